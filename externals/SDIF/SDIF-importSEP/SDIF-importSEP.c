@@ -430,6 +430,7 @@ void SDIFimport_import(SDIFImport *x, Symbol *fileNameIn)
     
     //  add frame to buffer (if frame already exists at same time, replace it)
     r = SDIFbuf_InsertFrame(x->t_buf, f, ESDIF_INSERT_REPLACE);
+    SDIFbuffer_FramesChanged(x->t_buffer);
     if(r != ESDIF_SUCCESS)
     {
       error("%s: problem adding frame at time %f in file \"%s\"", NAME, t, fileNameIn->s_name);
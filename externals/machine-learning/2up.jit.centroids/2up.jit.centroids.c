@@ -35,15 +35,12 @@
 #define REALLY_LARGE_NUMBER 999999999
 #define Z_BIAS	1.0f						// multiplier for z component in distance calc
 
-// e_pixdata-- stores which adjacent pixels are less in intensity. 
-// 
-typedef unsigned char e_pixdata;
-#define	PIX_RIGHT 	0x01
-#define	PIX_UP		0x02
-#define	PIX_LEFT	0x04
-#define	PIX_DOWN	0x08
-#define	PIX_ALL		0x0F
-#define PIX_DONE	0x10
+// label map entries-- union-find parent of each pixel above threshold, see labelImage().
+// pixels at or below threshold are never read or written. after the second pass 
+// the root of each blob holds BLOB_LABEL(index into the blob list).
+typedef int e_label;
+#define BLOB_LABEL(b)	(-1 - (b))
+#define INITIAL_BLOBS	256
 
 typedef struct _centroid_info
 {
@@ -61,6 +58,14 @@ typedef struct _centroid_info
 
 t_centroid_info gZeroCentroid = {0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0, 0, 0, 0};
 
+// moments of one blob, summed in double so large blobs stay accurate
+typedef struct _blob
+{
+	double					sum;
+	double					x_sum;
+	double					y_sum;
+}	t_blob;
+
 typedef struct _jit_centroids 
 {
 	t_object				ob;
@@ -78,7 +83,10 @@ typedef struct _jit_centroids
 	long					match;					// match old centroids with new at each frame
 	int						width;
 	int						height;
-	e_pixdata *				mInputMap;
+	e_label *				mInputMap;
+	t_blob *				mpBlobs;
+	long					mBlobSize;				// allocated size of mpBlobs
+	double *				mpMatchCost;			// assignment cost matrix for matchCentroids
 	
 	t_centroid_info	*		mpCurrentCentroids;
 	t_centroid_info *		mpNewCentroids;
@@ -97,16 +105,15 @@ typedef struct _jit_centroids
 void *jit_centroids_new(t_symbol *s, long argc, t_atom *argv);
 void jit_centroids_free(t_jit_centroids *x);
 void jit_centroids_assist(t_jit_centroids *x, void *b, long msg, long arg, char *dst);
-void free_map(e_pixdata *x, int width, int height);
-e_pixdata * new_map(int width, int height);
+void free_map(e_label *x, int width, int height);
+e_label * new_map(int width, int height);
 
 void jit_centroids_set_max(t_jit_centroids *x, void *attr, long argc, t_atom *argv);
 void jit_centroids_jit_matrix(t_jit_centroids *x, t_symbol *s, int argc, t_atom *argv);
-void mapImage(t_jit_centroids *x);
+long labelImage(t_jit_centroids *x);
 void gatherCentroids(t_jit_centroids *x);
-void gather_centroid(t_jit_centroids *x, int i, int j, t_centroid_info * c);
-void gather_centroid_recursive(t_jit_centroids *x, int i, int j, t_centroid_info * c);
 void matchCentroids(t_jit_centroids *x);
+void solveAssignment(const double *cost, int rows, int cols, int *assign);
 void reportCentroids(t_jit_centroids *x);
 
 #pragma mark -
@@ -201,8 +208,12 @@ void *jit_centroids_new(t_symbol *s, long argc, t_atom *argv)
 	x->mpCurrentCentroids = jit_getbytes(sizeof(t_centroid_info) * m);
 	x->mpNewCentroids = jit_getbytes(sizeof(t_centroid_info) * m);
 	x->mpPreviousCentroids = jit_getbytes(sizeof(t_centroid_info) * m);
+	x->mpMatchCost = jit_getbytes(sizeof(double) * MAX_POSSIBLE_CENTROIDS * MAX_POSSIBLE_CENTROIDS);
+	x->mBlobSize = INITIAL_BLOBS;
+	x->mpBlobs = (t_blob *)sysmem_newptr(sizeof(t_blob) * x->mBlobSize);
 	
-	if ((!x->mpCurrentCentroids) || (!x->mpNewCentroids) || (!x->mpPreviousCentroids)) 
+	if ((!x->mpCurrentCentroids) || (!x->mpNewCentroids) || (!x->mpPreviousCentroids) ||
+		(!x->mpMatchCost) || (!x->mpBlobs)) 
 	{
 		error("2up.jit.centroids: out of memory!");
 		x = 0;
@@ -228,6 +239,9 @@ void jit_centroids_free(t_jit_centroids *x)
 	jit_freebytes(x->mpNewCentroids, sizeof(t_centroid_info)*m);
 	jit_freebytes(x->mpCurrentCentroids, sizeof(t_centroid_info)*m);
 	jit_freebytes(x->mpPreviousCentroids, sizeof(t_centroid_info)*m);
+	jit_freebytes(x->mpMatchCost, sizeof(double) * MAX_POSSIBLE_CENTROIDS * MAX_POSSIBLE_CENTROIDS);
+	if (x->mpBlobs)
+		sysmem_freeptr(x->mpBlobs);
 	free_map(x->mInputMap, x->width, x->height);
 	max_jit_obex_free(x);
 }
@@ -283,23 +297,23 @@ void jit_centroids_set_max(t_jit_centroids *x, void *attr, long argc, t_atom *ar
 }
 
 
-void free_map(e_pixdata * pMap, int width, int height)
+void free_map(e_label * pMap, int width, int height)
 {
 	if (pMap)
 	{	
-		//jit_freebytes(pMap, width * height * sizeof(e_pixdata));
+		//jit_freebytes(pMap, width * height * sizeof(e_label));
 		sysmem_freeptr(pMap);
 		pMap = 0;
 	}
 }
 
 
-e_pixdata * new_map(int width, int height)
+e_label * new_map(int width, int height)
 {
 	// allocate image map
-	e_pixdata * pNew = 0;
-	//if (!(pNew = (e_pixdata *)jit_getbytes(width*height*sizeof(e_pixdata))))
-	if (!(pNew = (e_pixdata *)sysmem_newptr(width*height*sizeof(e_pixdata))))
+	e_label * pNew = 0;
+	//if (!(pNew = (e_label *)jit_getbytes(width*height*sizeof(e_label))))
+	if (!(pNew = (e_label *)sysmem_newptr(width*height*sizeof(e_label))))
 	{
 		error("2up.jit.centroids: couldn't make image map!");
 	}
@@ -376,109 +390,191 @@ void jit_centroids_jit_matrix(t_jit_centroids *x, t_symbol *s, int argc, t_atom
 		x->oneOverPixels = 1.f / (float)(width * height);		
 	}
 	
-	mapImage(x);
 	gatherCentroids(x);
 	matchCentroids(x);
 	reportCentroids(x);
 }
 
 
-void mapImage(t_jit_centroids *x)
+// find the root of pixel p's blob, pointing the pixels on the way straight at it. 
+static long label_find(e_label * pMap, long p)
+{
+	long r = p;
+	long next;
+	
+	while ((pMap[r] >= 0) && (pMap[r] != r))
+		r = pMap[r];
+	while (p != r)
+	{
+		next = pMap[p];
+		pMap[p] = r;
+		p = next;
+	}
+	return r;
+}
+
+static void label_union(e_label * pMap, long a, long b)
+{
+	a = label_find(pMap, a);
+	b = label_find(pMap, b);
+	
+	if (a < b)
+		pMap[b] = a;
+	else if (b < a)
+		pMap[a] = b;
+}
+
+// label pixels above threshold by the peak they climb to, and sum the moments 
+// of each blob into x->mpBlobs. returns the number of blobs. 
+// 
+// first pass: each pixel joins the blob of its highest neighbor, if that is 
+// higher than itself. peaks have no higher neighbor and start blobs of their own; 
+// equal neighbors of a peak (plateaus) join its blob. so touching fingers with 
+// separate peaks stay separate centroids.
+// second pass: find the root of each pixel and add the pixel to the root's moments.
+long labelImage(t_jit_centroids *x)
 {
 	int						i, j;
-	float *					pf_data = 0;
-	float *					pf_data_prev = 0;
-	float *					pf_data_next = 0;
-	e_pixdata *				p_map, * p_map_prev = 0, * p_map_next = 0;
-	int						firstrow, lastrow, firstcol, lastcol;
-	float					pixel;
+	long					p, q, r, b;
+	float *					pf_data;
+	float *					pf_data_prev;
+	float *					pf_data_next;
+	e_label *				p_map;
+	float					pixel, highest, h;
+	t_blob *				pNew;
+	long					n = 0;
 	
 	const int width = x->width;
 	const int height = x->height;
 	const int rowbytes = x->in_rowbytes;
-
-	// clear map
-	if (x->mInputMap)
+	const float cutoff = x->mSubtractThreshold ? x->threshold : 0.f;
+	e_label * const pMap = x->mInputMap;
+	
+	// first pass. row i+1 is initialized before row i is linked, because links can point down.
+	p_map = pMap;
+	pf_data = (float *)(x->mpInData);
+	for (j=0; j < width; j++)
 	{
-		memset(x->mInputMap, 0, width*height*sizeof(e_pixdata));
+		if (pf_data[j] - cutoff > 0.f)
+			p_map[j] = j;
 	}
-	else
-		return;
-
-	// set direction ptrs for each pixel to point to neighboring pixels of less intensity.
-	// PIX_DOWN means that pixel in down direction has less intensity, etc. 
-
 	for (i=0; i < height; i++)
 	{
-		firstrow = (i==0);
-		lastrow = (i==height-1);
-		
 		pf_data = (float *)(x->mpInData + i*rowbytes);
 		pf_data_prev = (float *)(x->mpInData + (i-1)*rowbytes);
 		pf_data_next = (float *)(x->mpInData + (i+1)*rowbytes);
-		
-		p_map = x->mInputMap + i*width;
-		p_map_prev = x->mInputMap + (i-1)*width;
-		p_map_next = x->mInputMap + (i+1)*width;
+		p_map = pMap + i*width;
 
+		if (i < height-1)
+		{
+			for (j=0; j < width; j++)
+			{
+				if (pf_data_next[j] - cutoff > 0.f)
+					p_map[width+j] = (i+1)*width + j;
+			}
+		}
+		
 		for (j=0; j < width; j++)
-		{		
-			firstcol = (j==0);
-			lastcol = (j==width-1);
+		{
 			pixel = pf_data[j];
-
-			// right
-			if (!lastcol)
+			if (pixel - cutoff <= 0.f)
+				continue;
+				
+			p = i*width + j;
+			highest = pixel;
+			q = -1;
+			
+			if ((j < width-1) && (pf_data[j+1] > highest))
 			{
-				if (pf_data[j+1] > pixel)
-					p_map[j+1] |= PIX_LEFT;
+				highest = pf_data[j+1];
+				q = p + 1;
 			}
-			else
+			if ((i > 0) && (pf_data_prev[j] > highest))
 			{
-				p_map[j] |= PIX_RIGHT;
+				highest = pf_data_prev[j];
+				q = p - width;
 			}
-			// up
-			if (!firstrow)
+			if ((j > 0) && (pf_data[j-1] > highest))
 			{
-				if (pf_data_prev[j] > pixel)
-					p_map_prev[j] |= PIX_DOWN;
+				highest = pf_data[j-1];
+				q = p - 1;
 			}
-			else
+			if ((i < height-1) && (pf_data_next[j] > highest))
 			{
-				p_map[j] |= PIX_UP;
+				highest = pf_data_next[j];
+				q = p + width;
 			}
-			// left
-			if (!firstcol)
+			
+			if (q >= 0)
 			{
-				if (pf_data[j-1] > pixel)
-					p_map[j-1] |= PIX_RIGHT;
+				label_union(pMap, p, q);
 			}
 			else
 			{
-				p_map[j] |= PIX_LEFT;
+				// peak: take in any neighbors on the same plateau
+				if ((j < width-1) && (pf_data[j+1] == pixel))
+					label_union(pMap, p, p + 1);
+				if ((i > 0) && (pf_data_prev[j] == pixel))
+					label_union(pMap, p, p - width);
+				if ((j > 0) && (pf_data[j-1] == pixel))
+					label_union(pMap, p, p - 1);
+				if ((i < height-1) && (pf_data_next[j] == pixel))
+					label_union(pMap, p, p + width);
 			}
-			// down
-			if (!lastrow)
+		}
+	}
+	
+	// second pass
+	for (i=0; i < height; i++)
+	{
+		pf_data = (float *)(x->mpInData + i*rowbytes);
+		
+		for (j=0; j < width; j++)
+		{
+			h = pf_data[j] - cutoff;
+			if (h <= 0.f)
+				continue;
+			
+			r = label_find(pMap, i*width + j);
+			if (pMap[r] == r)
 			{
-				if (pf_data_next[j] > pixel)
-					p_map_next[j] |= PIX_UP;
+				// first pixel of a new blob
+				if (n >= x->mBlobSize)
+				{
+					pNew = (t_blob *)sysmem_resizeptr(x->mpBlobs, sizeof(t_blob) * x->mBlobSize * 2);
+					if (!pNew)
+					{
+						error("2up.jit.centroids: out of memory for blobs!");
+						return n;
+					}
+					x->mpBlobs = pNew;
+					x->mBlobSize *= 2;
+				}
+				b = n++;
+				x->mpBlobs[b].sum = x->mpBlobs[b].x_sum = x->mpBlobs[b].y_sum = 0.;
+				pMap[r] = BLOB_LABEL(b);
 			}
 			else
 			{
-				p_map[j] |= PIX_DOWN;
-			} 
+				b = BLOB_LABEL(pMap[r]);
+			}
+			
+			x->mpBlobs[b].sum += h;
+			x->mpBlobs[b].x_sum += (double)j*h;
+			x->mpBlobs[b].y_sum += (double)i*h;
 		}
 	}
+	
+	return n;
 }
 
 
-
 void gatherCentroids(t_jit_centroids *x)
 {
-	int i, j;
-
-	unsigned char * p_map;
+	int i, k;
+	long b, blobs;
 	t_centroid_info			c;
+	t_blob *				pBlob;
 
 	int n = 0;			
 	
@@ -488,231 +584,160 @@ void gatherCentroids(t_jit_centroids *x)
 		x->mpNewCentroids[i] = gZeroCentroid;
 	}
 	
-	// gathering from peaks collects pixels into new centroids
-	for (i=0; i< x->height; i++)
+	if (!x->mInputMap)
 	{
-		p_map = x->mInputMap + i*x->width;
-		for (j=0; j< x->width; j++)
-		{
-			// if peak
-			if (p_map[j] == PIX_ALL)
-			{
-				// zero temp
-				c = gZeroCentroid;
-				
-				// gather
-				gather_centroid(x, i, j, &c);
-				
-				// if big enough, calc x and y and add to list
-				// first centroid index is 1. 
-				if (c.fp_sum > 0.)
-				{
-					n++;	
-					if (n > MAX_POSSIBLE_CENTROIDS) goto done;
-					
-					// calculate center of mass
-					c.fx = (float)c.x_sum / c.fp_sum;
-					c.fy = (float)c.y_sum / c.fp_sum;
-									
-					x->mpNewCentroids[n] = c;
-					x->mpNewCentroids[n].exists = true;
-				}
-			}
-		}
+		x->mNewCentroids = 0;
+		return;
 	}
 	
-done:
-
-	// sort new centroids by intensity
-	if (n > 1)
+	blobs = labelImage(x);
+	
+	// keep the most intense blobs, sorted by intensity.
+	// first centroid index is 1. 
+	for (b=0; b < blobs; b++)
 	{
-		for (i=1; i <= n; i++)
+		pBlob = &x->mpBlobs[b];
+		if (pBlob->sum <= 0.)
+			continue;
+		if ((n == MAX_POSSIBLE_CENTROIDS) && (pBlob->sum <= x->mpNewCentroids[n].fp_sum))
+			continue;
+			
+		c = gZeroCentroid;
+		c.fp_sum = pBlob->sum;
+		
+		// calculate center of mass
+		c.fx = pBlob->x_sum / pBlob->sum;
+		c.fy = pBlob->y_sum / pBlob->sum;
+		c.exists = true;
+		
+		if (n < MAX_POSSIBLE_CENTROIDS)
+			n++;
+		for (k = n; (k > 1) && (x->mpNewCentroids[k-1].fp_sum < c.fp_sum); k--)
 		{
-			for (j=i; j <= n; j++)
-			{
-				if (x->mpNewCentroids[j].fp_sum > x->mpNewCentroids[i].fp_sum)
-				{
-					c = x->mpNewCentroids[j];
-					x->mpNewCentroids[j] = x->mpNewCentroids[i];
-					x->mpNewCentroids[i] = c;
-				}
-			}
+			x->mpNewCentroids[k] = x->mpNewCentroids[k-1];
 		}
+		x->mpNewCentroids[k] = c;
 	}
 	
 	x->mNewCentroids = n;
 	return;
 }
 
-// notes: finish something like this to make a non-recursive version. 
-// right now this is not the bottleneck anyway, mapimage() takes more time.
-/*
-void gather_centroid(t_jit_centroids *x, int i, int j, t_centroid_info * c)
+
+inline float distSquared(const t_centroid_info * a, const t_centroid_info * b);
+inline float distSquared(const t_centroid_info * a, const t_centroid_info * b)
 {
-	register float h;				// pressure
-	register float * pf_data;		// ptr to float data row
-	unsigned char * p_map;
-	int width = x->width;
-	int firstrow, lastrow, firstcol, lastcol;
-		
-	// init stack. 
-	stack.depth = 0;
-		
-	do
-	{
-		p_map = x->mInputMap + i*width;
-		
-		// mark pixel as read
-		p_map[j] |= PIX_DONE;
+	float h, v, z;
+	h = fabsf(a->fx - b->fx);
+	v = fabsf(a->fy - b->fy);
+	z = fabsf(a->fp_sum - b->fp_sum);
+	return (h*h + v*v + Z_BIAS*z*z);
+}
 
-		pf_data = ((float *)(x->mpInData + i*x->in_rowbytes));
-		
-		h = pf_data[j];
-		if (x->mSubtractThreshold)
+
+// minimum total cost assignment of rows to distinct columns, rows <= cols 
+// (Hungarian method with potentials, O(rows*rows*cols)). cost is rows x cols, 
+// row major. assign[i] gets the column of row i. 
+void solveAssignment(const double *cost, int rows, int cols, int *assign)
+{
+	double u[MAX_POSSIBLE_CENTROIDS+1], v[MAX_POSSIBLE_CENTROIDS+1], minv[MAX_POSSIBLE_CENTROIDS+1];
+	int p[MAX_POSSIBLE_CENTROIDS+1], way[MAX_POSSIBLE_CENTROIDS+1];
+	char used[MAX_POSSIBLE_CENTROIDS+1];
+	int i, j, i0, j0, j1;
+	double delta, cur;
+	
+	// row and column 0 are the virtual start of each augmenting path
+	for (j=0; j <= cols; j++)
+	{
+		v[j] = 0.;
+		p[j] = 0;
+	}
+	for (i=0; i <= rows; i++)
+	{
+		u[i] = 0.;
+	}
+	
+	for (i=1; i <= rows; i++)
+	{
+		p[0] = i;
+		j0 = 0;
+		for (j=0; j <= cols; j++)
 		{
-			// subtracting threshold from pressure prevents discontinuity at zero for controllers
-			// but we don't want it in all applications
-			h -= x->threshold;		
+			minv[j] = REALLY_LARGE_NUMBER;
+			used[j] = false;
 		}
-		
-		if (h > 0.)
-		{			
-			// add pixel to centroid
-			c->fp_sum += h;
-			c->x_sum += (float)j*h;
-			c->y_sum += (float)i*h;
-			
-			// recurse to any unmarked adjacent pixels of lesser intensity
-			firstrow = (i==0);
-			lastrow = (i==x->height-1);
-			firstcol = (j==0);
-			lastcol = (j==x->width-1);
-			
-			// right
-			if ((!lastcol) && (p_map[j] & PIX_RIGHT) && (!(p_map[j+1] & PIX_DONE)))
-			{
-				stack.push(i, j);
-				j++;
-			}
-
-			// up
-			else if ((!firstrow) && (p_map[j] & PIX_UP) && (!(p_map[j-width] & PIX_DONE)))
+		do
+		{
+			used[j0] = true;
+			i0 = p[j0];
+			delta = REALLY_LARGE_NUMBER;
+			j1 = 0;
+			for (j=1; j <= cols; j++)
 			{
-				stack.push(i, j);
-				i--;
+				if (!used[j])
+				{
+					cur = cost[(i0-1)*cols + j-1] - u[i0] - v[j];
+					if (cur < minv[j])
+					{
+						minv[j] = cur;
+						way[j] = j0;
+					}
+					if (minv[j] < delta)
+					{
+						delta = minv[j];
+						j1 = j;
+					}
+				}
 			}
-
-			// left
-			else if ((!firstcol) && (p_map[j] & PIX_LEFT) && (!(p_map[j-1] & PIX_DONE)))
+			for (j=0; j <= cols; j++)
 			{
-				stack.push(i, j);
-				j--;
-			}
-	
-			// down
-			else if ((!lastrow) && (p_map[j] & PIX_DOWN) && (!(p_map[j+width] & PIX_DONE)))
-			{
-				stack.push(i, j);
-				i++;
+				if (used[j])
+				{
+					u[p[j]] += delta;
+					v[j] -= delta;
+				}
+				else
+				{
+					minv[j] -= delta;
+				}
 			}
-				
-			else 
-				stack.pop(&i, &j);
-
+			j0 = j1;
 		}
-	} 
-	while(stack.depth > 0);
-
-}
-*/
-
-
-void gather_centroid(t_jit_centroids *x, int i, int j, t_centroid_info * c)
-{
-	register float h;				// pressure
-	register float * pf_data;		// ptr to float data row
-	unsigned char * p_map;
-	int width = x->width;
-	int firstrow, lastrow, firstcol, lastcol;
+		while (p[j0] != 0);
 		
-	p_map = x->mInputMap + i*width;
-	
-	// mark pixel as read
-	p_map[j] |= PIX_DONE;
-
-	pf_data = ((float *)(x->mpInData + i*x->in_rowbytes));
-	
-	h = pf_data[j];
-	if (x->mSubtractThreshold)
-	{
-		// subtracting threshold from pressure prevents discontinuity at zero for controllers
-		// but we don't want it in all applications
-		h -= x->threshold;		
+		// flip the augmenting path
+		do
+		{
+			j1 = way[j0];
+			p[j0] = p[j1];
+			j0 = j1;
+		}
+		while (j0);
 	}
 	
-	if (h <= 0.)
+	for (j=1; j <= cols; j++)
 	{
-		return;
+		if (p[j])
+			assign[p[j]-1] = j-1;
 	}
-	
-	// add pixel to centroid
-	c->fp_sum += h;
-	c->x_sum += (float)j*h;
-	c->y_sum += (float)i*h;
-	
-	// recurse to any unmarked adjacent pixels of lesser intensity
-	firstrow = (i==0);
-	lastrow = (i==x->height-1);
-	firstcol = (j==0);
-	lastcol = (j==x->width-1);
-	
-	// right
-	if (!lastcol)
-		if (p_map[j] & PIX_RIGHT)
-			if (!(p_map[j+1] & PIX_DONE))
-				gather_centroid(x, i, j+1, c);
-	// up
-	if (!firstrow)
-		if (p_map[j] & PIX_UP)
-			if (!(p_map[j-width] & PIX_DONE))
-				gather_centroid(x, i-1, j, c);
-	// left
-	if (!firstcol)
-		if (p_map[j] & PIX_LEFT)
-			if (!(p_map[j-1] & PIX_DONE))
-				gather_centroid(x, i, j-1, c);
-	// down
-	if (!lastrow)
-		if (p_map[j] & PIX_DOWN)
-			if (!(p_map[j+width] & PIX_DONE))
-				gather_centroid(x, i+1, j, c);
-
-}
-
-
-
-inline float distSquared(const t_centroid_info * a, const t_centroid_info * b);
-inline float distSquared(const t_centroid_info * a, const t_centroid_info * b)
-{
-	float h, v, z;
-	h = fabsf(a->fx - b->fx);
-	v = fabsf(a->fy - b->fy);
-	z = fabsf(a->fp_sum - b->fp_sum);
-	return (h*h + v*v + Z_BIAS*z*z);
 }
 
 
 // swap new centroids to match order of current centroids close to them. 
+// new centroids are assigned to slots so that the total distance to the current 
+// centroids in them is smallest. distances are capped at the match distance, 
+// past which a match is as good as none; empty slots cost a bit more than that, 
+// so a new centroid only takes an empty slot when all the occupied ones are taken.
 void matchCentroids(t_jit_centroids *x)
 {
 	int i, j, m;
-	float d, dMin;
-	t_centroid_info * centroidList[MAX_POSSIBLE_CENTROIDS];
-	int reserved[MAX_POSSIBLE_CENTROIDS];
-	t_centroid_info	* t;		
-	t_centroid_info * pCurrent, * pNew, * pClosest;
+	float d;
+	int assign[MAX_POSSIBLE_CENTROIDS];
+	double gate;
+	t_centroid_info * pCurrent, * pNew;
 	const int new = MIN(x->mMaxCentroids, x->mNewCentroids);
 	const int current = x->mCurrentCentroids;
+	const int slots = x->mMaxCentroids;
 
 	x->mNewCentroids = new;
 	
@@ -725,95 +750,51 @@ void matchCentroids(t_jit_centroids *x)
 
 	if ((x->match) && (current > 0))
 	{
+		gate = x->mMatchDistance;
+		
 		// clear matches from current
-		for (i=1; i <= x->mMaxCentroids; i++)
+		for (i=1; i <= slots; i++)
 		{
 			x->mpCurrentCentroids[i].match = 0;
 		}
 		
-		// for each new centroid, get closest current centroid
+		// cost of each new centroid in each slot
 		for (i=1; i <= new; i++)
 		{
 			pNew = &x->mpNewCentroids[i];
 			pNew->index = i;
-			pNew->match = i; // default match for no current
-			dMin = REALLY_LARGE_NUMBER;
-			for(j=1; j<= x->mMaxCentroids; j++)
+			for(j=1; j <= slots; j++)
 			{
 				pCurrent = &x->mpCurrentCentroids[j];
-				if(pCurrent->exists)
-				{
-					d = distSquared(pNew, pCurrent);
-					if (d < dMin)
-					{
-						dMin = d;
-						pNew->matchDist = d;
-						pNew->match = j;
-					}
-				}
+				if (pCurrent->exists)
+					x->mpMatchCost[(i-1)*slots + j-1] = MIN(distSquared(pNew, pCurrent), gate);
+				else
+					x->mpMatchCost[(i-1)*slots + j-1] = gate + 1.;
 			}
-			pClosest = &x->mpCurrentCentroids[pNew->match];
 		}
+		
+		solveAssignment(x->mpMatchCost, new, slots, assign);
 
-		// sort centroids into a list by distance to closest current value
 		for (i=1; i <= new; i++)
 		{
 			pNew = &x->mpNewCentroids[i];
-			centroidList[i] = pNew;
-		}
-		if (new > 1)
-		{
-			for (i=1; i <= new; i++)
-			{
-				pNew = &x->mpNewCentroids[i];
-				
-				for (j=i; j <= new; j++)
-				{
-					if (centroidList[i]->matchDist > centroidList[j]->matchDist)
-					{
-						t = centroidList[j];
-						centroidList[j] = centroidList[i];
-						centroidList[i] = t;
-					}
-				}
-			}
-		}
-
-		// mark existing as free
-		for (i=1; i <= x->mMaxCentroids; i++)
-		{
-			reserved[i] = false;
-		}
-
-
-		// in order of distance, try to put centroids where they match 
-		for(i=1; i<=new; i++)
-		{
-			m = centroidList[i]->match;
-			d = centroidList[i]->matchDist;
-			if (!reserved[m]) // desired match is not reserved
-			{			
-				// centroid matches with previous.
-				reserved[m] = true;
-				x->mpCurrentCentroids[m].match = centroidList[i]->index;
+			m = assign[i-1] + 1;
+			pCurrent = &x->mpCurrentCentroids[m];
+			
+			pCurrent->match = i;
+			pNew->match = m;
 			
-				// mark continuous centroids.
-				centroidList[i]->matchesPrevious = (x->mpCurrentCentroids[m].exists) && (d < x->mMatchDistance);
+			// mark continuous centroids.
+			if (pCurrent->exists)
+			{
+				d = distSquared(pNew, pCurrent);
+				pNew->matchDist = d;
+				pNew->matchesPrevious = (d < x->mMatchDistance);
 			}
-			else	// not a continued centroid, just find room anywhere. 
+			else
 			{
-				centroidList[i]->matchesPrevious = false; 
-				for(j=1; j<=x->mMaxCentroids; j++)
-				{
-					if (!reserved[j])
-					{
-						reserved[j] = true;
-						x->mpCurrentCentroids[j].match = centroidList[i]->index;
-
-						centroidList[i]->match = j; // reassign
-						break;
-					}
-				}
+				pNew->matchDist = REALLY_LARGE_NUMBER;
+				pNew->matchesPrevious = false;
 			}
 		}		
 	}
@@ -56,6 +56,9 @@ long		n;
 #endif
 
 	
+#ifdef MAXObject
+	nn_train_stop(x);
+#endif
 	
 	if (x->trainingSet.patterns) {
 	
@@ -272,7 +275,8 @@ void	*nn_recognize(x,vector,out)
 NeuralNet	*x;
 double		*vector,*out;
 {
-	recognize(x->nn_net,vector,out,0L);
+	if (!nn_recognize_dense(x,vector,out,1))
+		recognize(x->nn_net,vector,out,0L);
 }
 
 /* ------------------------- nn_reinitialise_weights --------------------- */
@@ -376,7 +380,8 @@ void	*nn_recognize(x,s,argc,argv)
 					break;
 			}
 		}
-		recognize(x->nn_net,x->nn_exemplers,x->nn_outputs,0L);
+		if (!nn_recognize_dense(x,x->nn_exemplers,x->nn_outputs,1))
+			recognize(x->nn_net,x->nn_exemplers,x->nn_outputs,0L);
 		if (x->nn_debug) {
 			post("RECOGNIZE out: %ld",gettime());
 		}
@@ -392,6 +397,63 @@ void	*nn_recognize(x,s,argc,argv)
 	
 }
 
+/* ------------------------- nn_recognize_batch ------------------------ */
+/*
+ * recognize a whole list of input patterns at once; outputs are sent
+ * out as one "batch" list, numOUT values per pattern
+ */
+void	*nn_recognize_batch(x,s,argc,argv)
+	NeuralNet	*x;
+	Symbol	*s;
+	short	argc;
+	Atom	*argv;
+{
+	long	i,k,n,patterns;
+	double	*inputs,*outputs;
+	Atom	*list;
+	
+	
+	
+	for (i=0,n=0;i<argc;i++)
+		if (argv[i].a_type!=A_SYM)
+			n++;
+	patterns = n/x->nn_net->numIN;
+	if (patterns < 1) {
+	   post("Not Enough Inputs");
+	   return;
+	}
+	inputs = (double*)sysmem_newptr(sizeof(double)*patterns*x->nn_net->numIN);
+	outputs = (double*)sysmem_newptr(sizeof(double)*patterns*x->nn_net->numOUT);
+	list = (Atom*)sysmem_newptr(sizeof(Atom)*patterns*x->nn_net->numOUT);
+	if (!inputs || !outputs || !list) {
+		post("MaxNet:recognize_batch - Not enough memory");
+		goto out;
+	}
+	for (i=0,k=0;i<argc && k<patterns*x->nn_net->numIN;i++) {
+		switch(argv[i].a_type) {
+			case A_LONG:
+			    inputs[k++] = (double) argv[i].a_w.w_long;
+				break;
+			case A_FLOAT:
+			    inputs[k++] = (double) argv[i].a_w.w_float;
+				break;
+		}
+	}
+	if (!nn_recognize_dense(x,inputs,outputs,patterns)) {
+		for (k=0;k<patterns;k++)
+			recognize(x->nn_net,inputs+k*x->nn_net->numIN,
+							outputs+k*x->nn_net->numOUT,0L);
+	}
+	for (i=0;i<patterns*x->nn_net->numOUT;i++)
+	   SETFLOAT(list+i,(float)outputs[i]);
+	nn_outlet_list(x->nn_myOutlet,"batch",(short)(patterns*x->nn_net->numOUT),list);
+	qelem_set(x->nn_dqelem);
+out:
+	if (list) sysmem_freeptr(list);
+	if (outputs) sysmem_freeptr(outputs);
+	if (inputs) sysmem_freeptr(inputs);
+}
+
 /* ------------------------- nn_reinitialise_weights --------------------- */
 
 extern	double	random();
@@ -403,7 +465,9 @@ void	*nn_reinitialise_weights(x)
 	short		i,j,index;
 	
 	
-	
+#ifdef MAXObject
+	nn_train_stop(x);
+#endif
 	weights = (double*)getbytes((short)(sizeof(double)*WEIGHTS));
 
 	index = 0;
@@ -730,7 +794,9 @@ Atom	*argv;
 	double error_measure;
 	
 	
-
+#ifdef MAXObject
+	nn_train_stop(x);
+#endif
 	if (x->nn_debug) {
 		post("BPLEARN in: %ld",gettime());
 	}
@@ -783,7 +849,9 @@ Atom	*argv;
 	Atom	myAtom;
 	
 	
-
+#ifdef MAXObject
+	nn_train_stop(x);
+#endif
 	if (x->nn_debug) {
 		post("BPLEARN in: %ld",gettime());
 	}
@@ -966,7 +1034,10 @@ void	*nn_file(Symbol *s)
 void *nn_free(x)
 NeuralNet *x;
 {
-	
+#ifdef MAXObject
+	nn_train_stop(x);
+	qelem_free(x->nn_tqelem);
+#endif
 	qelem_free(x->nn_qelem);
 	qelem_free(x->nn_dqelem);
 #ifdef GRAPHICS
@@ -978,6 +1049,10 @@ NeuralNet *x;
 		nn_free_pattern_memory(x,&x->testSet);
 	if (x->trainingSet.patterns > 0)
 		nn_free_pattern_memory(x,&x->trainingSet);
+	freeDenseNet(x->nn_dense);
+#ifdef MAXObject
+	systhread_mutex_free(x->nn_trainLock);
+#endif
 	if (x->nn_net) {
 		freeNetwork(x->nn_net);
 		if (x->nn_net) freebytes(x->nn_net,(short)(sizeof(Network)));
@@ -1007,6 +1082,9 @@ void *nn_functHid(NeuralNet *x,Symbol *fnType)
 	else if (fnType==gensym("weightedLinear"))
 		index = WEIGHTEDLINEAR;
 		
+#ifdef MAXObject
+	nn_train_stop(x);
+#endif
 	setHidFunctAll(x->nn_net,index);
 	
 }
@@ -1033,6 +1111,9 @@ void *nn_functOut(NeuralNet *x,Symbol *fnType)
 		index = WEIGHTEDLINEAR;
 	
 		
+#ifdef MAXObject
+	nn_train_stop(x);
+#endif
 	setOutFunctAll(x->nn_net,index);
 	
 }
@@ -1106,7 +1187,9 @@ void *nn_hid_slope(x,slope)
 	NeuralNet	*x;
 	double		slope;
 {
-	
+#ifdef MAXObject
+	nn_train_stop(x);
+#endif
 	setSlopeFactorHidAll(x->nn_net,slope);
 	
 }
@@ -1162,7 +1245,9 @@ Atom	*argv;
 	double error_measure;
 	
 	
-	
+#ifdef MAXObject
+	nn_train_stop(x);
+#endif
 	if (argc < (x->nn_net->numIN+x->nn_net->numOUT)) {
 	   post("Not Enough Inputs");
 	}
@@ -1253,7 +1338,9 @@ void *nn_out_slope(x,slope)
 	NeuralNet	*x;
 	double		slope;
 {
-	
+#ifdef MAXObject
+	nn_train_stop(x);
+#endif
 	setSlopeFactorOutAll(x->nn_net,slope);
 	
 }
@@ -1329,6 +1416,10 @@ void *nn_qfn(x)
 	
 	
 	
+#ifdef MAXObject
+	if (x->nn_read || x->nn_get_train)
+		nn_train_stop(x);
+#endif
 	savelock = lockout_set(1);
 	if (x->nn_read) {
 		nn_doread(x,x->nn_readFile);
@@ -1549,6 +1640,7 @@ void main(fptr *f)
 	addmess((method) nn_out_slope_learn,"out_slope_learn",A_FLOAT,0);
 	addmess((method) nn_out_slope_mom,"out_slope_mom",A_FLOAT,0);
 	addmess((method) nn_recognize,"recognize",A_GIMME,0);
+	addmess((method) nn_recognize_batch,"recognize_batch",A_GIMME,0);
 	addmess((method) nn_reinitialise_weights,"reinitialise",0);
 #ifdef NEVER
 	addmess((method) nn_save, "psave", A_CANT, 0);
@@ -1556,6 +1648,8 @@ void main(fptr *f)
 	addmess((method) nn_save_weights,"save_weights",A_DEFSYM,0);
 	addmess((method) nn_scroll,"scroll",A_CANT,0);
 	addmess((method) nn_status,"status",0);
+	addmess((method) nn_train_stop,"stop",0);
+	addmess((method) nn_train,"train",A_LONG,A_DEFLONG,0);
 	addmess((method) nn_update, "update", A_CANT, 0);
 	addmess((method) nn_wsize,"wsize",A_CANT,0);
 	addmess((method) nn_xValidateTest,"xValidateTest",0);
@@ -71,6 +71,7 @@ University of California, Berkeley.
 #include "ext_user.h"
 #include "ext_wind.h"
 #include "ext_anim.h"
+#include "ext_systhread.h"
 #define	BUFSIZ	(512)
 
 #else /* not MAXObject */
@@ -110,6 +111,8 @@ SCOPE void *class;
 #ifndef MAXObject
 #define freebytes(x,y)	free(x)
 #define getbytes(x)		malloc((size_t)(x))
+#define sysmem_newptr(x)	malloc((size_t)(x))
+#define sysmem_freeptr(x)	free(x)
 #define	post			printf("\nMax: ");printf
 #define lockout_set
 #define	SETFLOAT
@@ -56,6 +56,7 @@ double *targets;
 		neuron = neurons+uid;
 		(*neuron->deltaSlopeFunction)(neuron,nnet->slopeLearningRate,nnet->slopeMomentum);
 	}
+	nnet->version++;
 }
 
 double	LAMBDA=5.0E-03;
@@ -137,6 +138,7 @@ NNetPtr	nnet;
 	post("bpAdjustWeights");
 #endif
 	neurons = nnet->units;
+	nnet->version++;
 		
 	/* calculate weights */
 	lr = nnet->weightLearningRate;
@@ -67,6 +67,7 @@ NNetPtr createNet(int in,int hid,int hiddenLayers,int out,
 	nnet->weightMomentum		= momentum;
 
 	nnet->lambda		= 5.0E-05;
+	nnet->version		= 0;
 	
 	if ((err=(createProcessingUnits(nnet,hidFuncts,outFuncts)))<0)
 		return((NNetPtr)err);
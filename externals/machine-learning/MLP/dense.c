@@ -0,0 +1,617 @@
+/* Copyright (c) 1990-2006.  The Regents of the University of California (Regents).
+All Rights Reserved.
+
+Permission to use, copy, modify, and distribute this software and its
+documentation for educational, research, and not-for-profit purposes, without
+fee and without a signed licensing agreement, is hereby granted, provided that
+the above copyright notice, this paragraph and the following two paragraphs
+appear in all copies, modifications, and distributions.  Contact The Office of
+Technology Licensing, UC Berkeley, 2150 Shattuck Avenue, Suite 510, Berkeley,
+CA 94720-1620, (510) 643-7201, for commercial licensing opportunities.
+
+     IN NO EVENT SHALL REGENTS BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT,
+     SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS,
+     ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF
+     REGENTS HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+     REGENTS SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT
+     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+     FOR A PARTICULAR PURPOSE. THE SOFTWARE AND ACCOMPANYING
+     DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS".
+     REGENTS HAS NO OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES,
+     ENHANCEMENTS, OR MODIFICATIONS.
+*/
+
+/*******************************************************************
+
+	dense.c
+	
+	compiles a fully connected network to one weight matrix per
+	layer, for batched recognition and mini-batch training
+	
+*******************************************************************/
+
+#define SCOPE	extern
+#include <math.h>
+#include "NNInclude.h"
+
+#define	DENSE_CHUNK	64		/* patterns per pass when recognizing many */
+
+static	Boolean	denseFunction(int);
+static	double	denseDot(double *,double *,short);
+static	void	denseActivate(DenseLayer *,double *,double *);
+static	void	denseForward(DenseNetPtr,double *,long);
+static	void	denseStoreUnits(DenseNetPtr,NNetPtr,double *,long);
+
+/************************* denseFunction *****************************/
+/*
+ * the activations a layer can be compiled with
+ */
+static Boolean	denseFunction(int functionIndex)
+{
+	return (functionIndex==SIGMOID)||(functionIndex==SIGMOIDT)||
+			(functionIndex==LINEAR)||(functionIndex==RADIAL);
+}
+
+/************************* newDenseNet *****************************/
+
+static DenseNetPtr	newDenseNet(short numIN,short numHID,short numHIDLayers,short numOUT)
+{
+	DenseNetPtr	d;
+	DenseLayer	*layer;
+	short	l;
+	long	size;
+
+	if (!(d = (DenseNetPtr)sysmem_newptr(sizeof(DenseNet))))
+		return nil;
+	d->numIN = numIN;
+	d->numOUT = numOUT;
+	d->numLayers = numHIDLayers+1;
+	d->capacity = 0;
+	d->version = -1;
+	d->weightLearningRate = d->weightMomentum = 0.0;
+	d->slopeLearningRate = d->slopeMomentum = 0.0;
+	if (!(d->layers = (DenseLayer *)sysmem_newptr(sizeof(DenseLayer)*d->numLayers))) {
+		sysmem_freeptr(d);
+		return nil;
+	}
+	for (l=0;l<d->numLayers;l++) {
+		layer = d->layers+l;
+		layer->numFrom = l ? numHID : numIN;
+		layer->numTo = (l<numHIDLayers) ? numHID : numOUT;
+		layer->functionIndex = SIGMOID;
+		layer->weights = layer->slope = nil;
+		layer->netIn = layer->output = layer->delta = nil;
+	}
+	for (l=0;l<d->numLayers;l++) {
+		layer = d->layers+l;
+		size = (long)layer->numTo*(layer->numFrom+1);
+		if (!(layer->weights = (double *)sysmem_newptr(sizeof(double)*3*size)) ||
+			!(layer->slope = (double *)sysmem_newptr(sizeof(double)*3*layer->numTo))) {
+			freeDenseNet(d);
+			return nil;
+		}
+		layer->change = layer->weights+size;
+		layer->gradient = layer->change+size;
+		layer->deltaSlope = layer->slope+layer->numTo;
+		layer->slopeGradient = layer->deltaSlope+layer->numTo;
+	}
+	if (!reserveDenseNet(d,1)) {
+		freeDenseNet(d);
+		return nil;
+	}
+	return d;
+}
+
+/************************* freeDenseNet *****************************/
+
+void	*freeDenseNet(DenseNetPtr d)
+{
+	short	l;
+	DenseLayer	*layer;
+
+	if (!d)
+		return;
+	for (l=0;l<d->numLayers;l++) {
+		layer = d->layers+l;
+		if (layer->weights) sysmem_freeptr(layer->weights);
+		if (layer->slope) sysmem_freeptr(layer->slope);
+		if (layer->netIn) sysmem_freeptr(layer->netIn);
+	}
+	sysmem_freeptr(d->layers);
+	sysmem_freeptr(d);
+}
+
+/************************* reserveDenseNet *****************************/
+/*
+ * make room for the per pattern rows of a batch of patterns
+ */
+int		reserveDenseNet(DenseNetPtr d,long patterns)
+{
+	short	l;
+	DenseLayer	*layer;
+	double	*rows;
+
+	if (patterns<=d->capacity)
+		return 1;
+	for (l=0;l<d->numLayers;l++) {
+		layer = d->layers+l;
+		if (!(rows = (double *)sysmem_newptr(sizeof(double)*3*patterns*layer->numTo)))
+			return 0;
+		if (layer->netIn) sysmem_freeptr(layer->netIn);
+		layer->netIn = rows;
+		layer->output = rows+patterns*layer->numTo;
+		layer->delta = layer->output+patterns*layer->numTo;
+	}
+	d->capacity = patterns;
+	return 1;
+}
+
+/************************* compileNet *****************************/
+/*
+ * nil if some layer is not fully connected to the one below or mixes
+ * activation functions, or uses one that needs the link lists
+ * (sigmapi, weightedLinear)
+ */
+DenseNetPtr	compileNet(NNetPtr nnet)
+{
+	DenseNetPtr	d;
+	DenseLayer	*layer;
+	unitPtr	neurons,neuron;
+	linkPtr	inLink;
+	short	l,j,from,to,hidLayers;
+	long	col,links,stride;
+
+#ifdef debug
+	post("compileNet");
+#endif
+
+	neurons = nnet->units;
+	hidLayers = nnet->numHID ? nnet->numHIDLayers : 0;
+	if (!(d = newDenseNet(nnet->numIN,nnet->numHID,hidLayers,nnet->numOUT)))
+		return nil;
+
+	for (l=0;l<d->numLayers;l++) {
+		layer = d->layers+l;
+		from = l ? HID_UID((l-1)*nnet->numHID) : IN_UID(0);
+		to = (l<hidLayers) ? HID_UID(l*nnet->numHID) : OUT_UID(0);
+		stride = layer->numFrom+1;
+		layer->functionIndex = (neurons+to)->functionIndex;
+		if (!denseFunction(layer->functionIndex))
+			goto fail;
+
+		for (j=0;j<layer->numTo;j++) {
+			neuron = neurons+to+j;
+			if (neuron->functionIndex!=layer->functionIndex)
+				goto fail;
+			layer->slope[j] = neuron->slope;
+			layer->deltaSlope[j] = neuron->deltaSlope;
+
+			links = 0;
+			inLink = neuron->inLinks;
+			while (inLink) {
+				col = inLink->fromUnit-neurons;
+				if (col==BIAS_UID)
+					col = layer->numFrom;
+				else if (InRange(col,from,from+layer->numFrom-1))
+					col -= from;
+				else
+					goto fail;
+				layer->weights[j*stride+col] = inLink->weight;
+				layer->change[j*stride+col] = inLink->data;
+				links++;
+				inLink = inLink->nextInlink;
+			}
+			if (links!=stride)
+				goto fail;
+		}
+	}
+	d->version = nnet->version;
+	return d;
+
+fail:
+	freeDenseNet(d);
+	return nil;
+}
+
+/************************* storeDenseNet *****************************/
+/*
+ * put the weights and slopes back in the link lists, so the rest
+ * of the object and the weight files see them
+ */
+void	*storeDenseNet(DenseNetPtr d,NNetPtr nnet)
+{
+	DenseLayer	*layer;
+	unitPtr	neurons,neuron;
+	linkPtr	inLink;
+	short	l,j,from,to;
+	long	col,stride;
+
+	neurons = nnet->units;
+	for (l=0;l<d->numLayers;l++) {
+		layer = d->layers+l;
+		from = l ? HID_UID((l-1)*nnet->numHID) : IN_UID(0);
+		to = (l<d->numLayers-1) ? HID_UID(l*nnet->numHID) : OUT_UID(0);
+		stride = layer->numFrom+1;
+		for (j=0;j<layer->numTo;j++) {
+			neuron = neurons+to+j;
+			neuron->slope = layer->slope[j];
+			neuron->deltaSlope = layer->deltaSlope[j];
+			inLink = neuron->inLinks;
+			while (inLink) {
+				col = inLink->fromUnit-neurons;
+				col = (col==BIAS_UID) ? layer->numFrom : col-from;
+				inLink->weight = layer->weights[j*stride+col];
+				inLink->data = layer->change[j*stride+col];
+				inLink = inLink->nextInlink;
+			}
+		}
+	}
+	nnet->version++;
+	d->version = nnet->version;
+}
+
+/************************* cloneDenseNet *****************************/
+
+DenseNetPtr	cloneDenseNet(DenseNetPtr d)
+{
+	DenseNetPtr	c;
+	short	numHID;
+
+	numHID = (d->numLayers>1) ? d->layers[0].numTo : 0;
+	if (!(c = newDenseNet(d->numIN,numHID,d->numLayers-1,d->numOUT)))
+		return nil;
+	copyDenseWeights(c,d);
+	return c;
+}
+
+/************************* copyDenseWeights *****************************/
+/*
+ * copy weights, slopes and momentum between nets of the same shape
+ */
+void	*copyDenseWeights(DenseNetPtr dst,DenseNetPtr src)
+{
+	short	l;
+	long	size;
+	DenseLayer	*s,*t;
+
+	for (l=0;l<src->numLayers;l++) {
+		s = src->layers+l;
+		t = dst->layers+l;
+		size = (long)s->numTo*(s->numFrom+1);
+		t->functionIndex = s->functionIndex;
+		memcpy(t->weights,s->weights,sizeof(double)*2*size);		/* weights and change */
+		memcpy(t->slope,s->slope,sizeof(double)*2*s->numTo);		/* slope and deltaSlope */
+	}
+	dst->version = src->version;
+	dst->weightLearningRate = src->weightLearningRate;
+	dst->weightMomentum = src->weightMomentum;
+	dst->slopeLearningRate = src->slopeLearningRate;
+	dst->slopeMomentum = src->slopeMomentum;
+}
+
+/************************* denseFeedback *****************************/
+/*
+ * inputs below -0.999 feed back a unit's output (see initialiseInputUnits),
+ * which the compiled net does not do
+ */
+Boolean	denseFeedback(double *inputs,long n)
+{
+	long	i;
+
+	for (i=0;i<n;i++)
+		if (inputs[i] < -0.999)
+			return true;
+	return false;
+}
+
+/************************* denseDot *****************************/
+
+static double	denseDot(double *w,double *x,short n)
+{
+	double	s0=0.0,s1=0.0,s2=0.0,s3=0.0;
+	short	i;
+
+	for (i=0;i+4<=n;i+=4) {
+		s0 += w[i]*x[i];
+		s1 += w[i+1]*x[i+1];
+		s2 += w[i+2]*x[i+2];
+		s3 += w[i+3]*x[i+3];
+	}
+	for (;i<n;i++)
+		s0 += w[i]*x[i];
+	return (s0+s1)+(s2+s3);
+}
+
+/************************* denseActivate *****************************/
+/*
+ * same as the unit activation functions, one layer row at a time
+ */
+static void	denseActivate(DenseLayer *layer,double *netIn,double *output)
+{
+	short	j,n;
+	double	*slope;
+
+	n = layer->numTo;
+	slope = layer->slope;
+	switch (layer->functionIndex) {
+		case SIGMOID:
+			for (j=0;j<n;j++)
+				output[j] = 1.0/(1.0 + exp(-slope[j]*netIn[j]));
+			break;
+		case SIGMOIDT:
+			for (j=0;j<n;j++)
+				output[j] = sigmoidT(netIn[j],slope[j],0.0);
+			break;
+		case LINEAR:
+			for (j=0;j<n;j++)
+				output[j] = slope[j]*netIn[j];
+			break;
+		case RADIAL:
+			for (j=0;j<n;j++)
+				output[j] = exp(-slope[j]*netIn[j]*netIn[j]);
+			break;
+	}
+}
+
+/************************* denseForward *****************************/
+/*
+ * one weight row at a time over all the patterns, then the activations
+ */
+static void	denseForward(DenseNetPtr d,double *inputs,long patterns)
+{
+	DenseLayer	*layer;
+	double	*in,*w;
+	short	l,j,numFrom,numTo;
+	long	p;
+
+	in = inputs;
+	for (l=0;l<d->numLayers;l++) {
+		layer = d->layers+l;
+		numFrom = layer->numFrom;
+		numTo = layer->numTo;
+		for (j=0;j<numTo;j++) {
+			w = layer->weights+j*(numFrom+1);
+			for (p=0;p<patterns;p++)
+				layer->netIn[p*numTo+j] = denseDot(w,in+p*numFrom,numFrom) + w[numFrom];
+		}
+		for (p=0;p<patterns;p++)
+			denseActivate(layer,layer->netIn+p*numTo,layer->output+p*numTo);
+		in = layer->output;
+	}
+}
+
+/************************* denseStoreUnits *****************************/
+/*
+ * leave the units as recognize() would after pattern p, for the
+ * messages that work from the last forward pass (back, bpInError)
+ */
+static void	denseStoreUnits(DenseNetPtr d,NNetPtr nnet,double *inputs,long p)
+{
+	DenseLayer	*layer;
+	unitPtr	neurons;
+	short	l,j,to;
+
+	neurons = nnet->units;
+	for (j=0;j<d->numIN;j++)
+		(neurons+IN_UID(j))->output = inputs[j];
+	for (l=0;l<d->numLayers;l++) {
+		layer = d->layers+l;
+		to = (l<d->numLayers-1) ? HID_UID(l*nnet->numHID) : OUT_UID(0);
+		for (j=0;j<layer->numTo;j++) {
+			(neurons+to+j)->netIn = layer->netIn[p*layer->numTo+j];
+			(neurons+to+j)->output = layer->output[p*layer->numTo+j];
+		}
+	}
+}
+
+/************************* denseRecognize *****************************/
+/*
+ * outputs for many patterns, DENSE_CHUNK at a time.  If nnet is given
+ * its units are left with the state of the last pattern.  Returns 0 if
+ * out of memory.
+ */
+int		denseRecognize(DenseNetPtr d,double *inputs,double *outputs,long patterns,NNetPtr nnet)
+{
+	long	p,n=0;
+	DenseLayer	*last;
+
+	if (!reserveDenseNet(d,MIN(patterns,DENSE_CHUNK)))
+		return 0;
+	last = d->layers+d->numLayers-1;
+	for (p=0;p<patterns;p+=n) {
+		n = MIN(patterns-p,d->capacity);
+		denseForward(d,inputs+p*d->numIN,n);
+		memcpy(outputs+p*d->numOUT,last->output,sizeof(double)*n*d->numOUT);
+	}
+	if (nnet && patterns)
+		denseStoreUnits(d,nnet,inputs+(patterns-1)*d->numIN,n-1);
+	return 1;
+}
+
+/************************* denseLearn *****************************/
+/*
+ * back propagation over a batch of patterns: the weight change is the
+ * mean of the per pattern changes bpLearn() would make, over the
+ * patterns whose error is above the tolerance.  One pattern per batch
+ * learns like bpLearn().  Returns the summed error of the batch.
+ */
+double	denseLearn(DenseNetPtr d,double *inputs,double *targets,double *errz,long patterns,double tolerance)
+{
+	DenseLayer	*layer,*upper;
+	double	*in,*w,*g,*delta,*row;
+	double	te,o,derivative,err,sum,rate;
+	short	l,i,j,numFrom,numTo,stride;
+	long	p,active;
+
+	if (!reserveDenseNet(d,patterns))
+		return 0.0;
+	denseForward(d,inputs,patterns);
+
+	/* output deltas, and the slope gradient */
+	layer = d->layers+d->numLayers-1;
+	numTo = layer->numTo;
+	for (j=0;j<numTo;j++)
+		layer->slopeGradient[j] = 0.0;
+	sum = 0.0;
+	active = 0;
+	for (p=0;p<patterns;p++) {
+		err = 0.0;
+		for (j=0;j<numTo;j++) {
+			te = targets[p*numTo+j]-layer->output[p*numTo+j];
+			err += te*te;
+		}
+		err /= 2.0;
+		sum += err;
+		if (errz)
+			errz[p] = err;
+
+		delta = layer->delta+p*numTo;
+		if (err<=tolerance) {
+			for (j=0;j<numTo;j++)
+				delta[j] = 0.0;
+			continue;
+		}
+		active++;
+		for (j=0;j<numTo;j++) {
+			te = targets[p*numTo+j]-layer->output[p*numTo+j];
+			o = layer->output[p*numTo+j];
+			switch (layer->functionIndex) {
+				case SIGMOID:
+					derivative = layer->slope[j]*o*(1.0-o)+0.1;
+					layer->slopeGradient[j] += te*(layer->netIn[p*numTo+j]*o*(1.0-o)+0.1);
+					break;
+				case SIGMOIDT:
+					derivative = layer->slope[j]*o*(1.0-o);
+					layer->slopeGradient[j] += te*(layer->netIn[p*numTo+j]*o*(1.0-o)+0.1);
+					break;
+				case LINEAR:
+					derivative = layer->slope[j];
+					layer->slopeGradient[j] += te*layer->netIn[p*numTo+j];
+					break;
+				case RADIAL:
+					derivative = -2*layer->netIn[p*numTo+j]*layer->slope[j]*o;
+					layer->slopeGradient[j] -= te*layer->netIn[p*numTo+j]*layer->netIn[p*numTo+j]*o;
+					break;
+			}
+			delta[j] = te*derivative;
+		}
+	}
+	if (!active)
+		return sum;
+
+	/* hidden deltas, from the weights before this batch changes them */
+	for (l=d->numLayers-2;l>=0;l--) {
+		layer = d->layers+l;
+		upper = layer+1;
+		numTo = layer->numTo;
+		stride = upper->numFrom+1;
+		for (p=0;p<patterns;p++) {
+			delta = layer->delta+p*numTo;
+			for (i=0;i<numTo;i++)
+				delta[i] = 0.0;
+			for (j=0;j<upper->numTo;j++) {
+				te = upper->delta[p*upper->numTo+j];
+				if (te==0.0)
+					continue;
+				w = upper->weights+j*stride;
+				for (i=0;i<numTo;i++)
+					delta[i] += te*w[i];
+			}
+			for (i=0;i<numTo;i++) {
+				o = layer->output[p*numTo+i];
+				switch (layer->functionIndex) {
+					case SIGMOID:
+						derivative = layer->slope[i]*o*(1.0-o)+0.1;
+						break;
+					case SIGMOIDT:
+						derivative = layer->slope[i]*o*(1.0-o);
+						break;
+					case LINEAR:
+						derivative = 0.0;		/* linearHidden() never sets a delta */
+						break;
+					case RADIAL:
+						derivative = -2*layer->netIn[p*numTo+i]*layer->slope[i]*o;
+						break;
+				}
+				delta[i] *= derivative;
+			}
+		}
+	}
+
+	/* weights */
+	if (d->weightLearningRate>0.0) {
+		rate = d->weightLearningRate/active;
+		in = inputs;
+		for (l=0;l<d->numLayers;l++) {
+			layer = d->layers+l;
+			numFrom = layer->numFrom;
+			numTo = layer->numTo;
+			stride = numFrom+1;
+			for (i=0;i<numTo*stride;i++)
+				layer->gradient[i] = 0.0;
+			for (p=0;p<patterns;p++) {
+				row = in+p*numFrom;
+				for (j=0;j<numTo;j++) {
+					te = layer->delta[p*numTo+j];
+					if (te==0.0)
+						continue;
+					g = layer->gradient+j*stride;
+					for (i=0;i<numFrom;i++)
+						g[i] += te*row[i];
+					g[numFrom] += te;				/* bias unit output is 1 */
+				}
+			}
+			for (i=0;i<numTo*stride;i++) {
+				layer->change[i] = rate*layer->gradient[i] + d->weightMomentum*layer->change[i];
+				layer->weights[i] += layer->change[i];
+			}
+			in = layer->output;
+		}
+	}
+
+	/* output slopes */
+	if (d->slopeLearningRate>0.0) {
+		layer = d->layers+d->numLayers-1;
+		for (j=0;j<layer->numTo;j++) {
+			te = layer->slopeGradient[j]/active;
+			layer->slope[j] += d->slopeLearningRate*te + d->slopeMomentum*layer->deltaSlope[j];
+			layer->deltaSlope[j] = te;
+		}
+	}
+	return sum;
+}
+
+/************************* nn_recognize_dense *****************************/
+/*
+ * recognize many patterns with the compiled net, compiling it first if
+ * the network changed.  Returns 0 if the network can't be compiled or
+ * the inputs need feedback, and the caller should use recognize().
+ */
+int		nn_recognize_dense(NeuralNetPtr x,double *inputs,double *outputs,long patterns)
+{
+	int		done=0;
+	NNetPtr	nnet;
+
+	nnet = x->nn_net;
+	if (denseFeedback(inputs,patterns*nnet->numIN))
+		return 0;
+
+#ifdef MAXObject
+	systhread_mutex_lock(x->nn_trainLock);
+#endif
+	if (x->nn_dense && x->nn_dense->version!=nnet->version) {
+		freeDenseNet(x->nn_dense);
+		x->nn_dense = nil;
+	}
+	if (!x->nn_dense && x->nn_noDense!=nnet->version) {
+		if (!(x->nn_dense = compileNet(nnet)))
+			x->nn_noDense = nnet->version;
+	}
+	if (x->nn_dense)
+		done = denseRecognize(x->nn_dense,inputs,outputs,patterns,nnet);
+#ifdef MAXObject
+	systhread_mutex_unlock(x->nn_trainLock);
+#endif
+	return done;
+}
@@ -41,9 +41,7 @@ double	linear(x,slope)
 double	x;
 double	slope;
 {
-	register	ret;
-	
-	ret = slope*x;
+	return slope*x;
 }
 
 /************************* linearActivation *****************************/
@@ -152,6 +152,7 @@ double	slope;
 #endif
   
 	(nnet->units+HID_UID(index))->slope = slope;
+	nnet->version++;
 }
 
 /************************* setSlopeFactorHidAll *****************************/
@@ -170,6 +171,7 @@ double	slope;
   
 	for (id = HID_UID(0); id < HID_UID(NUM_HID); id++)
 		(nnet->units+id)->slope = slope;
+	nnet->version++;
 }
 
 /************************* setSlopeFactorOut *****************************/
@@ -188,6 +190,7 @@ double	slope;
 #endif
   
 	(nnet->units+OUT_UID(index))->slope = slope;
+	nnet->version++;
 }
 
 /************************* setSlopeFactorOutAll *****************************/
@@ -208,6 +211,7 @@ double	slope;
 		(nnet->units+id)->slope = slope;
 		(nnet->units+id)->deltaSlope = 0.0;
 	}
+	nnet->version++;
 }
 
 /************************* setSlopeLearningRate *****************************/
@@ -249,6 +253,7 @@ void *setWeights(NNetPtr nnet, double *weights,Boolean all)
    unitPtr	neurons;
 
    neurons = nnet->units;
+   nnet->version++;
 
    for (i=IN_UID(0);i<IN_UID(NUM_IN);i++) {
       outLink = (neurons+i)->outLinks;
@@ -299,6 +304,7 @@ int		index;
 		(nnet->units+id)->activationFunction	= functionTable[index].activation;
 		(nnet->units+id)->deltaWeightFunction	= functionTable[index].deltaHidden;
 	}
+	nnet->version++;
 }
 
 /************************* setOutFunctAll *****************************/
@@ -321,4 +327,5 @@ int		index;
 		(nnet->units+id)->activationFunction	= functionTable[index].activation;
 		(nnet->units+id)->deltaWeightFunction	= functionTable[index].deltaOutput;
 	}
+	nnet->version++;
 }
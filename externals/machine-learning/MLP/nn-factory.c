@@ -102,6 +102,10 @@ fType	outFuncts;
 
 	x->nn_qelem = qelem_new(x, (method)nn_qfn);
 	x->nn_dqelem = qelem_new(x,(method)nn_dqfn);
+	x->nn_tqelem = qelem_new(x,(method)nn_tqfn);
+	systhread_mutex_new(&x->nn_trainLock,0);
+	x->nn_training = false;
+	x->nn_trained = x->nn_trainWork = nil;
 	x->nn_read = x->nn_write = x->nn_get_train = x->nn_get_test = 0;
 	x->nn_myOutlet = listout(x);
 
@@ -116,6 +120,8 @@ fType	outFuncts;
 #else
 	x = (NeuralNet *)getbytes((short)(sizeof(NeuralNet)));
 #endif
+	x->nn_dense = nil;
+	x->nn_noDense = -1;
 	if ((long)(x->nn_net = createNet(in,hid,hid_layers,out,inputLR,learning_rate,momentum,mu,
 								hidFuncts,outFuncts))<0L) {
 		post("MaxNet:newNeuralNet - Not enough create memory");	/* create net */
@@ -0,0 +1,248 @@
+/* Copyright (c) 1990-2006.  The Regents of the University of California (Regents).
+All Rights Reserved.
+
+Permission to use, copy, modify, and distribute this software and its
+documentation for educational, research, and not-for-profit purposes, without
+fee and without a signed licensing agreement, is hereby granted, provided that
+the above copyright notice, this paragraph and the following two paragraphs
+appear in all copies, modifications, and distributions.  Contact The Office of
+Technology Licensing, UC Berkeley, 2150 Shattuck Avenue, Suite 510, Berkeley,
+CA 94720-1620, (510) 643-7201, for commercial licensing opportunities.
+
+     IN NO EVENT SHALL REGENTS BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT,
+     SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS,
+     ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF
+     REGENTS HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+     REGENTS SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT
+     LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+     FOR A PARTICULAR PURPOSE. THE SOFTWARE AND ACCOMPANYING
+     DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS".
+     REGENTS HAS NO OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES,
+     ENHANCEMENTS, OR MODIFICATIONS.
+*/
+
+/*******************************************************************
+
+	nn-train.c
+	
+	mini-batch back propagation of the training set on a worker
+	thread, on a compiled copy of the network (see dense.c)
+	
+*******************************************************************/
+
+#define	SCOPE	extern
+#include "NNInclude.h"
+
+#ifdef MAXObject	/* threads and qelems only exist in the Max object */
+
+#define	DEFBATCH	16
+
+static	void	*nn_train_thread(NeuralNetPtr x);
+static	void	nn_train_publish(NeuralNetPtr x,DenseNetPtr work,long epoch,double pss);
+static	void	nn_train_finish(NeuralNetPtr x);
+
+/* ------------------------- nn_train ------------------------- */
+/*
+ * train <epochs> [batch size]: learn the training set in the background.
+ * Progress comes out as "train <epoch> <pss>" and recognize uses the new
+ * weights as soon as each epoch is done.  Any other message that changes
+ * the network stops the training first.
+ */
+void	*nn_train(NeuralNetPtr x,long epochs,long batch)
+{
+	NNetPtr	nnet;
+	patternSetPtr	set;
+
+	nn_train_stop(x);
+
+	nnet = x->nn_net;
+	set = &x->trainingSet;
+	if (!set->patterns) {
+		post("mlp: no training data");
+		return;
+	}
+	if (epochs<=0) {
+		post("mlp: train needs a number of epochs");
+		return;
+	}
+	if (denseFeedback(set->input,(long)set->patterns*nnet->numIN)) {
+		post("mlp: training data with feedback inputs needs auto_learn");
+		return;
+	}
+	if (batch<=0)
+		batch = DEFBATCH;
+	batch = MIN(batch,set->patterns);
+
+	systhread_mutex_lock(x->nn_trainLock);
+	if (x->nn_dense && x->nn_dense->version!=nnet->version) {
+		freeDenseNet(x->nn_dense);
+		x->nn_dense = nil;
+	}
+	if (!x->nn_dense)
+		x->nn_dense = compileNet(nnet);
+	systhread_mutex_unlock(x->nn_trainLock);
+	if (!x->nn_dense) {
+		post("mlp: train needs fully connected sigmoid, sigmoidTable, linear or radial layers, use auto_learn");
+		return;
+	}
+
+	x->nn_trained = cloneDenseNet(x->nn_dense);
+	x->nn_trainWork = cloneDenseNet(x->nn_dense);
+	if (!x->nn_trained || !x->nn_trainWork || !reserveDenseNet(x->nn_trainWork,batch)) {
+		post("mlp: train: out of memory");
+		freeDenseNet(x->nn_trained);
+		freeDenseNet(x->nn_trainWork);
+		x->nn_trained = x->nn_trainWork = nil;
+		return;
+	}
+	x->nn_trainWork->weightLearningRate = nnet->weightLearningRate;
+	x->nn_trainWork->weightMomentum = nnet->weightMomentum;
+	x->nn_trainWork->slopeLearningRate = nnet->slopeLearningRate;
+	x->nn_trainWork->slopeMomentum = nnet->slopeMomentum;
+
+	x->nn_trainEpochs = epochs;
+	x->nn_trainBatch = batch;
+	x->nn_trainEpoch = 0;
+	x->nn_trainPSS = 0.0;
+	x->nn_trainStop = x->nn_trainFresh = x->nn_trainDone = false;
+	x->nn_training = true;
+	systhread_create((method)nn_train_thread,x,0,0,0,&x->nn_trainThread);
+}
+
+/* ------------------------- nn_train_thread ------------------------- */
+
+static void	*nn_train_thread(NeuralNetPtr x)
+{
+	DenseNetPtr	work;
+	patternSetPtr	set;
+	long	epoch,i,n,in,out;
+	double	sum,pss;
+
+	work = x->nn_trainWork;
+	set = &x->trainingSet;
+	in = x->nn_net->numIN;
+	out = x->nn_net->numOUT;
+	pss = 0.0;
+
+	for (epoch=0;epoch<x->nn_trainEpochs && !x->nn_trainStop;epoch++) {
+		sum = 0.0;
+		for (i=0;i<set->patterns && !x->nn_trainStop;i+=n) {
+			n = MIN(x->nn_trainBatch,set->patterns-i);
+			sum += denseLearn(work,set->input+i*in,set->target+i*out,nil,n,x->nn_error_tolerance);
+		}
+		if (i<set->patterns) {
+			/* stopped halfway, keep what this epoch learnt so far */
+			nn_train_publish(x,work,x->nn_trainEpoch,x->nn_trainPSS);
+			break;
+		}
+
+		pss = sum/set->patterns;
+		nn_train_publish(x,work,epoch+1,pss);
+		if (pss<x->nn_error_tolerance)
+			break;
+	}
+
+	systhread_mutex_lock(x->nn_trainLock);
+	x->nn_trainDone = true;
+	systhread_mutex_unlock(x->nn_trainLock);
+	qelem_set(x->nn_tqelem);
+
+	systhread_exit(0);
+	return nil;
+}
+
+/* ------------------------- nn_train_publish ------------------------- */
+/*
+ * hand the worker's weights over, nn_tqfn swaps them in
+ */
+static void	nn_train_publish(NeuralNetPtr x,DenseNetPtr work,long epoch,double pss)
+{
+	systhread_mutex_lock(x->nn_trainLock);
+	copyDenseWeights(x->nn_trained,work);
+	x->nn_trainEpoch = epoch;
+	x->nn_trainPSS = pss;
+	x->nn_trainFresh = true;
+	systhread_mutex_unlock(x->nn_trainLock);
+	qelem_set(x->nn_tqelem);
+}
+
+/* ------------------------- nn_tqfn ------------------------- */
+
+void	*nn_tqfn(NeuralNetPtr x)
+{
+	DenseNetPtr	d;
+	Boolean	fresh,done;
+	long	epoch;
+	double	pss;
+	Atom	progress[2];
+
+	if (!x->nn_training)
+		return;
+
+	systhread_mutex_lock(x->nn_trainLock);
+	fresh = x->nn_trainFresh;
+	if (fresh) {
+		d = x->nn_dense;
+		x->nn_dense = x->nn_trained;
+		x->nn_trained = d;
+		x->nn_trainFresh = false;
+	}
+	done = x->nn_trainDone;
+	epoch = x->nn_trainEpoch;
+	pss = x->nn_trainPSS;
+	systhread_mutex_unlock(x->nn_trainLock);
+
+	if (fresh) {
+		SETLONG(progress,epoch);
+		SETFLOAT(progress+1,(float)pss);
+		nn_outlet_list(x->nn_myOutlet,"train",2,progress);
+	}
+	if (done)
+		nn_train_finish(x);
+}
+
+/* ------------------------- nn_train_stop ------------------------- */
+
+void	*nn_train_stop(NeuralNetPtr x)
+{
+	if (!x->nn_training)
+		return;
+	x->nn_trainStop = true;
+	nn_train_finish(x);
+}
+
+/* ------------------------- nn_train_finish ------------------------- */
+/*
+ * wait for the worker and put the trained weights back in the network
+ */
+static void	nn_train_finish(NeuralNetPtr x)
+{
+	DenseNetPtr	d;
+	unsigned int	status;
+
+	systhread_join(x->nn_trainThread,&status);
+	x->nn_training = false;
+
+	systhread_mutex_lock(x->nn_trainLock);
+	if (x->nn_trainFresh) {
+		d = x->nn_dense;
+		x->nn_dense = x->nn_trained;
+		x->nn_trained = d;
+		x->nn_trainFresh = false;
+	}
+	storeDenseNet(x->nn_dense,x->nn_net);
+	systhread_mutex_unlock(x->nn_trainLock);
+
+	freeDenseNet(x->nn_trained);
+	freeDenseNet(x->nn_trainWork);
+	x->nn_trained = x->nn_trainWork = nil;
+
+	x->epochs += x->nn_trainEpoch;
+	x->prevPSS = x->nn_trainPSS;
+	post("Epochs Executed: %ld",x->nn_trainEpoch);
+	post("Total Epochs Executed: %d",x->epochs);
+	post("PSS: %lf",x->nn_trainPSS);
+}
+
+#endif /* MAXObject */
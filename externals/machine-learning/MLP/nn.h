@@ -111,10 +111,46 @@ typedef struct network {
 
 	double  lambda;						/* weight decay */
 
+	long	version;					/* bumped whenever weights, slopes or functions change */
+
 	unitPtr	units;
 	linkPtr	links;
 } Network,*NNetPtr;						/* network data structure */
 
+/* a fully connected network compiled to one weight matrix per layer, see dense.c */
+
+typedef struct DenseLayer {
+	short	numFrom;			/* units in the layer below, not counting the bias */
+	short	numTo;				/* units in this layer */
+	int		functionIndex;		/* activation shared by the whole layer */
+
+	double	*weights;			/* numTo rows of numFrom+1 weights, the bias weight last */
+	double	*change;			/* previous weight change, for momentum */
+	double	*gradient;			/* summed over a batch */
+	double	*slope;				/* per unit slope factor */
+	double	*deltaSlope;		/* previous slope change, for momentum */
+	double	*slopeGradient;
+
+	double	*netIn;				/* capacity rows of numTo, one per pattern */
+	double	*output;
+	double	*delta;
+} DenseLayer;
+
+typedef struct DenseNet {
+	short	numIN;
+	short	numOUT;
+	short	numLayers;			/* hidden layers plus the output layer */
+	long	capacity;			/* patterns that fit in the per pattern rows */
+	long	version;			/* version of the network this was compiled from */
+
+	double	weightLearningRate;	/* learning parameters, copied when training starts */
+	double	weightMomentum;
+	double	slopeLearningRate;
+	double	slopeMomentum;
+
+	DenseLayer	*layers;
+} DenseNet,*DenseNetPtr;
+
 #define UNITSIZE	(short)sizeof(struct Unit)*(TOTAL+1)
 #define LINKSIZE	(short)(sizeof(struct Link)*(nnet->numHIDLayers?\
 						((nnet->numIN+nnet->numHID*(nnet->numHIDLayers-1)+\
@@ -172,6 +208,25 @@ struct	neuralNet
 #endif
 	Boolean	nn_debug;
 	NNetPtr	nn_net;
+	DenseNetPtr	nn_dense;		/* compiled copy of nn_net, nil until needed */
+	long	nn_noDense;			/* version of nn_net that would not compile */
+
+#ifdef MAXObject
+	/* background training, see nn-train.c */
+	t_systhread	nn_trainThread;
+	t_systhread_mutex	nn_trainLock;	/* guards nn_dense and nn_trained */
+	void	*nn_tqelem;			/* reports progress and takes the weights */
+	DenseNetPtr	nn_trained;		/* latest weights from the worker */
+	DenseNetPtr	nn_trainWork;	/* the worker's own copy */
+	Boolean	nn_training;
+	Boolean	nn_trainStop;
+	Boolean	nn_trainFresh;
+	Boolean	nn_trainDone;
+	long	nn_trainEpochs;
+	long	nn_trainBatch;
+	long	nn_trainEpoch;
+	double	nn_trainPSS;
+#endif
 	
 	double	*nn_exemplers;
 	double	*nn_outputs;
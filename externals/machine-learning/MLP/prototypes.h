@@ -49,6 +49,9 @@ double	bpNoPropLearn(NNetPtr a,double * b);
 void	*buildFunctionTable(void );
 
 double	calculateError(NNetPtr a,double * b);
+DenseNetPtr	cloneDenseNet(DenseNetPtr a);
+DenseNetPtr	compileNet(NNetPtr a);
+void	*copyDenseWeights(DenseNetPtr a,DenseNetPtr b);
 NNetPtr	createNet(int a,int v,int c,int d,double e,double f,double g,double h,fType  i,fType j);
 
 int		createIOLinks(NNetPtr a);
@@ -58,6 +61,9 @@ void	*createUnit(unitPtr a,int v,char * b, int c,
 					void (*d)(unitPtr,double,double),
 					void (*e)(unitPtr),double f,void (*g)(unitPtr),double h);
 
+Boolean	denseFeedback(double *a,long b);
+double	denseLearn(DenseNetPtr a,double *b,double *c,double *d,long e,double f);
+int		denseRecognize(DenseNetPtr a,double *b,double *c,long d,NNetPtr e);
 void	*disposeGraphics(NeuralNetPtr a);
 void	*drawNeuron(NeuralNetPtr a,int b);
 void	*drawNeurons(NeuralNetPtr a);
@@ -65,6 +71,7 @@ void	*DrawPict(NeuralNetPtr a,int b);
 void	*drawWeight(NNetPtr r,int e);
 void	*drawWeights(NeuralNetPtr a);
 void	*eraseGraphics(NeuralNetPtr a);
+void	*freeDenseNet(DenseNetPtr a);
 void	*freeNetwork(NNetPtr a);
 #ifdef MAC
 void	*GetDlgTextItem(DialogPtr a,int b,char * c);
@@ -110,7 +117,12 @@ void	*nn_learn(NeuralNetPtr,Symbol *,int,Atom *);
 void	*nn_Menu(struct patcher *,long,long,int);
 void	*nn_outlet_list(struct outlet *,char *,int,Atom *);
 void	*nn_recognize(NeuralNetPtr,Symbol *,int,Atom *);
+void	*nn_recognize_batch(NeuralNetPtr,Symbol *,int,Atom *);
+void	*nn_train(NeuralNetPtr a,long b,long c);
+void	*nn_train_stop(NeuralNetPtr a);
+void	*nn_tqfn(NeuralNetPtr a);
 #endif
+int		nn_recognize_dense(NeuralNetPtr a,double *b,double *c,long d);
 
 void	nn_bang(NeuralNetPtr a);
 #ifdef MAC
@@ -178,6 +190,7 @@ short		rand(void a);
 #endif
 double	random(void a);
 void	*recognize(NNetPtr a,double * b,double * c,double * d);
+int		reserveDenseNet(DenseNetPtr a,long b);
 
 void	*scroll_it(NeuralNetPtr a,int b,int c);
 #ifdef MAC
@@ -194,6 +207,7 @@ void	*setSlopeFactorOutAll(NNetPtr a,double b);
 void	*setSlopeLearningRate(NNetPtr a,double b);
 void	*setSlopeMomentum(NNetPtr a,double b);
 void	*setupGraphics(NeuralNetPtr a);
+void	*storeDenseNet(DenseNetPtr a,NNetPtr b);
 
 void	*setWeights(NNetPtr a,double * v,Boolean b);
 
@@ -137,19 +137,30 @@ NeuralNetPtr	x;
 patternSetPtr	set;
 int				index;
 {
-	int i;
-	double	sum;
+	int i,j;
+	double	sum,diff;
 	double	maxError;
+	Boolean	dense;
 
 	sum = 0.0;
 	if (set->patterns) {
 		maxError = 0.0;
+		/* the compiled net runs the whole set at once */
+		dense = nn_recognize_dense(x,set->input,set->outz,set->patterns);
 		for (i=0;i<set->patterns;i++) {
-			bpLearn(x->nn_net,(set->input+i*x->nn_net->numIN),
-					(set->target+i*x->nn_net->numOUT),
-					(set->target+(i-1)*x->nn_net->numOUT),
-					(set->outz+i*x->nn_net->numOUT),
-					(set->errz+i),x->nn_error_tolerance,false);
+			if (dense) {
+				*(set->errz+i) = 0.0;
+				for (j=0;j<x->nn_net->numOUT;j++) {
+					diff = *(set->target+i*x->nn_net->numOUT+j) - *(set->outz+i*x->nn_net->numOUT+j);
+					*(set->errz+i) += 0.5*diff*diff;
+				}
+			}
+			else
+				bpLearn(x->nn_net,(set->input+i*x->nn_net->numIN),
+						(set->target+i*x->nn_net->numOUT),
+						(set->target+(i-1)*x->nn_net->numOUT),
+						(set->outz+i*x->nn_net->numOUT),
+						(set->errz+i),x->nn_error_tolerance,false);
 
 			sum += *(set->errz+i);
 			maxError = MAX(maxError,*(set->errz+i));
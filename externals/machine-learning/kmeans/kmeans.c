@@ -32,6 +32,14 @@ maybe make taxpoint struct = (x, y) and centroid struct = taxpoint + amp + age.
 
 #define HACKVAL 0		// hack val (heuristic) for kmeans
 
+#define MAXCLUSTERS 256	// maximum clusters for feature vectors
+#define DEFCLUSTERS 8	// default nclusters for feature vectors
+#define DEFBATCH 16		// default mini-batch size for streamed vectors
+#define MAXBATCH 4096
+#define DEFITERATIONS 100 // default maximum iterations of the cluster message
+#define MINPOINTS 256	// initial size of the point store
+#define FARAWAY 1.0e30f
+
 typedef struct _taxpoint {
 	float x;
 	float y;
@@ -62,8 +70,35 @@ typedef struct _kmeans
 	
 	Atom x_clist[MAXCENTROIDS*5]; // output atom for taxel array (x, y, amplitude, age, k)
 	
+	// feature vectors of any dimension, see kmeans_add, kmeans_cluster and kmeans_stream
+	long x_dim;				// floats per vector, 0 until the first one comes in
+	long x_npoints;			// vectors in the store
+	long x_maxpoints;		// vectors allocated
+	float *x_points;		// the store, x_npoints vectors of x_dim floats back to back
+	long *x_assign;			// cluster of each stored vector
+	float *x_upper;			// upper bound on the distance to its own cluster
+	float *x_lower;			// lower bound on the distance to any other cluster
+	
+	long x_k;				// number of clusters
+	long x_kused;			// clusters that have a centroid yet
+	float *x_means;			// centroids, MAXCLUSTERS * x_dim
+	double *x_sums;			// sum of the vectors in each cluster, MAXCLUSTERS * x_dim
+	float *x_cdist;			// centroid to centroid distances, MAXCLUSTERS * MAXCLUSTERS
+	long x_counts[MAXCLUSTERS];	// vectors in each cluster
+	float x_moved[MAXCLUSTERS];	// how far each centroid moved in the last update
+	float x_half[MAXCLUSTERS];	// half the distance to the nearest other centroid
+	
+	long x_batch;			// mini-batch size for streamed vectors
+	long x_nbatch;			// streamed vectors waiting for the update
+	float *x_batchpoints;	// x_batch vectors
+	long x_batchassign[MAXBATCH];
+	long x_last;			// cluster of the last streamed vector, where the next search starts
+	
+	Atom *x_vlist;			// output atoms, x_dim + 2
+	
 	void *x_outlet0; // tracked centroids
 	void *x_outlet1; // ncentroids found
+	void *x_outlet2; // feature vector clusters
 
 } t_kmeans;
 
@@ -87,6 +122,24 @@ void kmeans_thresh(t_kmeans *x);
 void kmeans_test(t_kmeans *x, Taxpoint *coords, int coordssize, int n, int hack); //temporary
 void kmeans_run (t_kmeans *x, Taxpoint *coords, int coordssize, int n, int hack);
 
+void kmeans_dim(t_kmeans *x, long n);
+void kmeans_clusters(t_kmeans *x, long n);
+void kmeans_batch(t_kmeans *x, long n);
+void kmeans_add(t_kmeans *x, Symbol *s, int ac, Atom *av);
+void kmeans_stream(t_kmeans *x, Symbol *s, int ac, Atom *av);
+void kmeans_cluster(t_kmeans *x, long maxiter);
+void kmeans_clear(t_kmeans *x);
+void kmeans_reset(t_kmeans *x);
+void kmeans_dump(t_kmeans *x);
+
+Boolean kmeans_vsetdim(t_kmeans *x, long dim);
+void kmeans_vfree(t_kmeans *x);
+float kmeans_vdistance(float *p1, float *p2, long dim);
+long kmeans_vnearest(t_kmeans *x, float *p, long start, float *dist);
+void kmeans_vseed(t_kmeans *x, long k);
+void kmeans_vcentroiddistances(t_kmeans *x);
+void kmeans_voutput(t_kmeans *x, long j);
+
 void main(void)
 {			
 	setup(&kmeans_class, kmeans_new, (method)kmeans_free, (short)sizeof(t_kmeans), 0L, A_GIMME, 0);
@@ -99,6 +152,16 @@ void main(void)
 	addmess((method)kmeans_heuristic, "heuristic", A_LONG, 0);
 	addmess((method)kmeans_dimensions, "dimensions", A_GIMME, 0);
 	
+	addmess((method)kmeans_dim, "dim", A_LONG, 0);
+	addmess((method)kmeans_clusters, "clusters", A_LONG, 0);
+	addmess((method)kmeans_batch, "batch", A_LONG, 0);
+	addmess((method)kmeans_add, "add", A_GIMME, 0);
+	addmess((method)kmeans_stream, "stream", A_GIMME, 0);
+	addmess((method)kmeans_cluster, "cluster", A_DEFLONG, 0);
+	addmess((method)kmeans_clear, "clear", 0);
+	addmess((method)kmeans_reset, "reset", 0);
+	addmess((method)kmeans_dump, "dump", 0);
+	
 	rescopy('STR#',RES_ID);
 	post(VERSION,0);
 }
@@ -107,6 +170,7 @@ void kmeans_list(t_kmeans *x, Symbol *s, int ac, Atom *av)
 {
 	int i;
 	
+	ac = MIN(ac, MAXTAXELS);
 	for (i=0; i< ac; i++) {
 		if (av[i].a_type == A_LONG)
 			x->x_taxels[i] = (int)av[i].a_w.w_long;	
@@ -168,8 +232,7 @@ void kmeans_assist(t_kmeans *x, void *b, long m, long a, char *s)
 
 void kmeans_free (t_kmeans *x)
 {
-	// free anything needing freeing... 
-	// ...like if we ever dynamically allocate space for the taxel lists or something
+	kmeans_vfree(x);
 }
 
 void *kmeans_new(Symbol *s, int ac, Atom *av)
@@ -180,6 +243,7 @@ void *kmeans_new(Symbol *s, int ac, Atom *av)
 	x = (t_kmeans *)newobject(kmeans_class);
 	
 	intin(x,1); 				// ncentroids to look for
+	x->x_outlet2 = outlet_new(x, 0L); // feature vector clusters
 	x->x_outlet1 = intout(x); 	// ncentroids actually found
 	x->x_outlet0 = listout(x); 	// centroid list
 
@@ -220,6 +284,21 @@ void *kmeans_new(Symbol *s, int ac, Atom *av)
 		x->x_centroids[i].k = -1;
 	}
 	
+	x->x_dim = 0;
+	x->x_npoints = x->x_maxpoints = 0;
+	x->x_points = x->x_upper = x->x_lower = 0;
+	x->x_assign = 0;
+	x->x_k = DEFCLUSTERS;
+	x->x_kused = 0;
+	x->x_means = 0;
+	x->x_sums = 0;
+	x->x_cdist = 0;
+	x->x_batch = DEFBATCH;
+	x->x_nbatch = 0;
+	x->x_batchpoints = 0;
+	x->x_last = 0;
+	x->x_vlist = 0;
+	
 	return(x);
 }
 
@@ -285,7 +364,7 @@ void kmeans_thresh(t_kmeans *x)
 			else dx2 = x->x_taxels[i+1] - thistaxel;
 			
 			if (i<ncols) dy1 = 100;
-			else dy1 = thistaxel - x->x_taxels[i-14];
+			else dy1 = thistaxel - x->x_taxels[i-ncols];
 			
 			// this is a hack need to get the real number of complete rows instead of nrows-2
 			if (i>ncols*(nrows-2)) dy2 = -100; 
@@ -467,4 +546,502 @@ void kmeans_run(t_kmeans *x, Taxpoint *coords, int coordssize, int n, int hack)
 	
 	// restore updated values to obj instance
 	x->x_xused = xused;
-}
\ No newline at end of file
+}
+
+/* ========================================================================= */ 
+/* feature vectors
+
+	add      stores vectors in a packed store (any number of x_dim floats per message)
+	cluster  runs k-means over the store. Hamerly's bounds skip the distance
+	         computations for vectors that can't have changed cluster, so after
+	         the first couple of iterations most vectors cost one distance or none.
+	stream   assigns each vector to its nearest centroid right away and moves the
+	         centroids every x_batch vectors (mini-batch k-means), without storing them.
+	
+	distances are euclidean, the bounds need the triangle inequality.
+*/
+
+void kmeans_dim(t_kmeans *x, long n)
+{
+	if (n < 1) {
+		error("kmeans: dim must be at least 1");
+		return;
+	}
+	kmeans_vsetdim(x, n);
+}
+
+void kmeans_clusters(t_kmeans *x, long n)
+{
+	x->x_k = MAX(1, MIN(MAXCLUSTERS, n));
+	kmeans_reset(x);
+}
+
+void kmeans_batch(t_kmeans *x, long n)
+{
+	n = MAX(1, MIN(MAXBATCH, n));
+	if (x->x_dim && n != x->x_batch) {
+		float *pts = (float *)sysmem_newptr(n * x->x_dim * sizeof(float));
+		if (!pts) {
+			error("kmeans: out of memory");
+			return;
+		}
+		if (x->x_batchpoints)
+			sysmem_freeptr(x->x_batchpoints);
+		x->x_batchpoints = pts;
+	}
+	x->x_batch = n;
+	x->x_nbatch = 0;
+}
+
+void kmeans_add(t_kmeans *x, Symbol *s, int ac, Atom *av)
+{
+	long i, j, n, newmax;
+	float *p, *points, *upper, *lower;
+	long *assign;
+	
+	if (!x->x_dim && !kmeans_vsetdim(x, ac))
+		return;
+	if (ac % x->x_dim) {
+		error("kmeans: add needs a multiple of %ld values", x->x_dim);
+		return;
+	}
+	n = ac / x->x_dim;
+	
+	// grow the store
+	if (x->x_npoints + n > x->x_maxpoints) {
+		newmax = MAX(MINPOINTS, x->x_maxpoints);
+		while (newmax < x->x_npoints + n)
+			newmax *= 2;
+		if (!x->x_points) {
+			points = (float *)sysmem_newptr(newmax * x->x_dim * sizeof(float));
+			assign = (long *)sysmem_newptr(newmax * sizeof(long));
+			upper = (float *)sysmem_newptr(newmax * sizeof(float));
+			lower = (float *)sysmem_newptr(newmax * sizeof(float));
+			if (!points || !assign || !upper || !lower) {
+				if (points) sysmem_freeptr(points);
+				if (assign) sysmem_freeptr(assign);
+				if (upper) sysmem_freeptr(upper);
+				if (lower) sysmem_freeptr(lower);
+				error("kmeans: out of memory for %ld vectors", newmax);
+				return;
+			}
+		} else {
+			// a block that did grow replaces the old one even if another fails;
+			// a failed one is left as it was, so the store stays usable at its old size
+			points = (float *)sysmem_resizeptr(x->x_points, newmax * x->x_dim * sizeof(float));
+			if (points) x->x_points = points;
+			assign = (long *)sysmem_resizeptr(x->x_assign, newmax * sizeof(long));
+			if (assign) x->x_assign = assign;
+			upper = (float *)sysmem_resizeptr(x->x_upper, newmax * sizeof(float));
+			if (upper) x->x_upper = upper;
+			lower = (float *)sysmem_resizeptr(x->x_lower, newmax * sizeof(float));
+			if (lower) x->x_lower = lower;
+			if (!points || !assign || !upper || !lower) {
+				error("kmeans: out of memory for %ld vectors", newmax);
+				return;
+			}
+		}
+		x->x_points = points;
+		x->x_assign = assign;
+		x->x_upper = upper;
+		x->x_lower = lower;
+		x->x_maxpoints = newmax;
+	}
+	
+	p = x->x_points + x->x_npoints * x->x_dim;
+	for (i = 0; i < n * x->x_dim; i++) {
+		if (av[i].a_type == A_FLOAT)
+			p[i] = av[i].a_w.w_float;
+		else if (av[i].a_type == A_LONG)
+			p[i] = (float)av[i].a_w.w_long;
+		else
+			p[i] = 0.0f;
+	}
+	for (j = 0; j < n; j++)
+		x->x_assign[x->x_npoints + j] = -1;
+	x->x_npoints += n;
+}
+
+void kmeans_stream(t_kmeans *x, Symbol *s, int ac, Atom *av)
+{
+	long i, j, c, n, dim, b;
+	float *p, *m;
+	float d, eta;
+	
+	if (!x->x_dim && !kmeans_vsetdim(x, ac))
+		return;
+	dim = x->x_dim;
+	if (ac % dim) {
+		error("kmeans: stream needs a multiple of %ld values", dim);
+		return;
+	}
+	n = ac / dim;
+	
+	for (j = 0; j < n; j++, av += dim) {
+		p = x->x_batchpoints + x->x_nbatch * dim;
+		for (i = 0; i < dim; i++) {
+			if (av[i].a_type == A_FLOAT)
+				p[i] = av[i].a_w.w_float;
+			else if (av[i].a_type == A_LONG)
+				p[i] = (float)av[i].a_w.w_long;
+			else
+				p[i] = 0.0f;
+		}
+		
+		if (x->x_kused < x->x_k) {
+			// the first k vectors start the clusters
+			c = x->x_kused++;
+			m = x->x_means + c * dim;
+			for (i = 0; i < dim; i++)
+				m[i] = p[i];
+			x->x_counts[c] = 1;
+			kmeans_vcentroiddistances(x);
+			d = 0.0f;
+		} else {
+			c = kmeans_vnearest(x, p, x->x_last, &d);
+			x->x_batchassign[x->x_nbatch++] = c;
+		}
+		x->x_last = c;
+		
+		SETLONG(&x->x_vlist[0], c);
+		SETFLOAT(&x->x_vlist[1], d);
+		outlet_anything(x->x_outlet2, gensym("nearest"), 2, x->x_vlist);
+		
+		if (x->x_nbatch == x->x_batch) {
+			// move each centroid towards its vectors, by less as it collects more of them
+			for (b = 0; b < x->x_nbatch; b++) {
+				c = x->x_batchassign[b];
+				p = x->x_batchpoints + b * dim;
+				m = x->x_means + c * dim;
+				x->x_counts[c]++;
+				eta = 1.0f / (float)x->x_counts[c];
+				for (i = 0; i < dim; i++)
+					m[i] += eta * (p[i] - m[i]);
+			}
+			x->x_nbatch = 0;
+			kmeans_vcentroiddistances(x);
+		}
+	}
+}
+
+void kmeans_cluster(t_kmeans *x, long maxiter)
+{
+	long i, j, c, best, iter, changed, far;
+	long n = x->x_npoints;
+	long dim = x->x_dim;
+	long k;
+	float *p, *m, *q;
+	double *sum;
+	float d, d1, d2, bound, max1, max2;
+	
+	if (!n) {
+		error("kmeans: no vectors to cluster, use add");
+		return;
+	}
+	if (maxiter <= 0)
+		maxiter = DEFITERATIONS;
+	
+	k = MIN(x->x_k, n);
+	if (x->x_kused < k)
+		kmeans_vseed(x, k);
+	k = x->x_kused;
+	kmeans_vcentroiddistances(x);
+	
+	// first assignment, with exact bounds
+	for (j = 0; j < k * dim; j++)
+		x->x_sums[j] = 0.;
+	for (j = 0; j < k; j++)
+		x->x_counts[j] = 0;
+	for (i = 0, p = x->x_points; i < n; i++, p += dim) {
+		d1 = d2 = FARAWAY;
+		best = 0;
+		for (j = 0; j < k; j++) {
+			d = kmeans_vdistance(p, x->x_means + j * dim, dim);
+			if (d < d1) {
+				d2 = d1;
+				d1 = d;
+				best = j;
+			} else if (d < d2) {
+				d2 = d;
+			}
+		}
+		x->x_assign[i] = best;
+		x->x_upper[i] = d1;
+		x->x_lower[i] = d2;
+		x->x_counts[best]++;
+		sum = x->x_sums + best * dim;
+		for (j = 0; j < dim; j++)
+			sum[j] += p[j];
+	}
+	
+	for (iter = 0; iter < maxiter; iter++) {
+		// move the centroids to the mean of their vectors
+		max1 = max2 = 0.0f;
+		far = -1;
+		for (j = 0; j < k; j++) {
+			m = x->x_means + j * dim;
+			x->x_moved[j] = 0.0f;
+			if (x->x_counts[j]) {
+				float moved = 0.0f;
+				sum = x->x_sums + j * dim;
+				for (c = 0; c < dim; c++) {
+					float v = (float)(sum[c] / x->x_counts[j]);
+					moved += (v - m[c]) * (v - m[c]);
+					m[c] = v;
+				}
+				x->x_moved[j] = sqrt(moved);
+			}
+			if (x->x_moved[j] > max1) {
+				max2 = max1;
+				max1 = x->x_moved[j];
+				far = j;
+			} else if (x->x_moved[j] > max2) {
+				max2 = x->x_moved[j];
+			}
+		}
+		kmeans_vcentroiddistances(x);
+		
+		// reassign, skipping vectors whose bounds say they stay put
+		changed = 0;
+		for (i = 0, p = x->x_points; i < n; i++, p += dim) {
+			c = x->x_assign[i];
+			x->x_upper[i] += x->x_moved[c];
+			x->x_lower[i] -= (c == far) ? max2 : max1;
+			
+			bound = MAX(x->x_half[c], x->x_lower[i]);
+			if (x->x_upper[i] <= bound)
+				continue;
+			x->x_upper[i] = kmeans_vdistance(p, x->x_means + c * dim, dim);
+			if (x->x_upper[i] <= bound)
+				continue;
+			
+			d1 = x->x_upper[i];
+			d2 = FARAWAY;
+			best = c;
+			for (j = 0; j < k; j++) {
+				if (j == c)
+					continue;
+				d = kmeans_vdistance(p, x->x_means + j * dim, dim);
+				if (d < d1) {
+					d2 = d1;
+					d1 = d;
+					best = j;
+				} else if (d < d2) {
+					d2 = d;
+				}
+			}
+			x->x_upper[i] = d1;
+			x->x_lower[i] = d2;
+			if (best != c) {
+				x->x_assign[i] = best;
+				x->x_counts[c]--;
+				x->x_counts[best]++;
+				sum = x->x_sums + c * dim;
+				for (j = 0; j < dim; j++)
+					sum[j] -= p[j];
+				sum = x->x_sums + best * dim;
+				for (j = 0; j < dim; j++)
+					sum[j] += p[j];
+				changed++;
+			}
+		}
+		if (!changed)
+			break;
+	}
+	
+	// centroids of the final assignment
+	for (j = 0; j < k; j++) {
+		if (x->x_counts[j]) {
+			m = x->x_means + j * dim;
+			sum = x->x_sums + j * dim;
+			for (c = 0; c < dim; c++)
+				m[c] = (float)(sum[c] / x->x_counts[j]);
+		}
+	}
+	kmeans_vcentroiddistances(x);
+	x->x_nbatch = 0;
+	
+	SETLONG(&x->x_vlist[0], MIN(iter + 1, maxiter));
+	outlet_anything(x->x_outlet2, gensym("iterations"), 1, x->x_vlist);
+	kmeans_dump(x);
+}
+
+void kmeans_clear(t_kmeans *x)
+{
+	x->x_npoints = 0;
+}
+
+void kmeans_reset(t_kmeans *x)
+{
+	x->x_kused = 0;
+	x->x_nbatch = 0;
+	x->x_last = 0;
+}
+
+void kmeans_dump(t_kmeans *x)
+{
+	long j;
+	
+	for (j = 0; j < x->x_kused; j++)
+		kmeans_voutput(x, j);
+}
+
+// (re)allocate everything that depends on the vector size. forgets stored vectors and clusters.
+Boolean kmeans_vsetdim(t_kmeans *x, long dim)
+{
+	if (dim < 1) {
+		error("kmeans: empty vector");
+		return false;
+	}
+	kmeans_vfree(x);
+	x->x_dim = dim;
+	x->x_means = (float *)sysmem_newptr(MAXCLUSTERS * dim * sizeof(float));
+	x->x_sums = (double *)sysmem_newptr(MAXCLUSTERS * dim * sizeof(double));
+	x->x_batchpoints = (float *)sysmem_newptr(x->x_batch * dim * sizeof(float));
+	x->x_vlist = (Atom *)sysmem_newptr((dim + 2) * sizeof(Atom));
+	if (!x->x_cdist)
+		x->x_cdist = (float *)sysmem_newptr(MAXCLUSTERS * MAXCLUSTERS * sizeof(float));
+	if (!x->x_means || !x->x_sums || !x->x_batchpoints || !x->x_vlist || !x->x_cdist) {
+		error("kmeans: out of memory for %ld dimensional vectors", dim);
+		kmeans_vfree(x);
+		return false;
+	}
+	return true;
+}
+
+void kmeans_vfree(t_kmeans *x)
+{
+	if (x->x_points) sysmem_freeptr(x->x_points);
+	if (x->x_assign) sysmem_freeptr(x->x_assign);
+	if (x->x_upper) sysmem_freeptr(x->x_upper);
+	if (x->x_lower) sysmem_freeptr(x->x_lower);
+	if (x->x_means) sysmem_freeptr(x->x_means);
+	if (x->x_sums) sysmem_freeptr(x->x_sums);
+	if (x->x_batchpoints) sysmem_freeptr(x->x_batchpoints);
+	if (x->x_vlist) sysmem_freeptr(x->x_vlist);
+	if (x->x_cdist) sysmem_freeptr(x->x_cdist);
+	x->x_points = x->x_upper = x->x_lower = 0;
+	x->x_assign = 0;
+	x->x_means = x->x_batchpoints = x->x_cdist = 0;
+	x->x_sums = 0;
+	x->x_vlist = 0;
+	x->x_dim = 0;
+	x->x_npoints = x->x_maxpoints = 0;
+	kmeans_reset(x);
+}
+
+float kmeans_vdistance(float *p1, float *p2, long dim)
+{
+	long i;
+	float d, sum = 0.0f;
+	
+	for (i = 0; i < dim; i++) {
+		d = p1[i] - p2[i];
+		sum += d * d;
+	}
+	return sqrt(sum);
+}
+
+// nearest centroid to p, starting the search at centroid start. a centroid j 
+// is skipped when it is at least twice as far from the best so far as p is, 
+// since then it can't be any closer to p.
+long kmeans_vnearest(t_kmeans *x, float *p, long start, float *dist)
+{
+	long j;
+	long best = MIN(start, x->x_kused - 1);
+	long dim = x->x_dim;
+	float d, dmin;
+	float *row;
+	
+	dmin = kmeans_vdistance(p, x->x_means + best * dim, dim);
+	for (j = 0; j < x->x_kused; j++) {
+		row = x->x_cdist + best * MAXCLUSTERS;
+		if (j == best || row[j] >= 2.0f * dmin)
+			continue;
+		d = kmeans_vdistance(p, x->x_means + j * dim, dim);
+		if (d < dmin) {
+			dmin = d;
+			best = j;
+		}
+	}
+	*dist = dmin;
+	return best;
+}
+
+// k-means++ seeding from the store: each new centroid is a stored vector, 
+// picked with probability proportional to its squared distance to the 
+// centroids so far. x_upper holds those distances meanwhile.
+void kmeans_vseed(t_kmeans *x, long k)
+{
+	long i, j;
+	long n = x->x_npoints;
+	long dim = x->x_dim;
+	float *p, *m;
+	double total, r;
+	float d;
+	
+	i = rand() % n;
+	for (j = 0; j < dim; j++)
+		x->x_means[j] = x->x_points[i * dim + j];
+	for (i = 0; i < n; i++)
+		x->x_upper[i] = FARAWAY;
+	
+	for (x->x_kused = 1; x->x_kused < k; x->x_kused++) {
+		m = x->x_means + (x->x_kused - 1) * dim;
+		total = 0.;
+		for (i = 0, p = x->x_points; i < n; i++, p += dim) {
+			d = kmeans_vdistance(p, m, dim);
+			d *= d;
+			if (d < x->x_upper[i])
+				x->x_upper[i] = d;
+			total += x->x_upper[i];
+		}
+		r = total * ((double)rand() / (double)RAND_MAX);
+		for (i = 0; i < n - 1; i++) {
+			r -= x->x_upper[i];
+			if (r <= 0.)
+				break;
+		}
+		m += dim;
+		for (j = 0; j < dim; j++)
+			m[j] = x->x_points[i * dim + j];
+	}
+	for (j = 0; j < k; j++)
+		x->x_counts[j] = 1;
+	x->x_nbatch = 0;
+	x->x_last = 0;
+}
+
+void kmeans_vcentroiddistances(t_kmeans *x)
+{
+	long i, j;
+	long k = x->x_kused;
+	long dim = x->x_dim;
+	float d;
+	
+	for (i = 0; i < k; i++) {
+		x->x_half[i] = FARAWAY;
+		x->x_cdist[i * MAXCLUSTERS + i] = 0.0f;
+	}
+	for (i = 0; i < k; i++) {
+		for (j = i + 1; j < k; j++) {
+			d = kmeans_vdistance(x->x_means + i * dim, x->x_means + j * dim, dim);
+			x->x_cdist[i * MAXCLUSTERS + j] = x->x_cdist[j * MAXCLUSTERS + i] = d;
+			if (0.5f * d < x->x_half[i]) x->x_half[i] = 0.5f * d;
+			if (0.5f * d < x->x_half[j]) x->x_half[j] = 0.5f * d;
+		}
+	}
+}
+
+// centroid j as: centroid index count x1 .. xdim
+void kmeans_voutput(t_kmeans *x, long j)
+{
+	long i;
+	float *m = x->x_means + j * x->x_dim;
+	
+	SETLONG(&x->x_vlist[0], j);
+	SETLONG(&x->x_vlist[1], x->x_counts[j]);
+	for (i = 0; i < x->x_dim; i++)
+		SETFLOAT(&x->x_vlist[i + 2], m[i]);
+	outlet_anything(x->x_outlet2, gensym("centroid"), (short)(x->x_dim + 2), x->x_vlist);
+}
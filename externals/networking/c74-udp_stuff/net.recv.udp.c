@@ -14,6 +14,10 @@
 #include <errno.h>
 #include "ext_bytebuf.c"
 
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
+
 
 #define true 1
 #define false 0
@@ -22,23 +26,57 @@
 #define MAX_DGRAM_SIZE 65536 
 #define DEFAULT_MAX_QUEUE_SIZE 2048
 
-#define LOCK_QUEUE systhread_mutex_lock(x->queue_mutex);
-#define UNLOCK_QUEUE systhread_mutex_unlock(x->queue_mutex);
-
+// Datagrams are received straight into a ring of preallocated slots.  A slot
+// holds DGRAM_SLOT_SIZE bytes to start with and grows if a bigger datagram
+// comes along, so after warming up the listener never allocates.
+#define DGRAM_SLOT_SIZE 2048
+#define RING_CAPACITY DEFAULT_MAX_QUEUE_SIZE	// must be a power of two
+#define RING_MASK (RING_CAPACITY - 1)
+
+// Most datagrams the listener asks the kernel for in one call (Linux only)
+#define UDP_BATCH_SIZE 32
+#define DGRAM_OVERFLOW_SIZE (MAX_DGRAM_SIZE - DGRAM_SLOT_SIZE)
+
+// The ring is a single producer (listener thread) / single consumer (clock)
+// queue: only the listener writes ring_head and only the clock writes
+// ring_tail, so publishing a datagram is one release store and no lock.
+#if defined(__GNUC__)
+#define RING_LOAD(p)			__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define RING_STORE(p, v)		__atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define RING_EXCHANGE(p, v)		__atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
+#else // MSVC: volatile accesses have acquire/release semantics
+#define RING_LOAD(p)			(*(volatile unsigned long *)(p))
+#define RING_STORE(p, v)		(*(volatile unsigned long *)(p) = (v))
+#define RING_EXCHANGE(p, v)		((unsigned long)InterlockedExchange((volatile long *)(p), (long)(v)))
+#endif
 
+typedef struct udpdgram
+{
+	char *buf;
+	long size;	//bytes allocated for buf
+	long n;		//bytes of the datagram in buf
+} t_udpdgram;
 
 typedef struct udpreceiver
 {
     t_syssocket s;
     char* readbuf;//buffer we use to read into from the socket
+    char* overflow;//where batched datagrams that don't fit their slot spill over (Linux only)
     t_systhread listener;
     int     listening;
     t_sysaddr server,from;
 	int port;
-	t_linklist *queue;
-	t_systhread_mutex queue_mutex;
+	t_udpdgram *ring;
+	unsigned long ring_head;	//next slot the listener fills
+	unsigned long ring_tail;	//next slot the clock delivers
+	unsigned long tick_pending;	//nonzero while a clock tick is scheduled
     void *clock;
-    int droppedpackets;
+    long droppedpackets;
+    long reporteddrops;	//droppedpackets at the last time we posted about it
+    long poolexhausted;	//times the listener found every slot in use
+    long batches;		//receive calls that returned datagrams
+    long batcheddgrams;	//datagrams those calls returned
+    long maxbatch;
 	int maxqueuesize;
 	t_linklist *clients;
 } t_udpreceiver;
@@ -63,11 +101,10 @@ t_udpreceiver *udpreceiver_get_global_receiver(int port);
 
 int udpreceiver_netset(t_udpreceiver *x);
 void udpreceiver_listen(t_udpreceiver *x);
-void udpreceiver_enqueue_dgram(t_udpreceiver *x, t_bytebuf *bb);
-t_bytebuf* udpreceiver_dequeue_dgram(t_udpreceiver *x);
-void udpreceiver_deferdroppedpacketpost(t_udpreceiver *x,t_symbol *msg, short argc, t_atom *argv);
+long udpreceiver_free_slots(t_udpreceiver *x);
+void udpreceiver_publish(t_udpreceiver *x, long count);
+void udpreceiver_drop_dgram(t_udpreceiver *x);
 void udpreceiver_clock_tick(t_udpreceiver *x);
-void udpreceiver_cleanlinklist(t_udpreceiver *x);
 void udpreceiver_shutdown(t_udpreceiver *x);
 void udpreceiver_free(t_udpreceiver *x);
 
@@ -76,6 +113,7 @@ t_udpreceiver* udpreceiver_new(int port);
 int udpreceiver_addclient(t_udpreceiver *x,void *client, t_udpreceiver_callback callback);
 int udpreceiver_removeclient(t_udpreceiver *x,void *client);//if clients is 0 free
 void udpreceiver_maxqueuesize(t_udpreceiver *x,int maxqueuesize);
+void udpreceiver_stats(t_udpreceiver *x, t_object *client);
 
 //if no port exists create a new udp_receiver at specified port and start it up
 //otherwise just return t_udpreceiver already bound to port.
@@ -172,25 +210,44 @@ int udpreceiver_removeclient(t_udpreceiver *x,void *client)//if clients is zero
 
 t_udpreceiver* udpreceiver_new(int port)
 {
+	int i;
 	t_udpreceiver *x = udpreceiver_get_global_receiver(port);
 	if(x)
 		return x;
 	
-	x = (t_udpreceiver *)getbytes(sizeof(t_udpreceiver));
-	if(systhread_mutex_new(&(x->queue_mutex), 0) != 0)
+	x = (t_udpreceiver *)sysmem_newptrclear(sizeof(t_udpreceiver));
+	x->ring = (t_udpdgram *)sysmem_newptrclear(RING_CAPACITY * sizeof(t_udpdgram));
+	x->readbuf = sysmem_newptr(MAX_DGRAM_SIZE);
+#ifdef __linux__
+	x->overflow = sysmem_newptr(UDP_BATCH_SIZE * DGRAM_OVERFLOW_SIZE);
+	if(!x->overflow)
 	{
-		object_error((t_object *)x, "could not create queue mutex. uh oh.");
-		freebytes(x, sizeof(t_udpreceiver));
+		error("net.recv.udp: out of memory for the datagram pool");
+		udpreceiver_free(x);
 		return NULL;
-	} 
+	}
+#endif
+	if(!x->ring || !x->readbuf)
+	{
+		error("net.recv.udp: out of memory for the datagram pool");
+		udpreceiver_free(x);
+		return NULL;
+	}
+	for(i = 0; i < RING_CAPACITY; i++)
+	{
+		if(!(x->ring[i].buf = sysmem_newptr(DGRAM_SLOT_SIZE)))
+		{
+			error("net.recv.udp: out of memory for the datagram pool");
+			udpreceiver_free(x);
+			return NULL;
+		}
+		x->ring[i].size = DGRAM_SLOT_SIZE;
+	}
 	
 	x->port  = port;
 	x->s     = (t_syssocket)NULL;
-	x->queue = (t_linklist *)linklist_new();
 	x->listening = false;
 	x->clock =  clock_new(x,(method)udpreceiver_clock_tick);
-	x->droppedpackets = 0;
-	x->readbuf = sysmem_newptr(MAX_DGRAM_SIZE);
 	x->maxqueuesize = DEFAULT_MAX_QUEUE_SIZE;
 	x->clients = (t_linklist *)linklist_new();
 	udpreceiver_netset(x);//side effect of starting listener thread		
@@ -235,32 +292,164 @@ int udpreceiver_netset(t_udpreceiver *x)
     return 1;
 }
 
-void udpreceiver_listen(t_udpreceiver *x)
+//number of slots the listener may fill right now
+long udpreceiver_free_slots(t_udpreceiver *x)
+{
+	long used = (long)(x->ring_head - RING_LOAD(&x->ring_tail));
+	long limit = x->maxqueuesize < RING_CAPACITY ? x->maxqueuesize : RING_CAPACITY;
+	return limit - used;
+}
+
+//hand count freshly filled slots to the scheduler, waking it up unless a tick is already on its way
+void udpreceiver_publish(t_udpreceiver *x, long count)
+{
+	RING_STORE(&x->ring_head, x->ring_head + count);
+	x->batches++;
+	x->batcheddgrams += count;
+	if(count > x->maxbatch)
+		x->maxbatch = count;
+	if(RING_EXCHANGE(&x->tick_pending, 1) == 0)
+		clock_delay(x->clock,0);
+}
+
+//every slot is waiting for the scheduler: read the next datagram into readbuf and throw it away
+void udpreceiver_drop_dgram(t_udpreceiver *x)
 {
 	int fromlen = sizeof(x->from);
+	
+	x->poolexhausted++;
+	if(syssock_recvfrom(x->s,x->readbuf,MAX_DGRAM_SIZE,0,(struct sockaddr *)&(x->from),&fromlen) > 0)
+		x->droppedpackets++;
+}
+
+#ifdef __linux__
+
+//Fill as many free slots as the kernel has datagrams for with one recvmmsg() call.
+//Each message gets its slot as the first iovec and its own piece of the overflow area
+//as the second, so datagrams bigger than their slot aren't truncated; the slot then
+//grows to fit them, and after that big datagrams fit in that slot.
+void udpreceiver_listen(t_udpreceiver *x)
+{
+	struct mmsghdr msgs[UDP_BATCH_SIZE];
+	struct iovec iov[UDP_BATCH_SIZE][2];
+	long i, batch, len;
+	int n;
+	t_udpdgram *d;
+	
+	while(x->listening)
+	{
+		batch = udpreceiver_free_slots(x);
+		if(batch <= 0)
+		{
+			udpreceiver_drop_dgram(x);
+			continue;
+		}
+		if(batch > UDP_BATCH_SIZE)
+			batch = UDP_BATCH_SIZE;
+		
+		for(i = 0; i < batch; i++)
+		{
+			d = &x->ring[(x->ring_head + i) & RING_MASK];
+			iov[i][0].iov_base = d->buf;
+			iov[i][0].iov_len = d->size;
+			iov[i][1].iov_base = x->overflow + i * DGRAM_OVERFLOW_SIZE;
+			iov[i][1].iov_len = DGRAM_OVERFLOW_SIZE;
+			setmem(&msgs[i].msg_hdr, sizeof(msgs[i].msg_hdr), 0);
+			msgs[i].msg_hdr.msg_iov = iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 2;
+		}
+		
+		n = recvmmsg(x->s, msgs, batch, MSG_WAITFORONE, NULL);
+		if(n <= 0)
+			continue;
+		
+		for(i = 0; i < n; i++)
+		{
+			d = &x->ring[(x->ring_head + i) & RING_MASK];
+			len = msgs[i].msg_len;
+			if(msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+			{
+				//bigger than slot and overflow together: count it as dropped and reuse the slot
+				x->droppedpackets++;
+				len = 0;
+			}
+			else if(len > d->size)
+			{
+				char *overflow = iov[i][1].iov_base;
+				long oldsize = d->size;
+				char *grown = sysmem_resizeptr(d->buf, len);
+				if(!grown)
+				{
+					x->droppedpackets++;
+					len = 0;
+				}
+				else
+				{
+					d->buf = grown;
+					d->size = len;
+					sysmem_copyptr(overflow, d->buf + oldsize, len - oldsize);
+				}
+			}
+			d->n = len;
+		}
+		udpreceiver_publish(x, n);
+	}	
+}
+
+#else
+
+void udpreceiver_listen(t_udpreceiver *x)
+{
+	int fromlen;
 	int n;
-	t_bytebuf *bb;
+	t_udpdgram *d;
 	
 	while(x->listening)
 	{
+		if(udpreceiver_free_slots(x) <= 0)
+		{
+			udpreceiver_drop_dgram(x);
+			continue;
+		}
+		
+		fromlen = sizeof(x->from);
 		n = syssock_recvfrom(x->s,x->readbuf,MAX_DGRAM_SIZE,0,(struct sockaddr *)&(x->from),&fromlen);
 		if(n > 0)
 		{
-			bb = bytebuf_new(n);
-			bytebuf_copyto(bb,x->readbuf,n);
-			udpreceiver_enqueue_dgram(x,bb);
+			d = &x->ring[x->ring_head & RING_MASK];
+			if(n > d->size)
+			{
+				char *grown = sysmem_resizeptr(d->buf, n);
+				if(!grown)
+				{
+					x->droppedpackets++;
+					continue;
+				}
+				d->buf = grown;
+				d->size = n;
+			}
+			sysmem_copyptr(x->readbuf, d->buf, n);
+			d->n = n;
+			udpreceiver_publish(x, 1);
 		}
 		//post("read %d bytes",n);
 	}	
 }
 
+#endif
+
 void udpreceiver_shutdown(t_udpreceiver *x)	
 {   
     if (x->listener) 
     {   
 		x->listening = false;
 		if (x->s)
+		{
+#ifdef __linux__
+			shutdown(x->s, SHUT_RDWR);	//closing alone doesn't wake up a blocked recvmmsg()
+#endif
 			syssock_close(x->s);	
+		}
 		systhread_join(x->listener,NULL);  	//wait for the thread to stop
 		x->listener = NULL;
 	}	
@@ -268,96 +457,89 @@ void udpreceiver_shutdown(t_udpreceiver *x)
 
 void udpreceiver_maxqueuesize(t_udpreceiver *x,int maxqueuesize)
 {
-	x->maxqueuesize = maxqueuesize;	
-}
-
-void udpreceiver_enqueue_dgram(t_udpreceiver *x, t_bytebuf *bb)
-{
-	LOCK_QUEUE
-	if(linklist_getsize(x->queue) > x->maxqueuesize)
+	if(maxqueuesize > RING_CAPACITY)
 	{
-		x->droppedpackets++;
-		//when we obex this thing we should be able to report the port from
-		//deferdroppedpacketpost. It seems like deferlow wants a valid object
-		//as the first argument if non null...
-		defer_low(0,(method)udpreceiver_deferdroppedpacketpost,(t_symbol *)x,0,0);		
-		bytebuf_free(bb);
-		UNLOCK_QUEUE
-		return;
-	}	
-	else
-	{	
-		linklist_append(x->queue,bb);	
+		post("net.recv.udp [port %d]: maxqueuesize is limited to %d datagrams",x->port,RING_CAPACITY);
+		maxqueuesize = RING_CAPACITY;
 	}
-	UNLOCK_QUEUE
-	clock_delay(x->clock,0);
-}
-
-t_bytebuf* udpreceiver_dequeue_dgram(t_udpreceiver *x)
-{
-	t_bytebuf *bb=NULL;
-	LOCK_QUEUE
-	if(linklist_getsize(x->queue)>0)
-	{
-		bb = (t_bytebuf *)linklist_getindex(x->queue,0);
-		linklist_chuckindex(x->queue,0);		
-	}
-	UNLOCK_QUEUE
-	return bb;
+	x->maxqueuesize = maxqueuesize;	
 }
 
-void udpreceiver_deferdroppedpacketpost(t_udpreceiver *x,t_symbol *msg, short argc, t_atom *argv)
+void udpreceiver_stats(t_udpreceiver *x, t_object *client)
 {
-	t_udpreceiver *xx = (t_udpreceiver *)msg;
-	object_post((t_object *)x, "[port %d]: Dropped packet. Total dropped packets:%d",xx->port,xx->droppedpackets);
+	object_post(client, "[port %d]: %ld datagrams in %ld reads (mean batch %.1f, largest %ld)",
+		x->port, x->batcheddgrams, x->batches,
+		x->batches ? (double)x->batcheddgrams / x->batches : 0., x->maxbatch);
+	object_post(client, "[port %d]: pool of %d slots exhausted %ld times, %ld dropped packets",
+		x->port, x->maxqueuesize < RING_CAPACITY ? x->maxqueuesize : RING_CAPACITY,
+		x->poolexhausted, x->droppedpackets);
 }
 
-
+//deliver everything the listener has published so far
 void udpreceiver_clock_tick(t_udpreceiver *x)
 {
-	t_bytebuf *bb;
+	t_bytebuf bb;
+	t_udpdgram *d;
+	unsigned long head, tail;
+	long drops;
 	int i;
 	t_udpreceiver_client *c;
 	int numclients = linklist_getsize(x->clients);
-	while((bb = udpreceiver_dequeue_dgram(x)) != NULL)
+	
+	//datagrams published after this point schedule another tick
+	RING_STORE(&x->tick_pending, 0);
+	head = RING_LOAD(&x->ring_head);
+	
+	for(tail = x->ring_tail; tail != head; )
 	{
-		for(i = 0;i < numclients;i++)
+		d = &x->ring[tail & RING_MASK];
+		if(d->n > 0)
 		{
-			c = (t_udpreceiver_client *)linklist_getindex(x->clients,i);
-			(*(c->callback))(c->client,bb);
+			bb.buf = d->buf;
+			bb.size = bb.n = d->n;
+			for(i = 0;i < numclients;i++)
+			{
+				c = (t_udpreceiver_client *)linklist_getindex(x->clients,i);
+				(*(c->callback))(c->client,&bb);
+			}
 		}
-		bytebuf_free(bb);
+		//give the slot back to the listener
+		RING_STORE(&x->ring_tail, ++tail);
 	}
-}
-//do we need to lock the queue here?
-void udpreceiver_cleanlinklist(t_udpreceiver *x)
-{
-	t_bytebuf *bb;
-	while((bb = udpreceiver_dequeue_dgram(x)) != NULL)
+	
+	drops = x->droppedpackets;
+	if(drops != x->reporteddrops)
 	{
-		bytebuf_free(bb);			
+		post("net.recv.udp [port %d]: Dropped %ld packets. Total dropped packets:%ld",
+			x->port, drops - x->reporteddrops, drops);
+		x->reporteddrops = drops;
 	}
-	
 }
 
 void udpreceiver_free(t_udpreceiver *x)
 {
-	//probaby should clean the queue unless linklist free just takes care of it which it probably does
+	int i;
+	
 	udpreceiver_shutdown(x);	
-	if(x->queue)
-	{
-		udpreceiver_cleanlinklist(x);	
-		freeobject((t_object *)x->queue);
-	}	
 	if(x->clock)
 	{
 		clock_unset(x->clock);
 		freeobject(x->clock);
 	}
-	if(x->queue_mutex)
-		systhread_mutex_free(x->queue_mutex);
-	
-	sysmem_freeptr(x->readbuf);
+	if(x->ring)
+	{
+		for(i = 0; i < RING_CAPACITY; i++)
+			if(x->ring[i].buf)
+				sysmem_freeptr(x->ring[i].buf);
+		sysmem_freeptr(x->ring);
+	}
+	if(x->clients)
+		freeobject((t_object *)x->clients);
+	if(x->readbuf)
+		sysmem_freeptr(x->readbuf);
+	if(x->overflow)
+		sysmem_freeptr(x->overflow);
+	sysmem_freeptr(x);
 }
 
 
@@ -385,6 +567,7 @@ void udprecv_assist(t_udprecv *x, void *b, long m, long a, char *s);
 void udprecv_init();
 void udprecv_setport(t_udprecv *x,long port);
 void udprecv_setmaxqueuesize(t_udprecv *x,int maxqueuesize);
+void udprecv_stats(t_udprecv *x);
 void udprecv_callback(void *x,t_bytebuf *bb);
 
 //symbols
@@ -409,6 +592,7 @@ void main(void)
     addmess((method)udprecv_assist,"assist",A_CANT,0);
     addmess((method)udprecv_setport,"port",A_LONG,0);
     addmess((method)udprecv_setmaxqueuesize,"maxqueuesize",A_LONG,0);
+    addmess((method)udprecv_stats,"stats",0);
 	udprecv_init();
 	//init our udpreceiver class as well
 	udpreceiver_init();
@@ -447,6 +631,12 @@ void udprecv_setmaxqueuesize(t_udprecv *x,int maxqueuesize)
 
 }
 
+void udprecv_stats(t_udprecv *x)
+{
+	if(x->recv)
+		udpreceiver_stats(x->recv,(t_object *)x);
+}
+
 void udprecv_assist(t_udprecv *x, void *b, long m, long a, char *s)
 {
 	// this system eliminates the need for a STR# resource
@@ -0,0 +1,388 @@
+/*
+Copyright (c) 2013.  The Regents of the University of California (Regents).
+All Rights Reserved.
+
+Permission to use, copy, modify, and distribute this software and its
+documentation for educational, research, and not-for-profit purposes, without
+fee and without a signed licensing agreement, is hereby granted, provided that
+the above copyright notice, this paragraph and the following two paragraphs
+appear in all copies, modifications, and distributions.  Contact The Office of
+Technology Licensing, UC Berkeley, 2150 Shattuck Avenue, Suite 510, Berkeley,
+CA 94720-1620, (510) 643-7201, for commercial licensing opportunities.
+
+IN NO EVENT SHALL REGENTS BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL,
+INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF
+THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF REGENTS HAS BEEN
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+REGENTS SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE. THE SOFTWARE AND ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED
+HEREUNDER IS PROVIDED "AS IS". REGENTS HAS NO OBLIGATION TO PROVIDE
+MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+*/
+
+/*
+ * cnmat_fft.c
+ *
+ * A real FFT of size n is computed as a complex FFT of size N = n/2 on the
+ * even/odd samples, followed by the usual split into the real spectrum.
+ * The complex FFT works on split real/imaginary arrays (the scratch half of
+ * a cnmat_fft_buffer_new() buffer) so that every butterfly pass is a run of
+ * independent, aligned, unit stride operations: four lanes at a time with
+ * SSE or NEON, plain C otherwise.
+ *
+ * Plans are shared through gensym("CNMAT_fft_plans")->s_thing so that all
+ * externals loaded in the same Max process use one table per (size, type).
+ */
+
+#include <math.h>
+#include "ext.h"
+#include "ext_critical.h"
+#include "cnmat_fft.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define CNMAT_FFT_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CNMAT_FFT_NEON
+#include <arm_neon.h>
+#endif
+
+#define CNMAT_FFT_ALIGN 32
+
+// Bump this whenever t_cnmat_fftplan or the table layout changes: plans
+// from a registry created by another version are never used.
+#define CNMAT_FFT_REGISTRY_VERSION 1
+
+struct _cnmat_fftplan {
+	long p_n;					// real transform size
+	long p_type;
+	long p_refcount;
+	struct _cnmat_fftplan *p_next;
+	long *p_bitrev;				// N = n/2 entries
+	float *p_twr;				// butterfly twiddles: entry m+k is w^k for span m
+	float *p_twi;
+	float *p_unr;				// real split twiddles, N/2+1 entries
+	float *p_uni;
+};
+
+typedef struct _cnmat_fftregistry {
+	long r_version;
+	t_cnmat_fftplan *r_plans;
+} t_cnmat_fftregistry;
+
+static t_cnmat_fftregistry cnmat_fft_private_registry = {CNMAT_FFT_REGISTRY_VERSION, NULL};
+
+static void *cnmat_fft_alignedptr(long bytes)
+{
+	char *p = sysmem_newptrclear(bytes + CNMAT_FFT_ALIGN + sizeof(void *));
+	char *aligned;
+
+	if(!p){
+		return NULL;
+	}
+	aligned = (char *)(((size_t)p + sizeof(void *) + CNMAT_FFT_ALIGN - 1) & ~(size_t)(CNMAT_FFT_ALIGN - 1));
+	((void **)aligned)[-1] = p;
+	return aligned;
+}
+
+static void cnmat_fft_freealignedptr(void *aligned)
+{
+	if(aligned){
+		sysmem_freeptr(((void **)aligned)[-1]);
+	}
+}
+
+// Must be called inside critical_enter(0)
+static t_cnmat_fftregistry *cnmat_fft_registry(void)
+{
+	t_symbol *s = gensym("CNMAT_fft_plans");
+	t_cnmat_fftregistry *r = (t_cnmat_fftregistry *)s->s_thing;
+
+	if(!r){
+		r = (t_cnmat_fftregistry *)sysmem_newptrclear(sizeof(t_cnmat_fftregistry));
+		if(!r){
+			return &cnmat_fft_private_registry;
+		}
+		r->r_version = CNMAT_FFT_REGISTRY_VERSION;
+		r->r_plans = NULL;
+		s->s_thing = (t_object *)r;
+	}
+	if(r->r_version != CNMAT_FFT_REGISTRY_VERSION){
+		// An external built against a different layout owns the shared
+		// cache; keep our plans to ourselves.
+		return &cnmat_fft_private_registry;
+	}
+	return r;
+}
+
+static void cnmat_fft_plan_destroy(t_cnmat_fftplan *p)
+{
+	if(p->p_bitrev) sysmem_freeptr(p->p_bitrev);
+	cnmat_fft_freealignedptr(p->p_twr);
+	cnmat_fft_freealignedptr(p->p_twi);
+	cnmat_fft_freealignedptr(p->p_unr);
+	cnmat_fft_freealignedptr(p->p_uni);
+	sysmem_freeptr(p);
+}
+
+static t_cnmat_fftplan *cnmat_fft_plan_build(long n, long type)
+{
+	t_cnmat_fftplan *p;
+	long N = n / 2, bits = 0, k, m;
+	double sign = (type == CNMAT_FFT_REAL_INVERSE) ? -1. : 1.;
+
+	if(!(p = (t_cnmat_fftplan *)sysmem_newptrclear(sizeof(t_cnmat_fftplan)))){
+		return NULL;
+	}
+	p->p_n = n;
+	p->p_type = type;
+	p->p_bitrev = (long *)sysmem_newptr(N * sizeof(long));
+	p->p_twr = (float *)cnmat_fft_alignedptr(N * sizeof(float));
+	p->p_twi = (float *)cnmat_fft_alignedptr(N * sizeof(float));
+	p->p_unr = (float *)cnmat_fft_alignedptr((N / 2 + 1) * sizeof(float));
+	p->p_uni = (float *)cnmat_fft_alignedptr((N / 2 + 1) * sizeof(float));
+	if(!p->p_bitrev || !p->p_twr || !p->p_twi || !p->p_unr || !p->p_uni){
+		cnmat_fft_plan_destroy(p);
+		return NULL;
+	}
+
+	while((1L << bits) < N){
+		bits++;
+	}
+	for(k = 0; k < N; k++){
+		long r = 0, b;
+		for(b = 0; b < bits; b++){
+			r |= ((k >> b) & 1) << (bits - 1 - b);
+		}
+		p->p_bitrev[k] = r;
+	}
+
+	// Same exponent sign as the Jehan-lib forward fft: w = exp(+i pi k / m).
+	// Computed directly rather than by recurrence, so large sizes stay accurate.
+	p->p_twr[0] = 1.f;
+	p->p_twi[0] = 0.f;
+	for(m = 1; m < N; m <<= 1){
+		for(k = 0; k < m; k++){
+			p->p_twr[m + k] = (float)cos(M_PI * k / m);
+			p->p_twi[m + k] = (float)(sign * sin(M_PI * k / m));
+		}
+	}
+	for(k = 0; k <= N / 2; k++){
+		p->p_unr[k] = (float)cos(M_PI * k / N);
+		p->p_uni[k] = (float)(sign * sin(M_PI * k / N));
+	}
+	return p;
+}
+
+t_cnmat_fftplan *cnmat_fft_plan_new(long n, long type)
+{
+	t_cnmat_fftregistry *r;
+	t_cnmat_fftplan *p;
+
+	if(n < CNMAT_FFT_MINSIZE || n > CNMAT_FFT_MAXSIZE || (n & (n - 1))){
+		return NULL;
+	}
+	if(type != CNMAT_FFT_REAL_FORWARD && type != CNMAT_FFT_REAL_INVERSE){
+		return NULL;
+	}
+
+	critical_enter(0);
+	r = cnmat_fft_registry();
+	for(p = r->r_plans; p; p = p->p_next){
+		if(p->p_n == n && p->p_type == type){
+			break;
+		}
+	}
+	if(!p && (p = cnmat_fft_plan_build(n, type))){
+		p->p_next = r->r_plans;
+		r->r_plans = p;
+	}
+	if(p){
+		p->p_refcount++;
+	}
+	critical_exit(0);
+	return p;
+}
+
+void cnmat_fft_plan_free(t_cnmat_fftplan *plan)
+{
+	t_cnmat_fftregistry *r;
+	t_cnmat_fftplan **pp;
+
+	if(!plan){
+		return;
+	}
+	critical_enter(0);
+	if(--plan->p_refcount <= 0){
+		// The plan may have come from either registry
+		r = cnmat_fft_registry();
+		for(pp = &r->r_plans; *pp && *pp != plan; pp = &(*pp)->p_next);
+		if(!*pp){
+			for(pp = &cnmat_fft_private_registry.r_plans; *pp && *pp != plan; pp = &(*pp)->p_next);
+		}
+		if(*pp){
+			*pp = plan->p_next;
+		}
+		cnmat_fft_plan_destroy(plan);
+	}
+	critical_exit(0);
+}
+
+long cnmat_fft_plan_size(t_cnmat_fftplan *plan)
+{
+	return plan ? plan->p_n : 0;
+}
+
+float *cnmat_fft_buffer_new(long n)
+{
+	if(n < CNMAT_FFT_MINSIZE){
+		n = CNMAT_FFT_MINSIZE;
+	}
+	// n floats for the caller, n floats of split complex scratch behind them
+	return (float *)cnmat_fft_alignedptr(2 * n * sizeof(float));
+}
+
+void cnmat_fft_buffer_free(float *buf)
+{
+	cnmat_fft_freealignedptr(buf);
+}
+
+// Complex FFT of size N on split, bit reversed data
+static void cnmat_fft_butterflies(t_cnmat_fftplan *plan, float *re, float *im, long N)
+{
+	const float s = (plan->p_type == CNMAT_FFT_REAL_INVERSE) ? -1.f : 1.f;
+	long b, k, m;
+
+	// First two passes as one radix-4 pass: the twiddles are 1 and +-i
+	for(b = 0; b < N; b += 4){
+		float r0 = re[b] + re[b + 1], i0 = im[b] + im[b + 1];
+		float r1 = re[b] - re[b + 1], i1 = im[b] - im[b + 1];
+		float r2 = re[b + 2] + re[b + 3], i2 = im[b + 2] + im[b + 3];
+		float r3 = re[b + 2] - re[b + 3], i3 = im[b + 2] - im[b + 3];
+
+		re[b] = r0 + r2;
+		im[b] = i0 + i2;
+		re[b + 2] = r0 - r2;
+		im[b + 2] = i0 - i2;
+		re[b + 1] = r1 - s * i3;
+		im[b + 1] = i1 + s * r3;
+		re[b + 3] = r1 + s * i3;
+		im[b + 3] = i1 - s * r3;
+	}
+
+	for(m = 4; m < N; m <<= 1){
+		const float *wr = plan->p_twr + m, *wi = plan->p_twi + m;
+
+		for(b = 0; b < N; b += 2 * m){
+			float *r0 = re + b, *i0 = im + b, *r1 = re + b + m, *i1 = im + b + m;
+#if defined(CNMAT_FFT_SSE)
+			for(k = 0; k < m; k += 4){
+				__m128 vwr = _mm_load_ps(wr + k), vwi = _mm_load_ps(wi + k);
+				__m128 xr = _mm_load_ps(r1 + k), xi = _mm_load_ps(i1 + k);
+				__m128 ar = _mm_load_ps(r0 + k), ai = _mm_load_ps(i0 + k);
+				__m128 tr = _mm_sub_ps(_mm_mul_ps(vwr, xr), _mm_mul_ps(vwi, xi));
+				__m128 ti = _mm_add_ps(_mm_mul_ps(vwr, xi), _mm_mul_ps(vwi, xr));
+				_mm_store_ps(r1 + k, _mm_sub_ps(ar, tr));
+				_mm_store_ps(i1 + k, _mm_sub_ps(ai, ti));
+				_mm_store_ps(r0 + k, _mm_add_ps(ar, tr));
+				_mm_store_ps(i0 + k, _mm_add_ps(ai, ti));
+			}
+#elif defined(CNMAT_FFT_NEON)
+			for(k = 0; k < m; k += 4){
+				float32x4_t vwr = vld1q_f32(wr + k), vwi = vld1q_f32(wi + k);
+				float32x4_t xr = vld1q_f32(r1 + k), xi = vld1q_f32(i1 + k);
+				float32x4_t ar = vld1q_f32(r0 + k), ai = vld1q_f32(i0 + k);
+				float32x4_t tr = vmlsq_f32(vmulq_f32(vwr, xr), vwi, xi);
+				float32x4_t ti = vmlaq_f32(vmulq_f32(vwr, xi), vwi, xr);
+				vst1q_f32(r1 + k, vsubq_f32(ar, tr));
+				vst1q_f32(i1 + k, vsubq_f32(ai, ti));
+				vst1q_f32(r0 + k, vaddq_f32(ar, tr));
+				vst1q_f32(i0 + k, vaddq_f32(ai, ti));
+			}
+#else
+			for(k = 0; k < m; k++){
+				float tr = wr[k] * r1[k] - wi[k] * i1[k];
+				float ti = wr[k] * i1[k] + wi[k] * r1[k];
+				r1[k] = r0[k] - tr;
+				i1[k] = i0[k] - ti;
+				r0[k] += tr;
+				i0[k] += ti;
+			}
+#endif
+		}
+	}
+}
+
+static void cnmat_fft_forward(t_cnmat_fftplan *plan, float *buf)
+{
+	long N = plan->p_n / 2, k;
+	float *re = buf + plan->p_n, *im = re + N;
+	const long *rev = plan->p_bitrev;
+	const float *wr = plan->p_unr, *wi = plan->p_uni;
+
+	// Even samples are the real part, odd samples the imaginary part
+	for(k = 0; k < N; k++){
+		re[k] = buf[2 * rev[k]];
+		im[k] = buf[2 * rev[k] + 1];
+	}
+	cnmat_fft_butterflies(plan, re, im, N);
+
+	buf[0] = re[0] + im[0];
+	buf[1] = re[0] - im[0];
+	for(k = 1; k <= N / 2; k++){
+		long nk = N - k;
+		// X[k] = E[k] + w^k O[k], X[N-k] = conj(E[k] - w^k O[k])
+		float er = 0.5f * (re[k] + re[nk]), ei = 0.5f * (im[k] - im[nk]);
+		float or_ = 0.5f * (im[k] + im[nk]), oi = -0.5f * (re[k] - re[nk]);
+		float tr = wr[k] * or_ - wi[k] * oi, ti = wr[k] * oi + wi[k] * or_;
+
+		buf[2 * k] = er + tr;
+		buf[2 * k + 1] = ei + ti;
+		buf[2 * nk] = er - tr;
+		buf[2 * nk + 1] = ti - ei;
+	}
+}
+
+static void cnmat_fft_inverse(t_cnmat_fftplan *plan, float *buf)
+{
+	long N = plan->p_n / 2, k;
+	float *re = buf + plan->p_n, *im = re + N;
+	const long *rev = plan->p_bitrev;
+	const float *wr = plan->p_unr, *wi = plan->p_uni;
+	const float scale = 1.f / N;
+
+	re[0] = 0.5f * (buf[0] + buf[1]);
+	im[0] = 0.5f * (buf[0] - buf[1]);
+	for(k = 1; k <= N / 2; k++){
+		long nk = N - k;
+		// Z[k] = E[k] + i O[k], Z[N-k] = conj(E[k]) + i conj(O[k])
+		float er = 0.5f * (buf[2 * k] + buf[2 * nk]), ei = 0.5f * (buf[2 * k + 1] - buf[2 * nk + 1]);
+		float dr = 0.5f * (buf[2 * k] - buf[2 * nk]), di = 0.5f * (buf[2 * k + 1] + buf[2 * nk + 1]);
+		float or_ = wr[k] * dr - wi[k] * di, oi = wr[k] * di + wi[k] * dr;
+
+		re[rev[k]] = er - oi;
+		im[rev[k]] = ei + or_;
+		re[rev[nk]] = er + oi;
+		im[rev[nk]] = or_ - ei;
+	}
+	cnmat_fft_butterflies(plan, re, im, N);
+
+	for(k = 0; k < N; k++){
+		buf[2 * k] = re[k] * scale;
+		buf[2 * k + 1] = im[k] * scale;
+	}
+}
+
+void cnmat_fft_execute(t_cnmat_fftplan *plan, float *buf)
+{
+	if(!plan || !buf){
+		return;
+	}
+	if(plan->p_type == CNMAT_FFT_REAL_INVERSE){
+		cnmat_fft_inverse(plan, buf);
+	}else{
+		cnmat_fft_forward(plan, buf);
+	}
+}
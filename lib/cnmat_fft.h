@@ -0,0 +1,70 @@
+/*
+Copyright (c) 2013.  The Regents of the University of California (Regents).
+All Rights Reserved.
+
+Permission to use, copy, modify, and distribute this software and its
+documentation for educational, research, and not-for-profit purposes, without
+fee and without a signed licensing agreement, is hereby granted, provided that
+the above copyright notice, this paragraph and the following two paragraphs
+appear in all copies, modifications, and distributions.  Contact The Office of
+Technology Licensing, UC Berkeley, 2150 Shattuck Avenue, Suite 510, Berkeley,
+CA 94720-1620, (510) 643-7201, for commercial licensing opportunities.
+
+IN NO EVENT SHALL REGENTS BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL,
+INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF
+THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF REGENTS HAS BEEN
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+REGENTS SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE. THE SOFTWARE AND ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED
+HEREUNDER IS PROVIDED "AS IS". REGENTS HAS NO OBLIGATION TO PROVIDE
+MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+*/
+
+/*
+ * cnmat_fft.h
+ *
+ * Real-input FFT shared by the spectral analysis externals (analyzer~,
+ * pitch~, loudness~, brightness~, bark~, beat~, noisiness~, segment~,
+ * mfcc~).
+ *
+ * Plans hold the bit reversal and twiddle tables for one (size, type) pair.
+ * They live in a process-wide cache, so every instance and every external
+ * asking for the same FFT size shares one set of tables.
+ *
+ * The spectrum layout is the one of the old Jehan-lib fftRealfast():
+ *	buf[0] = DC, buf[1] = Nyquist, buf[2k], buf[2k+1] = Re, Im of bin k
+ * with the same (positive) exponent sign and no scaling, so existing
+ * analysis code reads the output unchanged.
+ */
+
+#ifndef __CNMAT_FFT_H__
+#define __CNMAT_FFT_H__
+
+#define CNMAT_FFT_MINSIZE 8
+#define CNMAT_FFT_MAXSIZE (1 << 24)
+
+enum {
+	CNMAT_FFT_REAL_FORWARD = 0,	// n real samples -> packed spectrum
+	CNMAT_FFT_REAL_INVERSE		// packed spectrum -> n real samples, exact inverse of the above
+};
+
+typedef struct _cnmat_fftplan t_cnmat_fftplan;
+
+// Returns a shared plan for a power of two size n, or NULL if n is not
+// supported.  Every plan must be handed back with cnmat_fft_plan_free().
+t_cnmat_fftplan *cnmat_fft_plan_new(long n, long type);
+void cnmat_fft_plan_free(t_cnmat_fftplan *plan);
+long cnmat_fft_plan_size(t_cnmat_fftplan *plan);
+
+// Vector aligned buffer of n floats, followed by the scratch space the
+// transform works in.  cnmat_fft_execute() only accepts these buffers, and
+// only with plans of size n or smaller.
+float *cnmat_fft_buffer_new(long n);
+void cnmat_fft_buffer_free(float *buf);
+
+// In place transform of buf
+void cnmat_fft_execute(t_cnmat_fftplan *plan, float *buf);
+
+#endif // __CNMAT_FFT_H__
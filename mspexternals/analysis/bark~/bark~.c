@@ -1,15 +1,10 @@
 #include "ext.h"
 #include "z_dsp.h"
-#include "fft.h"
+#include "cnmat_fft.h"
 #include <string.h>
 #include <math.h>
 #include <Accelerate/Accelerate.h> // to get veclib
 
-// Add altivec function prototypes
-#ifdef __ALTIVEC__
-#include "vDSP.h"
-#endif
-
 #define RES_ID	7316
 #define VERSION "1.3.1"
 #define NUMBAND 25 // at 44100 Hz only
@@ -57,7 +52,7 @@ typedef struct _bark {
     t_int *Buf2;			// buffer 2
     t_float *BufFFT;		// FFT buffer
     t_float *WindFFT;		// Window of FFTSize
-    t_float *memFFT;		// fftnobitrev.c memory space
+    t_cnmat_fftplan *fftplan;	// Shared FFT plan (see lib/cnmat_fft.h)
 
     t_int BufSize;			// FFT buffer size
 	t_int FFTSize;			// Size of FFT
@@ -71,12 +66,6 @@ typedef struct _bark {
 	void *x_clock;			// Use a clock for outputs... (better than Qelem)
 	Atom *myList;			// Copy of outputs as Atoms
 	void *x_outlet;			// List of outputs
-	
-	UInt32 x_log2n;
-	COMPLEX_SPLIT x_A;
-	FFTSetup x_setup;
-
-
 		
 } t_bark;
 
@@ -99,11 +88,6 @@ void *bark_new(t_symbol *s, short argc, t_atom *argv);
 void bark_free(t_bark *x);
 void bark_tick(t_bark *x);
 
-#ifdef __ALTIVEC__
-void bark_tick_G4(t_bark *x);
-long log2max(long n);
-#endif
-
 void main(void) {
 
     post("Bark~ object version " VERSION " by Tristan Jehan (Media Laboratory)");
@@ -198,6 +182,8 @@ void bark_dsp(t_bark *x, t_signal **sp, short *connect) {
 
 	if (vs > x->BufSize) {
 		post("Bark~: You need to use a smaller signal vector size...");
+	} else if (x->fftplan == NULL || x->BufFFT == NULL) {
+		error("Bark~: no FFT, not analyzing");
 	} else if (connect[0]) {
 		dsp_add(bark_perform, 3, sp[0]->s_vec, x, sp[0]->s_n);
 	}
@@ -439,6 +425,7 @@ void *bark_new(t_symbol *s, short argc, t_atom *argv) {
 	else if ((x->FFTSize > 512) && (x->FFTSize < 1024)) x->FFTSize = 1024;
 	else if ((x->FFTSize > 1024) && (x->FFTSize < 2048)) x->FFTSize = 2048;
 	else if ((x->FFTSize > 2048) && (x->FFTSize < 4096)) x->FFTSize = 4096;
+	else if ((x->FFTSize > 4096) && (x->FFTSize < 8192)) x->FFTSize = 8192;
 	else if ((x->FFTSize > 8192) && (x->FFTSize < 16384)) x->FFTSize = 16384;
 	else if ((x->FFTSize > 16384) && (x->FFTSize < 32768)) x->FFTSize = 32768;
 	else if ((x->FFTSize > 32768) && (x->FFTSize < 65536)) x->FFTSize = 65536;
@@ -446,6 +433,11 @@ void *bark_new(t_symbol *s, short argc, t_atom *argv) {
 		post("Bark~: Maximum FFT size is 65536 samples");
 		x->FFTSize = 65536;
 	}
+	if (x->FFTSize & (x->FFTSize - 1)) { // cnmat_fft only does powers of two
+		for (i = CNMAT_FFT_MINSIZE; i < x->FFTSize; i <<= 1);
+		post("Bark~: FFT size rounded up to %d", i);
+		x->FFTSize = i;
+	}
 	
 	// Overlap case
 	if (x->x_overlap > x->BufSize-vs) {
@@ -464,33 +456,16 @@ void *bark_new(t_symbol *s, short argc, t_atom *argv) {
 	post("	Window type = %s",x->x_winName);
 	post("	Initial delay = %d",x->x_delay);
 
-	// Here comes the choice for altivec optimization or not...
-	if (sys_optimize()) { // note that we DON'T divide the vector size by four here
-
-#ifdef __ALTIVEC__ // More code and a new ptr so that x->BufFFT is vector aligned.
-#pragma altivec_model on 
-		x->x_clock = clock_new(x,(method)bark_tick_G4); // Call altivec-optimized tick function
-		post("	Using G4-optimized FFT");	
-		// Allocate some memory for the altivec FFT
-		x->x_A.realp = t_getbytes(x->x_FFTSizeOver2 * sizeof(t_float));
-		x->x_A.imagp = t_getbytes(x->x_FFTSizeOver2 * sizeof(t_float));
-		x->x_log2n = log2max(x->FFTSize);
-      	x->x_setup = create_fftsetup (x->x_log2n, 0);
-#pragma altivec_model off
-#else
-		error("  No G4 optimization available");
-#endif
-
-	} else { // Normal tick function
-		x->x_clock = clock_new(x,(method)bark_tick);
-		x->memFFT = (t_float*) NewPtr(CMAX * x->FFTSize * sizeof(t_float)); // memory allocated for normal fft twiddle
-	}
+	x->x_clock = clock_new(x,(method)bark_tick);
+	x->fftplan = cnmat_fft_plan_new(x->FFTSize, CNMAT_FFT_REAL_FORWARD);
+	if (x->fftplan == NULL)
+		error("Bark~: can't make an FFT of size %d", x->FFTSize);
 	post("");
 
 	// Allocate memory
 	x->Buf1 = (t_int*) NewPtr(x->BufSize * sizeof(t_float)); // Careful these are pointers to integers but the content is floats
 	x->Buf2 = (t_int*) NewPtr(x->BufSize * sizeof(t_float));
-	x->BufFFT = (t_float*) NewPtr(x->FFTSize * sizeof(t_float));
+	x->BufFFT = cnmat_fft_buffer_new(x->FFTSize);
 	x->WindFFT = (t_float*) NewPtr(x->BufSize * sizeof(t_float));
 
 	if (x->x_Fs != DEFAULT_FS) {
@@ -570,19 +545,11 @@ void  bark_free(t_bark *x) {
 
 dsp_free((t_pxobject *)x);
 
-#ifdef __ALTIVEC__
-#pragma altivec_model on
-	if (x->x_A.realp) t_freebytes(x->x_A.realp, x->x_FFTSizeOver2);
-	if (x->x_A.imagp) t_freebytes(x->x_A.imagp, x->x_FFTSizeOver2);
-	if (x->x_setup) destroy_fftsetup(x->x_setup);
-#pragma altivec_model off
-#else
-	if (x->memFFT != NULL) DisposePtr((char *) x->memFFT);
-#endif		
+	cnmat_fft_plan_free(x->fftplan);
 
 	if (x->Buf1 != NULL) DisposePtr((char *) x->Buf1);
 	if (x->Buf2 != NULL) DisposePtr((char *) x->Buf2);
-	if (x->BufFFT != NULL) DisposePtr((char *) x->BufFFT);
+	if (x->BufFFT != NULL) cnmat_fft_buffer_free(x->BufFFT);
 	if (x->WindFFT != NULL) DisposePtr((char *) x->WindFFT);
 	if (x->x_clock != NULL) freeobject((t_object *)x->x_clock);
 	if (x->BufBark != NULL) DisposePtr((char *) x->BufBark);
@@ -608,75 +575,7 @@ void bark_tick(t_bark *x) {
 			x->BufFFT[i] *= x->WindFFT[i];
 			
 	// FFT
-	fftRealfast(x->FFTSize, x->BufFFT, x->memFFT);
-		
-	// Squared Absolute
-	for (i=0; i<x->FFTSize; i+=2) 
-		x->BufFFT[i/2] = (x->BufFFT[i] * x->BufFFT[i]) + (x->BufFFT[i+1] * x->BufFFT[i+1]);
-					
-	// Output Band energy
-	for (i=0; i<NUMBAND; i++) {
-		cpt = x->BufSizeBark[i];
-		energy = 0.0f;
-		while (cpt > 0) {
-			energy += x->BufFFT[index];
-			cpt--;
-			index++;
-		}
-		if (x->x_output == noList) {
-			if (x->x_scale) {
-				outlet_float(x->x_out[NUMBAND-1-i], energy/x->BufSizeBark[i]);
-			} else {
-				if (energy) {
-					outlet_float(x->x_out[NUMBAND-1-i], 10*log10((energy/x->BufSizeBark[i])/DB_REF));
- 				} else {
- 					outlet_float(x->x_out[NUMBAND-1-i], -DB_REF);					
- 				}
- 			}
- 		} else {
-			if (x->x_scale) {
-				SETFLOAT(x->myList+i, energy/x->BufSizeBark[i]);
-			} else {
-				if (energy) {			
-					SETFLOAT(x->myList+i, 10*log10((energy/x->BufSizeBark[i])/DB_REF));
-				} else {
-					SETFLOAT(x->myList+i, -DB_REF);
-				}
- 			}
- 		}
- 	}
- 		
- 	// Only for lists
-	if (x->x_output == List) {
- 		outlet_list(x->x_outlet, 0L, NUMBAND, x->myList);
- 	}
- }	
-
-void bark_tick_G4(t_bark *x) {
-
-	t_int i, index=0, cpt;
-	t_float energy = 0.0f;
-
-	// Zero padding
-	for (i=x->BufSize; i<x->FFTSize; i++)
-		x->BufFFT[i] = 0.0f;
-
-	// Window the samples
-	if (x->x_window != Recta)
-		for (i=0; i<x->BufSize; ++i)
-			x->BufFFT[i] *= x->WindFFT[i];
-			
-    // Look at the real signal as an interleaved complex vector by casting it.
-    // Then call the transformation function ctoz to get a split complex vector,
-    // which for a real signal, divides into an even-odd configuration.
-    ctoz ((COMPLEX *) x->BufFFT, 2, &x->x_A, 1, x->x_FFTSizeOver2);
-      
-    // Carry out a Forward FFT transform
-    fft_zrip(x->x_setup, &x->x_A, 1, x->x_log2n, FFT_FORWARD);
-
-    // The output signal is now in a split real form.  Use the function
-    // ztoc to get a split real vector.
-    ztoc ( &x->x_A, 1, (COMPLEX *) x->BufFFT, 2, x->x_FFTSizeOver2);
+	cnmat_fft_execute(x->fftplan, x->BufFFT);
 		
 	// Squared Absolute
 	for (i=0; i<x->FFTSize; i+=2) 
@@ -719,16 +618,3 @@ void bark_tick_G4(t_bark *x) {
  		outlet_list(x->x_outlet, 0L, NUMBAND, x->myList);
  	}
  }	
-
-// Computes the ceiling of log2(n) 
-// i.e. log2max(7) = 3, log2max(8) = 3, log2max(9) = 4
-long log2max(long n) {
-	
-	long power = 1;
-	long k = 1;
-	
-	if (n==1) return 0;
-	while ((k <<= 1) < n) power++;
-	
-	return power;
-}
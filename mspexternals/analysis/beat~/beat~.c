@@ -38,25 +38,23 @@
  DRUPAL_NODE: /patch/xxxx
  SVN_REVISION: $LastChangedRevision: 1916 $
  version 1.0.1: Tristans version.
+ version 1.1: comb bank keeps running energies, "thread" message
  @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
  
  */
 
 #include "ext.h"
 #include "z_dsp.h"
-#include "fft.h"
+#include "cnmat_fft.h"
+#include "ext_systhread.h"
+#include "param-update.h"
 #include <string.h>
 #include <math.h>
 #include <stdlib.h>
 
-// Add altivec function prototypes
-#ifdef __ALTIVEC__
-#include "vDSP.h"
-#endif
-
 #define RES_ID	7307
 #define COPYRIGHT "Copyright  2004 Massachussets Institute of Technology"
-#define VERSION "1.0.1"
+#define VERSION "1.1"
 #define DEFNUMBARKBANDS 3 // at 44100 Hz only
 #define MAXNUMBARKBANDS 25
 #define DEFAULT_FS 44100
@@ -86,6 +84,9 @@
 //#define DEF_TIME_TEMPOTHREAD 2000
 //#define MAX_TIME_TEMPOTHREAD 10000
 #define JUMP 256
+#define FRAMEQUEUE 32	  // Frames waiting for the analysis thread
+#define NEW_TEMPOSEARCH 1 // Settings waiting for beat_analyze
+#define NEW_TEMPOLOCK 2
 
 //#define TWOPI 6.28318530717952646f
 #define THREEPI 9.424777960769379f
@@ -108,17 +109,42 @@ void *beat_class;
 
 enum {Recta=0, Hann, Hamm, Blackman62, Blackman70, Blackman74, Blackman92};
 
-typedef struct combfilt
+/* All the comb filters, numReson per band. Every band has the same set of
+   resonators, and all of them advance together, so the per resonator values
+   (and the delay line indexes) are shared by the bands; the state is kept in
+   arrays of numReson doubles, band after band, so the inner loops run across
+   resonators. */
+typedef struct combbank
 {
-	double tempo;   // Tempo in bpm of the resonnance of the filter 
-	double alpha;   // Coefficient of the comb filter
-	int delay;	   // Delay of the filter
-	double *output; // Circular buffer of length 'delay' containing the filter output
-	int curInd;	   // Current index (delayed index = (curInd+1) mod delay)
-	double energy;  // Current energy of the filter
-	double norm;    // Normalisation for the filter
-	
-} CombFilter;
+	int numBands;		// Number of bands
+	int numReson;		// Number of resonators per band
+	int totalDelay;		// Sum of the delays: the length of one band's delay lines
+	double *tempo;		// Tempo in bpm of the resonnance of each filter
+	double *alpha;		// Coefficient of each comb filter
+	double *gain;		// 1 - alpha
+	double *norm;		// Normalisation for each filter
+	int *delay;			// Delay of each filter
+	int *offset;		// Where each delay line starts in a band
+	int *curInd;		// Current index (delayed index = (curInd+1) mod delay)
+	int *nextInd;		// (curInd+1) mod delay, for this frame
+	double *output;		// Circular buffers containing the filter outputs
+	double *sum;		// Running sum of each buffer...
+	double *sumSq;		// ...and of its squares, for the energy
+	double *cycSum;		// Sums of what has been written since the index
+	double *cycSumSq;	// last wrapped: they replace the running sums when it
+						// wraps again, so rounding errors can't pile up
+} CombBank;
+
+/* What the analysis hands over to the outlets */
+typedef struct beatresult
+{
+	long serial;		// Bumped by every tempo estimate
+	long beats;			// Bumped by every beat
+	double tempo;
+	double strength;
+	int numList;
+	float list[MAX_NUMRESON];	// Normalized tempo spectrum
+} BeatResult;
 
 
 typedef struct _beat {
@@ -141,7 +167,7 @@ typedef struct _beat {
 	double *filtEstim;	// Buffer containing the total energy of each resonator type
 	int frameRate;		// Frame rate in subdivisions of the input
 	int frameCpt;		// Counter for the analysis frame rate
-	CombFilter **comb;	// Comb filters
+	CombBank comb;		// Comb filters
 	int tempoIndex;
 	double strength;
 	int indexPhase;
@@ -154,6 +180,27 @@ typedef struct _beat {
 	int absTempoIndex;
 	int jump;
 	
+	int newSettings;				// NEW_TEMPOSEARCH | NEW_TEMPOLOCK, under mutex
+	double newTempolock;			// Settings from the messages, taken up by
+	double newSearch1;				// the analysis before its next frame
+	double newSearch2;
+	
+	BeatResult *result;				// Analysis results being updated
+	BeatResult *blocks[PARAM_NUM_BLOCKS];
+	paramPointers pp;				// Hands the results over to beat_tick
+	long lastSerial;				// Last estimate sent out
+	long lastBeats;					// Last beat sent out
+	
+	int threaded;					// Analysis in its own thread?
+	int quit;
+	t_systhread thread;
+	t_systhread_mutex mutex;		// Protects the frame queue and threaded
+	t_systhread_cond cond;			// New frame, or quit
+	double *frames;					// Queue of FRAMEQUEUE rectified frames
+	int frameRead;
+	int frameCount;
+	double *workFrame;				// Frame being analysed by the thread
+	
 	t_float x_Fs;			// Sample rate
 	t_int x_overlap;		// Number of overlaping samples
 	t_int x_hop;			// Number of non-overlaping samples
@@ -166,7 +213,7 @@ typedef struct _beat {
     t_int *Buf2;			// buffer 2
     t_float *BufFFT;		// FFT buffer
     t_float *WindFFT;		// Window of FFTSize
-    t_float *memFFT;		// fftnobitrev.c memory space
+    t_cnmat_fftplan *fftplan;	// Shared FFT plan (see lib/cnmat_fft.h)
 
     t_int BufSize;			// FFT buffer size
 	t_int FFTSize;			// Size of FFT
@@ -185,13 +232,6 @@ typedef struct _beat {
 	void *StrengthOutlet;	// Outlet for Tempo
 	void *BeatOutlet;		// Outlet for bangs
 
-#ifdef __ALTIVEC__ // Additional stuff for managing the G4-optimized FFT by Apple
-#pragma altivec_model on
-	UInt32 x_log2n;
-    COMPLEX_SPLIT x_A;
-	FFTSetup x_setup;
-#pragma altivec_model off
-#endif
 		
 } t_beat;
 
@@ -208,18 +248,22 @@ void beat_init(t_beat *x);
 void beat_free(t_beat *x);
 void beat_tick(t_beat *x);
 void beat_clear(t_beat *x, Symbol *sym);
-double filtEnergy(double *buf, int bufSize, double tempo);
+void comb_step(CombBank *b, double *input);
+double comb_energy(CombBank *b, int band, int reson);
+void comb_free(CombBank *b);
+void beat_analyze(t_beat *x, double *input);
+void beat_output(t_beat *x);
+void *beat_worker(t_beat *x);
+void beat_stopThread(t_beat *x);
+void beat_flushFrames(t_beat *x);
+void beat_takeSettings(t_beat *x);
+void beat_thread(t_beat *x, long n);
 int linReg(t_beat *x, double *vector, int numPoints);
 void beat_thresh(t_beat *x, Symbol *s, short argc, Atom *argv);
 void beat_phaselock(t_beat *x, Symbol *s, short argc, Atom *argv);
 void beat_temposearch(t_beat *x, Symbol *s, short argc, Atom *argv);
 void beat_tempolock(t_beat *x, Symbol *s, short argc, Atom *argv);
 
-#ifdef __ALTIVEC__
-void beat_tick_G4(t_beat *x);
-long log2max(long n);
-#endif
-
 void main(void) {
 
     post("Beat~ object version " VERSION " by Tristan Jehan");
@@ -245,6 +289,7 @@ void main(void) {
 	addmess((method)beat_phaselock, "phaselock", A_GIMME, 0);
 	addmess((method)beat_tempolock, "tempolock", A_GIMME, 0);
 	addmess((method)beat_temposearch, "temposearch", A_GIMME, 0);
+	addmess((method)beat_thread, "thread", A_LONG, 0);
 	addmess((method)beat_assist, "assist", A_CANT, 0);
 	addfloat((method)beat_float);
 	addint((method)beat_int);
@@ -318,6 +363,8 @@ void beat_dsp(t_beat *x, t_signal **sp, short *connect) {
 
 	if (vs > x->BufSize) {
 		post("Beat~: You need to use a smaller signal vector size...");
+	} else if (x->fftplan == NULL || x->BufFFT == NULL) {
+		error("Beat~: no FFT, not analyzing");
 	} else if (connect[0]) {
 		dsp_add(beat_perform, 3, sp[0]->s_vec, x, sp[0]->s_n);
 	}
@@ -399,6 +446,7 @@ void *beat_new(t_symbol *s, short argc, t_atom *argv) {
 	x->indexPhase = 0;
 	x->tempoWindow = BIG;
 	x->absTempoIndex = 0;
+	x->newSettings = 0;
 	x->x_window = DEFWIN;
 	x->BufSize = DEFBUFSIZE;
 	x->x_hop = vs;
@@ -459,6 +507,7 @@ void *beat_new(t_symbol *s, short argc, t_atom *argv) {
 		else if ((x->BufSize > 512) && (x->BufSize < 1024)) x->BufSize = 1024;
 		else if ((x->BufSize > 1024) && (x->BufSize < 2048)) x->BufSize = 2048;
 		else if ((x->BufSize > 2048) && (x->BufSize < 4096)) x->BufSize = 4096;
+		else if ((x->BufSize > 4096) && (x->BufSize < 8192)) x->BufSize = 8192;
 		else if (x->BufSize > 8192) {
 			post("   Maximum FFT size is 8192 samples!");
 			x->BufSize = 8192;
@@ -471,6 +520,11 @@ void *beat_new(t_symbol *s, short argc, t_atom *argv) {
 		
 	x->x_overlap = x->BufSize - x->x_hop;
 	x->FFTSize = x->BufSize;
+	if (x->FFTSize & (x->FFTSize - 1)) { // cnmat_fft only does powers of two
+		for (i = CNMAT_FFT_MINSIZE; i < x->FFTSize; i <<= 1);
+		post("Beat~: FFT size rounded up to %d", i);
+		x->FFTSize = i;
+	}
 	x->x_delay = DEFDELAY;
 
 
@@ -482,27 +536,10 @@ void *beat_new(t_symbol *s, short argc, t_atom *argv) {
 		
 	x->x_FFTSizeOver2 = x->FFTSize/2;		
 
-	// Here comes the choice for altivec optimization or not...
-	if (sys_optimize()) { // note that we DON'T divide the vector size by four here
-
-#ifdef __ALTIVEC__ // More code and a new ptr so that x->BufFFT is vector aligned.
-#pragma altivec_model on 
-		x->x_clock = clock_new(x,(method)beat_tick_G4); // Call altivec-optimized tick function
-		post("	Using G4-optimized FFT");	
-		// Allocate some memory for the altivec FFT
-		x->x_A.realp = t_getbytes(x->x_FFTSizeOver2 * sizeof(t_float));
-		x->x_A.imagp = t_getbytes(x->x_FFTSizeOver2 * sizeof(t_float));
-		x->x_log2n = log2max(x->FFTSize);
-      	x->x_setup = create_fftsetup (x->x_log2n, 0);
-#pragma altivec_model off
-#else
-#endif
-
-	} else { // Normal tick function
-		post("  No optimization!");
-		x->x_clock = clock_new(x,(method)beat_tick);
-		x->memFFT = (t_float*) NewPtr(CMAX * x->FFTSize * sizeof(t_float)); // memory allocated for normal fft twiddle
-	}
+	x->x_clock = clock_new(x,(method)beat_tick);
+	x->fftplan = cnmat_fft_plan_new(x->FFTSize, CNMAT_FFT_REAL_FORWARD);
+	if (x->fftplan == NULL)
+		error("Beat~: can't make an FFT of size %d", x->FFTSize);
 
 	if (x->numBarkBands > MAXNUMBARKBANDS) x->numBarkBands = MAXNUMBARKBANDS;
 	currBarkMax = barkSize = MAXBARK / x->numBarkBands;
@@ -511,7 +548,7 @@ void *beat_new(t_symbol *s, short argc, t_atom *argv) {
 	// Allocate memory
 	x->Buf1 = (t_int*) NewPtr(x->BufSize * sizeof(t_float)); // Careful these are pointers to integers but the content is floats
 	x->Buf2 = (t_int*) NewPtr(x->BufSize * sizeof(t_float));
-	x->BufFFT = (t_float*) NewPtr(x->FFTSize * sizeof(t_float));
+	x->BufFFT = cnmat_fft_buffer_new(x->FFTSize);
 	x->WindFFT = (t_float*) NewPtr(x->BufSize * sizeof(t_float));
 	x->BufBark = (t_float*) NewPtr(2*x->numBarkBands * sizeof(t_float));
 	x->BufSizeBark = (t_int*) NewPtr(x->numBarkBands * sizeof(t_int));
@@ -588,14 +625,21 @@ void *beat_new(t_symbol *s, short argc, t_atom *argv) {
 		x->cosine[i] = 0.5f * cosf(PI * (i+1)/x->numSamps) + 0.5f;
 	}
 
-	/* 2D matrix of comb filters */
-	x->comb = malloc(x->numBarkBands * sizeof(CombFilter *));
-	for (i=0; i<x->numBarkBands; i++) {
-  		x->comb[i] = malloc(tmpNumReson * sizeof(CombFilter));
-	}
+	/* Comb filters: the per resonator arrays are sized for tmpNumReson
+	   though resonators with the same delay are only kept once */
+	x->comb.numBands = x->numBarkBands;
+	x->comb.tempo = calloc(tmpNumReson, sizeof(double));
+	x->comb.alpha = calloc(tmpNumReson, sizeof(double));
+	x->comb.gain = calloc(tmpNumReson, sizeof(double));
+	x->comb.norm = calloc(tmpNumReson, sizeof(double));
+	x->comb.delay = calloc(tmpNumReson, sizeof(int));
+	x->comb.offset = calloc(tmpNumReson, sizeof(int));
+	x->comb.curInd = calloc(tmpNumReson, sizeof(int));
+	x->comb.nextInd = calloc(tmpNumReson, sizeof(int));
 	
 	/* Define tempo, alpha, and delay of all resonators */
 	x->numReson = 0;
+	x->comb.totalDelay = 0;
 	oldDelay = 0;
 	
 	for (i=0; i<tmpNumReson; i++) {
@@ -615,19 +659,42 @@ void *beat_new(t_symbol *s, short argc, t_atom *argv) {
 
 			norm /= (double)delay;
 		
-			for (j=0; j<x->numBarkBands; j++) {
-				x->comb[j][x->numReson].curInd = 0;
-				x->comb[j][x->numReson].energy = 0.0f;
-				x->comb[j][x->numReson].tempo = tempo;
-				x->comb[j][x->numReson].alpha = alpha;
-				x->comb[j][x->numReson].delay = delay;
-				x->comb[j][x->numReson].norm = norm;
-				x->comb[j][x->numReson].output = calloc(x->comb[j][x->numReson].delay, sizeof(double));
-			}
+			x->comb.tempo[x->numReson] = tempo;
+			x->comb.alpha[x->numReson] = alpha;
+			x->comb.gain[x->numReson] = 1 - alpha;
+			x->comb.delay[x->numReson] = delay;
+			x->comb.offset[x->numReson] = x->comb.totalDelay;
+			x->comb.norm[x->numReson] = norm;
+			x->comb.totalDelay += delay;
 			x->numReson++;
 			oldDelay = delay;
 		}
 	}
+	x->comb.numReson = x->numReson;
+	
+	x->comb.output = calloc(x->numBarkBands * x->comb.totalDelay, sizeof(double));
+	x->comb.sum = calloc(x->numBarkBands * x->numReson, sizeof(double));
+	x->comb.sumSq = calloc(x->numBarkBands * x->numReson, sizeof(double));
+	x->comb.cycSum = calloc(x->numBarkBands * x->numReson, sizeof(double));
+	x->comb.cycSumSq = calloc(x->numBarkBands * x->numReson, sizeof(double));
+	
+	/* Results: block 0 starts out current, the others are written by the analysis */
+	for (i=0; i<PARAM_NUM_BLOCKS; i++)
+		x->blocks[i] = calloc(1, sizeof(BeatResult));
+	InitParamPointers(&x->pp, x->blocks[0], x->blocks[1], x->blocks[2], x->blocks[3]);
+	x->result = calloc(1, sizeof(BeatResult));
+	x->lastSerial = 0;
+	x->lastBeats = 0;
+	
+	/* The analysis thread is started by the thread message */
+	x->threaded = 0;
+	x->quit = 0;
+	x->frameRead = 0;
+	x->frameCount = 0;
+	x->frames = calloc(FRAMEQUEUE * x->numBarkBands, sizeof(double));
+	x->workFrame = calloc(x->numBarkBands, sizeof(double));
+	systhread_mutex_new(&x->mutex, 0);
+	systhread_cond_new(&x->cond, 0);
 	
 	x->myList   = (Atom*) NewPtr(x->numReson * sizeof(*x->myList));     
 	x->x_outlet = listout((t_object *)x);		// Create a list outlet
@@ -665,23 +732,19 @@ void *beat_new(t_symbol *s, short argc, t_atom *argv) {
 
 void  beat_free(t_beat *x) {
 
-int i, j;
+int i;
 
 dsp_free((t_pxobject *)x);
 
-#ifdef __ALTIVEC__
-#pragma altivec_model on
-	if (x->x_A.realp) t_freebytes(x->x_A.realp, x->x_FFTSizeOver2);
-	if (x->x_A.imagp) t_freebytes(x->x_A.imagp, x->x_FFTSizeOver2);
-	if (x->x_setup) destroy_fftsetup(x->x_setup);
-#pragma altivec_model off
-#else
-	if (x->memFFT != NULL) DisposePtr((char *) x->memFFT);
-#endif		
+	beat_stopThread(x);
+	systhread_cond_free(x->cond);
+	systhread_mutex_free(x->mutex);
+
+	cnmat_fft_plan_free(x->fftplan);
 
 	if (x->Buf1 != NULL) DisposePtr((char *) x->Buf1);
 	if (x->Buf2 != NULL) DisposePtr((char *) x->Buf2);
-	if (x->BufFFT != NULL) DisposePtr((char *) x->BufFFT);
+	if (x->BufFFT != NULL) cnmat_fft_buffer_free(x->BufFFT);
 	if (x->WindFFT != NULL) DisposePtr((char *) x->WindFFT);
 	if (x->x_clock != NULL) freeobject((t_object *)x->x_clock);
 	if (x->BufBark != NULL) DisposePtr((char *) x->BufBark);
@@ -698,13 +761,13 @@ dsp_free((t_pxobject *)x);
 	if (x->oldInput) free(x->oldInput);
 	if (x->filtEstim) free(x->filtEstim);
 
-	for (j=0; j<x->numBarkBands; j++) {
-		for (i=0; i<x->numReson; i++) {
-			free(x->comb[j][i].output);
-		}
-			free(x->comb[j]);
-	}
-	free(x->comb);
+	if (x->frames) free(x->frames);
+	if (x->workFrame) free(x->workFrame);
+	if (x->result) free(x->result);
+	for (i=0; i<PARAM_NUM_BLOCKS; i++)
+		if (x->blocks[i]) free(x->blocks[i]);
+
+	comb_free(&x->comb);
 
 	
 }
@@ -731,45 +794,30 @@ void beat_phaselock(t_beat *x, Symbol *s, short argc, Atom *argv) {
 	else x->phaselock /= 100.0f;
 }
 
+// tempolock and temposearch only queue their settings: the indexes they
+// change belong to the analysis, which may be running in its own thread
 void beat_tempolock(t_beat *x, Symbol *s, short argc, Atom *argv) {
 
-	int val1, val2, val, k;
-	int tempoInd1, tempoInd2;
+	double tempolock = 100.;
 		
 	if (argv[0].a_type == A_LONG) {
-		x->tempolock = (float)argv[0].a_w.w_long;
+		tempolock = (float)argv[0].a_w.w_long;
 	} else if (argv[0].a_type == A_FLOAT) {
-		x->tempolock = argv[0].a_w.w_float;
+		tempolock = argv[0].a_w.w_float;
 	}
 	
-	if (x->tempolock > 100) x->tempolock = 1.0f;
-	else if (x->tempolock < 5) x->tempolock = 0.05f;
-	else x->tempolock /= 100.0f;
-	
-	val1 = x->tempoIndex;
-	val2 = x->numReson - 1 - x->tempoIndex;
-	
-	val = (val1 > val2) ? val1 : val2; 
-	
-	k = (int)(x->tempolock * val);
-	
-	if (k<1) k = 1;
-	
-	tempoInd1 = x->tempoIndex + x->tempoInd1 - k;
-	tempoInd2 = x->tempoIndex + x->tempoInd1 + k;
+	if (tempolock > 100) tempolock = 1.0f;
+	else if (tempolock < 5) tempolock = 0.05f;
+	else tempolock /= 100.0f;
 	
-	if (tempoInd1 < 0) tempoInd1 = 0;
-	if (tempoInd2 > x->numReson-1) tempoInd2 = x->numReson-1;
-	
-	x->tempoInd1 = tempoInd1;
-	x->tempoInd2 = tempoInd2;
-	x->tempoWindow = k;
-
+	systhread_mutex_lock(x->mutex);
+	x->newTempolock = tempolock;
+	x->newSettings |= NEW_TEMPOLOCK;
+	systhread_mutex_unlock(x->mutex);
 }
 
 void beat_temposearch(t_beat *x, Symbol *s, short argc, Atom *argv) {
-	double temp1=0, temp2=BIG, tempo;
-	int i, tempoInd1 = 1, tempoInd2 = x->numReson-2;
+	double temp1=0, temp2=BIG;
 	
 	if (argv[0].a_type == A_LONG) {
 		temp1 = (float)argv[0].a_w.w_long;
@@ -782,28 +830,75 @@ void beat_temposearch(t_beat *x, Symbol *s, short argc, Atom *argv) {
 	} else if (argv[1].a_type == A_FLOAT) {
 		temp2 = argv[1].a_w.w_float;
 	}
-		
-	if (temp1 > temp2) {
-		double tmp = temp1;
-		temp2 = temp1;
-		temp1 = tmp;
-	}
+	
+	// A new search range replaces any tempolock still waiting
+	systhread_mutex_lock(x->mutex);
+	x->newSearch1 = temp1;
+	x->newSearch2 = temp2;
+	x->newSettings = NEW_TEMPOSEARCH;
+	systhread_mutex_unlock(x->mutex);
+}
 
-	if (temp1 < x->comb[0][0].tempo) temp1 = x->comb[0][0].tempo;
-	if (temp2 > x->comb[0][x->numReson-1].tempo) temp2 = x->comb[0][x->numReson-1].tempo;
+// Apply the settings queued by tempolock and temposearch (with the mutex
+// held, before the next frame is analysed)
+void beat_takeSettings(t_beat *x) {
+
+	int val1, val2, val, k;
+	int tempoInd1, tempoInd2;
+	double temp1, temp2;
 	
-	while (temp1 >  x->comb[0][tempoInd1].tempo) {
-		tempoInd1++;
+	if (x->newSettings & NEW_TEMPOSEARCH) {
+		temp1 = x->newSearch1;
+		temp2 = x->newSearch2;
+		tempoInd1 = 1;
+		tempoInd2 = x->numReson-2;
+		
+		if (temp1 > temp2) {
+			double tmp = temp1;
+			temp2 = temp1;
+			temp1 = tmp;
+		}
+
+		if (temp1 < x->comb.tempo[0]) temp1 = x->comb.tempo[0];
+		if (temp2 > x->comb.tempo[x->numReson-1]) temp2 = x->comb.tempo[x->numReson-1];
+		
+		while (temp1 >  x->comb.tempo[tempoInd1]) {
+			tempoInd1++;
+		}
+		
+		while (temp2 <  x->comb.tempo[tempoInd2]) {
+			tempoInd2--;
+		}
+		
+		x->tempoInd1 = tempoInd1 - 1;
+		x->tempoInd2 = tempoInd2 + 1;
+		x->tempolock = 1.0;
 	}
 	
-	while (temp2 <  x->comb[0][tempoInd2].tempo) {
-		tempoInd2--;
+	if (x->newSettings & NEW_TEMPOLOCK) {
+		x->tempolock = x->newTempolock;
+		
+		val1 = x->tempoIndex;
+		val2 = x->numReson - 1 - x->tempoIndex;
+		
+		val = (val1 > val2) ? val1 : val2; 
+		
+		k = (int)(x->tempolock * val);
+		
+		if (k<1) k = 1;
+		
+		tempoInd1 = x->tempoIndex + x->tempoInd1 - k;
+		tempoInd2 = x->tempoIndex + x->tempoInd1 + k;
+		
+		if (tempoInd1 < 0) tempoInd1 = 0;
+		if (tempoInd2 > x->numReson-1) tempoInd2 = x->numReson-1;
+		
+		x->tempoInd1 = tempoInd1;
+		x->tempoInd2 = tempoInd2;
+		x->tempoWindow = k;
 	}
 	
-	x->tempoInd1 = tempoInd1 - 1;
-	x->tempoInd2 = tempoInd2 + 1;
-	x->tempolock = 1.0;
-	
+	x->newSettings = 0;
 }
 
 void beat_tick(t_beat *x) {
@@ -812,8 +907,6 @@ void beat_tick(t_beat *x) {
 	double energy = 0.0f;
 	double newData;
 	double *ptr;
-	int j, k;
-	float m = 0.0f, phase;
 
 	// Zero padding
 	for (i=x->BufSize; i<x->FFTSize; i++)
@@ -825,7 +918,7 @@ void beat_tick(t_beat *x) {
 			x->BufFFT[i] *= x->WindFFT[i];
 			
 	// FFT
-	fftRealfast(x->FFTSize, x->BufFFT, x->memFFT);
+	cnmat_fft_execute(x->fftplan, x->BufFFT);
 		
 	// Squared Absolute
 	for (i=0; i<x->FFTSize; i+=2) 
@@ -876,22 +969,116 @@ void beat_tick(t_beat *x) {
 	x->oldInput = ptr;
  		
  		
- 	// Comb filtering the signal for each single resonator
-	for (j=0; j<x->numBarkBands; j++) {
-		for (i=0; i<x->numReson; i++) {
-			int index = x->comb[j][i].curInd;
-			int previous = (index + x->comb[j][i].delay - 1) % x->comb[j][i].delay;
-			int next = (index + 1) % x->comb[j][i].delay;
-			
-			x->comb[j][i].output[index] = x->comb[j][i].alpha * x->comb[j][i].output[next] + (1 - x->comb[j][i].alpha) * x->curRecti[j]; // Comb filter
-			x->comb[j][i].curInd = next; // The next current index = the old delayed index in the circular buffer of size 'delay'
+ 	// The combs and the tempo estimate run here, or in the analysis thread
+ 	// if there is one: then the frame is queued for it
+	systhread_mutex_lock(x->mutex);
+	if (x->threaded) {
+		if (x->frameCount < FRAMEQUEUE) {
+			memcpy(x->frames + ((x->frameRead + x->frameCount) % FRAMEQUEUE) * x->numBarkBands,
+				x->curRecti, x->numBarkBands * sizeof(double));
+			x->frameCount++;
+			systhread_cond_signal(x->cond);
+		} // else the thread is hopelessly behind: drop the frame
+	} else {
+		beat_takeSettings(x);
+		beat_analyze(x, x->curRecti);
+	}
+	systhread_mutex_unlock(x->mutex);
+	
+	beat_output(x);
+ }	
 
-			if (x->frameCpt == x->frameRate) {
-				x->comb[j][i].energy = filtEnergy(x->comb[j][i].output, x->comb[j][i].delay, x->comb[j][i].tempo) / x->comb[j][i].norm;
+// Comb filtering the signal for each single resonator, one frame of
+// rectified band energies in
+void comb_step(CombBank *b, double *input) {
+
+	int i, j;
+	int numReson = b->numReson;
+	
+	// The indexes are the same in every band
+	for (i=0; i<numReson; i++) {
+		int next = b->curInd[i] + 1;
+		
+		if (next == b->delay[i]) next = 0;
+		b->nextInd[i] = next;
+	}
+	
+	for (j=0; j<b->numBands; j++) {
+		double *output = b->output + j * b->totalDelay;
+		double *sum = b->sum + j * numReson;
+		double *sumSq = b->sumSq + j * numReson;
+		double *cycSum = b->cycSum + j * numReson;
+		double *cycSumSq = b->cycSumSq + j * numReson;
+		double in = input[j];
+		
+		for (i=0; i<numReson; i++) {
+			double *buf = output + b->offset[i];
+			double old = buf[b->curInd[i]];
+			double y = b->alpha[i] * buf[b->nextInd[i]] + b->gain[i] * in; // Comb filter
+			
+			buf[b->curInd[i]] = y;
+			sum[i] += y - old;
+			sumSq[i] += y * y - old * old;
+			cycSum[i] += y;
+			cycSumSq[i] += y * y;
+		}
+		
+		// A buffer that was just filled from start to end holds exactly what
+		// was written since it last wrapped
+		for (i=0; i<numReson; i++) {
+			if (b->nextInd[i] == 0) {
+				sum[i] = cycSum[i];
+				sumSq[i] = cycSumSq[i];
+				cycSum[i] = cycSumSq[i] = 0.;
 			}
 		}
 	}
+	
+	// The next current index = the old delayed index in the circular buffer of size 'delay'
+	for (i=0; i<numReson; i++)
+		b->curInd[i] = b->nextInd[i];
+}
 
+// Energy of a filter from the running sums: the mean of (rms power - output)
+// over its buffer, normalised
+double comb_energy(CombBank *b, int band, int reson) {
+
+	double sumSq = b->sumSq[band * b->numReson + reson];
+	
+	if (sumSq < 0.) sumSq = 0.;	// rounding
+	return (sqrt(sumSq) - b->sum[band * b->numReson + reson] / b->delay[reson]) / b->norm[reson];
+}
+
+void comb_free(CombBank *b) {
+
+	if (b->tempo) free(b->tempo);
+	if (b->alpha) free(b->alpha);
+	if (b->gain) free(b->gain);
+	if (b->norm) free(b->norm);
+	if (b->delay) free(b->delay);
+	if (b->offset) free(b->offset);
+	if (b->curInd) free(b->curInd);
+	if (b->nextInd) free(b->nextInd);
+	if (b->output) free(b->output);
+	if (b->sum) free(b->sum);
+	if (b->sumSq) free(b->sumSq);
+	if (b->cycSum) free(b->cycSum);
+	if (b->cycSumSq) free(b->cycSumSq);
+}
+
+// One frame of analysis: comb filtering, then every frameRate frames the
+// tempo and phase estimate. Runs in beat_tick or in the analysis thread,
+// never both, and checks in x->result for beat_output when it changes.
+void beat_analyze(t_beat *x, double *input) {
+
+	t_int i, cpt;
+	int j;
+	float m = 0.0f, phase;
+	BeatResult *r = x->result, *block;
+	long serial = r->serial, beats = r->beats;
+	CombBank *comb = &x->comb;
+	
+	comb_step(comb, input);
 
 	// Estimate best candidate
 	if (x->frameCpt == x->frameRate) {
@@ -906,7 +1093,7 @@ void beat_tick(t_beat *x) {
 		for (i=x->tempoInd1; i<x->tempoInd2+1; i++) {
 			x->filtEstim[i] = 0.;
 			for (j=0; j<x->numBarkBands; j++) {
-				x->filtEstim[i] += x->comb[j][i].energy;
+				x->filtEstim[i] += comb_energy(comb, j, i);
 			}
 			x->filtEstim[i] /= (double)x->numBarkBands;
 		}	
@@ -918,26 +1105,26 @@ void beat_tick(t_beat *x) {
 		
 		cpt = 0;
 		for (i=x->tempoInd1; i<x->tempoInd2+1; i++) {
-			SETFLOAT(x->myList+cpt, x->filtEstim[i]);
+			r->list[cpt] = x->filtEstim[i];
 			cpt++;
 		}
-
-		outlet_float(x->StrengthOutlet, x->strength);
-		outlet_list(x->x_outlet, 0L,  x->tempoInd2+1 - x->tempoInd1, x->myList);
-		outlet_float(x->TempoOutlet, x->comb[0][x->tempoIndex + x->tempoInd1].tempo);
- 
+		r->numList = cpt;
+		r->strength = x->strength;
+		r->tempo = comb->tempo[x->absTempoIndex];
+		r->serial++;
  
  
  		/* Estimate Phase and maxPhase */	
 		m = 0.;
-		cpt = x->comb[0][x->absTempoIndex].curInd;
+		cpt = comb->curInd[x->absTempoIndex];
 		
-		if (x->comb[0][x->absTempoIndex].delay * x->phaselock > x->indexPhase) {
+		if (comb->delay[x->absTempoIndex] * x->phaselock > x->indexPhase) {
+			double *buf = comb->output + comb->offset[x->absTempoIndex];
 				
-		for (i=0; i<x->comb[0][x->absTempoIndex].delay * x->phaselock; i++) {
+		for (i=0; i<comb->delay[x->absTempoIndex] * x->phaselock; i++) {
 			phase = 0.;
 			for (j=0; j<x->numBarkBands; j++) {
-				phase += x->comb[j][x->absTempoIndex].output[cpt];			
+				phase += buf[j * comb->totalDelay + cpt];
 			}
 			phase /= x->numBarkBands;
 			
@@ -946,7 +1133,7 @@ void beat_tick(t_beat *x) {
 				x->indexPhase = i;
 			}
 	
-			if (cpt == x->comb[0][x->absTempoIndex].delay-1) {
+			if (cpt == comb->delay[x->absTempoIndex]-1) {
 				cpt = 0;
 			} else {
 				cpt++;
@@ -961,183 +1148,123 @@ void beat_tick(t_beat *x) {
 	x->indexPhase--;
 
 	if (x->indexPhase == 0) {
-		if(x->strength > x->thresh) outlet_bang(x->BeatOutlet);
-		x->indexPhase = x->comb[0][x->absTempoIndex].delay;
+		if(x->strength > x->thresh) r->beats++;
+		x->indexPhase = comb->delay[x->absTempoIndex];
 	}
-				
- }	
+	
+	if (r->serial != serial || r->beats != beats) {
+		block = (BeatResult *) CheckOutParamBlock(&x->pp);
+		block->serial = r->serial;
+		block->beats = r->beats;
+		block->tempo = r->tempo;
+		block->strength = r->strength;
+		block->numList = r->numList;
+		memcpy(block->list, r->list, r->numList * sizeof(float));
+		CheckInNewParams(&x->pp);
+	}
+}
 
-#ifdef __ALTIVEC__
-void beat_tick_G4(t_beat *x) {
+// Send out whatever the analysis found since the last time
+void beat_output(t_beat *x) {
 
-	t_int index=0, cpt;
-	double energy = 0.0f;
-	double newData;
-	double *ptr;
-	int i, j, k;
-	float m = 0.0f, phase;
+	BeatResult *r = (BeatResult *) GetCurrentParams(&x->pp);
+	int i;
 	
-	// Zero padding
-	for (i=x->BufSize; i<x->FFTSize; i++)
-		x->BufFFT[i] = 0.0f;
-
-	// Window the samples
-	if (x->x_window != Recta)
-		for (i=0; i<x->BufSize; ++i)
-			x->BufFFT[i] *= x->WindFFT[i];
-			
-    // Look at the real signal as an interleaved complex vector by casting it.
-    // Then call the transformation function ctoz to get a split complex vector,
-    // which for a real signal, divides into an even-odd configuration.
-    ctoz ((COMPLEX *) x->BufFFT, 2, &x->x_A, 1, x->x_FFTSizeOver2);
-      
-    // Carry out a Forward FFT transform
-    fft_zrip(x->x_setup, &x->x_A, 1, x->x_log2n, FFT_FORWARD);
-
-    // The output signal is now in a split real form.  Use the function
-    // ztoc to get a split real vector.
-    ztoc ( &x->x_A, 1, (COMPLEX *) x->BufFFT, 2, x->x_FFTSizeOver2);
-		
-	// Squared Absolute
-	for (i=0; i<x->FFTSize; i+=2) 
-		x->BufFFT[i/2] = (x->BufFFT[i] * x->BufFFT[i]) + (x->BufFFT[i+1] * x->BufFFT[i+1]);
-					
-	// Calculate Bark Band energy
-	for (i=0; i<x->numBarkBands; i++) {
-		cpt = x->BufSizeBark[i];
-		energy = 0.0f;
-		while (cpt > 0) {
-			energy += x->BufFFT[index];
-			cpt--;
-			index++;
+	if (r->serial != x->lastSerial) {
+		x->lastSerial = r->serial;
+		for (i=0; i<r->numList; i++) {
+			SETFLOAT(x->myList+i, r->list[i]);
 		}
-		
-		if (energy) {
-			x->curInput[i] = 10*log10((energy/x->BufSizeBark[i])/DB_REF);
-		} else {
-			x->curInput[i] = -DB_REF;					
-		}	
 
-		if((x->curRecti[i] = x->curInput[i] - x->oldInput[i]) < 0.0f) {
-			x->curRecti[i] = 0.;
-		}		
+		outlet_float(x->StrengthOutlet, r->strength);
+		outlet_list(x->x_outlet, 0L, r->numList, x->myList);
+		outlet_float(x->TempoOutlet, r->tempo);
+	}
+	
+	if (r->beats != x->lastBeats) {
+		x->lastBeats = r->beats;
+		outlet_bang(x->BeatOutlet);
+	}
+	DoneWithPreviousParams(&x->pp);
+}
 
-		x->oldInput[i] = x->curInput[i];
+// The analysis thread: runs beat_analyze on the frames queued by beat_tick
+void *beat_worker(t_beat *x) {
 
-		// Calculate temporal masking
-		newData = x->heldData[i] * x->cosine[x->index[i]];
-		
-		if (x->curRecti[i] < newData) {
-			x->oldData[i] = newData;
-		} else {
-			x->oldData[i] = x->curRecti[i];
-			x->heldData[i] = x->curRecti[i];
-			x->index[i] = 0;
-		}
-		
-		if (x->index[i] < x->numSamps-1) {
-			x->index[i]++;
-		}
-		 
- 	}
- 	
- 	// New frame becomes old	
-	ptr = x->curInput;	
-	x->curInput = x->oldInput;
-	x->oldInput = ptr;
- 		
- 		
- 	// Comb filtering the signal for each single resonator
-	for (j=0; j<x->numBarkBands; j++) {
-		for (i=0; i<x->numReson; i++) {
-			int index = x->comb[j][i].curInd;
-			int previous = (index + x->comb[j][i].delay - 1) % x->comb[j][i].delay;
-			int next = (index + 1) % x->comb[j][i].delay;
-			
-			x->comb[j][i].output[index] = x->comb[j][i].alpha * x->comb[j][i].output[next] + (1 - x->comb[j][i].alpha) * x->curRecti[j]; // Comb filter
-			x->comb[j][i].curInd = next; // The next current index = the old delayed index in the circular buffer of size 'delay'
-
-			if (x->frameCpt == x->frameRate) {
-				x->comb[j][i].energy = filtEnergy(x->comb[j][i].output, x->comb[j][i].delay, x->comb[j][i].tempo) / x->comb[j][i].norm;
-			}
+	systhread_mutex_lock(x->mutex);
+	while (!x->quit) {
+		if (!x->frameCount) {
+			systhread_cond_wait(x->cond, x->mutex);
+			continue;
 		}
+		memcpy(x->workFrame, x->frames + x->frameRead * x->numBarkBands, x->numBarkBands * sizeof(double));
+		x->frameRead = (x->frameRead + 1) % FRAMEQUEUE;
+		x->frameCount--;
+		beat_takeSettings(x);
+		systhread_mutex_unlock(x->mutex);
+		beat_analyze(x, x->workFrame);
+		systhread_mutex_lock(x->mutex);
 	}
+	systhread_mutex_unlock(x->mutex);
 
+	systhread_exit(0);
+	return NULL;
+}
 
-	// Estimate best candidate
-	if (x->frameCpt == x->frameRate) {
+// Stop the analysis thread; the frames it hadn't got to are analysed here
+void beat_stopThread(t_beat *x) {
+
+	unsigned int ret;
 	
-		if (x->tempolock < 1.0) {
-			x->tempoInd1 = x->absTempoIndex - x->tempoWindow;
-			x->tempoInd2 = x->absTempoIndex + x->tempoWindow;	
-			if (x->tempoInd1 < 0) x->tempoInd1 = 0;
-			if (x->tempoInd2 > x->numReson-1) x->tempoInd2 = x->numReson-1;
-		}
+	if (!x->threaded)
+		return;
+	systhread_mutex_lock(x->mutex);
+	x->quit = 1;
+	systhread_cond_signal(x->cond);
+	systhread_mutex_unlock(x->mutex);
 	
-		for (i=x->tempoInd1; i<x->tempoInd2+1; i++) {
-			x->filtEstim[i] = 0.;
-			for (j=0; j<x->numBarkBands; j++) {
-				x->filtEstim[i] += x->comb[j][i].energy;
-			}
-			x->filtEstim[i] /= (double)x->numBarkBands;
-		}	
-		x->frameCpt = 0;
-			
-		x->tempoIndex = linReg(x, &x->filtEstim[x->tempoInd1], x->tempoInd2+1 - x->tempoInd1);
-
-		x->absTempoIndex = x->tempoIndex + x->tempoInd1;			
-		
-		cpt = 0;
-		for (i=x->tempoInd1; i<x->tempoInd2+1; i++) {
-			SETFLOAT(x->myList+cpt, x->filtEstim[i]);
-			cpt++;
-		}
-
-		outlet_float(x->StrengthOutlet, x->strength);
-		outlet_list(x->x_outlet, 0L,  x->tempoInd2+1 - x->tempoInd1, x->myList);
-		outlet_float(x->TempoOutlet, x->comb[0][x->tempoIndex + x->tempoInd1].tempo);
- 
- 
- 
- 		/* Estimate Phase and maxPhase */	
-		m = 0.;
-		cpt = x->comb[0][x->absTempoIndex].curInd;
-		
-		if (x->comb[0][x->absTempoIndex].delay * x->phaselock > x->indexPhase) {
-				
-		for (i=0; i<x->comb[0][x->absTempoIndex].delay * x->phaselock; i++) {
-			phase = 0.;
-			for (j=0; j<x->numBarkBands; j++) {
-				phase += x->comb[j][x->absTempoIndex].output[cpt];			
-			}
-			phase /= x->numBarkBands;
-			
-			if (phase > m) {
-				m = phase;
-				x->indexPhase = i;
-			}
+	systhread_join(x->thread, &ret);
 	
-			if (cpt == x->comb[0][x->absTempoIndex].delay-1) {
-				cpt = 0;
-			} else {
-				cpt++;
-			}
-		}
-		
-		}
+	systhread_mutex_lock(x->mutex);
+	beat_flushFrames(x);
+	x->quit = 0;
+	x->threaded = 0;
+	systhread_mutex_unlock(x->mutex);
+}
 
+// Analyse the queued frames (with the mutex held and no analysis thread)
+void beat_flushFrames(t_beat *x) {
+
+	while (x->frameCount) {
+		beat_takeSettings(x);
+		beat_analyze(x, x->frames + x->frameRead * x->numBarkBands);
+		x->frameRead = (x->frameRead + 1) % FRAMEQUEUE;
+		x->frameCount--;
 	}
-	
-	x->frameCpt++;
-	x->indexPhase--;
+}
 
-	if (x->indexPhase == 0) {
-		if(x->strength > x->thresh) outlet_bang(x->BeatOutlet);
-		x->indexPhase = x->comb[0][x->absTempoIndex].delay;
+// 1: run the comb filters and the tempo estimate in their own thread, so
+// large numbers of resonators and bands don't hold up the scheduler.
+// Outputs are still sent from the scheduler, one frame later. 0: in beat_tick (default).
+void beat_thread(t_beat *x, long n) {
+
+	if ((n != 0) == x->threaded)
+		return;
+	if (!n) {
+		beat_stopThread(x);
+		return;
 	}
-	
- }	
-#endif // __ALTIVEC_
+	systhread_mutex_lock(x->mutex);
+	x->threaded = 1;
+	systhread_mutex_unlock(x->mutex);
+	if (systhread_create((method)beat_worker, x, 0, 0, 0, &x->thread)) {
+		post("Beat~: could not start the analysis thread");
+		systhread_mutex_lock(x->mutex);
+		beat_flushFrames(x);
+		x->threaded = 0;
+		systhread_mutex_unlock(x->mutex);
+	}
+}
 
 // Linear Regression
 int linReg(t_beat *x, double *vector, int numPoints)
@@ -1209,33 +1336,3 @@ void beat_clear(t_beat *x, Symbol *sym)
 	}		
 */
 }
-
-
-// Computes the ceiling of log2(n) 
-// i.e. log2max(7) = 3, log2max(8) = 3, log2max(9) = 4
-long log2max(long n) {
-	
-	long power = 1;
-	long k = 1;
-	
-	if (n==1) return 0;
-	while ((k <<= 1) < n) power++;
-	
-	return power;
-}
-
-double filtEnergy(double *buf, int bufSize, double tempo) 
-{
-	int i;
-	double pwr=0., sum=0.;
-	
-	for(i=0; i<bufSize; i++) {
-		pwr += buf[i]*buf[i];
-	}
-	pwr = sqrt(pwr);
-
-	for(i=0; i<bufSize; i++) {
-		sum += pwr - buf[i];
-	}
-	return (sum/bufSize);
-}
@@ -33,6 +33,7 @@ AUTHORS: John MacCallum
 COPYRIGHT_YEARS: 2006
 SVN_REVISION: $LastChangedRevision: 587 $
 VERSION 0.1: First build--no options yet.
+VERSION 0.2: Analysis moved to the scheduler, any vector size, multichannel (number of inlets as argument)
 @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 */
 
@@ -49,9 +50,11 @@ Some of this code taken from:
 #include "version.c"
 
 #include "z_dsp.h"
+#include "ext_critical.h"
 #include "stdlib.h"
+#include "string.h"
 #include "math.h"
-//#include <fftw3.h>
+#include "cnmat_fft.h"
 
 #define PIx2 6.28318530717958647692
 
@@ -75,14 +78,28 @@ typedef struct FFT_Window_tag
 FFT_Window;                     /* Structure for FFT window (one triangle in
 				   the chained list) */
 
+// The mel filter bank in compressed sparse row form: row i covers the
+// spectrum bins melStart[i] .. melStart[i] + melLength[i] - 1 with the
+// weights stored contiguously from melWeights + melOffset[i].
+typedef struct _mfcc_melbank
+{
+	long numRows;
+	long *melStart;
+	long *melLength;
+	long *melOffset;
+	float *melWeights;
+	float *melCenter;	// center frequency of each row in Hz
+} t_mfcc_melbank;
+
+#define MFCC_MAX_CHANNELS 128
+#define MFCC_NUM_FRAME_SLOTS 4	// frames that can wait for analysis before we start dropping
+
 typedef struct _mfcc
 {
 	t_pxobject c_ob;
 	void *c_out0;
 	void *c_out1;
 	void *c_out2;
-	//fftwf_plan c_dftPlan;
-	//fftw_plan c_dctPlan;
 	float c_fs;
 	long c_windowLength;
 	long c_windowShift;
@@ -92,12 +109,31 @@ typedef struct _mfcc
 	long c_numMelChannels;
 	long c_numCepCoeffs;
 	float c_startingFreq;
-	float *c_buffer;
-	float *c_circBuffer;
+	long c_numChannels;		// number of signal inlets analyzed together
+	
+	// written by the perform routine, handed to mfcc_tick() through schedule_delay()
+	float *c_frameSlots[MFCC_NUM_FRAME_SLOTS];	// c_numChannels frames of c_windowLength samples each
+	volatile long c_slotBusy[MFCC_NUM_FRAME_SLOTS];
+	long c_writeSlot;
+	long c_writePos;
+	long c_skipFrame;
+	long c_droppedFrames;
+	
+	// analysis state, only touched by mfcc_tick() while holding c_lock
+	t_critical c_lock;
+	t_cnmat_fftplan *c_fftPlan;	// Shared FFT plan (see lib/cnmat_fft.h)
+	t_mfcc_melbank c_melBank;
 	float *c_window;
-	float *c_DCTMatrix;
-	FFT_Window c_firstWindow;
-	float c_logEnergy;
+	float *c_DCTMatrixT;	// (c_numCepCoeffs - 1) columns per mel channel
+	float *c_dcState;		// previous input, previous output and previous filtered sample per channel
+	float *c_buffer;		// one frame, spectrum computed in place (cnmat_fft_buffer_new())
+	float *c_melFrames;		// log mel energies, channel fastest
+	float *c_cepFrames;		// cepstra, channel fastest
+	
+	// latest results, read by mfcc_bang()
+	float *c_melOut;
+	float *c_cepOut;
+	float *c_logEnergy;
 } t_mfcc;
 
 void *mfcc_class;
@@ -105,18 +141,18 @@ void *mfcc_class;
 void mfcc_anything(t_mfcc *x, t_symbol *msg, short argc, t_atom *argv);
 void mfcc_bang(t_mfcc *x);
 void mfcc_assist(t_mfcc *x, void *b, long m, long a, char *s);
-void *mfcc_new(void);
+void *mfcc_new(long numChannels);
 void mfcc_init(t_mfcc *x);
 void mfcc_free(t_mfcc *x);
+void mfcc_freeAnalysis(t_mfcc *x);
 t_int *mfcc_perform(t_int *w);
 void mfcc_dsp(t_mfcc *x, t_signal **sp, short *count);
-void mfcc_setupFFTs(t_mfcc *x);
+void mfcc_tick(t_mfcc *x, t_symbol *msg, short argc, t_atom *argv);
+void mfcc_analyzeFrames(t_mfcc *x, float *frames);
 
 // ETSI prototypes
-void DCOffsetFilter( float *CircBuff, int BSize, int *BPointer, int nSamples );
 void InitializeHamming (float *win, int len);
 void Window (float *data, float *win, int len);
-void rfft (float *x, int n, int m);
 void InitFFTWindows (FFT_Window * FirstWin,
                      float StFreq,
                      float SmplFreq,
@@ -124,16 +160,18 @@ void InitFFTWindows (FFT_Window * FirstWin,
                      int NumChannels);
 void ReleaseFFTWindows (FFT_Window *FirstWin );
 void ComputeTriangle (FFT_Window * FirstWin);
-void MelFilterBank (float *SigFFT, FFT_Window * FirstWin);
+int InitMelBank (t_mfcc_melbank *Bank, FFT_Window *FirstWin, float SmplFreq, int FFTLength);
+void ReleaseMelBank (t_mfcc_melbank *Bank);
+void MelFilterBank (float *SigFFT, t_mfcc_melbank *Bank, float *Out, int Stride);
 
 float *InitDCTMatrix (int NumCepstralCoeff, int NumChannels);
-void DCT (float *Data, float *Mx, int NumCepstralCoeff, int NumChannels);
+void DCT (float *Data, float *MxT, float *Out, int NumCepstralCoeff, int NumChannels, int NumFrames);
 
 //--------------------------------------------------------------------------
 
 int main(void)
 {
-	setup((t_messlist **)&mfcc_class, (method)mfcc_new, (method)mfcc_free, (short)sizeof(t_mfcc), 0L, 0); 
+	setup((t_messlist **)&mfcc_class, (method)mfcc_new, (method)mfcc_free, (short)sizeof(t_mfcc), 0L, A_DEFLONG, 0); 
 	
 	version(0);
 
@@ -154,31 +192,41 @@ void mfcc_anything(t_mfcc *x, t_symbol *msg, short argc, t_atom *argv)
 {
 }
 
+// With more than one signal inlet every list starts with the (1-based) channel number.
 void mfcc_bang(t_mfcc *x)
 {
-	t_atom mel_out[(x->c_numMelChannels) * 2];
-	t_atom mfcc_out[(x->c_numCepCoeffs) * 2];
-	double logen_out;
-	int i;
-	for(i = 0; i < (x->c_numCepCoeffs); i++){
-		SETFLOAT(mfcc_out + (i * 2), i);
-		SETFLOAT(mfcc_out + ((i * 2) + 1), x->c_buffer[i + (x->c_numMelChannels)]);
-	}
-	FFT_Window *w = &x->c_firstWindow;
-	for(i = 0; i < x->c_numMelChannels; i++){
-		//post("Channel %d: %f %f (StartingPoint: %d, Length: %d)", i, 
-		//	(x->c_fs / x->c_windowLength) * ((float)w->StartingPoint + ((float)w->Length / 2)), x->c_buffer[i], w->StartingPoint, w->Length);
-		SETFLOAT(mel_out + (i * 2), (x->c_fs / x->c_windowLength) * ((float)w->StartingPoint + ((float)w->Length / 2)));
-		SETFLOAT(mel_out + ((i * 2) + 1), x->c_buffer[i]);
-		w = w->Next;
+	long numMel = x->c_numMelChannels;
+	long numCep = x->c_numCepCoeffs;
+	long offset = x->c_numChannels > 1 ? 1 : 0;
+	t_atom mel_out[numMel * 2 + 1];
+	t_atom mfcc_out[numCep * 2 + 1];
+	t_atom logen_out[2];
+	int i, ch;
+	
+	for(ch = x->c_numChannels - 1; ch >= 0; ch--){
+		critical_enter(x->c_lock);
+		for(i = 0; i < numCep; i++){
+			SETFLOAT(mfcc_out + offset + (i * 2), i);
+			SETFLOAT(mfcc_out + offset + ((i * 2) + 1), x->c_cepOut[ch * numCep + i]);
+		}
+		for(i = 0; i < numMel; i++){
+			SETFLOAT(mel_out + offset + (i * 2), x->c_melBank.melCenter[i]);
+			SETFLOAT(mel_out + offset + ((i * 2) + 1), x->c_melOut[ch * numMel + i]);
+		}
+		SETFLOAT(logen_out + offset, x->c_logEnergy[ch]);
+		critical_exit(x->c_lock);
+		
+		if(offset){
+			SETLONG(mel_out, ch + 1);
+			SETLONG(mfcc_out, ch + 1);
+			SETLONG(logen_out, ch + 1);
+			outlet_list(x->c_out2, 0L, 2, logen_out);
+		}else{
+			outlet_float(x->c_out2, logen_out[0].a_w.w_float);
+		}
+		outlet_list(x->c_out1, 0L, (short)(numCep * 2 + offset), mfcc_out);
+		outlet_list(x->c_out0, 0L, (short)(numMel * 2 + offset), mel_out);
 	}
-	logen_out = (double)x->c_buffer[x->c_numMelChannels + x->c_numCepCoeffs];
-	//for(i = 0; i < x->c_numCepCoeffs; i++)
-	//	post("Coefficient %d: %f", i, x->c_buffer[i + x->c_numMelChannels]);
-	//post("Log Energy: %f", x->c_buffer[x->c_numMelChannels + x->c_numCepCoeffs]);
-	outlet_list(x->c_out0, 0L, (short)((x->c_numMelChannels) * 2), mel_out);
-	outlet_list(x->c_out1, 0L, (short)((x->c_numCepCoeffs) * 2), mfcc_out);
-	outlet_float(x->c_out2, logen_out);
 }
 
 //--------------------------------------------------------------------------
@@ -198,24 +246,34 @@ void mfcc_assist(t_mfcc *x, void *b, long m, long a, char *s)
 			break;
 		}
 	else {
-		sprintf(s,"Signal input");
-		
+		if(x->c_numChannels > 1)
+			sprintf(s,"Signal input %ld", a + 1);
+		else
+			sprintf(s,"Signal input");
 	}
 }
 
 //--------------------------------------------------------------------------
 
-void *mfcc_new(void)
+void *mfcc_new(long numChannels)
 {
 	t_mfcc *x;
+	int i;
+
+	if(numChannels < 1)
+		numChannels = 1;
+	if(numChannels > MFCC_MAX_CHANNELS){
+		error("mfcc~: at most %d channels, using %d", MFCC_MAX_CHANNELS, MFCC_MAX_CHANNELS);
+		numChannels = MFCC_MAX_CHANNELS;
+	}
 
 	x = (t_mfcc *)newobject(mfcc_class); // create a new instance of this object
-	dsp_setup((t_pxobject *)x, 1);
-	x->c_out2 = floatout(x);
+	dsp_setup((t_pxobject *)x, numChannels);
+	x->c_out2 = outlet_new(x, 0L);	// log energy is a list when there are several channels
 	x->c_out1 = listout(x);
 	x->c_out0 = listout(x);
-	//outlet_new((t_pxobject *)x, "signal");
 	
+	x->c_numChannels = numChannels;
 	x->c_windowLength = 512;
 	x->c_windowShift = 512;
 	x->c_preEmphasis = 0.97;
@@ -225,188 +283,288 @@ void *mfcc_new(void)
 	x->c_numCepCoeffs = 13;
 	x->c_startingFreq = 64.f;
 	x->c_fs = sys_getsr();
-	x->c_logEnergy = 0.f;
 	
-	//x->c_dftPlan = NULL;
-	//x->c_dctPlan = NULL;
-	//mfcc_setupFFTs(x);
+	for(i = 0; i < MFCC_NUM_FRAME_SLOTS; i++){
+		x->c_frameSlots[i] = NULL;
+		x->c_slotBusy[i] = 0;
+	}
+	x->c_writeSlot = 0;
+	x->c_writePos = 0;
+	x->c_skipFrame = 0;
+	x->c_droppedFrames = 0;
 	
+	x->c_fftPlan = NULL;
+	x->c_melBank.numRows = 0;
 	x->c_window = NULL;
-	x->c_circBuffer = NULL;
+	x->c_DCTMatrixT = NULL;
+	x->c_dcState = NULL;
 	x->c_buffer = NULL;
+	x->c_melFrames = NULL;
+	x->c_cepFrames = NULL;
+	x->c_melOut = NULL;
+	x->c_cepOut = NULL;
+	x->c_logEnergy = NULL;
+	critical_new(&x->c_lock);
 	mfcc_init(x);
 		
 	return(x);
 }
 
+// (Re)builds everything that depends on the sampling rate and the analysis
+// sizes.  Callers other than mfcc_new() must hold c_lock.
 void mfcc_init(t_mfcc *x){
-	x->c_circBuffer = (float *)realloc(x->c_circBuffer, sizeof(float) * (x->c_windowLength + 2));
-	x->c_buffer = (float *)realloc(x->c_buffer, sizeof(float) * (x->c_windowLength + 2));
-	x->c_window = (float *)realloc(x->c_window, sizeof(float) * (x->c_windowLength));
-	InitializeHamming(x->c_window, (int)x->c_windowLength);
-	InitFFTWindows (&x->c_firstWindow, x->c_startingFreq, x->c_fs, x->c_windowLength, x->c_numMelChannels);
-	ComputeTriangle (&x->c_firstWindow);
-	x->c_DCTMatrix = InitDCTMatrix(x->c_numCepCoeffs, x->c_numMelChannels);
+	long FrameLength = x->c_windowLength;
+	long numCh = x->c_numChannels;
+	FFT_Window firstWindow;
+	int i;
+	
+	mfcc_freeAnalysis(x);
+	
+	for(i = 0; i < MFCC_NUM_FRAME_SLOTS; i++)
+		x->c_frameSlots[i] = (float *)malloc(sizeof(float) * FrameLength * numCh);
+	x->c_buffer = cnmat_fft_buffer_new(FrameLength);
+	x->c_window = (float *)malloc(sizeof(float) * FrameLength);
+	x->c_dcState = (float *)calloc(numCh * 3, sizeof(float));
+	x->c_melFrames = (float *)malloc(sizeof(float) * x->c_numMelChannels * numCh);
+	x->c_cepFrames = (float *)malloc(sizeof(float) * x->c_numCepCoeffs * numCh);
+	x->c_melOut = (float *)calloc(x->c_numMelChannels * numCh, sizeof(float));
+	x->c_cepOut = (float *)calloc(x->c_numCepCoeffs * numCh, sizeof(float));
+	x->c_logEnergy = (float *)calloc(numCh, sizeof(float));
+	
+	InitializeHamming(x->c_window, (int)FrameLength);
+	x->c_fftPlan = cnmat_fft_plan_new(FrameLength, CNMAT_FFT_REAL_FORWARD);
+	if(!x->c_fftPlan)
+		error("mfcc~: no FFT of size %ld (must be a power of two)", FrameLength);
+	InitFFTWindows (&firstWindow, x->c_startingFreq, x->c_fs, FrameLength, x->c_numMelChannels);
+	ComputeTriangle (&firstWindow);
+	InitMelBank (&x->c_melBank, &firstWindow, x->c_fs, FrameLength);
+	ReleaseFFTWindows (&firstWindow);
+	x->c_DCTMatrixT = InitDCTMatrix(x->c_numCepCoeffs, x->c_numMelChannels);
+	
+	x->c_writePos = 0;
+	x->c_skipFrame = 0;
+}
+
+void mfcc_freeAnalysis(t_mfcc *x)
+{
+	int i;
+	for(i = 0; i < MFCC_NUM_FRAME_SLOTS; i++){
+		free(x->c_frameSlots[i]);
+		x->c_frameSlots[i] = NULL;
+	}
+	cnmat_fft_buffer_free(x->c_buffer);
+	x->c_buffer = NULL;
+	free(x->c_window);
+	free(x->c_dcState);
+	free(x->c_melFrames);
+	free(x->c_cepFrames);
+	free(x->c_melOut);
+	free(x->c_cepOut);
+	free(x->c_logEnergy);
+	free(x->c_DCTMatrixT);
+	x->c_DCTMatrixT = NULL;
+	ReleaseMelBank(&x->c_melBank);
+	cnmat_fft_plan_free(x->c_fftPlan);
+	x->c_fftPlan = NULL;
 }
 
 void mfcc_free(t_mfcc *x)
 {
 	dsp_free((t_pxobject *)x);
-	//fftwf_destroy_plan(x->c_dftPlan);
-	free(x->c_circBuffer);
-	free(x->c_DCTMatrix);
-	ReleaseFFTWindows(&x->c_firstWindow);
-	//fftw_destroy_plan(x->c_dctPlan);
+	critical_enter(x->c_lock);
+	mfcc_freeAnalysis(x);
+	critical_exit(x->c_lock);
+	critical_free(x->c_lock);
 }
 
 void mfcc_dsp(t_mfcc *x, t_signal **sp, short *count)
 {
-	x->c_fs = (float)sp[0]->s_sr;
-	dsp_add(mfcc_perform, 3, x, sp[0]->s_vec, sp[0]->s_n);
+	void *w[MFCC_MAX_CHANNELS + 2];
+	int i;
+	
+	if(x->c_fs != (float)sp[0]->s_sr){
+		// the mel bank depends on the sampling rate
+		critical_enter(x->c_lock);
+		x->c_fs = (float)sp[0]->s_sr;
+		mfcc_init(x);
+		critical_exit(x->c_lock);
+	}
+	
+	w[0] = x;
+	w[1] = (void *)(sp[0]->s_n);
+	for(i = 0; i < x->c_numChannels; i++)
+		w[i + 2] = sp[i]->s_vec;
+	dsp_addv(mfcc_perform, x->c_numChannels + 2, w);
 }
 
+// Only collects samples.  Whenever a frame is complete for all channels it
+// is passed to mfcc_tick() in the scheduler, so the analysis itself never
+// runs in the audio thread and no longer depends on the signal vector size.
+// If the scheduler falls behind by more than MFCC_NUM_FRAME_SLOTS frames,
+// frames are dropped and counted in c_droppedFrames.
 t_int *mfcc_perform(t_int *w)
 {
 	t_mfcc *x = (t_mfcc *)w[1];
-	t_float *in = (t_float *)w[2];
-	int signalVectorLength = (int)w[3];
+	long n = (long)w[2];
+	long numCh = x->c_numChannels;
+	long FrameLength = x->c_windowLength;
+	long pos = x->c_writePos;
+	long slot = x->c_writeSlot;
+	long i, ch, todo;
+	t_atom a;
+	
+	if(x->c_ob.z_disabled)
+		return w + numCh + 3;
+	
+	for(i = 0; i < n; i += todo){
+		if(pos == 0)
+			x->c_skipFrame = x->c_slotBusy[slot];
+		todo = FrameLength - pos;
+		if(todo > n - i)
+			todo = n - i;
+		if(!x->c_skipFrame){
+			for(ch = 0; ch < numCh; ch++)
+				memcpy(x->c_frameSlots[slot] + ch * FrameLength + pos, (t_float *)w[ch + 3] + i, todo * sizeof(float));
+		}
+		pos += todo;
+		if(pos == FrameLength){
+			if(x->c_skipFrame){
+				x->c_droppedFrames++;
+			}else{
+				x->c_slotBusy[slot] = 1;
+				SETLONG(&a, slot);
+				schedule_delay(x, (method)mfcc_tick, 0, NULL, 1, &a);
+				slot = (slot + 1) % MFCC_NUM_FRAME_SLOTS;
+			}
+			pos = 0;
+		}
+	}
+	x->c_writePos = pos;
+	x->c_writeSlot = slot;
 	
-	int i, j, TmpInt, CFBSize, CFBPointer;
+	return (w + numCh + 3);
+}
+
+void mfcc_tick(t_mfcc *x, t_symbol *msg, short argc, t_atom *argv)
+{
+	long slot = argv[0].a_w.w_long;
+	
+	critical_enter(x->c_lock);
+	if(x->c_frameSlots[slot])
+		mfcc_analyzeFrames(x, x->c_frameSlots[slot]);
+	critical_exit(x->c_lock);
+	x->c_slotBusy[slot] = 0;
+}
 
+// Analyzes one frame of every channel.  Each channel is filtered, windowed,
+// transformed and mel-filtered on its own; the DCT is then done for all
+// channels at once.
+void mfcc_analyzeFrames(t_mfcc *x, float *frames)
+{
+	int i, ch;
+	long numCh = x->c_numChannels;
+	long numMel = x->c_numMelChannels;
+	long numCep = x->c_numCepCoeffs;
 	long FrameLength = x->c_windowLength;
-	long FrameShift = x->c_windowShift;
 	long FFTLength = x->c_windowLength;
-
-    float LogEnergy = x->c_logEnergy;
-	  
 	float EnergyFloor_FB = x->c_energyFloor_FB;
 	float EnergyFloor_logE = x->c_energyFloor_logE;
 	float *FloatBuffer = x->c_buffer;
-	float *FloatWindow = x->c_window;
-	float *pDCTMatrix = x->c_DCTMatrix;
-	float *CircFloatBuffer = x->c_circBuffer;
-	
-    FFT_Window FirstWindow = x->c_firstWindow;
-	
-    //EnergyFloor_FB = expf(ENERGYFLOOR_FB);
-    //EnergyFloor_logE = expf(ENERGYFLOOR_logE);
-	
-	CFBSize = FrameLength + 2;
-	CircFloatBuffer[0] = 0.0;
-	CircFloatBuffer[1] = 0.0;
-	CFBPointer = 0;
-
-	//ReadWave(fp_in, CircFloatBuffer, CFBSize, CFBPointer+2, FrameLength-FrameShift, (SwapSpecified || InputByteOrder != NativeByteOrder));
+	float LogEnergy, Nyquist;
 	
-	DCOffsetFilter( CircFloatBuffer, CFBSize, &CFBPointer, FrameLength-FrameShift );
+	if(!x->c_fftPlan || !FloatBuffer)
+		return;
 	
-	//while (ReadWave (fp_in, CircFloatBuffer, CFBSize, (CFBPointer+2)%CFBSize, FrameShift, (SwapSpecified || InputByteOrder != NativeByteOrder)))
-    //    {
-	
-	for(j = 0; j < (int)round(signalVectorLength / FrameLength); j++){
+	for(ch = 0; ch < numCh; ch++){
+		float *frame = frames + ch * FrameLength;
+		float *state = x->c_dcState + ch * 3;
+		float xprev = state[0], yprev = state[1], prev = state[2], in;
+		
+		//---------------------------------------------------
+		// DC offset removal, y[n]=x[n]-x[n-1]+0.999*y[n-1] --
+		//---------------------------------------------------
+		for (i = 0; i < FrameLength; i++){
+			in = frame[i];
+			yprev = in - xprev + 0.999 * yprev;
+			xprev = in;
+			FloatBuffer[i] = yprev;
+		}
 		
-		for(i = 0; i < FrameLength; i++)
-			CircFloatBuffer[i] = in[i + (j * FrameLength)];
-	
-		//---------------------
-		// DC offset removal --
-		//---------------------
-		DCOffsetFilter( CircFloatBuffer, CFBSize, &CFBPointer, FrameShift );
-	
 		//--------------------
 		// logE computation --
 		//--------------------
 		LogEnergy = 0.0;
 		for (i = 0; i < FrameLength; i++)
-			LogEnergy += CircFloatBuffer[(CFBPointer+i+3)%CFBSize] * CircFloatBuffer[(CFBPointer+i+3)%CFBSize];
-
+			LogEnergy += FloatBuffer[i] * FloatBuffer[i];
 		if (LogEnergy < EnergyFloor_logE)
 			LogEnergy = EnergyFloor_logE;
 		else
 			LogEnergy = logf(LogEnergy);
 		
-		//-------------------------------------------------------
-		// Pre-emphasis, moving from circular to linear buffer --
-		//-------------------------------------------------------
-		for (i = 0; i < FrameLength; i++)
-			FloatBuffer[i] = CircFloatBuffer[(CFBPointer + i + 3) % CFBSize] - x->c_preEmphasis * CircFloatBuffer[(CFBPointer + i + 2) % CFBSize];
+		//-----------------
+		// Pre-emphasis --
+		//-----------------
+		state[0] = xprev;
+		state[1] = yprev;
+		state[2] = FloatBuffer[FrameLength - 1];
+		for (i = FrameLength - 1; i > 0; i--)
+			FloatBuffer[i] -= x->c_preEmphasis * FloatBuffer[i - 1];
+		FloatBuffer[0] -= x->c_preEmphasis * prev;
 		
 		//-------------
 		// Windowing --
 		//-------------
-		Window (FloatBuffer, FloatWindow, (int)FrameLength);
-
+		Window (FloatBuffer, x->c_window, (int)FrameLength);
+		
 		//-------
 		// FFT --
 		//-------
-
-		// Zero padding --
-		for (i = FrameLength; i < FFTLength; i++)
-			FloatBuffer[i] = 0.0;
 		
-		//x->c_tmpArray = (float *)memcpy(x->c_tmpArray, FloatBuffer, x->c_windowLength * sizeof(float));
-		//for(i = 0; i < x->c_windowLength; i++)
-		//	x->c_tmpArray[i] = FloatBuffer[i];
+		// Real valued, in-place FFT: DC, Nyquist, then Re, Im of each bin --
+		cnmat_fft_execute(x->c_fftPlan, FloatBuffer);
 		
-		// Real valued, in-place split-radix FFT --
-		TmpInt = (int) (log10 (FFTLength) / log10 (2));
-		rfft (FloatBuffer, FFTLength, TmpInt); //TmpInt = log2(FFTLength)--
-		
-		// Magnitude spectrum --
+		// Magnitude spectrum, bin i ends up in FloatBuffer[i] --
+		Nyquist = fabsf(FloatBuffer[1]);
 		FloatBuffer[0] = fabsf(FloatBuffer[0]);  // DC --
 		// pi/(N/2), 2pi/(N/2), ...,(N/2-1)*pi/(N/2) --
 		for (i = 1; i < FFTLength / 2; i++)  
-			FloatBuffer[i] = sqrtf(FloatBuffer[i] * FloatBuffer[i] + FloatBuffer[FFTLength - i] * FloatBuffer[FFTLength - i]);
-		FloatBuffer[FFTLength / 2] = fabsf(FloatBuffer[FFTLength / 2]);  // pi/2 --
-
+			FloatBuffer[i] = sqrtf(FloatBuffer[2 * i] * FloatBuffer[2 * i] + FloatBuffer[2 * i + 1] * FloatBuffer[2 * i + 1]);
+		FloatBuffer[FFTLength / 2] = Nyquist;  // pi/2 --
+		
 		//-----------------
 		// Mel filtering --
 		//-----------------
-		MelFilterBank (FloatBuffer, &FirstWindow);
-
+		MelFilterBank (FloatBuffer, &x->c_melBank, x->c_melFrames + ch, numCh);
+		
 		//---------------------------------
 		// Natural logarithm computation --
 		//---------------------------------
-		for (i = 0; i < x->c_numMelChannels; i++){
-			if (FloatBuffer[i] < EnergyFloor_FB)
-				FloatBuffer[i] = EnergyFloor_FB;
+		for (i = 0; i < numMel; i++){
+			float *e = x->c_melFrames + i * numCh + ch;
+			if (*e < EnergyFloor_FB)
+				*e = EnergyFloor_FB;
 			else
-				FloatBuffer[i] = logf(FloatBuffer[i]);
+				*e = logf(*e);
 		}
-
-		//-----------------------------
-		// Discrete Cosine Transform --
-		//-----------------------------
-		DCT(FloatBuffer, pDCTMatrix, x->c_numCepCoeffs, x->c_numMelChannels);
-
-		//----------------------------------------
-		// Append logE after c0 or overwrite c0 --
-		//----------------------------------------
-		BOOLEAN Noc0 = FALSE;
-		FloatBuffer[x->c_numMelChannels + x->c_numCepCoeffs - (Noc0 ? 1:0)] = LogEnergy;
 		
+		x->c_logEnergy[ch] = LogEnergy;
 	}
 	
-	return (w + 4);
-}
-
-void mfcc_setupFFTs(t_mfcc *x)
-{
-	/*
-	x->c_buffer = (float *)realloc(x->c_buffer, x->c_windowLength * sizeof(float));
-	if(x->c_dftPlan){
-		fftwf_destroy_plan(x->c_dftPlan);
-	}
-	x->c_dftPlan = fftwf_plan_r2r_1d(x->c_windowLength, x->c_buffer, x->c_buffer, FFTW_R2HC, FFTW_ESTIMATE);
-	*/
-	/*
-	if(x->c_dctPlan){
-		fftw_destroy_plan(x->c_dctPlan);
+	//-----------------------------
+	// Discrete Cosine Transform --
+	//-----------------------------
+	DCT(x->c_melFrames, x->c_DCTMatrixT, x->c_cepFrames, numCep, numMel, numCh);
+	
+	for(ch = 0; ch < numCh; ch++){
+		for(i = 0; i < numMel; i++)
+			x->c_melOut[ch * numMel + i] = x->c_melFrames[i * numCh + ch];
+		for(i = 0; i < numCep; i++)
+			x->c_cepOut[ch * numCep + i] = x->c_cepFrames[i * numCh + ch];
 	}
-	x->c_dctPlan = fftw_plan_r2r_1d(x->c_windowSize, x->c_tmpArray, x->c_tmpArray, FFTW_REDFT10, FFTW_ESTIMATE);
-	*/
 }
 
+//--------------------------------------------------------------------------
+
 /*---------------------------------------------------------------------------
 The following code was taken from:
 	ETSI STQ WI007 DSR Front-End Feature Extraction Algorithm
@@ -415,39 +573,6 @@ The following code was taken from:
 	www.etsi.org
 ---------------------------------------------------------------------------*/
 
-/*---------------------------------------------------------------------------
- * FUNCTION NAME: DCOffsetFilter
- *
- * PURPOSE:       DC offset removal from speech waveform
- *
- * INPUT:
- *   CircBuff     Pointer to input circular buffer
- *   BSize        Buffer size
- *   BPointer     Pointer to buffer pointer
- *   nSamples     Number of samples to be filtered
- *
- * OUTPUT
- *                Filtered data in the circular buffer
- *                last output sample pointed by the buffer pointer
- *
- * RETURN VALUE
- *   none
- *---------------------------------------------------------------------------*/
-void
-DCOffsetFilter( float *CircBuff, int BSize, int *BPointer, int nSamples )
-{
-  int i;
-
-  for ( i=0; i<nSamples; i++ )
-    {
-      /* y[n]=x[n]-x[n-1]+0.999*y[n-1] */
-      CircBuff[(*BPointer+1)%BSize]=CircBuff[(*BPointer+2)%BSize]-
-	CircBuff[(*BPointer+1)%BSize]+0.999*CircBuff[*BPointer];
-      *BPointer=(*BPointer+1)%BSize;
-    }
-}
-
-
 /*---------------------------------------------------------------------------
  * FUNCTION NAME: InitializeHamming
  *
@@ -502,179 +627,6 @@ Window (float *data, float *win, int len)
         data[i] *= win[len - 1 - i];
 }
 
-/*---------------------------------------------------------------------------
- * FUNCTION NAME: rfft
- *
- * PURPOSE:       Real valued, in-place split-radix FFT
- *
- * INPUT:
- *   x            Pointer to input and output array
- *   n            Length of FFT, must be power of 2
- *
- * OUTPUT         Output order
- *                  Re(0), Re(1), ..., Re(n/2), Im(N/2-1), ..., Im(1)
- *
- * RETURN VALUE
- *   none
- *
- * DESIGN REFERENCE:
- *                IEEE Transactions on Acoustic, Speech, and Signal Processing,
- *                Vol. ASSP-35. No. 6, June 1987, pp. 849-863.
- *
- *                Subroutine adapted from fortran routine pp. 858-859.
- *                Note corrected printing errors on page 859:
- *                    SS1 = SIN(A3) -> should be SS1 = SIN(A);
- *                    CC3 = COS(3)  -> should be CC3 = COS(A3)
- *---------------------------------------------------------------------------*/
-void 
-rfft (float *x, int n, int m)
-{
-    int j, i, k, is, id;
-    int i0, i1, i2, i3, i4, i5, i6, i7, i8;
-    int n2, n4, n8;
-    float xt, a0, e, a, a3;
-    float t1, t2, t3, t4, t5, t6;
-    float cc1, ss1, cc3, ss3;
-    float *r0;
-
-    /* Digit reverse counter */
-
-    j = 0;
-    r0 = x;
-
-    for (i = 0; i < n - 1; i++)
-    {
-
-        if (i < j)
-        {
-            xt = x[j];
-            x[j] = *r0;
-            *r0 = xt;
-        }
-        r0++;
-
-        k = n >> 1;
-
-        while (k <= j)
-        {
-            j = j - k;
-            k >>= 1;
-        }
-        j += k;
-    }
-
-    /* Length two butterflies */
-    is = 0;
-    id = 4;
-
-    while (is < n - 1)
-    {
-
-        for (i0 = is; i0 < n; i0 += id)
-        {
-            i1 = i0 + 1;
-            a0 = x[i0];
-            x[i0] += x[i1];
-            x[i1] = a0 - x[i1];
-        }
-
-        is = (id << 1) - 2;
-        id <<= 2;
-    }
-
-    /* L shaped butterflies */
-    n2 = 2;
-    for (k = 1; k < m; k++)
-    {
-        n2 <<= 1;
-        n4 = n2 >> 2;
-        n8 = n2 >> 3;
-        e = (M_PI * 2) / n2;
-        is = 0;
-        id = n2 << 1;
-        while (is < n)
-        {
-            for (i = is; i <= n - 1; i += id)
-            {
-                i1 = i;
-                i2 = i1 + n4;
-                i3 = i2 + n4;
-                i4 = i3 + n4;
-                t1 = x[i4] + x[i3];
-                x[i4] -= x[i3];
-                x[i3] = x[i1] - t1;
-                x[i1] += t1;
-
-                if (n4 != 1)
-                {
-                    i1 += n8;
-                    i2 += n8;
-                    i3 += n8;
-                    i4 += n8;
-                    t1 = (x[i3] + x[i4]) / M_SQRT2;
-                    t2 = (x[i3] - x[i4]) / M_SQRT2;
-                    x[i4] = x[i2] - t1;
-                    x[i3] = -x[i2] - t1;
-                    x[i2] = x[i1] - t2;
-                    x[i1] = x[i1] + t2;
-                }
-            }
-            is = (id << 1) - n2;
-            id <<= 2;
-        }
-
-        for (j = 1; j < n8; j++)
-        {
-            a = j * e;
-            a3 = 3 * a;
-            cc1 = cos (a);
-            ss1 = sin (a);
-            cc3 = cos (a3);
-            ss3 = sin (a3);
-
-            is = 0;
-            id = n2 << 1;
-
-            while (is < n)
-            {
-                for (i = is; i <= n - 1; i += id)
-                {
-                    i1 = i + j;
-                    i2 = i1 + n4;
-                    i3 = i2 + n4;
-                    i4 = i3 + n4;
-                    i5 = i + n4 - j;
-                    i6 = i5 + n4;
-                    i7 = i6 + n4;
-                    i8 = i7 + n4;
-                    t1 = x[i3] * cc1 + x[i7] * ss1;
-                    t2 = x[i7] * cc1 - x[i3] * ss1;
-                    t3 = x[i4] * cc3 + x[i8] * ss3;
-                    t4 = x[i8] * cc3 - x[i4] * ss3;
-                    t5 = t1 + t3;
-                    t6 = t2 + t4;
-                    t3 = t1 - t3;
-                    t4 = t2 - t4;
-                    t2 = x[i6] + t6;
-                    x[i3] = t6 - x[i6];
-                    x[i8] = t2;
-                    t2 = x[i2] - t3;
-                    x[i7] = -x[i2] - t3;
-                    x[i4] = t2;
-                    t1 = x[i1] + t5;
-                    x[i6] = x[i1] - t5;
-                    x[i1] = t1;
-                    t1 = x[i5] + t4;
-                    x[i5] = x[i5] - t4;
-                    x[i2] = t1;
-                }
-                is = (id << 1) - n2;
-                id <<= 2;
-            }
-        }
-    }
-}
-
 /*---------------------------------------------------------------------------
  * FUNCTION NAME: InitFFTWindows
  *
@@ -828,42 +780,105 @@ ComputeTriangle (FFT_Window * FirstWin)
     return;
 }
 
+/*---------------------------------------------------------------------------
+ * FUNCTION NAME: InitMelBank
+ *
+ * PURPOSE:       Packs the chained list of FFT windows into a compressed
+ *                sparse matrix, so that filtering walks one contiguous
+ *                array of weights
+ *
+ * INPUT:
+ *   Bank         Pointer to the mel bank to fill in
+ *   FirstWin     Pointer to first FFT window structure, with coefficients
+ *                computed by ComputeTriangle
+ *   SmplFreq     Sampling frequency
+ *   FFTLength    FFT length
+ *
+ * OUTPUT
+ *                Mel bank rows, weights and center frequencies
+ *
+ * RETURN VALUE
+ *                Number of rows
+ *---------------------------------------------------------------------------*/
+int
+InitMelBank (t_mfcc_melbank *Bank, FFT_Window *FirstWin, float SmplFreq, int FFTLength)
+{
+    FFT_Window *p1;
+    int i, j, NumRows = 0, NumWeights = 0;
+
+    for (p1 = FirstWin; p1; p1 = p1->Next)
+    {
+        NumRows++;
+        NumWeights += p1->Length;
+    }
+
+    Bank->numRows = NumRows;
+    Bank->melStart = (long *) malloc (sizeof (long) * NumRows);
+    Bank->melLength = (long *) malloc (sizeof (long) * NumRows);
+    Bank->melOffset = (long *) malloc (sizeof (long) * NumRows);
+    Bank->melCenter = (float *) malloc (sizeof (float) * NumRows);
+    Bank->melWeights = (float *) malloc (sizeof (float) * NumWeights);
+
+    NumWeights = 0;
+    for (p1 = FirstWin, j = 0; p1; p1 = p1->Next, j++)
+    {
+        Bank->melStart[j] = p1->StartingPoint;
+        Bank->melLength[j] = p1->Length;
+        Bank->melOffset[j] = NumWeights;
+        Bank->melCenter[j] = (SmplFreq / FFTLength) * ((float)p1->StartingPoint + ((float)p1->Length / 2));
+        for (i = 0; i < p1->Length; i++)
+            Bank->melWeights[NumWeights++] = p1->Data[i];
+    }
+    return NumRows;
+}
+
+void
+ReleaseMelBank (t_mfcc_melbank *Bank)
+{
+    if (Bank->numRows == 0)
+        return;
+    free (Bank->melStart);
+    free (Bank->melLength);
+    free (Bank->melOffset);
+    free (Bank->melCenter);
+    free (Bank->melWeights);
+    Bank->numRows = 0;
+}
+
 /*---------------------------------------------------------------------------
  * FUNCTION NAME: MelFilterBank
  *
  * PURPOSE:       Performs mel filtering on FFT magnitude spectrum using the
- *                filter bank defined by a chained list of FFT window
- *                structures
+ *                filter bank in compressed sparse form
  *
  * INPUT:
  *   SigFFT       Pointer to signal FFT magnitude spectrum
- *   FirstWin     Pointer to the first channel of the filter bank (first
- *                element in the chained list of FFT window data structures)
+ *   Bank         Mel bank built by InitMelBank
+ *   Out          Where to store the first filter bank output
+ *   Stride       Distance between consecutive outputs, so that the
+ *                outputs of several channels can be interleaved
  *
  * OUTPUT
- *                Filter bank outputs stored at the beginning of input signal
- *                FFT buffer pointed by *SigFFT*
+ *                Filter bank outputs stored at Out[0], Out[Stride], ...
  *
  * RETURN VALUE
  *   none
  *---------------------------------------------------------------------------*/
 void 
-MelFilterBank (float *SigFFT, FFT_Window * FirstWin)
+MelFilterBank (float *SigFFT, t_mfcc_melbank *Bank, float *Out, int Stride)
 {
-    FFT_Window *p1;
     float Sum;
     int i, j;
 
-    p1 = FirstWin;
-    j = 0;
-    while (p1)
+    for (j = 0; j < Bank->numRows; j++)
     {
+        const float *spec = SigFFT + Bank->melStart[j];
+        const float *weights = Bank->melWeights + Bank->melOffset[j];
+        int len = Bank->melLength[j];
         Sum = 0.0;
-        for (i = 0; i < p1->Length; i++)
-            Sum += SigFFT[p1->StartingPoint + i] * p1->Data[i];
-        SigFFT[j] = Sum;
-        j++;
-        p1 = p1->Next;
+        for (i = 0; i < len; i++)
+            Sum += spec[i] * weights[i];
+        Out[j * Stride] = Sum;
     }
     return;
 }
@@ -872,10 +887,12 @@ MelFilterBank (float *SigFFT, FFT_Window * FirstWin)
  * FUNCTION NAME: InitDCTMatrix
  *
  * PURPOSE:       Initializes matrix for DCT computation (DCT is implemented
- *                as matrix-vector multiplication). The DCT matrix is of size
- *                (NumCepstralCoeff-1)-by-NumChannels. The zeroth cepstral
+ *                as matrix-vector multiplication). The DCT matrix is stored
+ *                transposed, as NumChannels rows of (NumCepstralCoeff-1)
+ *                entries, so that DCT() can run its inner loops over
+ *                contiguous memory. The zeroth cepstral
  *                coefficient is computed separately (needing NumChannels
- *                additions and only one multiplication), so the zeroth row
+ *                additions and only one multiplication), so the zeroth column
  *                of DCT matrix corresponds to the first DCT basis vector, the
  *                first one to the second one, and so on up to
  *                NumCepstralCoeff-1.
@@ -904,7 +921,7 @@ InitDCTMatrix (int NumCepstralCoeff, int NumChannels)
     /* Computing matrix entries */
     for (i = 1; i < NumCepstralCoeff; i++)
         for (j = 0; j < NumChannels; j++)
-            Mx[(i - 1) * NumChannels + j] = cos (M_PI * (float) i /
+            Mx[j * (NumCepstralCoeff - 1) + (i - 1)] = cos (M_PI * (float) i /
 						 (float) NumChannels
 						 * ((float) j + 0.5));
     return Mx;
@@ -915,45 +932,68 @@ InitDCTMatrix (int NumCepstralCoeff, int NumChannels)
  *
  * PURPOSE:       Computes DCT transformation of filter bank outputs, results
  *                in cepstral coefficients. The DCT transformation is
- *                implemented as matrix-vector multiplication. The zeroth
- *                cepstral coefficient is computed separately and appended.
- *                Final cepstral coefficient order is c1, c2, ...,c12, c0. The
- *                output is stored right after the input values in the memory.
- *                Since the mel filter bank outputs are stored at the beginning
- *                of the FFT magnitude array it shouldn`t cause any problems.
- *                Some memory saving can be done this way.
+ *                implemented as matrix-matrix multiplication over a batch of
+ *                frames (one per input channel). The zeroth cepstral
+ *                coefficient is computed separately and appended.
+ *                Final cepstral coefficient order is c1, c2, ...,c12, c0.
+ *                Inputs and outputs are interleaved, frame index fastest, so
+ *                that with several frames the innermost loop is a
+ *                contiguous multiply-add over the batch; with one frame it
+ *                runs over the coefficients instead. Both forms are left
+ *                for the compiler to vectorize.
  *
  * INPUT:
- *   Data         Pointer to input data buffer (filter bank outputs)
- *   Mx           Pointer to DCT matrix
+ *   Data         Filter bank outputs, Data[j * NumFrames + f]
+ *   MxT          Transposed DCT matrix from InitDCTMatrix
+ *   Out          Cepstral coefficients, Out[(i - 1) * NumFrames + f] for
+ *                c1..c/NumCepstralCoeff-1/, then c0
  *   NumCepstralCoeff
  *                Number of cepstral coefficients
  *   NumChannels  Number of filter bank channels
+ *   NumFrames    Number of frames in the batch
  *
  * OUTPUT
- *                Cepstral coefficients stored after the input filter bank
- *                values pointed to by *Data*
+ *                Cepstral coefficients stored in *Out*
  *
  * RETURN VALUE
  *   none
  *---------------------------------------------------------------------------*/
 void 
-DCT (float *Data, float *Mx, int NumCepstralCoeff, int NumChannels)
+DCT (float *Data, float *MxT, float *Out, int NumCepstralCoeff, int NumChannels, int NumFrames)
 {
-    int i, j;
+    int i, j, f;
+    int NumRows = NumCepstralCoeff - 1;
+    float *c0 = Out + NumRows * NumFrames;
 
-    /* Computing c1..c/NumCepstralCoeff-1/, storing result after the incoming
-       data vector */
-    for (i = 1; i < NumCepstralCoeff; i++)
+    for (i = 0; i < NumCepstralCoeff * NumFrames; i++)
+        Out[i] = 0.0;
+
+    if (NumFrames == 1)
     {
-        Data[NumChannels + (i - 1)] = 0.0;
         for (j = 0; j < NumChannels; j++)
-            Data[NumChannels + (i - 1)] += Data[j] * Mx[(i - 1) * NumChannels + j];
+        {
+            float d = Data[j];
+            const float *mx = MxT + j * NumRows;
+            for (i = 0; i < NumRows; i++)
+                Out[i] += d * mx[i];
+            *c0 += d;
+        }
+        return;
     }
 
-    /* Computing c0, as the last element of output vector */
-    Data[NumChannels + NumCepstralCoeff - 1] = 0.0;
-    for (i = 0; i < NumChannels; i++)
-        Data[NumChannels + NumCepstralCoeff - 1] += Data[i];
+    for (j = 0; j < NumChannels; j++)
+    {
+        const float *d = Data + j * NumFrames;
+        const float *mx = MxT + j * NumRows;
+        for (i = 0; i < NumRows; i++)
+        {
+            float m = mx[i];
+            float *o = Out + i * NumFrames;
+            for (f = 0; f < NumFrames; f++)
+                o[f] += m * d[f];
+        }
+        for (f = 0; f < NumFrames; f++)
+            c0[f] += d[f];
+    }
     return;
 }
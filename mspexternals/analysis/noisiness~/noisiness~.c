@@ -1,14 +1,9 @@
 #include "ext.h"
 #include "z_dsp.h"
-#include "fft.h"
+#include "cnmat_fft.h"
 #include <string.h>
 #include <math.h>
 
-// Add altivec function prototypes
-#ifdef __ALTIVEC__
-#include "vDSP.h"
-#endif
-
 #define RES_ID	7080
 #define VERSION "1.3"
 #define NUMBAND 25 // at 44100 Hz only
@@ -56,7 +51,7 @@ typedef struct _noisiness {
     t_int *Buf2;			// buffer 2
     t_float *BufFFT;		// FFT buffer
     t_float *WindFFT;		// Window of FFTSize
-    t_float *memFFT;		// fftnobitrev.c memory space
+    t_cnmat_fftplan *fftplan;	// Shared FFT plan (see lib/cnmat_fft.h)
 
     t_int BufSize;			// FFT buffer size
 	t_int FFTSize;			// Size of FFT
@@ -69,13 +64,6 @@ typedef struct _noisiness {
 	void *x_outnois;		// Outlet for the noisiness
 	void *x_clock;			// Use a clock for outputs... (better than Qelem)
 
-#ifdef __ALTIVEC__ // Additional stuff for managing the G4-optimized FFT by Apple
-#pragma altivec_model on
-	UInt32 x_log2n;
-    COMPLEX_SPLIT x_A;
-	FFTSetup x_setup;
-#pragma altivec_model off
-#endif
 				
 } t_noisiness;
 
@@ -95,11 +83,6 @@ void *noisiness_new(t_symbol *s, short argc, t_atom *argv);
 void noisiness_free(t_noisiness *x);
 void noisiness_tick(t_noisiness *x);
 
-#ifdef __ALTIVEC__
-void noisiness_tick_G4(t_noisiness *x);
-long log2max(long n);
-#endif
-
 void main(void) {
 
     post("Noisiness~ object version " VERSION " by Tristan Jehan (Media Laboratory)");
@@ -189,6 +172,7 @@ void noisiness_dsp(t_noisiness *x, t_signal **sp, short *connect) {
 	x->x_counter = x->x_delay;
 
 	if (vs > x->BufSize) post("Noisiness~: You need to use a smaller signal vector size...");
+	else if (x->fftplan == NULL || x->BufFFT == NULL) error("Noisiness~: no FFT, not analyzing");
 	else if (connect[0]) dsp_add(noisiness_perform, 3, sp[0]->s_vec, x, sp[0]->s_n);
 }
 
@@ -397,6 +381,7 @@ void *noisiness_new(t_symbol *s, short argc, t_atom *argv) {
 	else if ((x->FFTSize > 512) && (x->FFTSize < 1024)) x->FFTSize = 1024;
 	else if ((x->FFTSize > 1024) && (x->FFTSize < 2048)) x->FFTSize = 2048;
 	else if ((x->FFTSize > 2048) && (x->FFTSize < 4096)) x->FFTSize = 4096;
+	else if ((x->FFTSize > 4096) && (x->FFTSize < 8192)) x->FFTSize = 8192;
 	else if ((x->FFTSize > 8192) && (x->FFTSize < 16384)) x->FFTSize = 16384;
 	else if ((x->FFTSize > 16384) && (x->FFTSize < 32768)) x->FFTSize = 32768;
 	else if ((x->FFTSize > 32768) && (x->FFTSize < 65536)) x->FFTSize = 65536;
@@ -404,6 +389,11 @@ void *noisiness_new(t_symbol *s, short argc, t_atom *argv) {
 		post("Noisiness~: Maximum FFT size is 65536 samples");
 		x->FFTSize = 65536;
 	}
+	if (x->FFTSize & (x->FFTSize - 1)) { // cnmat_fft only does powers of two
+		for (i = CNMAT_FFT_MINSIZE; i < x->FFTSize; i <<= 1);
+		post("Noisiness~: FFT size rounded up to %d", i);
+		x->FFTSize = i;
+	}
 	
 	// Overlap case
 	if (x->x_overlap > x->BufSize-vs) {
@@ -421,34 +411,16 @@ void *noisiness_new(t_symbol *s, short argc, t_atom *argv) {
 	post("	Window type = %s",x->x_winName);
 	post("	Initial delay = %d",x->x_delay);
 
-	// Here comes the choice for altivec optimization or not...
-	if (sys_optimize()) { // note that we DON'T divide the vector size by four here
-
-#ifdef __ALTIVEC__ // More code and a new ptr so that x->BufFFT is vector aligned.
-#pragma altivec_model on 
-		x->x_clock = clock_new(x,(method)noisiness_tick_G4); // Call altivec-optimized tick function
-		post("	Using G4-optimized FFT");	
-		// Allocate some memory for the altivec FFT
-		x->x_FFTSizeOver2 = x->FFTSize/2;		
-		x->x_A.realp = t_getbytes(x->x_FFTSizeOver2 * sizeof(t_float));
-		x->x_A.imagp = t_getbytes(x->x_FFTSizeOver2 * sizeof(t_float));
-		x->x_log2n = log2max(x->FFTSize);
-      	x->x_setup = create_fftsetup (x->x_log2n, 0);
-#pragma altivec_model off
-#else
-		error("  No G4 optimization available");
-#endif
-
-	} else { // Normal tick function
-		x->x_clock = clock_new(x,(method)noisiness_tick);
-		x->memFFT = (t_float*) NewPtr(CMAX * x->FFTSize * sizeof(t_float)); // memory allocated for normal fft twiddle
-	}
+	x->x_clock = clock_new(x,(method)noisiness_tick);
+	x->fftplan = cnmat_fft_plan_new(x->FFTSize, CNMAT_FFT_REAL_FORWARD);
+	if (x->fftplan == NULL)
+		error("Noisiness~: can't make an FFT of size %d", x->FFTSize);
 	post("");
 
 	// Allocate memory
 	x->Buf1 = (t_int*) NewPtr(x->BufSize * sizeof(t_float)); // Careful these are pointers to integers but the content is floats
 	x->Buf2 = (t_int*) NewPtr(x->BufSize * sizeof(t_float));
-	x->BufFFT = (t_float*) NewPtr(x->FFTSize * sizeof(t_float));
+	x->BufFFT = cnmat_fft_buffer_new(x->FFTSize);
 	x->WindFFT = (t_float*) NewPtr(x->BufSize * sizeof(t_float));
 
 	if (x->x_Fs != DEFAULT_FS) {
@@ -517,18 +489,10 @@ void  noisiness_free(t_noisiness *x) {
 
 	dsp_free((t_pxobject *)x);
 	
-#ifdef __ALTIVEC__
-#pragma altivec_model on
-	if (x->x_A.realp) t_freebytes(x->x_A.realp, x->x_FFTSizeOver2);
-	if (x->x_A.imagp) t_freebytes(x->x_A.imagp, x->x_FFTSizeOver2);
-	if (x->x_setup) destroy_fftsetup(x->x_setup);
-#pragma altivec_model off
-#else
-	if (x->memFFT != NULL) DisposePtr((char *) x->memFFT);
-#endif		
+	cnmat_fft_plan_free(x->fftplan);
 	if (x->Buf1 != NULL) DisposePtr((char *) x->Buf1);
 	if (x->Buf2 != NULL) DisposePtr((char *) x->Buf2);
-	if (x->BufFFT != NULL) DisposePtr((char *) x->BufFFT);
+	if (x->BufFFT != NULL) cnmat_fft_buffer_free(x->BufFFT);
 	if (x->WindFFT != NULL) DisposePtr((char *) x->WindFFT);
 	if (x->x_clock != NULL) freeobject((t_object *)x->x_clock);
 	if (x->BufBark != NULL) DisposePtr((char *) x->BufBark);
@@ -553,7 +517,7 @@ void noisiness_tick(t_noisiness *x) {
 			x->BufFFT[i] *= x->WindFFT[i];
 			
 	// FFT
-	fftRealfast(x->FFTSize, x->BufFFT, x->memFFT);
+	cnmat_fft_execute(x->fftplan, x->BufFFT);
 		
 	// Squared Absolute
 	for (i=0; i<x->FFTSize; i+=2) 
@@ -591,83 +555,3 @@ void noisiness_tick(t_noisiness *x) {
 	// Output result
     outlet_float(x->x_outnois, (1.0 - x->x_noisiness));
  }	
-
-#ifdef __ALTIVEC__
-void noisiness_tick_G4(t_noisiness *x) {
-
-	t_int i, index=0, cpt;
-	t_float Spz = 0.0f, SFM = 0.0f;
-	double prod = 1.0f, sum = 0.0f;
-	double invNumBand = 0.04f;
-
-	// Zero padding
-	for (i=x->BufSize; i<x->FFTSize; i++)
-		x->BufFFT[i] = 0.0f;
-
-	// Window the samples
-	if (x->x_window != Recta)
-		for (i=0; i<x->BufSize; ++i)
-			x->BufFFT[i] *= x->WindFFT[i];
-			
-    // Look at the real signal as an interleaved complex vector by casting it.
-    // Then call the transformation function ctoz to get a split complex vector,
-    // which for a real signal, divides into an even-odd configuration.
-    ctoz ((COMPLEX *) x->BufFFT, 2, &x->x_A, 1, x->x_FFTSizeOver2);
-      
-    // Carry out a Forward FFT transform
-    fft_zrip(x->x_setup, &x->x_A, 1, x->x_log2n, FFT_FORWARD);
-
-    // The output signal is now in a split real form.  Use the function
-    // ztoc to get a split real vector.
-    ztoc ( &x->x_A, 1, (COMPLEX *) x->BufFFT, 2, x->x_FFTSizeOver2);
-		
-	// Squared Absolute
-	for (i=0; i<x->FFTSize; i+=2) 
-		x->BufFFT[i/2] = (x->BufFFT[i] * x->BufFFT[i]) + (x->BufFFT[i+1] * x->BufFFT[i+1]);
-					
-	// Band Spz
-	for (i=0; i<NUMBAND; i++) {
-		cpt = x->BufSizeBark[i];
-		Spz = 0.0f;
-		while (cpt > 0) {
-			Spz += x->BufFFT[index];
-			cpt--;
-			index++;
-		}
-		Spz = Spz/x->BufSizeBark[i];
-
-		sum += Spz;
-		prod *= Spz;
- 	}
- 	
- 	prod = pow(prod,invNumBand);
- 	sum  = invNumBand * sum;
- 	SFM = prod/sum;
- 	
- 	// Spectral Flatness Measure (SFM)
- 	if (SFM > 0) {
-		SFM = 10*log10(prod/sum);
-	} else {
-		SFM = 0.0f;
-	}
-
-	// Tonality factor or Peakiness
-	x->x_noisiness = MINF((SFM/-SFM_MAX),1); // minimum of both
-		
-	// Output result
-    outlet_float(x->x_outnois, (1.0 - x->x_noisiness));
- }	
-#endif // __ALTIVEC__
-
-// Computes the ceiling of log2(n) 
-// i.e. log2max(7) = 3, log2max(8) = 3, log2max(9) = 4
-long log2max(long n) {
-	
-	long power = 1;
-	long k = 1;
-	
-	if (n==1) return 0;
-	while ((k <<= 1) < n) power++;
-	
-	return power;
-}
\ No newline at end of file
@@ -30,6 +30,7 @@ SVN_REVISION: $LastChangedRevision: 587 $
 VERSION 1.1: Universal Binary
 VERSION 1.1.1: GPL compatible license
 VERSION 1.1.2: Added tellmeeverything function
+VERSION 1.2: Buffered transform of any size with a hop, lifting schemes, level outlets
 @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 */
 
@@ -37,32 +38,82 @@ VERSION 1.1.2: Added tellmeeverything function
 #include "ext.h"
 #include "version.c"
 #include "z_dsp.h"
+#include "ext_critical.h"
 #include "math.h"
 #include <gsl/gsl_wavelet.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WLET_SSE2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define WLET_NEON
+#endif
+
+#define WLET_MAXLENGTH 65536
+#define WLET_MAXLEVELS 16
+
+// how a frame gets transformed.  Wavelets without a lifting scheme here go
+// through gsl.
+enum {
+	WLET_GSL = 0,
+	WLET_HAAR,
+	WLET_DAUB4,
+	WLET_CDF53,		// biorthogonal 202
+	WLET_CDF97		// biorthogonal 404
+};
+
+// Everything that depends on the size, hop and wavelet.  A change builds a
+// new one and the perform routine picks it up at the start of its next
+// vector (see wlet_post()), so it never sees half of a change.
+typedef struct _wletframe
+{
+	int f_length;
+	int f_hop;
+	int f_levels;		// level outlets that get coefficients at this size
+	int f_lift;
+	gsl_wavelet *f_wavelet;
+	gsl_wavelet_workspace *f_workspace;
+	double *f_ring;		// the last f_length input samples
+	double *f_frame;	// transform of the last complete frame, in gsl's order
+	double *f_approx;	// its approximation at level f_levels (level 0 is the input)
+	double *f_tmp;		// f_length, for splitting into even and odd samples
+	int f_write;		// next write position in f_ring
+	int f_count;		// samples since the last frame
+} t_wletframe;
+
 typedef struct _wlet
 {
 	t_pxobject w_ob;
 	void *w_proxy[2];
 	long w_inletNumber;
-	double *w_tmp;
-	gsl_wavelet *w_wavelet;
-	gsl_wavelet_type *w_waveletType;
-	gsl_wavelet_workspace *w_workspace;
+	t_symbol *w_name;
 	gsl_wavelet_direction w_direction;
 	int w_waveletLength;
-	size_t w_stride;
+	int w_hop;			// 0: same as the length
+	int w_levels;		// number of level outlets
 	size_t w_k;
+	t_wletframe *w_frame, *w_next, *w_old;
+	t_critical w_lock;
 } t_wlet;
 
 void *wlet_class;
 
 void wlet_anything(t_wlet *x, t_symbol *msg, short argc, t_atom *argv);
 void wlet_int(t_wlet *x, long n);
+void wlet_hop(t_wlet *x, long n);
 void wlet_assist(t_wlet *x, void *b, long m, long a, char *s);
-void *wlet_new(t_symbol *dir, t_symbol *wlet, long k, long n);//, long stride);
+void *wlet_new(t_symbol *dir, t_symbol *wlet, long k, long n, long hop, long levels);
 t_int *wlet_perform(t_int *w);
 void wlet_setupWavelet(t_wlet *x, t_symbol *msg, size_t k);
+void wlet_post(t_wlet *x);
+t_wletframe *wlet_newFrame(t_wlet *x);
+void wlet_freeFrame(t_wletframe *f);
+void wlet_transform(t_wletframe *f, gsl_wavelet_direction dir);
+void wlet_liftForward(int lift, double *data, double *tmp, int n);
+void wlet_liftBackward(int lift, double *data, double *tmp, int n);
+void wlet_lift(double *dst, const double *src, int m, int s0, int s1, double c0, double c1);
+void wlet_readout(t_wletframe *f, int levels, t_float **out, int offset, int pos, int m);
 void wlet_dsp(t_wlet *x, t_signal **sp, short *count);
 void wlet_free(t_wlet *x);
 void wlet_tellmeeverything(t_wlet *x);
@@ -72,7 +123,7 @@ void wlet_tellmeeverything(t_wlet *x);
 
 int main(void)
 {
-	setup((t_messlist **)&wlet_class, (method)wlet_new, (method)wlet_free, (short)sizeof(t_wlet), 0L, A_SYM, A_DEFSYM, A_DEFLONG, A_DEFLONG, A_DEFLONG, 0); 
+	setup((t_messlist **)&wlet_class, (method)wlet_new, (method)wlet_free, (short)sizeof(t_wlet), 0L, A_SYM, A_DEFSYM, A_DEFLONG, A_DEFLONG, A_DEFLONG, A_DEFLONG, 0); 
 	
 	version(0);
 
@@ -80,6 +131,7 @@ int main(void)
 	addmess((method)wlet_dsp, "dsp", A_CANT, 0);
 	addmess((method)wlet_anything, "anything", A_GIMME, 0);
 	addint((method)wlet_int);
+	addmess((method)wlet_hop, "hop", A_LONG, 0);
 	addmess((method)wlet_assist, "assist", A_CANT, 0);
 	addmess((method)wlet_tellmeeverything, "tellmeeverything", 0);
 	
@@ -108,36 +160,25 @@ void wlet_anything(t_wlet *x, t_symbol *msg, short argc, t_atom *argv)
 
 void wlet_int(t_wlet *x, long n)
 {
-	float f = (float)n;
-	int i = (int)n;
-	
 	if(proxy_getinlet((t_object *)x) == 1){
-		wlet_setupWavelet(x, gensym((char *)gsl_wavelet_name(x->w_wavelet)), (size_t)n);
+		wlet_setupWavelet(x, x->w_name, (size_t)n);
 	}else if(proxy_getinlet((t_object *)x) == 2){
-		if(n > sys_getblksize()){
-			error("wavelet: size must be smaller than the signal vector %ld", sys_getblksize());
+		if(n < 2 || n > WLET_MAXLENGTH || (n & (n - 1))){
+			error("wavelet: size must be a power of 2 between 2 and %d", WLET_MAXLENGTH);
 			return;
 		}
-		while(i > 1){
-			f = f / 2.0;
-			if(f - round(f)){
-				error("wavelet: size must be a multiple of 2");
-				return;
-			}
-			i = (int)f;
-		}
 		x->w_waveletLength = (int)n;
-		
-		gsl_wavelet_workspace *oldWspace = x->w_workspace;
-		x->w_workspace = gsl_wavelet_workspace_alloc((size_t)n);
-		gsl_wavelet_workspace_free(oldWspace);
-		
-		double *oldTmp = x->w_tmp;
-		x->w_tmp = (double *)calloc((int)n, sizeof(double));
-		free(oldTmp);
-	}//else if(proxy_getinlet((t_object *)x) == 3){
-	//	x->w_stride = (size_t)n;
-	//}
+		wlet_post(x);
+	}
+}
+
+// a new frame every n samples.  0 or anything bigger than the size means no
+// overlap; the inverse transform always works on whole frames.
+void wlet_hop(t_wlet *x, long n)
+{
+	if(n < 0) n = 0;
+	x->w_hop = (int)n;
+	wlet_post(x);
 }
 
 //--------------------------------------------------------------------------
@@ -145,10 +186,16 @@ void wlet_int(t_wlet *x, long n)
 void wlet_assist(t_wlet *x, void *b, long m, long a, char *s)
 {
 	if (m == ASSIST_OUTLET){
-		if(x->w_direction == forward){
-			sprintf(s,"(Signal) DWT output");
-		}
-		else sprintf(s, "(Signal) Inverse DWT output");
+		if(a == 0){
+			if(x->w_direction == forward){
+				sprintf(s,"(Signal) DWT output");
+			}
+			else sprintf(s, "(Signal) Inverse DWT output");
+		}else if(a <= x->w_levels)
+			sprintf(s, "(Signal) Level %ld detail coefficients", a);
+		else if(x->w_levels)
+			sprintf(s, "(Signal) Level %d approximation coefficients", x->w_levels);
+		else sprintf(s, "(Signal) Input, delayed to line up with the output");
 	}
 	else {
 		switch (a) {	
@@ -167,17 +214,16 @@ void wlet_assist(t_wlet *x, void *b, long m, long a, char *s)
 
 //--------------------------------------------------------------------------
 
-void *wlet_new(t_symbol *dir, t_symbol *wlet, long k, long n)//, long stride)
+// wavelet~ direction [wavelet k size hop levels]
+void *wlet_new(t_symbol *dir, t_symbol *wlet, long k, long n, long hop, long levels)
 {
 	t_wlet *x;
+	int i;
 
 	x = (t_wlet *)newobject(wlet_class); // create a new instance of this object
 	dsp_setup((t_pxobject *)x, 1);
-	//x->w_proxy[2] = proxy_new(x, 3, &x->w_inletNumber);
 	x->w_proxy[1] = proxy_new(x, 2, &x->w_inletNumber);
 	x->w_proxy[0] = proxy_new(x, 1, &x->w_inletNumber);
-	outlet_new((t_pxobject *)x, "signal");
-	outlet_new((t_pxobject *)x, "signal");
 	
 	if(!strcmp(dir->s_name, "forward"))
 		x->w_direction = forward;
@@ -188,26 +234,27 @@ void *wlet_new(t_symbol *dir, t_symbol *wlet, long k, long n)//, long stride)
 		return 0;
 	}
 	
-	if(n){
-		if(sys_getblksize() < n) x->w_waveletLength = sys_getblksize();
-		else x->w_waveletLength = n;
-	}else{
-		if(sys_getblksize() < 512) x->w_waveletLength = sys_getblksize();
-		else x->w_waveletLength = 512;
-	}
+	if(levels < 0 || x->w_direction == backward) levels = 0;
+	if(levels > WLET_MAXLEVELS) levels = WLET_MAXLEVELS;
+	x->w_levels = (int)levels;
 	
-	//if(stride) x->w_stride = stride;
-	//else 
-	x->w_stride = 1;
+	// rightmost first: the approximation (or the delayed input), the levels, then the transform
+	for(i = 0; i < x->w_levels + 2; i++)
+		outlet_new((t_pxobject *)x, "signal");
 	
-	x->w_tmp = (double *)calloc(x->w_waveletLength, sizeof(double));
-	//x->w_wavelet = gsl_wavelet_alloc(gsl_wavelet_daubechies, (k) ? k : 4);
-	x->w_workspace = gsl_wavelet_workspace_alloc(x->w_waveletLength);
+	if(n < 2 || n > WLET_MAXLENGTH || (n & (n - 1))){
+		if(n) error("wavelet: size must be a power of 2 between 2 and %d.  Defaulting to 512.", WLET_MAXLENGTH);
+		n = 512;
+	}
+	x->w_waveletLength = (int)n;
+	x->w_hop = hop > 0 ? (int)hop : 0;
+	
+	x->w_frame = x->w_next = x->w_old = NULL;
+	critical_new(&x->w_lock);
 	
-	if(k)
-		x->w_k = (size_t)k;
-	else x->w_k = 4;
-	wlet_setupWavelet(x, (!strcmp(wlet->s_name, " ")) ? wlet : gensym("daubechies"), x->w_k);
+	x->w_name = gensym("daubechies");
+	x->w_k = 4;
+	wlet_setupWavelet(x, wlet->s_name[0] ? wlet : x->w_name, (size_t)k);
 		
 	return(x);
 }
@@ -215,111 +262,460 @@ void *wlet_new(t_symbol *dir, t_symbol *wlet, long k, long n)//, long stride)
 void wlet_free(t_wlet *x)
 {
 	dsp_free((t_pxobject *)x);
-	free(x->w_tmp);
-	gsl_wavelet_free(x->w_wavelet);
-	gsl_wavelet_workspace_free(x->w_workspace);
+	critical_enter(x->w_lock);
+	wlet_freeFrame(x->w_frame);
+	wlet_freeFrame(x->w_next);
+	wlet_freeFrame(x->w_old);
+	x->w_frame = x->w_next = x->w_old = NULL;
+	critical_exit(x->w_lock);
+	critical_free(x->w_lock);
 }
 
 void wlet_setupWavelet(t_wlet *x, t_symbol *msg, size_t k)
 {
-	gsl_wavelet *oldWlet = x->w_wavelet;
-	x->w_k = k;
-	
-	if(!strcmp(msg->s_name, "daubechies")){
-		if(k = -1)
+	if(!strcmp(msg->s_name, "daubechies") || !strcmp(msg->s_name, "daubechies_centered") || !strcmp(msg->s_name, "daubechies-centered")){
+		if(!k)
 			k = 4;
-		if(k < 4 || k > 20 || ((k / 2) - round(k / 2))){
+		if(k < 4 || k > 20 || (k % 2)){
 			error("wavelet: k must equal 4, 6, 8, 10, 12, 14, 16, 18, or 20.  Defaulting to k = 4.");
 			k = 4;
 		}
-		x->w_waveletType = (gsl_wavelet_type *)gsl_wavelet_daubechies;
-		x->w_wavelet = gsl_wavelet_alloc(gsl_wavelet_daubechies, k);
-	}else if(!strcmp(msg->s_name, "daubechies_centered") || !strcmp(msg->s_name, "daubechies-centered")){
-		if(k = -1)
-			k = 4;
-		if(k < 4 || k > 20 || ((k / 2) - round(k / 2))){
-			error("wavelet: k must equal 4, 6, 8, 10, 12, 14, 16, 18, or 20.  Defaulting to k = 4.");
-			k = 4;
-		}
-		x->w_waveletType = (gsl_wavelet_type *)gsl_wavelet_daubechies_centered;
-		x->w_wavelet = gsl_wavelet_alloc(gsl_wavelet_daubechies_centered, k);
-	}else if(!strcmp(msg->s_name, "haar")){
-		if(k = -1)
+	}else if(!strcmp(msg->s_name, "haar") || !strcmp(msg->s_name, "haar_centered") || !strcmp(msg->s_name, "haar-centered")){
+		if(!k)
 			k = 2;
 		if(k != 2){
 			error("wavelet: k must equal 2.  Defaulting to k = 2.");
 			k = 2;
 		}
-		x->w_waveletType = (gsl_wavelet_type *)gsl_wavelet_haar;
-		x->w_wavelet = gsl_wavelet_alloc(gsl_wavelet_haar, k);
-	}else if(!strcmp(msg->s_name, "haar_centered") || !strcmp(msg->s_name, "haar-centered")){
-		if(k = -1)
-			k = 2;
-		if(k != 2){
-			error("wavelet: k must equal 2.  Defaulting to k = 2.");
-			k = 2;
-		}
-		x->w_waveletType = (gsl_wavelet_type *)gsl_wavelet_haar_centered;
-		x->w_wavelet = gsl_wavelet_alloc(gsl_wavelet_haar_centered, k);
-	}else if(!strcmp(msg->s_name, "bspline")){
-		if(k = -1)
+	}else if(!strcmp(msg->s_name, "bspline") || !strcmp(msg->s_name, "bspline_centered") || !strcmp(msg->s_name, "bspline-centered")){
+		if(!k)
 			k = 103;
 		if(k != 103 && k != 105 && k != 202 && k != 204 && k != 206 && k != 208 && k != 301 && k != 303 && k != 305 && k != 307 && k != 309){
 			error("wavelet: k must equal 103, 105, 202, 204, 206, 208, 301, 303, 305 307, or 309.  Defaulting to k = 103.");
 			k = 103;
 		}
-		x->w_waveletType = (gsl_wavelet_type *)gsl_wavelet_bspline;
-		x->w_wavelet = gsl_wavelet_alloc(gsl_wavelet_bspline, k);
-	}else if(!strcmp(msg->s_name, "bspline_centered") || !strcmp(msg->s_name, "bspline-centered")){
-		if(k = -1)
-			k = 103;
-		if(k != 103 && k != 105 && k != 202 && k != 204 && k != 206 && k != 208 && k != 301 && k != 303 && k != 305 && k != 307 && k != 309){
-			error("wavelet: k must equal 103, 105, 202, 204, 206, 208, 301, 303, 305 307, or 309.  Defaulting to k = 103.");
-			k = 103;
+	}else if(!strcmp(msg->s_name, "biorthogonal")){
+		// Cohen-Daubechies-Feauveau 5/3 and 9/7, numbered like the bsplines
+		if(!k)
+			k = 202;
+		if(k != 202 && k != 404){
+			error("wavelet: k must equal 202 (5/3) or 404 (9/7).  Defaulting to k = 202.");
+			k = 202;
 		}
-		x->w_waveletType = (gsl_wavelet_type *)gsl_wavelet_bspline_centered;
-		x->w_wavelet = gsl_wavelet_alloc(gsl_wavelet_bspline_centered, k);
 	}else{
 		error("wavelet: wavelet of type %s not implemented", msg->s_name);
 		return;
 	}
-	gsl_wavelet_free(oldWlet);
+	x->w_name = msg;
+	x->w_k = k;
+	wlet_post(x);
+}
+
+// Builds the frame for the current settings and hands it to the perform
+// routine.  A frame the perform routine hasn't picked up yet is replaced, and
+// the one it let go of last time is freed here rather than in the perform
+// routine.
+void wlet_post(t_wlet *x)
+{
+	t_wletframe *f = wlet_newFrame(x);
+	
+	if(!f){
+		error("wavelet: out of memory");
+		return;
+	}
+	critical_enter(x->w_lock);
+	wlet_freeFrame(x->w_next);
+	wlet_freeFrame(x->w_old);
+	x->w_old = NULL;
+	x->w_next = f;
+	critical_exit(x->w_lock);
+}
+
+t_wletframe *wlet_newFrame(t_wlet *x)
+{
+	t_wletframe *f = (t_wletframe *)calloc(1, sizeof(t_wletframe));
+	const char *name = x->w_name->s_name;
+	int n = x->w_waveletLength, levels = 0;
+	
+	if(!f)
+		return NULL;
+	f->f_length = n;
+	f->f_hop = (x->w_hop && x->w_hop < n && x->w_direction == forward) ? x->w_hop : n;
+	while(levels < x->w_levels && (n >> (levels + 1)))
+		levels++;
+	f->f_levels = levels;
+	
+	if(!strcmp(name, "haar"))
+		f->f_lift = WLET_HAAR;
+	else if(!strcmp(name, "daubechies") && x->w_k == 4)
+		f->f_lift = WLET_DAUB4;
+	else if(!strcmp(name, "biorthogonal"))
+		f->f_lift = (x->w_k == 404) ? WLET_CDF97 : WLET_CDF53;
+	else{
+		const gsl_wavelet_type *type;
+		
+		f->f_lift = WLET_GSL;
+		if(!strcmp(name, "daubechies"))
+			type = gsl_wavelet_daubechies;
+		else if(!strcmp(name, "haar_centered") || !strcmp(name, "haar-centered"))
+			type = gsl_wavelet_haar_centered;
+		else if(!strcmp(name, "bspline"))
+			type = gsl_wavelet_bspline;
+		else if(!strcmp(name, "bspline_centered") || !strcmp(name, "bspline-centered"))
+			type = gsl_wavelet_bspline_centered;
+		else type = gsl_wavelet_daubechies_centered;
+		f->f_wavelet = gsl_wavelet_alloc(type, x->w_k);
+		f->f_workspace = gsl_wavelet_workspace_alloc(n);
+		if(!f->f_wavelet || !f->f_workspace){
+			wlet_freeFrame(f);
+			return NULL;
+		}
+	}
+	
+	f->f_ring = (double *)calloc(n, sizeof(double));
+	f->f_frame = (double *)calloc(n, sizeof(double));
+	f->f_approx = (double *)calloc(n >> levels, sizeof(double));
+	f->f_tmp = (double *)calloc(n, sizeof(double));
+	if(!f->f_ring || !f->f_frame || !f->f_approx || !f->f_tmp){
+		wlet_freeFrame(f);
+		return NULL;
+	}
+	return f;
 }
 
+void wlet_freeFrame(t_wletframe *f)
+{
+	if(!f)
+		return;
+	if(f->f_wavelet) gsl_wavelet_free(f->f_wavelet);
+	if(f->f_workspace) gsl_wavelet_workspace_free(f->f_workspace);
+	if(f->f_ring) free(f->f_ring);
+	if(f->f_frame) free(f->f_frame);
+	if(f->f_approx) free(f->f_approx);
+	if(f->f_tmp) free(f->f_tmp);
+	free(f);
+}
+
+//--------------------------------------------------------------------------
+
+// Transforms f_frame in place, all the way down like gsl_wavelet_transform,
+// and keeps the approximation at level f_levels for the rightmost outlet.
+void wlet_transform(t_wletframe *f, gsl_wavelet_direction dir)
+{
+	int len = f->f_length, levels = f->f_levels;
+	int n, level;
+	
+	if(dir == backward){
+		memcpy(f->f_approx, f->f_frame, len * sizeof(double));
+		if(f->f_lift == WLET_GSL)
+			gsl_wavelet_transform(f->f_wavelet, f->f_frame, 1, len, backward, f->f_workspace);
+		else for(n = 2; n <= len; n <<= 1)
+			wlet_liftBackward(f->f_lift, f->f_frame, f->f_tmp, n);
+		return;
+	}
+	
+	if(!levels)
+		memcpy(f->f_approx, f->f_frame, len * sizeof(double));
+	
+	if(f->f_lift == WLET_GSL){
+		gsl_wavelet_transform(f->f_wavelet, f->f_frame, 1, len, forward, f->f_workspace);
+		if(levels){
+			// the first len >> levels coefficients are the whole transform of
+			// the approximation at that level, so undo just that part
+			n = len >> levels;
+			memcpy(f->f_approx, f->f_frame, n * sizeof(double));
+			if(n > 1)
+				gsl_wavelet_transform(f->f_wavelet, f->f_approx, 1, n, backward, f->f_workspace);
+		}
+		return;
+	}
+	
+	for(n = len, level = 1; n >= 2; n >>= 1, level++){
+		wlet_liftForward(f->f_lift, f->f_frame, f->f_tmp, n);
+		if(level == levels)
+			memcpy(f->f_approx, f->f_frame, (n >> 1) * sizeof(double));
+	}
+}
+
+// dst[i] += c0 * src[i + s0] + c1 * src[i + s1] for i < m, where the shifts
+// are -1, 0 or 1 and the indices wrap around like gsl's do.
+void wlet_lift(double *dst, const double *src, int m, int s0, int s1, double c0, double c1)
+{
+	int i, hi = m - 1;
+	
+	// the ends wrap
+	dst[0] += c0 * src[(s0 + m) % m] + c1 * src[(s1 + m) % m];
+	if(m < 2)
+		return;
+	dst[hi] += c0 * src[(hi + s0) % m] + c1 * src[(hi + s1) % m];
+	
+	i = 1;
+#if defined(WLET_SSE2)
+	{
+		__m128d v0 = _mm_set1_pd(c0), v1 = _mm_set1_pd(c1);
+		
+		for(; i + 2 <= hi; i += 2)
+			_mm_storeu_pd(dst + i, _mm_add_pd(_mm_loadu_pd(dst + i),
+				_mm_add_pd(_mm_mul_pd(v0, _mm_loadu_pd(src + i + s0)), _mm_mul_pd(v1, _mm_loadu_pd(src + i + s1)))));
+	}
+#elif defined(WLET_NEON)
+	{
+		float64x2_t v0 = vdupq_n_f64(c0), v1 = vdupq_n_f64(c1);
+		
+		for(; i + 2 <= hi; i += 2)
+			vst1q_f64(dst + i, vfmaq_f64(vfmaq_f64(vld1q_f64(dst + i), v0, vld1q_f64(src + i + s0)), v1, vld1q_f64(src + i + s1)));
+	}
+#endif
+	for(; i < hi; i++)
+		dst[i] += c0 * src[i + s0] + c1 * src[i + s1];
+}
+
+// The lifting factorisations.  Each one gives the same coefficients as
+// gsl's convolution (same order and signs, periodic at the ends) with
+// about half the arithmetic.  One step of size n turns data[0..n) into
+// n / 2 approximation coefficients followed by n / 2 details.
+#define WLET_SQRT3 1.7320508075688772935
+#define WLET_SQRT2 1.4142135623730950488
+#define WLET_D4_K ((WLET_SQRT3 + 1.) / WLET_SQRT2)
+#define WLET_97_A -1.586134342059924
+#define WLET_97_B -0.052980118572961
+#define WLET_97_C 0.882911075530934
+#define WLET_97_D 0.443506852043971
+#define WLET_97_K 1.230174104914001
+
+void wlet_liftForward(int lift, double *data, double *tmp, int n)
+{
+	int i, m = n >> 1;
+	double *e = tmp, *o = tmp + m;
+	
+	for(i = 0; i < m; i++){
+		e[i] = data[2 * i];
+		o[i] = data[2 * i + 1];
+	}
+	
+	switch(lift){
+		case WLET_HAAR:
+			wlet_lift(o, e, m, 0, 0, -1., 0.);
+			wlet_lift(e, o, m, 0, 0, 0.5, 0.);
+			for(i = 0; i < m; i++){
+				data[i] = WLET_SQRT2 * e[i];
+				data[m + i] = -o[i] / WLET_SQRT2;
+			}
+			return;
+		case WLET_DAUB4:
+			wlet_lift(o, e, m, 0, 0, -WLET_SQRT3, 0.);
+			wlet_lift(e, o, m, 0, 1, WLET_SQRT3 / 4., (WLET_SQRT3 - 2.) / 4.);
+			wlet_lift(o, e, m, -1, -1, 1., 0.);
+			for(i = 0; i < m; i++){
+				data[i] = WLET_D4_K * e[i];
+				data[m + i] = -o[(i + 1) % m] / WLET_D4_K;
+			}
+			return;
+		case WLET_CDF53:
+			wlet_lift(o, e, m, 0, 1, -0.5, -0.5);
+			wlet_lift(e, o, m, -1, 0, 0.25, 0.25);
+			for(i = 0; i < m; i++){
+				data[i] = WLET_SQRT2 * e[i];
+				data[m + i] = o[i] / WLET_SQRT2;
+			}
+			return;
+		case WLET_CDF97:
+			wlet_lift(o, e, m, 0, 1, WLET_97_A, WLET_97_A);
+			wlet_lift(e, o, m, -1, 0, WLET_97_B, WLET_97_B);
+			wlet_lift(o, e, m, 0, 1, WLET_97_C, WLET_97_C);
+			wlet_lift(e, o, m, -1, 0, WLET_97_D, WLET_97_D);
+			for(i = 0; i < m; i++){
+				data[i] = (WLET_SQRT2 / WLET_97_K) * e[i];
+				data[m + i] = (WLET_97_K / WLET_SQRT2) * o[i];
+			}
+			return;
+	}
+}
+
+void wlet_liftBackward(int lift, double *data, double *tmp, int n)
+{
+	int i, m = n >> 1;
+	double *e = tmp, *o = tmp + m;
+	
+	switch(lift){
+		case WLET_HAAR:
+			for(i = 0; i < m; i++){
+				e[i] = data[i] / WLET_SQRT2;
+				o[i] = -WLET_SQRT2 * data[m + i];
+			}
+			wlet_lift(e, o, m, 0, 0, -0.5, 0.);
+			wlet_lift(o, e, m, 0, 0, 1., 0.);
+			break;
+		case WLET_DAUB4:
+			for(i = 0; i < m; i++){
+				e[i] = data[i] / WLET_D4_K;
+				o[(i + 1) % m] = -WLET_D4_K * data[m + i];
+			}
+			wlet_lift(o, e, m, -1, -1, -1., 0.);
+			wlet_lift(e, o, m, 0, 1, -WLET_SQRT3 / 4., -(WLET_SQRT3 - 2.) / 4.);
+			wlet_lift(o, e, m, 0, 0, WLET_SQRT3, 0.);
+			break;
+		case WLET_CDF53:
+			for(i = 0; i < m; i++){
+				e[i] = data[i] / WLET_SQRT2;
+				o[i] = WLET_SQRT2 * data[m + i];
+			}
+			wlet_lift(e, o, m, -1, 0, -0.25, -0.25);
+			wlet_lift(o, e, m, 0, 1, 0.5, 0.5);
+			break;
+		case WLET_CDF97:
+			for(i = 0; i < m; i++){
+				e[i] = (WLET_97_K / WLET_SQRT2) * data[i];
+				o[i] = (WLET_SQRT2 / WLET_97_K) * data[m + i];
+			}
+			wlet_lift(e, o, m, -1, 0, -WLET_97_D, -WLET_97_D);
+			wlet_lift(o, e, m, 0, 1, -WLET_97_C, -WLET_97_C);
+			wlet_lift(e, o, m, -1, 0, -WLET_97_B, -WLET_97_B);
+			wlet_lift(o, e, m, 0, 1, -WLET_97_A, -WLET_97_A);
+			break;
+	}
+	
+	for(i = 0; i < m; i++){
+		data[2 * i] = e[i];
+		data[2 * i + 1] = o[i];
+	}
+}
+
+//--------------------------------------------------------------------------
+
 void wlet_dsp(t_wlet *x, t_signal **sp, short *count)
 {
-	dsp_add(wlet_perform, 4, x, sp[0]->s_vec, sp[1]->s_vec, sp[0]->s_n);
+	void *w[WLET_MAXLEVELS + 5];
+	int i, num = x->w_levels + 2;	// outlets
+	
+	// nothing is running, so a pending change can go in now
+	critical_enter(x->w_lock);
+	if(x->w_next){
+		wlet_freeFrame(x->w_frame);
+		x->w_frame = x->w_next;
+		x->w_next = NULL;
+	}
+	critical_exit(x->w_lock);
+	
+	w[0] = x;
+	w[1] = (void *)(sp[0]->s_n);
+	for(i = 0; i < num + 1; i++)
+		w[i + 2] = sp[i]->s_vec;
+	dsp_addv(wlet_perform, num + 3, w);
 }
 
+// Outlets, left to right: the frame's coefficients in gsl's order, the
+// detail coefficients of levels 1 to w_levels, and the approximation at the
+// last level (or, with no levels, the input).  Each coefficient is held for
+// the stretch of input it describes, so the level outlets line up in time.
+//
+// When frames don't overlap and fit the signal vector exactly, each frame
+// comes out in the vector it came in with, as this object always did.
+// Otherwise input is buffered and every f_hop samples the last f_length of
+// it are transformed; the output then lags the input by f_hop samples.
 t_int *wlet_perform(t_int *w)
 {
 	t_wlet *x = (t_wlet *)w[1];
-	t_float *inL = (t_float *)w[2];
-	t_float *outL = (t_float *)w[3];
-	int n = (int)w[4];
-	int i, j, result;
+	int n = (int)w[2];
+	t_float *in = (t_float *)w[3];
+	t_float **out = (t_float **)(w + 4);
+	t_wletframe *f;
+	int i, j, len, hop, m;
+	
+	if(x->w_next){
+		critical_enter(x->w_lock);
+		if(x->w_next){
+			x->w_old = x->w_frame;
+			x->w_frame = x->w_next;
+			x->w_next = NULL;
+		}
+		critical_exit(x->w_lock);
+	}
 	
-	long numTransforms = (long)n / (x->w_waveletLength);
+	f = x->w_frame;
+	if(!f){
+		for(j = 0; j < x->w_levels + 2; j++)
+			for(i = 0; i < n; i++)
+				out[j][i] = 0.;
+		return (w + x->w_levels + 5);
+	}
+	len = f->f_length;
+	hop = f->f_hop;
 	
-	//double data = x->w_tmp;
-	for(j = 0; j < numTransforms; j++){
-		for(i = 0; i < x->w_waveletLength; i++)
-			x->w_tmp[i] = (double)inL[i + (x->w_waveletLength * j)];
+	if(hop == len && !f->f_count && !(n % len)){
+		for(j = 0; j < n; j += len){
+			for(i = 0; i < len; i++)
+				f->f_frame[i] = (double)in[j + i];
+			wlet_transform(f, x->w_direction);
+			wlet_readout(f, x->w_levels, out, j, 0, len);
+		}
+		return (w + x->w_levels + 5);
+	}
+	
+	for(j = 0; j < n; j += m){
+		m = hop - f->f_count;
+		if(m > n - j) m = n - j;
 		
-		result = gsl_wavelet_transform(x->w_wavelet, x->w_tmp, x->w_stride, x->w_waveletLength, x->w_direction, x->w_workspace);
-		if(result) post("%d", result);
-		for(i = 0; i < x->w_waveletLength; i++){
-			outL[i + (x->w_waveletLength * j)] = (t_float)x->w_tmp[i];
+		// the input may share memory with an outlet, so read it first
+		for(i = 0; i < m; i++){
+			f->f_ring[f->f_write++] = (double)in[j + i];
+			if(f->f_write == len) f->f_write = 0;
+		}
+		wlet_readout(f, x->w_levels, out, j, len - hop + f->f_count, m);
+		
+		f->f_count += m;
+		if(f->f_count == hop){
+			int tail = len - f->f_write;
+			
+			// oldest sample first
+			memcpy(f->f_frame, f->f_ring + f->f_write, tail * sizeof(double));
+			memcpy(f->f_frame + tail, f->f_ring, f->f_write * sizeof(double));
+			wlet_transform(f, x->w_direction);
+			f->f_count = 0;
 		}
 	}
 			
-	return (w + 5);
+	return (w + x->w_levels + 5);
+}
+
+// m samples of every outlet, from position pos of the current frame on
+void wlet_readout(t_wletframe *f, int levels, t_float **out, int offset, int pos, int m)
+{
+	double *frame = f->f_frame, *approx = f->f_approx;
+	int i, j, len = f->f_length, fl = f->f_levels;
+	t_float *o;
+	
+	o = out[0] + offset;
+	for(i = 0; i < m; i++)
+		o[i] = (t_float)frame[pos + i];
+	
+	for(j = 1; j <= levels; j++){
+		double *d = frame + (len >> j);
+		
+		o = out[j] + offset;
+		if(j > fl){
+			for(i = 0; i < m; i++)
+				o[i] = 0.;
+			continue;
+		}
+		for(i = 0; i < m; i++)
+			o[i] = (t_float)d[(pos + i) >> j];
+	}
+	
+	o = out[levels + 1] + offset;
+	for(i = 0; i < m; i++)
+		o[i] = (t_float)approx[(pos + i) >> fl];
 }
 
 void wlet_tellmeeverything(t_wlet *x){
 	version(0);
 	post("Direction: %s", x->w_direction == forward ? "forward" : "backward");
-	post("Wavelet type: %s", gsl_wavelet_name(x->w_wavelet));
+	post("Wavelet type: %s", x->w_name->s_name);
 	post("k = %ld", (long)x->w_k);
 	post("Size: %d", x->w_waveletLength);
+	if(x->w_frame){
+		post("Hop: %d", x->w_frame->f_hop);
+		post("Levels: %d of %d", x->w_frame->f_levels, x->w_levels);
+		post("Computed %s", x->w_frame->f_lift == WLET_GSL ? "by gsl" : "by lifting");
+	}
 }
@@ -5,14 +5,25 @@ DESCRIPTION: Multiple convolutions with de-synchronised fast real fft
 
 #include "ext.h"
 #include "z_dsp.h"
-#include "fftnobitrev.h"
+#include "ext_systhread.h"
+#include "cnmat_fft.h"
 #include <math.h>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MCONV_SSE
+#include <xmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define MCONV_NEON
+#include <arm_neon.h>
+#endif
+
 #define RES_ID	7030
 
 #define TWOPI 6.28318530717952646f
 #define FOURPI 12.56637061435917292f
 #define DEFBUFSIZE 1024
+#define MAXTHREADS 8			// worker threads, on top of the perform thread
+#define MINCHANSPERTHREAD 4		// don't hand out less than this many transforms
 
 #define HANNING_W(i,ac) (sqrtf((1.0f - cos((i * TWOPI) / (ac - 1.0f))) * 0.5f)) // square root of hanning
 #define HAMMING_W(i,ac) (sqrtf(0.54f - 0.46f * cos((TWOPI * i) / (ac - 1.0f))))
@@ -22,51 +33,87 @@ void *mconv_class;
 
 enum {Recta = 0, Hann, Hamm, Black};
 
+typedef struct _mconv_worker {
+	struct _mconv *x;
+	t_int index;			// Slice of each job this thread does (the perform thread does 0)
+	t_int job;				// Last job seen
+} t_mconv_worker;
+
 typedef struct _mconv {
 
 	t_pxobject m_obj;
 
 	t_int m_window;			// Type of window
 	t_int m_numConv;		// Number of Comvolutions
+	t_int m_batch;			// All convolutions in phase, so their FFTs happen together
+	t_int m_align;			// Set the phases again in the next perform call
+	t_int m_ahead;			// Output is read after the transforms of the same round
 
-    t_int **w;			
+    t_int **w;
     t_float **Buf1, *bigBuf1;	// Sample buffer signals 1
-    t_float **Buf2, *bigBuf2;	// Sample buffer signals 1 (for overlapping reasons)
-    t_float **Buf3, *bigBuf3;	// Sample buffer signals 2 
-    t_float **Buf4, *bigBuf4;	// Sample buffer signals 2 (for overlapping reasons)
-    t_float **BufIFFT1, *bigBufIFFT1;	// IFFT buffer 1
-    t_float **BufIFFT2, *bigBufIFFT2;	// IFFT buffer 2 (for overlapping reasons)
+    t_float **Buf2, *bigBuf2;	// Sample buffer signals 2
+    t_float **BufFFT1;		// FFT buffer signal 1, one per convolution
+    t_float **BufFFT2;		// FFT buffer signal 2, one per convolution
+    t_float **BufIFFT1;		// IFFT buffer 1
+    t_float **BufIFFT2;		// IFFT buffer 2 (for overlapping reasons)
 
     t_float *Window;		// Window of BufSize
     t_float *WindFFT;		// Window of FFTSize or same as *Window
-    t_float *BufFFT1;		// FFT buffer signal 1
-    t_float *BufFFT2;		// FFT buffer signal 2
-    t_float *memFFT;		// fftnobitrev.c memory space
+    t_cnmat_fftplan *fftPlan;	// Shared FFT plans (see lib/cnmat_fft.h)
+    t_cnmat_fftplan *ifftPlan;
 
 	t_int FFTSize;			// Size of FFT Buffer
 	t_int BufSize;			// Size of Sample Buffer
     t_int *BufWritePos;		// Where to write in buffers
     t_int *BufReadPos;		// Where to read in buffers
-	
+    t_int *Done;			// Samples of the signal vector already processed
+    t_int *Chunk;			// Samples processed in this round
+    t_int *Ready;			// Convolutions with a full buffer in this round
+    t_int numReady;
+
+	// Worker threads for the transforms, see mconv_threads()
+	t_int m_numThreads;
+	t_mconv_worker *m_workers;
+	t_systhread *m_threads;
+	t_systhread_mutex m_mutex;
+	t_systhread_cond m_jobCond;		// New job, or quit
+	t_systhread_cond m_doneCond;	// Workers finished a slice, or the job is over
+	t_int m_jobSlices;		// Slices of the current job, 0 if none
+	t_int m_jobDone;		// Slices finished by the workers
+	t_int m_jobCount;
+	t_int m_quit;
+
 } t_mconv;
 
 t_symbol *ps_rectangular, *ps_hanning, *ps_hamming, *ps_blackman;
 
 t_int *mconv_perform(t_int *w);
+void mconv_output(t_mconv *x, t_float *out, t_int k, t_int cpt);
+void mconv_align(t_mconv *x, t_int vs);
+void mconv_multiply(t_float *a, t_float *b, t_int n);
+void mconv_transform(t_mconv *x, t_int k);
+void mconv_transformSlice(t_mconv *x, t_int slice, t_int slices);
+void mconv_transformReady(t_mconv *x);
+void *mconv_worker(t_mconv_worker *wk);
+void mconv_stopThreads(t_mconv *x);
+void mconv_threads(t_mconv *x, long n);
+void mconv_batch(t_mconv *x, long n);
 void mconv_dsp(t_mconv *x, t_signal **sp, short *connect);
 void *mconv_new(t_symbol *s, short argc, t_atom *argv);
 void mconv_free(t_mconv *x);
 
 void main(void) {
-	
+
 	ps_rectangular = gensym("rectangular");
 	ps_hanning = gensym("hanning");
 	ps_hamming = gensym("hamming");
 	ps_blackman = gensym("blackman");
 
 	setup( &mconv_class, mconv_new, (method)mconv_free, (short)sizeof(t_mconv), 0L, A_GIMME, 0);
-		
+
 	addmess((method)mconv_dsp, "dsp", A_CANT, 0);
+	addmess((method)mconv_batch, "batch", A_LONG, 0);
+	addmess((method)mconv_threads, "threads", A_LONG, 0);
 	dsp_initclass();
 
 	rescopy('STR#', RES_ID);
@@ -76,207 +123,393 @@ t_int *mconv_perform(t_int *wAsT_int) {
 
 	t_int **w = (t_int **)wAsT_int;
 	t_mconv *x = (t_mconv *)(w[1]);
-	t_int n = (t_int)(w[2]);	
-	t_float *out;
-
-	t_int *myintin1; // use integers to copy blocs faster
-	t_int *myintin2; // was suggested by David Z.
-	t_int **myintBuf1 = (t_int **)(x->Buf1);
-	t_int **myintBuf2 = (t_int **)(x->Buf2);
-	t_int **myintBuf3 = (t_int **)(x->Buf3);
-	t_int **myintBuf4 = (t_int **)(x->Buf4);
-	t_int *myintBufFFT1 = (t_int *)(x->BufFFT1);
-	t_int *myintBufFFT2 = (t_int *)(x->BufFFT2);
-
-	t_int newReadPos;
-	t_int num = x->m_numConv; 
-	t_int i, k, index, cpt, maxindex;
-	t_int halfBufSize = x->BufSize/2;
+	t_int n = (t_int)(w[2]);
+	t_float *in1, *in2;
+
+	t_int num = x->m_numConv;
+	t_int i, k, cpt, more;
+
+	if (x->m_align)
+		mconv_align(x, n);
+
+	for (k=0; k<num; ++k)
+		x->Done[k] = 0;
+
+	// Each round takes every convolution up to its next full buffer or read
+	// wrap, whichever comes first, and the buffers that are full get
+	// transformed together. Vectors of up to half a buffer need one round.
+	do {
+		x->numReady = 0;
+
+		for (k=0; k<num; ++k) {
+
+			// In (re-allocate the right inlets for each convolution)
+			in1 = (t_float *)(w[2*k+3]) + x->Done[k];
+			in2 = (t_float *)(w[2*k+4]) + x->Done[k];
+
+			cpt = n - x->Done[k];
+			if (cpt > x->BufSize - x->BufWritePos[k]) cpt = x->BufSize - x->BufWritePos[k];
+			if (cpt > x->BufSize - x->BufReadPos[k]) cpt = x->BufSize - x->BufReadPos[k];
+			x->Chunk[k] = cpt;
+
+			// Copy input samples into sample buffers
+			for (i=0; i<cpt; ++i) {
+				x->Buf1[k][x->BufWritePos[k] + i] = in1[i];
+				x->Buf2[k][x->BufWritePos[k] + i] = in2[i];
+			}
+			x->BufWritePos[k] += cpt;
+
+			if (!x->m_ahead)
+				mconv_output(x, (t_float *)(w[2*num+3+k]) + x->Done[k], k, cpt);
+
+			// When Sample Buffers are full...
+			if (x->BufWritePos[k] >= x->BufSize)
+				x->Ready[x->numReady++] = k;
+		}
+
+		mconv_transformReady(x);
+
+		more = 0;
+		for (k=0; k<num; ++k) {
+
+			cpt = x->Chunk[k];
+			if (x->m_ahead)
+				mconv_output(x, (t_float *)(w[2*num+3+k]) + x->Done[k], k, cpt);
+
+			x->Done[k] += cpt;
+			if (x->Done[k] < n)
+				more = 1;
+		}
+	} while (more);
+
+	return (wAsT_int+3*num+3);
+}
+
+// Output convolved sound
+void mconv_output(t_mconv *x, t_float *out, t_int k, t_int cpt) {
+
+	t_int i;
+
+	for (i=0; i<cpt; ++i)
+		out[i] = x->BufIFFT2[k][i + x->BufReadPos[k]];
+	x->BufReadPos[k] += cpt;
+	if (x->BufReadPos[k] >= x->BufSize)
+		x->BufReadPos[k] = x->BufSize/2;
+}
+
+// De-Synchronise FFT events by a signal vector per convolution, or put them
+// all in phase in batch mode.
+void mconv_align(t_mconv *x, t_int vs) {
+
+	t_int i, k, j, maxDelayFFT;
+
+	maxDelayFFT = (x->FFTSize != x->BufSize) ? x->FFTSize/2 : x->FFTSize;
+	x->m_ahead = ((x->BufSize/2) % vs == 0);
+	for (k=0; k<x->m_numConv; ++k) {
+		j = x->m_batch ? 0 : k;
+		x->BufWritePos[k] = j*vs % maxDelayFFT;		// This is the trick to de-synchronise FFTs
+		// Reading one vector ahead only holds when every half buffer ends on a vector
+		// boundary, otherwise read in step with the writes, before the transforms
+		if (x->m_ahead)
+			x->BufReadPos[k] = (j+1)*vs % maxDelayFFT;	// And this is the trick to output at the right time
+		else
+			x->BufReadPos[k] = x->BufWritePos[k];
+
+		// Clean IFFT1 and IFFT2
+		for (i=0; i<x->BufSize; ++i) {
+			x->BufIFFT1[k][i] = 0.0f;
+			x->BufIFFT2[k][i] = 0.0f;
+		}
+	}
+	x->m_align = 0;
+}
+
+// Extraction of magnitude of b and multiplication of a in the frequency
+// domain, in place. Goes by (real, imag) pairs like the scalar loop always
+// did, so the vector code gives the same results.
+void mconv_multiply(t_float *a, t_float *b, t_int n) {
+
+	t_int i = 0;
 	t_float magn;
 
-	t_float *TmpBuf1;
-	t_float *TmpBuf3;
-	t_float *TmpBufIFFT1;
-	
-	for (k=0; k<num; ++k) {
-	
-		// In and Out (re-allocate the right inlets and outlet for each convolution) 
-		myintin1 = (t_int *)(w[2*k+3]);
-		myintin2 = (t_int *)(w[2*k+4]);
-    	out = (t_float *)(w[2*num+3+k]);	
-		
-		// Initialisation
-		index = 0;
-		cpt = n;
-		TmpBuf1 = x->Buf1[k];
-		TmpBuf3 = x->Buf3[k];
-		TmpBufIFFT1 = x->BufIFFT1[k];
-				
-		// Copy input samples into FFT buffers	
-		while ((x->BufWritePos[k] < x->BufSize) && (cpt > 0)) {
-			myintBuf1[k][x->BufWritePos[k]] = myintin1[index];
-			myintBuf3[k][x->BufWritePos[k]] = myintin2[index];
-			x->BufWritePos[k]++;
-			index++;
-			cpt--;
+#if defined(MCONV_SSE)
+	const __m128 maxMagn = _mm_set1_ps(0.9f), zero = _mm_setzero_ps();
+
+	for (; i+4<=n; i+=4) {
+		__m128 vb = _mm_load_ps(b+i);
+		__m128 sq = _mm_mul_ps(vb, vb);
+		__m128 m = _mm_sqrt_ps(_mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2,3,0,1))));
+
+		m = _mm_max_ps(_mm_min_ps(m, maxMagn), zero);
+		_mm_store_ps(a+i, _mm_mul_ps(_mm_load_ps(a+i), m));
+	}
+#elif defined(MCONV_NEON)
+	const float32x4_t maxMagn = vdupq_n_f32(0.9f), zero = vdupq_n_f32(0.0f);
+
+	for (; i+4<=n; i+=4) {
+		float32x4_t vb = vld1q_f32(b+i);
+		float32x4_t sq = vmulq_f32(vb, vb);
+		float32x4_t m = vsqrtq_f32(vaddq_f32(sq, vrev64q_f32(sq)));
+
+		m = vmaxq_f32(vminq_f32(m, maxMagn), zero);
+		vst1q_f32(a+i, vmulq_f32(vld1q_f32(a+i), m));
+	}
+#endif
+	for (; i<n; i+=2) {
+		magn = sqrtf( (b[i] * b[i]) + (b[i+1] * b[i+1]) );
+
+		if (magn > 0.9f) magn = 0.9f;
+		else if  (magn < 0.0f) magn = 0.0f;
+
+		a[i] *= magn; // Real part
+		a[i+1] *= magn; // Imag part
+	}
+}
+
+// One frame of convolution k. Only touches the buffers of k, so any number
+// of these can run at the same time.
+void mconv_transform(t_mconv *x, t_int k) {
+
+	t_int i;
+	t_int halfBufSize = x->BufSize/2;
+	t_float *fft1 = x->BufFFT1[k];
+	t_float *fft2 = x->BufFFT2[k];
+	t_float *tmp;
+
+	// Make a copy of Buffers into Buffer FFT1 and Buffer FFT2
+	for (i=0; i<x->BufSize; ++i) {
+		fft1[i] = x->Buf1[k][i];
+		fft2[i] = x->Buf2[k][i];
+	}
+
+	// Zero padding
+	for (i=x->BufSize; i<x->FFTSize; ++i) {
+		fft1[i] = 0.0f;
+		fft2[i] = 0.0f;
+	}
+
+	// Keep the overlapping samples, the next frame starts with them
+	for (i=0; i<halfBufSize; ++i) {
+		x->Buf1[k][i] = x->Buf1[k][halfBufSize+i];
+		x->Buf2[k][i] = x->Buf2[k][halfBufSize+i];
+	}
+	x->BufWritePos[k] = halfBufSize;
+
+	// Window the samples
+	if ((x->m_window > Recta) && (x->m_window <= Black))
+		for (i=0; i<x->FFTSize; ++i) {
+			fft1[i] *= x->WindFFT[i];
+			fft2[i] *= x->WindFFT[i];
 		}
-	
-		// When Sample Buffers are full...
-		if (x->BufWritePos[k] >= x->BufSize) {
-			
-			// Save overlapping samples into Buffer 2 and 4
-			for (i=0; i<halfBufSize; ++i) {
-				myintBuf2[k][i] = myintBuf1[k][halfBufSize+i];
-				myintBuf4[k][i] = myintBuf3[k][halfBufSize+i];
-			}
-		
-			maxindex = n - index + halfBufSize;
-	
-			// Copy the rest of incoming samples into Buffer 2 and 4
-			for (i=halfBufSize; i<maxindex; ++i) {
-				myintBuf2[k][i] = myintin1[index];
-				myintBuf4[k][i] = myintin2[index];
-				index++;
-			}
-		
-			x->BufWritePos[k] = maxindex;
-						
-			// Make a copy of Buffers into Buffer FFT1 and Buffer FFT2
-			for (i=0; i<x->BufSize; ++i) {
-				myintBufFFT1[i] = myintBuf1[k][i];
-				myintBufFFT2[i] = myintBuf3[k][i];
-			}
-			
-			// Zero padding
-			for (i=x->BufSize; i<x->FFTSize; ++i) {
-				myintBufFFT1[i] = 0;
-				myintBufFFT2[i] = 0;
-			}
-		
-			// Window the samples
-			if ((x->m_window > Recta) && (x->m_window <= Black))
-				for (i=0; i<x->FFTSize; ++i) {
-					x->BufFFT1[i] *= x->WindFFT[i];
-					x->BufFFT2[i] *= x->WindFFT[i];
-				}
-	
-			// FFT
-			fftRealfastnbr(x->FFTSize, x->BufFFT1, x->memFFT);
-			fftRealfastnbr(x->FFTSize, x->BufFFT2, x->memFFT);
-
-			// Extraction of magnitude of second signal and multiplication in the frequency domaine
-			for (i=0; i<x->FFTSize; i+=2) {
-				magn = sqrtf( (x->BufFFT2[i] * x->BufFFT2[i]) + (x->BufFFT2[i+1] * x->BufFFT2[i+1]) );
-
-				if (magn > 0.9f) magn = 0.9f;
-				else if  (magn < 0.0f) magn = 0.0f;
-
-				x->BufIFFT2[k][i] = x->BufFFT1[i] * magn; // Real part
-				x->BufIFFT2[k][i+1] = x->BufFFT1[i+1] * magn; // Imag part
-			}
 
-			// IFFT
-			ifftRealfastnbr(x->FFTSize, x->BufIFFT2[k], x->memFFT);	
-
-			// Window IFFT result at overlapping
-			if ((x->m_window > Recta) && (x->m_window <= Black))
-				for (i=0; i<x->BufSize; ++i)
-					x->BufIFFT2[k][i] *= x->Window[i];
-		
-			// Interpolation between IFFT1 and IFFT2
-			for (i=halfBufSize; i<x->BufSize; ++i)
-				x->BufIFFT1[k][i] += x->BufIFFT2[k][i - halfBufSize];
-	
-			// Swap IFFT buffers
-			x->BufIFFT1[k] = x->BufIFFT2[k];
-			x->BufIFFT2[k] = TmpBufIFFT1;
-
-			// Swap sample buffers
-			x->Buf1[k] = x->Buf2[k];
-			x->Buf2[k] = TmpBuf1;
-			x->Buf3[k] = x->Buf4[k];
-			x->Buf4[k] = TmpBuf3;
+	// FFT, multiplication in the frequency domain, IFFT
+	cnmat_fft_execute(x->fftPlan, fft1);
+	cnmat_fft_execute(x->fftPlan, fft2);
+	mconv_multiply(fft1, fft2, x->FFTSize);
+	cnmat_fft_execute(x->ifftPlan, fft1);
+
+	// Window IFFT result at overlapping
+	if ((x->m_window > Recta) && (x->m_window <= Black))
+		for (i=0; i<x->BufSize; ++i)
+			fft1[i] *= x->Window[i];
+
+	// Interpolation between IFFT1 and the new frame
+	for (i=halfBufSize; i<x->BufSize; ++i)
+		x->BufIFFT1[k][i] += fft1[i - halfBufSize];
+
+	// Rotate buffers: the new frame becomes IFFT1, IFFT1 is read next,
+	// and the IFFT2 that has been read out takes the next FFT
+	tmp = x->BufIFFT2[k];
+	x->BufIFFT2[k] = x->BufIFFT1[k];
+	x->BufIFFT1[k] = fft1;
+	x->BufFFT1[k] = tmp;
+}
+
+void mconv_transformSlice(t_mconv *x, t_int slice, t_int slices) {
+
+	t_int i, start, end;
+
+	start = slice * x->numReady / slices;
+	end = (slice + 1) * x->numReady / slices;
+	for (i=start; i<end; ++i)
+		mconv_transform(x, x->Ready[i]);
+}
+
+// Transform all the full buffers of this round, with the help of the
+// worker threads if there are enough of them.
+void mconv_transformReady(t_mconv *x) {
+
+	t_int slices;
+
+	if (!x->numReady)
+		return;
+	slices = x->numReady / MINCHANSPERTHREAD;
+	if (slices > x->m_numThreads + 1)
+		slices = x->m_numThreads + 1;
+	if (slices > 1) {
+		systhread_mutex_lock(x->m_mutex);
+		if (slices > x->m_numThreads + 1)
+			slices = x->m_numThreads + 1;
+		if (slices > 1) {
+			x->m_jobSlices = slices;
+			x->m_jobDone = 0;
+			x->m_jobCount++;
+			systhread_cond_broadcast(x->m_jobCond);
 		}
+		systhread_mutex_unlock(x->m_mutex);
+	}
+
+	if (slices > 1) {
+		mconv_transformSlice(x, 0, slices);
+		systhread_mutex_lock(x->m_mutex);
+		while (x->m_jobDone < slices - 1)
+			systhread_cond_wait(x->m_doneCond, x->m_mutex);
+		x->m_jobSlices = 0;
+		systhread_cond_broadcast(x->m_doneCond);
+		systhread_mutex_unlock(x->m_mutex);
+	} else {
+		mconv_transformSlice(x, 0, 1);
+	}
+}
 
-		// Output convolved sound
-		if ((x->BufReadPos[k] + n) < x->BufSize) {
-			for (i=0; i<n; ++i)
-				out[i] = x->BufIFFT2[k][i + x->BufReadPos[k]];
-			x->BufReadPos[k] += n;
-
-		} else if ((x->BufReadPos[k] + n) > x->BufSize) { 
-			for (i=0; i<(x->BufSize - x->BufReadPos[k]); ++i)
-				out[i] = x->BufIFFT2[k][i + x->BufReadPos[k]];
-			newReadPos = halfBufSize + n - i;
-			for (i=halfBufSize; i<newReadPos; ++i)
-				out[i] = x->BufIFFT1[k][i];
-			x->BufReadPos[k] = newReadPos;
-
-		} else { // (x->BufReadPos + n) == x->BufSize
-			for (i=0; i<n; ++i)
-				out[i] = x->BufIFFT2[k][i + x->BufReadPos[k]];
-			x->BufReadPos[k] = halfBufSize;
+void *mconv_worker(t_mconv_worker *wk) {
+
+	t_mconv *x = wk->x;
+	t_int slices;
+
+	systhread_mutex_lock(x->m_mutex);
+	while (!x->m_quit) {
+		if (x->m_jobCount == wk->job) {
+			systhread_cond_wait(x->m_jobCond, x->m_mutex);
+			continue;
+		}
+		wk->job = x->m_jobCount;
+		slices = x->m_jobSlices;
+		if (wk->index < slices) {
+			systhread_mutex_unlock(x->m_mutex);
+			mconv_transformSlice(x, wk->index, slices);
+			systhread_mutex_lock(x->m_mutex);
+			x->m_jobDone++;
+			systhread_cond_broadcast(x->m_doneCond);
 		}
-	
 	}
-								
-	return (wAsT_int+3*num+3);
+	systhread_mutex_unlock(x->m_mutex);
+
+	systhread_exit(0);
+	return NULL;
+}
+
+void mconv_stopThreads(t_mconv *x) {
+
+	t_int i, num = x->m_numThreads;
+	unsigned int ret;
+
+	if (!num)
+		return;
+	systhread_mutex_lock(x->m_mutex);
+	x->m_numThreads = 0; // No new jobs...
+	while (x->m_jobSlices) // ...and let the current one finish
+		systhread_cond_wait(x->m_doneCond, x->m_mutex);
+	x->m_quit = 1;
+	systhread_cond_broadcast(x->m_jobCond);
+	systhread_mutex_unlock(x->m_mutex);
+
+	for (i=0; i<num; ++i)
+		systhread_join(x->m_threads[i], &ret);
+	x->m_quit = 0;
+}
+
+// Number of worker threads sharing the FFTs with the perform thread. They only
+// get work when at least MINCHANSPERTHREAD convolutions each are due at once,
+// which mostly means batch mode.
+void mconv_threads(t_mconv *x, long n) {
+
+	t_int i;
+
+	if (n < 0) n = 0;
+	if (n > MAXTHREADS) {
+		post(" Maximum number of threads is %i", MAXTHREADS);
+		n = MAXTHREADS;
+	}
+	mconv_stopThreads(x);
+
+	systhread_mutex_lock(x->m_mutex);
+	for (i=0; i<n; ++i) {
+		x->m_workers[i].x = x;
+		x->m_workers[i].index = i + 1;
+		x->m_workers[i].job = x->m_jobCount;
+	}
+	systhread_mutex_unlock(x->m_mutex);
+
+	for (i=0; i<n; ++i) {
+		if (systhread_create((method)mconv_worker, x->m_workers + i, 0, 0, 0, x->m_threads + i)) {
+			post(" Could only start %i threads", i);
+			break;
+		}
+	}
+
+	systhread_mutex_lock(x->m_mutex);
+	x->m_numThreads = i;
+	systhread_mutex_unlock(x->m_mutex);
+}
+
+// 1: all convolutions in phase, their FFTs are computed together in one
+// batch (and spread over the worker threads). 0: de-synchronised (default).
+void mconv_batch(t_mconv *x, long n) {
+
+	x->m_batch = (n != 0);
+	x->m_align = 1;
 }
 
 void mconv_dsp(t_mconv *x, t_signal **sp, short *connect) {
-	t_int vs = sys_getblksize();
-	t_int i, num = 3*x->m_numConv; // number of Inlets and Outlets 
+	t_int i, num = 3*x->m_numConv; // number of Inlets and Outlets
 	t_int **w = x->w;
 
+	if (x->fftPlan == NULL || x->ifftPlan == NULL) {
+		error("mconv~: no FFT, not convolving");
+		return;
+	}
+
 	w[0] = (t_int *)x;
 	w[1] = (t_int *)sp[0]->s_n;
 
 	for (i=0; i<num; ++i)
 		w[i+2] = (t_int *)sp[i]->s_vec;
-			
+
 	num += 2; // x and n
-	if (vs > x->BufSize) post(" You need to use a smaller signal vector size or a bigger FFT size...",0);
-	else dsp_addv(mconv_perform, num, (void **)w);
+	x->m_align = 1;	// the vector size here may not be the one mconv_new() saw (poly~, subpatchers)
+	dsp_addv(mconv_perform, num, (void **)w);
 }
 
 void *mconv_new(t_symbol *s, short argc, t_atom *argv) {
 
 	t_int i, k;
 	t_int vs = sys_getblksize(); // Size of signal vector selected in MSP
-    t_mconv *x = (t_mconv *)newobject(mconv_class);    
-    t_float ms2samp;    
+    t_mconv *x = (t_mconv *)newobject(mconv_class);
+    t_float ms2samp;
 	t_float Fs = sys_getsr();
-	t_int maxDelayFFT, num;
-			
+	t_int num;
+
 	ms2samp = Fs * 0.001f; // milli-seconds to samples
 
 	// Look at first argument
 	if (argv[0].a_type == A_LONG) x->BufSize = argv[0].a_w.w_long; // Samples
 	else if (argv[0].a_type == A_FLOAT) x->BufSize = (int)(argv[0].a_w.w_float * ms2samp); // Time in ms
 	else x->BufSize = DEFBUFSIZE;
-	
-	x->FFTSize = x->BufSize;
-
-	// Take a convenient FFT Size
-	if (x->BufSize < vs) { 
-		post(" Minimum FFT Size is %i",vs);
-		x->FFTSize = vs;
-		x->BufSize = vs;
+
+	// Take a convenient FFT Size. The buffer size no longer has to be at least
+	// a signal vector: the perform routine handles several frames per vector.
+	if (x->BufSize < CNMAT_FFT_MINSIZE) {
+		post(" Minimum FFT Size is %i",CNMAT_FFT_MINSIZE);
+		x->BufSize = CNMAT_FFT_MINSIZE;
 	}
-	else if ((x->BufSize > vs) && (x->BufSize < 128))  x->FFTSize = 128;
-	else if ((x->BufSize > 128) && (x->BufSize < 256)) x->FFTSize = 256;
-	else if ((x->BufSize > 256) && (x->BufSize < 512)) x->FFTSize = 512;
-	else if ((x->BufSize > 512) && (x->BufSize < 1024)) x->FFTSize = 1024;
-	else if ((x->BufSize > 1024) && (x->BufSize < 2048)) x->FFTSize = 2048;
-	else if ((x->BufSize > 2048) && (x->BufSize < 4096)) x->FFTSize = 4096;
-	else if ((x->BufSize > 4096) && (x->BufSize < 8192)) x->FFTSize = 8192;
-	else if ((x->BufSize > 8192) && (x->BufSize < 16384)) x->FFTSize = 16384;
-	else if ((x->BufSize > 16384) && (x->BufSize < 32768)) x->FFTSize = 32768;
 	else if (x->BufSize > 32768) {
 		post(" Maximum FFT Size is 65536",0);
-		x->FFTSize = 65536;
 		x->BufSize = 65536;
 	}
+	for (x->FFTSize = CNMAT_FFT_MINSIZE; x->FFTSize < x->BufSize; x->FFTSize *= 2)
+		;
+	if ((x->BufSize > vs) && (x->BufSize < 128)) x->FFTSize = 128; // as it always was
 
 	// Look at second argument
 	if (argv[1].a_w.w_sym == ps_rectangular) x->m_window = Recta;
@@ -295,126 +528,139 @@ void *mconv_new(t_symbol *s, short argc, t_atom *argv) {
 		x->m_numConv = 1;
 		post(" The number of convolutions is 1 or more!",0);
 	}
-	
+
 	num = x->m_numConv;
+	x->m_batch = 0;
+	x->m_align = 0;
 
 	// Allocate memory
 	x->bigBuf1 = t_getbytes(num * x->BufSize * sizeof(float));
 	x->bigBuf2 = t_getbytes(num * x->BufSize * sizeof(float));
-	x->bigBuf3 = t_getbytes(num * x->BufSize * sizeof(float));
-	x->bigBuf4 = t_getbytes(num * x->BufSize * sizeof(float));
 	x->Buf1 = t_getbytes(num * sizeof(float*));
 	x->Buf2 = t_getbytes(num * sizeof(float*));
-	x->Buf3 = t_getbytes(num * sizeof(float*));
-	x->Buf4 = t_getbytes(num * sizeof(float*));
-	
-	x->bigBufIFFT1 = t_getbytes(num * x->FFTSize * sizeof(float));
-	x->bigBufIFFT2 = t_getbytes(num * x->FFTSize * sizeof(float));
+
+	x->BufFFT1 = t_getbytes(num * sizeof(float*));
+	x->BufFFT2 = t_getbytes(num * sizeof(float*));
 	x->BufIFFT1 = t_getbytes(num * sizeof(float*));
 	x->BufIFFT2 = t_getbytes(num * sizeof(float*));
-	
+
 	for (k=0; k<num; ++k) {
 		x->Buf1[k] = x->bigBuf1 + k * x->BufSize;
 		x->Buf2[k] = x->bigBuf2 + k * x->BufSize;
-		x->Buf3[k] = x->bigBuf3 + k * x->BufSize;
-		x->Buf4[k] = x->bigBuf4 + k * x->BufSize;
-		x->BufIFFT1[k] = x->bigBufIFFT1 + k * x->FFTSize;
-		x->BufIFFT2[k] = x->bigBufIFFT2 + k * x->FFTSize;
+		for (i=0; i<x->BufSize; ++i) {
+			x->Buf1[k][i] = 0.0f;
+			x->Buf2[k][i] = 0.0f;
+		}
+		x->BufFFT1[k] = cnmat_fft_buffer_new(x->FFTSize);
+		x->BufFFT2[k] = cnmat_fft_buffer_new(x->FFTSize);
+		x->BufIFFT1[k] = cnmat_fft_buffer_new(x->FFTSize);
+		x->BufIFFT2[k] = cnmat_fft_buffer_new(x->FFTSize);
 	}
-	
-	x->BufFFT1 = t_getbytes(x->FFTSize * sizeof(float));
-	x->BufFFT2 = t_getbytes(x->FFTSize * sizeof(float));
-	x->memFFT = t_getbytes(CMAX * x->FFTSize * sizeof(float)); // memory allocated for fft twiddle
+
+	x->fftPlan = cnmat_fft_plan_new(x->FFTSize, CNMAT_FFT_REAL_FORWARD);
+	x->ifftPlan = cnmat_fft_plan_new(x->FFTSize, CNMAT_FFT_REAL_INVERSE);
+	if (x->fftPlan == NULL || x->ifftPlan == NULL)
+		error("mconv~: can't make an FFT of size %ld", (long)x->FFTSize);
 	x->BufWritePos = t_getbytes(num * sizeof(t_int));
 	x->BufReadPos = t_getbytes(num * sizeof(t_int));
+	x->Done = t_getbytes(num * sizeof(t_int));
+	x->Chunk = t_getbytes(num * sizeof(t_int));
+	x->Ready = t_getbytes(num * sizeof(t_int));
 	x->w = t_getbytes((3 * num + 2) * sizeof(t_int*));
 	x->Window = t_getbytes(x->BufSize * sizeof(float));
-	
-	if (x->FFTSize != x->BufSize) {	
+
+	if (x->FFTSize != x->BufSize)
 		x->WindFFT = t_getbytes(x->FFTSize * sizeof(float));
-		maxDelayFFT = x->FFTSize/2;
-	} else { 
+	else
 		x->WindFFT = x->Window;
-		maxDelayFFT = x->FFTSize;
-	}
-	
+
+	x->m_numThreads = 0;
+	x->m_workers = t_getbytes(MAXTHREADS * sizeof(t_mconv_worker));
+	x->m_threads = t_getbytes(MAXTHREADS * sizeof(t_systhread));
+	x->m_jobSlices = 0;
+	x->m_jobDone = 0;
+	x->m_jobCount = 0;
+	x->m_quit = 0;
+	systhread_mutex_new(&x->m_mutex, 0);
+	systhread_cond_new(&x->m_jobCond, 0);
+	systhread_cond_new(&x->m_doneCond, 0);
+
 	// Create inlets and outlets
 	dsp_setup((t_pxobject *)x, 2*num);
 	x->m_obj.z_misc = Z_NO_INPLACE; // Necessary when outlets should have different vectors than inlets !!
 	for (i=0; i<num; ++i)
 		outlet_new((t_object *)x, "signal");
 
-	// De-Synchronise FFT events
-	for (k=0; k<num; ++k) {
-		x->BufWritePos[k] = k*vs % maxDelayFFT;		// This is the trick to de-synchronise FFTs
-		x->BufReadPos[k] = (k+1)*vs % maxDelayFFT;	// And this is the trick to output at the right time
-	}	
+	// De-Synchronise FFT events and clean the IFFT buffers
+	mconv_align(x, vs);
 
 	// Compute and store Windows
 	if ((x->m_window > Recta) && (x->m_window <= Black)) {
-		
+
 		switch (x->m_window) {
 
 			case Hann: 	for (i=0; i<x->BufSize; ++i)
 							x->Window[i] = HANNING_W(i, x->BufSize);
-						if (x->FFTSize != x->BufSize)	
+						if (x->FFTSize != x->BufSize)
 							for (i=0; i<x->FFTSize; ++i)
 								x->WindFFT[i] = HANNING_W(i, x->FFTSize);
  						break;
 			case Hamm:	for (i=0; i<x->BufSize; ++i)
 							x->Window[i] = HAMMING_W(i, x->BufSize);
-						if (x->FFTSize != x->BufSize)	
+						if (x->FFTSize != x->BufSize)
 							for (i=0; i<x->FFTSize; ++i)
 								x->WindFFT[i] = HAMMING_W(i, x->FFTSize);
 						break;
 			case Black: for (i=0; i<x->BufSize; ++i)
 							x->Window[i] = BLACKMAN_W(i, x->BufSize);
-						if (x->FFTSize != x->BufSize)	
+						if (x->FFTSize != x->BufSize)
 							for (i=0; i<x->FFTSize; ++i)
 								x->WindFFT[i] = BLACKMAN_W(i, x->FFTSize);
 						break;
 		}
-	}		
-
-	// Clean IFFT1
-	for (k=0; k<num; ++k) {
-		for (i=0; i<x->FFTSize; ++i) {
-			x->BufIFFT1[k][i] = 0.0f;
-			x->BufIFFT2[k][i] = 0.0f;
-		}
 	}
-	
+
     return (x);
 }
 
 void  mconv_free(t_mconv *x) {
 
-	t_int num = x->m_numConv; 
+	t_int k, num = x->m_numConv;
+
+	dsp_free((t_pxobject *)x);
+
+	mconv_stopThreads(x);
+	systhread_cond_free(x->m_jobCond);
+	systhread_cond_free(x->m_doneCond);
+	systhread_mutex_free(x->m_mutex);
+	if (x->m_workers) t_freebytes(x->m_workers, MAXTHREADS * sizeof(t_mconv_worker));
+	if (x->m_threads) t_freebytes(x->m_threads, MAXTHREADS * sizeof(t_systhread));
 
 	if (x->Buf1) t_freebytes(x->Buf1, num * sizeof(float*));
 	if (x->Buf2) t_freebytes(x->Buf2, num * sizeof(float*));
-	if (x->Buf3) t_freebytes(x->Buf3, num * sizeof(float*));
-	if (x->Buf4) t_freebytes(x->Buf4, num * sizeof(float*));
 	if (x->bigBuf1) t_freebytes(x->bigBuf1, num * x->BufSize * sizeof(float));
 	if (x->bigBuf2) t_freebytes(x->bigBuf2, num * x->BufSize * sizeof(float));
-	if (x->bigBuf3) t_freebytes(x->bigBuf3, num * x->BufSize * sizeof(float));
-	if (x->bigBuf4) t_freebytes(x->bigBuf4, num * x->BufSize * sizeof(float));
 
+	for (k=0; k<num; ++k) {
+		if (x->BufFFT1) cnmat_fft_buffer_free(x->BufFFT1[k]);
+		if (x->BufFFT2) cnmat_fft_buffer_free(x->BufFFT2[k]);
+		if (x->BufIFFT1) cnmat_fft_buffer_free(x->BufIFFT1[k]);
+		if (x->BufIFFT2) cnmat_fft_buffer_free(x->BufIFFT2[k]);
+	}
+	if (x->BufFFT1) t_freebytes(x->BufFFT1, num * sizeof(float*));
+	if (x->BufFFT2) t_freebytes(x->BufFFT2, num * sizeof(float*));
 	if (x->BufIFFT1) t_freebytes(x->BufIFFT1, num * sizeof(float*));
 	if (x->BufIFFT2) t_freebytes(x->BufIFFT2, num * sizeof(float*));
-	if (x->bigBufIFFT1) t_freebytes(x->bigBufIFFT1, num * x->FFTSize * sizeof(float));
-	if (x->bigBufIFFT2) t_freebytes(x->bigBufIFFT2, num * x->FFTSize * sizeof(float));
+	cnmat_fft_plan_free(x->fftPlan);
+	cnmat_fft_plan_free(x->ifftPlan);
 
-	if (x->BufFFT1) t_freebytes(x->BufFFT1, x->FFTSize * sizeof(float));
-	if (x->BufFFT2) t_freebytes(x->BufFFT2, x->FFTSize * sizeof(float));
-	if (x->memFFT) t_freebytes(x->memFFT, CMAX * x->FFTSize * sizeof(float));
 	if (x->BufWritePos) t_freebytes(x->BufWritePos, num * sizeof(t_int));
 	if (x->BufReadPos) t_freebytes(x->BufReadPos, num * sizeof(t_int));
+	if (x->Done) t_freebytes(x->Done, num * sizeof(t_int));
+	if (x->Chunk) t_freebytes(x->Chunk, num * sizeof(t_int));
+	if (x->Ready) t_freebytes(x->Ready, num * sizeof(t_int));
 	if (x->w) t_freebytes(x->w, (3 * num + 2) * sizeof(t_int*));
 	if (x->Window) t_freebytes(x->Window, x->BufSize * sizeof(float));
-	if (x->FFTSize != x->BufSize)	
+	if (x->FFTSize != x->BufSize)
 		if (x->WindFFT) t_freebytes(x->WindFFT, x->FFTSize * sizeof(float));
-
-	dsp_free((t_pxobject *)x);
 }
-
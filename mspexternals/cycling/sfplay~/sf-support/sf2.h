@@ -53,6 +53,7 @@ typedef struct _sfile
 	long s_susloopstart;	// in samples (frames)
 	long s_susloopend;		// in samples (frames)
 	t_asyncfile *s_asyncfile;
+	struct _sfcachefile *s_cache;	// shared cache entry (sf_cache.c), NULL if none
 } t_sfile;
 
 typedef struct _cue
@@ -132,6 +133,15 @@ long sfile_waveopen(t_sfile *s, t_symbol *name, short vol, long flags);
 void sfile_async_done(t_asyncfile_params *p);
 
 long sfile_rawopen(t_sfile *s, t_symbol *name, short vol, long flags);
+// sf_cache.c
+void sf_cache_init(void);
+void sf_cache_attach(t_sfile *s, short vol);
+void sf_cache_detach(t_sfile *s);
+long sf_cache_read(t_sfile *s, long position, long bytes, char *dst);	// absolute position, all or nothing
+void sf_cache_store(t_sfile *s, long position, long bytes, char *src);
+void sf_cache_prefetch(t_sfile *s, long position, long bytes);
+void sf_cache_setmmap(long bytes);	// map files up to this size, 0 = never
+void sf_cache_print(void *x);
 // sf_conversion.c
 double sf_mulaw_decode(unsigned char ulaw); 
 double sf_alaw_decode(unsigned char alaw); 
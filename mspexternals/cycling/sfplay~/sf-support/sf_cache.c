@@ -0,0 +1,534 @@
+
+
+#include "ext.h"
+#include "ext_path.h"
+#include "ext_critical.h"
+#include "sf2.h" // the header for sf_cache.c
+
+#ifdef WIN_VERSION
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// Process-wide read-ahead cache shared by every sfplay~ instance.
+//
+// Files are identified by name, path and data size, so instances playing the
+// same file share one entry.  Sound data lives in a fixed pool of blocks
+// allocated when the first file is attached, so nothing is allocated from the
+// perform routine.  Each block remembers which part of it holds file data:
+// read-through stores from the players fill in partial blocks, prefetches load
+// whole ones.  Files up to the mmap limit are mapped instead and never use
+// the pool.
+
+enum {
+	SF_CACHE_BLOCKSIZE = 65536,
+	SF_CACHE_BLOCKS = 256,			// 16 MB
+	SF_CACHE_HASHSIZE = 512,		// power of two
+	SF_CACHE_WAITTIME = 2000
+};
+
+typedef struct _sfcacheblock
+{
+	struct _sfcacheblock *b_hnext;	// hash chain
+	struct _sfcacheblock *b_prev;	// lru list, most recently used first
+	struct _sfcacheblock *b_next;
+	struct _sfcachefile *b_file;	// owner, NULL if unused
+	long b_index;			// block number in the file
+	long b_lo;				// b_data[b_lo..b_hi) holds file data
+	long b_hi;
+	long b_loading;			// prefetch read in flight
+	char *b_data;
+} t_sfcacheblock;
+
+typedef struct _sfcachefile
+{
+	struct _sfcachefile *f_next;
+	t_symbol *f_name;
+	short f_vol;
+	long f_end;				// end of the sample data in bytes
+	long f_refcount;		// how many sfiles are attached?
+	long f_pending;			// prefetch reads in flight
+	t_asyncfile *f_asyncfile;	// for prefetching, opened on first use
+	char *f_map;			// whole file, if mapped
+	long f_maplen;
+#ifdef WIN_VERSION
+	HANDLE f_mapping;
+#endif
+} t_sfcachefile;
+
+typedef struct _sfcache
+{
+	t_critical c_lock;
+	t_sfcacheblock *c_blocks;
+	char *c_data;
+	t_sfcacheblock *c_hash[SF_CACHE_HASHSIZE];
+	t_sfcacheblock *c_head;	// lru list
+	t_sfcacheblock *c_tail;
+	t_sfcachefile *c_files;
+	long c_mmapmax;			// map files up to this many bytes, 0 = never
+	long c_hits;
+	long c_misses;
+	long c_prefetched;
+	t_asyncfile_cb c_prefetch_cb;
+} t_sfcache;
+
+static t_sfcache sf_cache;
+
+void sf_cache_prefetch_done(t_asyncfile_params *p);
+
+void sf_cache_init(void)
+{
+	if (sf_cache.c_prefetch_cb)
+		return;
+	critical_new(&sf_cache.c_lock);
+	sf_cache.c_prefetch_cb = asyncfile_callback_new((method)sf_cache_prefetch_done);
+}
+
+static t_sfcacheblock **sf_cache_slot(t_sfcachefile *f, long index)
+{
+	unsigned long h = ((unsigned long)f >> 4) + (unsigned long)index * 2654435761UL;
+
+	return &sf_cache.c_hash[h & (SF_CACHE_HASHSIZE - 1)];
+}
+
+static t_sfcacheblock *sf_cache_lookup(t_sfcachefile *f, long index)
+{
+	t_sfcacheblock *b;
+
+	for (b = *sf_cache_slot(f,index); b; b = b->b_hnext)
+		if (b->b_file == f && b->b_index == index)
+			return b;
+	return NULL;
+}
+
+static void sf_cache_unlink(t_sfcacheblock *b)
+{
+	if (b->b_prev)
+		b->b_prev->b_next = b->b_next;
+	else
+		sf_cache.c_head = b->b_next;
+	if (b->b_next)
+		b->b_next->b_prev = b->b_prev;
+	else
+		sf_cache.c_tail = b->b_prev;
+}
+
+static void sf_cache_touch(t_sfcacheblock *b)
+{
+	if (b == sf_cache.c_head)
+		return;
+	sf_cache_unlink(b);
+	b->b_prev = NULL;
+	b->b_next = sf_cache.c_head;
+	sf_cache.c_head->b_prev = b;
+	sf_cache.c_head = b;
+}
+
+static void sf_cache_unhash(t_sfcacheblock *b)
+{
+	t_sfcacheblock **bp;
+
+	for (bp = sf_cache_slot(b->b_file,b->b_index); *bp; bp = &(*bp)->b_hnext) {
+		if (*bp == b) {
+			*bp = b->b_hnext;
+			break;
+		}
+	}
+	b->b_hnext = NULL;
+	b->b_file = NULL;
+}
+
+// recycle the least recently used block that has no read in flight
+static t_sfcacheblock *sf_cache_take(t_sfcachefile *f, long index)
+{
+	t_sfcacheblock *b, **bp;
+
+	for (b = sf_cache.c_tail; b && b->b_loading; b = b->b_prev)
+		;
+	if (!b)
+		return NULL;
+	if (b->b_file)
+		sf_cache_unhash(b);
+	b->b_file = f;
+	b->b_index = index;
+	b->b_lo = b->b_hi = 0;
+	bp = sf_cache_slot(f,index);
+	b->b_hnext = *bp;
+	*bp = b;
+	sf_cache_touch(b);
+	return b;
+}
+
+static long sf_cache_newpool(void)
+{
+	long i;
+
+	sf_cache.c_blocks = (t_sfcacheblock *)sysmem_newptrclear(SF_CACHE_BLOCKS * sizeof(t_sfcacheblock));
+	sf_cache.c_data = sysmem_newptr(SF_CACHE_BLOCKS * (long)SF_CACHE_BLOCKSIZE);
+	if (!sf_cache.c_blocks || !sf_cache.c_data) {
+		if (sf_cache.c_blocks)
+			sysmem_freeptr(sf_cache.c_blocks);
+		if (sf_cache.c_data)
+			sysmem_freeptr(sf_cache.c_data);
+		sf_cache.c_blocks = NULL;
+		sf_cache.c_data = NULL;
+		return 0;
+	}
+	for (i = 0; i < SF_CACHE_BLOCKS; i++) {
+		sf_cache.c_blocks[i].b_data = sf_cache.c_data + i * (long)SF_CACHE_BLOCKSIZE;
+		sf_cache.c_blocks[i].b_prev = i ? sf_cache.c_blocks + i - 1 : NULL;
+		sf_cache.c_blocks[i].b_next = i < SF_CACHE_BLOCKS - 1 ? sf_cache.c_blocks + i + 1 : NULL;
+	}
+	sf_cache.c_head = sf_cache.c_blocks;
+	sf_cache.c_tail = sf_cache.c_blocks + SF_CACHE_BLOCKS - 1;
+	setmem(sf_cache.c_hash,sizeof(sf_cache.c_hash),0);
+	return 1;
+}
+
+static void sf_cache_freepool(void)
+{
+	sysmem_freeptr(sf_cache.c_blocks);
+	sysmem_freeptr(sf_cache.c_data);
+	sf_cache.c_blocks = NULL;
+	sf_cache.c_data = NULL;
+	sf_cache.c_head = sf_cache.c_tail = NULL;
+}
+
+static void sf_cache_map(t_sfcachefile *f)
+{
+	char native[MAX_PATH_CHARS];
+#ifdef WIN_VERSION
+	HANDLE h;
+	LARGE_INTEGER size;
+#else
+	struct stat st;
+	void *p;
+	int fd;
+#endif
+
+	if (path_toabsolutesystempath(f->f_vol,f->f_name->s_name,native))
+		return;
+#ifdef WIN_VERSION
+	h = CreateFile(native,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+	if (h == INVALID_HANDLE_VALUE)
+		return;
+	if (!GetFileSizeEx(h,&size) || size.QuadPart < f->f_end || size.QuadPart > sf_cache.c_mmapmax) {
+		CloseHandle(h);
+		return;
+	}
+	f->f_mapping = CreateFileMapping(h,NULL,PAGE_READONLY,0,0,NULL);
+	CloseHandle(h);
+	if (!f->f_mapping)
+		return;
+	if (!(f->f_map = (char *)MapViewOfFile(f->f_mapping,FILE_MAP_READ,0,0,0))) {
+		CloseHandle(f->f_mapping);
+		return;
+	}
+	f->f_maplen = (long)size.QuadPart;
+#else
+	if ((fd = open(native,O_RDONLY)) < 0)
+		return;
+	if (fstat(fd,&st) || st.st_size < f->f_end || st.st_size > sf_cache.c_mmapmax) {
+		close(fd);
+		return;
+	}
+	p = mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+	close(fd);
+	if (p == MAP_FAILED)
+		return;
+	// ask for all of it now, so the perform routine doesn't fault pages in
+	madvise(p,(size_t)st.st_size,MADV_WILLNEED);
+	f->f_map = (char *)p;
+	f->f_maplen = (long)st.st_size;
+#endif
+}
+
+static void sf_cache_unmap(t_sfcachefile *f)
+{
+	if (!f->f_map)
+		return;
+#ifdef WIN_VERSION
+	UnmapViewOfFile(f->f_map);
+	CloseHandle(f->f_mapping);
+#else
+	munmap(f->f_map,(size_t)f->f_maplen);
+#endif
+	f->f_map = NULL;
+}
+
+static short sf_cache_spinwait(long *p)
+{
+	double start,time;
+
+	clock_getftime(&start);
+	time = start;
+	while (time - start < SF_CACHE_WAITTIME) {
+		if (!*(volatile long *)p)
+			return false;
+		clock_getftime(&time);
+	}
+	return true;
+}
+
+// attach and detach are only called from the main thread (sfile_open/sfile_close)
+
+void sf_cache_attach(t_sfile *s, short vol)
+{
+	t_sfcachefile *f;
+	long end = s->s_offset + s->s_size;
+
+	s->s_cache = NULL;
+	if (!sf_cache.c_prefetch_cb)
+		return;
+	for (f = sf_cache.c_files; f; f = f->f_next) {
+		if (f->f_name == s->s_name && f->f_vol == vol && f->f_end == end) {
+			f->f_refcount++;
+			s->s_cache = f;
+			return;
+		}
+	}
+	if (!sf_cache.c_blocks && !sf_cache_newpool())
+		return;
+	if (!(f = (t_sfcachefile *)sysmem_newptrclear(sizeof(t_sfcachefile))))
+		return;
+	f->f_name = s->s_name;
+	f->f_vol = vol;
+	f->f_end = end;
+	f->f_refcount = 1;
+	if (sf_cache.c_mmapmax > 0 && end <= sf_cache.c_mmapmax)
+		sf_cache_map(f);
+	critical_enter(sf_cache.c_lock);
+	f->f_next = sf_cache.c_files;
+	sf_cache.c_files = f;
+	critical_exit(sf_cache.c_lock);
+	s->s_cache = f;
+}
+
+void sf_cache_detach(t_sfile *s)
+{
+	t_sfcachefile *f = s->s_cache, **fp;
+	long i, empty;
+
+	if (!f)
+		return;
+	s->s_cache = NULL;
+	if (--f->f_refcount > 0)
+		return;
+	// a prefetch still writing into the pool keeps the entry alive; a later
+	// attach of the same file picks it up again
+	if (sf_cache_spinwait(&f->f_pending)) {
+		error("sfplay~: %s: cache prefetch timeout",f->f_name->s_name);
+		return;
+	}
+	critical_enter(sf_cache.c_lock);
+	for (i = 0; i < SF_CACHE_BLOCKS; i++) {
+		t_sfcacheblock *b = sf_cache.c_blocks + i;
+
+		if (b->b_file == f) {
+			sf_cache_unhash(b);
+			b->b_lo = b->b_hi = 0;
+		}
+	}
+	for (fp = &sf_cache.c_files; *fp; fp = &(*fp)->f_next) {
+		if (*fp == f) {
+			*fp = f->f_next;
+			break;
+		}
+	}
+	empty = !sf_cache.c_files;
+	critical_exit(sf_cache.c_lock);
+
+	if (f->f_asyncfile)
+		asyncfile_close(f->f_asyncfile);
+	sf_cache_unmap(f);
+	sysmem_freeptr(f);
+	if (empty)
+		sf_cache_freepool();
+}
+
+// Copy bytes at absolute file position into dst if the cache holds all of
+// them.  Returns bytes on a hit, 0 on a miss: a partial hit still costs a
+// disk read, so it isn't worth splitting the request.  Safe at interrupt level.
+
+long sf_cache_read(t_sfile *s, long position, long bytes, char *dst)
+{
+	t_sfcachefile *f = s->s_cache;
+	t_sfcacheblock *b;
+	long pos, end, index, lo, hi;
+
+	if (!f || bytes <= 0 || position < 0)
+		return 0;
+	end = position + bytes;
+	if (f->f_map) {
+		if (end > f->f_maplen)
+			return 0;
+		sysmem_copyptr(f->f_map + position,dst,bytes);
+		sf_cache.c_hits++;	// stats only, no need to lock
+		return bytes;
+	}
+	critical_enter(sf_cache.c_lock);
+	for (pos = position; pos < end; pos = (index + 1) * SF_CACHE_BLOCKSIZE) {
+		index = pos / SF_CACHE_BLOCKSIZE;
+		lo = pos - index * SF_CACHE_BLOCKSIZE;
+		hi = MIN(end - index * SF_CACHE_BLOCKSIZE, SF_CACHE_BLOCKSIZE);
+		b = sf_cache_lookup(f,index);
+		if (!b || b->b_loading || b->b_lo > lo || b->b_hi < hi) {
+			sf_cache.c_misses++;
+			critical_exit(sf_cache.c_lock);
+			return 0;
+		}
+	}
+	for (pos = position; pos < end; pos = (index + 1) * SF_CACHE_BLOCKSIZE) {
+		index = pos / SF_CACHE_BLOCKSIZE;
+		lo = pos - index * SF_CACHE_BLOCKSIZE;
+		hi = MIN(end - index * SF_CACHE_BLOCKSIZE, SF_CACHE_BLOCKSIZE);
+		b = sf_cache_lookup(f,index);
+		sysmem_copyptr(b->b_data + lo,dst + (pos - position),hi - lo);
+		sf_cache_touch(b);
+	}
+	sf_cache.c_hits++;
+	critical_exit(sf_cache.c_lock);
+	return bytes;
+}
+
+// Read-through: keep a copy of data just read from disk.  A block holds one
+// contiguous span; data that doesn't touch it replaces it only if longer.
+
+void sf_cache_store(t_sfile *s, long position, long bytes, char *src)
+{
+	t_sfcachefile *f = s->s_cache;
+	t_sfcacheblock *b;
+	long pos, end, index, lo, hi;
+
+	if (!f || f->f_map || bytes <= 0 || position < 0)
+		return;
+	end = position + bytes;
+	critical_enter(sf_cache.c_lock);
+	for (pos = position; pos < end; pos = (index + 1) * SF_CACHE_BLOCKSIZE) {
+		index = pos / SF_CACHE_BLOCKSIZE;
+		lo = pos - index * SF_CACHE_BLOCKSIZE;
+		hi = MIN(end - index * SF_CACHE_BLOCKSIZE, SF_CACHE_BLOCKSIZE);
+		if (!(b = sf_cache_lookup(f,index)) && !(b = sf_cache_take(f,index)))
+			break;
+		if (b->b_loading)
+			continue;
+		if (b->b_hi <= b->b_lo) {
+			b->b_lo = lo;
+			b->b_hi = hi;
+		} else if (hi < b->b_lo || lo > b->b_hi) {
+			if (hi - lo <= b->b_hi - b->b_lo)
+				continue;
+			b->b_lo = lo;
+			b->b_hi = hi;
+		} else {
+			b->b_lo = MIN(b->b_lo, lo);
+			b->b_hi = MAX(b->b_hi, hi);
+		}
+		sysmem_copyptr(src + (pos - position),b->b_data + lo,hi - lo);
+		sf_cache_touch(b);
+	}
+	critical_exit(sf_cache.c_lock);
+}
+
+// Start loading the blocks covering [position, position+bytes) that aren't
+// already complete.  Main thread only.
+
+void sf_cache_prefetch(t_sfile *s, long position, long bytes)
+{
+	t_sfcachefile *f = s->s_cache;
+	t_sfcacheblock *b;
+	t_asyncfile_params *p;
+	long pos, end, index, len;
+	char ps[256];
+
+	if (!f || f->f_map || bytes <= 0 || position < 0)
+		return;
+	if (!f->f_asyncfile) {
+		strcpy(ps,f->f_name->s_name);
+		if (asyncfile_create(ps,f->f_vol,READ_PERM,0,&f->f_asyncfile,ASYNCFILE_NO_CACHE)) {
+			f->f_asyncfile = NULL;
+			return;
+		}
+	}
+	end = MIN(position + bytes, f->f_end);
+	for (pos = position; pos < end; pos = (index + 1) * SF_CACHE_BLOCKSIZE) {
+		index = pos / SF_CACHE_BLOCKSIZE;
+		len = MIN(f->f_end - index * SF_CACHE_BLOCKSIZE, SF_CACHE_BLOCKSIZE);
+		critical_enter(sf_cache.c_lock);
+		if ((b = sf_cache_lookup(f,index)) && (b->b_loading || (b->b_lo == 0 && b->b_hi >= len))) {
+			if (!b->b_loading)
+				sf_cache_touch(b);
+			critical_exit(sf_cache.c_lock);
+			continue;
+		}
+		if (b || (b = sf_cache_take(f,index))) {
+			b->b_loading = 1;
+			b->b_lo = b->b_hi = 0;
+			f->f_pending++;
+		}
+		critical_exit(sf_cache.c_lock);
+		if (!b || !(p = asyncfile_params_new())) {
+			if (b) {
+				critical_enter(sf_cache.c_lock);
+				b->b_loading = 0;
+				f->f_pending--;
+				critical_exit(sf_cache.c_lock);
+			}
+			break;
+		}
+		p->file = f->f_asyncfile;
+		p->buf = b->b_data;
+		p->requestcount = len;
+		p->position = index * SF_CACHE_BLOCKSIZE;
+		p->arg = b;
+		p->callback = sf_cache.c_prefetch_cb;
+		asyncfile_read(p);
+	}
+}
+
+void sf_cache_prefetch_done(t_asyncfile_params *p)
+{
+	t_sfcacheblock *b = (t_sfcacheblock *)p->arg;
+
+	critical_enter(sf_cache.c_lock);
+	b->b_loading = 0;
+	if (!p->result) {
+		b->b_lo = 0;
+		b->b_hi = p->actualcount;
+		sf_cache.c_prefetched++;
+	}
+	b->b_file->f_pending--;
+	critical_exit(sf_cache.c_lock);
+	asyncfile_params_free(p);
+}
+
+void sf_cache_setmmap(long bytes)
+{
+	sf_cache.c_mmapmax = bytes < 0 ? 0 : bytes;
+}
+
+void sf_cache_print(void *x)
+{
+	t_sfcachefile *f;
+	long i, used = 0, files = 0, mapped = 0;
+
+	critical_enter(sf_cache.c_lock);
+	for (f = sf_cache.c_files; f; f = f->f_next) {
+		files++;
+		if (f->f_map)
+			mapped++;
+	}
+	if (sf_cache.c_blocks)
+		for (i = 0; i < SF_CACHE_BLOCKS; i++)
+			if (sf_cache.c_blocks[i].b_file)
+				used++;
+	critical_exit(sf_cache.c_lock);
+	object_post((t_object *)x, " cache: %ld files (%ld mapped), %ld of %ld blocks used",
+		files,mapped,used,(long)SF_CACHE_BLOCKS);
+	object_post((t_object *)x, " cache: %ld hits %ld misses %ld blocks prefetched",
+		sf_cache.c_hits,sf_cache.c_misses,sf_cache.c_prefetched);
+}
@@ -33,6 +33,7 @@ void sched_cue_read(void *x, t_symbol *s, short argc, t_atom *argv);
 long cue_read(t_cue_read_req *crr);
 long cue_read_rev(t_cue_read_req *crr);
 long cue_read_sus(t_cue_read_req *crr);
+long cue_read_cached(t_cue_read_req *crr, t_asyncfile_params *p);
 void cue_done(t_asyncfile_params *p);
 void cue_done_rev(t_asyncfile_params *p);
 void cue_done_sus(t_asyncfile_params *p);
@@ -391,6 +392,16 @@ void sched_cue_read(void *x, t_symbol *s, short argc, t_atom *argv)
 	}
 }
 
+// another instance may have the same region in the shared cache already
+long cue_read_cached(t_cue_read_req *crr, t_asyncfile_params *p)
+{
+	if (!sf_cache_read(crr->c_s,p->position,p->requestcount,(char *)p->buf))
+		return 0;
+	p->actualcount = p->requestcount;
+	p->result = 0;
+	return 1;
+}
+
 // could merge read + read rev into one function
 long cue_read(t_cue_read_req *crr)
 {
@@ -404,6 +415,10 @@ long cue_read(t_cue_read_req *crr)
 
 	crr->c_s->s_busy = 1;
 	crr->c_cue->c_busy = 1;
+	if (cue_read_cached(crr,p)) {
+		cue_done(p);
+		return 0;
+	}
 	p->callback = cue_async_cb;
 	asyncfile_read(p);
 	return 0;
@@ -425,6 +440,10 @@ long cue_read_rev(t_cue_read_req *crr)
 
 	crr->c_s->s_busy = 1;
 	crr->c_cue->c_busy = 1;
+	if (cue_read_cached(crr,p)) {
+		cue_done_rev(p);
+		return 0;
+	}
 	p->callback = cue_async_cb_rev;
 	asyncfile_read(p);
 	return 0;
@@ -445,6 +464,10 @@ long cue_read_sus(t_cue_read_req *crr)
 
 	crr->c_s->s_busy = 1;
 	crr->c_cue->c_busy = 1;
+	if (cue_read_cached(crr,p)) {
+		cue_done_sus(p);
+		return 0;
+	}
 	p->callback = cue_async_cb_sus;
 	asyncfile_read(p);
 	return 0;
@@ -454,6 +477,8 @@ void cue_done(t_asyncfile_params *p)
 {
 	t_cue_read_req *crr = (t_cue_read_req *)p->arg;
 	
+	if (!p->result)
+		sf_cache_store(crr->c_s,p->position,p->actualcount,(char *)p->buf);
 	if (p->result||(!crr->c_tmpcue->c_bidir)) {
 		cue_done_epilog(crr->c_obj, crr, p->result);
 	} else if (crr->c_tmpcue->c_bidir) {
@@ -541,7 +566,13 @@ void cue_done_epilog_doit(void *x, t_symbol *s, short argc, t_atom *argv)
 				t_freebytes(tmprev,sizerev);
 			if (tmpsus)
 				t_freebytes(tmpsus,sizesus);
-			err = 0;		
+			err = 0;
+			
+			// warm the shared cache with what follows the preload: that's where
+			// the first disk reads land once the cue starts
+			sf_cache_prefetch(crr->c_cue->c_parent,
+				crr->c_cue->c_parent->s_offset + crr->c_cue->c_byteoffset + crr->c_cue->c_pds,
+				2 * (long)mess0(crr->c_obj,ps_getbufsize));
 		}
 		crr->c_s->s_busy = 0;
 		crr->c_cue->c_busy = 0;
@@ -556,6 +587,8 @@ void cue_done_rev(t_asyncfile_params *p)
 {
 	t_cue_read_req *crr = (t_cue_read_req *)p->arg;
 	
+	if (!p->result)
+		sf_cache_store(crr->c_s,p->position,p->actualcount,(char *)p->buf);
 	//cue_done_epilog(crr->c_obj, crr, p->result);
 	if (!crr->c_tmpcue->c_susloop) {
 		cue_done_epilog(crr->c_obj, crr, p->result);
@@ -570,6 +603,8 @@ void cue_done_sus(t_asyncfile_params *p)
 {
 	t_cue_read_req *crr = (t_cue_read_req *)p->arg;
 	
+	if (!p->result)
+		sf_cache_store(crr->c_s,p->position,p->actualcount,(char *)p->buf);
 	cue_done_epilog(crr->c_obj, crr, p->result);
 	asyncfile_params_free(p);
 }
@@ -29,6 +29,7 @@ void sfile_free(t_sfile *s)
 void sfile_close(t_sfile *s)
 {
 	s->s_open = 0;
+	sf_cache_detach(s);
 	if (s->s_refnum) {
 		sysfile_close(s->s_refnum);
 		s->s_refnum = 0;
@@ -51,6 +52,7 @@ long sfile_open(t_sfile *s, t_symbol *name, short vol, unsigned long filetype, l
 
 	s->s_refnum = 0;
 	s->s_asyncfile = NULL;
+	s->s_cache = NULL;
 
 	if (filetype==SF_FILETYPE_RAW) {
 		//default values
@@ -122,6 +124,8 @@ long sfile_open(t_sfile *s, t_symbol *name, short vol, unsigned long filetype, l
 		
 //	post("loop points in file: %ld %ld", s->s_susloopstart, s->s_susloopend);
 	
+	if (s->s_asyncfile)
+		sf_cache_attach(s,vol);
 	
 	return 0;
 }
@@ -82,6 +82,7 @@ typedef struct _sfplay
 	long p_process;				// in process, prevents file-reading
 	long p_invalid;				// in reading
 	IOREQTYPE *p_iorequest;		// for perform routine only. avoids memory allocation deadlock
+	t_sfile *p_readfile;		// file p_iorequest is reading from disk, for the shared cache
 	long p_looppalin;
 	void *p_loopclock;
 	void *p_updateclock;
@@ -108,6 +109,7 @@ void sfplay_open(t_sfplay *x, t_symbol *s);
 void sfplay_dofclose(t_sfplay *x, t_symbol *s);
 void sfplay_fclose(t_sfplay *x, t_symbol *s);
 void sfplay_print(t_sfplay *x);
+void sfplay_mmap(t_sfplay *x, long n);
 void sfplay_pause(t_sfplay *x);
 void sfplay_resume(t_sfplay *x);
 void sfplay_seek(t_sfplay *x, double start, double end);
@@ -227,6 +229,7 @@ int main(void)
 	class_addmethod(c, (method)sfplay_float, 	"float", A_FLOAT, 0);
 	class_addmethod(c, (method)sfplay_list, 	"list", 	A_GIMME, 0);
 	class_addmethod(c, (method)sfplay_print, 	"print" , 	0);
+	class_addmethod(c, (method)sfplay_mmap, 	"mmap" , 	A_LONG, 0);
 	class_addmethod(c, (method)sfplay_pause, 	"pause", 	0);
 	class_addmethod(c, (method)sfplay_resume, 	"resume", 	0);
 	class_addmethod(c, (method)cue_preload, 	"preload", 	A_GIMME, 0);
@@ -335,6 +338,7 @@ int main(void)
 	sfplay_class = c;
 	
 	cue_init(); //same cue code now supports both sfplay + sflist
+	sf_cache_init();
 	
 	return 0;
 }
@@ -875,11 +879,22 @@ long sfplay_doread(t_sfplay *x, t_aqueue *aq, t_cue *c, long async, long reverse
 		p->requestcount = bytes;
 		p->position = offset;
 		p->arg = x;
-		if (async) {
+		if (sf_cache_read(s,offset,bytes,ptr)) {
+			// served from the shared cache, finish it like a sync read
+			x->p_readfile = NULL;
+			p->actualcount = bytes;
+			p->result = 0;
+			if (reverse)
+				sfplay_done_rev(p);
+			else
+				sfplay_done(p);
+		} else if (async) {
+			x->p_readfile = s;
 			p->callback = reverse ? sfplay_async_cb_rev : sfplay_async_cb;
 			asyncfile_read(p);
 			return 0;
 		} else {
+			x->p_readfile = s;
 			p->flags |= ASYNCFILE_SYNC;
 			asyncfile_read(p);
 			if (reverse)
@@ -897,6 +912,8 @@ void sfplay_done(t_asyncfile_params *p)
 {
 	t_sfplay *x = (t_sfplay *)p->arg;
 
+	if (!p->result && x->p_readfile)
+		sf_cache_store(x->p_readfile,p->position,p->actualcount,p->buf);
 	if (!x->p_switch) {
 		aq_incrtail(x->p_aq,p->actualcount);
 		x->p_where += p->actualcount;
@@ -917,6 +934,8 @@ void sfplay_done_rev(t_asyncfile_params *p)
 {
 	t_sfplay *x = (t_sfplay *)p->arg;
 
+	if (!p->result && x->p_readfile)
+		sf_cache_store(x->p_readfile,p->position,p->actualcount,p->buf);
 	if (!x->p_switch) {
 		aq_incrtail_rev(x->p_aq,p->actualcount);
 		x->p_where -= p->actualcount;
@@ -1005,6 +1024,7 @@ void sfplay_doopen(t_sfplay *x, t_symbol *name)
 	preload = (preload / framesize) * framesize;
 	x->p_one.c_pds = MIN(total,preload);
 	sfplay_sfile_read(x,s,0,x->p_one.c_pds,(Ptr)x->p_one.c_data,false);	// preload
+	sf_cache_prefetch(s,s->s_offset + x->p_one.c_pds,2 * x->p_bufsize);
 	x->p_one.c_parent = s;
 	x->p_one.c_end = s->s_size;
 done:
@@ -1128,6 +1148,7 @@ void sfplay_doopenraw(t_sfplay *x, t_symbol *name)
 	preload = (preload / framesize) * framesize;
 	x->p_one.c_pds = MIN(total,preload);	
 	sfplay_sfile_read(x,s,0,x->p_one.c_pds,(Ptr)x->p_one.c_data,false);	// preload
+	sf_cache_prefetch(s,s->s_offset + x->p_one.c_pds,2 * x->p_bufsize);
 	x->p_one.c_parent = s;
 	x->p_one.c_end = s->s_size;
 	x->p_one.c_endpoint = 0;
@@ -1187,6 +1208,15 @@ void sfplay_print(t_sfplay *x)
 		object_post((t_object *)x, "numchans:   %d",x->p_now->c_parent->s_srcchans);
 		object_post((t_object *)x, "sampsize:   %d",x->p_now->c_parent->s_sampsize);
 	}
+	sf_cache_print(x);
+}
+
+// files up to n megabytes opened from now on are memory mapped, 0 turns it off
+void sfplay_mmap(t_sfplay *x, long n)
+{
+	if (n < 0) n = 0;
+	if (n > 2047) n = 2047;
+	sf_cache_setmmap(n * 1048576L);
 }
 
 void sfplay_pause(t_sfplay *x)
@@ -1753,10 +1783,19 @@ long sfplay_sfile_read(t_sfplay *x, t_sfile *s, long start, long bytes, Ptr dst,
 		asyncfile_read(p);
 		return 0;
 	} else {
-		p->flags |= ASYNCFILE_SYNC;
-		asyncfile_read(p);
+		long count;
+		
+		if (sf_cache_read(s,p->position,bytes,dst)) {
+			count = bytes;
+		} else {
+			p->flags |= ASYNCFILE_SYNC;
+			asyncfile_read(p);
+			count = p->actualcount;
+			if (!p->result)
+				sf_cache_store(s,p->position,count,dst);
+		}
 		asyncfile_params_free(p);
-		return p->actualcount;
+		return count;
 	}
 }
 
@@ -2124,6 +2163,7 @@ void *sfplay_new(t_symbol *s, short argc, t_atom *argv)
 		x->p_name = myname;
 		x->p_modout = 0;
 		x->p_iorequest = asyncfile_params_new();	
+		x->p_readfile = NULL;
 	
 		symbol_bind(myname,(t_object *)x);
 		object_register(CLASS_BOX, symbol_unique(), x);
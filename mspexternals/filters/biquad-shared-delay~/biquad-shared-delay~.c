@@ -10,6 +10,8 @@ DESCRIPTION: this is the "new" biquad test version using shared delays ym1, ym2.
 #include "z_dsp.h"
 #include <math.h>
 
+#include "param-update.h"
+
 //#define RES_ID 13251
 
 void *biquad_class;
@@ -23,43 +25,60 @@ enum {
 	NUM_COEFFICIENTS = 5
 };
 
+typedef struct _biquadcoeffs
+{
+	float c[NUM_COEFFICIENTS];	// gain, feedforward 1, 2, feedback 1, 2
+} t_biquadcoeffs;
+
 typedef struct _biquad
 {
 	t_pxobject b_obj;
 	float b_ym1;
 	float b_ym2;
 	
-	float b_a0;		// gain
-	float b_a1;		// feedforward 1
-	float b_a2;		// feedforward 2
-	float b_b1;		// feedback 1
-	float b_b2;		// feedback 2
+	t_biquadcoeffs b_coeffs[PARAM_NUM_BLOCKS];	// handed to the perform routine with param-update
+	paramPointers b_pp;
 	short b_connected[NUM_COEFFICIENTS];  // are coef signals connected?
 } t_biquad;
 
-t_int *biquad_perform(t_int *w);
-t_int *biquad2_perform(t_int *w);
-void biquad_dsp(t_biquad *x, t_signal **sp, short *connect);
-void biquad_float(t_biquad *x, double f);
-void biquad_int(t_biquad *x, long n);
-void biquad_list(t_biquad *x, t_symbol *s, short argc, t_atom *argv);
-void biquad_clear(t_biquad *x);
-void biquad_assist(t_biquad *x, void *b, long m, long a, char *s);
-void *biquad_new(t_symbol *s, short argc, t_atom *argv);
-
-void main(void)
+// runs the filter over one vector, ramping the coefficients from[] to to[] if they differ
+
+void biquad_filter(t_biquad *x, t_float *in, t_float *out, int n, float *from, float *to)
 {
-	setup((t_messlist **)&biquad_class,biquad_new, (method)dsp_free, (short)sizeof(t_biquad),
-		0L, A_GIMME, 0);
-	addmess((method)biquad_dsp, "dsp", A_CANT, 0);
-	addmess((method)biquad_list, "list", A_GIMME, 0);
-	addmess((method)biquad_clear, "clear", 0);
-	addfloat((method)biquad_float);
-	addint((method)biquad_int);
-	addmess((method)biquad_assist, "assist", A_CANT, 0);
-	dsp_initclass();
-	//rescopy('STR#',RES_ID);
-	// assist isn't defined yet
+	float a0 = from[FF0], a1 = from[FF1], a2 = from[FF2], b1 = from[FB1], b2 = from[FB2];
+	float yn,xn,ym1 = x->b_ym1, ym2 = x->b_ym2;
+	float inc[NUM_COEFFICIENTS];
+	short i;
+
+	for (i = 0; i < NUM_COEFFICIENTS; i++)
+		if (from[i] != to[i])
+			break;
+
+	if (i < NUM_COEFFICIENTS) {
+		ParamRampFloat(inc, from, to, NUM_COEFFICIENTS, n - 1);
+		while (--n) {
+			xn = *++in;
+			yn = xn - (b1 * ym1) - (b2 * ym2);
+			*++out = (a0 * yn) + (a1 * ym1) + (a2 * ym2);
+			ym2 = ym1;
+			ym1 = yn;
+			a0 += inc[FF0];
+			a1 += inc[FF1];
+			a2 += inc[FF2];
+			b1 += inc[FB1];
+			b2 += inc[FB2];
+		}
+	} else {
+		while (--n) {
+			xn = *++in;
+			yn = xn - (b1 * ym1) - (b2 * ym2);
+			*++out = (a0 * yn) + (a1 * ym1) + (a2 * ym2);
+			ym2 = ym1;
+			ym1 = yn;
+		}
+	}
+	x->b_ym1 = ym1;
+	x->b_ym2 = ym2;
 }
 
 t_int *biquad_perform(t_int *w)
@@ -68,49 +87,39 @@ t_int *biquad_perform(t_int *w)
 	t_float *out = (t_float *)(w[2]);
 	t_biquad *x = (t_biquad *)(w[3]);
 	int n = (int)(w[4]);
-	float a0 = x->b_a0, a1 = x->b_a1, a2 = x->b_a2, b1 = x->b_b1, b2 = x->b_b2;
-	float yn,xn,ym1 = x->b_ym1, ym2 = x->b_ym2;
+	t_biquadcoeffs *c = (t_biquadcoeffs *)GetCurrentParams(&x->b_pp);
+	t_biquadcoeffs *oc = (t_biquadcoeffs *)GetPreviousParams(&x->b_pp);
 
-	while (--n) {
-		xn = *++in;
-		yn = xn - (b1 * ym1) - (b2 * ym2);
-		*++out = (a0 * yn) + (a1 * ym1) + (a2 * ym2);
-		ym2 = ym1;
-		ym1 = yn;
-	}
-	x->b_ym1 = ym1;
-	x->b_ym2 = ym2;
+	biquad_filter(x, in, out, n, oc->c, c->c);
+	DoneWithPreviousParams(&x->b_pp);
 	return (w+5);
 }
 
 t_int *biquad2_perform(t_int *w)
 {
-	float a0,a1,a2,b1,b2,yn,xn,ym1,ym2,xm1,xm2;
+	float from[NUM_COEFFICIENTS], to[NUM_COEFFICIENTS];
+	t_biquadcoeffs *c, *oc;
 	t_float *in = (t_float *)(w[1]);
 	t_float *out = (t_float *)(w[2]);
 	t_biquad *x = (t_biquad *)(w[3]);
 	int n = (int)(w[4]);
+	short i;
 
 	if (x->b_obj.z_disabled)
 		return (w+10);
-	a0 = x->b_connected[FF0]? *(float *)(w[5]) : x->b_a0;
-	a1 = x->b_connected[FF1]? *(float *)(w[6]) : x->b_a1;
-	a2 = x->b_connected[FF2]? *(float *)(w[7]) : x->b_a2;
-	b1 = x->b_connected[FB1]? *(float *)(w[8]) : x->b_b1;
-	b2 = x->b_connected[FB2]? *(float *)(w[9]) : x->b_b2;
-	ym1 = x->b_ym1;
-	ym2 = x->b_ym2;
-
-
-	while (--n) {
-		xn = *++in;
-		yn = xn - (b1 * ym1) - (b2 * ym2);
-		*++out = (a0 * yn) + (a1 * ym1) + (a2 * ym2);
-		ym2 = ym1;
-		ym1 = yn;
+	c = (t_biquadcoeffs *)GetCurrentParams(&x->b_pp);
+	oc = (t_biquadcoeffs *)GetPreviousParams(&x->b_pp);
+	for (i = 0; i < NUM_COEFFICIENTS; i++) {
+		if (x->b_connected[i])
+			from[i] = to[i] = *(float *)(w[5+i]);
+		else {
+			from[i] = oc->c[i];
+			to[i] = c->c[i];
+		}
 	}
-	x->b_ym1 = ym1;
-	x->b_ym2 = ym2;
+
+	biquad_filter(x, in, out, n, from, to);
+	DoneWithPreviousParams(&x->b_pp);
 	return (w+10);
 }
 
@@ -140,20 +149,27 @@ void biquad_dsp(t_biquad *x, t_signal **sp, short *connect)
 	}
 }
 
+// a copy of the latest coefficients to change; check it in when done
+
+float *biquad_edit(t_biquad *x)
+{
+	t_biquadcoeffs *c = (t_biquadcoeffs *)CheckOutParamBlock(&x->b_pp);
+
+	*c = *(t_biquadcoeffs *)GetLatestParams(&x->b_pp);
+	return c->c;
+}
+
 void biquad_float(t_biquad *x, double f)
 {
 	long in = x->b_obj.z_in;
+	float *c;
 
-	if (!in)
+	if (!in || in > NUM_COEFFICIENTS)
 		return;
 	in--;
-	switch (in) {
-		case FF0: x->b_a0 = f; break;
-		case FF1: x->b_a1 = f; break;
-		case FF2: x->b_a2 = f; break;
-		case FB1: x->b_b1 = f; break;
-		case FB2: x->b_b2 = f; break;
-	}
+	c = biquad_edit(x);
+	c[in] = f;
+	CheckInNewParams(&x->b_pp);
 }
 
 void biquad_int(t_biquad *x, long n)
@@ -166,31 +182,30 @@ void biquad_int(t_biquad *x, long n)
 void biquad_list(t_biquad *x, t_symbol *s, short argc, t_atom *argv)
 {
 	short i;
+	float *c = biquad_edit(x);
 
-	for (i=0; i < argc; i++) {
-		switch (i) {
-			case FF0: x->b_a0 = atom_getfloatarg(i,argc,argv); break;
-			case FF1: x->b_a1 = atom_getfloatarg(i,argc,argv); break;
-			case FF2: x->b_a2 = atom_getfloatarg(i,argc,argv); break;
-			case FB1: x->b_b1 = atom_getfloatarg(i,argc,argv); break;
-			case FB2: x->b_b2 = atom_getfloatarg(i,argc,argv); break;
-		}
-	}
+	for (i=0; i < argc && i < NUM_COEFFICIENTS; i++)
+		c[i] = atom_getfloatarg(i,argc,argv);
+	CheckInNewParams(&x->b_pp);
 }
 
 void biquad_assist(t_biquad *x, void *b, long m, long a, char *s)
-/*{
-	assist_string(RES_ID,m,a,1,7,s);
-}*/
+{
+	// assist_string(RES_ID,m,a,1,7,s);
+}
 
 void *biquad_new(t_symbol *s, short argc, t_atom *argv)
 {
     t_biquad *x = (t_biquad *)newobject(biquad_class);
     dsp_setup((t_pxobject *)x,6);
     outlet_new((t_object *)x, "signal");
-    x->b_a0 = x->b_a1 = x->b_a2 = x->b_b1 = x->b_b2 = 0.;
+    x->b_coeffs[0].c[FF0] = x->b_coeffs[0].c[FF1] = x->b_coeffs[0].c[FF2] = 0.;
+    x->b_coeffs[0].c[FB1] = x->b_coeffs[0].c[FB2] = 0.;
+    InitParamPointers(&x->b_pp, &x->b_coeffs[0], &x->b_coeffs[1], &x->b_coeffs[2], &x->b_coeffs[3]);
     biquad_clear(x);
     biquad_list(x,s,argc,argv);
+    GetCurrentParams(&x->b_pp);		// DSP isn't running yet, so take them up without a ramp
+    DoneWithPreviousParams(&x->b_pp);
     return (x);
 }
 
@@ -30,11 +30,12 @@ AUTHORS: Franz Zotter, Andy Schmeder
 COPYRIGHT_YEARS: 2009
 SVN_REVISION: $LastChangedRevision: 550 $
 VERSION 0.1: Ported code from PD
+VERSION 0.2: Ambisonic mode: one object equalizes every channel of a stream
 @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@  
 
 */
 
-#define RADIAL_BEAMFORM_VERSION "0.1"
+#define RADIAL_BEAMFORM_VERSION "0.2"
 
 #include "ext.h"
 
@@ -50,6 +51,15 @@ VERSION 0.1: Ported code from PD
 #include <float.h>
 
 #include "sph_hn_zeros.h"
+#include "param-update.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define RADIAL_SSE
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RADIAL_NEON
+#endif
 
 #include "version.h"
 #include "version.c"
@@ -63,6 +73,11 @@ VERSION 0.1: Ported code from PD
 *             p          ... sound pressure synthesis at primary radius
 *             v          ... sound velocity synthesis at primary radius
 *
+* Max: [radialbeameq~ @n 3] filters one signal for degree n.
+*      [radialbeameq~ 5] filters a whole 5th order ambisonic stream, 36 signals
+*      in ACN order (degree n is channels n*n to n*n+2n), each with the filter
+*      for its degree.
+*
 * messages:
 *             r0 <float> ... primary synthesis radius
 *             r  <float> ... target radius
@@ -74,6 +89,24 @@ VERSION 0.1: Ported code from PD
 
 enum BFMode {PRESSURE=0,VELOCITY=1};
 
+#define RADIAL_MAX_AMBI_ORDER 12
+#define RADIAL_MAX_SECTIONS (RADIAL_MAX_AMBI_ORDER/2+2)
+#define RADIAL_LANES 4
+
+// One filter section in a form that covers all the kinds the perform
+// routine runs (sosARMA, fosAR, ...):
+//    w = x + p1*z1 + p2*z2;  y = q0*w + q1*z1 + q2*z2;  z2 = z1;  z1 = w;
+// Unused terms are zeros and ones, so the results are the same to the bit.
+enum {SEC_P1=0, SEC_P2, SEC_Q0, SEC_Q1, SEC_Q2, SEC_NUM};
+
+// Coefficients for the ambisonic mode, one cascade per degree, handed to
+// the perform routine with param-update.
+typedef struct {
+    int num_sec[RADIAL_MAX_AMBI_ORDER+1];
+    float gain[RADIAL_MAX_AMBI_ORDER+1];
+    float sec[RADIAL_MAX_AMBI_ORDER+1][RADIAL_MAX_SECTIONS][SEC_NUM];
+} RadialAmbiCoeffs;
+
 static t_class *radialbeameq_class;
 
 typedef struct {
@@ -113,8 +146,20 @@ typedef struct {
     
     void* list_outlet;
     
+    // ambisonic mode: (ambi_order+1)^2 channels, 0 channels in the
+    // single channel mode
+    int ambi_order;
+    int num_channels;
+    RadialAmbiCoeffs *ambi_blocks[PARAM_NUM_BLOCKS];
+    paramPointers ambi_pp;
+    float *ambi_z1;     // [degree][section][lane]
+    float *ambi_z2;
+    float *ambi_buf;    // one degree's channels, interleaved
+    
 } RadialBeamform;
 
+static void radialBeamformAmbiUpdate (RadialBeamform *x);
+
 static void radialBeamformFreeFilters (RadialBeamform *x) {
     if (x->z1!=0)
         free(x->z1);
@@ -146,10 +191,23 @@ static void radialBeamformFreeFilters (RadialBeamform *x) {
 }
 
 void radialBeamformFree (RadialBeamform *x) {
+    int k;
+    
+    dsp_free((t_pxobject *)x);
     radialBeamformFreeFilters (x);
     if (x->buf!=0)
         free(x->buf);
     x->buf=0;
+    if (x->ambi_buf!=0)
+        free(x->ambi_buf);
+    x->ambi_buf=0;
+    if (x->ambi_z1!=0)
+        free(x->ambi_z1);
+    if (x->ambi_z2!=0)
+        free(x->ambi_z2);
+    for (k=0; k<PARAM_NUM_BLOCKS; k++)
+        if (x->ambi_blocks[k]!=0)
+            free(x->ambi_blocks[k]);
 }
 
 static void radialBeamformReset (RadialBeamform *x) {
@@ -165,6 +223,151 @@ static void radialBeamformReset (RadialBeamform *x) {
     cycles = (x->num_ar_sec<x->num_ma_sec)?x->num_ma_sec:x->num_ar_sec;
     for (;n<cycles; n++)
         x->z1[n]=0;
+    
+    if (x->num_channels) {
+        cycles = (x->ambi_order+1) * RADIAL_MAX_SECTIONS * (2*x->ambi_order+1+RADIAL_LANES);
+        for (n=0; n<cycles; n++) {
+            x->ambi_z1[n]=0;
+            x->ambi_z2[n]=0;
+        }
+    }
+}
+
+// Section counts for degree sh_degree.  The denominator (AR) and numerator
+// (MA) each have second order sections and at most one first order one.
+static void radialSectionCounts (int sh_degree, int bf_mode, int *num_ar_sec, int *num_ma_sec, int *num_ar_sos, int *num_ma_sos) {
+    *num_ar_sec = bf_mode + (int)((sh_degree+1)/2);
+    *num_ma_sec =   (int)((sh_degree+1+bf_mode)/2);
+    *num_ar_sos = *num_ar_sec - sh_degree%2 - bf_mode;
+    *num_ma_sos = *num_ma_sec - (sh_degree+bf_mode)%2;
+}
+
+// AR coefficients for delta_n, returns their gain
+static float radialARCoeffs (int sh_degree, int bf_mode, float dn, float *a1, float *a2) {
+    int k, num_ar_sec, num_ma_sec, num_ar_sos, num_ma_sos;
+    float one_over_dn,one_over_dn_sq, one_over_a0;
+    float gain_ar = 1.0f;
+    float *shn_b=sph_hn_b[sh_degree];
+    float *shn_o=sph_hn_omega[sh_degree];
+    
+    radialSectionCounts(sh_degree, bf_mode, &num_ar_sec, &num_ma_sec, &num_ar_sos, &num_ma_sos);
+    one_over_dn = 1.0f / dn;
+    one_over_dn_sq = one_over_dn * one_over_dn;
+    
+    // The radius controls the zeroes of the Hankel function in the
+    // denominator. Therefore, the AR coefficients are inserted.
+    // Basically, all the coefficients correspond to second order AR sections
+    // except for every odd degree, where the last coefficient describes 
+    // a first order AR section. The V-mode introduces an extra pole thereof.
+    
+    for (k=0; k < num_ar_sos; k++) {
+        one_over_a0 = 1.0f / (1.0f-2.0f*one_over_dn*shn_b[k]);
+        a2[k] = one_over_a0;
+        a1[k] = (one_over_dn_sq*(shn_b[k]*shn_b[k]+shn_o[k]*shn_o[k])+
+                    2.0f*(one_over_dn*shn_b[k]-1.0f)) * one_over_a0;
+        gain_ar *= one_over_a0;
+    }
+    for (; k<num_ar_sec-bf_mode; k++) {
+        one_over_a0 = 1.0f / (1.0f-one_over_dn*shn_b[k]);
+        a1[k] = -one_over_a0;
+        gain_ar *= one_over_a0;
+    }
+    if (bf_mode==VELOCITY) {
+        a1[k] = -0.999f;
+    }
+    return gain_ar;
+}
+
+// MA coefficients for delta_n0
+static void radialMACoeffs (int sh_degree, int bf_mode, float dn0, float *b0, float *b1) {
+    int k, num_ar_sec, num_ma_sec, num_ar_sos, num_ma_sos;
+    float one_over_dn0,one_over_dn0_sq;
+    float *shn_b, *shn_o;
+    
+    radialSectionCounts(sh_degree, bf_mode, &num_ar_sec, &num_ma_sec, &num_ar_sos, &num_ma_sos);
+    one_over_dn0 = 1.0f / dn0;
+    one_over_dn0_sq = one_over_dn0*one_over_dn0;
+    
+    // The radius controls the zeroes of the differentiated Hankel function
+    // in the numerator in case of V-mode, else the Hankel function in the
+    // numerator. Therefore, the MA coefficients are inserted.
+    // Basically, all the coefficients correspond to second order MA sections
+    // except for every odd degree+mode_sw, where the last coefficient describes 
+    // a first order AR section.
+    
+    if (bf_mode==VELOCITY) {
+        shn_b = sph_hdn_b[sh_degree];
+        shn_o = sph_hdn_omega[sh_degree];
+    }
+    else {
+        shn_b = sph_hn_b[sh_degree];
+        shn_o = sph_hn_omega[sh_degree];
+    }
+    
+    for (k=0; k<num_ma_sos; k++) {
+        b0[k] = 1.0f-2.0f*one_over_dn0*shn_b[k];
+        b1[k] = one_over_dn0_sq*(shn_b[k]*shn_b[k]+shn_o[k]*shn_o[k])+
+        2.0f*(one_over_dn0*shn_b[k]-1.0f);
+    }
+    for (; k<num_ma_sec; k++) {
+        b0[k] = 1.0f-one_over_dn0*shn_b[k];
+    }
+}
+
+static void radialSection (float *sec, float p1, float p2, float q0, float q1, float q2) {
+    sec[SEC_P1]=p1;
+    sec[SEC_P2]=p2;
+    sec[SEC_Q0]=q0;
+    sec[SEC_Q1]=q1;
+    sec[SEC_Q2]=q2;
+}
+
+// The cascade radialBeamformPerform runs, section by section in the same
+// order, as rows for radialSectionRun.  Returns the number of sections.
+static int radialCompileSections (int sh_degree, int bf_mode, float *a1, float *a2, float *b0, float *b1, float sec[][SEC_NUM]) {
+    int k, num_ar_sec, num_ma_sec, num_ar_sos, num_ma_sos, num_arma_sos;
+    
+    radialSectionCounts(sh_degree, bf_mode, &num_ar_sec, &num_ma_sec, &num_ar_sos, &num_ma_sos);
+    num_arma_sos = (num_ar_sos < num_ma_sos)? num_ar_sos : num_ma_sos;
+    
+    for (k=0; k<num_arma_sos; k++) // sosARMA
+        radialSection(sec[k], -a1[k], -a2[k], b0[k], b1[k], 1.0f);
+    for (; (k<num_ar_sos)&&(k<num_ma_sec); k++) // fosMA sosAR
+        radialSection(sec[k], a1[k], a2[k], b0[k], -1.0f, 0.0f);
+    for (; (k<num_ma_sos)&&(k<num_ar_sec); k++) //sosMA fosAR
+        radialSection(sec[k], -a1[k], 0.0f, b0[k], b1[k], 1.0f);
+    for (; k<num_ar_sos; k++) //sosAR
+        radialSection(sec[k], a1[k], a2[k], 1.0f, 0.0f, 0.0f);
+    for (; k<num_ma_sos; k++) //sosMA
+        radialSection(sec[k], 0.0f, 0.0f, b0[k], b1[k], 1.0f);
+    for (; (k<num_ma_sec)&&(k<num_ar_sec); k++) //fosARMA
+        radialSection(sec[k], -a1[k], 0.0f, b0[k], -1.0f, 0.0f);
+    for (; k<num_ar_sec; k++) //fosAR
+        radialSection(sec[k], -a1[k], 0.0f, 1.0f, 0.0f, 0.0f);
+    for (; k<num_ma_sec; k++) //fosMA
+        radialSection(sec[k], 0.0f, 0.0f, b0[k], -1.0f, 0.0f);
+    return k;
+}
+
+// Recomputes every degree's cascade for the ambisonic mode and hands them
+// to the perform routine.
+static void radialBeamformAmbiUpdate (RadialBeamform *x) {
+    float a1[RADIAL_MAX_SECTIONS], a2[RADIAL_MAX_SECTIONS], b0[RADIAL_MAX_SECTIONS], b1[RADIAL_MAX_SECTIONS];
+    RadialAmbiCoeffs *c;
+    float gain_ar;
+    int n;
+    
+    if (!x->num_channels)
+        return;
+    
+    c = (RadialAmbiCoeffs *)CheckOutParamBlock(&x->ambi_pp);
+    for (n=0; n<=x->ambi_order; n++) {
+        gain_ar = radialARCoeffs(n, x->bf_mode, x->delta_n, a1, a2);
+        radialMACoeffs(n, x->bf_mode, x->delta_n0, b0, b1);
+        c->gain[n] = gain_ar * x->delta_n / x->delta_n0;
+        c->num_sec[n] = radialCompileSections(n, x->bf_mode, a1, a2, b0, b1, c->sec[n]);
+    }
+    CheckInNewParams(&x->ambi_pp);
 }
 
 
@@ -239,11 +442,7 @@ static void radialBeamformSetWNG (RadialBeamform *x,  t_object *attr, int argc,
 
 static void radialBeamformSetDeltan (RadialBeamform *x, t_object *attr, int argc, t_atom *argv) {
     t_atom list[1];
-    int k;
-    float one_over_dn,one_over_dn_sq, one_over_a0;
     float dn;
-    float *shn_b=sph_hn_b[x->sh_degree];
-    float *shn_o=sph_hn_omega[x->sh_degree];
     
     if ((argc<1)|(argv[0].a_type!=A_FLOAT)) {
         post("radial_beamform~: no value given for delta_n");
@@ -252,44 +451,18 @@ static void radialBeamformSetDeltan (RadialBeamform *x, t_object *attr, int argc
     else
         dn = atom_getfloat(&argv[0]);
     
-    one_over_dn = 1.0f / dn;
-    one_over_dn_sq = one_over_dn * one_over_dn;
     x->delta_n = dn;
-    x->gain_ar = 1.0f;
-    
-    // The radius controls the zeroes of the Hankel function in the
-    // denominator. Therefore, the AR coefficients are inserted.
-    // Basically, all the coefficients correspond to second order AR sections
-    // except for every odd degree, where the last coefficient describes 
-    // a first order AR section. The V-mode introduces an extra pole thereof.
-    
-    for (k=0; k < x->num_ar_sos; k++) {
-        one_over_a0 = 1.0f / (1.0f-2.0f*one_over_dn*shn_b[k]);
-        x->a2[k] = one_over_a0;
-        x->a1[k] = (one_over_dn_sq*(shn_b[k]*shn_b[k]+shn_o[k]*shn_o[k])+
-                    2.0f*(one_over_dn*shn_b[k]-1.0f)) * one_over_a0;
-        x->gain_ar *= one_over_a0;
-    }
-    for (; k<x->num_ar_sec-x->bf_mode; k++) {
-        one_over_a0 = 1.0f / (1.0f-one_over_dn*shn_b[k]);
-        x->a1[k] = -one_over_a0;
-        x->gain_ar *= one_over_a0;
-    }
-    if (x->bf_mode==VELOCITY) {
-        x->a1[k] = -0.999f;
-    }
+    x->gain_ar = radialARCoeffs(x->sh_degree, x->bf_mode, dn, x->a1, x->a2);
     x->gain = x->gain_ar * x->delta_n / x->delta_n0;
     SETFLOAT(list,x->max_wng);
     radialBeamformSetWNG(x,gensym("wng"),1,list);
+    radialBeamformAmbiUpdate(x);
     
 }
 
 static void radialBeamformSetDeltan0 (RadialBeamform *x,  t_object *attr, int argc, t_atom *argv) {
     t_atom list[1];
-    float one_over_dn0,one_over_dn0_sq;
-    int k;
     float dn0;
-    float *shn_b, *shn_o;
     if ((argc<1)|(argv[0].a_type!=A_FLOAT)) {
         post("radial_beamform~: no value given for delta_n0");
         dn0=0;
@@ -297,37 +470,12 @@ static void radialBeamformSetDeltan0 (RadialBeamform *x,  t_object *attr, int ar
     else
         dn0 = atom_getfloat(&argv[0]);
     
-    one_over_dn0 = 1.0f / dn0;
-    one_over_dn0_sq = one_over_dn0*one_over_dn0;
     x->delta_n0 = dn0;
     x->gain = x->gain_ar * x->delta_n / x->delta_n0;
-    
-    // The radius controls the zeroes of the differentiated Hankel function
-    // in the numerator in case of V-mode, else the Hankel function in the
-    // numerator. Therefore, the MA coefficients are inserted.
-    // Basically, all the coefficients correspond to second order MA sections
-    // except for every odd degree+mode_sw, where the last coefficient describes 
-    // a first order AR section.
-    
-    if (x->bf_mode==VELOCITY) {
-        shn_b = sph_hdn_b[x->sh_degree];
-        shn_o = sph_hdn_omega[x->sh_degree];
-    }
-    else {
-        shn_b = sph_hn_b[x->sh_degree];
-        shn_o = sph_hn_omega[x->sh_degree];
-    }
-    
-    for (k=0; k<x->num_ma_sos; k++) {
-        x->b0[k] = 1.0f-2.0f*one_over_dn0*shn_b[k];
-        x->b1[k] = one_over_dn0_sq*(shn_b[k]*shn_b[k]+shn_o[k]*shn_o[k])+
-        2.0f*(one_over_dn0*shn_b[k]-1.0f);
-    }
-    for (; k<x->num_ma_sec; k++) {
-        x->b0[k] = 1.0f-one_over_dn0*shn_b[k];
-    }
+    radialMACoeffs(x->sh_degree, x->bf_mode, dn0, x->b0, x->b1);
     SETFLOAT(list,x->max_wng);
     radialBeamformSetWNG(x,gensym("wng"),1,list);
+    radialBeamformAmbiUpdate(x);
     
 }
 
@@ -356,10 +504,7 @@ t_max_err radialBeamformSetn (RadialBeamform *x, t_object *attr, int argc, t_ato
     sh_degree=(sh_degree<0)?0:sh_degree;
     sh_degree=(sh_degree>25)?25:sh_degree;
     
-    num_ar_sec = x->bf_mode + (int)((sh_degree+1)/2);
-    num_ma_sec =   (int)((sh_degree+1+x->bf_mode)/2);
-    num_ar_sos = num_ar_sec - sh_degree%2 - x->bf_mode;
-    num_ma_sos = num_ma_sec - (sh_degree+x->bf_mode)%2;
+    radialSectionCounts(sh_degree, x->bf_mode, &num_ar_sec, &num_ma_sec, &num_ar_sos, &num_ma_sos);
     num_z2 = (num_ar_sos > num_ma_sos)? num_ar_sos : num_ma_sos;
     num_z1 = (num_ma_sec<num_ar_sec)?
 num_ar_sec:num_ma_sec;
@@ -508,7 +653,155 @@ static t_int *radialBeamformPerform (t_int *arg) {// TODO
     return(arg+2);
 }
 
+// One section over n samples of lanes interleaved channels (a multiple
+// of RADIAL_LANES), in place.  The channels share the coefficients, so the
+// SIMD lanes run across channels while each lane's recursion stays serial.
+// Two groups of lanes go through the sample loop together, keeping their
+// state in registers, so one's recursion overlaps the other's.
+#if defined(RADIAL_SSE)
+#define RADIAL_SECTION_STEP(x, s1, s2) \
+    { __m128 w = _mm_add_ps(_mm_add_ps(x, _mm_mul_ps(p1, s1)), _mm_mul_ps(p2, s2)); \
+      x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(q0, w), _mm_mul_ps(q1, s1)), _mm_mul_ps(q2, s2)); \
+      s2 = s1; s1 = w; }
+#elif defined(RADIAL_NEON)
+#define RADIAL_SECTION_STEP(x, s1, s2) \
+    { float32x4_t w = vaddq_f32(vaddq_f32(x, vmulq_f32(p1, s1)), vmulq_f32(p2, s2)); \
+      x = vaddq_f32(vaddq_f32(vmulq_f32(q0, w), vmulq_f32(q1, s1)), vmulq_f32(q2, s2)); \
+      s2 = s1; s1 = w; }
+#endif
+
+static void radialSectionRun (float *buf, int n, int lanes, const float *sec, float *z1, float *z2) {
+    int l, s;
+    float *b;
+#if defined(RADIAL_SSE)
+    __m128 p1 = _mm_set1_ps(sec[SEC_P1]), p2 = _mm_set1_ps(sec[SEC_P2]);
+    __m128 q0 = _mm_set1_ps(sec[SEC_Q0]), q1 = _mm_set1_ps(sec[SEC_Q1]), q2 = _mm_set1_ps(sec[SEC_Q2]);
+    
+    for (l=0; l+2*RADIAL_LANES<=lanes; l+=2*RADIAL_LANES) {
+        __m128 a1 = _mm_loadu_ps(z1 + l), a2 = _mm_loadu_ps(z2 + l);
+        __m128 c1 = _mm_loadu_ps(z1 + l + RADIAL_LANES), c2 = _mm_loadu_ps(z2 + l + RADIAL_LANES);
+        
+        for (s=0, b=buf+l; s<n; s++, b+=lanes) {
+            __m128 x = _mm_loadu_ps(b), y = _mm_loadu_ps(b + RADIAL_LANES);
+            RADIAL_SECTION_STEP(x, a1, a2);
+            RADIAL_SECTION_STEP(y, c1, c2);
+            _mm_storeu_ps(b, x);
+            _mm_storeu_ps(b + RADIAL_LANES, y);
+        }
+        _mm_storeu_ps(z1 + l, a1);
+        _mm_storeu_ps(z2 + l, a2);
+        _mm_storeu_ps(z1 + l + RADIAL_LANES, c1);
+        _mm_storeu_ps(z2 + l + RADIAL_LANES, c2);
+    }
+    if (l<lanes) {
+        __m128 a1 = _mm_loadu_ps(z1 + l), a2 = _mm_loadu_ps(z2 + l);
+        
+        for (s=0, b=buf+l; s<n; s++, b+=lanes) {
+            __m128 x = _mm_loadu_ps(b);
+            RADIAL_SECTION_STEP(x, a1, a2);
+            _mm_storeu_ps(b, x);
+        }
+        _mm_storeu_ps(z1 + l, a1);
+        _mm_storeu_ps(z2 + l, a2);
+    }
+#elif defined(RADIAL_NEON)
+    float32x4_t p1 = vdupq_n_f32(sec[SEC_P1]), p2 = vdupq_n_f32(sec[SEC_P2]);
+    float32x4_t q0 = vdupq_n_f32(sec[SEC_Q0]), q1 = vdupq_n_f32(sec[SEC_Q1]), q2 = vdupq_n_f32(sec[SEC_Q2]);
+    
+    for (l=0; l+2*RADIAL_LANES<=lanes; l+=2*RADIAL_LANES) {
+        float32x4_t a1 = vld1q_f32(z1 + l), a2 = vld1q_f32(z2 + l);
+        float32x4_t c1 = vld1q_f32(z1 + l + RADIAL_LANES), c2 = vld1q_f32(z2 + l + RADIAL_LANES);
+        
+        for (s=0, b=buf+l; s<n; s++, b+=lanes) {
+            float32x4_t x = vld1q_f32(b), y = vld1q_f32(b + RADIAL_LANES);
+            RADIAL_SECTION_STEP(x, a1, a2);
+            RADIAL_SECTION_STEP(y, c1, c2);
+            vst1q_f32(b, x);
+            vst1q_f32(b + RADIAL_LANES, y);
+        }
+        vst1q_f32(z1 + l, a1);
+        vst1q_f32(z2 + l, a2);
+        vst1q_f32(z1 + l + RADIAL_LANES, c1);
+        vst1q_f32(z2 + l + RADIAL_LANES, c2);
+    }
+    if (l<lanes) {
+        float32x4_t a1 = vld1q_f32(z1 + l), a2 = vld1q_f32(z2 + l);
+        
+        for (s=0, b=buf+l; s<n; s++, b+=lanes) {
+            float32x4_t x = vld1q_f32(b);
+            RADIAL_SECTION_STEP(x, a1, a2);
+            vst1q_f32(b, x);
+        }
+        vst1q_f32(z1 + l, a1);
+        vst1q_f32(z2 + l, a2);
+    }
+#else
+    for (s=0, b=buf; s<n; s++, b+=lanes) {
+        for (l=0; l<lanes; l++) {
+            float w = b[l] + sec[SEC_P1] * z1[l] + sec[SEC_P2] * z2[l];
+            b[l] = sec[SEC_Q0] * w + sec[SEC_Q1] * z1[l] + sec[SEC_Q2] * z2[l];
+            z2[l] = z1[l];
+            z1[l] = w;
+        }
+    }
+#endif
+}
+
+// The ambisonic mode: degree by degree, that degree's 2n+1 channels are
+// interleaved and run through its cascade together.
+static t_int *radialBeamformPerformAmbi (t_int *arg) {
+    RadialBeamform *x = (RadialBeamform*)(arg[1]);
+    int n = (int)(arg[2]);
+    t_float **in = (t_float **)(arg + 3);
+    t_float **out = in + x->num_channels;
+    RadialAmbiCoeffs *c = (RadialAmbiCoeffs *)GetCurrentParams(&x->ambi_pp);
+    float *buf = x->ambi_buf;
+    int deg, k, s, ch, first, num, lanes, stride;
+    
+    stride = RADIAL_MAX_SECTIONS * (2*x->ambi_order+1+RADIAL_LANES);
+    for (deg=0; deg<=x->ambi_order; deg++) {
+        float gain = c->gain[deg];
+        float *z1 = x->ambi_z1 + deg * stride;
+        float *z2 = x->ambi_z2 + deg * stride;
+        
+        first = deg*deg;
+        num = 2*deg+1;
+        lanes = (num+RADIAL_LANES-1) / RADIAL_LANES * RADIAL_LANES;
+        
+        for (s=0; s<n; s++) {
+            for (ch=0; ch<num; ch++)
+                buf[s*lanes+ch] = in[first+ch][s] * gain;
+            for (; ch<lanes; ch++)
+                buf[s*lanes+ch] = 0.0f;
+        }
+        for (k=0; k<c->num_sec[deg]; k++)
+            radialSectionRun(buf, n, lanes, c->sec[deg][k], z1 + k*lanes, z2 + k*lanes);
+        for (s=0; s<n; s++)
+            for (ch=0; ch<num; ch++)
+                out[first+ch][s] = buf[s*lanes+ch];
+    }
+    
+    DoneWithPreviousParams(&x->ambi_pp);
+    return(arg + 3 + 2*x->num_channels);
+}
+
 static void radialBeamformDsp (RadialBeamform *x, t_signal **sp) { 
+    if (x->num_channels) {
+        void *w[2*(RADIAL_MAX_AMBI_ORDER+1)*(RADIAL_MAX_AMBI_ORDER+1)+2];
+        int k, lanes = (2*x->ambi_order+1+RADIAL_LANES-1) / RADIAL_LANES * RADIAL_LANES;
+        
+        if(x->ambi_buf!=0)
+            free(x->ambi_buf);
+        x->ambi_buf=(float *)calloc(sp[0]->s_n*lanes,sizeof(float));
+        
+        w[0] = x;
+        w[1] = (void *)(sp[0]->s_n);
+        for (k=0; k<2*x->num_channels; k++)
+            w[k+2] = sp[k]->s_vec;
+        dsp_addv(radialBeamformPerformAmbi, 2*x->num_channels+2, w);
+        return;
+    }
+    
     x->in=sp[0]->s_vec;
     x->out=sp[1]->s_vec;
     x->block_sz=sp[0]->s_n;
@@ -525,7 +818,31 @@ static void *radialBeamformNew(t_symbol *s, int argc, t_atom *argv) {
     
     RadialBeamform *x = (RadialBeamform *)object_alloc(radialbeameq_class);
     
-    int k;
+    int k, order;
+    
+    // a number before the attributes is an ambisonic order
+    x->ambi_order=0;
+    x->num_channels=0;
+    x->ambi_buf=0;
+    x->ambi_z1=0;
+    x->ambi_z2=0;
+    for (k=0; k<PARAM_NUM_BLOCKS; k++)
+        x->ambi_blocks[k]=0;
+    if (attr_args_offset(argc, argv)>0 && (argv[0].a_type==A_LONG || argv[0].a_type==A_FLOAT)) {
+        order = atom_getlong(&argv[0]);
+        if (order<0 || order>RADIAL_MAX_AMBI_ORDER) {
+            error("radialbeameq~: ambisonic order must be between 0 and %d", RADIAL_MAX_AMBI_ORDER);
+            order = (order<0)?0:RADIAL_MAX_AMBI_ORDER;
+        }
+        for (k=0; k<PARAM_NUM_BLOCKS; k++)
+            x->ambi_blocks[k]=(RadialAmbiCoeffs *)calloc(1,sizeof(RadialAmbiCoeffs));
+        k = (order+1) * RADIAL_MAX_SECTIONS * (2*order+1+RADIAL_LANES);
+        x->ambi_z1=(float *)calloc(k,sizeof(float));
+        x->ambi_z2=(float *)calloc(k,sizeof(float));
+        InitParamPointers(&x->ambi_pp, x->ambi_blocks[0], x->ambi_blocks[1], x->ambi_blocks[2], x->ambi_blocks[3]);
+        x->ambi_order=order;
+        x->num_channels=(order+1)*(order+1);
+    }
     
     x->z1=0;
     x->z2=0;
@@ -570,8 +887,8 @@ static void *radialBeamformNew(t_symbol *s, int argc, t_atom *argv) {
     
     attr_args_process(x, argc, argv);
     
-    // one signal in
-    dsp_setup((t_pxobject*)x, 1);
+    // one signal in, or one per ambisonic channel
+    dsp_setup((t_pxobject*)x, x->num_channels ? x->num_channels : 1);
 
     // no inplace
     x->x_obj.z_misc = Z_NO_INPLACE;
@@ -579,8 +896,9 @@ static void *radialBeamformNew(t_symbol *s, int argc, t_atom *argv) {
     // some list out
     x->list_outlet = outlet_new(&x->x_obj, "list");
     
-    // one signal out
-    outlet_new(&x->x_obj, "signal");
+    // one signal out, or one per ambisonic channel
+    for (k=0; k<(x->num_channels ? x->num_channels : 1); k++)
+        outlet_new(&x->x_obj, "signal");
 
     return x;
 }
@@ -632,7 +950,7 @@ int main(void) {
     CLASS_ATTR_FLOAT(c, "delta_n", 0, RadialBeamform, delta_n);
     CLASS_ATTR_ACCESSORS(c, "delta_n", 0, radialBeamformSetDeltan);
     CLASS_ATTR_FLOAT(c, "delta_n0", 0, RadialBeamform, delta_n0);
-    CLASS_ATTR_ACCESSORS(c, "delta_n0", 0, radialBeamformSetDeltan);
+    CLASS_ATTR_ACCESSORS(c, "delta_n0", 0, radialBeamformSetDeltan0);
     
     class_addmethod(c, (method)radialBeamformDsp, "dsp", A_CANT, 0);
 	class_addmethod(c, (method)radialBeamformReset, "reset", 0);
@@ -27,6 +27,7 @@ AUTHORS: John MacCallum
 COPYRIGHT_YEARS: 2007
 SVN_REVISION: $LastChangedRevision: 587 $
 VERSION 0.0: First try
+VERSION 0.1: Voice bank, per voice random number generators, seed and num messages
 @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 */
 
@@ -35,33 +36,63 @@ VERSION 0.0: First try
 #include "version.c"
 #include "z_dsp.h"
 #include "math.h"
+#include <stdint.h>
 
-#include <gsl/gsl_rng.h>
-#include <gsl/gsl_randist.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GENDYN_SSE2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define GENDYN_NEON
+#endif
 
+#define GENDYN_MAXVOICES 1024
+#define GENDYN_MAXMEMORY 256
+#define GENDYN_LANES 2		// voices per SIMD register; the voice arrays are padded to a multiple
+
+// All the voices of one object. Every voice draws from its own counter based
+// random number generator, so a voice's breakpoints only depend on the seed
+// and the voice number, and a render can be repeated exactly with "seed".
+//
+// The per voice state the inner loop needs is kept in arrays of doubles, one
+// entry per voice, so that loop can run over the voices GENDYN_LANES at a
+// time; each voice's breakpoint memory is one contiguous block.  Between
+// breakpoints every voice outputs amp + (phase - base) * slope, until its
+// phase reaches limit.
 typedef struct _gendyn
 {
 	t_pxobject g_ob;
-	gsl_rng *g_rng;
 	int g_type;
 	
-	// Gendy1-3
-	double g_phase;
-	float g_freqMul, g_amp, g_nextAmp, g_speed, g_dur;
-	int g_memorySize, g_index;
-	float *g_memoryAmp, *g_memoryDur;
+	int g_numVoices, g_maxVoices, g_lanes;
+	float g_gain;				// 1 / g_numVoices
+	int g_pendingVoices;		// applied by the perform routine, -1 if none
+	int g_pendingSeed;			// reseed in the perform routine
+	uint32_t g_seed;
+	
+	// interpolation, per voice (g_lanes of each)
+	double *g_phase, *g_speed, *g_base, *g_amp, *g_slope, *g_limit;
 	
-	// Gendy2
+	// Gendy1-3, per voice
+	float *g_nextAmp, *g_dur;
+	int *g_index;
+	uint32_t *g_key, *g_counter;
+	int g_memorySize;
+	float *g_memoryAmp, *g_memoryDur;		// g_memorySize per voice
+	float g_freqMul;
+	
+	// Gendy2, g_memorySize per voice
 	float *g_memoryAmpStep, *g_memoryDurStep;
 	
-	// Gendy3
-	double g_nextPhase, g_lastPhase;
-	float g_interpMult;
-	double *g_phaseList;
-	float *g_ampList;
+	// Gendy3, per voice
+	double *g_nextPhase, *g_lastPhase;
+	float *g_interpMult;
+	double *g_phaseList;		// g_memorySize + 1 per voice
+	float *g_ampList;			// g_memorySize + 1 per voice
+	float *g_draws;				// scratch: random numbers for one period
 	
 	// user params
-	int g_whichamp, g_whichdur;
+	int g_whichamp, g_whichdur, g_num;
 	float g_aamp, g_adur, g_minfreq, g_maxfreq, g_scaleamp, g_scaledur;
 	float g_freq;
 	
@@ -73,18 +104,27 @@ void gendyn_anything(t_gendyn *x, t_symbol *msg, short argc, t_atom *argv);
 void gendyn_int(t_gendyn *x, long n);
 void gendyn_assist(t_gendyn *x, void *b, long m, long a, char *s);
 void *gendyn_new(t_symbol *msg, short argc, t_atom *argv);
-void gendy1_constructor(t_gendyn *x);
-void gendy2_constructor(t_gendyn *x);
-void gendy3_constructor(t_gendyn *x);
+int gendyn_alloc(t_gendyn *x);
+void gendyn_initVoice(t_gendyn *x, int v);
+void gendyn_padVoice(t_gendyn *x, int v);
+void gendyn_setVoices(t_gendyn *x, int n, int reset);
+void gendy1_constructor(t_gendyn *x, int v);
+void gendy2_constructor(t_gendyn *x, int v);
+void gendy3_constructor(t_gendyn *x, int v);
 static int makeseed(void);
+static uint32_t gendyn_hash(uint32_t h);
+static void gendyn_uniform(uint32_t key, uint32_t *counter, float *out, int n);
 t_int *gendyn_perform(t_int *w);
 void gendyn_dsp(t_gendyn *x, t_signal **sp, short *count);
-void gendy1_perform(t_gendyn *x, t_float *outL, int n);
-void gendy2_perform(t_gendyn *x, t_float *outL, int n);
-void gendy3_perform(t_gendyn *x, t_float *outL, int n);
+void gendyn_run(t_gendyn *x, t_float *out, int n);
+void gendyn_segment(t_gendyn *x, int v);
+void gendy1_segment(t_gendyn *x, int v);
+void gendy2_segment(t_gendyn *x, int v);
+void gendy3_segment(t_gendyn *x, int v);
 void gendyn_free(t_gendyn *x);
 
 float Gendyn_distribution(int which, float a, float f);
+void Gendyn_distribution_block(int which, float a, float *f, int n);
 float Gendyn_mirroring (float lower, float upper, float in);;
 
 void whichamp(t_gendyn *x, long l);
@@ -96,6 +136,9 @@ void maxfreq(t_gendyn *x, double l);
 void scaleamp(t_gendyn *x, double l);
 void scaledur(t_gendyn *x, double l);
 void freq(t_gendyn *x, double l);
+void num(t_gendyn *x, long l);
+void voices(t_gendyn *x, long l);
+void seed(t_gendyn *x, long l);
 
 void gendyn_tellmeeverything(t_gendyn *x);
 
@@ -123,6 +166,9 @@ int main(void)
 	addmess((method)scaleamp, "scaleamp", A_FLOAT, 0);
 	addmess((method)scaledur, "scaledur", A_FLOAT, 0);
 	addmess((method)freq, "freq", A_FLOAT, 0);
+	addmess((method)num, "num", A_LONG, 0);
+	addmess((method)voices, "voices", A_LONG, 0);
+	addmess((method)seed, "seed", A_LONG, 0);
 	
 	dsp_initclass();
 		
@@ -166,6 +212,8 @@ void gendyn_assist(t_gendyn *x, void *b, long m, long a, char *s)
 
 //--------------------------------------------------------------------------
 
+// arguments: type [whichamp whichdur aamp adur minfreq maxfreq scaleamp scaledur
+// voices memorysize].  voices is the most the voices message can ask for.
 void *gendyn_new(t_symbol *msg, short argc, t_atom *argv){
 	t_gendyn *x;
 
@@ -187,6 +235,10 @@ void *gendyn_new(t_symbol *msg, short argc, t_atom *argv){
 	x->g_maxfreq = 660.f;
 	x->g_scaleamp = 0.5f;
 	x->g_scaledur = 0.5f;
+	x->g_freq = 440.f;
+	x->g_maxVoices = 1;
+	x->g_memorySize = 12;
+	x->g_num = 12;
 	
 	if(argc > 1) x->g_whichamp = argv[1].a_w.w_long;
 	if(argc > 2) x->g_whichdur = argv[2].a_w.w_long;
@@ -214,34 +266,106 @@ void *gendyn_new(t_symbol *msg, short argc, t_atom *argv){
 		if(argv[8].a_type == A_LONG) x->g_scaledur = argv[8].a_w.w_long;
 		else x->g_scaledur = (float)argv[8].a_w.w_float;
 	}
+	if(argc > 9) x->g_maxVoices = argv[9].a_w.w_long;
+	if(argc > 10) x->g_memorySize = x->g_num = argv[10].a_w.w_long;
 	
-	gsl_rng_env_setup();
-	x->g_rng = gsl_rng_alloc((const gsl_rng_type *)gsl_rng_default);
+	if(x->g_maxVoices < 1) x->g_maxVoices = 1;
+	if(x->g_maxVoices > GENDYN_MAXVOICES) x->g_maxVoices = GENDYN_MAXVOICES;
+	if(x->g_memorySize < 1) x->g_memorySize = 1;
+	if(x->g_memorySize > GENDYN_MAXMEMORY) x->g_memorySize = GENDYN_MAXMEMORY;
+	x->g_freqMul = 1.f / sys_getsr();
 	
 	// systime_ms() is a really bad idea since it'll be the same or very close if a bunch
 	// are instantiated when the patch opens.
-	//gsl_rng_set(x->r_rng, systime_ms());
-	
 	// makeseed() is from the PD code in x_misc.c
-	gsl_rng_set(x->g_rng, makeseed());
-		
+	x->g_seed = makeseed();
+	
+	x->g_memoryAmpStep = x->g_memoryDurStep = NULL;
+	x->g_nextPhase = x->g_lastPhase = x->g_phaseList = NULL;
+	x->g_interpMult = x->g_ampList = NULL;
+	if(gendyn_alloc(x)){
+		error("gendyn~: out of memory");
+		gendyn_free(x);
+		return NULL;
+	}
+	x->g_pendingVoices = -1;
+	x->g_pendingSeed = 0;
+	gendyn_setVoices(x, x->g_maxVoices, 1);
+			
+	return(x);
+}
+
+// everything is allocated for g_maxVoices so the perform routine never has to
+int gendyn_alloc(t_gendyn *x){
+	int lanes = (x->g_maxVoices + GENDYN_LANES - 1) / GENDYN_LANES * GENDYN_LANES;
+	int mem = x->g_maxVoices * x->g_memorySize;
+	int list = x->g_maxVoices * (x->g_memorySize + 1);
+	
+	x->g_phase = (double *)calloc(lanes, sizeof(double));
+	x->g_speed = (double *)calloc(lanes, sizeof(double));
+	x->g_base = (double *)calloc(lanes, sizeof(double));
+	x->g_amp = (double *)calloc(lanes, sizeof(double));
+	x->g_slope = (double *)calloc(lanes, sizeof(double));
+	x->g_limit = (double *)calloc(lanes, sizeof(double));
+	x->g_nextAmp = (float *)calloc(lanes, sizeof(float));
+	x->g_dur = (float *)calloc(lanes, sizeof(float));
+	x->g_index = (int *)calloc(lanes, sizeof(int));
+	x->g_key = (uint32_t *)calloc(lanes, sizeof(uint32_t));
+	x->g_counter = (uint32_t *)calloc(lanes, sizeof(uint32_t));
+	x->g_memoryAmp = (float *)calloc(mem, sizeof(float));
+	x->g_memoryDur = (float *)calloc(mem, sizeof(float));
+	x->g_draws = (float *)calloc(2 * x->g_memorySize, sizeof(float));
+	if(!x->g_phase || !x->g_speed || !x->g_base || !x->g_amp || !x->g_slope || !x->g_limit ||
+	   !x->g_nextAmp || !x->g_dur || !x->g_index || !x->g_key || !x->g_counter ||
+	   !x->g_memoryAmp || !x->g_memoryDur || !x->g_draws)
+		return 1;
+	
 	switch(x->g_type){
-		case 1:
-			gendy1_constructor(x);
-			break;
 		case 2:
-			gendy2_constructor(x);
+			x->g_memoryAmpStep = (float *)calloc(mem, sizeof(float));
+			x->g_memoryDurStep = (float *)calloc(mem, sizeof(float));
+			if(!x->g_memoryAmpStep || !x->g_memoryDurStep)
+				return 1;
 			break;
 		case 3:
-			gendy3_constructor(x);
+			x->g_nextPhase = (double *)calloc(lanes, sizeof(double));
+			x->g_lastPhase = (double *)calloc(lanes, sizeof(double));
+			x->g_interpMult = (float *)calloc(lanes, sizeof(float));
+			//one more in amp list for guard (wrap) element
+			x->g_ampList = (float *)calloc(list, sizeof(float));
+			x->g_phaseList = (double *)calloc(list, sizeof(double));
+			if(!x->g_nextPhase || !x->g_lastPhase || !x->g_interpMult || !x->g_ampList || !x->g_phaseList)
+				return 1;
 			break;
 	}
-			
-	return(x);
+	x->g_lanes = lanes;
+	return 0;
 }
 
 void gendyn_free(t_gendyn *x){
 	dsp_free((t_pxobject *)x);
+	
+	if(x->g_phase) free(x->g_phase);
+	if(x->g_speed) free(x->g_speed);
+	if(x->g_base) free(x->g_base);
+	if(x->g_amp) free(x->g_amp);
+	if(x->g_slope) free(x->g_slope);
+	if(x->g_limit) free(x->g_limit);
+	if(x->g_nextAmp) free(x->g_nextAmp);
+	if(x->g_dur) free(x->g_dur);
+	if(x->g_index) free(x->g_index);
+	if(x->g_key) free(x->g_key);
+	if(x->g_counter) free(x->g_counter);
+	if(x->g_memoryAmp) free(x->g_memoryAmp);
+	if(x->g_memoryDur) free(x->g_memoryDur);
+	if(x->g_draws) free(x->g_draws);
+	if(x->g_memoryAmpStep) free(x->g_memoryAmpStep);
+	if(x->g_memoryDurStep) free(x->g_memoryDurStep);
+	if(x->g_nextPhase) free(x->g_nextPhase);
+	if(x->g_lastPhase) free(x->g_lastPhase);
+	if(x->g_interpMult) free(x->g_interpMult);
+	if(x->g_ampList) free(x->g_ampList);
+	if(x->g_phaseList) free(x->g_phaseList);
 }
 
 // from PD x_misc.c
@@ -253,92 +377,139 @@ static int makeseed(void){
     return (random_nextseed & 0x7fffffff);
 }
 
-void gendy1_constructor(t_gendyn *x){
-	x->g_freqMul = 1.f / sys_getsr();
-	x->g_phase = 1.f;	//should immediately decide on new target 
-	x->g_amp = 0.0; 
-	x->g_nextAmp = 0.0;
-	x->g_speed = 100; 
+// A 32 bit integer hash (lowbias32 by Chris Wellons).  Hashing a counter
+// gives a random number generator whose whole state is the counter: each
+// voice hashes its own key with its own counter, so voices never share a
+// stream and filling a buffer with draws is a loop the compiler can vectorise.
+static uint32_t gendyn_hash(uint32_t h){
+	h ^= h >> 16;
+	h *= 0x7feb352d;
+	h ^= h >> 15;
+	h *= 0x846ca68b;
+	h ^= h >> 16;
+	return h;
+}
+
+// n uniform draws in [0, 1) from the stream key, starting at *counter
+static void gendyn_uniform(uint32_t key, uint32_t *counter, float *out, int n){
+	uint32_t c = *counter;
+	int i;
 	
-	x->g_memorySize = 12;  //this is arg 8 in sc
-	if(x->g_memorySize < 1) x->g_memorySize = 1;
-	x->g_index = 0;
-	//x->g_memoryAmp = (float *)RTAlloc(x->g_World, x->g_memorySize * sizeof(float));
-	x->g_memoryAmp = (float *)calloc(x->g_memorySize, sizeof(float));
-	x->g_memoryDur = (float *)calloc(x->g_memorySize, sizeof(float));
-		
-	//initialise to zeroes and separations
-	int i = 0;
-	for(i = 0; i < x->g_memorySize; ++i) {
-		x->g_memoryAmp[i] = 2 * gsl_ran_flat(x->g_rng, 0, 1) - 1.0;
-		x->g_memoryDur[i] = gsl_ran_flat(x->g_rng, 0, 1);
+	for(i = 0; i < n; i++)
+		out[i] = (gendyn_hash((c + i) ^ key) >> 8) * (1.f / 16777216.f);
+	*counter = c + n;
+}
+
+// sets the number of sounding voices.  Voices that start sounding (all of
+// them if reset is set) start over from the seed; the rest of the lanes are
+// silenced.  Called from the perform routine once the dsp is running.
+void gendyn_setVoices(t_gendyn *x, int n, int reset){
+	int v, old = reset ? 0 : x->g_numVoices;
+	
+	if(n < 1) n = 1;
+	if(n > x->g_maxVoices) n = x->g_maxVoices;
+	for(v = old; v < n; v++)
+		gendyn_initVoice(x, v);
+	for(v = n; v < x->g_lanes; v++)
+		gendyn_padVoice(x, v);
+	x->g_numVoices = n;
+	x->g_gain = 1.f / n;
+}
+
+void gendyn_initVoice(t_gendyn *x, int v){
+	x->g_key[v] = gendyn_hash(x->g_seed ^ gendyn_hash(v + 0x9e3779b9));
+	x->g_counter[v] = 0;
+	x->g_index[v] = 0;
+	x->g_phase[v] = 1.f;	//should immediately decide on new target 
+	x->g_amp[v] = 0.0; 
+	x->g_nextAmp[v] = 0.0;
+	x->g_speed[v] = 100; 
+	x->g_dur[v] = 0.0;
+	
+	switch(x->g_type){
+		case 1:
+			gendy1_constructor(x, v);
+			break;
+		case 2:
+			gendy2_constructor(x, v);
+			break;
+		case 3:
+			gendy3_constructor(x, v);
+			break;
 	}
+	gendyn_segment(x, v);
 }
 
-void gendy2_constructor(t_gendyn *x){
-	x->g_freqMul = 1.f / sys_getsr();
-	x->g_phase = 1.f;	//should immediately decide on new target 
-	x->g_amp = 0.0; 
-	x->g_nextAmp = 0.0;
-	x->g_speed = 100; 
+// a lane with no voice: outputs 0 and never reaches its limit
+void gendyn_padVoice(t_gendyn *x, int v){
+	x->g_phase[v] = 0.;
+	x->g_speed[v] = 0.;
+	x->g_base[v] = 0.;
+	x->g_amp[v] = 0.;
+	x->g_slope[v] = 0.;
+	x->g_limit[v] = HUGE_VAL;
+}
+
+void gendy1_constructor(t_gendyn *x, int v){
+	float *memoryamp = x->g_memoryAmp + v * x->g_memorySize;
+	float *memorydur = x->g_memoryDur + v * x->g_memorySize;
+	float *r = x->g_draws;
+	int i;
 	
-	x->g_memorySize = 12;	//default is 12
-	//printf("memsize %d %f", x->g_MemorySize, ZIN0(8));
-	if(x->g_memorySize < 1) x->g_memorySize = 1;
-	x->g_index = 0;
-	x->g_memoryAmp = (float *)calloc(x->g_memorySize, sizeof(float));
-	x->g_memoryDur = (float *)calloc(x->g_memorySize,  sizeof(float));
-	x->g_memoryAmpStep = (float *)calloc(x->g_memorySize,  sizeof(float));
-	x->g_memoryDurStep = (float *)calloc(x->g_memorySize,  sizeof(float));
-		
 	//initialise to zeroes and separations
-	int i = 0;
+	gendyn_uniform(x->g_key[v], x->g_counter + v, r, 2 * x->g_memorySize);
 	for(i = 0; i < x->g_memorySize; ++i) {
-		x->g_memoryAmp[i] = 2 * gsl_ran_flat(x->g_rng, 0, 1) - 1.0;
-		x->g_memoryDur[i] = gsl_ran_flat(x->g_rng, 0, 1);
-		x->g_memoryAmpStep[i] = 2 * gsl_ran_flat(x->g_rng, 0, 1) - 1.0;
-		x->g_memoryDurStep[i] = 2 * gsl_ran_flat(x->g_rng, 0, 1) - 1.0;
+		memoryamp[i] = 2 * r[2 * i] - 1.0;
+		memorydur[i] = r[2 * i + 1];
 	}
 }
 
-void gendy3_constructor(t_gendyn *x){
-	x->g_freqMul = 1.f / sys_getsr();
-	x->g_phase = 1.f;	//should immediately decide on new target 
-	x->g_amp = 0.0; 
-	x->g_nextAmp = 0.0;
-	x->g_nextPhase = 0.0;
-	x->g_lastPhase = 0.0;
-	x->g_interpMult = 1.0;
-	x->g_speed = 100; 
+void gendy2_constructor(t_gendyn *x, int v){
+	float *memoryampstep = x->g_memoryAmpStep + v * x->g_memorySize;
+	float *memorydurstep = x->g_memoryDurStep + v * x->g_memorySize;
+	float *r = x->g_draws;
+	int i;
 	
-	x->g_freq = 440.f;
+	gendy1_constructor(x, v);
+	gendyn_uniform(x->g_key[v], x->g_counter + v, r, 2 * x->g_memorySize);
+	for(i = 0; i < x->g_memorySize; ++i) {
+		memoryampstep[i] = 2 * r[2 * i] - 1.0;
+		memorydurstep[i] = 2 * r[2 * i + 1] - 1.0;
+	}
+}
+
+void gendy3_constructor(t_gendyn *x, int v){
+	float *amplist = x->g_ampList + v * (x->g_memorySize + 1);
+	double *phaselist = x->g_phaseList + v * (x->g_memorySize + 1);
+	float *r = x->g_draws;
+	int i;
 	
-	x->g_memorySize = 12;//(int) ZIN0(7);
-	if(x->g_memorySize < 1) x->g_memorySize = 1;
-	x->g_index = 0;
-	x->g_memoryAmp= (float *)calloc(x->g_memorySize, sizeof(float));
-	x->g_memoryDur= (float *)calloc(x->g_memorySize, sizeof(float));
+	x->g_nextPhase[v] = 0.0;
+	x->g_lastPhase[v] = 0.0;
+	x->g_interpMult[v] = 1.0;
 	
-	//one more in amp list for guard (wrap) element
-	x->g_ampList= (float *)calloc((x->g_memorySize + 1), sizeof(float));
-	x->g_phaseList= (double *)calloc((x->g_memorySize + 1), sizeof(double));
-		
-	//initialise to zeroes and separations
-	int i = 0;
+	gendy1_constructor(x, v);
+	gendyn_uniform(x->g_key[v], x->g_counter + v, r, x->g_memorySize);
 	for(i = 0; i < x->g_memorySize; ++i) {
-		x->g_memoryAmp[i] = 2 * gsl_ran_flat(x->g_rng, 0., 1.) - 1.0;
-		x->g_memoryDur[i] = gsl_ran_flat(x->g_rng, 0., 1.);
-		x->g_ampList[i] = 2 * gsl_ran_flat(x->g_rng, 0., 1.) - 1.0;
-		x->g_phaseList[i] = 1.0; //will be intialised immediately
+		amplist[i] = 2 * r[i] - 1.0;
+		phaselist[i] = 1.0; //will be intialised immediately
 	}
 	
-	x->g_memoryAmp[0] = 0.0;	//always zeroed first BP
+	x->g_memoryAmp[v * x->g_memorySize] = 0.0;	//always zeroed first BP
 }
 			
 //called once per period so OK to work out constants in here
 float Gendyn_distribution( int which, float a, float f) {
+	Gendyn_distribution_block(which, a, &f, 1);
+	return f;
+}
+
+// Gendyn_distribution on n values at once: the constants are worked out once
+// and each case is a plain loop
+void Gendyn_distribution_block(int which, float a, float *f, int n) {
 
 	float temp, c;
+	int i;
 	
 	if(a>1.0) a=1.0;       //a must be in range 0 to 1
 	if(a<0.0001) a=0.0001; 	//for safety with some distributions, don't want divide by zero errors
@@ -356,11 +527,11 @@ float Gendyn_distribution( int which, float a, float f) {
 			//choice of 10 here is such that f=0.95 gives about 0.35 for temp, could go with 2 to make it finer
 			c= atan(10*a);		//PERHAPS CHANGE TO a=1/a;
 			//incorrect- missed out divisor of pi in norm temp= a*tan(c*(2*pi*f - 1));	
-			temp= (1/a)*tan(c*(2*f - 1));	//Cauchy distribution, C is precalculated
-			
-			//printf("a %f cauchy f %f c %f temp %f out %f \n", a, f,  c, temp, temp/10);
-			
-			return temp*0.1; //(temp+100)/200;
+			for(i = 0; i < n; i++) {
+				temp= (1/a)*tan(c*(2*f[i] - 1));	//Cauchy distribution, C is precalculated
+				f[i]= temp*0.1; //(temp+100)/200;
+			}
+			return;
 			
 		case 2: //LOGIST (ic)
 			//X has -(log((1-z)/z)+b)/a which is not very usable as is
@@ -370,58 +541,57 @@ float Gendyn_distribution( int which, float a, float f) {
 		   
 			//remap into range of valid inputs to avoid infinities in the log
 			
-		   //f= ((f-0.5)*0.499*a)+0.5;
-			f= ((f-0.5)*0.998*a)+0.5; //[0,1]->[0.001,0.999]; squashed around midpoint 0.5 by a
 			//Xenakis calls this the LOGIST map, it's from the range [0,1] to [inf,0] where 0.5->1
 			//than take natural log. to avoid infinities in practise I take [0,1] -> [0.001,0.999]->[6.9,-6.9]
 			//an interesting property is that 0.5-e is the reciprocal of 0.5+e under (1-f)/f 
 			//and hence the logs are the negative of each other
-			temp= log((1-f)/f)/c;	//n range [-1,1]
 			//X also had two constants in his- I don't bother
-			
-			//printf("logist f %f temp %f\n", f, temp);
-			
-			return temp; //a*0.5*(temp+1.0);	//to [0,1]
+			for(i = 0; i < n; i++) {
+				float g= ((f[i]-0.5)*0.998*a)+0.5; //[0,1]->[0.001,0.999]; squashed around midpoint 0.5 by a
+				f[i]= log((1-g)/g)/c;	//n range [-1,1]
+			}
+			return;
 			
 		case 3: //HYPERBCOS
 			//X original a*log(tan(z*pi/2)) which is [0,1]->[0,pi/2]->[0,inf]->[-inf,inf]
 			//unmanageable in this pure form
 			c=tan(1.5692255*a);    //tan(0.999*a*pi*0.5);    	//[0, 636.6] maximum range
-			temp= tan(1.5692255*a*f)/c;	//[0,1]->[0,1] 
-			temp= log(temp*0.999+0.001)*(-0.1447648);  // multiplier same as /(-6.9077553); //[0,1]->[0,1]
-		   
-			 //printf("hyperbcos f %f c %f temp %f\n", f, c, temp);
-			
-			return 2*temp-1.0;
+			for(i = 0; i < n; i++) {
+				temp= tan(1.5692255*a*f[i])/c;	//[0,1]->[0,1] 
+				temp= log(temp*0.999+0.001)*(-0.1447648);  // multiplier same as /(-6.9077553); //[0,1]->[0,1]
+				f[i]= 2*temp-1.0;
+			}
+			return;
 			
 		case 4: //ARCSINE
 			//X original a/2*(1-sin((0.5-z)*pi)) aha almost a better behaved one though [0,1]->[2,0]->[a,0] 
 			c= sin(1.5707963*a); //sin(pi*0.5*a);	//a as scaling factor of domain of sine input to use
-			temp= sin(pi*(f-0.5)*a)/c; //[-1,1] which is what I need
-			
-			//printf("arcsine f %f c %f temp %f\n", f, c, temp);
-			
-			return temp;
+			for(i = 0; i < n; i++)
+				f[i]= sin(PI*(f[i]-0.5)*a)/c; //[-1,1] which is what I need
+			return;
 			
 			case 5: //EXPON
 			//X original -(log(1-z))/a [0,1]-> [1,0]-> [0,-inf]->[0,inf]
 			c= log(1.0-(0.999*a));
-			temp= log(1.0-(f*0.999*a))/c;
-			
-			//printf("expon f %f c %f temp %f\n", f, c, temp);
-			
-			return 2*temp-1.0;
+			for(i = 0; i < n; i++) {
+				temp= log(1.0-(f[i]*0.999*a))/c;
+				f[i]= 2*temp-1.0;
+			}
+			return;
 			
 		case 6: //SINUS
 			//X original a*sin(smp * 2*pi/44100 * b) ie depends on a second oscillator's value- 
 			//hmmm, plug this in as a I guess, will automatically accept control rate inputs then!
-			return 2*a-1.0;
+			for(i = 0; i < n; i++)
+				f[i]= 2*a-1.0;
+			return;
 			
 		default:
 			break;
 		}
 	
-	return 2*f-1.0;
+	for(i = 0; i < n; i++)
+		f[i]= 2*f[i]-1.0;
 }
 		
 float Gendyn_mirroring (float lower, float upper, float in){
@@ -442,6 +612,7 @@ float Gendyn_mirroring (float lower, float upper, float in){
 }
 
 void gendyn_dsp(t_gendyn *x, t_signal **sp, short *count){
+	x->g_freqMul = 1.f / sp[0]->s_sr;
 	dsp_add(gendyn_perform, 4, x, sp[0]->s_vec, sp[1]->s_vec, sp[0]->s_n);
 }
 
@@ -450,25 +621,109 @@ t_int *gendyn_perform(t_int *w){
 	t_float *inL = (t_float *)w[2];
 	t_float *outL = (t_float *)w[3];
 	int n = (int)w[4];
+	int i;
+	
+	if(x->g_type < 1 || x->g_type > 3){
+		for(i = 0; i < n; i++)
+			outL[i] = 0.;
+		return (w + 5);
+	}
 	
+	if(x->g_pendingSeed){
+		x->g_pendingSeed = 0;
+		x->g_pendingVoices = -1;
+		gendyn_setVoices(x, x->g_numVoices, 1);
+	}
+	if(x->g_pendingVoices >= 0){
+		gendyn_setVoices(x, x->g_pendingVoices, 0);
+		x->g_pendingVoices = -1;
+	}
+	
+	gendyn_run(x, outL, n);
+	
+	return (w + 5);
+}
+
+// Runs all the voices GENDYN_LANES at a time, summing their interpolated
+// outputs.  A voice whose phase reaches its limit gets its next segment
+// before the next sample, which is when the single voice code used to check.
+void gendyn_run(t_gendyn *x, t_float *out, int n){
+	double *phase = x->g_phase, *speed = x->g_speed, *base = x->g_base;
+	double *amp = x->g_amp, *slope = x->g_slope, *limit = x->g_limit;
+	int lanes = x->g_lanes, numvoices = x->g_numVoices;
+	float gain = x->g_gain;
+	int i, v, hit;
+	
+	for(i = 0; i < n; i++){
+		double z;
+#if defined(GENDYN_SSE2)
+		__m128d acc = _mm_setzero_pd();
+		
+		hit = 0;
+		for(v = 0; v < lanes; v += 2){
+			__m128d p = _mm_loadu_pd(phase + v);
+			
+			acc = _mm_add_pd(acc, _mm_add_pd(_mm_loadu_pd(amp + v),
+				_mm_mul_pd(_mm_sub_pd(p, _mm_loadu_pd(base + v)), _mm_loadu_pd(slope + v))));
+			p = _mm_add_pd(p, _mm_loadu_pd(speed + v));
+			_mm_storeu_pd(phase + v, p);
+			hit |= _mm_movemask_pd(_mm_cmpge_pd(p, _mm_loadu_pd(limit + v)));
+		}
+		z = _mm_cvtsd_f64(_mm_add_sd(acc, _mm_unpackhi_pd(acc, acc)));
+#elif defined(GENDYN_NEON)
+		float64x2_t acc = vdupq_n_f64(0.);
+		uint64x2_t hits = vdupq_n_u64(0);
+		
+		for(v = 0; v < lanes; v += 2){
+			float64x2_t p = vld1q_f64(phase + v);
+			
+			acc = vaddq_f64(acc, vfmaq_f64(vld1q_f64(amp + v), vsubq_f64(p, vld1q_f64(base + v)), vld1q_f64(slope + v)));
+			p = vaddq_f64(p, vld1q_f64(speed + v));
+			vst1q_f64(phase + v, p);
+			hits = vorrq_u64(hits, vcgeq_f64(p, vld1q_f64(limit + v)));
+		}
+		z = vaddvq_f64(acc);
+		hit = (vgetq_lane_u64(hits, 0) | vgetq_lane_u64(hits, 1)) != 0;
+#else
+		z = 0.;
+		hit = 0;
+		for(v = 0; v < lanes; v++){
+			double p = phase[v];
+			
+			//linear interpolation could be changed
+			z += amp[v] + (p - base[v]) * slope[v];
+			p += speed[v];
+			phase[v] = p;
+			hit |= p >= limit[v];
+		}
+#endif
+		out[i] = z * gain;
+		
+		if(hit){
+			for(v = 0; v < numvoices; v++)
+				if(phase[v] >= limit[v])
+					gendyn_segment(x, v);
+		}
+	}
+}
+
+// the breakpoint code of each gendy, for one voice.  It runs when the voice's
+// phase reaches its limit and sets up the segment that follows.
+void gendyn_segment(t_gendyn *x, int v){
 	switch(x->g_type){
 		case 1:
-			gendy1_perform(x, outL, n);
+			gendy1_segment(x, v);
 			break;
 		case 2:
-			gendy2_perform(x, outL, n);
+			gendy2_segment(x, v);
 			break;
 		case 3:
-			gendy3_perform(x, outL, n);
+			gendy3_segment(x, v);
 			break;
 	}
-	
-	return (w + 5);
 }
 
-void gendy1_perform(t_gendyn *x, t_float *outL, int n){
-	int i;
-	
+void gendy1_segment(t_gendyn *x, int v){
 	int whichamp = x->g_whichamp;
 	int whichdur = x->g_whichdur;
 	float aamp = x->g_aamp;
@@ -478,91 +733,83 @@ void gendy1_perform(t_gendyn *x, t_float *outL, int n){
 	float scaleamp = x->g_scaleamp;
 	float scaledur = x->g_scaledur;
 	
-	float rate = x->g_dur;
-	double phase = x->g_phase;
-	float amp = x->g_amp;
-	float nextamp = x->g_nextAmp;
-	float speed = x->g_speed;
+	float *memoryamp = x->g_memoryAmp + v * x->g_memorySize;
+	float *memorydur = x->g_memoryDur + v * x->g_memorySize;
+	double phase = x->g_phase[v];
+	float amp = x->g_amp[v];
+	float nextamp = x->g_nextAmp[v];
+	float rate = x->g_dur[v];
+	float speed = x->g_speed[v];
+	float r[2];
 	
-	for(i = 0; i < n; i++){
-		float z;
-		if (phase >= 1.f) {
-			phase -= 1.f;
+	if (phase >= 1.f) {
+		phase -= 1.f;
 
-			int index = x->g_index;
-			int num = 12;//(int)(ZIN0(9));//(unit->mMemorySize);(((int)ZIN0(9))%(unit->mMemorySize))+1;
-			if((num > (x->g_memorySize)) || (num < 1)) num = x->g_memorySize;
-			
-			//new code for indexing
-			index = (index + 1) % num;
-			amp = nextamp;
-		   
-			x->g_index = index;
-			
-			//Gendy dist gives value [-1,1], then use scaleamp
-			//first term was amp before, now must check new memory slot
-			nextamp = (x->g_memoryAmp[index]) + (scaleamp * Gendyn_distribution(whichamp, aamp, gsl_ran_flat(x->g_rng, 0., 1.)));
+		int index = x->g_index[v];
+		int num = x->g_num;
+		if((num > (x->g_memorySize)) || (num < 1)) num = x->g_memorySize;
 		
-			//mirroring for bounds- safe version 
-			if(nextamp > 1.0 || nextamp < -1.0) {
-			
-				//printf("mirroring nextamp %f ", nextamp);
-
-				//to force mirroring to be sensible
-				if(nextamp < 0.0) nextamp = nextamp + 4.0;
-			
-				nextamp = fmod(nextamp, 4.0f); 
-				//printf("fmod  %f ", nextamp);
-
-				if(nextamp > 1.0 && nextamp < 3.0)
-					nextamp = 2.0 - nextamp;
-			
-				else if(nextamp > 1.0)
-					nextamp = nextamp - 4.0;
-			
-				//printf("mirrorednextamp %f \n", nextamp);
-			};
-			
-			x->g_memoryAmp[index] = nextamp;
-			
-			//Gendy dist gives value [-1,1]
-			rate = (x->g_memoryDur[index]) + (scaledur * Gendyn_distribution(whichdur, adur, gsl_ran_flat(x->g_rng, 0., 1.)));
-		 
-			if(rate > 1.0 || rate < 0.0){
-				if(rate < 0.0) rate = rate + 2.0;
-				rate = fmod(rate, 2.0f);
-				rate = 2.0 - rate;
-			}
+		//new code for indexing
+		index = (index + 1) % num;
+		amp = nextamp;
+	   
+		x->g_index[v] = index;
 		
-			x->g_memoryDur[index] = rate;
-			
-			//printf("nextamp %f rate %f \n", nextamp, rate);
-
-			//define range of speeds (say between 20 and 1000 Hz)
-			//can have bounds as fourth and fifth inputs
-			speed =  (minfreq + ((maxfreq - minfreq) * rate)) * (x->g_freqMul);
-			
-			//if there are 12 control points in memory, that is 12 per cycle
-			//the speed is multiplied by 12
-			//(I don't store this because updating rates must remain in range [0,1]
-			speed *= num;
-		} 
-			
-		//linear interpolation could be changed
-		z = ((1.0 - phase) * amp) + (phase * nextamp);
+		gendyn_uniform(x->g_key[v], x->g_counter + v, r, 2);
+		
+		//Gendy dist gives value [-1,1], then use scaleamp
+		//first term was amp before, now must check new memory slot
+		nextamp = (memoryamp[index]) + (scaleamp * Gendyn_distribution(whichamp, aamp, r[0]));
 	
-		phase +=  speed;
-		outL[i] = z;
-	};
+		//mirroring for bounds- safe version 
+		if(nextamp > 1.0 || nextamp < -1.0) {
+		
+			//to force mirroring to be sensible
+			if(nextamp < 0.0) nextamp = nextamp + 4.0;
+		
+			nextamp = fmod(nextamp, 4.0f); 
 
-	x->g_phase = phase;
-	x->g_amp =  amp;      
-	x->g_nextAmp = nextamp;
-	x->g_speed = speed;
-	x->g_dur = rate;
+			if(nextamp > 1.0 && nextamp < 3.0)
+				nextamp = 2.0 - nextamp;
+		
+			else if(nextamp > 1.0)
+				nextamp = nextamp - 4.0;
+		};
+		
+		memoryamp[index] = nextamp;
+		
+		//Gendy dist gives value [-1,1]
+		rate = (memorydur[index]) + (scaledur * Gendyn_distribution(whichdur, adur, r[1]));
+	 
+		if(rate > 1.0 || rate < 0.0){
+			if(rate < 0.0) rate = rate + 2.0;
+			rate = fmod(rate, 2.0f);
+			rate = 2.0 - rate;
+		}
+	
+		memorydur[index] = rate;
+		
+		//define range of speeds (say between 20 and 1000 Hz)
+		//can have bounds as fourth and fifth inputs
+		speed =  (minfreq + ((maxfreq - minfreq) * rate)) * (x->g_freqMul);
+		
+		//if there are 12 control points in memory, that is 12 per cycle
+		//the speed is multiplied by 12
+		//(I don't store this because updating rates must remain in range [0,1]
+		speed *= num;
+	} 
+	
+	x->g_phase[v] = phase;
+	x->g_amp[v] = amp;
+	x->g_nextAmp[v] = nextamp;
+	x->g_speed[v] = speed;
+	x->g_dur[v] = rate;
+	x->g_base[v] = 0.;
+	x->g_slope[v] = nextamp - amp;
+	x->g_limit[v] = 1.;
 }
 
-void gendy2_perform(t_gendyn *x, t_float *outL, int n){
+void gendy2_segment(t_gendyn *x, int v){
 	//distribution choices for amp and dur and constants of distribution
 	int whichamp = x->g_whichamp;
 	int whichdur = x->g_whichdur;
@@ -573,92 +820,85 @@ void gendy2_perform(t_gendyn *x, t_float *outL, int n){
 	float scaleamp = x->g_scaleamp;
 	float scaledur = x->g_scaledur;
 	
-	float rate = x->g_dur;
-	double phase = x->g_phase;
-	float amp = x->g_amp;
-	float nextamp = x->g_nextAmp;
-	float speed = x->g_speed;
+	float *memoryamp = x->g_memoryAmp + v * x->g_memorySize;
+	float *memorydur = x->g_memoryDur + v * x->g_memorySize;
+	float *memoryampstep = x->g_memoryAmpStep + v * x->g_memorySize;
+	float *memorydurstep = x->g_memoryDurStep + v * x->g_memorySize;
+	double phase = x->g_phase[v];
+	float amp = x->g_amp[v];
+	float nextamp = x->g_nextAmp[v];
+	float rate = x->g_dur[v];
+	float speed = x->g_speed[v];
+	float r;
 	
-	int i;
-
-	for(i = 0; i < n; i++){
-		float z;
-				
-		if (phase >= 1.f) {
-			phase -= 1.f;
-
-			int index= x->g_index;
-			int num = 12;//(int)(ZIN0(9));//(unit->mMemorySize);(((int)ZIN0(9))%(unit->mMemorySize))+1;
-			if((num > (x->g_memorySize)) || (num < 1)) num = x->g_memorySize;
-			
-			//new code for indexing
-			index = (index + 1) % num;
-			
-			//using last amp value as seed
-			//random values made using a lehmer number generator xenakis style
-			float a = 1.17;//ZIN0(10); 
-			float c = .31;//ZIN0(11);
-			
-			float lehmerxen = fmod(((amp) * a) + c, 1.0f);  
-			
-			//printf("lehmer %f \n", lehmerxen);
+	if (phase >= 1.f) {
+		phase -= 1.f;
 
-			amp = nextamp;
-		   
-			x->g_index = index;
-			
-			//Gendy dist gives value [-1,1], then use scaleamp
-			//first term was amp before, now must check new memory slot
-		   
-			float ampstep = (x->g_memoryAmpStep[index]) + Gendyn_distribution(whichamp, aamp, fabs(lehmerxen));
-			ampstep = Gendyn_mirroring(-1.0, 1.0, ampstep);
-		   
-			x->g_memoryAmpStep[index] = ampstep;
-			
-			nextamp = (x->g_memoryAmp[index]) + (scaleamp * ampstep);
-			
-			nextamp = Gendyn_mirroring(-1.0, 1.0, nextamp);
-			
-			x->g_memoryAmp[index] = nextamp;
-			
-			float durstep = (x->g_memoryDurStep[index]) + Gendyn_distribution(whichdur, adur, gsl_ran_flat(x->g_rng, 0., 1.));
-			durstep = Gendyn_mirroring(-1.0, 1.0, durstep);
-		   
-			x->g_memoryDurStep[index] = durstep;
-			
-			rate = (x->g_memoryDur[index]) + (scaledur * durstep);
-			
-			rate = Gendyn_mirroring(0.0, 1.0, rate);
-			
-			x->g_memoryDur[index] = rate;
-			
-			//printf("nextamp %f rate %f \n", nextamp, rate);
+		int index= x->g_index[v];
+		int num = x->g_num;
+		if((num > (x->g_memorySize)) || (num < 1)) num = x->g_memorySize;
+		
+		//new code for indexing
+		index = (index + 1) % num;
+		
+		//using last amp value as seed
+		//random values made using a lehmer number generator xenakis style
+		float a = 1.17;//ZIN0(10); 
+		float c = .31;//ZIN0(11);
+		
+		float lehmerxen = fmod(((amp) * a) + c, 1.0f);  
+		
+		amp = nextamp;
+	   
+		x->g_index[v] = index;
+		
+		//Gendy dist gives value [-1,1], then use scaleamp
+		//first term was amp before, now must check new memory slot
+	   
+		float ampstep = (memoryampstep[index]) + Gendyn_distribution(whichamp, aamp, fabs(lehmerxen));
+		ampstep = Gendyn_mirroring(-1.0, 1.0, ampstep);
+	   
+		memoryampstep[index] = ampstep;
+		
+		nextamp = (memoryamp[index]) + (scaleamp * ampstep);
+		
+		nextamp = Gendyn_mirroring(-1.0, 1.0, nextamp);
+		
+		memoryamp[index] = nextamp;
+		
+		gendyn_uniform(x->g_key[v], x->g_counter + v, &r, 1);
+		float durstep = (memorydurstep[index]) + Gendyn_distribution(whichdur, adur, r);
+		durstep = Gendyn_mirroring(-1.0, 1.0, durstep);
+	   
+		memorydurstep[index] = durstep;
+		
+		rate = (memorydur[index]) + (scaledur * durstep);
+		
+		rate = Gendyn_mirroring(0.0, 1.0, rate);
+		
+		memorydur[index] = rate;
+		
+		//define range of speeds (say between 20 and 1000 Hz)
+		//can have bounds as fourth and fifth inputs
+		speed =  (minfreq + ((maxfreq - minfreq) * rate)) * (x->g_freqMul);
+		
+		//if there are 12 control points in memory, that is 12 per cycle
+		//the speed is multiplied by 12
+		//(I don't store this because updating rates must remain in range [0,1]
+		speed *= num;
+	} 
+	
+	x->g_phase[v] = phase;
+	x->g_amp[v] = amp;
+	x->g_nextAmp[v] = nextamp;
+	x->g_speed[v] = speed;
+	x->g_dur[v] = rate;
+	x->g_base[v] = 0.;
+	x->g_slope[v] = nextamp - amp;
+	x->g_limit[v] = 1.;
+}
 
-			//define range of speeds (say between 20 and 1000 Hz)
-			//can have bounds as fourth and fifth inputs
-			speed =  (minfreq + ((maxfreq - minfreq) * rate)) * (x->g_freqMul);
-			
-			//if there are 12 control points in memory, that is 12 per cycle
-			//the speed is multiplied by 12
-			//(I don't store this because updating rates must remain in range [0,1]
-			speed *= num;
-		} 
-				
-		//linear interpolation could be changed
-		z = ((1.0 - phase) * amp) + (phase * nextamp);
-		
-		phase +=  speed;
-		outL[i] = z;
-	};
-
-	x->g_phase = phase;
-	x->g_amp =  amp;      
-	x->g_nextAmp = nextamp;
-	x->g_speed = speed;
-	x->g_dur = rate;
-}
-
-void gendy3_perform(t_gendyn *x, t_float *outL, int n){
+void gendy3_segment(t_gendyn *x, int v){
 	//distribution choices for amp and dur and constants of distribution
 	int whichamp = x->g_whichamp;
 	int whichdur = x->g_whichdur;
@@ -668,122 +908,114 @@ void gendy3_perform(t_gendyn *x, t_float *outL, int n){
 	float scaledur = x->g_scaledur;
 	float freq = x->g_freq;
 
-	double phase = x->g_phase;
-	float amp = x->g_amp;
-	float nextamp = x->g_nextAmp;
-	float speed = x->g_speed;
-	int index = x->g_index;  
-	int interpmult = (int)x->g_interpMult;
-	double lastphase = x->g_lastPhase;
-	double nextphase = x->g_nextPhase;
+	double phase = x->g_phase[v];
+	float amp = x->g_amp[v];
+	float nextamp = x->g_nextAmp[v];
+	float speed = x->g_speed[v];
+	int index = x->g_index[v];  
+	int interpmult = (int)x->g_interpMult[v];
+	double lastphase = x->g_lastPhase[v];
+	double nextphase = x->g_nextPhase[v];
 	
-	int i, j;
+	int j;
 
-	float *amplist = x->g_ampList;
-	double *phaselist = x->g_phaseList;
+	float *amplist = x->g_ampList + v * (x->g_memorySize + 1);
+	double *phaselist = x->g_phaseList + v * (x->g_memorySize + 1);
 
-	for(i = 0; i < n; i++){ 
-		float z;
-				
-		if (phase >= 1.f) { //calculate all targets for new period
-			phase -= 1.f;
+	if (phase >= 1.f) { //calculate all targets for new period
+		phase -= 1.f;
 
-			int num = 12;//(int)(ZIN0(8));
-			if((num > (x->g_memorySize)) || (num < 1)) num = x->g_memorySize;
-			
-			float dursum = 0.0;
-			
-			float *memoryamp= x->g_memoryAmp;
-			float *memorydur= x->g_memoryDur;
-			
-			for(j = 0; j < num; ++j) {
-			
-				if(j > 0) {   //first BP always stays at 0
-					float amp = (memoryamp[j]) + (scaleamp * Gendyn_distribution(whichamp, aamp, gsl_ran_flat(x->g_rng, 0., 1.)));
-					amp = Gendyn_mirroring(-1.0, 1.0, amp);
-					memoryamp[j] = amp;
-				}
-			   
-				float dur = (memorydur[j]) + (scaledur * Gendyn_distribution(whichdur, adur, gsl_ran_flat(x->g_rng, 0., 1.)));
-				dur = Gendyn_mirroring(0.01, 1.0, dur);	//will get normalised in a moment, don't allow zeroes
-				memorydur[j] = dur;
-				dursum += dur;
+		int num = x->g_num;
+		if((num > (x->g_memorySize)) || (num < 1)) num = x->g_memorySize;
+		
+		float dursum = 0.0;
+		
+		float *memoryamp= x->g_memoryAmp + v * x->g_memorySize;
+		float *memorydur= x->g_memoryDur + v * x->g_memorySize;
+		
+		// all the period's random numbers at once: num - 1 for the
+		// amplitudes (first BP always stays at 0), then num for the durations
+		float *ampdraws = x->g_draws;
+		float *durdraws = x->g_draws + num - 1;
+		
+		gendyn_uniform(x->g_key[v], x->g_counter + v, x->g_draws, 2 * num - 1);
+		Gendyn_distribution_block(whichamp, aamp, ampdraws, num - 1);
+		Gendyn_distribution_block(whichdur, adur, durdraws, num);
+		
+		for(j = 0; j < num; ++j) {
+		
+			if(j > 0) {   //first BP always stays at 0
+				float amp = (memoryamp[j]) + (scaleamp * ampdraws[j - 1]);
+				amp = Gendyn_mirroring(-1.0, 1.0, amp);
+				memoryamp[j] = amp;
 			}
+		   
+			float dur = (memorydur[j]) + (scaledur * durdraws[j]);
+			dur = Gendyn_mirroring(0.01, 1.0, dur);	//will get normalised in a moment, don't allow zeroes
+			memorydur[j] = dur;
+			dursum += dur;
+		}
+		
+		//normalising constant
+		dursum = 1.0 / dursum;
+		
+		int active = 0;
+		
+		//phase duration of a sample
+		float minphase = x->g_freqMul;
+		
+		speed = freq * minphase;
+
+		//normalise and discard any too short (even first)
+		for(j = 0; j < num; ++j) {
+		
+			float dur = memorydur[j];
+			dur *= dursum;
 			
-			//normalising constant
-			dursum = 1.0 / dursum;
-			
-			int active = 0;
-			
-			//phase duration of a sample
-			float minphase = x->g_freqMul;
-			
-			speed = freq * minphase;
-	
-			//normalise and discard any too short (even first)
-			for(j = 0; j < num; ++j) {
-			
-				float dur = memorydur[j];
-				dur *= dursum;
-				
-				if(dur >= minphase) {
-					amplist[active] = memoryamp[j];
-					phaselist[active] = dur;
-					++active;
-				}
+			if(dur >= minphase) {
+				amplist[active] = memoryamp[j];
+				phaselist[active] = dur;
+				++active;
 			}
-			
-			//add a zero on the end at active
-			amplist[active] = 0.0; //guard element
-			phaselist[active] = 2.0; //safety element
-			
-			//lastphase=0.0;
-//					nextphase= phaselist[0];
-//					amp=amplist[0];
-//					nextamp=amplist[1];
-//					index=0;
-//					unit->mIndex=index;
-//					
-			//setup to trigger next block
-			nextphase = 0.0;
-			nextamp = amplist[0];
-			index = -1;
-		} 
-			
+		}
 		
-		if (phase >= nextphase) { //are we into a new region?
+		//add a zero on the end at active
+		amplist[active] = 0.0; //guard element
+		phaselist[active] = 2.0; //safety element
 		
-			//new code for indexing
-			++index; //=index+1; //%num;
-			
-			amp = nextamp;
-		   
-			x->g_index = index;
-			
-			lastphase = nextphase;
-			nextphase = lastphase + phaselist[index];
-			nextamp = amplist[index + 1]; 
-								
-			interpmult = (int)(1.0 / (nextphase - lastphase));
-			
-		}	
-				
-		float interp = (phase - lastphase) * interpmult;		
-				
-		//linear interpolation could be changed
-		z = ((1.0 - interp) * amp) + (interp * nextamp);
-		
-		phase +=  speed;
-		outL[i] = z;
-	};
-
-	x->g_phase = phase;
-	x->g_speed = speed;
-	x->g_interpMult = interpmult; 
-	x->g_amp = amp;      
-	x->g_nextAmp = nextamp;
-	x->g_lastPhase = lastphase;
-	x->g_nextPhase = nextphase;
+		//setup to trigger next block
+		nextphase = 0.0;
+		nextamp = amplist[0];
+		index = -1;
+	} 
+		
+	
+	if (phase >= nextphase) { //are we into a new region?
+	
+		//new code for indexing
+		++index; //=index+1; //%num;
+		
+		amp = nextamp;
+	   
+		lastphase = nextphase;
+		nextphase = lastphase + phaselist[index];
+		nextamp = amplist[index + 1]; 
+							
+		interpmult = (int)(1.0 / (nextphase - lastphase));
+		
+	}	
+	
+	x->g_phase[v] = phase;
+	x->g_speed[v] = speed;
+	x->g_index[v] = index;
+	x->g_interpMult[v] = interpmult; 
+	x->g_amp[v] = amp;      
+	x->g_nextAmp[v] = nextamp;
+	x->g_lastPhase[v] = lastphase;
+	x->g_nextPhase[v] = nextphase;
+	x->g_base[v] = lastphase;
+	x->g_slope[v] = interpmult * (nextamp - amp);
+	x->g_limit[v] = nextphase < 1. ? nextphase : 1.;
 }
 
 void whichamp(t_gendyn *x, long l){
@@ -826,6 +1058,30 @@ void freq(t_gendyn *x, double l){
 	x->g_freq = fabs(l);
 }
 
+// number of breakpoints used, up to the memory size
+void num(t_gendyn *x, long l){
+	if(l < 1) l = 1;
+	if(l > x->g_memorySize) l = x->g_memorySize;
+	x->g_num = l;
+}
+
+// number of voices sounding, up to the number given when the object was made
+void voices(t_gendyn *x, long l){
+	if(l < 1) l = 1;
+	if(l > x->g_maxVoices){
+		post("gendyn~: only %d voices were allocated", x->g_maxVoices);
+		l = x->g_maxVoices;
+	}
+	x->g_pendingVoices = l;
+}
+
+// restarts every voice from a seed: the same seed, voices and parameters
+// give the same output
+void seed(t_gendyn *x, long l){
+	x->g_seed = (uint32_t)l;
+	x->g_pendingSeed = 1;
+}
+
 void gendyn_tellmeeverything(t_gendyn *x){
 	version(0);
 	
@@ -837,4 +1093,7 @@ void gendyn_tellmeeverything(t_gendyn *x){
 	post("x->g_maxfreq %f", x->g_maxfreq);
 	post("x->g_scaleamp %f", x->g_scaleamp);
 	post("x->g_scaledur %f", x->g_scaledur);
+	post("x->g_num %d", x->g_num);
+	post("x->g_numVoices %d (of %d)", x->g_numVoices, x->g_maxVoices);
+	post("x->g_seed %u", x->g_seed);
 }
@@ -33,6 +33,7 @@
 #define E  2.71828182845904523536028747135266249775724709369995
 
 #define DEFAULTMAXOSCILLATORS 256
+#define STEALSEARCH 8	// voices steal 1 looks at, from the oldest
 
 #define TPOW 16
 #define STABSZ (1l<<TPOW)
@@ -62,7 +63,6 @@ typedef struct _osc
     int         offset;
 
     int         outlet;
-    
 
 } t_osc;
 
@@ -77,8 +77,16 @@ typedef struct _grans {
     
     double          maxhz;
     t_osc           *base;
+    
+    int             *freevoices;    // stack of unused voice indices
+    int             nfree;
+    int             *activevoices;  // ring of sounding voice indices in start order, oldest at activehead
+    int             activehead;
+    long            nactive;
+    long            peakvoices;
+    long            stolen;
+    long            steal;          // what to do when a trigger finds no free voice, see grans_stealVoice()
         
-    int             nosc;
     int             next_nosc;
     double          pk;
     double          pkw;
@@ -110,7 +118,8 @@ void grans_perform64(t_grans *x, t_object *dsp64, double **ins, long numins, dou
 
 static void grans_clear(t_grans *x);
 
-void grans_releaseVoice(t_grans *x, t_osc *osc);
+void grans_releaseVoice(t_grans *x, int v);
+int grans_stealVoice(t_grans *x);
 void grans_setNewGrain(t_grans *x, int offset, double chirp, double freq, double duration, double attack, double slope, int type);
 
 
@@ -150,6 +159,13 @@ int main(void)
 	
     CLASS_ATTR_LONG(c, "alwayson", 0, t_grans, always_on);
     
+    CLASS_ATTR_LONG(c, "steal", 0, t_grans, steal);
+    CLASS_ATTR_FILTER_CLIP(c, "steal", 0, 2);
+    
+    CLASS_ATTR_LONG(c, "activevoices", ATTR_SET_OPAQUE_USER, t_grans, nactive);
+    CLASS_ATTR_LONG(c, "peakvoices", ATTR_SET_OPAQUE_USER, t_grans, peakvoices);
+    CLASS_ATTR_LONG(c, "stolen", ATTR_SET_OPAQUE_USER, t_grans, stolen);
+    
 	class_dspinit(c);
 	class_register(CLASS_BOX, c);
 	grans_class = c;
@@ -208,7 +224,12 @@ void *grans_new(t_symbol *s, long argc, t_atom *argv)
         x->ob.z_misc |= Z_NO_INPLACE;
 
         
+        if( x->maxoscillators < 1 )
+            x->maxoscillators = 1;
+        
 		x->base = (t_osc *)calloc(x->maxoscillators, sizeof(t_osc));
+        x->freevoices = (int *)calloc(x->maxoscillators, sizeof(int));
+        x->activevoices = (int *)calloc(x->maxoscillators, sizeof(int));
         x->sinetab = (double *)calloc(STABSZ, sizeof(double));
         x->wind_costab = (double *)calloc(STABSZ, sizeof(double));
         x->expdecaytab = (double *)calloc(STABSZ, sizeof(double));
@@ -246,7 +267,8 @@ void *grans_new(t_symbol *s, long argc, t_atom *argv)
         x->pkw = ( STABSZ * x->sampleinterval ) ;
 
         x->maxhz = (x->samplerate / 2) * x->pkw;
-        x->nosc = x->next_nosc = 0;
+        x->next_nosc = 0;
+        x->steal = 0;
         
         x->prev_in1 = 0.0;
         
@@ -291,6 +313,8 @@ void grans_free(t_grans *x)
     free(x->wind_costab);
 	free(x->sinetab);
     free(x->base);
+    free(x->freevoices);
+    free(x->activevoices);
     
     
     long i;
@@ -306,6 +330,8 @@ void grans_free(t_grans *x)
     x->expdecaytab = NULL;
     x->wind_costab = NULL;
     x->base = NULL;
+    x->freevoices = NULL;
+    x->activevoices = NULL;
     x->sinetab = NULL;
 }
 
@@ -327,6 +353,15 @@ static void grans_clear(t_grans *x)
         p->window_type  = 0;
         p->tex = 0.0;
 	}
+    
+    // everything is free again; push in reverse so voice 0 is handed out first
+    for( i = 0; i < x->maxoscillators; ++i )
+        x->freevoices[i] = x->maxoscillators - 1 - i;
+    x->nfree = x->maxoscillators;
+    x->activehead = 0;
+    x->nactive = 0;
+    x->peakvoices = 0;
+    x->stolen = 0;
 }
 
 
@@ -401,16 +436,14 @@ void grans_perform64(t_grans *x, t_object *dsp64, double **ins, long numins, dou
     
     const double **exptab = (const double **)x->exptab;
     
-    const Boolean alwayson = x->always_on;
+    //zero out samples
+    for(i = 0; i < numouts; i++){
+        memset(outlets[i], 0, sampleframes * sizeof(double));
+    }
     
-    //zero out samples, and check for new triggers
+    //check for new triggers
     for ( j = 0; j < sampleframes; j++)
     {
-        
-        for(i = 0; i < numouts; i++){ //might be able to move this into the main loop, and do the grain allocation there too... if that was the case the j offset could be removed also
-            outlets[i][j] = 0.0;
-        }
-
         trigger = *in1++; //trigger also used for chirp rate
         hz = *in2++;
         dur = *in3++;
@@ -430,9 +463,11 @@ void grans_perform64(t_grans *x, t_object *dsp64, double **ins, long numins, dou
     x->prev_in1 = prev_trig;
 
     
-    t_osc *o = x->base;
+    t_osc *o;
+    int *active = x->activevoices;
+    const int maxosc = x->maxoscillators;
+    int k, v, nactive, kept, r, w;
 
-    const int    maxoscillators = x->maxoscillators;
     const double tabSamp = 1.0 / STABSZ;
     const double halftab = 0.5 * STABSZ;
     const int    shapetabscale = NSHAPINGTABS - 1;
@@ -443,13 +478,19 @@ void grans_perform64(t_grans *x, t_object *dsp64, double **ins, long numins, dou
     register double     pi, wpi, att, slop, amp, tex, chirprate;
     register int        w_type, outletnum;
     
-    for( i = 0; i < maxoscillators; i++, o++)
+    // only sounding voices are on the active list, so silent ones cost nothing (alwayson is kept for old patches but has no effect now)
+    // finished voices are squeezed out as we go (r reads, w writes back), which keeps the rest in start order
+    nactive = x->nactive;
+    kept = 0;
+    r = w = x->activehead;
+    for( k = 0; k < nactive; k++ )
     {
+        v = active[r];
+        if( ++r == maxosc )
+            r = 0;
+        o       = x->base + v;
         
         pi      = o->phase_inc;
-        if( pi == 0.0 && !alwayson) continue; //<< if not always on, it's a little cheaper, but spiky
-        //actually this is only one part of cpu cost, the other part is writing the windows, i'm not sure if I can reduced that...
-        
         pc      = o->phase_current;
         
         wpc     = o->window_phase_curent;
@@ -476,7 +517,8 @@ void grans_perform64(t_grans *x, t_object *dsp64, double **ins, long numins, dou
                                           (uint32_t)(cos_wind[(uint32_t)(exptab[ xshapetab ][ (uint32_t)wpc ] * wtabscale)] * wtabscale)
                                           ];
                 outlets[outletnum][j] += amp * sinetab[ (uint32_t)pc ];
-                pc = fmod((pc + pi), STABSZ);
+                pc += pi;
+                if( pc >= STABSZ ) pc -= STABSZ;
                 wpc += wpi;
                 
                 j++;
@@ -502,7 +544,8 @@ void grans_perform64(t_grans *x, t_object *dsp64, double **ins, long numins, dou
                 }
                                 
                 outlets[outletnum][j] += amp * sinetab[ (uint32_t)pc ];
-                pc = fmod((pc + pi), STABSZ);
+                pc += pi;
+                if( pc >= STABSZ ) pc -= STABSZ;
                 wpc += wpi;
                 
                 j++;
@@ -518,7 +561,8 @@ void grans_perform64(t_grans *x, t_object *dsp64, double **ins, long numins, dou
                                           (uint32_t)(dampedsinetab[(uint32_t)(exptab[ xshapetab ][ (uint32_t)wpc ] * wtabscale)] * wtabscale)
                                           ];
                 outlets[outletnum][j] += amp * sinetab[ (uint32_t)pc ];
-                pc = fmod((pc + pi), STABSZ);
+                pc += pi;
+                if( pc >= STABSZ ) pc -= STABSZ;
                 wpc += wpi;
                 
                 j++;
@@ -533,7 +577,8 @@ void grans_perform64(t_grans *x, t_object *dsp64, double **ins, long numins, dou
                                           (uint32_t)(sinc_wind[(uint32_t)(exptab[ xshapetab ][ (uint32_t)wpc ] * wtabscale)] * wtabscale)
                                           ];
                 outlets[outletnum][j] += amp * sinetab[ (uint32_t)pc ];
-                pc = fmod((pc + pi), STABSZ);
+                pc += pi;
+                if( pc >= STABSZ ) pc -= STABSZ;
                 wpc += wpi;
                 
                 j++;
@@ -586,69 +631,112 @@ void grans_perform64(t_grans *x, t_object *dsp64, double **ins, long numins, dou
         {
             o->window_phase_curent = wpc;
             o->phase_current = pc;
-            
+            active[w] = v;
+            if( ++w == maxosc )
+                w = 0;
+            kept++;
         }
         else
         {
 release:
-            grans_releaseVoice(x, o); //this could probably be moved out of the osc loop, but seems ok
-
-            if(x->nosc == 0 && !alwayson)
-                break;
+            grans_releaseVoice(x, v);
         }
 
     }
+    x->nactive = kept;
 }
 
 
 
 void grans_setNewGrain(t_grans *x, int offset, double chirprate, double freq, double duration, double attack, double slope, int type)
 {
-    int i, maxoscillators = x->maxoscillators;
-    t_osc *o = x->base;
+    int v;
+    t_osc *o;
     double pkw = x->pkw;
     //  double sr = x->samplerate; //could pass this from perform in case of change?
     
-        
-    for ( i = 0; i < maxoscillators; ++i )
+    if( x->nfree > 0 )
+    {
+        v = x->freevoices[ --x->nfree ];
+        x->nactive++;
+        if( x->nactive > x->peakvoices )
+            x->peakvoices = x->nactive;
+    }
+    else if( x->steal && x->nactive > 0 )
+    {
+        v = grans_stealVoice(x); // taken off the front of the ring, goes back on at the end as the newest voice
+        x->stolen++;
+    }
+    else
+    {
+        return; // pool exhausted, trigger ignored
+    }
+    x->activevoices[ (x->activehead + x->nactive - 1) % x->maxoscillators ] = v;
+    
+    o = x->base + v;
+
+    o->window_type = type;
+    
+    // o->phase_inc = freq * pk; //bit shift version
+    o->phase_inc = fmod(freq * pkw, STABSZ); //modulo version, aliased into the table so the perform loop can wrap by subtraction
+    o->next_phase_inc = o->phase_inc; //this might be useful in case of frequency change
+    
+    o->chirp_direction = (chirprate > 0) ? 1 : -1;
+    o->chirp_rate = fabs(chirprate) * pkw;
+    
+    double dur_hz = 1000.0 / duration;
+    o->window_phase_inc = dur_hz * pkw;
+    
+    
+   // o->tex = 1.0 / ((attack > 1.0) ? 1.0 : attack);
+    o->tex = 1.0 / attack;
+    
+    o->offset = offset;
+    
+    o->phase_current = 0.0; // a stolen voice still has its old phase
+    o->window_phase_curent = 0.0; //offset for cos
+    o->window_attack = CLAMP(attack, 0.0, 1.0);
+    o->window_slope = CLAMP(slope, 0.0, 1.0);
+    
+    x->outletiter++;
+    o->outlet =  x->outletiter % x->numoutlets;
+    
+}
+
+// pick the voice to restart when there are no free voices, and take it off the front of the active ring:
+// steal 2 takes the oldest one, steal 1 the one nearest the end of its window (usually the quietest)
+// among the STEALSEARCH oldest, so neither costs more as the pool grows
+int grans_stealVoice(t_grans *x)
+{
+    int *ring = x->activevoices;
+    int max = x->maxoscillators, head = x->activehead;
+    int k, best = 0, n = (x->nactive < STEALSEARCH) ? (int)x->nactive : STEALSEARCH;
+    int v;
+    
+    if( x->steal == 1 )
     {
-        if( o->phase_inc == 0.0 )
+        for( k = 1; k < n; k++ )
         {
-            o->window_type = type;
-            
-            // o->phase_inc = freq * pk; //bit shift version
-            o->phase_inc = freq * pkw; //modulo version
-            o->next_phase_inc = o->phase_inc; //this might be useful in case of frequency change
-            
-            o->chirp_direction = (chirprate > 0) ? 1 : -1;
-            o->chirp_rate = fabs(chirprate) * pkw;
-            
-            double dur_hz = 1000.0 / duration;
-            o->window_phase_inc = dur_hz * pkw;
-            
-            
-           // o->tex = 1.0 / ((attack > 1.0) ? 1.0 : attack);
-            o->tex = 1.0 / attack;
-            
-            o->offset = offset;
-            
-            o->window_phase_curent = 0.0; //offset for cos
-            o->window_attack = CLAMP(attack, 0.0, 1.0);
-            o->window_slope = CLAMP(slope, 0.0, 1.0);
-            
-            x->outletiter++;
-            o->outlet =  x->outletiter % x->numoutlets;
-            
-            x->nosc++;
-            break;
+            if( x->base[ ring[ (head + k) % max ] ].window_phase_curent > x->base[ ring[ (head + best) % max ] ].window_phase_curent )
+                best = k;
         }
-        o++;
     }
     
+    // move the older voices up one so the ring stays in start order
+    v = ring[ (head + best) % max ];
+    for( k = best; k > 0; k-- )
+        ring[ (head + k) % max ] = ring[ (head + k - 1) % max ];
+    
+    x->activehead = (head + 1) % max;
+    return v;
 }
 
-void grans_releaseVoice(t_grans *x, t_osc *o)
+// the caller takes v off the active ring
+void grans_releaseVoice(t_grans *x, int v)
 {
+    t_osc *o = x->base + v;
+    
+
     //with the window verison most of this clearing is probably unecessary as long as things are initialized correctly  ... i.e. just need to set phase_inc to 0.0
     o->phase_inc = 0.0;
     o->phase_current = 0.0;
@@ -656,7 +744,7 @@ void grans_releaseVoice(t_grans *x, t_osc *o)
     o->window_phase_inc = 0.0;
     o->window_phase_curent = 0.0;
 
-    --x->nosc; //I think not used now
+    x->freevoices[ x->nfree++ ] = v;
 }
 
 
@@ -16,21 +16,35 @@
 #include <math.h>
 #include "foflib.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FOF_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define FOF_NEON
+#include <arm_neon.h>
+#endif
+
 
 // fof_init sets up the inputs and params structure with default values
 // and initializes the f0_phase
 
 static void fof_init(t_fof *x)
 {   
-	x->inputs.f0 = 0;
-    x->inputs.cf = DEF_CF;
-    x->inputs.bw = DEF_BW;
-    x->inputs.amp = DEF_AMP;
-    x->inputs.tex = DEF_TEX;
-    x->inputs.debatt = DEF_DEBATT;
-    x->inputs.atten = DEF_ATTEN;
-    x->inputs.phase = 0.;
-    x->inputs.changed = 1;
+    int i;
+    
+    x->f0 = 0;
+    x->nformants = 1;
+    for (i = 0; i < MAX_FORMANTS; i++) {
+	t_fof_inputs *in = &(x->formants[i].inputs);
+	in->cf = DEF_CF;
+	in->bw = DEF_BW;
+	in->amp = DEF_AMP;
+	in->tex = DEF_TEX;
+	in->debatt = DEF_DEBATT;
+	in->atten = DEF_ATTEN;
+	in->phase = 0.;
+	in->changed = 1;
+    }
     x->params.sr = DEFAULT_SRATE;
     x->params.sro2 = x->params.sr * 0.5;
     x->params.sp = 1 / x->params.sr;
@@ -40,74 +54,82 @@ static void fof_init(t_fof *x)
     x->f0_phase = 0;
 }
 
-// fof_init_list initializes the free list to contain all (maxfofs) fofs
-static void fof_init_list(t_fof_list *x)
+// fof_clear_lane makes lane i silent: y stays 0 and the envelope is 0
+static void fof_clear_lane(t_fof_bank *x, long i)
 {
-    t_fof_entry *p = x->fofs;
-    int i;
+    x->y1[i] = x->y2[i] = 0;
+    x->ec1[i] = x->ec2[i] = 0;
+    x->c[i] = 2;
+    x->e1[i] = x->e2[i] = -0.5;
+    x->fofs[i].part = FOF_DONE;
+    x->fofs[i].count = 0;
+}
+
+// fof_init_bank stops all fofs and allows (maxfofs) of them to run at once
+static void fof_init_bank(t_fof_bank *x, long maxfofs)
+{
+    long i;
     
-    x->free.next = p;
-    x->used.next = LIST_END;
-    for (i = 1; i < x->maxfofs; i++)
-	p[i - 1].next = &p[i];
-    p[--i].next = LIST_END;
+    x->nfofs = 0;
+    x->maxfofs = maxfofs;
+    for (i = 0; i < MAX_FOFS; i++)
+	fof_clear_lane(x, i);
 }
 
 /* fof_update calculates some fof parameters and coefficients from the
    fof inputs, it is called when any of the parameters changed
    [2x exp(), 3x cos()] */
    
-static void fof_update(t_fof_entry *entry, t_fof *x)
+static void fof_update(t_fof_formant *f, t_fof_params *p)
 {
-    t_fof_real sp = x->params.sp, pi = x->params.pi, bwc;
+    t_fof_real sp = p->sp, pi = p->pi, bwc;
     
-    x->params.cf2pi = x->inputs.cf * x->params.twopi;
-    x->params.bwpi = x->inputs.bw * pi;
-    x->params.piotex = pi / x->inputs.tex;
-    x->params.pioatten = pi / x->inputs.atten;
-    x->params.fpc = x->params.cf2pi * sp;
-    x->params.bpc = exp(x->params.bwpi * sp);
-    x->params.tpc = x->inputs.tex > 0 ? x->params.piotex * sp : 0;
-    x->params.apc = x->inputs.atten > 0 ? x->params.pioatten * sp : 0;
+    f->cf2pi = f->inputs.cf * p->twopi;
+    f->bwpi = f->inputs.bw * pi;
+    f->piotex = pi / f->inputs.tex;
+    f->pioatten = pi / f->inputs.atten;
+    f->fpc = f->cf2pi * sp;
+    f->bpc = exp(f->bwpi * sp);
+    f->tpc = f->inputs.tex > 0 ? f->piotex * sp : 0;
+    f->apc = f->inputs.atten > 0 ? f->pioatten * sp : 0;
 
-    bwc = exp(- x->params.bwpi * sp);
-    x->coefs_cache.ec1 = 2 * bwc * cos(x->params.fpc);
-    x->coefs_cache.ec2 = - (bwc * bwc);
-    x->coefs_cache.tc = 2 * cos(x->params.tpc);
-    x->coefs_cache.ac = 2 * cos(x->params.apc);
-    entry->coefs = x->coefs_cache;
-    x->inputs.changed = 0;
+    bwc = exp(- f->bwpi * sp);
+    f->coefs_cache.ec1 = 2 * bwc * cos(f->fpc);
+    f->coefs_cache.ec2 = - (bwc * bwc);
+    f->coefs_cache.tc = 2 * cos(f->tpc);
+    f->coefs_cache.ac = 2 * cos(f->apc);
+    f->inputs.changed = 0;
 }
 
 /* fof_onset calculates the initial values for the three fof states
    based on the parameters and coefficients calculated by fof_update */
    
-static void fof_onset(t_fof_entry *e, t_fof *x, long start, t_fof_real d1)
+static void fof_onset(t_fof_entry *e, t_fof_formant *f, t_fof_params *p, long start, t_fof_real d1)
 {
-    t_fof_real pi = x->params.pi, sr = x->params.sr, sp = x->params.sp;
-    t_fof_real dexp = d1 * x->params.cf2pi + x->inputs.phase;
-    t_fof_real aexp = exp(-x->params.bwpi*d1) * x->inputs.amp * x->params.bpc;
-    t_fof_real dmd = x->inputs.debatt - d1;
+    t_fof_real pi = p->pi, sr = p->sr, sp = p->sp;
+    t_fof_real dexp = d1 * f->cf2pi + f->inputs.phase;
+    t_fof_real aexp = exp(-f->bwpi*d1) * f->inputs.amp * f->bpc;
+    t_fof_real dmd = f->inputs.debatt - d1;
     
-    if (x->inputs.tex >= sp) {
-	t_fof_real dtex = x->params.piotex * d1;
-	e->tex.count = (x->inputs.tex - d1) * sr + 1;
-	e->tex.y1 = cos(pi - x->params.tpc + dtex) * 0.5;
-	e->tex.y2 = cos(pi - x->params.tpc * 2 + dtex) * 0.5;
+    if (f->inputs.tex >= sp) {
+	t_fof_real dtex = f->piotex * d1;
+	e->tex.count = (f->inputs.tex - d1) * sr + 1;
+	e->tex.y1 = cos(pi - f->tpc + dtex) * 0.5;
+	e->tex.y2 = cos(pi - f->tpc * 2 + dtex) * 0.5;
     } else
 	e->tex.count = 0;
 	
     e->start = start;
     e->exp.count = dmd * sr + 1;
-    e->exp.y1 = sin(- x->params.fpc + dexp) * aexp;
-    e->exp.y2 = sin(- x->params.fpc * 2 + dexp) * x->params.bpc * aexp;
+    e->exp.y1 = sin(- f->fpc + dexp) * aexp;
+    e->exp.y2 = sin(- f->fpc * 2 + dexp) * f->bpc * aexp;
     
-    if (x->inputs.atten >= sp) {
+    if (f->inputs.atten >= sp) {
 	t_fof_real d2 = e->exp.count * sp - dmd;
-	t_fof_real datt = x->params.pioatten * d2;
-	e->atten.count = (x->inputs.atten - d2) * sr + 1;
-	e->atten.y1 = cos(- x->params.apc + datt) * 0.5;
-	e->atten.y2 = cos(- x->params.apc * 2 + datt) * 0.5;
+	t_fof_real datt = f->pioatten * d2;
+	e->atten.count = (f->inputs.atten - d2) * sr + 1;
+	e->atten.y1 = cos(- f->apc + datt) * 0.5;
+	e->atten.y2 = cos(- f->apc * 2 + datt) * 0.5;
     } else
 	e->atten.count = 0;
 
@@ -116,24 +138,82 @@ static void fof_onset(t_fof_entry *e, t_fof *x, long start, t_fof_real d1)
 	e->exp.count = 0;
 }
 
-/* fof_trigger allocates a new fof, calls fof_update if necessary
-   and starts the fof at a certain start time and start phase */
+/* fof_next_part moves the fof in lane i on to its next part that has
+   anything to do, loading that part's envelope into the lane */
+
+static void fof_next_part(t_fof_bank *b, long i)
+{
+    t_fof_entry *e = &(b->fofs[i]);
+    
+    if (e->part == FOF_START) {	/* the exp recursion starts now */
+	b->y1[i] = e->exp.y1;
+	b->y2[i] = e->exp.y2;
+    }
+    do {
+	e->part++;
+	switch (e->part) {
+	    case FOF_TEX: e->count = e->tex.count; break;
+	    case FOF_EXP: e->count = e->exp.count; break;
+	    case FOF_ATTEN: e->count = e->atten.count; break;
+	    default: e->count = 0; break;
+	}
+    } while (e->part < FOF_DONE && e->count <= 0);
+    
+    switch (e->part) {
+	case FOF_TEX:
+	    b->c[i] = e->coefs.tc;
+	    b->e1[i] = e->tex.y1;
+	    b->e2[i] = e->tex.y2;
+	    break;
+	case FOF_EXP:
+	    b->c[i] = 2;
+	    b->e1[i] = b->e2[i] = 0.5;
+	    break;
+	case FOF_ATTEN:
+	    b->c[i] = e->coefs.ac;
+	    b->e1[i] = e->atten.y1;
+	    b->e2[i] = e->atten.y2;
+	    break;
+	default:
+	    fof_clear_lane(b, i);
+	    break;
+    }
+}
+
+/* fof_trigger starts a new fof for each formant, calling fof_update if
+   necessary, at a certain start time and start phase */
  
 static void fof_trigger(t_fof *x, long start, t_fof_real delta)
 {
-    t_fof_entry *new = x->list.free.next;
-
-    if (new == LIST_END) {
-	// fof_error(); //in msp we dont want to waste time printing -rd
-	return;
+    t_fof_bank *b = x->bank;
+    int k;
+    
+    for (k = 0; k < x->nformants; k++) {
+	t_fof_formant *f = &(x->formants[k]);
+	long i = b->nfofs;
+	t_fof_entry *e;
+	
+	if (i >= b->maxfofs) {
+	    // fof_error(); //in msp we dont want to waste time printing -rd
+	    return;
+	}
+	b->nfofs++;
+	e = &(b->fofs[i]);
+	if (f->inputs.changed)
+	    fof_update(f, &(x->params));
+	e->coefs = f->coefs_cache;
+	fof_onset(e, f, &(x->params), start, delta);
+	
+	b->ec1[i] = e->coefs.ec1;
+	b->ec2[i] = e->coefs.ec2;
+	b->y1[i] = b->y2[i] = 0;
+	b->c[i] = 2;
+	b->e1[i] = b->e2[i] = -0.5;
+	e->part = FOF_START;
+	e->count = start;
+	if (e->count <= 0)
+	    fof_next_part(b, i);
     }
-    x->list.free.next = new->next;
-    new->next = x->list.used.next;
-    x->list.used.next = new;
-    if (x->inputs.changed)
-	fof_update(new, x);
-    new->coefs = x->coefs_cache;
-    fof_onset(new, x, start, delta);
 }
 
 /* fof_run_phasor accumulates the current phase by the incoming
@@ -176,94 +256,148 @@ static void fof_run_phasor_nosig(t_sigfofs *x, t_sample in, t_sample *out, long
     xx->f0_phase = p;
 }
 
-/* fof_run_one runs one fof and returns 0 if the fof can be freed and 1
-   if it is still needed, this is the heart of the implementation,
-   it contains the calculation of the three fof parts
-   (exp + tex, exp, exp + atten). */
-   
-static int fof_run_one(t_fof_entry *x, t_sample *out, long n)
+/* fof_run_lanes runs the FOF_LANES fofs starting at lane g for n samples
+   without any of them changing part, this is the heart of the implementation:
+   y = ec1 * y1 + ec2 * y2 is the exp. decaying sine, e = c * e1 - e2 the
+   envelope, and the output is y * (e + 0.5) summed over the lanes.
+   [per fof: 4x *, 3x +, 1x -] */
+
+static void fof_run_lanes(t_fof_bank *b, long g, t_sample *out, long n)
 {
-    t_fof_real y, a = x->coefs.ec1, b = x->coefs.ec2;
-    t_fof_real y1 = x->exp.y1, y2 = x->exp.y2;
+#if defined(FOF_SSE2)
+    /* FOF_LANES == 4: two doubles per register */
+    __m128d a0 = _mm_loadu_pd(b->ec1 + g), a1 = _mm_loadu_pd(b->ec1 + g + 2);
+    __m128d b0 = _mm_loadu_pd(b->ec2 + g), b1 = _mm_loadu_pd(b->ec2 + g + 2);
+    __m128d c0 = _mm_loadu_pd(b->c + g), c1 = _mm_loadu_pd(b->c + g + 2);
+    __m128d y10 = _mm_loadu_pd(b->y1 + g), y11 = _mm_loadu_pd(b->y1 + g + 2);
+    __m128d y20 = _mm_loadu_pd(b->y2 + g), y21 = _mm_loadu_pd(b->y2 + g + 2);
+    __m128d e10 = _mm_loadu_pd(b->e1 + g), e11 = _mm_loadu_pd(b->e1 + g + 2);
+    __m128d e20 = _mm_loadu_pd(b->e2 + g), e21 = _mm_loadu_pd(b->e2 + g + 2);
+    __m128d half = _mm_set1_pd(0.5);
     
-    if (x->start > 0) {
-	int m = MIN(n, x->start);
-	n -= m;
-	out += m;
-	x->start -= m;
+    while (n--) {
+	__m128d y0 = _mm_add_pd(_mm_mul_pd(a0, y10), _mm_mul_pd(b0, y20));
+	__m128d y1 = _mm_add_pd(_mm_mul_pd(a1, y11), _mm_mul_pd(b1, y21));
+	__m128d e0 = _mm_sub_pd(_mm_mul_pd(c0, e10), e20);
+	__m128d e1 = _mm_sub_pd(_mm_mul_pd(c1, e11), e21);
+	__m128d s = _mm_add_pd(_mm_mul_pd(y0, _mm_add_pd(e0, half)), _mm_mul_pd(y1, _mm_add_pd(e1, half)));
+	y20 = y10; y10 = y0;
+	y21 = y11; y11 = y1;
+	e20 = e10; e10 = e0;
+	e21 = e11; e11 = e1;
+	s = _mm_add_sd(s, _mm_unpackhi_pd(s, s));
+	*out++ += _mm_cvtsd_f64(s);
     }
-    if (x->tex.count > 0) {
-	t_fof_real ty, ta = x->coefs.tc, ty1 = x->tex.y1, ty2 = x->tex.y2;
-	int m = MIN(n, x->tex.count);
-	n -= m;
-	x->tex.count -= m;
-	while (m--) { /* [4x *, 3x +, 1x -] */
-	    y = a * y1 + b * y2;
-	    y2 = y1;
-	    y1 = y;
-	    ty = ta * ty1 - ty2;
-	    *out++ += y * (ty + 0.5);
-	    ty2 = ty1;
-	    ty1 = ty;
+    _mm_storeu_pd(b->y1 + g, y10); _mm_storeu_pd(b->y1 + g + 2, y11);
+    _mm_storeu_pd(b->y2 + g, y20); _mm_storeu_pd(b->y2 + g + 2, y21);
+    _mm_storeu_pd(b->e1 + g, e10); _mm_storeu_pd(b->e1 + g + 2, e11);
+    _mm_storeu_pd(b->e2 + g, e20); _mm_storeu_pd(b->e2 + g + 2, e21);
+#elif defined(FOF_NEON)
+    float64x2_t a0 = vld1q_f64(b->ec1 + g), a1 = vld1q_f64(b->ec1 + g + 2);
+    float64x2_t b0 = vld1q_f64(b->ec2 + g), b1 = vld1q_f64(b->ec2 + g + 2);
+    float64x2_t c0 = vld1q_f64(b->c + g), c1 = vld1q_f64(b->c + g + 2);
+    float64x2_t y10 = vld1q_f64(b->y1 + g), y11 = vld1q_f64(b->y1 + g + 2);
+    float64x2_t y20 = vld1q_f64(b->y2 + g), y21 = vld1q_f64(b->y2 + g + 2);
+    float64x2_t e10 = vld1q_f64(b->e1 + g), e11 = vld1q_f64(b->e1 + g + 2);
+    float64x2_t e20 = vld1q_f64(b->e2 + g), e21 = vld1q_f64(b->e2 + g + 2);
+    float64x2_t half = vdupq_n_f64(0.5);
+    
+    while (n--) {
+	float64x2_t y0 = vaddq_f64(vmulq_f64(a0, y10), vmulq_f64(b0, y20));
+	float64x2_t y1 = vaddq_f64(vmulq_f64(a1, y11), vmulq_f64(b1, y21));
+	float64x2_t e0 = vsubq_f64(vmulq_f64(c0, e10), e20);
+	float64x2_t e1 = vsubq_f64(vmulq_f64(c1, e11), e21);
+	float64x2_t s = vaddq_f64(vmulq_f64(y0, vaddq_f64(e0, half)), vmulq_f64(y1, vaddq_f64(e1, half)));
+	y20 = y10; y10 = y0;
+	y21 = y11; y11 = y1;
+	e20 = e10; e10 = e0;
+	e21 = e11; e11 = e1;
+	*out++ += vaddvq_f64(s);
+    }
+    vst1q_f64(b->y1 + g, y10); vst1q_f64(b->y1 + g + 2, y11);
+    vst1q_f64(b->y2 + g, y20); vst1q_f64(b->y2 + g + 2, y21);
+    vst1q_f64(b->e1 + g, e10); vst1q_f64(b->e1 + g + 2, e11);
+    vst1q_f64(b->e2 + g, e20); vst1q_f64(b->e2 + g + 2, e21);
+#else
+    t_fof_real *a = b->ec1 + g, *bb = b->ec2 + g, *c = b->c + g;
+    t_fof_real y1[FOF_LANES], y2[FOF_LANES], e1[FOF_LANES], e2[FOF_LANES];
+    int k;
+    
+    for (k = 0; k < FOF_LANES; k++) {
+	y1[k] = b->y1[g + k]; y2[k] = b->y2[g + k];
+	e1[k] = b->e1[g + k]; e2[k] = b->e2[g + k];
+    }
+    while (n--) {
+	t_fof_real s = 0;
+	for (k = 0; k < FOF_LANES; k++) {
+	    t_fof_real y = a[k] * y1[k] + bb[k] * y2[k];
+	    t_fof_real e = c[k] * e1[k] - e2[k];
+	    y2[k] = y1[k]; y1[k] = y;
+	    e2[k] = e1[k]; e1[k] = e;
+	    s += y * (e + 0.5);
 	}
-	x->tex.y1 = ty1;
-	x->tex.y2 = ty2;
+	*out++ += s;
     }
-    if (x->exp.count > 0) {
-		int m = MIN(n, x->exp.count);
-		n -= m;
-		x->exp.count -= m;
+    for (k = 0; k < FOF_LANES; k++) {
+	b->y1[g + k] = y1[k]; b->y2[g + k] = y2[k];
+	b->e1[g + k] = e1[k]; b->e2[g + k] = e2[k];
+    }
+#endif
+}
 
-		while (m--) { /* [2x *, 2x +] */
-		    y = a * y1 + b * y2;
-		    *out++ += y;
-		    y2 = y1;
-		    y1 = y;
-		}
-	}
-    if (x->atten.count > 0) {
-	t_fof_real ay, aa = x->coefs.ac, ay1 = x->atten.y1, ay2 = x->atten.y2;
-	int m = MIN(n, x->atten.count);
+/* fof_run_group runs the fofs in lanes g .. g + FOF_LANES - 1 for a block,
+   in stretches that end whenever one of them reaches the end of a part */
+
+static void fof_run_group(t_fof_bank *b, long g, t_sample *out, long n)
+{
+    t_fof_entry *e = &(b->fofs[g]);
+    long m;
+    int k, running;
+    
+    while (n > 0) {
+	m = n;
+	running = 0;
+	for (k = 0; k < FOF_LANES; k++)
+	    if (e[k].part != FOF_DONE) {
+		running = 1;
+		m = MIN(m, e[k].count);
+	    }
+	if (!running)
+	    return;
+	fof_run_lanes(b, g, out, m);
+	out += m;
 	n -= m;
-	x->atten.count -= m;
-	while (m--) { /* [4x *, 3x +, 1x -] */
-	    y = a * y1 + b * y2;
-	    y2 = y1;
-	    y1 = y;
-	    ay = aa * ay1 - ay2;
-	    ay2 = ay1;
-	    ay1 = ay;
-	    *out++ += y * (ay + 0.5);
-	}
-	x->atten.y1 = ay1;
-	x->atten.y2 = ay2;
+	for (k = 0; k < FOF_LANES; k++)
+	    if (e[k].part != FOF_DONE && (e[k].count -= m) == 0)
+		fof_next_part(b, g + k);
     }
-    x->exp.y1 = y1;
-    x->exp.y2 = y2;
-    if (x->atten.count > 0 || x->exp.count > 0 || x->tex.count > 0)
-	return 1;
-    else
-	return 0;
 }
 
-//fof_run_all runs all fofs and removes the finished fofs
-// from the used list and puts them into the free list
+//fof_run_all runs all fofs and moves the last running fof into the
+// place of each one that finished, to keep the bank packed
 static void fof_run_all(t_sigfofs *x, t_sample *out, long n)
 {
-	t_fof *xx = x->ctlp;
-    t_fof_entry *prev = (t_fof_entry*)&(xx->list.used);
-    t_fof_entry *curr = prev->next;
+    t_fof_bank *b = x->ctlp->bank;
+    long g, i, j;
 
-    while (curr != LIST_END) {
-	if (fof_run_one(curr, out, n) == 0) {
-	    prev->next = curr->next;
-	    curr->next = xx->list.free.next;
-	    xx->list.free.next = curr;
-	    curr = prev->next;
-	} else {
-	    prev = curr;
-	    curr = curr->next;
+    for (g = 0; g < b->nfofs; g += FOF_LANES)
+	fof_run_group(b, g, out, n);
+	
+    for (i = 0; i < b->nfofs; ) {
+	if (b->fofs[i].part != FOF_DONE) {
+	    i++;
+	    continue;
 	}
+	j = --b->nfofs;
+	b->y1[i] = b->y1[j];
+	b->y2[i] = b->y2[j];
+	b->ec1[i] = b->ec1[j];
+	b->ec2[i] = b->ec2[j];
+	b->e1[i] = b->e1[j];
+	b->e2[i] = b->e2[j];
+	b->c[i] = b->c[j];
+	b->fofs[i] = b->fofs[j];
+	fof_clear_lane(b, j);
     }
 }
 
@@ -293,7 +427,7 @@ static t_int *fof_perform_nosig(t_int *w)
 	t_float *out = (t_float *)(w[2]);
 	int n = (int)(w[3]);
 	
-	t_float in = x->ctlp->inputs.f0;
+	t_float in = x->ctlp->f0;
     
 	if (x->x_obj.z_disabled)
 		goto out;
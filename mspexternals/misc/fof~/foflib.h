@@ -11,6 +11,9 @@
  //   this definition is found in foflib.h
  // commented out fof_error() in foflib.c - 
  //   we don't want to do unnecessary printing at audio interrupt!
+ //
+ // 2026: formants (several fofs started per f0 period) and the fof
+ //   list replaced by a packed bank that runs FOF_LANES fofs at a time
  
 #ifndef MIN
 #define MIN(x, y) ((x) < (y) ? (x) : (y))
@@ -25,14 +28,22 @@
 #endif
 
 #define DEFAULT_SRATE 44100	/* default sampling rate for initialization */
-#define LIST_END ((void*)0)	/* end of list */
 //#define MAX_FOFS 40		/* max # of fofs on the SIM at 32 kHz */
-#define MAX_FOFS 256
+//#define MAX_FOFS 256
+#define MAX_FOFS 1024		/* for all formants together */
+#define MAX_FORMANTS 16
+#define FOF_LANES 4		/* fofs advanced together by fof_run_group() */
+
+#define DEF_CF 609.		/* default inputs: the first formant of an "a" */
+#define DEF_BW 80.
+#define DEF_AMP 1.
+#define DEF_TEX 0.003
+#define DEF_DEBATT 0.02
+#define DEF_ATTEN 0.007
 
 typedef double t_fof_real;	/* fof calculation has to be in double */
 
-typedef struct _fof_inputs {	/* fof inputs */
-    t_fof_real f0;		/* center frequency in Hz */
+typedef struct _fof_inputs {	/* fof inputs (one set per formant) */
     t_fof_real cf;		/* center frequency in Hz */
     t_fof_real bw;		/* band width in Hz */
     t_fof_real amp;		/* linear amplitude */
@@ -55,15 +66,7 @@ typedef struct _ctl
 	float x_ffcoef2;			
 } t_ctl;
 
-typedef struct _fof_params {	/* fof parameters and pre-calculated values */
-    t_fof_real cf2pi;		/* center frequency times two pi */
-    t_fof_real bwpi;		/* band width times pi */
-    t_fof_real piotex;		/* pi over tex */
-    t_fof_real pioatten;	/* pi over atten */
-    t_fof_real fpc;		/* center frequency pre-coefficient */
-    t_fof_real bpc;		/* bandwidth pre-coefficient */
-    t_fof_real tpc;		/* tex pre-coefficient */
-    t_fof_real apc;		/* atten pre-coefficient */
+typedef struct _fof_params {	/* parameters shared by all formants */
     t_fof_real sr;		/* sampling rate in Hz */
     t_fof_real sro2;		/* nyquist frequency in Hz */
     t_fof_real sp;		/* sampling period in s */
@@ -79,38 +82,64 @@ typedef struct _fof_coefs {	/* coefficients for all fof parts */
     t_fof_real ac;		/* atten coefficient */
 } t_fof_coefs;
 
+typedef struct _fof_formant {	/* one formant: inputs and pre-calculated values */
+    t_fof_inputs inputs;	/* fof inputs */
+    t_fof_real cf2pi;		/* center frequency times two pi */
+    t_fof_real bwpi;		/* band width times pi */
+    t_fof_real piotex;		/* pi over tex */
+    t_fof_real pioatten;	/* pi over atten */
+    t_fof_real fpc;		/* center frequency pre-coefficient */
+    t_fof_real bpc;		/* bandwidth pre-coefficient */
+    t_fof_real tpc;		/* tex pre-coefficient */
+    t_fof_real apc;		/* atten pre-coefficient */
+    t_fof_coefs coefs_cache;	/* coefficient cache */
+} t_fof_formant;
+
 typedef struct _fof_state {	/* the state of a fof part */
     long count;			/* samples to go */
     t_fof_real y1;		/* sample t - 1 */
     t_fof_real y2;		/* sample t - 2 */
 } t_fof_state;
 
-typedef struct _fof_entry {	/* entry in fof list */
-    struct _fof_entry *next;	/* list link (has to be the first component) */
+/* the parts of a fof, in the order they run; a part with a count of 0 is skipped */
+enum { FOF_START, FOF_TEX, FOF_EXP, FOF_ATTEN, FOF_DONE };
+
+typedef struct _fof_entry {	/* a running fof */
     t_fof_coefs coefs;		/* fof coefficients */
     t_fof_state exp;		/* fof exp state (exp. decaying sine) */
     t_fof_state tex;		/* fof tex state (attack part) */
     t_fof_state atten;		/* fof atten state (attenuation part) */
     long start;			/* start sample in current block */
+    long part;			/* part that's running (FOF_START .. FOF_DONE) */
+    long count;			/* samples to go in that part */
 } t_fof_entry;
 
-typedef struct _fof_loco {	/* locomotive for fof list */
-    struct _fof_entry *next;	/* list link (has to be the first component) */
-} t_fof_loco;
-
-typedef struct _fof_list {	/* fof list */
-    t_fof_loco free;		/* locomotive for free list */
-    t_fof_loco used;		/* locomotive for used list */
-    long maxfofs;		/* maximum number of entries (<= MAX_FOFS) */
-    t_fof_entry fofs[MAX_FOFS];	/* entry space */
-} t_fof_list;
+/* The running fofs, packed into [0, nfofs).  The recursions live in separate
+   arrays so that FOF_LANES neighbouring fofs can be advanced by the same
+   (SIMD) instructions.  Every part is computed the same way, as the exp
+   recursion y times an envelope recursion plus 0.5: for tex and atten that's
+   the raised cosine, for the exp part a constant 1 (c = 2, e1 = e2 = 0.5), and
+   for a fof that hasn't started or has finished it's 0 with y = 0. */
+typedef struct _fof_bank {
+    long nfofs;			/* number of running fofs */
+    long maxfofs;		/* maximum number of running fofs (<= MAX_FOFS) */
+    t_fof_real y1[MAX_FOFS];	/* exp recursion */
+    t_fof_real y2[MAX_FOFS];
+    t_fof_real ec1[MAX_FOFS];
+    t_fof_real ec2[MAX_FOFS];
+    t_fof_real e1[MAX_FOFS];	/* envelope recursion */
+    t_fof_real e2[MAX_FOFS];
+    t_fof_real c[MAX_FOFS];
+    t_fof_entry fofs[MAX_FOFS];
+} t_fof_bank;
 
 typedef struct _fof {		/* fof control structure */
-    t_fof_inputs inputs;	/* fof inputs */
     t_fof_params params;	/* fof parameters */
-    t_fof_coefs coefs_cache;	/* coefficient cache */
+    t_fof_real f0;		/* fundamental frequency in Hz */
     t_fof_real f0_phase;	/* current f0 phase (0 .. params.sr) */
-    t_fof_list list;		/* fof list */
+    long nformants;		/* formants started by each f0 period */
+    t_fof_formant formants[MAX_FORMANTS];
+    t_fof_bank *bank;		/* running fofs (allocated by the object) */
 } t_fof;
 
 
@@ -124,13 +153,14 @@ typedef struct _sigfofs {
 
 
 static void fof_init(t_fof *x);
-static void fof_init_list(t_fof_list *x);
-static void fof_update(t_fof_entry *entry, t_fof *x);
-static void fof_onset(t_fof_entry *e, t_fof *x, long start, t_fof_real d1);
+static void fof_init_bank(t_fof_bank *x, long maxfofs);
+static void fof_update(t_fof_formant *f, t_fof_params *p);
+static void fof_onset(t_fof_entry *e, t_fof_formant *f, t_fof_params *p, long start, t_fof_real d1);
+static void fof_next_part(t_fof_bank *b, long i);
 static void fof_trigger(t_fof *x, long start, t_fof_real delta);
 static void fof_run_phasor(t_sigfofs *x, t_sample *in, t_sample *out, long n);
 static void fof_run_phasor_nosig(t_sigfofs *x, t_sample in, t_sample *out, long n);
-static int fof_run_one(t_fof_entry *x, t_sample *out, long n);
+static void fof_run_group(t_fof_bank *b, long g, t_sample *out, long n);
 static void fof_run_all(t_sigfofs *x, t_sample *out, long n);
 static t_int *fof_perform(t_int *w);
 static t_int *fof_perform_nosig(t_int *w);
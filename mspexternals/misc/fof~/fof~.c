@@ -24,9 +24,16 @@ MW made floating point args be declared as double.
  //   we don't want to do unnecessary printing at audio interrupt!
  //   also commented out error() in fof_error just in case!!!
  // removed old int and float messages (old shortcuts for maxfofs and start)
+ //
+ // 2026
+ // formants: "formants <n>" makes every f0 period start n fofs, one per formant,
+ //   "formant <i> <cf> <amp> <bw> [<tex> <debatt> <atten> [<fof-phase>]]" sets
+ //   formant i; formant 0 is the one the inlets control
+ // the running fofs are kept packed and run several at a time (see foflib.c)
+ // maxfofs now counts the fofs of all formants, up to 1024
  
 
-#define VERSION "fof~: version 0.2 for MSP (eckel/iovino/dudas)"
+#define VERSION "fof~: version 0.3 for MSP (eckel/iovino/dudas)"
 #define RES_ID 19991
 
 #include "ext.h"
@@ -50,6 +57,9 @@ void sigfofs_phase(t_sigfofs *x, double v);
 void sigfofs_bang(t_sigfofs *x);
 void sigfofs_maxfofs(t_sigfofs *x, long v);
 void sigfofs_f0_phase(t_sigfofs *x, double v);
+void sigfofs_formants(t_sigfofs *x, long n);
+void sigfofs_formant(t_sigfofs *x, Symbol *s, short ac, Atom *av);
+void sigfofs_param(t_sigfofs *x, long formant, long which, t_sample v);
 
 void sigfofs_float(t_sigfofs *x, t_sample v);
 void sigfofs_int(t_sigfofs *x, long v);
@@ -70,12 +80,15 @@ float sigfofs_get_value(Atom *a);
 void sigfofs_assist(t_sigfofs *x, void *b, long m, long a, char *s);
 void sigfofs_init_args(t_sigfofs *x, int ac, Atom *av);
 void *sigfofs_new(Symbol *s, int ac, Atom *av);
+void sigfofs_free(t_sigfofs *x);
+
+enum { IN_CF = 1, IN_AMP, IN_BW, IN_TEX, IN_DEBATT, IN_ATTEN, IN_PHASE };	// inlet order
 
 void *sigfofs_class;
 
 void main(void)
 {
-    setup(&sigfofs_class, sigfofs_new, (method)dsp_free, (short)sizeof(t_sigfofs), 0, A_GIMME, 0);
+    setup(&sigfofs_class, sigfofs_new, (method)sigfofs_free, (short)sizeof(t_sigfofs), 0, A_GIMME, 0);
     addmess((method)sigfofs_dsp, "dsp", A_CANT, 0);
     addbang((method)sigfofs_bang);
     addfloat((method)sigfofs_float);
@@ -85,6 +98,8 @@ void main(void)
     addmess((method)sigfofs_start, "start", A_FLOAT, 0);
     addmess((method)sigfofs_phase, "fof-phase", A_FLOAT, 0);
     addmess((method)sigfofs_f0_phase, "f0-phase", A_FLOAT, 0);
+    addmess((method)sigfofs_formants, "formants", A_LONG, 0);
+    addmess((method)sigfofs_formant, "formant", A_GIMME, 0);
 
 	addmess((method)sigfofs_assist,"assist",A_CANT,0);
 	dsp_initclass();
@@ -126,12 +141,7 @@ void sigfofs_start(t_sigfofs *x, double d)
 
 void sigfofs_phase(t_sigfofs *x, double d)
 {
-  v = (t_sample) d;
-    v = v - (int)v;
-    if (v < 0)
-        v += 1;
-    x->ctlp->inputs.phase = v * x->ctlp->params.twopi;
-    x->ctlp->inputs.changed = 1;
+    sigfofs_param(x, 0, IN_PHASE, (t_sample) d);
 }
 
 //sigfofs_bang triggers a fof at next block begin
@@ -149,8 +159,7 @@ void sigfofs_maxfofs(t_sigfofs *x, long v)
     }
     if (v < 1)
 	v = 1;
-    x->ctlp->list.maxfofs = v;
-    fof_init_list(&(x->ctlp->list));
+    fof_init_bank(x->ctlp->bank, v);
 }
 
 //sigfofs_f0_phase sets the initial phase of the fof (0 <= v < 1)
@@ -194,58 +203,114 @@ void sigfofs_f0(t_sigfofs *x, t_sample v)
     	v = 0;
     if (v > x->ctlp->params.sro2)
     	v = x->ctlp->params.sro2;
-    x->ctlp->inputs.f0 = v;
-    x->ctlp->inputs.changed = 1;
+    x->ctlp->f0 = v;
+}
+
+// sigfofs_param sets one parameter of one formant, which can be any of the
+// MAX_FORMANTS whether or not it is sounding
+void sigfofs_param(t_sigfofs *x, long formant, long which, t_sample v)
+{
+    t_fof_inputs *in = &(x->ctlp->formants[formant].inputs);
+    
+    switch (which) {
+	case IN_CF:
+	case IN_BW:
+	    if (v < 0)
+		v = 0;
+	    if (v > x->ctlp->params.sro2)
+		v = x->ctlp->params.sro2;
+	    if (which == IN_CF)
+		in->cf = v;
+	    else
+		in->bw = v;
+	    break;
+	case IN_AMP:
+	    in->amp = v;
+	    break;
+	case IN_TEX:
+	case IN_DEBATT:
+	case IN_ATTEN:
+	    if (v < 0)
+		v = 0;
+	    if (which == IN_TEX)
+		in->tex = v * 0.001;
+	    else if (which == IN_DEBATT)
+		in->debatt = v * 0.001;
+	    else
+		in->atten = v * 0.001;
+	    break;
+	case IN_PHASE:
+	    v = v - (int)v;
+	    if (v < 0)
+		v += 1;
+	    in->phase = v * x->ctlp->params.twopi;
+	    break;
+    }
+    in->changed = 1;
 }
 
 void sigfofs_cf(t_sigfofs *x, t_sample v)
 {    
-    if (v < 0)
-    	v = 0;
-    if (v > x->ctlp->params.sro2)
-    	v = x->ctlp->params.sro2;
-    x->ctlp->inputs.cf = v;
-    x->ctlp->inputs.changed = 1;
+    sigfofs_param(x, 0, IN_CF, v);
 }
 
 void sigfofs_bw(t_sigfofs *x, t_sample v)
 {
-    if (v < 0)
-    	v = 0;
-    if (v > x->ctlp->params.sro2)
-    	v = x->ctlp->params.sro2;
-    x->ctlp->inputs.bw = v;
-    x->ctlp->inputs.changed = 1;
+    sigfofs_param(x, 0, IN_BW, v);
 }
 
 void sigfofs_amp(t_sigfofs *x, t_sample v)
 {
-    x->ctlp->inputs.amp = v;
-    x->ctlp->inputs.changed = 1;
+    sigfofs_param(x, 0, IN_AMP, v);
 }
 
 void sigfofs_tex(t_sigfofs *x, t_sample v)
 {
-    if (v < 0)
-    	v = 0;
-    x->ctlp->inputs.tex = v * 0.001;
-    x->ctlp->inputs.changed = 1;
+    sigfofs_param(x, 0, IN_TEX, v);
 }
 
 void sigfofs_debatt(t_sigfofs *x, t_sample v)
 {
-    if (v < 0)
-    	v = 0;
-    x->ctlp->inputs.debatt = v * 0.001;
-    x->ctlp->inputs.changed = 1;
+    sigfofs_param(x, 0, IN_DEBATT, v);
 }
 
 void sigfofs_atten(t_sigfofs *x, t_sample v)
 {
-    if (v < 0)
-    	v = 0;
-    x->ctlp->inputs.atten = v * 0.001;
-    x->ctlp->inputs.changed = 1;
+    sigfofs_param(x, 0, IN_ATTEN, v);
+}
+
+//sigfofs_formants sets how many formants each f0 period starts
+void sigfofs_formants(t_sigfofs *x, long n)
+{
+    if (n > MAX_FORMANTS) {
+	post("fof~: warning! formants out of range (%ld), set to %d", n, MAX_FORMANTS);
+	n = MAX_FORMANTS;
+    }
+    if (n < 1)
+	n = 1;
+    x->ctlp->nformants = n;
+}
+
+//sigfofs_formant sets the parameters of one formant, in inlet order:
+// formant <i> <cf> <amp> <bw> [<tex> <debatt> <atten> [<fof-phase>]]
+// setting a formant past the last one sounding adds formants up to it
+void sigfofs_formant(t_sigfofs *x, Symbol *s, short ac, Atom *av)
+{
+    long i, f;
+    
+    if (ac < 2) {
+	post("fof~: formant needs an index and at least a center frequency");
+	return;
+    }
+    f = sigfofs_get_value(av);
+    if (f < 0 || f >= MAX_FORMANTS) {
+	post("fof~: formant %ld out of range (0 - %d)", f, MAX_FORMANTS - 1);
+	return;
+    }
+    for (i = 1; i < ac && i <= IN_PHASE; i++)
+	sigfofs_param(x, f, i, sigfofs_get_value(av + i));
+    if (f >= x->ctlp->nformants)
+	sigfofs_formants(x, f + 1);
 }
 
 void sigfofs_input(t_int *w, long m)
@@ -259,6 +324,7 @@ void sigfofs_input(t_int *w, long m)
 	t_sample *debatt = (t_float *)(w[7]);
 	t_sample *atten = (t_float *)(w[8]);
     
+    t_fof_inputs *inputs = &(x->ctlp->formants[0].inputs);
     t_sample v;
 	
     if (x->b_connected[0] && cf[m] != x->cf) {
@@ -267,12 +333,12 @@ void sigfofs_input(t_int *w, long m)
 	    v = -v;
 	if (v > x->ctlp->params.sro2)
 	    v = x->ctlp->params.sro2;
-	x->cf = x->ctlp->inputs.cf = v;
-	x->ctlp->inputs.changed = 1;
+	x->cf = inputs->cf = v;
+	inputs->changed = 1;
     }
     if (x->b_connected[1] && amp[m] != x->amp) {
-	x->amp = x->ctlp->inputs.amp = amp[m];
-	x->ctlp->inputs.changed = 1;
+	x->amp = inputs->amp = amp[m];
+	inputs->changed = 1;
     }
     if (x->b_connected[2] && bw[m] != x->bw) {
 	v = bw[m];
@@ -280,32 +346,32 @@ void sigfofs_input(t_int *w, long m)
 	    v = -v;
 	if (v > x->ctlp->params.sro2)
 	    v = x->ctlp->params.sro2;
-	x->bw = x->ctlp->inputs.bw = v;
-	x->ctlp->inputs.changed = 1;
+	x->bw = inputs->bw = v;
+	inputs->changed = 1;
     }
     if (x->b_connected[3] && tex[m] != x->tex) {
 	v = tex[m];
 	if (v < 0)
 	    v = 0;
 	x->tex = v;
-	x->ctlp->inputs.tex = v * 0.001;
-	x->ctlp->inputs.changed = 1;
+	inputs->tex = v * 0.001;
+	inputs->changed = 1;
     }
     if (x->b_connected[4] && debatt[m] != x->debatt) {
 	v = debatt[m];
 	if (v < 0)
 	    v = 0;
 	x->debatt = v;
-	x->ctlp->inputs.debatt = v * 0.001;
-	x->ctlp->inputs.changed = 1;
+	inputs->debatt = v * 0.001;
+	inputs->changed = 1;
     }
     if (x->b_connected[5] && atten[m] != x->atten) {
 	v = atten[m];
 	if (v < 0)
 	    v = 0;
 	x->atten = v;
-	x->ctlp->inputs.atten = v * 0.001;
-	x->ctlp->inputs.changed = 1;
+	inputs->atten = v * 0.001;
+	inputs->changed = 1;
     }
 }
 
@@ -352,6 +418,8 @@ void sigfofs_dsp(t_sigfofs *x, t_signal **sp, short *connect)
     x->ctlp->params.sro2 = x->ctlp->params.sr * 0.5;
     x->ctlp->params.sp = 1 / x->ctlp->params.sr;
     x->ctlp->params.piosr = x->ctlp->params.pi * x->ctlp->params.sp;
+    for (i = 0; i < MAX_FORMANTS; i++)
+	x->ctlp->formants[i].inputs.changed = 1;	// the coefficients depend on sr
 
 	for (i = 0; i < 6; i++) // 6 control inlets
 		if (x->b_connected[i] = connect[i+1])
@@ -407,15 +475,29 @@ void sigfofs_init_args(t_sigfofs *x, int ac, Atom *av)
 
 void *sigfofs_new(Symbol *s, int ac, Atom *av)
 {
-    t_sigfofs *x = (t_sigfofs *)newobject(sigfofs_class);
+    t_sigfofs *x;
+    t_fof_bank *bank = (t_fof_bank *)sysmem_newptrclear(sizeof(t_fof_bank));
+    
+    if (!bank) {
+	post("fof~: out of memory");
+	return (0);
+    }
+    x = (t_sigfofs *)newobject(sigfofs_class);
     dsp_setup((t_pxobject *)x,7);
     outlet_new((t_object *)x, "signal");
     x->ctlp = &(x->ctl);
     fof_init(x->ctlp);
+    x->ctlp->bank = bank;	// the bank is too big for an object struct
     
     sigfofs_init_args(x, ac, av);
 
     return (x);
 }
 
+void sigfofs_free(t_sigfofs *x)
+{
+    dsp_free((t_pxobject *)x);
+    sysmem_freeptr(x->ctlp->bank);
+}
+
 
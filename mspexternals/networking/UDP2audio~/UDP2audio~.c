@@ -21,46 +21,105 @@ DESCRIPTION: Receive audio in UDP packets and output it continuously as an MSP s
 
    */
 
-#define UDP2AUDIO_VERSION "0.0"
+#define UDP2AUDIO_VERSION "0.1"
 
 #include "ext.h"
 #include "z_dsp.h"
+#include <math.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 void *U2A_class;
 
-#define NUM_CHANS 2
-#define BUF_SIZE 1000000
+#define DEFAULT_NUM_CHANS 2
+#define MAX_CHANS 64
+#define BUF_SIZE 65536		// Frames per ring buffer; must be a power of two
 #define HEADSTART 64
+#define DEFAULT_MAX_LATENCY 16384
+
+/* Jitter estimation: squared inter-arrival deviation, smoothed with a fast
+   attack and a slow release so the buffer grows quickly when the network gets
+   worse and only shrinks once it has been quiet for a while. */
+#define JITTER_ATTACK (1.0/16.0)
+#define JITTER_RELEASE (1.0/1024.0)
+#define JITTER_DEVIATIONS 4.0	// Target depth covers this many standard deviations
+#define CLOCK_STALE_MS 100		// Don't measure jitter while the DSP isn't running
+
+/* Drift compensation: a PI loop on the (smoothed) buffer fill, with the error
+   measured in seconds so its response doesn't depend on the target depth or
+   the sample rate.  Corrections are clamped to a few cents of pitch. */
+#define FILL_SMOOTHING_TIME 1.0	// seconds
+#define DRIFT_KP 0.1
+#define DRIFT_KI 0.004
+#define MAX_DRIFT 0.001			// Largest clock mismatch the integrator will track
+#define MAX_RATIO_DEVIATION 0.002
 
 typedef struct ruc {
 	t_pxobject O_ob;
 	void *O_msgoutlet;
-	short previousCount;	// Negative until we see the first packet
+	long previousCount;	// Negative until we see the first packet
+	
+	long numChans;		// # signal outlets
+	long packetChans;	// # interleaved channels in each incoming packet
 	
 	long headStart;		// # samples to read before we output any.  Set to 0 once we start outputting
 	
-	long bufSize;		// Size of all ring buffers
-	float *ringbuffers[NUM_CHANS];
-	long readPtr;
-	long writePtr;
+	long bufSize;		// Size of all ring buffers; a power of two
+	float *ringmem;
+	float **ringbuffers;	// numChans rings of bufSize samples each
+	volatile long readPtr;
+	volatile long writePtr;
 	int underflowState;
+	
+	float **outSignals;	// Set by U2A_dsp()
+	long vecSize;
+	long *readIndex;	// Per output sample read offset and interpolation fraction
+	float *readFrac;
+	float sr;
+	
+	/* Jitter estimation, in samples of our own audio clock */
+	volatile double localClock;	// # samples output so far
+	volatile long lastPerformTime;
+	double lastArrival;
+	int haveArrival;
+	double jitterVar;
+	long packetFrames;
+	
+	/* Buffer depth we steer towards */
+	int adapt;
+	long minLatency;
+	long maxLatency;
+	long target;
+	
+	/* Drift compensation */
+	int resample;
+	double fillAvg;
+	double driftIntegral;
+	double ratio;		// Input samples consumed per output sample
+	double phase;		// Fractional read position, in [0, 1)
+	int fadeIn;
 } U2A;
 
-Symbol *ps_skipped, *ps_dropped, *ps_duplicate, *ps_buffer_overflow, *ps_buffer_underflow;
+Symbol *ps_skipped, *ps_dropped, *ps_duplicate, *ps_buffer_overflow, *ps_buffer_underflow, *ps_resync;
 float sampleScaleFactor;
 
 
-void *U2A_new(long arg);
+void *U2A_new(long numChans, long packetChans);
 void U2A_free(U2A *x);
 void U2A_assist(U2A *x, void *b, long m, long a, char *s);
 void U2A_version (U2A *x);
 void U2A_state (U2A *x);
 void U2A_headstart (U2A *x, long l);
+void U2A_minlatency (U2A *x, long l);
+void U2A_maxlatency (U2A *x, long l);
+void U2A_adapt (U2A *x, long l);
+void U2A_resample (U2A *x, long l);
+void U2A_UpdateTarget(U2A *x);
 void U2A_ParseFullPacket(U2A *x, long size, long bufptr);
 void U2A_dsp(U2A *x, t_signal **sp, short *count);
 t_int *U2A_perform(t_int *w);
-long isModuloishlyBetween(long x, long low, long high);
-t_int *U2A_perform(t_int *w);
 long num_can_read(U2A *x);
 long num_can_write(U2A *x);
 
@@ -71,64 +130,123 @@ void main (fptr *f) {
 	post("UDP2audio~ object version " UDP2AUDIO_VERSION " by Matt Wright");
 	post("Copyright  1999 Regents of the University of California.  ");
 		
-	setup(&U2A_class,U2A_new,(method) U2A_free,(short)sizeof(U2A),0L,0);
+	setup(&U2A_class,U2A_new,(method) U2A_free,(short)sizeof(U2A),0L,A_DEFLONG,A_DEFLONG,0);
 
     addmess((method)U2A_dsp, "dsp", A_CANT, 0);
 	addmess((method)U2A_assist, "assist",	A_CANT,0);
 	addmess((method)U2A_version, "version", 0);
 	addmess((method)U2A_state, "state", 0);
 	addmess((method)U2A_headstart, "headstart", A_LONG, 0);
+	addmess((method)U2A_minlatency, "minlatency", A_LONG, 0);
+	addmess((method)U2A_maxlatency, "maxlatency", A_LONG, 0);
+	addmess((method)U2A_adapt, "adapt", A_LONG, 0);
+	addmess((method)U2A_resample, "resample", A_LONG, 0);
 	addmess((method)U2A_ParseFullPacket, "FullPacket", A_LONG, A_LONG, 0);
 
     dsp_initclass();
-	rescopy('STR#',3009);
 
 	ps_skipped = gensym("skipped");
 	ps_dropped = gensym("dropped");
 	ps_duplicate = gensym("duplicate");
 	ps_buffer_overflow = gensym("buffer_overflow");
 	ps_buffer_underflow = gensym("buffer_underflow");
+	ps_resync = gensym("resync");
 	
 	sampleScaleFactor = 1.0f/2147483647.0f;
 }
 
-#define DEFAULT_BUFFER_SIZE 1024
+#define CHANS_IN_PACKET 8
 
-void *U2A_new(long arg) {
+void *U2A_new(long numChans, long packetChans) {
 	U2A *x;
-	char *buf;
 	int i;
+	
+	if (numChans <= 0) {
+		numChans = DEFAULT_NUM_CHANS;
+	} else if (numChans > MAX_CHANS) {
+		post(" UDP2audio~: at most %ld channels; using %ld", (long) MAX_CHANS, (long) MAX_CHANS);
+		numChans = MAX_CHANS;
+	}
+	if (packetChans <= 0) {
+		packetChans = CHANS_IN_PACKET;
+	}
+	if (packetChans < numChans) {
+		post(" UDP2audio~: packets must carry at least %ld channels; assuming %ld", numChans, numChans);
+		packetChans = numChans;
+	}
 		
 	x = (U2A *) newobject(U2A_class);
 	dsp_setup((t_pxobject *) x, 1);
 	
 	/* Create the outlets in right to left order */
 	x->O_msgoutlet = outlet_new(x, 0L);		// Message outlet
-	for (i = 0; i < NUM_CHANS; ++i) {
+	for (i = 0; i < numChans; ++i) {
 		outlet_new(x, "signal");				
 	}
 	
+	x->numChans = numChans;
+	x->packetChans = packetChans;
 	x->previousCount = -1;
 	x->headStart = HEADSTART;
 	x->underflowState = 0;
 	x->bufSize = BUF_SIZE;
 	x->readPtr = x->writePtr = 0;
-	for (i = 0; i < NUM_CHANS; ++i) {
-		x->ringbuffers[i] = (float *) getbytes(BUF_SIZE * sizeof(float));
+	
+	x->vecSize = 0;
+	x->readIndex = 0;
+	x->readFrac = 0;
+	x->sr = 44100.f;
+	
+	x->localClock = 0.;
+	x->lastPerformTime = 0;
+	x->haveArrival = 0;
+	x->jitterVar = 0.;
+	x->packetFrames = 0;
+	
+	x->adapt = 1;
+	x->minLatency = HEADSTART;
+	x->maxLatency = DEFAULT_MAX_LATENCY;
+	x->target = HEADSTART;
+	
+	x->resample = 1;
+	x->fillAvg = 0.;
+	x->driftIntegral = 0.;
+	x->ratio = 1.;
+	x->phase = 0.;
+	x->fadeIn = 0;
+	
+	x->ringmem = (float *) sysmem_newptrclear(numChans * BUF_SIZE * sizeof(float));
+	x->ringbuffers = (float **) sysmem_newptr(numChans * sizeof(float *));
+	x->outSignals = (float **) sysmem_newptrclear(numChans * sizeof(float *));
+	if (!x->ringmem || !x->ringbuffers || !x->outSignals) {
+		post(" UDP2audio~: out of memory");
+		freeobject((t_object *) x);
+		return 0;
+	}
+	for (i = 0; i < numChans; ++i) {
+		x->ringbuffers[i] = x->ringmem + i * BUF_SIZE;
 	}
 
 	return (x);
 }
 
 void U2A_free(U2A *x) {
-	int i;
-	for (i = 0; i < NUM_CHANS; ++i) {
-		freebytes(x->ringbuffers[i], x->bufSize);
-	}
+	dsp_free((t_pxobject *) x);
+	if (x->ringmem) sysmem_freeptr(x->ringmem);
+	if (x->ringbuffers) sysmem_freeptr(x->ringbuffers);
+	if (x->outSignals) sysmem_freeptr(x->outSignals);
+	if (x->readIndex) sysmem_freeptr(x->readIndex);
+	if (x->readFrac) sysmem_freeptr(x->readFrac);
 }
 
 void U2A_assist(U2A *x, void *b, long m, long a, char *s) {
-	assist_string(3009,m,a,1,2,s);
+	if (m == ASSIST_INLET) {
+		sprintf(s, "FullPacket from a UDP receiver, messages");
+	} else if (a < x->numChans) {
+		sprintf(s, "(signal) Channel %ld", a + 1);
+	} else {
+		sprintf(s, "Sequence and buffer status");
+	}
 }
 
 void U2A_version (U2A *x) {
@@ -138,10 +256,17 @@ void U2A_version (U2A *x) {
 
 void U2A_state (U2A *x) {
 	post("UDP2audio~ state:  obj %p ", x);
+	post("  %ld channels out of %ld per packet", x->numChans, x->packetChans);
 	if (x->headStart) {
 		post("  Still waiting for %ld incoming samples before I output.", x->headStart);
 	}
 	post("  Read ptr %ld, write ptr %ld, bufSize %ld", x->readPtr, x->writePtr, x->bufSize);
+	post("  Target depth %ld samples (%s, %ld to %ld), average depth %.1f",
+		 x->target, x->adapt ? "adaptive" : "fixed", x->minLatency, x->maxLatency, x->fillAvg);
+	post("  Arrival jitter %.1f samples (std dev), %ld samples per packet",
+		 sqrt(x->jitterVar), x->packetFrames);
+	post("  Drift compensation %s, playback ratio %.6f (%+.1f ppm)",
+		 x->resample ? "on" : "off", x->ratio, (x->ratio - 1.) * 1e6);
 	if (x->previousCount < 0) {
 		post("  Still waiting to receive my first packet");
 	} else {
@@ -153,6 +278,36 @@ void U2A_headstart (U2A *x, long l) {
 	x->headStart = l;
 }
 
+void U2A_minlatency (U2A *x, long l) {
+	if (l < 0) l = 0;
+	if (l > x->maxLatency) l = x->maxLatency;
+	x->minLatency = l;
+	U2A_UpdateTarget(x);
+}
+
+void U2A_maxlatency (U2A *x, long l) {
+	/* Leave room in the ring buffer for a burst on top of the deepest target */
+	if (l > x->bufSize / 2) {
+		post(" UDP2audio~: maxlatency is limited to %ld samples", x->bufSize / 2);
+		l = x->bufSize / 2;
+	}
+	if (l < x->minLatency) l = x->minLatency;
+	x->maxLatency = l;
+	U2A_UpdateTarget(x);
+}
+
+void U2A_adapt (U2A *x, long l) {
+	x->adapt = (l != 0);
+	U2A_UpdateTarget(x);
+}
+
+void U2A_resample (U2A *x, long l) {
+	x->resample = (l != 0);
+	if (!x->resample) {
+		x->driftIntegral = 0.;
+	}
+}
+
 
 /* Ring buffer helpers */
 
@@ -171,64 +326,159 @@ long num_can_read(U2A *x) {
 
 long num_can_write(U2A *x) {
  	/* This could be interrupted at any time by the audio processing interrupt.  But if that happens
- 	   we know that more will be read, so our answer will be too conservative. */
+ 	   we know that more will be read, so our answer will be too conservative.
+ 	   The sample just behind the read pointer is kept too: the interpolator reads it. */
 
 	long readPosSnapshot, capacity;
 	
 	readPosSnapshot = x->readPtr;
 
 	if (x->writePtr < readPosSnapshot) {
-		capacity = readPosSnapshot - x->writePtr - 1;
+		capacity = readPosSnapshot - x->writePtr - 2;
 	} else {
-		capacity = x->bufSize - (x->writePtr - readPosSnapshot) - 1;
+		capacity = x->bufSize - (x->writePtr - readPosSnapshot) - 2;
 	}
-	return capacity;
+	return capacity < 0 ? 0 : capacity;
 }
 
 
 /*******************************************************************
- Parsing incoming UDP packets 
+ Adaptive buffer depth
  *******************************************************************/
 
-long isModuloishlyBetween(long x, long low, long high) {
-	if (low < high) {
-		return (low <= x) && (x <= high);
-	} else {
-		// Wrap-around case
-		return (x >= low) || (x <= high);
+void U2A_UpdateTarget(U2A *x) {
+	double depth;
+	long target = x->minLatency;
+	
+	if (x->adapt) {
+		/* One packet has to be in hand before it's needed, plus one signal vector
+		   of lookahead, plus enough to ride out the measured arrival jitter. */
+		depth = x->packetFrames + x->vecSize + JITTER_DEVIATIONS * sqrt(x->jitterVar);
+		if (depth > target) target = (long) depth;
 	}
+	if (target > x->maxLatency) target = x->maxLatency;
+	x->target = target;
 }
 
+static void U2A_MeasureArrival(U2A *x, long numFrames, long packetsSent) {
+	double now, d, d2;
+	
+	/* Arrival times are read off our own audio clock, so the deviation is in the
+	   same units as the buffer depth.  With no DSP running the clock stands still
+	   and tells us nothing. */
+	if (gettime() - x->lastPerformTime > CLOCK_STALE_MS) {
+		x->haveArrival = 0;
+		return;
+	}
+	now = x->localClock;
+	
+	if (x->haveArrival) {
+		/* How much later (or earlier) than the sender's own timing this packet
+		   showed up, relative to the previous one (cf. RFC 3550 interarrival jitter) */
+		d = (now - x->lastArrival) - (double) packetsSent * numFrames;
+		d2 = d * d;
+		x->jitterVar += (d2 - x->jitterVar) * (d2 > x->jitterVar ? JITTER_ATTACK : JITTER_RELEASE);
+	}
+	x->lastArrival = now;
+	x->haveArrival = 1;
+	x->packetFrames = numFrames;
+	
+	U2A_UpdateTarget(x);
+}
+
+
+/*******************************************************************
+ Parsing incoming UDP packets 
+ *******************************************************************/
+
 #define MAX_COUNT 65535U
 #define MAX_PACKET_SKIP 100	// Most sequence numbers we're willing to skip forward
-#define CHANS_IN_PACKET 8
 
+/* Convert n frames of interleaved 32-bit samples into the per-channel rings,
+   starting at ring position pos (the caller handles wrap-around). */
+static void U2A_Deinterleave(U2A *x, const int *src, long pos, long n) {
+	long stride = x->packetChans;
+	long c = 0, i;
+	float scale = sampleScaleFactor;
+	
+#ifdef __SSE2__
+	/* Four channels by four frames at a time: load one row of four channels
+	   per frame, convert, and transpose into four per-channel columns. */
+	__m128 vscale = _mm_set1_ps(scale);
+	
+	for (; c + 4 <= x->numChans; c += 4) {
+		const int *s = src + c;
+		float *d0 = x->ringbuffers[c] + pos;
+		float *d1 = x->ringbuffers[c+1] + pos;
+		float *d2 = x->ringbuffers[c+2] + pos;
+		float *d3 = x->ringbuffers[c+3] + pos;
+		
+		for (i = 0; i + 4 <= n; i += 4, s += 4 * stride) {
+			__m128 r0 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *) s)), vscale);
+			__m128 r1 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *) (s + stride))), vscale);
+			__m128 r2 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *) (s + 2 * stride))), vscale);
+			__m128 r3 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *) (s + 3 * stride))), vscale);
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			_mm_storeu_ps(d0 + i, r0);
+			_mm_storeu_ps(d1 + i, r1);
+			_mm_storeu_ps(d2 + i, r2);
+			_mm_storeu_ps(d3 + i, r3);
+		}
+		for (; i < n; ++i, s += stride) {
+			d0[i] = (float) s[0] * scale;
+			d1[i] = (float) s[1] * scale;
+			d2[i] = (float) s[2] * scale;
+			d3[i] = (float) s[3] * scale;
+		}
+	}
+#endif
+	
+	/* Remaining channels one at a time, unrolled so each output is a unit-stride run */
+	for (; c < x->numChans; ++c) {
+		const int *s = src + c;
+		float *d = x->ringbuffers[c] + pos;
+		
+		for (i = 0; i + 4 <= n; i += 4, s += 4 * stride) {
+			d[i] = (float) s[0] * scale;
+			d[i+1] = (float) s[stride] * scale;
+			d[i+2] = (float) s[2 * stride] * scale;
+			d[i+3] = (float) s[3 * stride] * scale;
+		}
+		for (; i < n; ++i, s += stride) {
+			d[i] = (float) s[0] * scale;
+		}
+	}
+}
 
 void U2A_ParseFullPacket(U2A *x, long size, long bufptr) {
 	Atom args[2];
 	char *bytes;
-	long *samples;
+	int *samples;
 	unsigned short *shortPtr, count;
-	int numFrames, i, c;
-	long readPosSnapshot, capacity, myWritePtr;
+	long numFrames, delta, capacity, myWritePtr, firstPart;
 	bytes = (char *)bufptr;
 	
 	// post("*U2A_ParseFullPacket: size %ld, bufptr %ld", size, bufptr);
 	
+	if (size < 2) return;
+	
 	/* Last two bytes of packet are the count */
 	shortPtr = (unsigned short *) (bytes+size-2);
 	count = (*shortPtr);
+	delta = 1;
 	
 	if (x->previousCount < 0) {
 		// First packet we've seen; no problem
 	} else {
-		if (count != x->previousCount + 1) {
-			if (count == x->previousCount) {
+		/* Sequence numbers wrap around at MAX_COUNT */
+		delta = ((long) count - x->previousCount) & MAX_COUNT;
+		if (delta != 1) {
+			if (delta == 0) {
 				/* Duplicate of the packet we just got; trash it. */
 				SETLONG(args, count);
 				outlet_anything(x->O_msgoutlet, ps_duplicate, 1, args);
 				return;
-			} else if (isModuloishlyBetween(count, x->previousCount, x->previousCount+MAX_PACKET_SKIP)) {
+			} else if (delta <= MAX_PACKET_SKIP) {
 				// Assume we skipped some packets and carry on
 				SETLONG(args, (long) x->previousCount);
 				SETLONG(args+1, (long) count);
@@ -247,10 +497,14 @@ void U2A_ParseFullPacket(U2A *x, long size, long bufptr) {
 	/* The rest of the packet is the data.  If we got this far we want to write this data into our
 	   circular buffers. */
 	   
-	samples = (long *) bufptr;
-	numFrames = (size-2) / (CHANS_IN_PACKET * sizeof(float));
+	samples = (int *) bufptr;
+	numFrames = (size-2) / (x->packetChans * sizeof(int));
+	if (numFrames <= 0) return;
+	
+	U2A_MeasureArrival(x, numFrames, delta);
 	
-	/* Make sure the ring buffers have capacity. */
+	/* Make sure the ring buffers have capacity.  The perform routine keeps the fill
+	   near the target depth, so this only happens if the DSP has been off a while. */
 	
 	capacity = num_can_write(x);
 	
@@ -263,98 +517,228 @@ void U2A_ParseFullPacket(U2A *x, long size, long bufptr) {
 		return;
 	}
 	
-	/* Put the data in the ring buffers */
+	/* Put the data in the ring buffers, in at most two contiguous runs */
 	myWritePtr = x->writePtr;
-	for (i = 0; i < numFrames; ++i) {
-		for (c = 0; c < NUM_CHANS; ++c) {
-	         x->ringbuffers[c][myWritePtr] = ((float) samples[(i * CHANS_IN_PACKET) + c]) * sampleScaleFactor;
-		}
-		myWritePtr = (myWritePtr + 1) % x->bufSize;
-		/* Skip over the samples to ignore */
-		samples += (CHANS_IN_PACKET - NUM_CHANS);			
+	firstPart = x->bufSize - myWritePtr;
+	if (firstPart >= numFrames) {
+		U2A_Deinterleave(x, samples, myWritePtr, numFrames);
+	} else {
+		U2A_Deinterleave(x, samples, myWritePtr, firstPart);
+		U2A_Deinterleave(x, samples + firstPart * x->packetChans, 0, numFrames - firstPart);
 	}
-	x->writePtr = myWritePtr;
+	x->writePtr = (myWritePtr + numFrames) & (x->bufSize - 1);
 }
 
 
 /* Outputting a signal */
 
 void U2A_dsp(U2A *x, t_signal **sp, short *count){
-	void *vectorArgs[NUM_CHANS+2];
 	int i;
+	long n = sp[0]->s_n;
 	
-	for (i = 0; i < NUM_CHANS; ++i) {
-		vectorArgs[i] = sp[i]->s_vec;
+	/* sp[0] is the signal inlet; the outlets come after it */
+	for (i = 0; i < x->numChans; ++i) {
+		x->outSignals[i] = sp[i+1]->s_vec;
 	}
-	vectorArgs[NUM_CHANS] = (void *) sp[0]->s_n;
-	vectorArgs[NUM_CHANS+1] = (void *) x;
 	
-	dsp_addv(U2A_perform, (long) NUM_CHANS+2, (void **) vectorArgs);
+	if (n > x->vecSize || !x->readIndex) {
+		if (x->readIndex) sysmem_freeptr(x->readIndex);
+		if (x->readFrac) sysmem_freeptr(x->readFrac);
+		x->readIndex = (long *) sysmem_newptr(n * sizeof(long));
+		x->readFrac = (float *) sysmem_newptr(n * sizeof(float));
+		if (!x->readIndex || !x->readFrac) {
+			post(" UDP2audio~: out of memory");
+			return;
+		}
+	}
+	x->vecSize = n;
+	x->sr = sp[0]->s_sr;
+	U2A_UpdateTarget(x);
+	
+	dsp_add(U2A_perform, 2, x, n);
+}
+
+/* Returns the playback ratio for this signal vector, steering the buffer fill
+   towards the target depth to absorb the difference between the sender's and
+   our sample clocks. */
+static double U2A_Steer(U2A *x, long fill, long vecSize) {
+	double dt, a, err, correction;
+	
+	dt = vecSize / x->sr;
+	a = dt / FILL_SMOOTHING_TIME;
+	if (a > 1.) a = 1.;
+	x->fillAvg += (fill - x->fillAvg) * a;
+	
+	if (!x->resample) {
+		return 1.;
+	}
+	
+	err = (x->fillAvg - x->target) / x->sr;
+	
+	x->driftIntegral += DRIFT_KI * err * dt;
+	if (x->driftIntegral > MAX_DRIFT) x->driftIntegral = MAX_DRIFT;
+	if (x->driftIntegral < -MAX_DRIFT) x->driftIntegral = -MAX_DRIFT;
+	
+	correction = DRIFT_KP * err + x->driftIntegral;
+	if (correction > MAX_RATIO_DEVIATION) correction = MAX_RATIO_DEVIATION;
+	if (correction < -MAX_RATIO_DEVIATION) correction = -MAX_RATIO_DEVIATION;
+	
+	return 1. + correction;
 }
 
 t_int *U2A_perform(t_int *w) {
-	int i, j, vecSize, c;
-	float *outSignals[NUM_CHANS];
-	long sampsAvailable, writePtrSnapshot, myReadPtr;
-	U2A *x;
+	U2A *x = (U2A *) w[1];
+	long vecSize = w[2];
+	long i, c, n, numChans, mask, sampsAvailable, needed, consumed, myReadPtr;
+	int interpolate;
+	double ratio, pos;
+	float **outSignals, *ring, *out;
 	Atom args[2];
 	
-	for (i = 0; i < NUM_CHANS; ++i) {
-		outSignals[i] = (float *)(w[i+1]);
-	}
-	vecSize = w[NUM_CHANS+1];
-	x = (U2A *) w[NUM_CHANS+2];
+	numChans = x->numChans;
+	mask = x->bufSize - 1;
+	outSignals = x->outSignals;
+	
+	x->localClock += vecSize;
+	x->lastPerformTime = gettime();
 	
 #ifdef OUTPUTALLZEROES
-	for (c = 0; c < NUM_CHANS; ++c) {
-		for (i = 0; i < vecSize; ++i) {
-			outSignals[c][i] = 0.0f;
-		}
-	}
+	goto outputzeroes;
 #else
+	if (!x->readIndex) {
+		goto outputzeroes;
+	}
+	
 	/* Make sure we have enough samples.*/
 	sampsAvailable = num_can_read(x);
 	
-	
 	if (x->headStart) {
 		if (sampsAvailable >= x->headStart) {
 			x->headStart = 0;
+			x->fadeIn = 1;
+			x->fillAvg = sampsAvailable;
+			x->phase = 0.;
 		} else {
 			goto outputzeroes;
 		}
 	}
 	
-	if (sampsAvailable < vecSize) {
+	if (sampsAvailable > x->target + x->maxLatency) {
+		/* Far more buffered than we'll ever want, e.g., because packets kept
+		   coming while the DSP was off.  Skip ahead instead of playing late. */
+		SETLONG(args, (long) sampsAvailable);
+		SETLONG(args+1, (long) x->target);
+		outlet_anything(x->O_msgoutlet, ps_resync, 2, args);
+		
+		x->readPtr = (x->readPtr + sampsAvailable - x->target) & mask;
+		sampsAvailable = x->target;
+		x->fillAvg = sampsAvailable;
+		x->fadeIn = 1;
+	}
+	
+	ratio = x->ratio = U2A_Steer(x, sampsAvailable, vecSize);
+	
+	/* Work out where each output sample reads from */
+	if (ratio == 1. && x->phase == 0.) {
+		interpolate = 0;
+		pos = vecSize;
+		consumed = needed = vecSize;
+	} else {
+		interpolate = 1;
+		pos = x->phase;
+		for (i = 0; i < vecSize; ++i) {
+			long k = (long) pos;
+			x->readIndex[i] = k;
+			x->readFrac[i] = (float) (pos - k);
+			pos += ratio;
+		}
+		consumed = (long) pos;
+		needed = x->readIndex[vecSize-1] + 3;	// Interpolator reads two samples ahead
+	}
+	
+	if (sampsAvailable < needed) {
 		if (x->underflowState) {
 			// We already complained
 		} else {
 			x->underflowState = 1;
 			SETLONG(args, (long) sampsAvailable);
-			SETLONG(args+1, (long) vecSize);
+			SETLONG(args+1, (long) needed);
 			outlet_anything(x->O_msgoutlet, ps_buffer_underflow, 2, args);
 		}
-
-		/* Output all zeroes this frame */
-		outputzeroes:
-		for (c = 0; c < NUM_CHANS; ++c) {
+		
+		/* Fade out whatever we have rather than stopping dead, then
+		   wait for the buffer to fill back up to the target depth. */
+		n = sampsAvailable < vecSize ? sampsAvailable : vecSize;
+		myReadPtr = x->readPtr;
+		for (c = 0; c < numChans; ++c) {
+			ring = x->ringbuffers[c];
+			out = outSignals[c];
+			for (i = 0; i < n; ++i) {
+				out[i] = ring[(myReadPtr + i) & mask] * (float) (n - i) / (float) n;
+			}
+			for (; i < vecSize; ++i) {
+				out[i] = 0.0f;
+			}
+		}
+		x->readPtr = (myReadPtr + n) & mask;
+		x->headStart = x->target > 0 ? x->target : 1;
+		x->phase = 0.;
+		return w + 3;
+	}
+	
+	/* We're happy */
+	x->underflowState = 0;
+	myReadPtr = x->readPtr;
+	
+	for (c = 0; c < numChans; ++c) {
+		ring = x->ringbuffers[c];
+		out = outSignals[c];
+		
+		if (!interpolate) {
+			n = x->bufSize - myReadPtr;
+			if (n >= vecSize) {
+				memcpy(out, ring + myReadPtr, vecSize * sizeof(float));
+			} else {
+				memcpy(out, ring + myReadPtr, n * sizeof(float));
+				memcpy(out + n, ring, (vecSize - n) * sizeof(float));
+			}
+		} else {
+			/* 4-point, 3rd order Hermite interpolation */
 			for (i = 0; i < vecSize; ++i) {
-				outSignals[c][i] = 0.0f;
+				long p = myReadPtr + x->readIndex[i];
+				float f = x->readFrac[i];
+				float ym1 = ring[(p - 1) & mask];
+				float y0 = ring[p & mask];
+				float y1 = ring[(p + 1) & mask];
+				float y2 = ring[(p + 2) & mask];
+				float c1 = 0.5f * (y1 - ym1);
+				float c2 = ym1 - 2.5f * y0 + 2.f * y1 - 0.5f * y2;
+				float c3 = 0.5f * (y2 - ym1) + 1.5f * (y0 - y1);
+				out[i] = ((c3 * f + c2) * f + c1) * f + y0;
 			}
 		}
-	} else {
-		/* We're happy */
-		x->underflowState = 0;
-		myReadPtr = x->readPtr;
-		for (i = 0; i < vecSize; ++i) {
-			for (c = 0; c < NUM_CHANS; ++c) {
-		         outSignals[c][i] = x->ringbuffers[c][myReadPtr];
+		
+		if (x->fadeIn) {
+			for (i = 0; i < vecSize; ++i) {
+				out[i] *= (float) i / (float) vecSize;
 			}
-			myReadPtr = (myReadPtr + 1) % x->bufSize;
 		}
-		x->readPtr = myReadPtr;
 	}
 	
+	x->readPtr = (myReadPtr + consumed) & mask;
+	x->phase = pos - consumed;
+	x->fadeIn = 0;
+	
+	return w + 3;
 #endif	
 	
-	return w + NUM_CHANS + 3;
+	/* Output all zeroes this frame */
+	outputzeroes:
+	for (c = 0; c < numChans; ++c) {
+		for (i = 0; i < vecSize; ++i) {
+			outSignals[c][i] = 0.0f;
+		}
+	}
+	
+	return w + 3;
 }
@@ -67,12 +67,17 @@ ENHANCEMENTS, OR MODIFICATIONS.
 
 
 #include <math.h>
+#include <stdlib.h>
 #include "ext.h"  				/* you must include this - it contains the external object's link to max */
 
 
 #define RES_ID 8561 			// resource ID for assistance (we'll add that later)
-#define MAX_LS_AMOUNT 32		// maximum amount of loudspeakers, can be raised
+#define MAX_LS_AMOUNT 32		// maximum amount of loudspeakers for the old pairwise triangulation
 #define MIN_VOL_P_SIDE_LGTH 0.01  
+#define HULL_EPSILON 1.0e-6		// distance under which a point is considered to lie on a hull face
+
+#define TRIANGULATE_HULL 0		// convex hull of the loudspeaker directions (default)
+#define TRIANGULATE_PAIRWISE 1	// original O(n^4) search, limited to MAX_LS_AMOUNT loudspeakers
 
 
 /* A struct for a loudspeaker instance */
@@ -97,22 +102,40 @@ typedef struct 				/* This defines the object as an entity made up of other thin
 	Object x_ob;				/* gotta say this... it creates a reference to your object */
 	long x_ls_read;	 			// 1 if loudspeaker directions have been read
 	long x_triplets_specified;  // 1 if loudspeaker triplets have been chosen
-	t_ls x_ls[MAX_LS_AMOUNT];   // loudspeakers
+	t_ls *x_ls;   				// loudspeakers
+	long x_ls_allocated;		// number of t_ls allocated in x_ls
 	t_ls_set *x_ls_set;			// loudspeaker sets
 	void *x_outlet0;			/* outlet creation - inlets are automatic */
 	long x_ls_amount;			// number of loudspeakers
 	long x_dimension;		    // 2 (horizontal arrays) or 3 (3d setups)
+	long x_triangulation;		// TRIANGULATE_HULL or TRIANGULATE_PAIRWISE
 } t_def_ls;
 
+/* A triangle of the convex hull, used by choose_ls_triplets_hull() */
+typedef struct {
+  int v[3];      // loudspeaker indices, counterclockwise seen from outside
+  int adj[3];    // neighbouring face across edge v[i] -> v[(i+1)%3]
+  double n[3];   // outward unit normal
+  double d;      // distance of the plane from the origin
+  int outside;   // first loudspeaker still outside this face, -1 if none
+  int visited;   // mark for the visibility search
+  int alive;
+} t_hull_face;
+
 void *def_ls_class;				/* so max can identify your object */
 void def_ls_bang(t_def_ls *x);
 void def_ls_int(t_def_ls *x, long n);
 void def_ls_read_directions(t_def_ls *x, Symbol *s, int ac, Atom *av);
 void def_ls_read_triplets(t_def_ls *x, Symbol *s, int ac, Atom *av);
+void def_ls_triangulation(t_def_ls *x, Symbol *s);
 void *def_ls_new(Symbol *s, int ac, Atom *av); // using A_GIMME - typed message list
+void def_ls_free(t_def_ls *x);
+int def_ls_alloc_ls(t_def_ls *x, long amount);
+void def_ls_free_sets(t_def_ls *x);
 void def_ls(float g[3], long ls[3], t_def_ls *x);
 void ls_angles_to_cart(t_ls *ls);
 void choose_ls_triplets(t_def_ls *x);
+void choose_ls_triplets_hull(t_def_ls *x);
 int any_ls_inside_triplet(int a, int b, int c,t_ls lss[MAX_LS_AMOUNT],int ls_amount);
 void add_ldsp_triplet(int i, int j, int k, t_def_ls *x);
 float vec_angle(t_ls v1, t_ls v2);
@@ -132,30 +155,30 @@ void sort_2D_lss(t_ls lss[MAX_LS_AMOUNT], int sorted_lss[MAX_LS_AMOUNT],
 
 void main(void)
 {
-	setup(&def_ls_class, def_ls_new, 0L, (short)sizeof(t_def_ls), 0L, A_GIMME, 0); 
+	setup(&def_ls_class, def_ls_new, (method)def_ls_free, (short)sizeof(t_def_ls), 0L, A_GIMME, 0); 
 	/* def_ls_new = creation function, A_DEFLONG = its (optional) arguement is a long (32-bit) int */
 	
 	addbang((method)def_ls_bang);			/* the procedure it uses when it gets a bang in the left inlet */
 	addint((method)def_ls_int);			/* the rocedure for an int in the left inlet (inlet 0) */
 	addmess((method)def_ls_read_directions, "ls-directions", A_GIMME, 0);	
 	addmess((method)def_ls_read_triplets, "ls-triplets", A_GIMME, 0);
+	addmess((method)def_ls_triangulation, "triangulation", A_SYM, 0);
 }
 
 
 void def_ls_bang(t_def_ls *x)						/* x = reference to this instance of the object */ 
 {   // calculate and print out chosen loudspeaker sets and corresponding  matrices
-	Atom at[MAX_LS_AMOUNT*2+1]; 
-	float g[3];
-	long ls[3];
-	long i;
-	
 	if(x->x_ls_read == 1){
 		if(x->x_ls_amount < x->x_dimension){
 			post("define-loudspeakers: Too few loudspeakers!",0);
 			return;
 		} else if(x->x_dimension == 3){
-			if(x->x_triplets_specified==0)
-				choose_ls_triplets(x);
+			if(x->x_triplets_specified==0){
+				if(x->x_triangulation == TRIANGULATE_PAIRWISE && x->x_ls_amount <= MAX_LS_AMOUNT)
+					choose_ls_triplets(x);
+				else
+					choose_ls_triplets_hull(x);
+			}
 			calculate_3x3_matrixes(x);
 		} else if(x->x_dimension == 2)
 		  	choose_ls_tuplets(x);
@@ -184,7 +207,6 @@ void def_ls_read_triplets(t_def_ls *x, Symbol *s, int ac, Atom *av)
 // when loudspeaker triplets come in a message
 {
 	long l1,l2,l3,i;
-	t_ls_set *trip_ptr,  *tmp_ptr, *prev;
 	if(x->x_ls_read == 0){
 		post("define_loudspeakers: Define loudspeaker directions first!",0);
 		return;
@@ -195,14 +217,7 @@ void def_ls_read_triplets(t_def_ls *x, Symbol *s, int ac, Atom *av)
 		return;
 	}
 		
- 	trip_ptr = x->x_ls_set;
-  	prev = NULL;
-  	while (trip_ptr != NULL){
-   	     tmp_ptr = trip_ptr;
-   	     trip_ptr = trip_ptr->next;
-   	     freebytes(tmp_ptr, sizeof (struct t_ls_set));
-    }
-    x->x_ls_set = NULL;
+	def_ls_free_sets(x);
 	
 	for(i=0;i<ac;i+=3){
 		if(av[i].a_type == A_LONG) 
@@ -227,7 +242,6 @@ void def_ls_read_triplets(t_def_ls *x, Symbol *s, int ac, Atom *av)
 void def_ls_read_directions(t_def_ls *x, Symbol *s, int ac, Atom *av)
 // when loudspeaker directions come in a message
 {
-	t_ls_set *trip_ptr, *prev, *tmp_ptr;
 	long i,pointer,newlyread;	
 	newlyread = 0;
 	if(av[0].a_type == A_LONG){
@@ -244,6 +258,10 @@ void def_ls_read_directions(t_def_ls *x, Symbol *s, int ac, Atom *av)
  	}
  		
 	pointer = 1;
+	if(def_ls_alloc_ls(x, (ac-1) / (x->x_dimension - 1)) == 0){
+		x->x_ls_read = 0;
+		return;
+	}
 	x->x_ls_amount= (ac-1) / (x->x_dimension - 1);
 	for(i=0; i < x->x_ls_amount;i++){
 		if(av[0].a_type == A_LONG) 
@@ -275,18 +293,65 @@ void def_ls_read_directions(t_def_ls *x, Symbol *s, int ac, Atom *av)
 		x->x_ls_read = 1;  // preprocess data
 		for(i=0;i<x->x_ls_amount;i++)
 			ls_angles_to_cart(&x->x_ls[i]);	
- 		trip_ptr = x->x_ls_set;
-  		prev = NULL;
-  		while (trip_ptr != NULL){ // remove old matrices
-   		     tmp_ptr = trip_ptr;
-   		     trip_ptr = trip_ptr->next;
-   		     freebytes(tmp_ptr, sizeof (struct t_ls_set));
-    	}
-    	x->x_ls_set = NULL;
+		def_ls_free_sets(x); // remove old matrices
     }
     x->x_triplets_specified=0;
 }
 
+void def_ls_triangulation(t_def_ls *x, Symbol *s)
+// choose how loudspeaker triplets are found in 3-D setups
+{
+	if(s == gensym("hull"))
+		x->x_triangulation = TRIANGULATE_HULL;
+	else if(s == gensym("pairwise"))
+		x->x_triangulation = TRIANGULATE_PAIRWISE;
+	else {
+		post("define-loudspeakers: triangulation has to be hull or pairwise",0);
+		return;
+	}
+	if(x->x_triangulation == TRIANGULATE_PAIRWISE && x->x_ls_amount > MAX_LS_AMOUNT)
+		post("define-loudspeakers: pairwise triangulation handles at most %ld loudspeakers, using hull",
+		     (long) MAX_LS_AMOUNT);
+}
+
+int def_ls_alloc_ls(t_def_ls *x, long amount)
+// make room for amount loudspeakers, returns 0 if out of memory
+{
+	t_ls *lss;
+	if(amount <= x->x_ls_allocated)
+		return 1;
+	lss = (t_ls *) sysmem_newptr(amount * sizeof(t_ls));
+	if(lss == NULL){
+		post("define-loudspeakers: out of memory for %ld loudspeakers", amount);
+		return 0;
+	}
+	if(x->x_ls != NULL)
+		sysmem_freeptr(x->x_ls);
+	x->x_ls = lss;
+	x->x_ls_allocated = amount;
+	return 1;
+}
+
+void def_ls_free_sets(t_def_ls *x)
+// remove all loudspeaker sets
+{
+	t_ls_set *trip_ptr, *tmp_ptr;
+	trip_ptr = x->x_ls_set;
+	while (trip_ptr != NULL){
+		tmp_ptr = trip_ptr;
+		trip_ptr = trip_ptr->next;
+		freebytes(tmp_ptr, sizeof (struct t_ls_set));
+	}
+	x->x_ls_set = NULL;
+}
+
+void def_ls_free(t_def_ls *x)
+{
+	def_ls_free_sets(x);
+	if(x->x_ls != NULL)
+		sysmem_freeptr(x->x_ls);
+}
+
 /*--------------------------------------------------------------------------*/
 
 void ls_angles_to_cart(t_ls *ls)
@@ -308,6 +373,11 @@ void *def_ls_new(Symbol *s, int ac, Atom *av)	/* create new instance of object..
 	t_def_ls *x;
 	x = (t_def_ls *)newobject(def_ls_class);
 	
+	x->x_ls = NULL;
+	x->x_ls_allocated = 0;
+	x->x_ls_set = NULL;
+	x->x_ls_amount = 0;
+	x->x_triangulation = TRIANGULATE_HULL;
 	x->x_ls_read = 0;
 	if(av[0].a_type == A_LONG){
 		 x->x_dimension= av[0].a_w.w_long;
@@ -324,6 +394,10 @@ void *def_ls_new(Symbol *s, int ac, Atom *av)	/* create new instance of object..
  	
  	
 	pointer = 1;
+	if(def_ls_alloc_ls(x, (ac-1) / (x->x_dimension - 1)) == 0){
+		freeobject((t_object *)x);
+		return(0);
+	}
 	x->x_ls_amount= (ac-1) / (x->x_dimension - 1);
 
 	// read loudspeaker direction angles  
@@ -358,7 +432,6 @@ void *def_ls_new(Symbol *s, int ac, Atom *av)	/* create new instance of object..
 			ls_angles_to_cart(&x->x_ls[i]);	
 	x->x_triplets_specified=0;
 	x->x_outlet0 =  outlet_new(x, 0L);	/* create a (list) outlet */
-	x->x_ls_set = NULL;
 	return(x);					/* return a reference to the object instance */
 }
 
@@ -484,6 +557,319 @@ void choose_ls_triplets(t_def_ls *x)
   x->x_triplets_specified=1;
 }
 
+static double hull_dist(t_hull_face *f, t_ls *p)
+// signed distance of a loudspeaker from the plane of a hull face
+{
+  return f->n[0] * p->x + f->n[1] * p->y + f->n[2] * p->z - f->d;
+}
+
+static int hull_set_plane(t_hull_face *f, t_ls *lss)
+     /* computes the outward plane of a face from its vertex order,
+        returns 0 if the three loudspeakers are collinear */
+{
+  t_ls *a = &lss[f->v[0]], *b = &lss[f->v[1]], *c = &lss[f->v[2]];
+  double ux = b->x - a->x, uy = b->y - a->y, uz = b->z - a->z;
+  double vx = c->x - a->x, vy = c->y - a->y, vz = c->z - a->z;
+  double len;
+
+  f->n[0] = uy * vz - uz * vy;
+  f->n[1] = uz * vx - ux * vz;
+  f->n[2] = ux * vy - uy * vx;
+  len = sqrt(f->n[0] * f->n[0] + f->n[1] * f->n[1] + f->n[2] * f->n[2]);
+  if(len < HULL_EPSILON){
+    f->n[0] = f->n[1] = f->n[2] = f->d = 0.0;
+    return 0;
+  }
+  f->n[0] /= len;
+  f->n[1] /= len;
+  f->n[2] /= len;
+  f->d = f->n[0] * a->x + f->n[1] * a->y + f->n[2] * a->z;
+  return 1;
+}
+
+static int hull_new_face(t_hull_face **faces, int *nfaces, int *faces_allocated,
+                         int a, int b, int c, t_ls *lss)
+     /* appends face a,b,c and returns its index, or -1 if out of memory */
+{
+  t_hull_face *f;
+  if(*nfaces == *faces_allocated){
+    f = (t_hull_face *) sysmem_resizeptr(*faces, 2 * (*faces_allocated) * sizeof(t_hull_face));
+    if(f == NULL)
+      return -1;
+    *faces = f;
+    *faces_allocated *= 2;
+  }
+  f = &(*faces)[*nfaces];
+  f->v[0] = a;
+  f->v[1] = b;
+  f->v[2] = c;
+  f->adj[0] = f->adj[1] = f->adj[2] = -1;
+  f->outside = -1;
+  f->visited = -1;
+  f->alive = 1;
+  hull_set_plane(f, lss);
+  return (*nfaces)++;
+}
+
+static int hull_compare_triplets(const void *p1, const void *p2)
+// lexicographic order, the order in which the pairwise search finds triplets
+{
+  const int *t1 = (const int *) p1, *t2 = (const int *) p2;
+  if(t1[0] != t2[0])
+    return t1[0] - t2[0];
+  if(t1[1] != t2[1])
+    return t1[1] - t2[1];
+  return t1[2] - t2[2];
+}
+
+void choose_ls_triplets_hull(t_def_ls *x)
+     /* Selects the loudspeaker triplets as the faces of the convex hull
+     of the loudspeaker direction vectors. Since all loudspeakers lie on
+     the unit sphere every one of them is a hull vertex, and the hull faces
+     are exactly the non-overlapping triangles the pairwise search looks
+     for. The hull is built incrementally: every loudspeaker not yet on the
+     hull is kept in the outside list of one face it can see, so adding a
+     loudspeaker only visits the faces it removes and the ones it creates
+     (expected O(n log n)). Faces whose plane does not have the listener
+     strictly on its inner side (e.g. the open bottom of a dome) are
+     dropped, as are too narrow triangles. The triplets are sorted so that
+     the output has the same form and order as choose_ls_triplets(). */
+{
+  int ls_amount = x->x_ls_amount;
+  t_ls *lss = x->x_ls;
+  t_hull_face *faces = NULL;
+  int nfaces = 0, faces_allocated;
+  int *next_outside = NULL, *new_face_at = NULL, *stack = NULL, *triplets = NULL;
+  int *horizon = NULL;
+  int i, j, k, f, g, p, q, i0, i1, i2, i3, stamp, ntriplets, nhorizon, nvisible;
+  double best, dist, dx, dy, dz;
+  t_hull_face *fp;
+  t_ls_set *tail, *trip_ptr;
+
+  def_ls_free_sets(x);
+  if (ls_amount < 4) {
+    post("define-loudspeakers: at least 4 loudspeakers are needed for a 3-D setup",0);
+    return;
+  }
+
+  /* initial tetrahedron: two far apart loudspeakers, the one farthest
+     from the line through them and the one farthest from that plane */
+  i0 = 0;
+  i1 = -1;
+  best = 0.0;
+  for(i=1;i<ls_amount;i++){
+    dx = lss[i].x - lss[i0].x; dy = lss[i].y - lss[i0].y; dz = lss[i].z - lss[i0].z;
+    dist = dx * dx + dy * dy + dz * dz;
+    if(dist > best){ best = dist; i1 = i; }
+  }
+  i2 = -1;
+  best = HULL_EPSILON;
+  for(i=0;i<ls_amount;i++){
+    double ux = lss[i1].x - lss[i0].x, uy = lss[i1].y - lss[i0].y, uz = lss[i1].z - lss[i0].z;
+    double cx, cy, cz;
+    dx = lss[i].x - lss[i0].x; dy = lss[i].y - lss[i0].y; dz = lss[i].z - lss[i0].z;
+    cx = uy * dz - uz * dy; cy = uz * dx - ux * dz; cz = ux * dy - uy * dx;
+    dist = cx * cx + cy * cy + cz * cz;
+    if(dist > best){ best = dist; i2 = i; }
+  }
+  if(i1 < 0 || i2 < 0){
+    post("define-loudspeakers: loudspeakers are not spread in 3-D",0);
+    return;
+  }
+
+  faces_allocated = 4 * ls_amount + 8;
+  faces = (t_hull_face *) sysmem_newptr(faces_allocated * sizeof(t_hull_face));
+  next_outside = (int *) sysmem_newptr(ls_amount * sizeof(int));
+  new_face_at = (int *) sysmem_newptr(ls_amount * sizeof(int));
+  horizon = (int *) sysmem_newptr(3 * ls_amount * sizeof(int));
+  if(faces == NULL || next_outside == NULL || new_face_at == NULL || horizon == NULL){
+    post("define-loudspeakers: out of memory",0);
+    goto done;
+  }
+  for(i=0;i<ls_amount;i++)
+    new_face_at[i] = -1;
+
+  f = hull_new_face(&faces, &nfaces, &faces_allocated, i0, i1, i2, lss);
+  i3 = -1;
+  best = HULL_EPSILON;
+  for(i=0;i<ls_amount;i++){
+    dist = fabs(hull_dist(&faces[f], &lss[i]));
+    if(dist > best){ best = dist; i3 = i; }
+  }
+  if(i3 < 0){
+    post("define-loudspeakers: loudspeakers are not spread in 3-D",0);
+    goto done;
+  }
+  if(hull_dist(&faces[f], &lss[i3]) > 0.0){ // fourth loudspeaker has to be behind the first face
+    faces[f].v[1] = i2;
+    faces[f].v[2] = i1;
+    hull_set_plane(&faces[f], lss);
+    k = i1; i1 = i2; i2 = k;
+  }
+  hull_new_face(&faces, &nfaces, &faces_allocated, i0, i3, i1, lss);
+  hull_new_face(&faces, &nfaces, &faces_allocated, i1, i3, i2, lss);
+  hull_new_face(&faces, &nfaces, &faces_allocated, i2, i3, i0, lss);
+  for(f=0;f<4;f++)
+    for(k=0;k<3;k++)
+      for(g=0;g<4;g++)
+        for(j=0;j<3;j++)
+          if(faces[g].v[j] == faces[f].v[(k+1)%3] && faces[g].v[(j+1)%3] == faces[f].v[k])
+            faces[f].adj[k] = g;
+
+  for(i=0;i<ls_amount;i++){
+    if(i == i0 || i == i1 || i == i2 || i == i3)
+      continue;
+    for(f=0;f<4;f++)
+      if(hull_dist(&faces[f], &lss[i]) > HULL_EPSILON){
+        next_outside[i] = faces[f].outside;
+        faces[f].outside = i;
+        break;
+      }
+  }
+
+  /* faces are only ever appended, so one pass reaches every face with
+     loudspeakers outside it */
+  stack = (int *) sysmem_newptr(faces_allocated * sizeof(int));
+  if(stack == NULL){
+    post("define-loudspeakers: out of memory",0);
+    goto done;
+  }
+  stamp = 0;
+  for(f=0;f<nfaces;f++){
+    if(!faces[f].alive || faces[f].outside < 0)
+      continue;
+
+    /* farthest loudspeaker outside this face */
+    best = -1.0;
+    p = -1;
+    for(q=faces[f].outside;q>=0;q=next_outside[q]){
+      dist = hull_dist(&faces[f], &lss[q]);
+      if(dist > best){ best = dist; p = q; }
+    }
+
+    /* faces visible from p and the horizon around them */
+    if(sysmem_ptrsize(stack) < faces_allocated * sizeof(int)){
+      int *s = (int *) sysmem_resizeptr(stack, faces_allocated * sizeof(int));
+      if(s == NULL){
+        post("define-loudspeakers: out of memory",0);
+        goto done;
+      }
+      stack = s;
+    }
+    stamp++;
+    nvisible = 0;
+    nhorizon = 0;
+    faces[f].visited = stamp;
+    stack[nvisible++] = f;
+    for(j=0;j<nvisible;j++){
+      fp = &faces[stack[j]];
+      for(k=0;k<3;k++){
+        g = fp->adj[k];
+        if(faces[g].visited == stamp)
+          continue;
+        if(hull_dist(&faces[g], &lss[p]) > HULL_EPSILON){
+          faces[g].visited = stamp;
+          stack[nvisible++] = g;
+        } else {
+          horizon[3*nhorizon] = fp->v[k];
+          horizon[3*nhorizon+1] = fp->v[(k+1)%3];
+          horizon[3*nhorizon+2] = g;
+          nhorizon++;
+        }
+      }
+    }
+
+    /* cone of new faces from the horizon to p */
+    for(j=0;j<nhorizon;j++){
+      int a = horizon[3*j], b = horizon[3*j+1];
+      g = hull_new_face(&faces, &nfaces, &faces_allocated, a, b, p, lss);
+      if(g < 0){
+        post("define-loudspeakers: out of memory",0);
+        goto done;
+      }
+      faces[g].adj[0] = horizon[3*j+2];
+      fp = &faces[horizon[3*j+2]];
+      for(k=0;k<3;k++)
+        if(fp->v[k] == b && fp->v[(k+1)%3] == a)
+          fp->adj[k] = g;
+      new_face_at[a] = g;
+    }
+    for(j=0;j<nhorizon;j++){
+      g = new_face_at[horizon[3*j]];
+      faces[g].adj[1] = new_face_at[horizon[3*j+1]];
+      faces[new_face_at[horizon[3*j+1]]].adj[2] = g;
+    }
+
+    /* hand the remaining outside loudspeakers over to the new faces */
+    for(j=0;j<nvisible;j++){
+      fp = &faces[stack[j]];
+      fp->alive = 0;
+      q = fp->outside;
+      while(q >= 0){
+        int next = next_outside[q];
+        if(q != p)
+          for(k=0;k<nhorizon;k++){
+            g = new_face_at[horizon[3*k]];
+            if(hull_dist(&faces[g], &lss[q]) > HULL_EPSILON){
+              next_outside[q] = faces[g].outside;
+              faces[g].outside = q;
+              break;
+            }
+          }
+        q = next;
+      }
+      fp->outside = -1;
+    }
+    for(j=0;j<nhorizon;j++)
+      new_face_at[horizon[3*j]] = -1;
+  }
+
+  /* collect usable faces as sorted triplets */
+  triplets = (int *) sysmem_newptr(3 * nfaces * sizeof(int));
+  if(triplets == NULL){
+    post("define-loudspeakers: out of memory",0);
+    goto done;
+  }
+  ntriplets = 0;
+  for(f=0;f<nfaces;f++){
+    int *t = &triplets[3*ntriplets];
+    fp = &faces[f];
+    if(!fp->alive || fp->d <= HULL_EPSILON)
+      continue;
+    if(vol_p_side_lgth(fp->v[0], fp->v[1], fp->v[2], lss) <= MIN_VOL_P_SIDE_LGTH)
+      continue;
+    t[0] = fp->v[0]; t[1] = fp->v[1]; t[2] = fp->v[2];
+    if(t[0] > t[1]){ k = t[0]; t[0] = t[1]; t[1] = k; }
+    if(t[1] > t[2]){ k = t[1]; t[1] = t[2]; t[2] = k; }
+    if(t[0] > t[1]){ k = t[0]; t[0] = t[1]; t[1] = k; }
+    ntriplets++;
+  }
+  qsort(triplets, ntriplets, 3 * sizeof(int), hull_compare_triplets);
+
+  tail = NULL;
+  for(i=0;i<ntriplets;i++){
+    trip_ptr = (struct t_ls_set*) getbytes (sizeof (struct t_ls_set));
+    trip_ptr->next = NULL;
+    trip_ptr->ls_nos[0] = triplets[3*i];
+    trip_ptr->ls_nos[1] = triplets[3*i+1];
+    trip_ptr->ls_nos[2] = triplets[3*i+2];
+    if(tail == NULL)
+      x->x_ls_set = trip_ptr;
+    else
+      tail->next = trip_ptr;
+    tail = trip_ptr;
+  }
+  x->x_triplets_specified=1;
+
+done:
+  if(faces) sysmem_freeptr(faces);
+  if(next_outside) sysmem_freeptr(next_outside);
+  if(new_face_at) sysmem_freeptr(new_face_at);
+  if(horizon) sysmem_freeptr(horizon);
+  if(stack) sysmem_freeptr(stack);
+  if(triplets) sysmem_freeptr(triplets);
+}
+
 
 int any_ls_inside_triplet(int a, int b, int c,t_ls lss[MAX_LS_AMOUNT],int ls_amount)
    /* returns 1 if there is loudspeaker(s) inside given ls triplet */
@@ -688,7 +1074,11 @@ void  calculate_3x3_matrixes(t_def_ls *x)
   }
   tr_ptr = x->x_ls_set;
   list_length= triplet_amount * 21 + 3;
-  at= (Atom *) getbytes(list_length*sizeof(Atom));
+  at= (Atom *) sysmem_newptr(list_length*sizeof(Atom));
+  if(at == NULL){
+    post("define-loudspeakers: out of memory",0);
+    return;
+  }
   
   SETLONG(&at[0], x->x_dimension);
   SETLONG(&at[1], x->x_ls_amount);
@@ -735,7 +1125,7 @@ void  calculate_3x3_matrixes(t_def_ls *x)
     tr_ptr = tr_ptr->next;
   }
   outlet_anything(x->x_outlet0, gensym("loudspeaker-matrices"), list_length, at);
-  freebytes(at, list_length*sizeof(Atom));
+  sysmem_freeptr(at);
 }
 
 
@@ -748,10 +1138,10 @@ void choose_ls_tuplets(t_def_ls *x)
   int i,j,k;
   float w1,w2;
   float p1,p2;
-  int sorted_lss[MAX_LS_AMOUNT];
-  int exist[MAX_LS_AMOUNT];   
+  int *sorted_lss;
+  int *exist;   
   int amount=0;
-  float inv_mat[MAX_LS_AMOUNT][4];  // In 2-D ls amount == max amount of LS pairs
+  float (*inv_mat)[4];  // In 2-D ls amount == max amount of LS pairs
   float *ptr;   
   float *ls_table;
   t_ls *lss = x->x_ls;
@@ -760,7 +1150,14 @@ void choose_ls_tuplets(t_def_ls *x)
   Atom *at;
   long pointer;
   
-  for(i=0;i<MAX_LS_AMOUNT;i++){
+  sorted_lss = (int *) sysmem_newptr(ls_amount * sizeof(int));
+  exist = (int *) sysmem_newptr(ls_amount * sizeof(int));
+  inv_mat = (float (*)[4]) sysmem_newptr(ls_amount * 4 * sizeof(float));
+  if(sorted_lss == NULL || exist == NULL || inv_mat == NULL){
+    post("define-loudspeakers: out of memory",0);
+    goto done;
+  }
+  for(i=0;i<ls_amount;i++){
     exist[i]=0;
   }
 
@@ -793,7 +1190,11 @@ void choose_ls_tuplets(t_def_ls *x)
   
   // Output
   list_length= amount * 6 + 2;
-  at= (Atom *) getbytes(list_length*sizeof(Atom));
+  at= (Atom *) sysmem_newptr(list_length*sizeof(Atom));
+  if(at == NULL){
+    post("define-loudspeakers: out of memory",0);
+    goto done;
+  }
   
   SETLONG(&at[0], x->x_dimension);
   SETLONG(&at[1], x->x_ls_amount);
@@ -822,7 +1223,12 @@ void choose_ls_tuplets(t_def_ls *x)
     }
   }
   outlet_anything(x->x_outlet0, gensym("loudspeaker-matrices"), list_length, at);
-  freebytes(at, list_length*sizeof(Atom));
+  sysmem_freeptr(at);
+
+done:
+  if(sorted_lss) sysmem_freeptr(sorted_lss);
+  if(exist) sysmem_freeptr(exist);
+  if(inv_mat) sysmem_freeptr(inv_mat);
 }
 
 void sort_2D_lss(t_ls lss[MAX_LS_AMOUNT], int sorted_lss[MAX_LS_AMOUNT], 
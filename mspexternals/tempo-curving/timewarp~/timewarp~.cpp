@@ -60,6 +60,7 @@
   VERSION 1.6.9: scaletofit now takes function numbers to operate on and defaults to operating on all of them.  
   VERSION 1.6.10: /function/* can be used to address the parameters of all functions
   VERSION 1.6.11: minor bug fixes and outlets are now labeled
+  VERSION 1.7: functions are compiled into segment tables for the perform routine, which only computes the functions that are read
   @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@ 
 */
 
@@ -137,8 +138,6 @@
 #define RANGE_SELECT 1
 #define BOX_SELECT 2
 
-#define DOWNSAMPLE 1
-
 #define POSITION_UPDATE_RATE_MS 100
 
 typedef struct _osc_point{
@@ -233,6 +232,14 @@ typedef struct _plan{
  	struct _plan *prev; 
 } t_plan; 
 
+// A function compiled for the perform routine: the plan for every segment, sorted by
+// start time, so finding the plan for a given time is a binary search instead of a
+// walk through the list of points.  Built by te_compileFunction().
+typedef struct _segtable{
+	int nplans;
+	t_plan *plans;
+} t_segtable;
+
 typedef struct _te{ 
  	t_pxjbox box; 
  	void *out_osc, *out_cellblock;
@@ -249,8 +256,14 @@ typedef struct _te{
 	int muteFunctions[MAX_NUM_FUNCTIONS];
 	int lockFunctions[MAX_NUM_FUNCTIONS];
 	t_jrgba functionColors[MAX_NUM_FUNCTIONS];
-	t_plan *plans;  // used in the perform routine only
-	int dirty; // set this to non-zero to indicate that a point has been added
+	t_segtable *segtables[MAX_NUM_FUNCTIONS];  // used in the perform routine only
+	int planIndex[MAX_NUM_FUNCTIONS]; // the segment each function was in at the end of the last vector
+	int evaluated[MAX_NUM_FUNCTIONS]; // non-zero if the function was computed on the last vector
+	t_segtable *pendingSegtables[MAX_NUM_FUNCTIONS]; // compiled, but not yet picked up by the perform routine
+	t_segtable *retiredSegtables[MAX_NUM_FUNCTIONS]; // swapped out by the perform routine, freed by te_compile()
+	t_critical segtable_lock; // only ever held long enough to swap the pointers above
+	void *compile_qelem;
+	int dirty; // bit i is set when function i has been edited and needs to be recompiled
 	double time_min, time_max;
 	double freq_min, freq_max;
 	double error_span, error_offset; // these are the defaults that will be used when a new point is created
@@ -374,7 +387,15 @@ t_osc_point _osc_point = (t_osc_point){
 void te_paint(t_te *x, t_object *patcherview); 
 t_int *te_perform(t_int *w);
 int te_makePlan(t_te *x, float f, int function, t_plan *plan);
+void te_fillPlan(t_te *x, int state, t_point *p, t_point *next, int pointnum, t_plan *plan);
 int te_isPlanValid(t_te *x, double time, t_plan *plan, int function);
+t_segtable *te_compileFunction(t_te *x, int function);
+void te_compile(t_te *x);
+void te_freeSegtable(t_segtable *st);
+void te_pickupSegtables(t_te *x);
+int te_findPlan(t_segtable *st, double t);
+int te_isFunctionRead(t_te *x, int function);
+void te_evaluate(t_te *x, int function, int n, t_float *in);
 void te_computePhaseError(t_te *x, t_plan *plan);
 double te_betaPDF(double z, double a, double b, double beta_ab);
 double te_betaCDF(double z, double a, double b, double beta_ab);
@@ -485,6 +506,7 @@ void te_clearRangeForAllFunctions(t_te *x, float timemin, float timemax);
 void te_clearCurrent(t_te *x);
 void te_doClearFunction(t_te *x, int f);
 void te_resetFunctionColors(t_te *x);
+void te_invalidateFunction(t_te *x, int f);
 void te_invalidateAllFunctions(t_te *x);
 void te_invalidateAll(t_te *x);
 void te_dsp(t_te *x, t_signal **sp, short *count);
@@ -1322,63 +1344,69 @@ void te_dspstate(t_te *x, long state){
 	}
 }
 
-void te_workerproc(t_sysparallel_worker *worker){
-	t_te *x = *((t_te **)(worker->data));
-	t_int *w = x->w;
-	int n = (int)w[2];
-	t_float *in = (t_float *)w[3];
+// the signal outlets only carry the current function.  the others can only be 
+// read through the bkout_ names, which we only register when we have a name.
+int te_isFunctionRead(t_te *x, int function){
+	return function == x->currentFunction || x->name != NULL;
+}
 
-	int numfunctions = x->numFunctions;
-	int id = worker->id;
+// computes the five signals for one function into x->ptrs.  called from the perform
+// routine, or from a worker thread with one function per worker.
+void te_evaluate(t_te *x, int function, int n, t_float *in){
+	t_float *out_phase_wrapped = x->ptrs[function * 5];
+	t_float *out_phase = x->ptrs[function * 5 + 1];
+	t_float *out_bps = x->ptrs[function * 5 + 2];
+	t_float *out_pointnum = x->ptrs[function * 5 + 3];
+	t_float *out_beatnum = x->ptrs[function * 5 + 4];
+	t_segtable *st = x->segtables[function];
 	int i;
-	int muted[MAX_NUM_FUNCTIONS];
-	memcpy(muted, x->muteFunctions, MAX_NUM_FUNCTIONS * sizeof(int));
 
-	x->last_x = in[0];
-	if(x->functions[id] == NULL || muted[id]){
-		memset(x->ptrs[(id * 5)], 0, n * sizeof(t_float));
-		memset(x->ptrs[(id * 5) + 1], 0, n * sizeof(t_float));
-		memset(x->ptrs[(id * 5) + 2], 0, n * sizeof(t_float));
-		memset(x->ptrs[(id * 5) + 3], 0, n * sizeof(t_float));
-		memset(x->ptrs[(id * 5) + 4], 0, n * sizeof(t_float));
+	if(!st || st->nplans == 0 || x->muteFunctions[function]){
+		memset(out_phase_wrapped, 0, n * sizeof(t_float));
+		memset(out_phase, 0, n * sizeof(t_float));
+		memset(out_bps, 0, n * sizeof(t_float));
+		memset(out_pointnum, 0, n * sizeof(t_float));
+		memset(out_beatnum, 0, n * sizeof(t_float));
+		x->evaluated[function] = 0;
+		return;
+	}
+
+	int k = x->planIndex[function];
+	float last_y = x->last_y[function];
+	for(i = 0; i < n; i++){
+		double t = in[i];
+		if(t != t){
+			out_phase_wrapped[i] = out_phase[i] = out_bps[i] = out_pointnum[i] = out_beatnum[i] = 0.;
+			continue;
+		}
+		// usually we're still in the same segment as the last sample
+		if((k > 0 && t < st->plans[k].startTime) || (k < st->nplans - 1 && t >= st->plans[k + 1].startTime)){
+			k = te_findPlan(st, t);
+		}
+		t_plan *plan = st->plans + k;
+		out_phase[i] = te_computeCorrectedPhase(t, plan);
+		out_phase_wrapped[i] = out_phase[i] - floor(out_phase[i]);
+		out_bps[i] = (out_phase[i] - last_y) * x->fs;
+		last_y = out_phase[i];
+		out_pointnum[i] = plan->pointnum_left;
+		out_beatnum[i] = floorf(out_phase[i]);
+	}
+	// the tempo is a difference, so if we didn't compute the last vector,
+	// the first sample of this one is garbage.
+	if(!x->evaluated[function] && n > 1){
+		out_bps[0] = out_bps[1];
+	}
+	x->last_y[function] = last_y;
+	x->planIndex[function] = k;
+	x->evaluated[function] = 1;
+}
+
+void te_workerproc(t_sysparallel_worker *worker){
+	t_te *x = *((t_te **)(worker->data));
+	t_int *w = x->w;
+	if(te_isFunctionRead(x, worker->id)){
+		te_evaluate(x, worker->id, (int)w[2], (t_float *)w[3]);
 	}
-	t_plan plan;
-	//te_critical_enter(x->lock, __LINE__);
-	plan = x->plans[id];
-	//te_critical_exit(x->lock, __LINE__);
-	int ret = 0;
-	int j;
-	for(i = 0; i < n; i += DOWNSAMPLE){
-		if(te_isPlanValid(x, in[i], &plan, id) == 0 || plan.valid == 0){
-			ret = te_makePlan(x, in[i], id, &plan);
-		}
-		if(ret || plan.valid == 0){
-			x->ptrs[(id * 5)][i] = 0.;
-			x->ptrs[(id * 5) + 1][i] = 0.;
-			x->ptrs[(id * 5) + 2][i] = 0.;
-			x->ptrs[(id * 5) + 3][i] = 0.;
-			x->ptrs[(id * 5) + 4][i] = 0.;
-		}else{
-			x->ptrs[(id * 5) + 1][i] = te_computeCorrectedPhase(in[i], &plan);
-			x->ptrs[(id * 5)][i] = x->ptrs[(id * 5) + 1][i] - floor(x->ptrs[(id * 5) + 1][i]);
-			x->ptrs[(id * 5) + 2][i] = (x->ptrs[(id * 5) + 1][i] - x->last_y[id]) * x->fs;
-			//x->ptrs[(id * 5) + 2][i] = te_computeCorrectedTempo(in[i], &plan);
-			x->last_y[id] = x->ptrs[(id * 5) + 1][i];
-			x->ptrs[(id * 5) + 3][i] = plan.pointnum_left;
-			x->ptrs[(id * 5) + 4][i] = floorf(x->ptrs[(id * 5) + 1][i]);
-		}
-
-		for(j = 1; j < DOWNSAMPLE; j++){
-			x->ptrs[(id * 5) + j][i + 1] = x->ptrs[(id * 5) + 1][i];
-			x->ptrs[(id * 5)][i + j] = x->ptrs[(id * 5)][i];
-			x->ptrs[(id * 5) + 2][i + j] = x->ptrs[(id * 5) + 2][i];
-			x->ptrs[(id * 5) + 3][i + j] = plan.pointnum_left;
-			x->ptrs[(id * 5) + 4][i + j] = x->ptrs[(id * 5) + 4][i];
-		}
-	}
-	//te_critical_enter(x->lock, __LINE__);
-	x->plans[id] = plan;
-	//te_critical_exit(x->lock, __LINE__);
 }
 
 void te_run(t_te *x){
@@ -1395,16 +1423,32 @@ void te_run(t_te *x){
 
 t_int *te_perform(t_int *w){
 	t_te *x = (t_te *)w[1];
-	x->w = w;
-	te_run(x);
-
+	int n = (int)w[2];
+	t_float *in = (t_float *)w[3];
 	t_float *out_phase_wrapped = (t_float *)w[4];
 	t_float *out_phase = (t_float *)w[5];
 	t_float *out_bps = (t_float *)w[6];
 	t_float *out_pointnum = (t_float *)w[7];
 	t_float *out_beatnum = (t_float *)w[8];
+	int j, nread = 0;
 
-	int n = (int)w[2];
+	te_pickupSegtables(x);
+	x->last_x = in[0];
+
+	for(j = 0; j < x->numFunctions; j++){
+		if(te_isFunctionRead(x, j)){
+			nread++;
+		}else{
+			x->evaluated[j] = 0;
+		}
+	}
+	// only worth waking up the workers if there's more than one function to compute
+	if(nread > 1){
+		x->w = w;
+		te_run(x);
+	}else{
+		te_evaluate(x, x->currentFunction, n, in);
+	}
 
 	memcpy(out_phase_wrapped, x->ptrs[x->currentFunction * 5], n * sizeof(t_float));
 	memcpy(out_phase, x->ptrs[x->currentFunction * 5 + 1], n * sizeof(t_float));
@@ -1537,40 +1581,13 @@ int te_makePlan(t_te *x, float f, int function, t_plan *plan){
 	jbox_get_rect_for_view((t_object *)x, x->pv, &r); 
 	double f_sc = te_scale(f, x->time_min, x->time_max, 0, r.width);
 	t_point *p = x->functions[function];
-	t_point *next = NULL;
-	if(p){
-		next = p->next;
-	}else{
-		memset(plan, 0, sizeof(plan));
-		return 1;
-	}
+	t_point *next = p->next;
 
 	// we are somewhere between the minimum time (probably 0) and the first
 	// point.  so we'll make a plan with a freq of 0.
 	double scx = te_scale(p->coords.x, x->time_min, x->time_max, 0, r.width);
 	if(f_sc < scx){
-		plan->alpha = p->alpha;
-		plan->beta = p->beta;
-		plan->beta_ab = boost::math::beta(plan->alpha, plan->beta);
-		plan->error_alpha = p->error_alpha;
-		plan->error_beta = p->error_beta;
-		plan->error_beta_ab = boost::math::beta(plan->error_alpha, plan->error_beta);
-		plan->state = BEFORE_FIRST_POINT;
-		plan->startTime = x->time_min;
-		plan->endTime = p->coords.x;
-		plan->startFreq = 0.;
-		plan->endFreq = 0.;
-		plan->startPhase = p->a_phase;
-		// we don't want to introduce any phase error here that would cause the 
-		// algorithm to try to compensate for it.
-		plan->endPhase = p->a_phase; 
-		te_computePhaseError(x, plan);
-		plan->correctionStart = te_scale(p->aux_points[0], 0, 1., plan->startTime, plan->endTime);
-		plan->correctionEnd = te_scale(p->aux_points[1], 0, 1., plan->startTime, plan->endTime);
-		//te_postPlan(plan);
-		plan->pointnum_left = 0;
-		plan->pointnum_right = 1;
-		plan->valid = 1;
+		te_fillPlan(x, BEFORE_FIRST_POINT, p, NULL, 0, plan);
 		return 0;
 	}
 
@@ -1579,28 +1596,7 @@ int te_makePlan(t_te *x, float f, int function, t_plan *plan){
 		double scx = te_scale(p->coords.x, x->time_min, x->time_max, 0, r.width);
 		double nscx = te_scale(next->coords.x, x->time_min, x->time_max, 0, r.width);
 		if(f_sc >= scx && f_sc < nscx){
-			//printf("f_sc = %f, scx = %f, nscx = %f\n", f_sc, scx, nscx);
-			plan->alpha = p->alpha;
-			plan->beta = p->beta;
-			plan->beta_ab = boost::math::beta(plan->alpha, plan->beta);
-			plan->error_alpha = p->error_alpha;
-			plan->error_beta = p->error_beta;
-			plan->error_beta_ab = boost::math::beta(plan->error_alpha, plan->error_beta);
-			plan->state = 0;
-			plan->startTime = p->coords.x;
-			//printf("%s: time = %f %f\n", __PRETTY_FUNCTION__, p->coords.x, next->coords.x);
-			plan->endTime = next->coords.x;
-			plan->startFreq = p->d_freq;
-			plan->endFreq = next->coords.y;
-			plan->startPhase = p->d_phase;
-			plan->endPhase = next->a_phase;
-			te_computePhaseError(x, plan);
-			plan->correctionStart = te_scale(p->aux_points[0], 0, 1., plan->startTime, plan->endTime);
-			plan->correctionEnd = te_scale(p->aux_points[1], 0, 1., plan->startTime, plan->endTime);
-			//te_postPlan(plan);
-			plan->pointnum_left = counter;
-			plan->pointnum_right = counter + 1;
-			plan->valid = 1;
+			te_fillPlan(x, 0, p, next, counter, plan);
 			return 0;
 		}
 		counter++;
@@ -1611,13 +1607,36 @@ int te_makePlan(t_te *x, float f, int function, t_plan *plan){
 	// if we made it here, we're somewhere between the last point and time_max
 	scx = te_scale(p->coords.x, x->time_min, x->time_max, 0., r.width);
 	if(f_sc >= scx){
-		plan->alpha = p->alpha;
-		plan->beta = p->beta;
-		plan->beta_ab = boost::math::beta(plan->alpha, plan->beta);
-		plan->error_alpha = p->error_alpha;
-		plan->error_beta = p->error_beta;
-		plan->error_beta_ab = boost::math::beta(plan->error_alpha, plan->error_beta);
-		plan->state = AFTER_LAST_POINT;
+		te_fillPlan(x, AFTER_LAST_POINT, p, NULL, counter, plan);
+		return 0;
+	}
+	return 1;
+}
+
+// fills in the plan for the segment that starts at p, or ends at p if state is
+// BEFORE_FIRST_POINT.  next is the point the segment ends at, and is only used 
+// between two points.
+void te_fillPlan(t_te *x, int state, t_point *p, t_point *next, int pointnum, t_plan *plan){
+	plan->alpha = p->alpha;
+	plan->beta = p->beta;
+	plan->beta_ab = boost::math::beta(plan->alpha, plan->beta);
+	plan->error_alpha = p->error_alpha;
+	plan->error_beta = p->error_beta;
+	plan->error_beta_ab = boost::math::beta(plan->error_alpha, plan->error_beta);
+	plan->state = state;
+	switch(state){
+	case BEFORE_FIRST_POINT:
+		plan->startTime = x->time_min;
+		plan->endTime = p->coords.x;
+		plan->startFreq = 0.;
+		plan->endFreq = 0.;
+		plan->startPhase = p->a_phase;
+		// we don't want to introduce any phase error here that would cause the 
+		// algorithm to try to compensate for it.
+		plan->endPhase = p->a_phase; 
+		te_computePhaseError(x, plan);
+		break;
+	case AFTER_LAST_POINT:
 		plan->startTime = p->coords.x;
 		plan->endTime = plan->startTime;
 		plan->startFreq = p->coords.y;
@@ -1627,16 +1646,137 @@ int te_makePlan(t_te *x, float f, int function, t_plan *plan){
 		// algorithm to try to compensate for it.  this will effectively be a jump to phase and freq 0.
 		plan->endPhase = p->d_phase;
 		plan->phaseError = 0.;
-		plan->correctionStart = te_scale(p->aux_points[0], 0, 1., plan->startTime, plan->endTime);
-		plan->correctionEnd = te_scale(p->aux_points[1], 0, 1., plan->startTime, plan->endTime);
-		//te_postPlan(plan);
-		plan->pointnum_left = counter;
-		plan->pointnum_right = counter;
-		plan->valid = 1;
-		return 0;
+		break;
+	default:
+		plan->startTime = p->coords.x;
+		plan->endTime = next->coords.x;
+		plan->startFreq = p->d_freq;
+		plan->endFreq = next->coords.y;
+		plan->startPhase = p->d_phase;
+		plan->endPhase = next->a_phase;
+		te_computePhaseError(x, plan);
+		break;
+	}
+	plan->correctionStart = te_scale(p->aux_points[0], 0, 1., plan->startTime, plan->endTime);
+	plan->correctionEnd = te_scale(p->aux_points[1], 0, 1., plan->startTime, plan->endTime);
+	//te_postPlan(plan);
+	plan->pointnum_left = pointnum;
+	plan->pointnum_right = (state == AFTER_LAST_POINT) ? pointnum : pointnum + 1;
+	plan->valid = 1;
+	plan->next = plan->prev = NULL;
+}
 
+// flattens a function into the table that the perform routine searches.  segment 0
+// runs up to the first point, segment i starts at point i - 1, and the last one runs
+// from the last point on; each is the plan te_makePlan() would make for a time in
+// that range.  call with x->lock held.
+t_segtable *te_compileFunction(t_te *x, int function){
+	t_point *p;
+	int npoints = 0, i;
+	for(p = x->functions[function]; p; p = p->next){
+		npoints++;
 	}
-	return 1;
+	t_segtable *st = (t_segtable *)malloc(sizeof(t_segtable));
+	if(!st){
+		return NULL;
+	}
+	st->nplans = npoints ? npoints + 1 : 0;
+	st->plans = NULL;
+	if(st->nplans){
+		if(!(st->plans = (t_plan *)malloc(st->nplans * sizeof(t_plan)))){
+			free(st);
+			return NULL;
+		}
+		p = x->functions[function];
+		te_fillPlan(x, BEFORE_FIRST_POINT, p, NULL, 0, st->plans);
+		for(i = 1; p->next; i++, p = p->next){
+			te_fillPlan(x, 0, p, p->next, i, st->plans + i);
+		}
+		te_fillPlan(x, AFTER_LAST_POINT, p, NULL, i, st->plans + i);
+	}
+	return st;
+}
+
+// compiles every function that's been edited since the last time and hands the
+// tables to the perform routine.  runs on the main thread, from the qelem that
+// te_invalidateFunction() sets.
+void te_compile(t_te *x){
+	t_segtable *compiled[MAX_NUM_FUNCTIONS];
+	t_segtable *garbage[MAX_NUM_FUNCTIONS * 2];
+	int i, ngarbage = 0;
+
+	te_critical_enter(x->lock, __LINE__);
+	int dirty = x->dirty;
+	x->dirty = 0;
+	for(i = 0; i < MAX_NUM_FUNCTIONS; i++){
+		compiled[i] = NULL;
+		if(dirty & (1 << i)){
+			if(!(compiled[i] = te_compileFunction(x, i))){
+				object_error((t_object *)x, "out of memory compiling function %d", i);
+			}
+		}
+	}
+	te_critical_exit(x->lock, __LINE__);
+
+	critical_enter(x->segtable_lock);
+	for(i = 0; i < MAX_NUM_FUNCTIONS; i++){
+		if(compiled[i]){
+			// one the perform routine never got to, or the one it replaced last time
+			if(x->pendingSegtables[i]){
+				garbage[ngarbage++] = x->pendingSegtables[i];
+			}
+			if(x->retiredSegtables[i]){
+				garbage[ngarbage++] = x->retiredSegtables[i];
+			}
+			x->pendingSegtables[i] = compiled[i];
+			x->retiredSegtables[i] = NULL;
+		}
+	}
+	critical_exit(x->segtable_lock);
+
+	for(i = 0; i < ngarbage; i++){
+		te_freeSegtable(garbage[i]);
+	}
+}
+
+void te_freeSegtable(t_segtable *st){
+	if(st){
+		if(st->plans){
+			free(st->plans);
+		}
+		free(st);
+	}
+}
+
+// called at the top of the perform routine to swap in whatever te_compile() has
+// published.  the old table is left for te_compile() to free.
+void te_pickupSegtables(t_te *x){
+	int i;
+	critical_enter(x->segtable_lock);
+	for(i = 0; i < MAX_NUM_FUNCTIONS; i++){
+		if(x->pendingSegtables[i]){
+			x->retiredSegtables[i] = x->segtables[i];
+			x->segtables[i] = x->pendingSegtables[i];
+			x->pendingSegtables[i] = NULL;
+			x->planIndex[i] = 0;
+		}
+	}
+	critical_exit(x->segtable_lock);
+}
+
+// the segment that time t falls in: the last one that starts at or before t.
+// segment 0 has no start.
+int te_findPlan(t_segtable *st, double t){
+	int lo = 0, hi = st->nplans - 1;
+	while(lo < hi){
+		int mid = (lo + hi + 1) / 2;
+		if(st->plans[mid].startTime <= t){
+			lo = mid;
+		}else{
+			hi = mid - 1;
+		}
+	}
+	return lo;
 }
 
 int te_isPlanValid(t_te *x, double time, t_plan *plan, int function){
@@ -2068,7 +2208,6 @@ void te_fullPacket(t_te *x, long len, long ptr){
 	}
 	hashtab_chuck(ht);
 
-	memset(x->plans, '\0', MAX_NUM_FUNCTIONS * sizeof(t_plan));
 	te_invalidateAllFunctions(x);
 	jbox_redraw((t_jbox *)x);
 	te_dumpSelectedOSC(x);
@@ -2526,7 +2665,7 @@ void te_applySelectionToAllFunctions(t_te *x){
 	int i;
 	for(i = 0; i < x->numFunctions; i++){
 		te_selectPointsInBox(x, r, x->sel_box, i);
-		jbox_invalidate_layer((t_object *)x, x->pv, l_function_layers[i]);
+		te_invalidateFunction(x, i);
 	}
 	jbox_redraw((t_jbox *)x);
 }
@@ -2586,7 +2725,7 @@ void te_addPointsAtSelectionBoundariesForFunction(t_te *x, int function){
 	}
 	x->selected = p;
 
-	jbox_invalidate_layer((t_object *)x, x->pv, l_function_layers[function]);
+	te_invalidateFunction(x, function);
 	jbox_redraw((t_jbox *)x);
 }
 
@@ -3249,7 +3388,7 @@ void te_repeatSelection(t_te *x){
 		p = p->next_selected;
 	}
 	te_critical_exit(x->lock, __LINE__);
-	jbox_invalidate_layer((t_object *)x, x->pv, l_function_layers[x->currentFunction]);
+	te_invalidateFunction(x, x->currentFunction);
 	jbox_redraw((t_jbox *)x);
 }
 
@@ -3287,7 +3426,7 @@ void te_cut(t_te *x){
 	}
 	te_clipboard->s_thing = (t_object *)selected;
 	critical_exit(te_clipboard_lock);
-	jbox_invalidate_layer((t_object *)x, x->pv, l_function_layers[x->currentFunction]);
+	te_invalidateFunction(x, x->currentFunction);
 	jbox_redraw((t_jbox *)x);
 }
 
@@ -3417,7 +3556,7 @@ void te_pasteAtCoords(t_te *x, double xx, double yy){
 		copy = next;
 	}
 	te_critical_exit(x->lock, __LINE__);
-	jbox_invalidate_layer((t_object *)x, x->pv, l_function_layers[x->currentFunction]);
+	te_invalidateFunction(x, x->currentFunction);
 	jbox_redraw((t_jbox *)x);
 }
 
@@ -3474,7 +3613,7 @@ void te_mouseup(t_te *x, t_object *patcherview, t_pt pt, long modifiers){
 		x->selected->draw_snapline = 0;
 	}
 	//x->sel_box = (t_rect){0., 0., 0., 0.};
-	jbox_invalidate_layer((t_object *)x, x->pv, l_function_layers[x->currentFunction]);
+	te_invalidateFunction(x, x->currentFunction);
 	jbox_redraw((t_jbox *)x);
 
 	struct _mouseup{
@@ -4891,7 +5030,7 @@ void te_clearFunction(t_te *x, int f){
 	te_dumpSelectedOSC(x);
 	
 	te_dumpCellblock(x);
-	jbox_invalidate_layer((t_object *)x, x->pv, l_function_layers[f]);
+	te_invalidateFunction(x, f);
 	jbox_redraw((t_jbox *)x);
 }
 
@@ -4907,7 +5046,7 @@ void te_clearRange(t_te *x, t_symbol *msg, int argc, t_atom *argv){
 		}
 	}
 	te_clearRangeForFunction(x, function, atom_getfloat(ptr), atom_getfloat(ptr + 1));
-	jbox_invalidate_layer((t_object *)x, x->pv, l_function_layers[function]);
+	te_invalidateFunction(x, function);
 	jbox_redraw((t_jbox *)x);
 }
 
@@ -4930,7 +5069,7 @@ void te_clearRangeForAllFunctions(t_te *x, float timemin, float timemax){
 	int i;
 	for(i = 0; i < x->numFunctions; i++){
 		te_clearRangeForFunction(x, i, timemin, timemax);
-		jbox_invalidate_layer((t_object *)x, x->pv, l_function_layers[i]);
+		te_invalidateFunction(x, i);
 	}
 	jbox_redraw((t_jbox *)x);
 }
@@ -4940,13 +5079,12 @@ void te_clearCurrent(t_te *x){
 	te_dumpSelectedOSC(x);
 	
 	te_dumpCellblock(x);
-	jbox_invalidate_layer((t_object *)x, x->pv, l_function_layers[x->currentFunction]);
+	te_invalidateFunction(x, x->currentFunction);
 	jbox_redraw((t_jbox *)x);
 }
 
 void te_doClearFunction(t_te *x, int f){
 	te_critical_enter(x->lock, __LINE__);
-	memset(x->plans + f, '\0', sizeof(t_plan));
 	t_point *p = x->functions[f];
 	t_point *next = p->next;
 	while(p){
@@ -4965,7 +5103,7 @@ void te_resetFunctionColors(t_te *x){
 	int i;
 	for(i = 0; i < x->numFunctions; i++){
 		x->functionColors[i] = (t_jrgba){0., 0., 0., 1.};
-		jbox_invalidate_layer((t_object *)x, x->pv, l_function_layers[i]);
+		te_invalidateFunction(x, i);
 	}
 	t_atom a;
 	atom_setlong(&a, x->currentFunction);
@@ -4986,7 +5124,7 @@ void te_hideFunction(t_te *x, t_symbol *msg, short argc, t_atom *argv){
 		return;
 	}
 	x->hideFunctions[function] = b;
-	jbox_invalidate_layer((t_object *)x, x->pv, l_function_layers[function]);
+	te_invalidateFunction(x, function);
 	jbox_redraw((t_jbox *)x);
 }
 
@@ -5004,7 +5142,7 @@ void te_muteFunction(t_te *x, t_symbol *msg, short argc, t_atom *argv){
 	}
 	x->muteFunctions[function] = b;
 	jbox_invalidate_layer((t_object *)x, x->pv, l_legend);
-	jbox_invalidate_layer((t_object *)x, x->pv, l_function_layers[function]);
+	te_invalidateFunction(x, function);
 	jbox_redraw((t_jbox *)x);
 }
 
@@ -5058,7 +5196,6 @@ void te_mapx(t_te *x, t_symbol *msg, int argc, t_atom *argv){
 	te_domap(x, msg, argc, argv, 0, &sel_box_x, &sel_box_width);
 	//x->sel_box.x = te_scale(sel_box_x, x->time_min, x->time_max, 0., r.width);
 	//x->sel_box.width = sel_box_width;
-	memset(x->plans, '\0', sizeof(t_plan) * x->numFunctions);
 	te_invalidateAll(x);
 	jbox_redraw((t_jbox *)x);
 }
@@ -5075,7 +5212,6 @@ void te_mapy(t_te *x, t_symbol *msg, int argc, t_atom *argv){
 	te_domap(x, msg, argc, argv, 1, &sel_box_y, &sel_box_height);
 	//x->sel_box.y = te_scale(sel_box_y, x->freq_min, x->freq_max, r.height, 0.);
 	//x->sel_box.height = sel_box_height;
-	memset(x->plans, '\0', sizeof(t_plan) * x->numFunctions);
 	te_invalidateAll(x);
 	jbox_redraw((t_jbox *)x);
 }
@@ -5182,7 +5318,7 @@ void te_scaleToFitX(t_te *x, int numfunctions, int *functions){
 			p->coords.x = te_scale(p->coords.x, minx, maxx, x->time_min, x->time_max);
 			p = p->next;
 		}
-		jbox_invalidate_layer((t_object *)x, x->pv, l_function_layers[functions[i]]);
+		te_invalidateFunction(x, functions[i]);
 	}
 	te_dumpSelectedOSC(x);
 	
@@ -5215,7 +5351,7 @@ void te_scaleToFitY(t_te *x, int numfunctions, int *functions){
 			p->d_freq = te_scale(p->d_freq, miny, maxy, x->freq_min, x->freq_max);
 			p = p->next;
 		}
-		jbox_invalidate_layer((t_object *)x, x->pv, l_function_layers[functions[i]]);
+		te_invalidateFunction(x, functions[i]);
 	}
 	te_dumpSelectedOSC(x);
 	
@@ -5244,7 +5380,7 @@ void te_addToFunction(t_te *x, t_symbol *msg, short argc, t_atom *argv){
 	te_dumpSelectedOSC(x);
 	
 	te_dumpCellblock(x);
-	jbox_invalidate_layer((t_object *)x, x->pv, l_function_layers[func]);
+	te_invalidateFunction(x, func);
 	jbox_redraw((t_jbox *)x);
 }
 
@@ -5301,7 +5437,7 @@ void te_setFunctionColor(t_te *x, t_symbol *msg, int argc, t_atom *argv){
 		color.alpha = atom_getfloat(ptr);
 	}
 	x->functionColors[function] = color;
-	jbox_invalidate_layer((t_object *)x, x->pv, l_function_layers[function]);
+	te_invalidateFunction(x, function);
 	jbox_redraw((t_jbox *)x);
 }
 
@@ -5443,10 +5579,20 @@ void te_makeColorForInt(int i, t_jrgb *c){
 	}
 }
 
+// anything that edits a function's points has to come through here (or
+// te_invalidateAllFunctions()) so that the perform routine gets a new table.
+void te_invalidateFunction(t_te *x, int f){
+	jbox_invalidate_layer((t_object *)x, x->pv, l_function_layers[f]);
+	te_critical_enter(x->lock, __LINE__);
+	x->dirty |= 1 << f;
+	te_critical_exit(x->lock, __LINE__);
+	qelem_set(x->compile_qelem);
+}
+
 void te_invalidateAllFunctions(t_te *x){
 	int i;
 	for(i = 0; i < MAX_NUM_FUNCTIONS; i++){
-		jbox_invalidate_layer((t_object *)x, x->pv, l_function_layers[i]);
+		te_invalidateFunction(x, i);
 	}
 }
 
@@ -5524,9 +5670,13 @@ void te_free(t_te *x){
 	if(x->last_y){
 		free(x->last_y);
 	}
-	if(x->plans){
-		free(x->plans);
+	qelem_free(x->compile_qelem);
+	for(i = 0; i < MAX_NUM_FUNCTIONS; i++){
+		te_freeSegtable(x->segtables[i]);
+		te_freeSegtable(x->pendingSegtables[i]);
+		te_freeSegtable(x->retiredSegtables[i]);
 	}
+	critical_free(x->segtable_lock);
 	if(x->update_position_clock){
 		clock_unset(x->update_position_clock);
 		object_free(x->update_position_clock);
@@ -5869,10 +6019,13 @@ void *te_new(t_symbol *s, long argc, t_atom *argv){
 		memset(x->muteFunctions, 0, MAX_NUM_FUNCTIONS * sizeof(int));
 		memset(x->lockFunctions, 0, MAX_NUM_FUNCTIONS * sizeof(int));
 		x->last_y = (float *)calloc(MAX_NUM_FUNCTIONS, sizeof(float));
-		x->plans = (t_plan *)calloc(MAX_NUM_FUNCTIONS, sizeof(t_plan));
  		x->numFunctions = 1; 
  		x->currentFunction = 0; 
 		critical_new(&(x->lock));
+		critical_new(&(x->segtable_lock));
+		x->compile_qelem = qelem_new((t_object *)x, (method)te_compile);
+		// every function needs a table, even an empty one
+		x->dirty = (1 << MAX_NUM_FUNCTIONS) - 1;
 
 		x->ptrs = (t_float **)malloc((MAX_NUM_FUNCTIONS * 5) * sizeof(t_float *));
 		int i;
@@ -5942,6 +6095,7 @@ void *te_new(t_symbol *s, long argc, t_atom *argv){
 						 sizeof(_osc_point.ebeta_typetags) +
 						 sizeof(_osc_point.ebeta_data));
 
+		te_compile(x);
 		
  		jbox_ready((t_jbox *)x); 
 		dsp_setupjbox((t_pxjbox *)x, 1);
@@ -80,6 +80,26 @@ VERSION 1.9.16: Use unsigned bytes in blobs
 
 void *OSC_class;
 t_symbol *ps_gimme, *ps_OSCTimeTag, *ps_FullPacket, *ps_OSCBlob;
+t_symbol *ps_nil, *ps_Infinitum, *ps_BogusString;
+
+/* Every gensym() is permanent: Max never frees a symbol.  Addresses and
+   string arguments of incoming packets go through a small per-object cache
+   first, so repeated strings don't hash into the global table each time, and
+   the "strings" message can keep string arguments out of the table entirely. */
+
+#define SYMBOL_CACHE_SIZE 256		// entries, power of two
+#define SYMBOL_CACHE_NAMELEN 64		// longer strings bypass the cache
+
+enum {
+	STRINGS_SYMBOLS = 0,	// string arguments come out as ordinary symbols (default)
+	STRINGS_BLOBS			// ... as OSCBlob <length> <byte> ..., like blob arguments
+};
+
+typedef struct OSCSymbolCacheEntry {
+	unsigned long hash;
+	t_symbol *sym;
+	char name[SYMBOL_CACHE_NAMELEN];
+} OSCSymbolCacheEntry;
 
 typedef struct openSoundControl {
 	struct object O_ob;
@@ -93,10 +113,15 @@ typedef struct openSoundControl {
 	int writeTypeStrings; // nonzero if this object writes messages with type strings
 	int readTypeStrings;  // if zero, never interpret first argument as a type string
 	int errorreporting;	  // Does this object report errors in the Max window?
+	int stringMode;		  // STRINGS_SYMBOLS or STRINGS_BLOBS
+	OSCSymbolCacheEntry *symbolCache;
+	long symbolLookups;	  // strings this object has handed to gensym()
+	long symbolCacheHits;
 } OSC;
 
 
 void *OSC_new(long arg);
+void OSC_free(OSC *x);
 void OSC_assist(OSC *x, void *b, long m, long a, char *s);
 void OSC_debug (OSC *x);
 void OSC_errorreporting(OSC *x, int yesno);
@@ -110,6 +135,8 @@ void OSC_closeBundleCB (OSC *x);
 void OSC_bang (OSC *x);
 void OSC_readtypestrings(OSC *x, int yesno);
 void OSC_writetypestrings(OSC *x, int yesno);
+void OSC_strings(OSC *x, long mode);
+void OSC_symbolcount(OSC *x);
 void OSC_printcontents (OSC *x);
 void OSC_NewTimeTag(OSC *x, long seconds, long fraction);
 void OSC_ParseFullPacket(OSC *x, long size, long bufptr);
@@ -135,7 +162,7 @@ void strcpy(char *s1, char *s2);
 #endif
 
 int main (void) {	
-        OSC_class = class_new("OpenSoundControl", (method) OSC_new,0L,(short)sizeof(OSC),0L,A_DEFLONG,0);
+        OSC_class = class_new("OpenSoundControl", (method) OSC_new,(method) OSC_free,(short)sizeof(OSC),0L,A_DEFLONG,0);
 
 #ifdef SANITY_CHECK
 	post("*** sizeof(int4byte) = %ld", (long) sizeof(int4byte));
@@ -165,6 +192,8 @@ int main (void) {
 	class_addmethod(OSC_class, (method)OSC_ParseEvilGimme, "gimme", A_GIMME, 0);
 	class_addmethod(OSC_class, (method)OSC_readtypestrings, "readtypestrings", A_LONG, 0);
 	class_addmethod(OSC_class, (method)OSC_writetypestrings, "writetypestrings", A_LONG, 0);
+	class_addmethod(OSC_class, (method)OSC_strings, "strings", A_LONG, 0);
+	class_addmethod(OSC_class, (method)OSC_symbolcount, "symbolcount", 0);
 	
 
 	//finder_addclass("Devices","OpenSoundControl");
@@ -173,6 +202,9 @@ int main (void) {
 	ps_OSCTimeTag = gensym("OSCTimeTag");
 	ps_FullPacket = gensym("FullPacket");
 	ps_OSCBlob = gensym("OSCBlob");
+	ps_nil = gensym("nil");
+	ps_Infinitum = gensym("Infinitum");
+	ps_BogusString = gensym("Bogus_String");
 
 	class_register(CLASS_BOX, OSC_class);
 	version_post_copyright();
@@ -218,6 +250,11 @@ void *OSC_new(long arg) {
 	x->writeTypeStrings = 1;
 	x->readTypeStrings = 1;
 	
+	x->stringMode = STRINGS_SYMBOLS;
+	x->symbolCache = (OSCSymbolCacheEntry *) sysmem_newptrclear(SYMBOL_CACHE_SIZE * sizeof(OSCSymbolCacheEntry));
+	x->symbolLookups = 0;
+	x->symbolCacheHits = 0;
+	
 	OSC_initBuffer(&(x->b), arg, buf);
 #ifdef LAME
 	post("*** Obj %p, buf %p, Buffer %p, size %ld", x, &(x->b), 
@@ -229,6 +266,12 @@ void *OSC_new(long arg) {
 	return (x);
 }
 
+void OSC_free(OSC *x) {
+	if (x->symbolCache) {
+		sysmem_freeptr(x->symbolCache);
+	}
+}
+
 void OSC_assist(OSC *x, void *b, long m, long a, char *dst) {
 	if (m == ASSIST_INLET) {
 		if (a == 0) {
@@ -322,6 +365,21 @@ void OSC_writetypestrings(OSC *x, int yesno) {
 }
 
 
+void OSC_strings(OSC *x, long mode) {
+	if (mode < STRINGS_SYMBOLS || mode > STRINGS_BLOBS) {
+		error("OpenSoundControl: strings %ld: use 0 (symbols) or 1 (blobs)", mode);
+		return;
+	}
+	x->stringMode = mode;
+}
+
+
+void OSC_symbolcount(OSC *x) {
+	post("OpenSoundControl: %ld strings looked up in the symbol table, %ld more found in the object's cache",
+		 x->symbolLookups, x->symbolCacheHits);
+}
+
+
 void OSC_openBundleCB (OSC *x) {
 	if (OSC_openBundle(&(x->b), x->O_timeTagToUse)) {
 		if (x->errorreporting) {
@@ -779,6 +837,8 @@ void OSC_NewTimeTag(OSC *x, long seconds, long fraction) {
 
 int ParseOSCPacket(OSC *x, char *buf, long n, int topLevel);
 static void Smessage(OSC *x, char *address, void *v, long n);
+static t_symbol *OSC_intern(OSC *x, char *string);
+static int OSC_stringArgument(OSC *x, char *string, t_atom *args, int room);
 char *DataAfterAlignedString(char *string, char *boundary); 
 int IsNiceString(char *string, char *boundary);
 #ifdef DONT_HAVE_STRING_LIBRARY
@@ -905,6 +965,71 @@ ParseOSCPacket_Error:
 #define SMALLEST_POSITIVE_FLOAT 0.000001f
 #define MAXARGS 5000
 
+/* gensym() through the object's cache.  Direct mapped: a new string simply
+   replaces whatever hashed to the same entry, so the cache never grows. */
+static t_symbol *OSC_intern(OSC *x, char *string) {
+	unsigned long hash = 5381;
+	int len, i;
+	OSCSymbolCacheEntry *e;
+	t_symbol *s;
+	
+	for (len = 0; string[len] != '\0'; ++len) {
+		hash = hash * 33 + (unsigned char) string[len];
+	}
+	if (x->symbolCache == 0 || len >= SYMBOL_CACHE_NAMELEN) {
+		x->symbolLookups++;
+		return gensym(string);
+	}
+	
+	e = &x->symbolCache[hash & (SYMBOL_CACHE_SIZE-1)];
+	if (e->sym && e->hash == hash) {
+		for (i = 0; i <= len && e->name[i] == string[i]; ++i)
+			;
+		if (i > len) {
+			x->symbolCacheHits++;
+			return e->sym;
+		}
+	}
+	
+	s = gensym(string);
+	x->symbolLookups++;
+	e->hash = hash;
+	e->sym = s;
+	for (i = 0; i <= len; ++i) {
+		e->name[i] = string[i];
+	}
+	return s;
+}
+
+/* Writes a string argument into args according to x->stringMode.  Returns the
+   number of atoms used, or 0 if it doesn't fit in room atoms. */
+static int OSC_stringArgument(OSC *x, char *string, t_atom *args, int room) {
+	int len, i;
+	
+	if (room < 1) {
+		return 0;
+	}
+	
+	switch (x->stringMode) {
+		case STRINGS_BLOBS:
+		for (len = 0; string[len] != '\0'; ++len)
+			;
+		if (len + 2 > room) {
+			return 0;
+		}
+		atom_setsym(&args[0], ps_OSCBlob);
+		atom_setlong(&args[1], len);
+		for (i = 0; i < len; ++i) {
+			atom_setlong(&args[i+2], (long) (unsigned char) string[i]);
+		}
+		return len + 2;
+		
+		default:
+		atom_setsym(&args[0], OSC_intern(x, string));
+		return 1;
+	}
+}
+
 static void Smessage(OSC *x, char *address, void *v, long n) {
     int i, j, k;
     float *floats;
@@ -912,12 +1037,12 @@ static void Smessage(OSC *x, char *address, void *v, long n) {
     char *chars;
     char *string, *nextString, *typeTags, *thisType;
     unsigned char *p;
-    t_symbol *addressSymbol, *argSymbol;
+    t_symbol *addressSymbol;
 	t_atom args[MAXARGS];
 	int numArgs = 0;
 	int tooManyArgs = false;
 	
-	addressSymbol = gensym(address);
+	addressSymbol = OSC_intern(x, address);
 
     /* Go through the arguments a word at a time */
     floats = v;
@@ -976,9 +1101,16 @@ static void Smessage(OSC *x, char *address, void *v, long n) {
 
 	            case 's': case 'S':
 	            if (!IsNiceString(p, typeTags+n)) {
-	            	atom_setsym(&args[numArgs], gensym("Bogus_String"));
+	            	atom_setsym(&args[numArgs], ps_BogusString);
 	            } else {
-	            	atom_setsym(&args[numArgs], gensym(p));
+	            	k = OSC_stringArgument(x, p, &args[numArgs], MAXARGS - numArgs);
+	            	if (k == 0) {
+	            		if (x->errorreporting) {
+	            			post("OpenSoundControl: too many string arguments for encoding");
+	            		}
+	            		return;
+	            	}
+	            	numArgs += k - 1; // increments again at end of loop
 	                p = DataAfterAlignedString(p, typeTags+n);
 	            }
 	            break;
@@ -1025,13 +1157,13 @@ static void Smessage(OSC *x, char *address, void *v, long n) {
 	           	            
 	            case 'N': 
 	            /* Empty lists in max?  I wish!  How about the symbol "nil"? */
-	            atom_setsym(&args[numArgs], gensym("nil"));
+	            atom_setsym(&args[numArgs], ps_nil);
 	            /* Don't touch p */
 	           	break;
 	           	
 	            case 'I': 
 	            /* Infinita in Max?  Ha!  How about the symbol "Infinitum"? */
-	            atom_setsym(&args[numArgs], gensym("Infinitum"));
+	            atom_setsym(&args[numArgs], ps_Infinitum);
 	            /* Don't touch p */
 	           	break;
 
@@ -1068,8 +1200,14 @@ static void Smessage(OSC *x, char *address, void *v, long n) {
 			    i++;
 			} else if (IsNiceString(string, chars+n)) {
 			    nextString = DataAfterAlignedString(string, chars+n);
-			    argSymbol = gensym(string);
-			    atom_setsym(&args[numArgs], argSymbol);
+			    k = OSC_stringArgument(x, string, &args[numArgs], MAXARGS - numArgs);
+			    if (k == 0) {
+			    	if (x->errorreporting) {
+			    		post("OTUDP: no room for string argument; dropping the rest of the message");
+			    	}
+			    	break;
+			    }
+			    numArgs += k - 1;
 			    i += (nextString-string) / 4;
 			} else {
 				// Assume int if nothing looks good.
@@ -56,6 +56,8 @@ VERSION 0.9.4: Force Package Info Generation
 VERSION 1.0: Includes workaround for illegal SDIF files with -1 for the frame size
 VERSION 1.0.1: New outlet bangs when file is read
 VERSION 1.1: For Max 5
+VERSION 1.2: Sorted time index and reader cursors for frame lookup; buffer names in a hash table
+VERSION 1.2.1: No more 32K limit on matrix size
 @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 */
 #define NAME "SDIF-buffer"
@@ -97,14 +99,28 @@ VERSION 1.1: For Max 5
 							             #x, __FILE__, __LINE__); } else {}
 */
 
+/* One entry of the time index: frame times are kept next to the frame
+   pointers so the binary search walks one contiguous array. */
+typedef struct _SDIFframeIndexEntry {
+  sdif_float64 time;
+  SDIFmem_Frame frame;
+} SDIFFrameIndexEntry;
+
 /* This struct contains the "private" data for an SDIF-buffer: */
 typedef struct _SDIFbuffer_private {
   SDIFbuf_Buffer buf;
-  SDIFBuffer *next;	/* For linked list of all buffers, for name lookup */
   int debug;			/* 0 or non-zero for debug mode. */
   void *t_out;
   t_critical lock;
 
+  /* Time index, rebuilt on the first lookup after the buffer changes */
+  SDIFFrameIndexEntry *index;
+  long indexSize;		/* number of frames in the index */
+  long indexAlloc;		/* number of entries allocated */
+  long indexGeneration;	/* buffer generation the index was built for */
+
+  /* Older buffer registered under the same name, see AddNewBuffer */
+  struct _SDIFbuffer *sameName;
 } SDIFBufferPrivate;
 
 
@@ -112,7 +128,7 @@ typedef struct _SDIFbuffer_private {
 t_class *SDIFbuffer_class;
 
 t_symbol *ps_SDIFbuffer, *ps_SDIF_buffer_lookup, *ps_emptysymbol;
-SDIFBuffer *AllTheBuffers;	/* A linked list of all the buffers */
+t_hashtab *AllTheBuffers;	/* All the buffers, keyed by name */
 
 
 /* prototypes for my functions */
@@ -136,6 +152,7 @@ void PrintOneFrame(SDIFmem_Frame f);
 void PrintFrameHeader(SDIF_FrameHeader *fh);
 void PrintMatrixHeader(SDIF_MatrixHeader *mh);
 static SDIFFrameLookupFn ListSearch;
+static SDIFFrameIndexedLookupFn IndexSearch;
 static SDIFFrameInsertFn ListInsert;
 static SDIFFrameDeleteFn ListDelete;  //  NOTE: not implemented (0.8.0)
 static SDIFBufferAccessorFn GetBuffer;
@@ -154,14 +171,15 @@ void SDIFbuffer_writefile(SDIFBuffer *x, t_symbol *fileName);
 
 
 void *my_getbytes(int numBytes) {
-	if (numBytes > SHRT_MAX) {
-			return 0;
+	//  sdif-mem takes 0 to mean out of memory, so an empty matrix still gets a block
+	if (numBytes <= 0) {
+			numBytes = 1;
 	}
-	return (void *) getbytes((short) numBytes);
+	return (void *) sysmem_newptr(numBytes);
 }
 
 void my_freebytes(void *bytes, int size) {
-	freebytes(bytes, (short) size);
+	sysmem_freeptr(bytes);
 }
 
 
@@ -236,6 +254,9 @@ int main(void) {
 	}
 	ps_SDIF_buffer_lookup->s_thing = (void *) MySDIFBufferLookupFunction;
 
+	AllTheBuffers = hashtab_new(0);
+	hashtab_flags(AllTheBuffers, OBJ_FLAG_REF);
+
 	class_register(CLASS_BOX, SDIFbuffer_class);
 	return 0;
 }
@@ -263,12 +284,19 @@ void *SDIFbuffer_new(t_symbol *name, Symbol *filename) {
 	x->FrameDelete = ListDelete;    //  NOTE: this has never actually been implemented (0.8.0)
 	x->BufferAccessor = GetBuffer;
     // <<<<<
+	x->FrameIndexedLookup = IndexSearch;
+	x->generation = 0;
     
 	x->internal = getbytes((short) sizeof(SDIFBufferPrivate));
 	privateStuff = (SDIFBufferPrivate *) x->internal;
 	privateStuff->buf = SDIFbuf_Create();
 	privateStuff->debug = 0;	
 	privateStuff->t_out = bangout(x);
+	privateStuff->index = 0;
+	privateStuff->indexSize = 0;
+	privateStuff->indexAlloc = 0;
+	privateStuff->indexGeneration = -1;
+	privateStuff->sameName = 0;
     
     critical_new(&privateStuff->lock);
     
@@ -290,6 +318,7 @@ void SDIFbuffer_free(SDIFBuffer *x) {
 
     SDIFbuf_Free(privateStuff->buf);
     critical_free(privateStuff->lock);
+    if (privateStuff->index) sysmem_freeptr(privateStuff->index);
     
     
     // maybe lock the buffer delete? not sure if it matters or not (rama, jan 1 2018)
@@ -301,6 +330,7 @@ void SDIFbuffer_doclear(SDIFBuffer *x) {
 	privateStuff = (SDIFBufferPrivate *)x->internal;
     critical_enter(privateStuff->lock);
     SDIFbuf_Clear(privateStuff->buf);
+	SDIFbuffer_FramesChanged(x);
 	x->fileName = 0;
 	x->streamID = 1;
     critical_exit(privateStuff->lock);
@@ -361,6 +391,7 @@ void SDIFbuffer_timeShift(SDIFBuffer *x) {
     
     critical_enter(privateStuff->lock);
 	SDIFbuf_TimeShiftToZero(privateStuff->buf);
+	SDIFbuffer_FramesChanged(x);
     critical_exit(privateStuff->lock);
 
 }
@@ -427,6 +458,7 @@ void ReadStream(SDIFBuffer *x, char *filename, SDIFwhichStreamMode mode, long ar
 
   //  read the requested stream
   r = SDIFbuf_ReadStreamFromOpenFile(privateStuff->buf, f, mode, arg);
+  SDIFbuffer_FramesChanged(x);
 
   if (r == ESDIF_STREAM_NOT_FOUND) {
     post("SDIFbuffer_readstreamnumber: Warning: no frames found with StreamID %ld!",
@@ -601,21 +633,152 @@ SDIFbuf_Buffer GetBuffer(struct _SDIFbuffer *x)
 
 
 static SDIFmem_Frame ListSearch(SDIFBuffer *x, sdif_float64 time, long direction) {
- 	SDIFsearchMode mode;
-	SDIFBufferPrivate *privateStuff;
+	// post("* ListSearch(SDIF-buffer %s, time %f, dir %d)", x->s_myname->s_name, (float) time, direction);
 
-	privateStuff = (SDIFBufferPrivate *) x->internal;
+	return IndexSearch(x, time, direction, 0);
+}
+
+
+/******************** Time index ********************/
+
+/* The frame list is kept in time order by sdif-buf, so walking it to answer
+   a lookup is linear in the length of the buffer.  Instead we keep an array of
+   (time, frame) pairs that is rebuilt from the list on the first lookup after
+   the buffer's generation changes, and binary search in that. */
+
+static int RebuildIndex(SDIFBuffer *x) {
+	SDIFBufferPrivate *privateStuff = (SDIFBufferPrivate *) x->internal;
+	SDIFFrameIndexEntry *e, tmp;
+	SDIFmem_Frame f;
+	long n, i, j;
+
+	for (n = 0, f = SDIFbuf_GetFirstFrame(privateStuff->buf); f != 0; f = f->next) {
+		++n;
+	}
 	
-	// post("* ListSearch(SDIF-buffer %s, time %f, dir %d)", x->s_myname->s_name, (float) time, direction);
+	if (n > privateStuff->indexAlloc) {
+		long alloc = privateStuff->indexAlloc ? privateStuff->indexAlloc : 64;
+		while (alloc < n) alloc *= 2;
+		if (privateStuff->index) sysmem_freeptr(privateStuff->index);
+		privateStuff->index = (SDIFFrameIndexEntry *) sysmem_newptr(alloc * sizeof(SDIFFrameIndexEntry));
+		if (privateStuff->index == 0) {
+			privateStuff->indexAlloc = 0;
+			privateStuff->indexSize = 0;
+			privateStuff->indexGeneration = -1;
+			return 0;
+		}
+		privateStuff->indexAlloc = alloc;
+	}
+	
+	e = privateStuff->index;
+	for (i = 0, f = SDIFbuf_GetFirstFrame(privateStuff->buf); f != 0; f = f->next, ++i) {
+		e[i].time = f->header.time;
+		e[i].frame = f;
+	}
+	
+	/* Legal SDIF has nondecreasing frame times, so this insertion sort is just
+	   a linear check unless the file broke the rules. */
+	for (i = 1; i < n; ++i) {
+		if (e[i].time < e[i-1].time) {
+			tmp = e[i];
+			for (j = i; j > 0 && e[j-1].time > tmp.time; --j) {
+				e[j] = e[j-1];
+			}
+			e[j] = tmp;
+		}
+	}
 
-  if(direction < 0)
-    mode = ESDIF_SEARCH_BACKWARDS;
-  else if (direction == 0)
-    mode = ESDIF_SEARCH_EXACT;
-  else
-    mode = ESDIF_SEARCH_FORWARDS;
-  
-  return SDIFbuf_GetFrame(privateStuff->buf, time, mode);
+	privateStuff->indexSize = n;
+	privateStuff->indexGeneration = x->generation;
+	return 1;
+}
+
+/* Returns the first position in e[0..n] whose time is > t (strict) or >= t
+   (not strict).  With hint >= 0 the search gallops outwards from hint, which
+   costs O(log distance), so queries near the previous answer are O(1). */
+static long IndexBound(SDIFFrameIndexEntry *e, long n, sdif_float64 t, int strict, long hint) {
+	long lo, hi, mid, step;
+
+#define BEFORE_BOUND(i) (strict ? (e[i].time <= t) : (e[i].time < t))
+
+	if (hint < 0) {
+		lo = 0;
+		hi = n;
+	} else {
+		if (hint > n) hint = n;
+		step = 1;
+		if (hint < n && BEFORE_BOUND(hint)) {
+			lo = hi = hint + 1;
+			while (hi < n && BEFORE_BOUND(hi)) {
+				lo = hi + 1;
+				hi += step;
+				step *= 2;
+			}
+			if (hi > n) hi = n;
+		} else {
+			lo = hi = hint;
+			while (lo > 0 && !BEFORE_BOUND(lo - 1)) {
+				hi = lo - 1;
+				lo -= step;
+				step *= 2;
+			}
+			if (lo < 0) lo = 0;
+		}
+	}
+	
+	/* Everything below lo is before the bound, nothing at or above hi is */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (BEFORE_BOUND(mid)) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	
+#undef BEFORE_BOUND
+
+	return lo;
+}
+
+static SDIFmem_Frame IndexSearch(SDIFBuffer *x, sdif_float64 time, long direction, SDIFBufferCursor *cursor) {
+	SDIFBufferPrivate *privateStuff = (SDIFBufferPrivate *) x->internal;
+	SDIFFrameIndexEntry *e;
+	SDIFmem_Frame result = 0;
+	long n, hint, bound;
+
+	critical_enter(privateStuff->lock);
+	
+	if (privateStuff->indexGeneration != x->generation && !RebuildIndex(x)) {
+		/* Out of memory for the index; fall back on walking the list */
+		SDIFsearchMode mode = (direction < 0) ? ESDIF_SEARCH_BACKWARDS :
+							  (direction == 0) ? ESDIF_SEARCH_EXACT : ESDIF_SEARCH_FORWARDS;
+		result = SDIFbuf_GetFrame(privateStuff->buf, time, mode);
+		critical_exit(privateStuff->lock);
+		return result;
+	}
+	
+	e = privateStuff->index;
+	n = privateStuff->indexSize;
+	hint = (cursor && cursor->generation == x->generation) ? cursor->position : -1;
+	
+	if (direction < 0) {
+		// Last frame with time <= the requested time
+		bound = IndexBound(e, n, time, 1, hint);
+		if (bound > 0) result = e[bound-1].frame;
+	} else {
+		// First frame with time >= the requested time
+		bound = IndexBound(e, n, time, 0, hint);
+		if (bound < n && (direction > 0 || e[bound].time == time)) result = e[bound].frame;
+	}
+	
+	if (cursor) {
+		cursor->generation = x->generation;
+		cursor->position = bound;
+	}
+	
+	critical_exit(privateStuff->lock);
+	return result;
 }
 
 
@@ -624,7 +787,10 @@ static int ListInsert(SDIFmem_Frame newf, struct _SDIFbuffer *x) {
 	SDIFresult r;
 
 	privateStuff = (SDIFBufferPrivate *) x->internal;	
+  critical_enter(privateStuff->lock);
   r = SDIFbuf_InsertFrame(privateStuff->buf, newf, FALSE);
+  SDIFbuffer_FramesChanged(x);
+  critical_exit(privateStuff->lock);
   
   return r;
 }
@@ -790,48 +956,57 @@ void SDIFbuffer_NAVcrap(SDIFBuffer *x) {
 
 /********************  Buffer lookup ********************/
 
-/* For now, just a linked list. */
-
-#define Next(buffer) (((SDIFBufferPrivate *)buffer->internal)->next)
-
+/* Every reader resolves its buffer by name on each query, so the buffers
+   live in a hash table keyed by their name symbol.  The table holds the
+   newest buffer of each name; any older one with the same name hangs off its
+   sameName chain and takes its place when it goes away. */
 
 SDIFBuffer *MySDIFBufferLookupFunction(t_symbol *name) {
-	SDIFBuffer *b;
+	SDIFBuffer *b = 0;
 	
-	for (b = AllTheBuffers; b != NULL; b = Next(b)) {
-		if (b->s_myname == name) return b;
+	if (hashtab_lookup(AllTheBuffers, name, (t_object **)&b) != MAX_ERR_NONE) {
+		return 0;
 	}
-	return 0;
+	return b;
 }
 
+#define SameName(buffer) (((SDIFBufferPrivate *)(buffer)->internal)->sameName)
+
 void AddNewBuffer(SDIFBuffer *b) {
-	Next(b) = AllTheBuffers;
-	AllTheBuffers = b;
+	SameName(b) = MySDIFBufferLookupFunction(b->s_myname);
+	hashtab_store(AllTheBuffers, b->s_myname, (t_object *)b);
 }
 
 void DeleteBuffer(SDIFBuffer *goner) {
-	SDIFBuffer *b;
+	SDIFBuffer *b = MySDIFBufferLookupFunction(goner->s_myname);
 
-	if (goner == AllTheBuffers) {
-		AllTheBuffers = Next(goner);
+	if (b == goner) {
+		if (SameName(goner)) {
+			hashtab_store(AllTheBuffers, goner->s_myname, (t_object *)SameName(goner));
+		} else {
+			hashtab_chuckkey(AllTheBuffers, goner->s_myname);
+		}
 		return;
 	}
 	
-	for (b = AllTheBuffers; Next(b) != NULL; b = Next(b)) {
-		if (Next(b) == goner) {
-			Next(b) = Next(goner);
+	for (; b != 0; b = SameName(b)) {
+		if (SameName(b) == goner) {
+			SameName(b) = SameName(goner);
 			return;
 		}
 	}
 }
 
 void PrintAllTheBuffers(void) {
-	SDIFBuffer *b;
+	t_symbol **keys = 0;
+	long nkeys = 0, i;
 	
 	post("All the SDIF-buffers:");
-	for (b = AllTheBuffers; b != NULL; b = Next(b)) {
-		post("  %s", b->s_myname->s_name);
+	hashtab_getkeys(AllTheBuffers, &nkeys, &keys);
+	for (i = 0; i < nkeys; ++i) {
+		post("  %s", keys[i]->s_name);
 	}
+	if (keys) sysmem_freeptr(keys);
 }
 
 
@@ -34,10 +34,21 @@ University of California, Berkeley. Maintenance by Ben Jacobs.
  */
 
 #include <stdio.h>
+#include "ext_atomic.h"
 #include "sdif.h"
 #include "sdif-mem.h"
 #include "sdif-buf.h"
 
+/* A reader's position in an SDIF-buffer's time index.  Readers that query
+   nearby times over and over (scrubbing, playback) keep one of these and pass
+   it to FrameIndexedLookup, which then finds the answer in constant time
+   instead of searching the whole index.  Zero it to start; a stale cursor is
+   harmless, it only costs a full search. */
+typedef struct _SDIFbufferCursor {
+	long generation;	/* buffer generation the position refers to */
+	long position;		/* index position of the previous answer */
+} SDIFBufferCursor;
+
 typedef struct _SDIFbuffer {
  	t_object s_obj;
  	t_symbol *s_myname;
@@ -64,9 +75,23 @@ typedef struct _SDIFbuffer {
  	// was: SDIFBufferAccessorFn *BufferAccessor;
 	SDIFbuf_Buffer (*BufferAccessor)(struct _SDIFbuffer * buf);
 
+	//  1.2: binary search in a sorted time index; see SDIFFrameIndexedLookupFn
+	SDIFmem_Frame (*FrameIndexedLookup)(struct _SDIFbuffer * buf,
+									    sdif_float64 time,
+									    long direction,
+									    SDIFBufferCursor *cursor);
+
+	//  1.2: bumped whenever frames are added, removed or retimed
+	t_int32_atomic generation;
+
   //  only add new stuff at bottom, so we don't have to recompile existing client objects
 } SDIFBuffer;
 
+/* Objects that add frames straight through the sdif-buf.h API (rather than
+   FrameInsert) must call this afterwards so the time index gets rebuilt.
+   They don't hold the buffer's lock, so the bump is atomic. */
+#define SDIFbuffer_FramesChanged(buf) ATOMIC_INCREMENT(&((buf)->generation))
+
 
 
 /* The "SDIF buffer lookup function" turns a max symbol into a pointer to an 
@@ -90,6 +115,16 @@ typedef SDIFmem_Frame (SDIFFrameLookupFn)(struct _SDIFbuffer * buf,
 									    sdif_float64 time,
 									    long direction);
 
+/* An "SDIF Frame Indexed Lookup Function" answers the same question as the
+   SDIF Frame Lookup Function, by binary search in a sorted array of frame times
+   that is rebuilt lazily after the buffer changes.  If cursor is non-zero it is
+   used as a starting hint and updated, so a reader stepping through nearby
+   times pays O(1) per query.  Returns 0 if it doesn't find a frame. */
+typedef SDIFmem_Frame (SDIFFrameIndexedLookupFn)(struct _SDIFbuffer * buf,
+									    sdif_float64 time,
+									    long direction,
+									    SDIFBufferCursor *cursor);
+
 /* An "SDIF Frame Insert Function" inserts a new frame into an SDIF-buffer.  It
    automatically updates the doubly linked list.  
    Returns 0 for success, nonzero for failure.
@@ -58,6 +58,7 @@
   VERSION 1.0: Controllable by a virtual time signal input. tellmeeverything. Better help patch.
   VERSION 1.1: Works for Max 5.
   VERSION 1.3: added next/prev messages (rama 2017).
+  VERSION 1.4: frame lookups go through the SDIF-buffer time index with a per-object cursor
 
   @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 
@@ -169,8 +170,11 @@ typedef struct _SDIFtuples {
     void *clock;
     
     SDIFmem_Frame t_current_frame;
+    long t_current_generation; // buffer generation t_current_frame belongs to
     int t_boundsflag; // -1 if less than beginning or not set, 0 if in middle, 1 if off end
     
+    SDIFBufferCursor t_cursor; // where the last time index lookup landed
+    
 } SDIFtuples;
 
 
@@ -363,6 +367,8 @@ void *SDIFtuples_new(t_symbol *dummy, short argc, t_atom *argv) {
 
     x->t_current_frame = NULL;
     x->t_boundsflag = -1;
+    x->t_cursor.generation = -1;
+    x->t_cursor.position = 0;
     
 	return (x);
 }
@@ -436,6 +442,7 @@ static void SDIFtuples_set(SDIFtuples *x, t_symbol *bufName) {
 	x->t_complainedAboutEmptyBufferAlready = FALSE;
     
     x->t_current_frame = NULL;
+    x->t_cursor.generation = -1;
 
 }
 
@@ -825,6 +832,17 @@ static SDIFmem_Matrix GetNextMatrix(SDIFtuples *x, int step, int *columns, int n
         return NULL;
     }
     
+    //  the buffer was reread or edited since we found f, so find our place again by time
+    if( f && x->t_current_generation != x->t_buffer->generation )
+    {
+        if( !(f = (*(x->t_buffer->FrameIndexedLookup))(x->t_buffer, x->t_time, 0, &x->t_cursor)) )
+            f = (*(x->t_buffer->FrameIndexedLookup))(x->t_buffer, x->t_time, -step, &x->t_cursor);
+        if( !f )
+            boundsflag = -step;
+        x->t_current_frame = f;
+        x->t_current_generation = x->t_buffer->generation;
+    }
+    
     //  what matrixType do we want?
     if (x->t_mainMatrix) {
         SDIFmem_Frame ff;
@@ -936,6 +954,7 @@ static SDIFmem_Matrix GetNextMatrix(SDIFtuples *x, int step, int *columns, int n
     {
         error("empty matrix");
         x->t_current_frame = f;
+        x->t_current_generation = x->t_buffer->generation;
         x->t_time = f->header.time;
         return NULL;
     }
@@ -954,6 +973,7 @@ static SDIFmem_Matrix GetNextMatrix(SDIFtuples *x, int step, int *columns, int n
     //  return result
     x->t_time = f->header.time;
     x->t_current_frame = f;
+    x->t_current_generation = x->t_buffer->generation;
     x->t_boundsflag = 0;
     
     return matrixOut; //  NOTE: caller is responsible for calling SDIFmem_FreeMatrix()
@@ -970,7 +990,7 @@ static SDIFmem_Matrix GetMatrixWithoutInterpolation(SDIFtuples *x,
 	SDIFresult r;
   
 	//  get the frame
-	if(!(f = (*(x->t_buffer->FrameLookup))(x->t_buffer, time, direction))) {
+	if(!(f = (*(x->t_buffer->FrameIndexedLookup))(x->t_buffer, time, direction, &x->t_cursor))) {
 		if ((*(x->t_buffer->FrameLookup))(x->t_buffer, (sdif_float64) VERY_SMALL, 1) == 0) {
 			if (!x->t_complainedAboutEmptyBufferAlready) {
 				object_post((t_object *)x, "* SDIF-tuples: SDIF-buffer %s is empty", x->t_bufferSym->s_name);
@@ -1028,6 +1048,7 @@ static SDIFmem_Matrix GetMatrixWithoutInterpolation(SDIFtuples *x,
 		//  NOTE: caller is responsible for calling SDIFmem_FreeMatrix()
         
         x->t_current_frame = f;
+        x->t_current_generation = x->t_buffer->generation;
 		return matrixOut;
 	}else{
 		return NULL;
@@ -1048,7 +1069,7 @@ static SDIFmem_Matrix GetMatrixWithInterpolation(SDIFtuples *x,
 	sdif_int32 interpParam;
   
 	//  find nearby frame (used as starting point for neighbor value searches)
-	if(!(f = SDIFbuf_GetFrame(x->t_buf, time, ESDIF_SEARCH_BACKWARDS)))
+	if(!(f = (*(x->t_buffer->FrameIndexedLookup))(x->t_buffer, time, -1, &x->t_cursor)))
 		return NULL;
   
 	//  try to find a matrix of desired type in this frame or earlier
@@ -1109,6 +1130,7 @@ static SDIFmem_Matrix GetMatrixWithInterpolation(SDIFtuples *x,
 		}
   
     x->t_current_frame = f;
+    x->t_current_generation = x->t_buffer->generation;
 
 	//  return result
 	//  NOTE: caller is responsible for calling SDIFmem_FreeMatrix()
@@ -70,8 +70,7 @@
 #include <string.h>
 #include <math.h>
 #include <stdint.h>
-#include "fftw3.h"
-//#include "fft.h"
+#include "cnmat_fft.h"
 
 #define OSC 1
 #ifdef OSC
@@ -283,8 +282,8 @@ typedef struct _analyzer {
 	// Buffers
 	t_atom *Buf1;			// buffer 1 : Use buffers of integers to copy faster
 	t_atom *Buf2;			// buffer 2
-	double *BufFFT_in;		// FFT buffer
-	double *BufFFT_out;		// FFT buffer
+	float *BufFFT_in;		// FFT buffer (cnmat_fft layout, MAXBUFSIZE)
+	double *BufFFT_out;		// Spectrum as n/2+1 complex bins
 	double *BufPower;		// Power spectrum buffer
 //	double *WindFFT;		// Window of FFTSize
 	//double *memFFT;		// fft.c memory space
@@ -318,7 +317,7 @@ typedef struct _analyzer {
 	double *lastInputVector;	// Remembered from last analyzer_perform() for debug into
 	long lastInputVectorSize;	// ditto
 
-	fftw_plan fft_plan;
+	t_cnmat_fftplan *fft_plan;
 
 	t_osc_timetag timetag; // the time reported by gettimeofday---used to create timestamps for outgoing OSC packets
 	uint64_t svctr; // the signal vector number---used to create timestamps for outgoing OSC packets
@@ -679,13 +678,12 @@ void analyzer_tick(t_analyzer *x, t_symbol *msg, int argc, t_atom *argv)
 	long i, index=0, cpt;
 	double bark = 0.0, loud = 0.0, bright = 0.0, sumSpectrum = 0.0, SFM = 0.0;
 	critical_enter(x->lock);
-	fftw_plan fft_plan = x->fft_plan;
 	double fs = x->x_Fs;
 	double FFTSize = x->FFTSize;
+	long halfFFTSize = x->FFTSize / 2;
 	int window_index = x->window;
-	double window[argc];
-	memcpy(window, x->windows[window_index], argc * sizeof(double));
-	critical_exit(x->lock);
+	double *window = x->windows[window_index];
+	float *BufFFT_in = x->BufFFT_in;
 	double FsOverFFTSize = fs / FFTSize; // Keep it here since x_Fs may change
 	double FsOverBarkSize = fs / (2.0 * NUMBAND); // Fix that problem in a next version
 	double prod = 1.0, sum = 0.0;
@@ -693,22 +691,33 @@ void analyzer_tick(t_analyzer *x, t_symbol *msg, int argc, t_atom *argv)
 	t_pitchhist *ph;
 
 	// this function is only ever called by the scheduler (via schedule_delay() in the perform
-	// routine), so we don't need to enter a critical section to mess with the data stored
-	// in our struct
-	memset(x->BufFFT_in, '\0', FFTSize * sizeof(double)); // takes care of zero padding
+	// routine), but the fftsize setter swaps the plan and the window from the main thread,
+	// so the transform itself stays in the critical section
+	memset(BufFFT_in, '\0', FFTSize * sizeof(float)); // takes care of zero padding
 	if(window_index == Recta){
 		for(int i = 0; i < argc; i++){
-			x->BufFFT_in[i] = atom_getfloat(argv + i);
+			BufFFT_in[i] = atom_getfloat(argv + i);
 		}
 	}else{
 		for(int i = 0; i < argc; i++){
-			//x->BufFFT_in[i] = atom_getfloat(argv + i) * x->windows[window][i];
-			x->BufFFT_in[i] = atom_getfloat(argv + i) * window[i];
+			BufFFT_in[i] = atom_getfloat(argv + i) * window[i];
 		}
 	}
-	fftw_execute(fft_plan);
+	cnmat_fft_execute(x->fft_plan, BufFFT_in);
+	critical_exit(x->lock);
 
+	// Unpack into n/2+1 complex bins with the usual negative exponent (what the
+	// peak finder below was written against)
 	double *BufFFT = x->BufFFT_out;
+	BufFFT[0] = BufFFT_in[0];
+	BufFFT[1] = 0.0;
+	for (i=1; i<halfFFTSize; i++) {
+		BufFFT[2*i] = BufFFT_in[2*i];
+		BufFFT[2*i+1] = -BufFFT_in[2*i+1];
+	}
+	BufFFT[2*halfFFTSize] = BufFFT_in[1];
+	BufFFT[2*halfFFTSize+1] = 0.0;
+
 	// Squared Absolute
 	for (i=0; i<x->FFTSize; i+=2) {
 		x->BufPower[i/2] = (BufFFT[i] * BufFFT[i]) + (BufFFT[i+1] * BufFFT[i+1]);
@@ -1645,9 +1654,17 @@ void analyzer_fftsize_do_set(t_analyzer *x, long n)
     }
     
     {
+        t_cnmat_fftplan *plan = cnmat_fft_plan_new(n, CNMAT_FFT_REAL_FORWARD), *oldplan;
+        
+        if(!plan){
+            object_error((t_object *)x, "couldn't allocate an FFT of size %d", n);
+            return;
+        }
+        
         critical_enter(x->lock);
         
-        x->fft_plan = fftw_plan_dft_r2c_1d(n, x->BufFFT_in, (fftw_complex*)x->BufFFT_out, FFTW_MEASURE);
+        oldplan = x->fft_plan;
+        x->fft_plan = plan;
         x->FFTSize = n;
         
         analyzer_setBarkBins(x);
@@ -1660,6 +1677,8 @@ void analyzer_fftsize_do_set(t_analyzer *x, long n)
         }
         
         critical_exit(x->lock);
+        
+        cnmat_fft_plan_free(oldplan);
     }
     
         
@@ -1805,8 +1824,8 @@ void analyzer_free(t_analyzer *x)
     
     if (x->Buf1 != NULL) sysmem_freeptr((char *)x->Buf1);
     if (x->Buf2 != NULL) sysmem_freeptr((char *)x->Buf2);
-    if (x->BufFFT_in != NULL) fftw_free((char *)x->BufFFT_in);
-    if (x->BufFFT_out != NULL) fftw_free((char *) x->BufFFT_out);
+    if (x->BufFFT_in != NULL) cnmat_fft_buffer_free(x->BufFFT_in);
+    if (x->BufFFT_out != NULL) sysmem_freeptr((char *) x->BufFFT_out);
     if (x->BufPower != NULL) sysmem_freeptr((char *)x->BufPower);
     if (x->peakBuf != NULL) sysmem_freeptr((char *)x->peakBuf);
     if (x->histBuf != NULL) sysmem_freeptr((char *)x->histBuf);
@@ -1822,7 +1841,7 @@ void analyzer_free(t_analyzer *x)
         }
     }
     
-    fftw_destroy_plan(x->fft_plan);
+    cnmat_fft_plan_free(x->fft_plan);
     
     critical_free(x->lock);
 }
@@ -1890,10 +1909,8 @@ void *analyzer_new(t_symbol *s, short argc, t_atom *argv) {
     x->Buf1 = (t_atom*)sysmem_newptr( (MAXBUFSIZE + 1) * sizeof(t_atom));
     x->Buf2 = (t_atom*)sysmem_newptr( (MAXBUFSIZE + 1) * sizeof(t_atom));
     
-    x->BufFFT_in = (double *)fftw_malloc(sizeof(double) * MAXBUFSIZE);
-    x->BufFFT_out = (double *)fftw_malloc(sizeof(double) * MAXBUFSIZE * 2);
-    memset(x->BufFFT_in, '\0', MAXBUFSIZE * sizeof(double));
-    memset(x->BufFFT_out, '\0', MAXBUFSIZE * 2 * sizeof(double));
+    x->BufFFT_in = cnmat_fft_buffer_new(MAXBUFSIZE);
+    x->BufFFT_out = (double *)sysmem_newptrclear(sizeof(double) * (MAXBUFSIZE + 2));
     
     x->BufPower = (double*) sysmem_newptr((MAXBUFSIZE / 2) * sizeof(double));
     
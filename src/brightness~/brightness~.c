@@ -60,7 +60,7 @@
 #include "version.h"
 
 #include "z_dsp.h"
-#include "fft.h"
+#include "cnmat_fft.h"
 #include <string.h>
 #include <math.h>
 #include <inttypes.h>
@@ -69,11 +69,6 @@
 #include <Accelerate/Accelerate.h> // to get veclib
 #endif
 
-// Add altivec function prototypes
-#ifdef __ALTIVEC__
-#include "vDSP.h"
-#endif
-
 //#define ALTIVEC_ATTEMPT // needed for "d_signal.h"
 #define RES_ID	7077
 #define VERSION "1.3.2"
@@ -116,7 +111,7 @@ typedef struct _brightness {
     t_int *Buf2;			// buffer 2
     t_float *BufFFT;		// FFT buffer
     t_float *WindFFT;		// Window of FFTSize
-    t_float *memFFT;		// fft.c memory space
+    t_cnmat_fftplan *fftplan;	// Shared FFT plan (see lib/cnmat_fft.h)
 
     t_int BufSize;			// FFT buffer size
 	t_int FFTSize;			// Size of FFT
@@ -126,13 +121,6 @@ typedef struct _brightness {
 	void *x_clock;			// Use a clock for outputs... (better than Qelem)
        
 
-#ifdef __ALTIVEC__ // Additional stuff for managing the G4-optimized FFT by Apple
-#pragma altivec_model on
-	uint32_t x_log2n;
-    COMPLEX_SPLIT x_A;
-	FFTSetup x_setup;
-#pragma altivec_model off
-#endif
 		
 } t_brightness;
 
@@ -152,11 +140,6 @@ void *brightness_new(t_symbol *s, short argc, t_atom *argv);
 void brightness_free(t_brightness *x);
 void brightness_tick(t_brightness *x);
 
-#ifdef __ALTIVEC__
-void brightness_tick_G4(t_brightness *x);
-long log2max(long n);
-#endif
-
 
 int main(void){
 
@@ -255,6 +238,8 @@ void brightness_dsp(t_brightness *x, t_signal **sp, short *connect) {
 
 	if (vs > x->BufSize) {
 		object_post((t_object *)x, "Brightness~: You need to use a smaller signal vector size...");
+	} else if (x->fftplan == NULL || x->BufFFT == NULL) {
+		object_error((t_object *)x, "Brightness~: no FFT, not analyzing");
 	} else if (connect[0]) {
 			dsp_add(brightness_perform, 3, sp[0]->s_vec, x, sp[0]->s_n);
 	}
@@ -467,6 +452,7 @@ void *brightness_new(t_symbol *s, short argc, t_atom *argv) {
 	else if ((x->FFTSize > 512) && (x->FFTSize < 1024)) x->FFTSize = 1024;
 	else if ((x->FFTSize > 1024) && (x->FFTSize < 2048)) x->FFTSize = 2048;
 	else if ((x->FFTSize > 2048) && (x->FFTSize < 4096)) x->FFTSize = 4096;
+	else if ((x->FFTSize > 4096) && (x->FFTSize < 8192)) x->FFTSize = 8192;
 	else if ((x->FFTSize > 8192) && (x->FFTSize < 16384)) x->FFTSize = 16384;
 	else if ((x->FFTSize > 16384) && (x->FFTSize < 32768)) x->FFTSize = 32768;
 	else if ((x->FFTSize > 32768) && (x->FFTSize < 65536)) x->FFTSize = 65536;
@@ -474,6 +460,11 @@ void *brightness_new(t_symbol *s, short argc, t_atom *argv) {
 		object_post((t_object *)x, "Brightness~: Maximum FFT size is 65536 samples");
 		x->FFTSize = 65536;
 	}
+	if (x->FFTSize & (x->FFTSize - 1)) { // cnmat_fft only does powers of two
+		for (i = CNMAT_FFT_MINSIZE; i < x->FFTSize; i <<= 1);
+		object_post((t_object *)x, "Brightness~: FFT size rounded up to %d", i);
+		x->FFTSize = i;
+	}
 	
 	// Overlap case
 	if (x->x_overlap > x->BufSize-vs) {
@@ -492,31 +483,14 @@ void *brightness_new(t_symbol *s, short argc, t_atom *argv) {
 	object_post((t_object *)x, "	Window type = %s",x->x_winName);
 	object_post((t_object *)x, "	Initial delay = %d",x->x_delay);
 
-	// Here comes the choice for altivec optimization or not...
-	if (sys_optimize()) { // note that we DON'T divide the vector size by four here
-
-#ifdef __ALTIVEC__ // More code and a new ptr so that x->BufFFT is vector aligned.
-#pragma altivec_model on 
-		x->x_clock = clock_new(x,(method)brightness_tick_G4); // Call altivec-optimized tick function
-		object_post((t_object *)x, "	Using G4-optimized FFT");	
-		// Allocate some memory for the altivec FFT
-		x->x_A.realp = t_getbytes(x->x_FFTSizeOver2 * sizeof(t_float));
-		x->x_A.imagp = t_getbytes(x->x_FFTSizeOver2 * sizeof(t_float));
-		x->x_log2n = log2max(x->FFTSize);
-      	x->x_setup = create_fftsetup (x->x_log2n, 0);
-#pragma altivec_model off
-#else
-		object_error((t_object *)x, "  No G4 optimization available");
-#endif
-
-	} else { // Normal tick function
-		x->x_clock = clock_new(x,(method)brightness_tick);
-		x->memFFT = (t_float*) sysmem_newptr(CMAX * x->FFTSize * sizeof(t_float)); // memory allocated for normal fft twiddle
-	}
+	x->x_clock = clock_new(x,(method)brightness_tick);
+	x->fftplan = cnmat_fft_plan_new(x->FFTSize, CNMAT_FFT_REAL_FORWARD);
+	if (x->fftplan == NULL)
+		object_error((t_object *)x, "Brightness~: can't make an FFT of size %d", x->FFTSize);
 	object_post((t_object *)x, "");
 
 	// Allocate more memory
-	x->BufFFT = (t_float*) sysmem_newptr(x->FFTSize * sizeof(t_float));
+	x->BufFFT = cnmat_fft_buffer_new(x->FFTSize);
 	x->Buf1 = (t_int*) sysmem_newptr(x->BufSize * sizeof(t_float)); // Careful these are pointers to integers but the content is floats
 	x->Buf2 = (t_int*) sysmem_newptr(x->BufSize * sizeof(t_float));
 	x->WindFFT = (t_float*) sysmem_newptr(x->BufSize * sizeof(t_float));
@@ -558,17 +532,9 @@ void  brightness_free(t_brightness *x) {
 
 dsp_free((t_pxobject *)x);
 
-#ifdef __ALTIVEC__
-#pragma altivec_model on
-	if (x->x_A.realp) t_freebytes(x->x_A.realp, x->x_FFTSizeOver2);
-	if (x->x_A.imagp) t_freebytes(x->x_A.imagp, x->x_FFTSizeOver2);
-	if (x->x_setup) destroy_fftsetup(x->x_setup);
-#pragma altivec_model off
-#else
-	if (x->memFFT != NULL) sysmem_freeptr((char *) x->memFFT);
-#endif		
-
-	if (x->BufFFT != NULL) sysmem_freeptr((char *) x->BufFFT);
+	cnmat_fft_plan_free(x->fftplan);
+
+	if (x->BufFFT != NULL) cnmat_fft_buffer_free(x->BufFFT);
 	if (x->Buf1 != NULL) sysmem_freeptr((char *) x->Buf1);
 	if (x->Buf2 != NULL) sysmem_freeptr((char *) x->Buf2);
 	if (x->WindFFT != NULL) sysmem_freeptr((char *) x->WindFFT);
@@ -593,7 +559,7 @@ void brightness_tick(t_brightness *x) {
 			x->BufFFT[i] *= x->WindFFT[i];
 			
 	// FFT
-	fftRealfast(x->FFTSize, x->BufFFT, x->memFFT);
+	cnmat_fft_execute(x->fftplan, x->BufFFT);
 		
 	// Absolute version
 	for (i=2; i<x->FFTSize; i+=2) 
@@ -609,60 +575,3 @@ void brightness_tick(t_brightness *x) {
 
     outlet_float(x->x_outcent, x->x_brightness);
 }
-#ifdef __ALTIVEC__
-void brightness_tick_G4(t_brightness *x) {
-
-	t_float FsOverFFTSize = x->x_Fs/x->FFTSize;
-	t_float sumSpectrum = 0.0f;
-	t_float numerator = 0.0f;
-	t_int i;
-
-	// Zero padding
-	for (i=x->BufSize; i<x->FFTSize; i++)
-		x->BufFFT[i] = 0.0f;
-
-	// Window the samples
-	if (x->x_window != Recta)
-		for (i=0; i<x->BufSize; ++i)
-			x->BufFFT[i] *= x->WindFFT[i];
-
-    // Look at the real signal as an interleaved complex vector by casting it.
-    // Then call the transformation function ctoz to get a split complex vector,
-    // which for a real signal, divides into an even-odd configuration.
-    ctoz ((COMPLEX *) x->BufFFT, 2, &x->x_A, 1, x->x_FFTSizeOver2);
-      
-    // Carry out a Forward FFT transform
-    fft_zrip(x->x_setup, &x->x_A, 1, x->x_log2n, FFT_FORWARD);
-
-    // The output signal is now in a split real form.  Use the function
-    // ztoc to get a split real vector.
-    ztoc ( &x->x_A, 1, (COMPLEX *) x->BufFFT, 2, x->x_FFTSizeOver2);
-		
-	// Squared Absolute
-	for (i=2; i<x->FFTSize; i+=2) 
-		x->BufFFT[i/2] = (x->BufFFT[i] * x->BufFFT[i]) + (x->BufFFT[i+1] * x->BufFFT[i+1]);
-					
-	// brightness
-	for (i=1; i<x->x_FFTSizeOver2; i++) {
-		numerator += (i * x->BufFFT[i]);
-		sumSpectrum += x->BufFFT[i];
-	}
-	if (sumSpectrum <= 0.0f) x->x_brightness = 0.0f;
-	else x->x_brightness = (numerator * FsOverFFTSize) / sumSpectrum;
-
-    outlet_float(x->x_outcent, x->x_brightness);
-}
-#endif
-
-// Computes the ceiling of log2(n) 
-// i.e. log2max(7) = 3, log2max(8) = 3, log2max(9) = 4
-long log2max(long n) {
-	
-	long power = 1;
-	long k = 1;
-	
-	if (n==1) return 0;
-	while ((k <<= 1) < n) power++;
-	
-	return power;
-}
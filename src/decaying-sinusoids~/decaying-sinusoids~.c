@@ -37,6 +37,7 @@ VERSION 0.0: Adrian's initial version
 VERSION 0.0.1: Force Package Info Generation
 VERSION 0.1: min_vtime and max_vtime affect goto.  Also "clear" now doesn't clear the model.
 VERSION 0.2: signal inlet for virtual time.  Also version message.
+VERSION 0.3: No oscillator limit; signal-driven time costs about the same as message-driven time.
 @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@  
 
        	�1988,1989 Adrian Freed
@@ -54,7 +55,15 @@ VERSION 0.2: signal inlet for virtual time.  Also version message.
 #include "ext_obex.h"
 
 #include "z_dsp.h"
+#include "ext_critical.h"
 #include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #include "version.h"
 
@@ -66,12 +75,16 @@ VERSION 0.2: signal inlet for virtual time.  Also version message.
 
 #undef PI
 #define PI 3.14159265358979323f
-#define MAXOSCILLATORS 256
+#define INITOSCILLATORS 256
 
 #define TPOW 14
 #define STABSZ (1l<<TPOW)
 #define LOGBASE2OFTABLEELEMENT 2
 
+// How far (relative) the time signal may stray from a straight line and still
+// be synthesized with the per-sample decay recurrence
+#define LINEARTIMETOL 1e-9
+
 t_class *sinusoids_class;
 
 float Sinetab[STABSZ];
@@ -79,15 +92,18 @@ float Sinetab[STABSZ];
 //typedef  unsigned long ulong;
 
 
-typedef  struct oscdesc
+/* The oscillators, one array per field so that the per-block exp() work can
+   run across oscillators.  "size" is how many the arrays hold, which may be
+   more than are sounding.  When a list needs more, sinusoids_list() builds a
+   bigger bank and hands it to the perform routine through b_next. */
+typedef struct dsbank
 {
-//	float next_amplitude;
-	float amplitude;		/* amplitude */
-	unsigned long phase_current;
-//	long next_phase_inc;
-	long phase_inc;			/* frequency */
-	double gain,rate;
-} oscdesc;
+	long size;
+	unsigned long *phase_current;
+	long *phase_inc;		/* frequency */
+	double *gain, *rate;
+	double *a, *ascale;		/* scratch for the perform routine */
+} t_dsbank;
 
 
 /* bank of oscillators */
@@ -95,7 +111,8 @@ typedef struct
 {
 	t_pxobject b_obj;
 //	short b_connected;
-	oscdesc base[MAXOSCILLATORS];
+	t_dsbank *bank, *b_next, *b_old;
+	t_critical b_lock;
 	int nosc; 
 	float  pk;
 	float samplerate;
@@ -103,6 +120,8 @@ typedef struct
 	double t;		// time machine
 	double rate, stop, backstop;
 	double pulse;
+	double *tbuf, *obuf;	// double copies of the signals for the 32-bit perform routines
+	long bufsize;
 
 } oscbank;
 typedef oscbank t_sinusoids;
@@ -114,9 +133,163 @@ void decayingsinusoids_perform_time_input_signal64(t_sinusoids *x, t_object *dsp
 void sinusoids_dsp64(t_sinusoids *x, t_object *dsp64, short *count, double samplerate, long maxvectorsize, long flags);
 void sinusoids_dsp(t_sinusoids *x, t_signal **sp, short *connect);
  void sinusoids_list(t_sinusoids *x, t_symbol *s, short argc, t_atom *argv);
+void sinusoids_setbank(t_sinusoids *x, t_dsbank *fp, int nosc, short argc, t_atom *argv);
  void sinusoids_clear(t_sinusoids *x);
  void sinusoids_assist(t_sinusoids *x, void *b, long m, long a, char *s);
  void *sinusoids_new(t_symbol *s, short argc, t_atom *argv);
+ void sinusoids_free(t_sinusoids *x);
+t_dsbank *sinusoids_newbank(long size);
+void sinusoids_freebank(t_dsbank *b);
+
+t_dsbank *sinusoids_newbank(long size)
+{
+	t_dsbank *b = (t_dsbank *)sysmem_newptrclear(sizeof(t_dsbank));
+	if(!b){
+		return NULL;
+	}
+	b->size = size;
+	b->phase_current = (unsigned long *)sysmem_newptrclear(size * sizeof(unsigned long));
+	b->phase_inc = (long *)sysmem_newptrclear(size * sizeof(long));
+	b->gain = (double *)sysmem_newptrclear(size * sizeof(double));
+	b->rate = (double *)sysmem_newptrclear(size * sizeof(double));
+	b->a = (double *)sysmem_newptrclear(size * sizeof(double));
+	b->ascale = (double *)sysmem_newptrclear(size * sizeof(double));
+	if(!b->phase_current || !b->phase_inc || !b->gain || !b->rate || !b->a || !b->ascale){
+		sinusoids_freebank(b);
+		return NULL;
+	}
+	return b;
+}
+
+void sinusoids_freebank(t_dsbank *b)
+{
+	if(!b){
+		return;
+	}
+	if(b->phase_current) sysmem_freeptr(b->phase_current);
+	if(b->phase_inc) sysmem_freeptr(b->phase_inc);
+	if(b->gain) sysmem_freeptr(b->gain);
+	if(b->rate) sysmem_freeptr(b->rate);
+	if(b->a) sysmem_freeptr(b->a);
+	if(b->ascale) sysmem_freeptr(b->ascale);
+	sysmem_freeptr(b);
+}
+
+/* y[i] = exp(y[i]).  2^k * p(r) with r = y - k ln2 in [-ln2/2, ln2/2] and p the
+   Taylor series to r^11, good to a few parts in 1e15; arguments are clamped
+   to the range where the result is a normal double. */
+#define EXPCLAMPLO -708.0
+#define EXPCLAMPHI 709.0
+#define EXPLOG2E 1.4426950408889634
+#define EXPLN2HI 6.93147180369123816490e-01
+#define EXPLN2LO 1.90821492927058770002e-10
+
+void sinusoids_expv(double *y, long n)
+{
+	long i = 0;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	const __m128d lo = _mm_set1_pd(EXPCLAMPLO), hi = _mm_set1_pd(EXPCLAMPHI);
+	const __m128d log2e = _mm_set1_pd(EXPLOG2E), ln2hi = _mm_set1_pd(EXPLN2HI), ln2lo = _mm_set1_pd(EXPLN2LO);
+	const __m128i bias = _mm_set1_epi32(1023);
+	for(; i + 2 <= n; i += 2){
+		__m128d x = _mm_min_pd(_mm_max_pd(_mm_loadu_pd(y + i), lo), hi);
+		__m128i k = _mm_cvtpd_epi32(_mm_mul_pd(x, log2e));
+		__m128d kd = _mm_cvtepi32_pd(k);
+		__m128d r = _mm_sub_pd(_mm_sub_pd(x, _mm_mul_pd(kd, ln2hi)), _mm_mul_pd(kd, ln2lo));
+		__m128d p = _mm_set1_pd(1.0 / 39916800.0);
+		p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 3628800.0));
+		p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 362880.0));
+		p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 40320.0));
+		p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 5040.0));
+		p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 720.0));
+		p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 120.0));
+		p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 24.0));
+		p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 6.0));
+		p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(0.5));
+		p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0));
+		p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0));
+		__m128i e = _mm_slli_epi64(_mm_unpacklo_epi32(_mm_add_epi32(k, bias), _mm_setzero_si128()), 52);
+		_mm_storeu_pd(y + i, _mm_mul_pd(p, _mm_castsi128_pd(e)));
+	}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+	const float64x2_t lo = vdupq_n_f64(EXPCLAMPLO), hi = vdupq_n_f64(EXPCLAMPHI);
+	const float64x2_t log2e = vdupq_n_f64(EXPLOG2E), ln2hi = vdupq_n_f64(EXPLN2HI), ln2lo = vdupq_n_f64(EXPLN2LO);
+	for(; i + 2 <= n; i += 2){
+		float64x2_t x = vminq_f64(vmaxq_f64(vld1q_f64(y + i), lo), hi);
+		int64x2_t k = vcvtnq_s64_f64(vmulq_f64(x, log2e));
+		float64x2_t kd = vcvtq_f64_s64(k);
+		float64x2_t r = vfmsq_f64(vfmsq_f64(x, kd, ln2hi), kd, ln2lo);
+		float64x2_t p = vdupq_n_f64(1.0 / 39916800.0);
+		p = vfmaq_f64(vdupq_n_f64(1.0 / 3628800.0), p, r);
+		p = vfmaq_f64(vdupq_n_f64(1.0 / 362880.0), p, r);
+		p = vfmaq_f64(vdupq_n_f64(1.0 / 40320.0), p, r);
+		p = vfmaq_f64(vdupq_n_f64(1.0 / 5040.0), p, r);
+		p = vfmaq_f64(vdupq_n_f64(1.0 / 720.0), p, r);
+		p = vfmaq_f64(vdupq_n_f64(1.0 / 120.0), p, r);
+		p = vfmaq_f64(vdupq_n_f64(1.0 / 24.0), p, r);
+		p = vfmaq_f64(vdupq_n_f64(1.0 / 6.0), p, r);
+		p = vfmaq_f64(vdupq_n_f64(0.5), p, r);
+		p = vfmaq_f64(vdupq_n_f64(1.0), p, r);
+		p = vfmaq_f64(vdupq_n_f64(1.0), p, r);
+		int64x2_t e = vshlq_n_s64(vaddq_s64(k, vdupq_n_s64(1023)), 52);
+		vst1q_f64(y + i, vmulq_f64(p, vreinterpretq_f64_s64(e)));
+	}
+#endif
+	for(; i < n; ++i){
+		y[i] = exp(y[i]);
+	}
+}
+
+/* Add nosc oscillators into out[0..n-1], each starting at amplitude a[i] and
+   multiplied by ascale[i] every sample. */
+void sinusoids_synth(t_dsbank *b, int nosc, double *out, long n)
+{
+	const char *st = (const char *)Sinetab;
+	int i, j;
+
+	for(i=0;i<nosc;++i)
+		{
+			register double a = b->a[i];
+			register double ascale = b->ascale[i];
+			register long pi = b->phase_inc[i];
+			register unsigned long pc = b->phase_current[i];
+			for(j=0;j<n;++j)
+				{
+
+					out[j] +=  a  * 
+						*((float *)(st + (((pc) >> (32-TPOW-LOGBASE2OFTABLEELEMENT))
+								  & ((STABSZ-1)*sizeof(*Sinetab)))));
+					pc +=  pi;
+					a *=ascale;
+
+				}
+			b->phase_current[i] = pc;
+		}
+}
+
+/* Pick up a bank that sinusoids_list() grew since the last vector. */
+t_dsbank *sinusoids_getbank(t_sinusoids *x)
+{
+	if(x->b_next){
+		critical_enter(x->b_lock);
+		if(x->b_next){
+			x->b_old = x->bank;
+			x->bank = x->b_next;
+			x->b_next = NULL;
+		}
+		critical_exit(x->b_lock);
+	}
+	return x->bank;
+}
+
+void sinusoids_advance(t_sinusoids *op, long n)
+{
+	op->t += op->rate*n*op->sampleinterval;
+	if(op->t<op->backstop)
+		op->t = op->backstop;
+	if(op->t>op->stop)
+		op->t = op->stop;
+}
 
 void sinusoids_dsp64(t_sinusoids *x, t_object *dsp64, short *count, double samplerate, long maxvectorsize, long flags)
 {
@@ -131,6 +304,17 @@ void sinusoids_dsp64(t_sinusoids *x, t_object *dsp64, short *count, double sampl
 
 void sinusoids_dsp(t_sinusoids *x, t_signal **sp, short *count)
 {
+	if (x->bufsize < sp[0]->s_n) {
+		if (x->tbuf) sysmem_freeptr(x->tbuf);
+		if (x->obuf) sysmem_freeptr(x->obuf);
+		x->tbuf = (double *)sysmem_newptrclear(sp[0]->s_n * sizeof(double));
+		x->obuf = (double *)sysmem_newptrclear(sp[0]->s_n * sizeof(double));
+		x->bufsize = (x->tbuf && x->obuf) ? sp[0]->s_n : 0;
+		if (!x->bufsize) {
+			object_error((t_object *)x, "out of memory");
+			return;
+		}
+	}
 
 	if (count[0]) {
 		// Signal inlet is connected; that's virtual time
@@ -144,152 +328,92 @@ void sinusoids_dsp(t_sinusoids *x, t_signal **sp, short *count)
 
 void sinusoids2_perform64(t_sinusoids *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
 {
-	//t_float *out = (t_float *)(w[2]);
 	double *out = outs[0];
 	t_sinusoids *op = x;
 	long n = sampleframes;
-	int nosc = op->nosc;
+	t_dsbank *b = sinusoids_getbank(op);
+	int nosc = op->nosc < b->size ? op->nosc : (int)b->size;
+	double decay = op->sampleinterval*op->rate;
 	int i,j;
-	oscdesc *o = op->base;
-	const char *st = (const char *)Sinetab;
-	float rate ;
-	//	if(op->b_obj.z_disabled)
-	//		goto out;
 	
-	rate = 1.0f/n;
 	for(j=0;j<n;++j)
 		out[j] = 0.0f;
 
-
 	for(i=0;i<nosc;++i)
 		{
-			register float a = op->pulse*exp(-o->rate*op->t)*o->gain;
-			register float ascale = exp(-o->rate*op->sampleinterval*op->rate);
-			register long pi = o->phase_inc;
-			register unsigned long pc = o->phase_current;
-			//		register float astep = (nexta - o->amplitude)*rate;
-
-			//		if(op->t<1.0)
-			//			post("%d", o->phase_current);
-			for(j=0;j<n;++j)
-				{
-
-					out[j] +=  a  * 
-						*((float *)(st + (((pc) >> (32-TPOW-LOGBASE2OFTABLEELEMENT))
-								  & ((STABSZ-1)*sizeof(*Sinetab)))));
-					pc +=  pi;
-					a *=ascale;
-
-				}
-			o->phase_current = pc;
-			++o;
+			b->a[i] = -b->rate[i]*op->t;
+			b->ascale[i] = -b->rate[i]*decay;
 		}
-	op->t += op->rate*n*op->sampleinterval;
-	if(op->t<op->backstop)
-		op->t = op->backstop;
-	if(op->t>op->stop)
-		op->t = op->stop;
+	sinusoids_expv(b->a, nosc);
+	sinusoids_expv(b->ascale, nosc);
+	for(i=0;i<nosc;++i)
+		b->a[i] *= op->pulse*b->gain[i];
+
+	sinusoids_synth(b, nosc, out, n);
+	sinusoids_advance(op, n);
 }
 
 
 t_int *sinusoids2_perform(t_int *w)
 {
-		t_float *out = (t_float *)(w[2]);
+	t_float *out = (t_float *)(w[2]);
 	t_sinusoids *op = (t_sinusoids *)(w[1]);
 	int n = (int)(w[3]);
-	int nosc = op->nosc;
-	 int i,j;
-	 oscdesc *o = op->base;
-	 const char *st = (const char *)Sinetab;
-	 float rate ;
-//	if(op->b_obj.z_disabled)
-//		goto out;
-	
-	rate = 1.0f/n;
-	for(j=0;j<n;++j)
-		out[j] = 0.0f;
-
-
-	for(i=0;i<nosc;++i)
-	{
-		register float a = op->pulse*exp(-o->rate*op->t)*o->gain;
-		register float ascale = exp(-o->rate*op->sampleinterval*op->rate);
-		register long pi = o->phase_inc;
-		register unsigned long pc = o->phase_current;
-//		register float astep = (nexta - o->amplitude)*rate;
-
-//		if(op->t<1.0)
-//			post("%d", o->phase_current);
-		for(j=0;j<n;++j)
-		{
-
-			out[j] +=  a  * 
-		*((float *)(st + (((pc) >> (32-TPOW-LOGBASE2OFTABLEELEMENT))
-					& ((STABSZ-1)*sizeof(*Sinetab)))));
-			pc +=  pi;
-			a *=ascale;
+	double *outs[1];
+	int j;
 
-		}
-		o->phase_current = pc;
-		++o;
-	}
-	op->t += op->rate*n*op->sampleinterval;
-	if(op->t<op->backstop)
-		op->t = op->backstop;
-	if(op->t>op->stop)
-		op->t = op->stop;
-out:	return (w+4);
+	outs[0] = op->obuf;
+	sinusoids2_perform64(op, NULL, NULL, 0, outs, 1, n, 0, NULL);
+	for(j=0;j<n;++j)
+		out[j] = op->obuf[j];
+	return (w+4);
 }
 
+/* The time signal is cut into runs where it moves in a straight line (just
+   one run for a phasor~ or line~ that isn't wrapping).  Each run costs two
+   exp()s per oscillator, done across oscillators by sinusoids_expv(), and the
+   oscillators then decay by a constant factor per sample as in the message
+   driven version.  A time signal that jumps every sample falls back to a run
+   per sample or two. */
 void decayingsinusoids_perform_time_input_signal64(t_sinusoids *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
 {
 	t_sinusoids *op = x;
 	double *time = ins[0];
 	double *out = outs[0];
 	long n = sampleframes;
-	int nosc = op->nosc;
-	int i,j;
-	oscdesc *o = op->base;
-	const char *st = (const char *)Sinetab;
-	float rate ;
-	//	if(op->b_obj.z_disabled)
-	//		goto out;
+	t_dsbank *b = sinusoids_getbank(op);
+	int nosc = op->nosc < b->size ? op->nosc : (int)b->size;
+	long j, j0, len;
+	int i;
 	
-	rate = 1.0f/n;
 	for(j=0;j<n;++j)
 		out[j] = 0.0f;
 
-
-	for(i=0;i<nosc;++i)
+	for(j0=0;j0<n;j0+=len)
 		{
-			// register float a = op->pulse*exp(-o->rate*op->t)*o->gain;
-			// register float ascale = exp(-o->rate*op->sampleinterval*op->rate);
-			register long pi = o->phase_inc;
-			register unsigned long pc = o->phase_current;
-			//		register float astep = (nexta - o->amplitude)*rate;
-			register float t, a;
-
-			//		if(op->t<1.0)
-			//			post("%d", o->phase_current);
-			for(j=0;j<n;++j)
+			double t0 = time[j0];
+			double dt = 0.0;
+			len = 1;
+			if(j0+1<n){
+				dt = time[j0+1]-t0;
+				for(len=2;j0+len<n;++len){
+					double predicted = t0+len*dt;
+					if(fabs(time[j0+len]-predicted) > LINEARTIMETOL*(1.0+fabs(predicted)))
+						break;
+				}
+			}
+			for(i=0;i<nosc;++i)
 				{
-					// Super-inefficient version calls exp in the inner loop!
-					a = op->pulse *exp(-o->rate*time[j])*o->gain;
-					out[j] +=  a  * 
-						*((float *)(st + (((pc) >> (32-TPOW-LOGBASE2OFTABLEELEMENT))
-								  & ((STABSZ-1)*sizeof(*Sinetab)))));
-					pc +=  pi;
-					//			a *=ascale;
-
+					b->a[i] = -b->rate[i]*t0;
+					b->ascale[i] = -b->rate[i]*dt;
 				}
-			o->phase_current = pc;
-			++o;
+			sinusoids_expv(b->a, nosc);
+			sinusoids_expv(b->ascale, nosc);
+			for(i=0;i<nosc;++i)
+				b->a[i] *= op->pulse*b->gain[i];
+			sinusoids_synth(b, nosc, out+j0, len);
 		}
-	op->t += op->rate*n*op->sampleinterval;
-	if(op->t<op->backstop)
-		op->t = op->backstop;
-	if(op->t>op->stop)
-		op->t = op->stop;
+	sinusoids_advance(op, n);
 }
 
 t_int *decayingsinusoids_perform_time_input_signal(t_int *w) {
@@ -297,67 +421,24 @@ t_int *decayingsinusoids_perform_time_input_signal(t_int *w) {
 	t_float *time = (t_float *)(w[2]);
 	t_float *out = (t_float *)(w[3]);
 	int n = (int)(w[4]);
-	int nosc = op->nosc;
-	 int i,j;
-	 oscdesc *o = op->base;
-	 const char *st = (const char *)Sinetab;
-	 float rate ;
-//	if(op->b_obj.z_disabled)
-//		goto out;
-	
-	rate = 1.0f/n;
-	for(j=0;j<n;++j)
-		out[j] = 0.0f;
-
-
-	for(i=0;i<nosc;++i)
-	{
-		// register float a = op->pulse*exp(-o->rate*op->t)*o->gain;
-		// register float ascale = exp(-o->rate*op->sampleinterval*op->rate);
-		register long pi = o->phase_inc;
-		register unsigned long pc = o->phase_current;
-//		register float astep = (nexta - o->amplitude)*rate;
-		register float t, a;
-
-//		if(op->t<1.0)
-//			post("%d", o->phase_current);
-		for(j=0;j<n;++j)
-		{
-			// Super-inefficient version calls exp in the inner loop!
-			a = op->pulse *exp(-o->rate*time[j])*o->gain;
-			out[j] +=  a  * 
-		*((float *)(st + (((pc) >> (32-TPOW-LOGBASE2OFTABLEELEMENT))
-					& ((STABSZ-1)*sizeof(*Sinetab)))));
-			pc +=  pi;
-//			a *=ascale;
+	double *ins[1], *outs[1];
+	int j;
 
-		}
-		o->phase_current = pc;
-		++o;
-	}
-	op->t += op->rate*n*op->sampleinterval;
-	if(op->t<op->backstop)
-		op->t = op->backstop;
-	if(op->t>op->stop)
-		op->t = op->stop;
-out:	return (w+5);
+	for(j=0;j<n;++j)
+		op->tbuf[j] = time[j];
+	ins[0] = op->tbuf;
+	outs[0] = op->obuf;
+	decayingsinusoids_perform_time_input_signal64(op, NULL, ins, 1, outs, 1, n, 0, NULL);
+	for(j=0;j<n;++j)
+		out[j] = op->obuf[j];
+	return (w+5);
 }
 
 
 void sinusoids_clearmodel(t_sinusoids *x) {
-	int i;
-	oscdesc *p = x->base;
-	for(i=0;i<MAXOSCILLATORS;++i, p++)
-	{
-	
-	//	p->next_phase_inc = 0;
-	//	p->next_amplitude = 0.0f;
-		p->amplitude = 0.0f;
-		p->phase_inc = 0;
-		p->phase_current = 0;
-//		p->phaseadd = 0;
-//		p->next_phaseadd = 0;
-	}
+	t_dsbank *b = x->bank;
+	memset(b->phase_current, 0, b->size * sizeof(unsigned long));
+	memset(b->phase_inc, 0, b->size * sizeof(long));
 }  
 
 
@@ -370,47 +451,75 @@ void sinusoids_clear(t_sinusoids *x)
 	x->stop = 1e30;
 }
 
-void sinusoids_list(t_sinusoids *x, t_symbol *s, short argc, t_atom *argv)
+/* Set the first nosc oscillators of fp from a list of triplets. */
+void sinusoids_setbank(t_sinusoids *x, t_dsbank *fp, int nosc, short argc, t_atom *argv)
 {
 	int i;
+	for(i=0;i<nosc;++i)
+	{
+		float f = atom_getfloatarg(i*3,argc,argv);
+		float g = 	atom_getfloatarg(i*3+1,argc,argv);
+		float rate = atom_getfloatarg(i*3+2,argc,argv);
+
+		if((f<=0.0f) || (f>=(x->samplerate*0.5f)) || (rate<=0.0f))
+		{
+			fp->rate[i] = fp->gain[i] = 0.0;
+			fp->phase_inc[i] = 0;
+			
+		}
+		else
+		{
+		fp->rate[i] = rate;
+		fp->phase_inc[i] = f*x->pk;
+		fp->gain[i] = g;
+
+		}
+//		post("%d %f %d %f", i, fp->rate[i], fp->phase_inc[i], g);
+	}
+}
+
+void sinusoids_list(t_sinusoids *x, t_symbol *s, short argc, t_atom *argv)
+{
 	if(argc%3!=0)
 	{
 		object_post((t_object *)x, "multiple of 3 floats required");
 	}
 	else
 	{
-		oscdesc *fp = x->base;
+		t_dsbank *fp, *nb;
 		int nosc;
 		nosc = argc/3;
-		if(nosc>MAXOSCILLATORS)
-			nosc = MAXOSCILLATORS;
 
-
-		for(i=x->nosc;i<nosc;++i)
-		{
-// xxxx	 mess with ampl		fp[i].out1 = fp[i].out2 = 0.0f;
-		}
-		x->nosc = nosc;
-		for(i=0;i<nosc;++i)
+		// Only this routine sets b_next, so the bank it reads here stays
+		// allocated even if the perform routine picks it up meanwhile
+		fp = x->b_next ? x->b_next : x->bank;
+		if(nosc>fp->size)
 		{
-			float f = atom_getfloatarg(i*3,argc,argv);
-			float g = 	atom_getfloatarg(i*3+1,argc,argv);
-			float rate = atom_getfloatarg(i*3+2,argc,argv);
-
-			if((f<=0.0f) || (f>=(x->samplerate*0.5f)) || (rate<=0.0f))
-			{
-				fp[i].rate = fp[i].gain = fp[i].phase_inc = 0.0f;
-				
-			}
-			else
+			// Grow to the next multiple of INITOSCILLATORS.  The new bank is
+			// filled in before it's handed over; the perform routine keeps
+			// using the old one until it picks this one up
+			nb = sinusoids_newbank(((nosc+INITOSCILLATORS-1)/INITOSCILLATORS)*INITOSCILLATORS);
+			if(!nb)
 			{
-			fp[i].rate = rate;
-			fp[i].phase_inc = f*x->pk;
-			fp[i].gain = g;
-
+				object_error((t_object *)x, "out of memory for %d oscillators", nosc);
+				return;
 			}
-//		post("%d %f %d %f", i, fp[i].rate, fp[i].phase_inc, g);
+			sinusoids_setbank(x, nb, nosc, argc, argv);
+			critical_enter(x->b_lock);
+			fp = x->b_next ? x->b_next : x->bank;
+			memcpy(nb->phase_current, fp->phase_current, fp->size * sizeof(unsigned long));
+			if(x->b_next)
+				sinusoids_freebank(x->b_next);
+			sinusoids_freebank(x->b_old);
+			x->b_old = NULL;
+			x->b_next = nb;
+			critical_exit(x->b_lock);
+		}
+		else
+		{
+			sinusoids_setbank(x, fp, nosc, argc, argv);
 		}
+		x->nosc = nosc;
 	}
 }
 
@@ -430,6 +539,16 @@ void *sinusoids_new(t_symbol *s, short argc, t_atom *argv)
 		return NULL;
 	}
 
+    x->bank = sinusoids_newbank(INITOSCILLATORS);
+	if(!x->bank){
+		object_error((t_object *)x, "out of memory");
+		return NULL;
+	}
+	x->b_next = x->b_old = NULL;
+	critical_new(&x->b_lock);
+	x->tbuf = x->obuf = NULL;
+	x->bufsize = 0;
+
     dsp_setup((t_pxobject *)x,1);   // One signal inlet, for virtual time
     outlet_new((t_object *)x, "signal");
 	x->samplerate =  sys_getsr();
@@ -446,6 +565,17 @@ void *sinusoids_new(t_symbol *s, short argc, t_atom *argv)
     return (x);
 }
 
+void sinusoids_free(t_sinusoids *x)
+{
+	dsp_free((t_pxobject *)x);
+	critical_free(x->b_lock);
+	sinusoids_freebank(x->bank);
+	sinusoids_freebank(x->b_next);
+	sinusoids_freebank(x->b_old);
+	if(x->tbuf) sysmem_freeptr(x->tbuf);
+	if(x->obuf) sysmem_freeptr(x->obuf);
+}
+
 void SineFunction(int n, float *stab, int stride, float from, float to);
 void SineFunction(int n, float *stab, int stride, float from, float to)
 {
@@ -502,10 +632,9 @@ void sinusoids_maxtime(t_sinusoids *x, double f)
 
 
 int main(void){
-	sinusoids_class = class_new("decaying-sinusoids~", (method)sinusoids_new, (method)dsp_free,
+	sinusoids_class = class_new("decaying-sinusoids~", (method)sinusoids_new, (method)sinusoids_free,
 		  (short)sizeof(t_sinusoids), 0L, A_GIMME, 0);
 	version_post_copyright();
-	post("Maximum Oscillators: %d", MAXOSCILLATORS);
 	post("Never expires");
 
 
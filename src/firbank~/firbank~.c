@@ -30,6 +30,7 @@
  VERSION 0.1: Initial release
  VERSION 0.2: Fixed operation with multiple inputs
  VERSION 0.3: Fix sensitivity to buffer initialization
+ VERSION 0.4: filter and set messages, crossfade on filter changes, fixed 64-bit signal i/o
  @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
  
  */
@@ -55,6 +56,9 @@
 // fftw 3
 #include "fftw3.h"
 
+// lock-free filter table updates
+#include "param-update.h"
+
 
 
 t_class *firbank_class;
@@ -113,6 +117,7 @@ typedef struct _firbank {
     float** output;
 
     float* input_copy;
+    float* output_copy;
     
     /*
     // autosplit mode on/off
@@ -134,8 +139,9 @@ typedef struct _firbank {
     float overlap_power;
     */
     
-    // filters
-    t_fir* filters;
+    // filters: k-entry tables, handed to the perform routine with param-update
+    t_fir* filter_blocks[PARAM_NUM_BLOCKS];
+    paramPointers pp;
     
     // filters
     t_fir_state* filter_states;
@@ -162,6 +168,10 @@ void *firbank_new(t_symbol*, short, t_atom*);
 void firbank_dsp(t_firbank *x, t_signal **sp, short int *count);
 t_int *firbank_perform(t_int *w);
 void firbank_free(t_firbank *x);
+void firbank_process(t_firbank *x);
+int firbank_convolve(t_firbank *x, t_fir *f);
+void firbank_set(t_firbank *x, t_symbol *s);
+void firbank_filter(t_firbank *x, t_symbol *s, short argc, t_atom *argv);
 
 
 
@@ -177,265 +187,239 @@ t_buffer* _sym_to_buffer(t_symbol* s) {
 
 }
 
-t_int* firbank_perform(t_int *w) {
+// multiply the spectrum in x_forward_c by filter f and transform back into x_inverse_t;
+// returns 0 if the filter's buffer doesn't meet the channel and length requirements
+int firbank_convolve(t_firbank *x, t_fir *f) {
 
-    t_int** wp;
-    int v;
-    int i, p, s, k;
+    int s;
     float c, d;
-	t_firbank *x;
-    
     t_buffer* b;
-
-    wp = (t_int**)w;
     
-    x = (t_firbank*)(wp[1]);
-    v = (int)(wp[2]);
-    
-    if(v != x->v) {
-        object_post((t_object *)x, "firbank~: unexpected block size, v != x->v, %d", v);
-        return w + 3 + x->n + x->m;
-    }
-
-    for(i = 0; i < x->n; i++) {
-        x->input[i] = (float*)(wp[3 + i]);
+    if(f->buffer == NULL) {
+        return 0;
     }
     
-    for(i = 0; i < x->m; i++) {
-        x->output[i] = (float*)(wp[3 + i + x->n]);
+    b = _sym_to_buffer(f->buffer);
+    
+    // verify that its buffer valid and meets the channel and length requirements...
+    if(!(b && (b->b_valid) && 
+       (f->channel_1 >= 0 && f->channel_1 < b->b_nchans) && 
+       ((f->channel_2 >= 0 && f->channel_2 < b->b_nchans) || (f->channel_2 < 0)) &&
+       (f->offset + x->framesize < b->b_frames))) {
+        return 0;
     }
-        
-    if(x->v == x->framesize / 2) {
 
-        // copy input
-        for(i = 0; i < x->n; i++) {
-            memcpy(x->input_copy + (i * x->v), x->input[i], x->v * sizeof(float));
+    // real convolution only (magnitude) 
+    if(f->channel_2 < 0) {
+        
+        for(s = 0; s < x->framesize / 2 + 1; s++) { // note symmetry; second half of filter is ignored
+            c = b->b_samples[(f->offset + s) * b->b_nchans + f->channel_1];
+            
+            // (a + b I) * c = ac + bc I
+            x->x_inverse_c[s][0] = x->x_forward_c[s][0] * c; // ac
+            x->x_inverse_c[s][1] = x->x_forward_c[s][1] * c; // bc
         }
         
-        // do overlap-save
+    } 
+    
+    // complex convolution
+    else {
         
-        // for each input...
-        for(i = 0; i < x->n; i++) {
-            
-            // copy input into first half of x_forward_t
-            for(s = 0; s < x->v; s++) {
-                x->x_forward_t[s] = x->input_copy[i * x->v + s];
-                x->x_forward_t[s + x->v] = 0.f;
-            }
-            
-            // transform -> x_forward_c
-            fftwf_execute(x->x_forward);
-            
-            // for each filter state using this input...
-            for(p = 0; p < x->m; p++) {
-                
-                if(x->filter_states[p].i == i) {
-                    
-                    // find the corresponding filter index
-                    k = x->filter_states[p].k;
-                    
-                    b = _sym_to_buffer(x->filters[k].buffer);
-                    
-                    // verify that its buffer valid and meets the channel and length requirements...
-                    if(b && (b->b_valid) && 
-                       (x->filters[k].channel_1 >= 0 && x->filters[k].channel_1 < b->b_nchans) && 
-                       ((x->filters[k].channel_2 >= 0 && x->filters[k].channel_2 < b->b_nchans) || (x->filters[k].channel_2 < 0)) &&
-                       (x->filters[k].offset + x->framesize < b->b_frames)) {
-
-                        // real convolution only (magnitude) 
-                        if(x->filters[k].channel_2 < 0) {
-                            
-                            for(s = 0; s < x->framesize / 2 + 1; s++) { // note symmetry; second half of filter is ignored
-                                c = b->b_samples[(x->filters[k].offset + s) * b->b_nchans + x->filters[k].channel_1];
-                                
-                                // (a + b I) * c = ac + bc I
-                                x->x_inverse_c[s][0] = x->x_forward_c[s][0] * c; // ac
-                                x->x_inverse_c[s][1] = x->x_forward_c[s][1] * c; // bc
-                            }
-                            
-                        } 
-                        
-                        // complex convolution
-                        else {
-                            
-                            for(s = 0; s < (x->framesize / 2 + 1); s++) { // note symmetry
-                                c = b->b_samples[(x->filters[k].offset + s) * b->b_nchans + x->filters[k].channel_1];
-                                d = b->b_samples[(x->filters[k].offset + s) * b->b_nchans + x->filters[k].channel_2];
-                                
-                                // (a + b I) * (c + d I) = (ac - bd) + (ad + bc) I
-                                x->x_inverse_c[s][0] = x->x_forward_c[s][0] * c - x->x_forward_c[s][1] * d;  // ac - bd
-                                x->x_inverse_c[s][1] = x->x_forward_c[s][0] * d +  x->x_forward_c[s][1] * c; // ad + bc
-                            }
-                            
-                        }
-                        
-                        // invert result
-                        fftwf_execute(x->x_inverse);
-                        
-                        // normalize 
-                        for(s = 0; s < x->framesize; s++) {
-                            x->x_inverse_t[s] /= x->framesize;
-                        }
-                        
-                        // copy first half of result into output + tail of filter state
-                        for(s = 0; s < x->v; s++) {
-                            x->output[x->filter_states[p].o][s] = x->x_inverse_t[s] + x->filter_states[p].tail[s];
-                        }
-                        
-                        // copy second half of result into tail
-                        for(s = 0; s < x->v; s++) {
-                            x->filter_states[p].tail[s] = x->x_inverse_t[s + x->v];
-                        }
-                                                
-                   } else {
-                       object_post((t_object *)x, "firbank~: buffer for filter %d does not meet specifications", k);
-                   }
-                        
-                } // filter state corresponds to this input
-                
-            } // for each filter state
+        for(s = 0; s < (x->framesize / 2 + 1); s++) { // note symmetry
+            c = b->b_samples[(f->offset + s) * b->b_nchans + f->channel_1];
+            d = b->b_samples[(f->offset + s) * b->b_nchans + f->channel_2];
             
-        } // for each input
-
-    } else {
-
-        // outputs all zeros
-        for(i = 0; i < x->m; i++) {
-            for(s = 0; s < x->v; s++) {
-                x->output[i][s] = 0.f;
-            }
+            // (a + b I) * (c + d I) = (ac - bd) + (ad + bc) I
+            x->x_inverse_c[s][0] = x->x_forward_c[s][0] * c - x->x_forward_c[s][1] * d;  // ac - bd
+            x->x_inverse_c[s][1] = x->x_forward_c[s][0] * d +  x->x_forward_c[s][1] * c; // ad + bc
         }
         
     }
     
-    return w + 3 + x->n + x->m;
+    // invert result
+    fftwf_execute(x->x_inverse);
+    
+    // normalize 
+    for(s = 0; s < x->framesize; s++) {
+        x->x_inverse_t[s] /= x->framesize;
+    }
+    
+    return 1;
     
 }
 
-void firbank_perform64(t_firbank *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
-    {
+static int _same_filter(t_fir *a, t_fir *b) {
+    return a->buffer == b->buffer && a->offset == b->offset && a->channel_1 == b->channel_1 && a->channel_2 == b->channel_2;
+}
+
+// overlap-add of input_copy through the filter bank into output_copy
+void firbank_process(t_firbank *x) {
 
-    t_int** wp;
     int i, p, s, k;
-    float c, d;
+    float g, ginc, zero = 0.f, one = 1.f;
+    float* out;
+    t_fir_state* fs;
+    t_fir* filters;
+    t_fir* oldfilters;
     
-    t_buffer* b;
+    // the filter table for this vector, and the one from the previous vector if it changed
+    filters = (t_fir*)GetCurrentParams(&x->pp);
+    oldfilters = (t_fir*)GetPreviousParams(&x->pp);
     
-    long v = sampleframes;
-    if(v != x->v) {
-        object_post((t_object *)x, "firbank~: unexpected block size, v != x->v, %d", v);
+    if(x->v != x->framesize / 2) {
+
+        // outputs all zeros
+        memset(x->output_copy, 0, sizeof(float) * x->v * x->m);
+        DoneWithPreviousParams(&x->pp);
         return;
+        
     }
     
-    for(i = 0; i < numins; i++) {
-        x->input[i] = (float *)ins[i];
-    }
+    // crossfade gain, per sample
+    ParamRampFloat(&ginc, &zero, &one, 1, x->v);
     
-    for(i = 0; i < numouts; i++) {
-        x->output[i] = (float *)outs[i];
-    }
+    // do overlap-save
     
-    if(x->v == x->framesize / 2) {
+    // for each input...
+    for(i = 0; i < x->n; i++) {
         
-        // copy input
-        for(i = 0; i < x->n; i++) {
-            memcpy(x->input_copy + (i * x->v), x->input[i], x->v * sizeof(float));
+        // copy input into first half of x_forward_t
+        for(s = 0; s < x->v; s++) {
+            x->x_forward_t[s] = x->input_copy[i * x->v + s];
+            x->x_forward_t[s + x->v] = 0.f;
         }
         
-        // do overlap-save
+        // transform -> x_forward_c
+        fftwf_execute(x->x_forward);
         
-        // for each input...
-        for(i = 0; i < x->n; i++) {
+        // for each filter state using this input...
+        for(p = 0; p < x->m; p++) {
             
-            // copy input into first half of x_forward_t
-            for(s = 0; s < x->v; s++) {
-                x->x_forward_t[s] = x->input_copy[i * x->v + s];
-                x->x_forward_t[s + x->v] = 0.f;
-            }
-            
-            // transform -> x_forward_c
-            fftwf_execute(x->x_forward);
+            fs = &x->filter_states[p];
             
-            // for each filter state using this input...
-            for(p = 0; p < x->m; p++) {
+            if(fs->i == i) {
                 
-                if(x->filter_states[p].i == i) {
-                    
-                    // find the corresponding filter index
-                    k = x->filter_states[p].k;
-                    
-                    b = _sym_to_buffer(x->filters[k].buffer);
+                // find the corresponding filter index
+                k = fs->k;
+                out = x->output_copy + fs->o * x->v;
+                
+                if(oldfilters != filters && !_same_filter(&oldfilters[k], &filters[k])) {
                     
-                    // verify that its buffer valid and meets the channel and length requirements...
-                    if(b && (b->b_valid) &&
-                       (x->filters[k].channel_1 >= 0 && x->filters[k].channel_1 < b->b_nchans) &&
-                       ((x->filters[k].channel_2 >= 0 && x->filters[k].channel_2 < b->b_nchans) || (x->filters[k].channel_2 < 0)) &&
-                       (x->filters[k].offset + x->framesize < b->b_frames)) {
-                        
-                        // real convolution only (magnitude)
-                        if(x->filters[k].channel_2 < 0) {
-                            
-                            for(s = 0; s < x->framesize / 2 + 1; s++) { // note symmetry; second half of filter is ignored
-                                c = b->b_samples[(x->filters[k].offset + s) * b->b_nchans + x->filters[k].channel_1];
-                                
-                                // (a + b I) * c = ac + bc I
-                                x->x_inverse_c[s][0] = x->x_forward_c[s][0] * c; // ac
-                                x->x_inverse_c[s][1] = x->x_forward_c[s][1] * c; // bc
-                            }
-                            
-                        }
-                        
-                        // complex convolution
-                        else {
-                            
-                            for(s = 0; s < (x->framesize / 2 + 1); s++) { // note symmetry
-                                c = b->b_samples[(x->filters[k].offset + s) * b->b_nchans + x->filters[k].channel_1];
-                                d = b->b_samples[(x->filters[k].offset + s) * b->b_nchans + x->filters[k].channel_2];
-                                
-                                // (a + b I) * (c + d I) = (ac - bd) + (ad + bc) I
-                                x->x_inverse_c[s][0] = x->x_forward_c[s][0] * c - x->x_forward_c[s][1] * d;  // ac - bd
-                                x->x_inverse_c[s][1] = x->x_forward_c[s][0] * d +  x->x_forward_c[s][1] * c; // ad + bc
-                            }
-                            
+                    // filter changed: fade this vector's contribution from the old filter to the
+                    // new one.  the tail is already the old filter's, and we keep the new one's.
+                    if(firbank_convolve(x, &oldfilters[k])) {
+                        for(s = 0, g = 1.f; s < x->v; s++) {
+                            g -= ginc;
+                            out[s] = fs->tail[s] + g * x->x_inverse_t[s];
                         }
-                        
-                        // invert result
-                        fftwf_execute(x->x_inverse);
-                        
-                        // normalize
-                        for(s = 0; s < x->framesize; s++) {
-                            x->x_inverse_t[s] /= x->framesize;
-                        }
-                        
-                        // copy first half of result into output + tail of filter state
+                    } else {
                         for(s = 0; s < x->v; s++) {
-                            x->output[x->filter_states[p].o][s] = x->x_inverse_t[s] + x->filter_states[p].tail[s];
+                            out[s] = fs->tail[s];
                         }
-                        
-                        // copy second half of result into tail
-                        for(s = 0; s < x->v; s++) {
-                            x->filter_states[p].tail[s] = x->x_inverse_t[s + x->v];
+                    }
+                    
+                    if(firbank_convolve(x, &filters[k])) {
+                        for(s = 0, g = 0.f; s < x->v; s++) {
+                            g += ginc;
+                            out[s] += g * x->x_inverse_t[s];
+                            fs->tail[s] = x->x_inverse_t[s + x->v];
                         }
-                        
                     } else {
-                        object_post((t_object *)x, "firbank~: buffer for filter %d does not meet specifications", k);
+                        memset(fs->tail, 0, sizeof(float) * x->v);
                     }
                     
-                } // filter state corresponds to this input
-                
-            } // for each filter state
+                } else if(firbank_convolve(x, &filters[k])) {
+                    
+                    // copy first half of result into output + tail of filter state
+                    for(s = 0; s < x->v; s++) {
+                        out[s] = x->x_inverse_t[s] + fs->tail[s];
+                    }
+                    
+                    // copy second half of result into tail
+                    for(s = 0; s < x->v; s++) {
+                        fs->tail[s] = x->x_inverse_t[s + x->v];
+                    }
+                                            
+               } else {
+                   memset(out, 0, sizeof(float) * x->v);
+                   memset(fs->tail, 0, sizeof(float) * x->v);
+                   object_post((t_object *)x, "firbank~: buffer for filter %d does not meet specifications", k);
+               }
+                    
+            } // filter state corresponds to this input
             
-        } // for each input
+        } // for each filter state
         
-    } else {
+    } // for each input
+    
+    DoneWithPreviousParams(&x->pp);
+    
+}
+
+t_int* firbank_perform(t_int *w) {
+
+    t_int** wp;
+    int v;
+    int i;
+	t_firbank *x;
+    
+    wp = (t_int**)w;
+    
+    x = (t_firbank*)(wp[1]);
+    v = (int)(wp[2]);
+    
+    if(v != x->v) {
+        object_post((t_object *)x, "firbank~: unexpected block size, v != x->v, %d", v);
+        return w + 3 + x->n + x->m;
+    }
+
+    for(i = 0; i < x->n; i++) {
+        x->input[i] = (float*)(wp[3 + i]);
+    }
+    
+    for(i = 0; i < x->m; i++) {
+        x->output[i] = (float*)(wp[3 + i + x->n]);
+    }
         
-        // outputs all zeros
-        for(i = 0; i < x->m; i++) {
-            for(s = 0; s < x->v; s++) {
-                x->output[i][s] = 0.f;
-            }
+    // copy input
+    for(i = 0; i < x->n; i++) {
+        memcpy(x->input_copy + (i * x->v), x->input[i], x->v * sizeof(float));
+    }
+    
+    firbank_process(x);
+    
+    for(i = 0; i < x->m; i++) {
+        memcpy(x->output[i], x->output_copy + (i * x->v), x->v * sizeof(float));
+    }
+    
+    return w + 3 + x->n + x->m;
+    
+}
+
+void firbank_perform64(t_firbank *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
+    {
+
+    int i, s;
+    
+    long v = sampleframes;
+    if(v != x->v) {
+        object_post((t_object *)x, "firbank~: unexpected block size, v != x->v, %d", v);
+        return;
+    }
+    
+    // copy input (the fft works in single precision)
+    for(i = 0; i < x->n; i++) {
+        for(s = 0; s < x->v; s++) {
+            x->input_copy[i * x->v + s] = ins[i][s];
+        }
+    }
+    
+    firbank_process(x);
+    
+    for(i = 0; i < x->m; i++) {
+        for(s = 0; s < x->v; s++) {
+            outs[i][s] = x->output_copy[i * x->v + s];
         }
-        
     }
 }
 
@@ -506,6 +490,7 @@ void firbank_free(t_firbank *x) {
         fftwf_destroy_plan(x->x_inverse);
         
         fftwf_free(x->input_copy);
+        fftwf_free(x->output_copy);
     }
     
     if(x->filter_states != NULL) {
@@ -515,8 +500,10 @@ void firbank_free(t_firbank *x) {
         free(x->filter_states);
     }
     
-    if(x->filters != NULL) {
-        free(x->filters);
+    for(i = 0; i < PARAM_NUM_BLOCKS; i++) {
+        if(x->filter_blocks[i] != NULL) {
+            free(x->filter_blocks[i]);
+        }
     }
     
     if(x->w != NULL) {
@@ -564,9 +551,12 @@ void *firbank_new(t_symbol *s, short argc, t_atom *argv) {
     x->k = 16;
     x->v = 0;
     
-    x->filters = NULL;
+    for(i = 0; i < PARAM_NUM_BLOCKS; i++) {
+        x->filter_blocks[i] = NULL;
+    }
     x->filter_states = NULL;
     x->input_copy = NULL;
+    x->output_copy = NULL;
     x->input = NULL;
     x->output = NULL;
     x->w = NULL;
@@ -727,22 +717,28 @@ void *firbank_new(t_symbol *s, short argc, t_atom *argv) {
      }
      */
     
+    for(i = 0; i < PARAM_NUM_BLOCKS; i++) {
+        x->filter_blocks[i] = (t_fir*)calloc(x->k ? x->k : 1, sizeof(t_fir));
+    }
+    
     // setup filters if not from initialization
-    if(default_filters && default_buffer != NULL) {
+    if(default_filters) {
         // post("firbank~: setting up %d filters with framesize %d, channels (%d, %d)", x->k, x->framesize, default_channel_1, default_channel_2);
         
-        x->filters = (t_fir*)malloc(sizeof(t_fir)*x->k);
-        
         for(i = 0; i < x->k; i++) {
-            x->filters[i].buffer = default_buffer;
-            x->filters[i].channel_1 = default_channel_1;
-            x->filters[i].channel_2 = default_channel_2;
-            x->filters[i].offset = i * x->framesize;
+            x->filter_blocks[0][i].buffer = default_buffer;
+            x->filter_blocks[0][i].channel_1 = default_channel_1;
+            x->filter_blocks[0][i].channel_2 = default_channel_2;
+            x->filter_blocks[0][i].offset = i * x->framesize;
         }
-    } else {
+    }
+    
+    if(default_buffer == NULL) {
         object_post((t_object *)x, "firbank~: no buffer specified");
     }
     
+    InitParamPointers(&x->pp, x->filter_blocks[0], x->filter_blocks[1], x->filter_blocks[2], x->filter_blocks[3]);
+    
     // setup iomap if not from initialization
     if(default_iomap) {
         // post("firbank~: initializing input-output map...");
@@ -767,6 +763,8 @@ void *firbank_new(t_symbol *s, short argc, t_atom *argv) {
     x->x_inverse_c = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * (x->framesize / 2 + 1));  // n/2+1 complex numbers (dc is first, nyquist last)
     
     x->input_copy = (float*)fftwf_malloc(sizeof(float) * (x->framesize / 2) * x->n);
+    x->output_copy = (float*)fftwf_malloc(sizeof(float) * (x->framesize / 2) * x->m);
+    memset(x->output_copy, 0, sizeof(float) * (x->framesize / 2) * x->m);
     
     memset(x->x_forward_t, 0, sizeof(float) * (x->framesize));
     memset(x->x_inverse_t, 0, sizeof(float) * (x->framesize));
@@ -805,6 +803,69 @@ void *firbank_new(t_symbol *s, short argc, t_atom *argv) {
     
 }
 
+// copy of the current filter table for a message to edit; check it in when done
+static t_fir* _edit_filters(t_firbank *x) {
+
+    t_fir* f = (t_fir*)CheckOutParamBlock(&x->pp);
+    
+    memcpy(f, GetLatestParams(&x->pp), sizeof(t_fir) * x->k);
+    return f;
+    
+}
+
+// set <buffer>: point every filter at another buffer, keeping offsets and channels
+void firbank_set(t_firbank *x, t_symbol *s) {
+
+    int i;
+    t_fir* f = _edit_filters(x);
+    
+    for(i = 0; i < x->k; i++) {
+        f[i].buffer = s;
+    }
+    
+    CheckInNewParams(&x->pp);
+    
+}
+
+// filter <index> <buffer> [<offset> [<channel> [<channel>]]]
+void firbank_filter(t_firbank *x, t_symbol *s, short argc, t_atom *argv) {
+
+    int k;
+    t_fir* f;
+    
+    if(argc < 2 || argv[0].a_type != A_LONG || argv[1].a_type != A_SYM) {
+        object_post((t_object *)x, "firbank~: expected filter index and buffer name for filter");
+        return;
+    }
+    
+    k = argv[0].a_w.w_long;
+    if(k < 0 || k >= x->k) {
+        object_post((t_object *)x, "firbank~: filter index %d out of range (0 - %d)", k, x->k - 1);
+        return;
+    }
+    
+    f = _edit_filters(x);
+    
+    f[k].buffer = argv[1].a_w.w_sym;
+    
+    if(argc > 2 && argv[2].a_type == A_LONG) {
+        f[k].offset = argv[2].a_w.w_long;
+    }
+    
+    if(argc > 3 && argv[3].a_type == A_LONG) {
+        f[k].channel_1 = argv[3].a_w.w_long;
+        
+        if(argc > 4 && argv[4].a_type == A_LONG) {
+            f[k].channel_2 = argv[4].a_w.w_long;
+        } else {
+            f[k].channel_2 = -1;
+        }
+    }
+    
+    CheckInNewParams(&x->pp);
+    
+}
+
 // main
 int main(void){
     
@@ -815,6 +876,8 @@ int main(void){
     
     class_addmethod(firbank_class, (method)firbank_dsp, "dsp", A_CANT, 0);
     class_addmethod(firbank_class, (method)firbank_dsp64, "dsp64", A_CANT, 0);
+    class_addmethod(firbank_class, (method)firbank_set, "set", A_SYM, 0);
+    class_addmethod(firbank_class, (method)firbank_filter, "filter", A_GIMME, 0);
     
     class_dspinit(firbank_class);
     
@@ -52,12 +52,11 @@ VERSION 2.3.1 Fixed crash caused by maxelem() and peqbank_reset() calling peqban
 VERSION 2.4: Support for multiple channels, vector optimization, built with Intel CC
 VERSION 2.5: Support for internal generation of biquad cascade for high/low pass cheby/butterworth filter
 VERSION 2.5.1: Fix denormal problem
+VERSION 2.6: Coefficient handoff through the lock-free param-update library; b_nbpeq and b_start swap along with the coefficients
 @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@  
 
 
-TO-DO:  Include b_nbpeq and b_start in the atomic pointer-swapping scheme
-        
-        Double-precision coefficients, state variables, intra-cascade signal passing
+TO-DO:  Double-precision coefficients, state variables, intra-cascade signal passing
             (in alternate, slower perform routine)
 
 */
@@ -74,33 +73,10 @@ TO-DO:  Include b_nbpeq and b_start in the atomic pointer-swapping scheme
 	Conceptually, it's simple.  Whenever coefficients change, we linearly interpolate the 
 	coefficients from the old values to the new values over one signal vector.
 	
-	How do we know when they've changed and keep track of the old and new values?
-	It's hairy because the audio interrupt might
-	come in the middle of computing the new coefficients.  In the worst case, we get new
-	parameters and compute new coefficients, then get new new parameters, and, in the
-	middle of computing the new new coefficients, get an audio interrupt.  From this case
-	we see that we need three buffers:  the old coefficients (that we used on the last
-	vector), the new coefficients (that we just computed), and temporary space to compute
-	a new set of coefficients.
-	
-	We have four pointers to these three arrays:
-		coeff - the values we'll use next time
-		oldcoeff - the values we used last time
-		newcoeff - where we compute new values
-		freecoeff - If coeff==oldcoeff, freecoeff points to the third buffer.
-		
-	The default state, when the coefficients haven't changed recently, is that
-	coeff==oldcoeff, and the remaining two pointers point to the remaining two buffers.
-	
-	After new coefficients are computed we make them take effect by setting
-	coeff = newcoeff; newcoeff = freecoeff; freecoeff = 0;
-	
-	But maybe we already computed new coefficients since the last time the perform routine
-	happened.  In that case coeff will be the "old new" coefficients, computed recently
-	but not yet actually used by a perform routine.  In that case we simply swap coeff and newcoeff.
-	
-	The perform routine sees that coeff != oldcoeff and interpolates.  Then it sets
-	freecoeff = oldcoeff; oldcoeff = coeff;
+	The coefficients, together with how many filters there are and whether the shelf is
+	on, live in parameter blocks that are handed to the perform routine through
+	utility-library/reentrancy/param-update.c; see the large comment there.  Computing new
+	coefficients never touches a block the perform routine might be reading.
 
 */
 
@@ -115,6 +91,8 @@ TO-DO:  Include b_nbpeq and b_start in the atomic pointer-swapping scheme
 #include <math.h>
 #include <stdio.h>
 
+#include "param-update.h"
+
 #ifdef WIN_VERSION
 #define sinhf sinh
 #define sqrtf sqrt
@@ -147,6 +125,13 @@ TO-DO:  Include b_nbpeq and b_start in the atomic pointer-swapping scheme
 
 t_class *peqbank_class;
 
+/* One parameter block: everything the perform routine needs to run the cascade */
+typedef struct _peqcoeffs {
+	int start;			// 0=shelf, 5=no shelf
+	int nbpeq;			// number of peq filters
+	double coeff[1];	// really (b_max * NBCOEFF)
+} t_peqcoeffs;
+
 typedef struct _peqbank {
 
 	t_pxobject b_obj;
@@ -154,14 +139,9 @@ typedef struct _peqbank {
 	double *param;		// Ptr on stored parameters
 	double *oldparam;	// Ptr on stored old parameters
 	
-	double *coeff;		// See large comment above for explanation of these four pointers
-	double *oldcoeff;
-	double *newcoeff;
-	double *freecoeff;
-
-#ifdef DEBUG	
-	double testcoeff3;  // Matt sanity check
-#endif	
+	t_peqcoeffs *coeffblocks[PARAM_NUM_BLOCKS];
+	paramPointers pp;	// See large comment above
+	
 	double b_Fs;			// Sample rate
 
     int b_channels;     // Number of channels to process in parallel
@@ -196,10 +176,10 @@ t_symbol *ps_maxelem, *ps_shelf, *ps_peq, *ps_fast, *ps_smooth, *ps_channels, *p
 //t_int *do_peqbank_perform_fast(t_int *w, float *mycoeffs);
 //void do_peqbank_perform_fast_multi(t_peqbank *w, float *mycoeffs);
 void peqbank_perform64_fast_multi(t_peqbank *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam);
-void do_peqbank_perform64_fast_multi(t_peqbank *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, double *mycoeff);
+void do_peqbank_perform64_fast_multi(t_peqbank *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, t_peqcoeffs *mycoeff);
 void peqbank_perform64_smooth_multi(t_peqbank *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam);
 void peqbank_perform64_fast(t_peqbank *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam);
-void do_peqbank_perform64_fast(t_peqbank *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, double *mycoeff);
+void do_peqbank_perform64_fast(t_peqbank *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, t_peqcoeffs *mycoeff);
 
 void peqbank_clear(t_peqbank *x);
 //void peqbank_dsp(t_peqbank *x, t_signal **sp, short *connect);
@@ -224,16 +204,13 @@ void peqbank_allocmem(t_peqbank *x);
 void peqbank_freemem(t_peqbank *x);
 void peqbank_free(t_peqbank *x);
 void peqbank_compute(t_peqbank *x);
-void swap_in_new_coeffs(t_peqbank *x);
-void compute_parameq(t_peqbank *x, int index); 
-void compute_shelf(t_peqbank *x); 
+void swap_in_new_coeffs(t_peqbank *x, t_peqcoeffs *nc);
+void compute_parameq(t_peqbank *x, int index, double *newcoeff); 
+void compute_shelf(t_peqbank *x, double *newcoeff); 
 double pow10(double x);
 double pow2(double x);
 void peqbank_tellmeeverything(t_peqbank *x);
 
-int test_normal_state(t_peqbank *x);
-int test_newcoeffs_state(t_peqbank *x);
-
 int main(void){
         version_post_copyright();
 
@@ -293,6 +270,7 @@ int main(void){
 
 void peqbank_tellmeeverything(t_peqbank *x) {
 	int i;
+	double *coeff = ((t_peqcoeffs *) GetLatestParams(&x->pp))->coeff;
 	
 	version(x);
 
@@ -306,16 +284,13 @@ void peqbank_tellmeeverything(t_peqbank *x) {
     
     object_post((t_object *)x, "  Channels: %d", x->b_channels);
     
-    post("  coeff = %p, oldcoeff = %p, newcoeff = %p, freecoeff = %p",
-    	x->coeff, x->oldcoeff, x->newcoeff, x->freecoeff);
-    
     object_post((t_object *)x, "  Allocated enough memory for %ld filters", x->b_max);
     if (x->b_start == 0) {
     	post("  Shelving EQ: %.2f dB, %.2f dB, %.2f dB, %.2f Hz, %.2f Hz",
     		 x->param[0], x->param[1], x->param[2], x->param[3], x->param[4]);
     	post("  (%.1f dB below %.0f Hz, %.1f dB between, %.1f dB above %.0f Hz)",
     		 x->param[0], x->param[3], x->param[1], x->param[2], x->param[4]);
-    	object_post((t_object *)x, "  (biquad: %f %f %f %f %f)", x->coeff[0], x->coeff[1], x->coeff[2], x->coeff[3], x->coeff[4]);
+    	object_post((t_object *)x, "  (biquad: %f %f %f %f %f)", coeff[0], coeff[1], coeff[2], coeff[3], coeff[4]);
     } else {
     	object_post((t_object *)x, "  No shelving EQ.");
     }
@@ -323,20 +298,11 @@ void peqbank_tellmeeverything(t_peqbank *x) {
     for (i = 1; i <= x->b_nbpeq; ++i) {
     	post("   %ld: Ctr %.2fHz, BW %.2f oct, %.1fdB at DC, %.1fdB at ctr, %.1fdB at BW edges (biquad: %f %f %f %f %f)", 
     		 i, x->param[i*5], x->param[i*5+1], x->param[i*5+2], x->param[i*5+3], x->param[i*5+4],
-    		 x->coeff[i*5], x->coeff[i*5+1], x->coeff[i*5+2], x->coeff[i*5+3], x->coeff[i*5+4]);
-    }
-    
-   
-    if (x->coeff == x->oldcoeff) {
-    	if (!test_normal_state(x)) post("Assertions failed in tme, x->coeff == x->oldcoeff");
-    } else {
-    	if (!test_newcoeffs_state(x)) post("Assertions failed in tme, x->coeff != x->oldcoeff");
+    		 coeff[i*5], coeff[i*5+1], coeff[i*5+2], coeff[i*5+3], coeff[i*5+4]);
     }
 }
 
 
-int posted = 0;
-
 void peqbank_perform64_smooth_multi(t_peqbank *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
 {
     peqbank_perform64_fast_multi(x, dsp64, ins, numins, outs, numouts, sampleframes, flags, userparam);
@@ -354,60 +320,34 @@ void peqbank_perform64_smooth(t_peqbank *x, t_object *dsp64, double **ins, long
 {
     double *in  = ins[0];
     double *out = outs[0];
-    //t_peqbank *x = (t_peqbank *)(w[3]);
-    //int n        = (int)(w[4]);
     int n = sampleframes;
-    double *mycoeff;
-    
-    // In overdrive, it's possible that this perform routine could be interrupted (e.g.,
-    // by a MIDI event) by new coefficients being calculated.  So we snapshot a local
-    // copy of x->coeff
-    // Nowhere else is x->oldcoeff set, so we don't have to worry about that.
+    t_peqcoeffs *mycoeff, *oldcoeff;
     
-    mycoeff = x->coeff;
+    // Snapshot of the coefficients for this vector; new ones computed meanwhile
+    // (in overdrive, or on another thread) go into a different block.
+    mycoeff = (t_peqcoeffs *) GetCurrentParams(&x->pp);
+    oldcoeff = (t_peqcoeffs *) GetPreviousParams(&x->pp);
     
-#ifdef DEBUG
-    if (x->oldcoeff[3] != x->testcoeff3) {
-        if (posted == 1) {
-            object_post((t_object *)x, "testcoeff3 is %f, but x->oldcoeff[3] is %f!", x->testcoeff3, x->oldcoeff[3]);
-        }
-        ++ posted;
-        posted = posted %100;
-    }
-#endif
-    
-    if (mycoeff == x->oldcoeff) {
-        // Coefficients haven't changed, so no need to interpolate
-        
-#ifdef DEBUG
-        if (!test_normal_state(x)) post("peqbank_perform: mycoeff==x->oldcoeff");
-#endif
-        
-        //return do_peqbank_perform_fast(w, mycoeff);
+    if (mycoeff == oldcoeff || mycoeff->start != oldcoeff->start || mycoeff->nbpeq != oldcoeff->nbpeq) {
+        // Coefficients haven't changed, so no need to interpolate.  (If the cascade
+        // itself changed there's nothing sensible to interpolate from either.)
         do_peqbank_perform64_fast(x, dsp64, ins, numins, outs, numouts, sampleframes, flags, mycoeff);
     } else {
         
         // Biquad with linear interpolation: smooth-biquad~
         int i, j, k=0;
-        double rate = 1.0f/n;
         double i0, i1, i2, i3;
         double a0, a1, a2, b1, b2;
-        double a0inc, a1inc, a2inc, b1inc, b2inc;
+        double inc[NBCOEFF];
         double y0, y1;
         
-        
-#ifdef DEBUG
-        if (!test_newcoeffs_state(x)) post("peqbank_perform: mycoeff!=x->oldcoeff");
-#endif
-        
-        
         // First copy input vector to output vector (below we'll filter the output in-place
         if (out != in) {
             for (i=0; i<n; ++i) out[i] = in[i];
         }
         
         // Cascade of Biquads
-        for (j=x->b_start; j<(x->b_nbpeq+1)*NBCOEFF; j+=NBCOEFF) {
+        for (j=mycoeff->start; j<(mycoeff->nbpeq+1)*NBCOEFF; j+=NBCOEFF) {
             
             i2 = x->b_xm2[k];
             i3 = x->b_xm1[k];
@@ -415,32 +355,28 @@ void peqbank_perform64_smooth(t_peqbank *x, t_object *dsp64, double **ins, long
             y1 = x->b_ym1[k];
             
             // Interpolated values
-            a0 = x->oldcoeff[j  ];
-            a1 = x->oldcoeff[j+1];
-            a2 = x->oldcoeff[j+2];
-            b1 = x->oldcoeff[j+3];
-            b2 = x->oldcoeff[j+4];
+            a0 = oldcoeff->coeff[j  ];
+            a1 = oldcoeff->coeff[j+1];
+            a2 = oldcoeff->coeff[j+2];
+            b1 = oldcoeff->coeff[j+3];
+            b2 = oldcoeff->coeff[j+4];
             
             // Incrementation values
-            a0inc = (mycoeff[j  ] - a0) * rate;
-            a1inc = (mycoeff[j+1] - a1) * rate;
-            a2inc = (mycoeff[j+2] - a2) * rate;
-            b1inc = (mycoeff[j+3] - b1) * rate;
-            b2inc = (mycoeff[j+4] - b2) * rate;
+            ParamRampDouble(inc, oldcoeff->coeff+j, mycoeff->coeff+j, NBCOEFF, n);
             
             for (i=0; i<n; i+=4) {
                 
                 out[i  ] = y0 = (a0 * (i0 = out[i  ])) + (a1 * i3) + (a2 * i2) - (b1 * y1) - (b2 * y0);
-                a1 += a1inc; a2 += a2inc; a0 += a0inc; b1 += b1inc; b2 += b2inc;
+                a0 += inc[0]; a1 += inc[1]; a2 += inc[2]; b1 += inc[3]; b2 += inc[4];
                 
                 out[i+1] = y1 = (a0 * (i1 = out[i+1])) + (a1 * i0) + (a2 * i3) - (b1 * y0) - (b2 * y1);
-                a1 += a1inc; a2 += a2inc; a0 += a0inc; b1 += b1inc; b2 += b2inc;
+                a0 += inc[0]; a1 += inc[1]; a2 += inc[2]; b1 += inc[3]; b2 += inc[4];
                 
                 out[i+2] = y0 = (a0 * (i2 = out[i+2])) + (a1 * i1) + (a2 * i0) - (b1 * y1) - (b2 * y0);
-                a1 += a1inc; a2 += a2inc; a0 += a0inc; b1 += b1inc; b2 += b2inc;
+                a0 += inc[0]; a1 += inc[1]; a2 += inc[2]; b1 += inc[3]; b2 += inc[4];
                 
                 out[i+3] = y1 = (a0 * (i3 = out[i+3])) + (a1 * i2) + (a2 * i1) - (b1 * y0) - (b2 * y1);
-                a1 += a1inc; a2 += a2inc; a0 += a0inc; b1 += b1inc; b2 += b2inc;
+                a0 += inc[0]; a1 += inc[1]; a2 += inc[2]; b1 += inc[3]; b2 += inc[4];
                 
             } // Interpolation loop
             
@@ -451,23 +387,11 @@ void peqbank_perform64_smooth(t_peqbank *x, t_object *dsp64, double **ins, long
             k ++;
             
         } // cascade loop
-        
-        
-        // Now that we've made it to the end of the signal vector, the "old" coefficients are
-        // the ones we just used.  The previous "old" coeffients, which we've now finished
-        // interpolating away from, are not needed any more.
-        
-        if (x->freecoeff != 0) {
-            object_post((t_object *)x, "peqbank~: disaster (smooth)!  freecoeff should be zero now!");
-        }
-        
-#ifdef DEBUG	
-        x->testcoeff3 = x->oldcoeff[3];
-#endif
-        
-        x->freecoeff = x->oldcoeff;
-        x->oldcoeff = mycoeff;		
     }
+    
+    // Now that we've made it to the end of the signal vector, the "old" coefficients are
+    // the ones we just used.
+    DoneWithPreviousParams(&x->pp);
 }
 /*
 t_int *peqbank_perform_smooth(t_int *w) {
@@ -591,17 +515,10 @@ t_int *peqbank_perform_smooth(t_int *w) {
 */
 void peqbank_perform64_fast(t_peqbank *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
 {
-    do_peqbank_perform64_fast(x, dsp64, ins, numins, outs, numouts, sampleframes, flags, x->coeff);
-    
-    // We still have to shuffle the coeff pointers around.
+    do_peqbank_perform64_fast(x, dsp64, ins, numins, outs, numouts, sampleframes, flags, (t_peqcoeffs *) GetCurrentParams(&x->pp));
     
-    if (x->coeff != x->oldcoeff) {
-        if (x->freecoeff != 0) {
-            object_post((t_object *)x, "peqbank~: disaster (fast)!  freecoeff should be zero now!");
-        }
-        x->freecoeff = x->oldcoeff;
-        x->oldcoeff = x->coeff;		
-    }
+    // We still have to let go of the previous coefficients.
+    DoneWithPreviousParams(&x->pp);
 }
 /*
 t_int *peqbank_perform_fast(t_int *w) {
@@ -623,7 +540,7 @@ t_int *peqbank_perform_fast(t_int *w) {
 	return result;	
 }
 */
-void do_peqbank_perform64_fast(t_peqbank *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, double *mycoeff)
+void do_peqbank_perform64_fast(t_peqbank *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, t_peqcoeffs *mycoeff)
 {
     //t_float *in  = (t_float *)(w[1]);
     //t_float *out = (t_float *)(w[2]);
@@ -644,18 +561,18 @@ void do_peqbank_perform64_fast(t_peqbank *x, t_object *dsp64, double **ins, long
     }
     
     // Cascade of Biquads
-    for (j=x->b_start; j<(x->b_nbpeq+1)*NBCOEFF; j+=NBCOEFF) {
+    for (j=mycoeff->start; j<(mycoeff->nbpeq+1)*NBCOEFF; j+=NBCOEFF) {
         
         xm2 = x->b_xm2[k];
         xm1 = x->b_xm1[k];
         ym2 = x->b_ym2[k];
         ym1 = x->b_ym1[k];
         
-        a0 = mycoeff[j  ];
-        a1 = mycoeff[j+1];
-        a2 = mycoeff[j+2];
-        b1 = mycoeff[j+3];
-        b2 = mycoeff[j+4];
+        a0 = mycoeff->coeff[j  ];
+        a1 = mycoeff->coeff[j+1];
+        a2 = mycoeff->coeff[j+2];
+        b1 = mycoeff->coeff[j+3];
+        b2 = mycoeff->coeff[j+4];
         
         for (i=0; i<n; i++) {
             xn = out[i];
@@ -729,17 +646,10 @@ t_int *do_peqbank_perform_fast(t_int *w, float *mycoeff) {
 */
 void peqbank_perform64_fast_multi(t_peqbank *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
 {
-    do_peqbank_perform64_fast_multi(x, dsp64, ins, numins, outs, numouts, sampleframes, flags, x->coeff);
-    
-    /* We still have to shuffle the coeff pointers around. */
+    do_peqbank_perform64_fast_multi(x, dsp64, ins, numins, outs, numouts, sampleframes, flags, (t_peqcoeffs *) GetCurrentParams(&x->pp));
     
-    if (x->coeff != x->oldcoeff) {
-        if (x->freecoeff != 0) {
-            object_post((t_object *)x, "peqbank~: disaster (fast)!  freecoeff should be zero now!");
-        }
-        x->freecoeff = x->oldcoeff;
-        x->oldcoeff = x->coeff;		
-    }
+    /* We still have to let go of the previous coefficients. */
+    DoneWithPreviousParams(&x->pp);
 }
 /*
 t_int *peqbank_perform_fast_multi(t_int *w) {
@@ -761,7 +671,7 @@ t_int *peqbank_perform_fast_multi(t_int *w) {
 	return w + 2;	
 }
 */
-void do_peqbank_perform64_fast_multi(t_peqbank *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, double *mycoeff)
+void do_peqbank_perform64_fast_multi(t_peqbank *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, t_peqcoeffs *mycoeff)
 {
     int n = sampleframes;
     
@@ -780,7 +690,7 @@ void do_peqbank_perform64_fast_multi(t_peqbank *x, t_object *dsp64, double **ins
     }
     
     /* Cascade of Biquads */
-    for (j=x->b_start; j < (x->b_nbpeq+1)*NBCOEFF; j+=NBCOEFF) {
+    for (j=mycoeff->start; j < (mycoeff->nbpeq+1)*NBCOEFF; j+=NBCOEFF) {
         
         for(c = 0; c < x->b_channels; c++) {
             xm2[c] = x->b_xm2[k*x->b_channels + c];
@@ -789,11 +699,11 @@ void do_peqbank_perform64_fast_multi(t_peqbank *x, t_object *dsp64, double **ins
             ym1[c] = x->b_ym1[k*x->b_channels + c];
         }
         
-        a0 = mycoeff[j  ];
-        a1 = mycoeff[j+1];
-        a2 = mycoeff[j+2];
-        b1 = mycoeff[j+3];
-        b2 = mycoeff[j+4];
+        a0 = mycoeff->coeff[j  ];
+        a1 = mycoeff->coeff[j+1];
+        a2 = mycoeff->coeff[j+2];
+        b1 = mycoeff->coeff[j+3];
+        b2 = mycoeff->coeff[j+4];
         
         for (i=0; i < n; i++) {
             
@@ -1000,18 +910,8 @@ void peqbank_reset(t_peqbank *x) {
 	if(x->oldparam){
 		memset(x->oldparam, 0, x->b_max * NBPARAM * sizeof(double));
 	}
-	if(x->coeff){
-		memset(x->coeff, 0, x->b_max * NBCOEFF * sizeof(double));
-	}
-	if(x->oldcoeff){
-		memset(x->oldcoeff, 0, x->b_max * NBCOEFF * sizeof(double));
-	}
-	if(x->newcoeff){
-		memset(x->newcoeff, 0, x->b_max * NBCOEFF * sizeof(double));
-	}
-	if(x->freecoeff){
-		memset(x->freecoeff, 0, x->b_max * NBCOEFF * sizeof(double));
-	}
+	// The coefficient blocks may be in use by the perform routine; peqbank_compute()
+	// below hands it a fresh one.
 	if(x->b_ym1){
 		memset(x->b_ym1, 0, x->b_max * x->b_channels * sizeof(double));
 	}
@@ -1177,6 +1077,7 @@ void peqbank_list(t_peqbank *x, t_symbol *s, short argc, t_atom *argv) {
 
 void peqbank_biquads(t_peqbank *x, t_symbol *s, short argc, t_atom *argv) {
 	int i;
+	t_peqcoeffs *nc;
 	
 	for (i = 0; i < argc; ++i) {
 		if (argv[i].a_type == A_SYM) {
@@ -1196,15 +1097,14 @@ void peqbank_biquads(t_peqbank *x, t_symbol *s, short argc, t_atom *argv) {
 		return;
 	}
 	
+	nc = (t_peqcoeffs *) CheckOutParamBlock(&x->pp);
 	for (i = 0; i < argc; ++i) {
-		x->newcoeff[i] = ASFLOAT(argv[i]);
+		nc->coeff[i] = ASFLOAT(argv[i]);
 	}
 
-
-	/* These should happen atomically... */
 	x->b_start = 0;
 	x->b_nbpeq = (argc/5)-1;    /* The first biquad is the "shelf"; the other n-1 are the "peq"s */
-	swap_in_new_coeffs(x);	
+	swap_in_new_coeffs(x, nc);	
 }		
 		
 void peqbank_cheby(t_peqbank *x, t_symbol *s, short argc, t_atom *argv) {
@@ -1278,6 +1178,7 @@ int peqbank_cheby_coeffs(t_peqbank *x, double freq, int type, int order, double
 	double RP, IP, ES, VX, KX, T, W, M, D, K, X0, X1, X2, Y1, Y2;
 	double GAIN;
 	unsigned int LH, NP, P;
+	t_peqcoeffs *nc;
 
 	FC = freq;
 	LH = type;
@@ -1318,6 +1219,8 @@ int peqbank_cheby_coeffs(t_peqbank *x, double freq, int type, int order, double
 }
 	else
 	{
+		nc = (t_peqcoeffs *) CheckOutParamBlock(&x->pp);
+		
 		//	fprintf(stderr, "cheby: calculating biquad coefficients, FC = %f\n",FC);
 		for (P=0;P<NP/2;P++)
 		{
@@ -1372,17 +1275,16 @@ int peqbank_cheby_coeffs(t_peqbank *x, double freq, int type, int order, double
 			
 			// fprintf(stderr, "coeffs: %f %f %f %f %f : gain %f\n",A0*GAIN,A1*GAIN,A2*GAIN,B1*GAIN,B2*GAIN, GAIN);
 			
-			x->newcoeff[(P*5)]   = A0 * GAIN;
-			x->newcoeff[(P*5)+1] = A1 * GAIN;
-			x->newcoeff[(P*5)+2] = A2 * GAIN;
-			x->newcoeff[(P*5)+3] = -B1;
-			x->newcoeff[(P*5)+4] = -B2;
+			nc->coeff[(P*5)]   = A0 * GAIN;
+			nc->coeff[(P*5)+1] = A1 * GAIN;
+			nc->coeff[(P*5)+2] = A2 * GAIN;
+			nc->coeff[(P*5)+3] = -B1;
+			nc->coeff[(P*5)+4] = -B2;
 		}
 		
-		/* These should happen atomically... */
 		x->b_start = 0;
 		x->b_nbpeq = P-1;    /* The first biquad is the "shelf"; the other n-1 are the "peq"s */
-		swap_in_new_coeffs(x);
+		swap_in_new_coeffs(x, nc);
 		
 		return 0;
 	}
@@ -1396,7 +1298,6 @@ void peqbank_init(t_peqbank *x) {
 	for (i=0; i<x->b_max * NBPARAM; ++i) {
 		x->param[i]    = 0.0;
 		x->oldparam[i] = 0.0;
-		x->coeff[i]    = 0.0;
 	}
 	
 	for (i=0; i < (x->b_max * x->b_channels); ++i) {
@@ -1405,10 +1306,6 @@ void peqbank_init(t_peqbank *x) {
 		x->b_xm1[i] = 0.0;
 		x->b_xm2[i] = 0.0;
 	}
-	
-#ifdef DEBUG
-	x->testcoeff3 = 0.0;
-#endif
 }
 
 void peqbank_assist(t_peqbank *x, void *b, long m, long a, char *s) 
@@ -1488,13 +1385,21 @@ void *peqbank_new(t_symbol *s, short argc, t_atom *argv) {
 }
 
 void peqbank_allocmem(t_peqbank *x){
+	int i, nomem = 0;
+	
 	/* alocate and initialize memory */
 	x->param    = (double*) sysmem_newptr( x->b_max * NBPARAM * sizeof(*x->param) );
 	x->oldparam = (double*) sysmem_newptr( x->b_max * NBPARAM * sizeof(*x->oldparam) );
-	x->coeff    = (double*) sysmem_newptr( x->b_max * NBCOEFF * sizeof(*x->coeff) );
-	x->oldcoeff = x->coeff;
-	x->newcoeff = (double*) sysmem_newptr( x->b_max * NBCOEFF * sizeof(*x->newcoeff) );
-	x->freecoeff = (double*) sysmem_newptr( x->b_max * NBCOEFF * sizeof(*x->freecoeff) );
+	for (i = 0; i < PARAM_NUM_BLOCKS; ++i) {
+		x->coeffblocks[i] = (t_peqcoeffs *) sysmem_newptrclear( sizeof(t_peqcoeffs) + (x->b_max * NBCOEFF - 1) * sizeof(double) );
+		if (x->coeffblocks[i] == NIL) nomem = 1;
+	}
+	if (!nomem) {
+		// Empty cascade until the first coefficients come in
+		x->coeffblocks[0]->start = NBCOEFF;
+		x->coeffblocks[0]->nbpeq = 0;
+		InitParamPointers(&x->pp, x->coeffblocks[0], x->coeffblocks[1], x->coeffblocks[2], x->coeffblocks[3]);
+	}
 	x->b_ym1    = (double*) sysmem_newptr( x->b_max * x->b_channels * sizeof(*x->b_ym1) );
 	x->b_ym2    = (double*) sysmem_newptr( x->b_max * x->b_channels * sizeof(*x->b_ym2) );     
 	x->b_xm1    = (double*) sysmem_newptr( x->b_max * x->b_channels * sizeof(*x->b_xm1) );
@@ -1503,21 +1408,22 @@ void peqbank_allocmem(t_peqbank *x){
     //x->s_vec_out = (t_float**) sysmem_newptr( x->b_channels * sizeof(t_float*));
 	x->myList   = (t_atom*)  sysmem_newptr( x->b_max * NBCOEFF * sizeof(*x->myList) );     
 
-	if (x->param == NIL || x->oldparam == NIL || x->coeff == NIL || x->newcoeff == NIL ||
-	    x->freecoeff == NIL || x->b_ym1 == NIL || x->b_ym2 == NIL || x->b_xm1 == NIL || 
+	if (x->param == NIL || x->oldparam == NIL || nomem || x->b_ym1 == NIL || x->b_ym2 == NIL || x->b_xm1 == NIL || 
 	    x->b_xm2 == NIL || x->myList == NIL) {
 		object_post((t_object *)x, "peqbank~: warning: not enough memory.  Expect to crash soon.");
 	}
 }
 
 void peqbank_freemem(t_peqbank *x){
+	int i;
+	
 	sysmem_freeptr((char *) x->param);
 	sysmem_freeptr((char *) x->oldparam);
 
-	if (x->coeff != x->oldcoeff) sysmem_freeptr((char *) x->oldcoeff);
-	sysmem_freeptr((char *) x->coeff);
-	sysmem_freeptr((char *) x->newcoeff);
-	if (x->freecoeff) sysmem_freeptr((char *) x->freecoeff);
+	for (i = 0; i < PARAM_NUM_BLOCKS; ++i) {
+		if (x->coeffblocks[i]) sysmem_freeptr((char *) x->coeffblocks[i]);
+		x->coeffblocks[i] = 0;
+	}
 
 	sysmem_freeptr((char *) x->b_ym1);
 	sysmem_freeptr((char *) x->b_ym2);
@@ -1537,6 +1443,7 @@ void  peqbank_free(t_peqbank *x) {
 
 void peqbank_compute(t_peqbank *x) {		
 	int i;
+	t_peqcoeffs *nc;
 	
 #ifdef WORRIED_ABOUT_PEQBANK_REENTRANCY
 	if (x->already_peqbank_compute) {
@@ -1548,10 +1455,13 @@ void peqbank_compute(t_peqbank *x) {
 	x->already_peqbank_compute = 1;
 #endif
 
+	// The perform routine never sees this block until we check it in
+	nc = (t_peqcoeffs *) CheckOutParamBlock(&x->pp);
+
  startover:
-	// Do the actual computation of coefficients, into x->newcoeff
-	compute_shelf(x);
-	for (i=NBPARAM; i<(x->b_nbpeq+1)*NBPARAM; i+=NBPARAM) compute_parameq(x,i);
+	// Do the actual computation of coefficients
+	compute_shelf(x, nc->coeff);
+	for (i=NBPARAM; i<(x->b_nbpeq+1)*NBPARAM; i+=NBPARAM) compute_parameq(x, i, nc->coeff);
 
 	if (x->need_to_recompute) {
 	  // This procedure was called while the previous invocation
@@ -1561,7 +1471,7 @@ void peqbank_compute(t_peqbank *x) {
 	  goto startover;
 	}
 
-	swap_in_new_coeffs(x);
+	swap_in_new_coeffs(x, nc);
 
 #ifdef WORRIED_ABOUT_PEQBANK_REENTRANCY
 	x->already_peqbank_compute = 0;
@@ -1569,67 +1479,25 @@ void peqbank_compute(t_peqbank *x) {
 }
 
 
-void swap_in_new_coeffs(t_peqbank *x) {
-	double *prevcoeffs, *prevnew, *prevfree;
+void swap_in_new_coeffs(t_peqbank *x, t_peqcoeffs *nc) {
 	int i;
 
-	// To make the new coefficients take effect we swap around the pointers to the
-	// coefficient buffers.  See the large comment at the top of this file.
-	// The audio processing interrupt might come at any time.
+	// nc is the block we got from CheckOutParamBlock(); the shape of the cascade
+	// travels with the coefficients so the perform routine always sees a matching set.
+	nc->start = x->b_start;
+	nc->nbpeq = x->b_nbpeq;
 	
-	if (x->coeff == x->oldcoeff) {
-		// Normal case: these are the first new coeffients since the last perform routine		
-
-#ifdef DEBUG		
-		if (!test_normal_state(x)) post("peqbank_compute: x->coeff == x->oldcoeff");
-#endif
-
-		if (x->freecoeff == 0) {
-			object_post((t_object *)x, "peqbank: disaster!  freecoeff shouldn't be zero here!");
-			   post("  coeff = %p, oldcoeff = %p, newcoeff = %p, freecoeff = %p",
-   					x->coeff, x->oldcoeff, x->newcoeff, x->freecoeff);
-
-		}
-		prevcoeffs = x->coeff;
-		prevnew = x->newcoeff;
-		prevfree = x->freecoeff;
-		
-		x->freecoeff = 0;
-		x->coeff = x->newcoeff;	// Now if we're interrupted the new values will be used.
-		x->newcoeff = prevfree;
-
-#ifdef DEBUG		
-		if (!test_newcoeffs_state(x)) post("peqbank_compute: just set first new coeffs");
-#endif
-
-	} else {
-		// We already computed new coeffients since the last perform routine, and now we
-		// have even newer ones.  The perform routine may have interrupted this procedure
-		// already, but it only would have changed oldcoeffs and freecoeffs.
-
-#ifdef DEBUG		
-		if (!test_newcoeffs_state(x)) post("peqbank_compute: x->coeff != x->oldcoeff");
-#endif
-		
-		prevcoeffs = x->coeff;
-		prevnew = x->newcoeff;
-		
-		x->coeff = x->newcoeff;
-		x->newcoeff = prevcoeffs;
-
-#ifdef DEBUG		
-		if (!test_newcoeffs_state(x)) post("peqbank_compute: just set new new coeffs");
-#endif
-	}
+	// The audio processing interrupt might come at any time; from here on it may use nc.
+	CheckInNewParams(&x->pp);
 
 	// Output the new coefficients out the outlet
-	for (i=0; i<(x->b_nbpeq+1)*NBPARAM; i++) atom_setfloat(x->myList+i, x->coeff[i]);		
+	for (i=0; i<(x->b_nbpeq+1)*NBPARAM; i++) atom_setfloat(x->myList+i, nc->coeff[i]);		
 	outlet_list(x->b_outlet, 0L, (x->b_nbpeq+1)*NBPARAM, x->myList);
 }
 
 
 
-void compute_parameq(t_peqbank *x, int index) {
+void compute_parameq(t_peqbank *x, int index, double *newcoeff) {
 	
 	/* Biquad coefficient estimation */
 	double G0 = pow10(x->param[index+2] * 0.05);
@@ -1679,14 +1547,14 @@ void compute_parameq(t_peqbank *x, int index) {
 	double val10 = 1.0 / (1.0 + W2 + A);
     
    	/* New values */
- 	x->newcoeff[index  ] = (G1 + G0 * W2 + B)     * val10; 
-	x->newcoeff[index+1] = -2.0 * (G1 - G0 * W2) * val10;
-	x->newcoeff[index+2] = (G1 - B + G0 * W2)     * val10;
-	x->newcoeff[index+3] = -2.0 * (1.0 - W2)    * val10;
-	x->newcoeff[index+4] = (1.0 + W2 - A)        * val10;
+ 	newcoeff[index  ] = (G1 + G0 * W2 + B)     * val10; 
+	newcoeff[index+1] = -2.0 * (G1 - G0 * W2) * val10;
+	newcoeff[index+2] = (G1 - B + G0 * W2)     * val10;
+	newcoeff[index+3] = -2.0 * (1.0 - W2)    * val10;
+	newcoeff[index+4] = (1.0 + W2 - A)        * val10;
 }
 
-void compute_shelf(t_peqbank *x) {
+void compute_shelf(t_peqbank *x, double *newcoeff) {
 	
 	/* Biquad coefficient estimation */	
 	double G1 = pow10((x->param[0] - x->param[1]) * 0.05);
@@ -1708,11 +1576,11 @@ void compute_shelf(t_peqbank *x) {
 	double C0 = L3 * H3 * Gh;
   
     /* New values */
- 	x->newcoeff[0] = C0; 
-	x->newcoeff[1] = C0 * (L2 + H2);
-	x->newcoeff[2] = C0 * L2 * H2;
-	x->newcoeff[3] = L1 + H1;
-	x->newcoeff[4] = L1 * H1;
+ 	newcoeff[0] = C0; 
+	newcoeff[1] = C0 * (L2 + H2);
+	newcoeff[2] = C0 * L2 * H2;
+	newcoeff[3] = L1 + H1;
+	newcoeff[4] = L1 * H1;
 }
 
 double pow10(double x) {
@@ -1723,32 +1591,3 @@ double pow2(double x) {
 	return exp(LOG_2 * x);
 }
 
-
-#define YUCKKYIF(test) if (test) {post(" normal:  " #test); ok = 0;}
-int test_normal_state(t_peqbank *x) {
-	int ok = 1;
-	YUCKKYIF (x->coeff == 0)
-	YUCKKYIF (x->oldcoeff == 0)
-	YUCKKYIF (x->coeff != x->oldcoeff) 
-	YUCKKYIF (x->newcoeff == 0) 
-	YUCKKYIF (x->freecoeff == 0) 
-	YUCKKYIF (x->coeff == x->newcoeff)
-	YUCKKYIF (x->coeff == x->freecoeff)
-	YUCKKYIF (x->newcoeff == x->freecoeff)
-
-	return ok;
-}
-
-int test_newcoeffs_state(t_peqbank *x) {
-	int ok = 1;
-	YUCKKYIF (x->oldcoeff == 0)
-	YUCKKYIF (x->coeff == 0)
-	YUCKKYIF (x->newcoeff == 0) 
-	YUCKKYIF (x->freecoeff != 0)
-	
-	YUCKKYIF (x->coeff == x->oldcoeff)
-	YUCKKYIF (x->coeff == x->newcoeff)
-	YUCKKYIF (x->newcoeff == x->oldcoeff)
-
-	return ok;
-}
@@ -61,16 +61,11 @@
 #include "version.h"
 
 #include "z_dsp.h"
-#include "fft.h"
+#include "cnmat_fft.h"
 #include <string.h>
 #include <math.h>
 #include <inttypes.h>
 
-// Add altivec function prototypes
-#ifdef __ALTIVEC__
-#include "vDSP.h"
-#endif
-
 #define DEBUG
 #ifdef DEBUG
 #define debug if (x->x_debug) post
@@ -226,7 +221,7 @@ typedef struct _pitch {
     t_float *BufFFT;		// FFT buffer
     t_float *BufPower;		// Power spectrum buffer
     t_float *WindFFT;		// Window of FFTSize
-    t_float *memFFT;		// fft.c memory space
+    t_cnmat_fftplan *fftplan;	// Shared FFT plan (see lib/cnmat_fft.h)
     t_peakout *peakBuf;		// Spectral peaks for output
     t_float *histBuf;		// Histogram Buffer
 
@@ -241,14 +236,6 @@ typedef struct _pitch {
     void *x_pitchout;
 	void *x_clock;			// Use a clock for outputs... (better than Qelem)
 
-#ifdef __ALTIVEC__ // Additional stuff for managing the G4-optimized FFT by Apple
-#pragma altivec_model on
-	t_float x_scaleFactor;
-	uint32_t x_log2n;
-    COMPLEX_SPLIT x_A;
-	FFTSetup x_setup;
-#pragma altivec_model off
-#endif
 		
 } t_pitch;
 
@@ -280,11 +267,6 @@ t_float pitch_ftom(t_float f);
 t_int pitch_ilog2(t_int n);
 void pitch_getit(t_pitch *x); // modified fiddle pitch tracker function
 
-#ifdef __ALTIVEC__
-void pitch_tick_G4(t_pitch *x);
-long log2max(long n);
-#endif
-
 int main(void){
 
 	//post("Pitch~ object version " VERSION " by Tristan Jehan and Michael Zbyszynski");
@@ -390,6 +372,7 @@ void pitch_dsp(t_pitch *x, t_signal **sp, short *connect) {
 	x->x_counter = x->x_delay;
 
 	if (vs > x->BufSize) post("Pitch~: You need to use a smaller signal vector size...");
+	else if (x->fftplan == NULL || x->BufFFT == NULL) object_error((t_object *)x, "Pitch~: no FFT, not analyzing");
 	else if (connect[0]) dsp_add(pitch_perform, 3, sp[0]->s_vec, x, sp[0]->s_n);
 }
 
@@ -785,6 +768,7 @@ void *pitch_new(t_symbol *s, short argc, t_atom *argv) {
 	else if ((x->FFTSize > 512) && (x->FFTSize < 1024)) x->FFTSize = 1024;
 	else if ((x->FFTSize > 1024) && (x->FFTSize < 2048)) x->FFTSize = 2048;
 	else if ((x->FFTSize > 2048) && (x->FFTSize < 4096)) x->FFTSize = 4096;
+	else if ((x->FFTSize > 4096) && (x->FFTSize < 8192)) x->FFTSize = 8192;
 	else if ((x->FFTSize > 8192) && (x->FFTSize < 16384)) x->FFTSize = 16384;
 	else if ((x->FFTSize > 16384) && (x->FFTSize < 32768)) x->FFTSize = 32768;
 	else if ((x->FFTSize > 32768) && (x->FFTSize < 65536)) x->FFTSize = 65536;
@@ -792,6 +776,11 @@ void *pitch_new(t_symbol *s, short argc, t_atom *argv) {
 		object_post((t_object *)x, "Pitch~: Maximum FFT size is 65536 samples");
 		x->FFTSize = 65536;
 	}
+	if (x->FFTSize & (x->FFTSize - 1)) { // cnmat_fft only does powers of two
+		for (i = CNMAT_FFT_MINSIZE; i < x->FFTSize; i <<= 1);
+		object_post((t_object *)x, "Pitch~: FFT size rounded up to %d", i);
+		x->FFTSize = i;
+	}
 	
 	// Overlap case
 	if (x->x_overlap > x->BufSize-vs) {
@@ -813,34 +802,16 @@ void *pitch_new(t_symbol *s, short argc, t_atom *argv) {
 	object_post((t_object *)x, "	Number of peaks to search = %d",x->x_npeakanal);
 	object_post((t_object *)x, "	Number of peaks to output = %d",x->x_npeakout);
 
-	// Here comes the choice for altivec optimization or not...
-	if (sys_optimize()) { // note that we DON'T divide the vector size by four here
-
-#ifdef __ALTIVEC__ // More code and a new ptr so that x->BufFFT is vector aligned.
-#pragma altivec_model on 
-		x->x_clock = clock_new(x,(method)pitch_tick_G4); // Call altivec-optimized tick function
-		object_post((t_object *)x, "	Using G4-optimized FFT");	
-		// Allocate some memory for the altivec FFT
-		x->x_A.realp = t_getbytes(x->x_FFTSizeOver2 * sizeof(t_float));
-		x->x_A.imagp = t_getbytes(x->x_FFTSizeOver2 * sizeof(t_float));
-		x->x_log2n = log2max(x->FFTSize);
-      	x->x_setup = create_fftsetup (x->x_log2n, 0);
-    	x->x_scaleFactor = (t_float)1.0/(2.0*x->FFTSize);
-#pragma altivec_model off
-#else
-		object_error((t_object *)x, "  No G4 optimization available");
-#endif
-
-	} else { // Normal tick function
-		x->x_clock = clock_new(x,(method)pitch_tick);
-		x->memFFT = (t_float*) sysmem_newptr(CMAX * x->FFTSize * sizeof(t_float)); // memory allocated for normal fft twiddle
-	}
+	x->x_clock = clock_new(x,(method)pitch_tick);
+	x->fftplan = cnmat_fft_plan_new(x->FFTSize, CNMAT_FFT_REAL_FORWARD);
+	if (x->fftplan == NULL)
+		object_error((t_object *)x, "Pitch~: can't make an FFT of size %d", x->FFTSize);
 	object_post((t_object *)x, "");
 
 	// Allocate memory
 	x->Buf1 = (t_int*) sysmem_newptr(x->BufSize * sizeof(t_float)); // Careful these are pointers to integers but the content is floats
 	x->Buf2 = (t_int*) sysmem_newptr(x->BufSize * sizeof(t_float));
-	x->BufFFT = (t_float*) sysmem_newptr(x->FFTSize * sizeof(t_float));
+	x->BufFFT = cnmat_fft_buffer_new(x->FFTSize);
 	x->BufPower = (t_float*) sysmem_newptr((x->FFTSize/2) * sizeof(t_float));
 	x->WindFFT = (t_float*) sysmem_newptr(x->BufSize * sizeof(t_float));
 	x->peakBuf = (t_peakout*) sysmem_newptr(x->x_npeakout * sizeof(t_peakout)); // from Fiddle~
@@ -887,19 +858,11 @@ void  pitch_free(t_pitch *x) {
 
 dsp_free((t_pxobject *)x);
 
-#ifdef __ALTIVEC__
-#pragma altivec_model on
-	if (x->x_A.realp) t_freebytes(x->x_A.realp, x->x_FFTSizeOver2);
-	if (x->x_A.imagp) t_freebytes(x->x_A.imagp, x->x_FFTSizeOver2);
-	if (x->x_setup) destroy_fftsetup(x->x_setup);
-#pragma altivec_model off
-#else
-	if (x->memFFT != NULL) sysmem_freeptr((char *) x->memFFT);
-#endif		
+	cnmat_fft_plan_free(x->fftplan);
 	
 	if (x->Buf1 != NULL) sysmem_freeptr((char *) x->Buf1);
 	if (x->Buf2 != NULL) sysmem_freeptr((char *) x->Buf2);
-	if (x->BufFFT != NULL) sysmem_freeptr((char *) x->BufFFT);
+	if (x->BufFFT != NULL) cnmat_fft_buffer_free(x->BufFFT);
 	if (x->BufPower != NULL) sysmem_freeptr((char *) x->BufPower);
 	if (x->WindFFT != NULL) sysmem_freeptr((char *) x->WindFFT);
 	if (x->peakBuf != NULL) sysmem_freeptr((char *) x->peakBuf);
@@ -925,105 +888,7 @@ void pitch_tick(t_pitch *x) {
 			x->BufFFT[i] *= x->WindFFT[i];
 			
 	// FFT
-	fftRealfast(x->FFTSize, x->BufFFT, x->memFFT);
-		
-	// Squared Absolute
-	for (i=0; i<x->FFTSize; i+=2) 
-		x->BufPower[i/2] = (x->BufFFT[i] * x->BufFFT[i]) + (x->BufFFT[i+1] * x->BufFFT[i+1]);
-		
-	// Go into fiddle~ code
-	pitch_getit(x);
-	
-	// Output results
-    if (x->x_npeakout) { // Output peaks
-    	t_peakout *po;
-    	for (i=0, po=x->peakBuf; i<x->x_npeakout; i++, po++) {
-			t_atom at[3];
-	    	atom_setlong(at, i+1);
-	    	atom_setfloat(at+1, po->po_freq);
-	    	atom_setfloat(at+2, po->po_amp);
-	    	outlet_list(x->x_peakout, 0, 3, at);
-		}
-    }
-  
-    // Output amplitude 
-    outlet_float(x->x_envout, x->x_dbs[x->x_histphase]);
-    
-    // Output fundamental frequencies + amplitudes
-    if (x->x_npitch > 1) {
-		for (i=0,  ph=x->x_hist; i<x->x_npitch; i++, ph++) {
-			t_atom at[3];
-			atom_setlong(at, i+1);
-			atom_setfloat(at+1, ph->h_pitches[x->x_histphase]);
-			atom_setfloat(at+2, ph->h_amps[x->x_histphase]);
-			outlet_list(x->x_pitchout, 0, 3, at);
-   		}
-   	} else {
-		for (i=0,  ph=x->x_hist; i<x->x_npitch; i++, ph++) {
-			t_atom at[2];
-			atom_setfloat(at, ph->h_pitches[x->x_histphase]);
-			atom_setfloat(at+1, ph->h_amps[x->x_histphase]);
-			outlet_list(x->x_pitchout, 0, 2, at);
-   		}
-	}   	
-       
-    // Output cooked MIDI/Frequency pitch
-    if (x->x_npitch > 1) {
-	    for (i=0, ph=x->x_hist; i<x->x_npitch; i++, ph++)
- 			if (ph->h_pitch) {
-				t_atom at[3];
-				atom_setlong(at, i+1);
-				atom_setfloat(at+1, ph->h_pitch);
-				atom_setfloat(at+2, mtof(ph->h_pitch));
-				outlet_list(x->x_noteout, 0, 3, at);
-			}
-	} else {
-		ph = x->x_hist;
- 		if (ph->h_pitch) {
-			t_atom at[2];
-			atom_setfloat(at, ph->h_pitch);
-			atom_setfloat(at+1, mtof(ph->h_pitch));
-			outlet_list(x->x_noteout, 0, 2, at);
-		}
-	}
-			
-    // Output attack bang 
-    if (x->x_attackvalue) outlet_bang(x->x_attackout);
-
-}
-
-#ifdef __ALTIVEC__
-void pitch_tick_G4(t_pitch *x) {
-
-	t_int halfFFTSize = x->FFTSize/2;
-	t_float FsOverFFTSize = x->x_Fs/((t_float)x->FFTSize);
-    t_pitchhist *ph;
-	t_int i;
-		
-	// Zero padding
-	for (i=x->BufSize; i<x->FFTSize; i++)
-		x->BufFFT[i] = 0.0f;
-
-	// Window the samples
-	if (x->x_window != Recta)
-		for (i=0; i<x->BufSize; ++i)
-			x->BufFFT[i] *= x->WindFFT[i];
-			
-    // Look at the real signal as an interleaved complex vector by casting it.
-    // Then call the transformation function ctoz to get a split complex vector,
-    // which for a real signal, divides into an even-odd configuration.
-    ctoz ((COMPLEX *) x->BufFFT, 2, &x->x_A, 1, x->x_FFTSizeOver2);
-      
-    // Carry out a Forward FFT transform
-    fft_zrip(x->x_setup, &x->x_A, 1, x->x_log2n, FFT_FORWARD);
-
-	// Fast rescaling required
-//    vsmul( x->x_A.realp, 1, &x->x_scaleFactor, x->x_A.realp, 1, x->x_FFTSizeOver2);
-//    vsmul( x->x_A.imagp, 1, &x->x_scaleFactor, x->x_A.imagp, 1, x->x_FFTSizeOver2);
-
-    // The output signal is now in a split real form.  Use the function
-    // ztoc to get a split real vector.
-    ztoc ( &x->x_A, 1, (COMPLEX *) x->BufFFT, 2, x->x_FFTSizeOver2);
+	cnmat_fft_execute(x->fftplan, x->BufFFT);
 		
 	// Squared Absolute
 	for (i=0; i<x->FFTSize; i+=2) 
@@ -1089,7 +954,6 @@ void pitch_tick_G4(t_pitch *x) {
     if (x->x_attackvalue) outlet_bang(x->x_attackout);
 
 }
-#endif // __ALTIVEC__
 
 // Convert from MIDI to Hz and Hz to MIDI
 t_float pitch_mtof(t_float f) {
@@ -1484,16 +1348,3 @@ void pitch_getit(t_pitch *x)
 
 	return;
 }
-
-// Computes the ceiling of log2(n) 
-// i.e. log2max(7) = 3, log2max(8) = 3, log2max(9) = 4
-long log2max(long n) {
-	
-	long power = 1;
-	long k = 1;
-	
-	if (n==1) return 0;
-	while ((k <<= 1) < n) power++;
-	
-	return power;
-}
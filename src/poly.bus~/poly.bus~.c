@@ -29,6 +29,7 @@ SVN_REVISION: $LastChangedRevision: 587 $
 VERSION 0.0: First try
 VERSION 0.0.1: New help file
 VERSION 0.1: Fixed a memory leak and made it so that you can safely have 2 of them running at once
+VERSION 0.2: Per-voice accumulation slots for poly~ @parallel 1, summed in voice order
 @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 */
 #define NAME "poly.bus~"
@@ -42,6 +43,7 @@ VERSION 0.1: Fixed a memory leak and made it so that you can safely have 2 of th
 #include "ext_obex.h"
 #include "ext_obex_util.h"
 #include "z_dsp.h"
+#include "polybus.h"
 
 
 typedef struct _pbus{
@@ -97,41 +99,55 @@ void pbus_perform64(t_pbus *x, t_object *dsp64, double **ins, long numins, doubl
 void pbus_dsp64(t_pbus *x, t_object *dsp64, short *count, double samplerate, long maxvectorsize, long flags)
 {
     for(int i = 0; i < x->num_channels; i++){
-        //x->sv[i] = sp[i + 1]->s_vec;
-        if(x->blksize != maxvectorsize){
-            // block size has changed
-            // if there are multiple instances of this object, this will happen more than once, but
-            // it's cool because (from the gcc manual):
-            // If the new size you specify is the same as the old size, realloc is guaranteed to change
-            // nothing and return the same address that you gave.
-            
-            void *ptr = realloc(x->mangled_names[i]->s_thing, maxvectorsize * sizeof(double));
-            if(ptr){
-                x->mangled_names[i]->s_thing = ptr;
-            }else{
-                object_error((t_object *)x, "out of memory!");
-                x->mangled_names[i]->s_thing = NULL;
-            }
+        t_polybus *bus = polybus_get(x->mangled_names[i]);
+        if(!bus){
+            continue;
+        }
+        if(polybus_grow(bus, maxvectorsize, 0)){
+            object_error((t_object *)x, "out of memory!");
+        }
+        t_polybus_block *b = bus->block;
+        for(int k = 0; b && k < b->nslots; k++){
+            b->flags[k].dirty = 0;
         }
-        memset(x->mangled_names[i]->s_thing, '\0', sizeof(double) * maxvectorsize);
     }
     x->blksize = maxvectorsize;
     long id = (long)(x->name->s_thing);
     x->my_id = ++id;
     x->name->s_thing = (void *)id;
-    //x->samplerate = sp[0]->s_sr;
-    //dsp_add(pbus_perform, 1, x);
     object_method(dsp64, gensym("dsp_add64"), x, pbus_perform64, 0, NULL);
 }
 
+// Slots are summed in voice order whichever threads wrote them, so the output
+// doesn't depend on how poly~ spread its voices over the threads.
 void pbus_perform64(t_pbus *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
 {
+    int owner = (x->my_id == (long)(x->name->s_thing));
     for(int i = 0; i < x->num_channels; i++){
-        if(x->mangled_names[i]->s_thing){
-            memcpy(outs[i], x->mangled_names[i]->s_thing, sizeof(double) * sampleframes);
+        t_polybus *bus = polybus_get(x->mangled_names[i]);
+        t_polybus_block *b = bus ? POLYBUS_LOAD(&bus->block) : NULL;
+        if(!b || sampleframes > b->vectorsize){
+            memset(outs[i], '\0', sizeof(double) * sampleframes);
+            continue;
+        }
+        int first = 1;
+        for(int k = 0; k < b->nslots; k++){
+            if(!(b->flags[k].dirty)){
+                continue;
+            }
+            double *slot = b->slots + k * b->vectorsize;
+            if(first){
+                memcpy(outs[i], slot, sizeof(double) * sampleframes);
+                first = 0;
+            }else{
+                polybus_accumulate(outs[i], slot, sampleframes);
+            }
+            if(owner){
+                b->flags[k].dirty = 0;
+            }
         }
-        if(x->my_id == (long)(x->name->s_thing)){
-            memset(x->mangled_names[i]->s_thing, '\0', sizeof(double) * sampleframes);
+        if(first){
+            memset(outs[i], '\0', sizeof(double) * sampleframes);
         }
     }
 }
@@ -165,14 +181,15 @@ void pbus_mangle(t_pbus *x){
 void pbus_free(t_pbus *x){
 	dsp_free((t_pxobject *)x);
 	int i;
-	x->name->s_thing = x->name->s_thing - 1;
-	if(x->name->s_thing == 0){
-		for(i = 0; i < x->num_channels; i++){
-			if(x->mangled_names[i]->s_thing){
-				free(x->mangled_names[i]->s_thing);
-			}
+	x->name->s_thing = (void *)((long)(x->name->s_thing) - 1);
+	for(i = 0; i < x->num_channels; i++){
+		t_polybus *bus = polybus_get(x->mangled_names[i]);
+		if(bus && --(bus->refcount) == 0){
+			x->mangled_names[i]->s_thing = NULL;
+			polybus_free(bus);
 		}
 	}
+	free(x->mangled_names);
 }
 
 void pbus_assist(t_pbus *x, void *b, long io, long index, char *s){
@@ -205,7 +222,7 @@ void *pbus_new(t_symbol *sym, int argc, t_atom *argv){
 		dsp_setup((t_pxobject *)x, 1);
         	x->ob.z_misc = Z_NO_INPLACE;
 		x->name = atom_getsym(argv);
-		x->name->s_thing = x->name->s_thing + 1;
+		x->name->s_thing = (void *)((long)(x->name->s_thing) + 1);
 		x->num_channels = atom_getlong(argv + 1);
 		if(x->num_channels <= 0){
 			object_error((t_object *)x, "poly.bus~: number of channels must be >0");
@@ -215,6 +232,27 @@ void *pbus_new(t_symbol *sym, int argc, t_atom *argv){
 		//x->sv = (double **)calloc(x->num_channels, sizeof(double *));
 		int i;
 		pbus_mangle(x);
+		for(i = 0; i < x->num_channels; i++){
+			t_polybus *bus = polybus_get(x->mangled_names[i]);
+			if(!bus){
+				if(x->mangled_names[i]->s_thing){
+					object_error((t_object *)x, "%s is already in use by something else", x->mangled_names[i]->s_name);
+					continue;
+				}
+				bus = (t_polybus *)sysmem_newptrclear(sizeof(t_polybus));
+				if(!bus){
+					object_error((t_object *)x, "out of memory!");
+					continue;
+				}
+				bus->magic = POLYBUS_MAGIC;
+				x->mangled_names[i]->s_thing = (t_object *)bus;
+			}
+			bus->refcount++;
+			// size the slots now so that dsp64 normally has nothing to allocate
+			if(sys_getblksize() > 0){
+				polybus_grow(bus, sys_getblksize(), 0);
+			}
+		}
 		for(i = 0; i < x->num_channels; i++){
 			outlet_new(x, "signal");
 		}
@@ -0,0 +1,173 @@
+/*
+Written by John MacCallum, The Center for New Music and Audio Technologies,
+University of California, Berkeley.  Copyright (c) 2009, The Regents of
+the University of California (Regents).
+Permission to use, copy, modify, distribute, and distribute modified versions
+of this software and its documentation without fee and without a signed
+licensing agreement, is hereby granted, provided that the above copyright
+notice, this paragraph and the following two paragraphs appear in all copies,
+modifications, and distributions.
+
+IN NO EVENT SHALL REGENTS BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT,
+SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING
+OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF REGENTS HAS
+BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+REGENTS SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE. THE SOFTWARE AND ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED
+HEREUNDER IS PROVIDED "AS IS". REGENTS HAS NO OBLIGATION TO PROVIDE
+MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+*/
+
+/* The bus shared by poly.bus~ and poly.send~.
+
+   Each bus channel is a symbol "name_N" whose s_thing points at a t_polybus,
+   created by the first poly.bus~ that uses the channel and freed by the last.
+   With poly~ @parallel 1 the voices run on several threads at once, so
+   instead of one buffer that every poly.send~ adds into there is one slot per
+   poly~ voice: slot k for voice k, slot 0 for a poly.send~ that isn't in a
+   poly~.  A voice runs on one thread at a time, so nothing else writes its
+   slot, and poly.bus~ sums the slots in voice order, which gives the same
+   answer however poly~ spread the voices over its threads.
+
+   The slots live in a t_polybus_block that also records their size.  When
+   the vector size or the number of voices grows, the dsp64 method that
+   noticed builds a new block and swaps the pointer.  The old blocks are kept
+   until the bus goes away, since a perform routine from the previous DSP
+   chain may still be using one; they only ever grow, so there are few. */
+
+#ifndef __POLYBUS_H__
+#define __POLYBUS_H__
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__)
+#define POLYBUS_LOAD(p)				__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define POLYBUS_STORE(p, v)			__atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else // MSVC: volatile accesses have acquire/release semantics
+#define POLYBUS_LOAD(p)				(*(p))
+#define POLYBUS_STORE(p, v)			(*(p) = (v))
+#endif
+
+#define POLYBUS_MINSLOTS 16
+#define POLYBUS_MAGIC 0x706f6c62	/* 'polb' */
+
+/* Keep each voice's dirty flag on its own cache line so that voices on
+   different cores don't fight over it. */
+#define POLYBUS_LINE 64
+
+typedef struct _polybus_flag{
+	volatile long dirty;
+	char pad[POLYBUS_LINE - sizeof(long)];
+} t_polybus_flag;
+
+typedef struct _polybus_block{
+	long vectorsize;
+	long nslots;
+	double *slots;			// nslots * vectorsize, slot k at slots + k * vectorsize
+	t_polybus_flag *flags;	// nslots
+	struct _polybus_block *next;	// older blocks, in bus->retired
+} t_polybus_block;
+
+typedef struct _polybus{
+	long magic;
+	long refcount;			// poly.bus~ objects using this channel
+	t_polybus_block *volatile block;
+	t_polybus_block *retired;
+} t_polybus;
+
+static t_polybus *polybus_get(t_symbol *s){
+	t_polybus *bus = (t_polybus *)(s->s_thing);
+	if(bus && bus->magic == POLYBUS_MAGIC){
+		return bus;
+	}
+	return NULL;
+}
+
+static void polybus_block_free(t_polybus_block *b){
+	if(b){
+		sysmem_freeptr(b->slots);
+		sysmem_freeptr(b->flags);
+		sysmem_freeptr(b);
+	}
+}
+
+static void polybus_free(t_polybus *bus){
+	t_polybus_block *b, *next;
+	polybus_block_free(bus->block);
+	for(b = bus->retired; b; b = next){
+		next = b->next;
+		polybus_block_free(b);
+	}
+	sysmem_freeptr(bus);
+}
+
+/* Make room for at least vectorsize samples in at least nslots slots.  Called
+   from new and dsp64 only, never from a perform routine.  Returns nonzero if
+   it ran out of memory, in which case the current block is left alone. */
+static int polybus_grow(t_polybus *bus, long vectorsize, long nslots){
+	t_polybus_block *b = bus->block;
+	t_polybus_block *nb;
+	long n = POLYBUS_MINSLOTS;
+	if(b){
+		if(b->vectorsize >= vectorsize && b->nslots >= nslots){
+			return 0;
+		}
+		if(vectorsize < b->vectorsize){
+			vectorsize = b->vectorsize;
+		}
+		if(nslots < b->nslots){
+			nslots = b->nslots;
+		}
+	}
+	while(n < nslots){
+		n *= 2;
+	}
+	nb = (t_polybus_block *)sysmem_newptrclear(sizeof(t_polybus_block));
+	if(!nb){
+		return 1;
+	}
+	nb->vectorsize = vectorsize;
+	nb->nslots = n;
+	nb->slots = (double *)sysmem_newptrclear(n * vectorsize * sizeof(double));
+	nb->flags = (t_polybus_flag *)sysmem_newptrclear(n * sizeof(t_polybus_flag));
+	if(!(nb->slots) || !(nb->flags)){
+		polybus_block_free(nb);
+		return 1;
+	}
+	if(b){
+		b->next = bus->retired;
+		bus->retired = b;
+	}
+	POLYBUS_STORE(&bus->block, nb);
+	return 0;
+}
+
+/* out[i] += in[i].  Both poly.send~ (several sends in one voice) and
+   poly.bus~ (the reduction over slots) come through here. */
+static void polybus_accumulate(double *out, const double *in, long n){
+	long i = 0;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	for(; i + 4 <= n; i += 4){
+		_mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(out + i), _mm_loadu_pd(in + i)));
+		_mm_storeu_pd(out + i + 2, _mm_add_pd(_mm_loadu_pd(out + i + 2), _mm_loadu_pd(in + i + 2)));
+	}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+	for(; i + 4 <= n; i += 4){
+		vst1q_f64(out + i, vaddq_f64(vld1q_f64(out + i), vld1q_f64(in + i)));
+		vst1q_f64(out + i + 2, vaddq_f64(vld1q_f64(out + i + 2), vld1q_f64(in + i + 2)));
+	}
+#endif
+	for(; i < n; i++){
+		out[i] += in[i];
+	}
+}
+
+#endif // __POLYBUS_H__
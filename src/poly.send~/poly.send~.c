@@ -28,6 +28,7 @@ COPYRIGHT_YEARS: 2009
 SVN_REVISION: $LastChangedRevision: 587 $
 VERSION 0.0: First try
 VERSION 0.0.1: New help file
+VERSION 0.1: Each poly~ voice writes its own bus slot, so poly~ @parallel 1 is safe
 @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 */
 #define NAME "poly.send~"
@@ -41,11 +42,14 @@ VERSION 0.0.1: New help file
 #include "ext_obex.h"
 #include "ext_obex_util.h"
 #include "z_dsp.h"
+#include "jpatcher_api.h"
+#include "../poly.bus~/polybus.h"
 
 typedef struct _psend{
 	t_pxobject ob;
 	t_symbol *name, *mangled_name;
 	long channel;
+	long voice;		// bus slot: our poly~ voice, or 0 outside poly~
 	//double *sv;
 	//long blksize;
 	//long samplerate;
@@ -56,6 +60,7 @@ static t_class *psend_class;
 //void psend_dsp(t_psend *x, t_signal **sp, short *count);
 //t_int *psend_perform(t_int *w);
 void psend_perform64(t_psend *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam);
+long psend_getvoice(t_psend *x);
 void psend_mangle(t_psend *x);
 void psend_free(t_psend *x);
 void psend_assist(t_psend *x, void *b, long m, long a, char *s);
@@ -67,17 +72,50 @@ void *psend_new(t_symbol *sym, int argc, t_atom *argv);
 
 void psend_dsp64(t_psend *x, t_object *dsp64, short *count, double samplerate, long maxvectorsize, long flags)
 {
+    x->voice = psend_getvoice(x);
+    t_polybus *bus = polybus_get(x->mangled_name);
+    if(bus && polybus_grow(bus, maxvectorsize, x->voice + 1)){
+        object_error((t_object *)x, "out of memory!");
+    }
     object_method(dsp64, gensym("dsp_add64"), x, psend_perform64, 0, NULL);
 }
 
+// The index of the poly~ voice we're in (from 1), looking up through any
+// subpatchers, or 0 if we're not in a poly~
+long psend_getvoice(t_psend *x)
+{
+    t_object *patcher = NULL, *assoc;
+    object_obex_lookup(x, gensym("#P"), &patcher);
+    while(patcher){
+        assoc = NULL;
+        object_method(patcher, gensym("getassoc"), &assoc);
+        if(assoc && object_classname(assoc) == gensym("poly~")){
+            long voice = (long)object_method(assoc, gensym("getindex"), patcher);
+            return voice > 0 ? voice : 0;
+        }
+        patcher = jpatcher_get_parentpatcher(patcher);
+    }
+    return 0;
+}
+
 void psend_perform64(t_psend *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
 {
-    if(!(x->mangled_name->s_thing)){
+    t_polybus *bus = polybus_get(x->mangled_name);
+    if(!bus){
+        return;
+    }
+    t_polybus_block *b = POLYBUS_LOAD(&bus->block);
+    if(!b || sampleframes > b->vectorsize || x->voice >= b->nslots){
         return;
     }
-    double *ptr = (double *)(x->mangled_name->s_thing);
-    for(int i = 0; i < sampleframes; i++){
-        ptr[i] += ins[0][i];
+    double *ptr = b->slots + x->voice * b->vectorsize;
+    volatile long *dirty = &(b->flags[x->voice].dirty);
+    // the first send in this voice overwrites whatever was left from the last vector
+    if(*dirty){
+        polybus_accumulate(ptr, ins[0], sampleframes);
+    }else{
+        memcpy(ptr, ins[0], sizeof(double) * sampleframes);
+        *dirty = 1;
     }
 }
 /*
@@ -175,6 +213,7 @@ void *psend_new(t_symbol *sym, int argc, t_atom *argv){
 		x->name = NULL;
 		x->mangled_name = NULL;
 		x->channel = 0;
+		x->voice = 0;
 		attr_args_process(x, argc, argv);
 		if( x->name && x->channel )
 		{
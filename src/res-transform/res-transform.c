@@ -50,6 +50,7 @@ VERSION 1.75: replaced  getbytes by NewPtr and tested
 VERSION 1.76: I can't get the alias feature to work
 VERSION 1.77: (MW) replaced NewPtr() with sysmem_newptr() so it will compile on Windows too.  Plugged memory leak.
 VERSION 1.78: Force Package Info Generation
+VERSION 1.8: Only recomputes the stages a parameter affects; delta-output mode sends only the resonances that changed
 @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 
 
@@ -85,6 +86,8 @@ t_class *resonclass;
 
 #define PI (3.14159265358979323)
 #define MAXRESON 1024
+// outlet_list() takes a short count
+#define MAXLIST 32767
 #define NSPECTRALENVELOPE 32
 
 #define A440 440.0
@@ -97,6 +100,15 @@ t_class *resonclass;
 #define AASMIDINOTE 69
 #define CASMIDINOTE 60
 
+/* Stages of the transform chain, for marking what a parameter change invalidates */
+#define RT_FREQ 1		/* transformed frequencies */
+#define RT_GAIN 2		/* transformed gains, which depend on the frequencies */
+#define RT_RATE 4		/* transformed decay rates */
+#define RT_CLUSTER 8	/* expansion into clusters, i.e. the output model */
+#define RT_ALL (RT_FREQ|RT_GAIN|RT_RATE|RT_CLUSTER)
+
+static t_symbol *ps_setoneresonance, *ps_setonesinusoid;
+
 typedef	struct	fobj
 {
 	t_object			object;		/* An embedded MAX object.					*/
@@ -163,6 +175,20 @@ typedef	struct	fobj
 	double evenfscale;
 	
 	int	sinusoidalmodel; /* no decayrate, i.e. sinusoidal model vs resonance model */
+	
+	// cached results of each stage, per resonance
+	double *tf, *tg, *tb;
+	int dirty; /* RT_ stages that need recomputing */
+	int dirtylo, dirtyhi; /* for resonances dirtylo..dirtyhi-1 */
+	long modelsize; /* atoms allocated in model */
+	
+	// delta output
+	int deltaoutput;
+	long outputsize; /* atoms in the last list output, -1 to force a full one */
+	int outputsinusoidal;
+	int *changed; /* indices of output resonances that changed since the last output */
+	int nchanged;
+	t_atom *delta; /* the message that carries them, modelsize atoms */
 }fobj;
 
 
@@ -172,8 +198,13 @@ static double modeltune(double f,double p);
 static void faxis(double f[],long n);
 void * fnew(t_symbol *s, int argc, t_atom *argv);
 static double senv(fobj *x, double f);
+static void invalidate(fobj *x, int stages, int lo, int hi);
+static void invalidateall(fobj *x, int stages);
+static int growmodel(fobj *x);
 static void computeeverything(fobj *x);
 static void dumpresonances(fobj *x);
+static void resetdelta(fobj *x);
+static void setdeltaoutput(fobj *x, long n);
 //static void *setsrate(fobj *it, double ef);
 static void setcenter(fobj *it, double f);
 static void setslope(fobj *it, double f);
@@ -330,84 +361,227 @@ else if(!x->sinusoidalmodel && ((argc%3)!=0))
 	}
 	x->nreson = x->fcount;
 	x->fcount = 0;
+	invalidateall(x, RT_ALL);
+}
+
+
+/* Mark stages of the transform chain out of date for resonances lo..hi-1.
+   Everything downstream of a stage is recomputed with it. */
+static void invalidate(fobj *x, int stages, int lo, int hi)
+{
+	if(!stages)
+		return;
+	if(x->dirty == 0 || lo < x->dirtylo)
+		x->dirtylo = lo;
+	if(x->dirty == 0 || hi > x->dirtyhi)
+		x->dirtyhi = hi;
+	x->dirty |= stages;
+}
+
+static void invalidateall(fobj *x, int stages)
+{
+	invalidate(x, stages, 0, x->maxresonances);
 }
 
+/* Room in x->model (and x->changed, x->delta) for the output of nreson resonances */
+static int growmodel(fobj *x)
+{
+	int minc = (x->sinusoidalmodel==1)?2:3;
+	long need = (long)x->nreson*x->clustersize*minc;
+	long i;
+
+	if(need <= x->modelsize)
+		return 1;
+	{
+		t_atom *m = (t_atom *) sysmem_resizeptr(x->model, need * sizeof(t_atom));
+		int *c = (int *) sysmem_resizeptr(x->changed, need * sizeof(int));
+		t_atom *d = (t_atom *) sysmem_resizeptr(x->delta, need * sizeof(t_atom));
+		if(m) x->model = m;
+		if(c) x->changed = c;
+		if(d) x->delta = d;
+		if(!m || !c || !d)
+		{
+			error("res-transform: cannot allocate space for model");
+			return 0;
+		}
+	}
+	for(i=x->modelsize;i<need;++i)
+		atom_setfloat(x->model+i, 0.0);
+	x->modelsize = need;
+	x->outputsize = -1;
+	return 1;
+}
 
 static void computeeverything(fobj *x)
 {
 	double fsc = x->freqscale, bwsc=x->bwscale,
-	 gainscale = x->gainscale,fadd= x->freqadd,srbar;
-	 int i,j,k;
+	 gainscale = x->gainscale,fadd= x->freqadd;
+	 int i,k;
 	int csize = x->clustersize;
 	int squelch = ( x->squelch>=0.0);
-	 double r;	
 		int minc = (x->sinusoidalmodel==1)?2:3;
+	int dirty = x->dirty;
+	int lo = x->dirtylo, hi = x->dirtyhi;
+
+	if(dirty & RT_FREQ)
+		dirty |= RT_GAIN;
+	if(dirty & (RT_GAIN|RT_RATE))
+		dirty |= RT_CLUSTER;
+	if(!dirty)
+		return;
+	if(!growmodel(x))
+		return;
+	if(lo < 0)
+		lo = 0;
+	if(hi > x->nreson)
+		hi = x->nreson;
 	
-	j = 0; /* Output resonance index */
-	for(i=0;i<x->nreson;++i)
+	for(i=lo;i<hi;++i)
 	{
-		struct reson transformedresonances;
 		int odd = ((i%2)==0); // yea yea, I know: the first partial has the index 0
-				
-		if(!x->sinusoidalmodel)
-			transformedresonances.b = squelch?x->squelch:(x->resonances[i].b*bwsc);	
-		
-	//	a = expf(ap*0.1151292546497)*(x->slope*(f-x->center)+1.0f) /* *senv(x,f) */;
-		transformedresonances.f = (x->resonances[i].f*fsc*(odd?x->oddfscale:x->evenfscale)+fadd);
-		transformedresonances.g = x->resonances[i].g*gainscale*(odd?x->oddgain:x->evengain);
 
+		if((dirty & RT_RATE) && !x->sinusoidalmodel)
+			x->tb[i] = squelch?x->squelch:(x->resonances[i].b*bwsc);	
+		
+		if(dirty & RT_FREQ)
+			x->tf[i] = (x->resonances[i].f*fsc*(odd?x->oddfscale:x->evenfscale)+fadd);
 
+		if(dirty & RT_GAIN)
+		{
+			double f = x->tf[i];
+			double g = x->resonances[i].g*gainscale*(odd?x->oddgain:x->evengain);
 
-		if(transformedresonances.f>x->center)
-			transformedresonances.g *= exp(0.1151292546497*(x->slope*(x->resonances[i].f-x->center)));
+			if(f>x->center)
+				g *= exp(0.1151292546497*(x->slope*(x->resonances[i].f-x->center)));
 
-		if(x->time!=0.0)
-			transformedresonances.g *= exp(x->time*-x->k1*(1.0+ 20.0*x->k2*(transformedresonances.f-x->fpivot)/50000.0));
+			if(x->time!=0.0)
+				g *= exp(x->time*-x->k1*(1.0+ 20.0*x->k2*(f-x->fpivot)/50000.0));
 		
-		if(i>x->partialmax-1 || i<x->partialmin
-		 ||transformedresonances.g < x->mingain && transformedresonances.g > x->maxgain
-			|| transformedresonances.f<x->fmin || transformedresonances.f>x->fmax)
-			transformedresonances.g = 0.0;
+			if(i>x->partialmax-1 || i<x->partialmin
+			 ||g < x->mingain && g > x->maxgain
+				|| f<x->fmin || f>x->fmax)
+				g = 0.0;
+			x->tg[i] = g;
+		}
 		
-		for(k=0;k<csize;++k)
+		if(dirty & RT_CLUSTER)
 		{
-			int halfway = csize/2;
-			double f = transformedresonances.f+(k)*(x->fspread/csize)
-				+(k-halfway)*(x->faround/csize);
-			double g = transformedresonances.g*expf(-0.1151292546497*k*(x->attenuationspread/csize));
-
-			x->model[(csize*i+k)*minc+0].a_w.w_float = f;
-			x->model[(csize*i+k)*minc+1].a_w.w_float = g;
-			if(!x->sinusoidalmodel)
-				x->model[(csize*i+k)*minc+2].a_w.w_float = transformedresonances.b+k*(x->bwspread/csize);
+			for(k=0;k<csize;++k)
+			{
+				int halfway = csize/2;
+				int n = csize*i+k;
+				t_atom *m = x->model+n*minc;
+				t_atom a[3];
+				
+				atom_setfloat(a, x->tf[i]+(k)*(x->fspread/csize)
+					+(k-halfway)*(x->faround/csize));
+				atom_setfloat(a+1, x->tg[i]*expf(-0.1151292546497*k*(x->attenuationspread/csize)));
+				if(!x->sinusoidalmodel)
+					atom_setfloat(a+2, x->tb[i]+k*(x->bwspread/csize));
+
+				// Compare what goes out, not the doubles, so that delta output
+				// ignores changes too small to survive the trip
+				if(m[0].a_w.w_float != a[0].a_w.w_float || m[1].a_w.w_float != a[1].a_w.w_float
+					|| (minc == 3 && m[2].a_w.w_float != a[2].a_w.w_float))
+				{
+					if(x->nchanged < x->modelsize)
+						x->changed[x->nchanged++] = n;
+					else
+						x->outputsize = -1;
+					m[0] = a[0];
+					m[1] = a[1];
+					if(minc == 3)
+						m[2] = a[2];
+				}
+			}
 		}
 	}
 	
-	x->nreson_output = j;
-
+	x->nreson_output = x->nreson*csize;
+	x->dirty = 0;
 }
 
 static void dumpresonances(fobj *x)
 {
 		int minc = (x->sinusoidalmodel)?2:3;
+	long n;
+	int i;
+
 	computeeverything(x);
- 	outlet_list(x->dataoutlet,0L,(short)x->nreson*x->clustersize*minc,x->model);
+	n = (long)x->nreson*x->clustersize*minc;
+	if(n > x->modelsize)
+		return;
+	if(n > MAXLIST)
+	{
+		long fits = (MAXLIST/minc)*minc;
+		if(x->outputsize != fits)
+			error("res-transform: %ld resonances don't fit in one list; only the first %ld are output", n/minc, fits/minc);
+		n = fits;
+	}
+
+	// When most of the model changed the full list is shorter than the delta
+	if(x->deltaoutput && x->outputsize == n && x->outputsinusoidal == x->sinusoidalmodel
+		&& (long)x->nchanged * (minc+1) < n)
+	{
+		// Only the resonances that changed, as one setoneresonance (setonesinusoid)
+		// message of index/parameter groups, which resonators~, sinusoids~ and
+		// res-transform itself apply in one go
+		t_symbol *sel = x->sinusoidalmodel ? ps_setonesinusoid : ps_setoneresonance;
+		t_atom *a = x->delta;
+		for(i=0;i<x->nchanged;++i)
+		{
+			int k = x->changed[i];
+			if((long)k*minc >= n)
+				continue;
+			atom_setlong(a, k);
+			a[1] = x->model[k*minc];
+			a[2] = x->model[k*minc+1];
+			if(minc == 3)
+				a[3] = x->model[k*minc+2];
+			a += minc+1;
+		}
+		if(a > x->delta)
+			outlet_anything(x->dataoutlet, sel, (short)(a - x->delta), x->delta);
+	}
+	else
+	{
+	 	outlet_list(x->dataoutlet,0L,(short)n,x->model);
+	}
+	x->outputsize = n;
+	x->outputsinusoidal = x->sinusoidalmodel;
+	x->nchanged = 0;
 }
+
 void dumpifnecessary(fobj *x);
 void dumpifnecessary(fobj *x)
 {
 	if(x->m_inletNumber==0)
 		dumpresonances(x);
 }
+
+static void resetdelta(fobj *x)
+{
+	// The next output is the whole model
+	x->outputsize = -1;
+}
+
+static void setdeltaoutput(fobj *x, long n)
+{
+	x->deltaoutput = (n != 0);
+	resetdelta(x);
+}
+
 static void clear(fobj *it)
 {
 	clearit(it);
+	invalidateall(it, RT_ALL);
 		dumpifnecessary(it);
 }
 
 static void setcenter(fobj *it, double f)
 {
 	it->center = f;
+		invalidateall(it, RT_GAIN);
 		dumpifnecessary(it);
 }
 
@@ -415,6 +589,7 @@ static void setslope(fobj *it, double f);
 static void setslope(fobj *it, double f)
 {		
 	it->slope = f;
+		invalidateall(it, RT_GAIN);
 		dumpifnecessary(it);
 }
 
@@ -424,6 +599,7 @@ static void setfreqscale(fobj *it, double f);
 static void setfreqscale(fobj *it, double f)
 {
 	it->freqscale = f;
+		invalidateall(it, RT_FREQ);
 		dumpifnecessary(it);
 }
 
@@ -431,6 +607,7 @@ static void setoddfreqscale(fobj *it, double f);
 static void setoddfreqscale(fobj *it, double f)
 {
 	it->oddfscale = f;
+		invalidateall(it, RT_FREQ);
 		dumpifnecessary(it);
 }
 
@@ -438,6 +615,7 @@ static void setevenfreqscale(fobj *it, double f);
 static void setevenfreqscale(fobj *it, double f)
 {
 	it->evenfscale = f;
+		invalidateall(it, RT_FREQ);
 		dumpifnecessary(it);
 }
 
@@ -445,36 +623,42 @@ static void setk1(fobj *it, double f);
 static void setk1(fobj *it, double f)
 {
 	it->k1 = f;
+		invalidateall(it, RT_GAIN);
 		dumpifnecessary(it);
 }
 static void setk2(fobj *it, double f);
 static void setk2(fobj *it, double f)
 {
 	it->k2 = f;
+		invalidateall(it, RT_GAIN);
 		dumpifnecessary(it);
 }
 static void setfpivot(fobj *it, double f);
 static void setfpivot(fobj *it, double f)
 {
 	it->fpivot = f;
+		invalidateall(it, RT_GAIN);
 		dumpifnecessary(it);
 }
 static void setfmax(fobj *it, double f);
 static void setfmax(fobj *it, double f)
 {
 	it->fmax = f;
+		invalidateall(it, RT_GAIN);
 		dumpifnecessary(it);
 }
 static void setfmin(fobj *it, double f);
 static void setfmin(fobj *it, double f)
 {
 	it->fmin = f;
+		invalidateall(it, RT_GAIN);
 		dumpifnecessary(it);
 }
 static void settime(fobj *it, double f);
 static void settime(fobj *it, double f)
 {
 	it->time = f;
+		invalidateall(it, RT_GAIN);
 		dumpifnecessary(it);
 }
 
@@ -490,6 +674,7 @@ static void setfreqbase(fobj *it, double f)
 static void setfreqadd(fobj *it, double f)
 {
 	it->freqadd = f;
+		invalidateall(it, RT_FREQ);
 		dumpifnecessary(it);
 }
 
@@ -497,24 +682,28 @@ static void setatten(fobj *it, double f);
 static void setatten(fobj *it, double f)
 {
 	it->gainscale = exp(-f*0.1151292546497);
+		invalidateall(it, RT_GAIN);
 		dumpifnecessary(it);
 }
 static void setgain(fobj *it, double f);
 static void setgain(fobj *it, double f)
 {
 	it->gainscale = f;
+		invalidateall(it, RT_GAIN);
 		dumpifnecessary(it);
 }
 static void setoddgain(fobj *it, double f);
 static void setoddgain(fobj *it, double f)
 {
 	it->oddgain = f;
+		invalidateall(it, RT_GAIN);
 		dumpifnecessary(it);
 }
 static void setevengain(fobj *it, double f);
 static void setevengain(fobj *it, double f)
 {
 	it->evengain = f;
+		invalidateall(it, RT_GAIN);
 		dumpifnecessary(it);
 }
 
@@ -525,6 +714,7 @@ static void setmidipitch(fobj *it, double f)
 {
 	it->freqscale = modeltune(f,it->freqbase);
 //	post("%d %lf %lf", n,it->freqbase,it->freqscale);
+		invalidateall(it, RT_FREQ);
 		dumpifnecessary(it);
 }
 static void setpitch(fobj *it, double f);
@@ -533,6 +723,7 @@ static void setpitch(fobj *it, double f)
 	if(it->freqbase >0.0)
 		it->freqscale = f/it->freqbase;
 //	post("%lf %lf %lf",f,it->freqbase,it->freqscale);
+		invalidateall(it, RT_FREQ);
 		dumpifnecessary(it);
 }
 
@@ -541,12 +732,14 @@ static void setbwscale(fobj *it, double f);
 static void setbwscale(fobj *it, double f)
 {
 	it->bwscale = f;
+		invalidateall(it, RT_RATE);
 		dumpifnecessary(it);
 }
 static void setfspread(fobj *it, double f);
 static void setfspread(fobj *it, double f)
 {
 	it->fspread = f;
+		invalidateall(it, RT_CLUSTER);
 		dumpifnecessary(it);
 }
 
@@ -560,6 +753,7 @@ static void setfstretch(fobj *it, double f)
 static void setfaround(fobj *it, double f)
 {
 	it->faround = f;
+		invalidateall(it, RT_CLUSTER);
 		dumpifnecessary(it);
 }
 static void setbwstretch(fobj *it, double f);
@@ -573,12 +767,14 @@ static void setbwspread(fobj *it, double f);
 static void setbwspread(fobj *it, double f)
 {
 	it->bwspread = f;
+		invalidateall(it, RT_CLUSTER);
 		dumpifnecessary(it);
 }
 static void setattenuationspread(fobj *it, double f);
 static void setattenuationspread(fobj *it, double f)
 {
 	it->attenuationspread = f;
+		invalidateall(it, RT_CLUSTER);
 		dumpifnecessary(it);
 }
 
@@ -589,6 +785,7 @@ static void setpartialmin(fobj *it, int i)
 		post("partial number must be positive");
 	else
 		it->partialmin = i;
+	invalidateall(it, RT_GAIN);
 	dumpifnecessary(it);
 }
 static void setpartialmax(fobj *it, int i);
@@ -598,16 +795,22 @@ static void setpartialmax(fobj *it, int i)
 		post("partial number must be positive");
 	else
 		it->partialmax = i;
+	invalidateall(it, RT_GAIN);
 	dumpifnecessary(it);
 }
 
 static void setclustersize(fobj *it, int i);
 static void setclustersize(fobj *it, int i)
 {
+	int minc = (it->sinusoidalmodel)?2:3;
 	if(i<=0)
 		post("cluster size must be larger than 0");
+	else if((long)(it->nreson>0?it->nreson:1)*i*minc > MAXLIST)
+		error("res-transform: cluster size %d is too large for %ld resonances (the output list holds %d atoms)",
+			i, (long)it->nreson, MAXLIST);
 	else
 		it->clustersize = i;
+	invalidateall(it, RT_CLUSTER);
 	dumpifnecessary(it);
 }
 
@@ -658,11 +861,14 @@ static void squelch(fobj *x, double f);
 static void squelch(fobj *x, double f)
 {
 	x->squelch = f;
+	invalidateall(x, RT_RATE);
 	dumpresonances(x);
 	x->squelch = -1.0;
+	invalidateall(x, RT_RATE);
 }
 void resondump(fobj *x, struct symbol *s, int argc, t_atom *argv)
 {
+	resetdelta(x);
 	dumpresonances(x);
 }
 
@@ -678,6 +884,7 @@ static void setoneamplitude(fobj *x, int i, double newamplitude) {
 			  x->nreson, i);
 	} else {
 		x->resonances[i].g = newamplitude;
+		invalidate(x, RT_GAIN, i, i+1);
 		dumpifnecessary(x);
 
 	}
@@ -693,6 +900,7 @@ static void setonefrequency(fobj *x, int i, double newfreq) {
 			  x->nreson, i);
 	} else {
 		x->resonances[i].f = newfreq;
+		invalidate(x, RT_FREQ, i, i+1);
 		dumpifnecessary(x);
 
 	}
@@ -706,92 +914,69 @@ static void setonerate(fobj *x, int i, double newrate) {
 			  x->nreson, i);
 	} else {
 		x->resonances[i].b = newrate;
+		invalidate(x, RT_RATE, i, i+1);
 		dumpifnecessary(x);
 	}
 }
 
 
-static void setoneresonance(fobj *x, struct symbol *s, int argc, struct atom *argv) {
-	int i;
-	double f, g, b;
+/* index f g (b) groups, 4 atoms each for setoneresonance and 3 for
+   setonesinusoid; a bad group is skipped and the rest still applied. */
+static void setonegroups(fobj *x, char *msg, int argc, struct atom *argv, int group) {
+	int i, j, any = 0;
 	
-	if (argc != 4) {
-		error("res-transform: setoneresonance needs exactly 4 arguments");
+	if (argc == 0 || argc % group != 0) {
+		error("res-transform: %s needs groups of exactly %d arguments", msg, group);
 		return;
 	} 
 	
-	if (argv[0].a_type!= A_LONG) {
-		error("res-transform: index (first arg) to setone must be an integer");
-		return;
-	}
-	
-	if (argv[1].a_type != A_FLOAT || argv[2].a_type != A_FLOAT || argv[3].a_type != A_FLOAT) {
-		error("res-transform: freq, gain, and bw must all be floats");
-		return;
-	}
-	
-	i = argv[0].a_w.w_long;
-	f = argv[1].a_w.w_float;
-	g = argv[2].a_w.w_float;
-	b = argv[3].a_w.w_float;
-	
+	for (j = 0; j < argc; j += group) {
+		t_atom *a = argv + j;
 		
-	if (i < -1) {
-		post(" res-transform: setoneresonance: index must be >= 0 (or -1 to add a new resonance)");
-	} else if (i >= x->nreson) {
-		post(" res-transform: setone: model has only %ld resonances; can't set number %ld",
-			  x->nreson, i);
-	} else {
-		if (i == -1) {
-			/* Add a new resonance */
-			i = (x->nreson)++;
+		if (a[0].a_type!= A_LONG) {
+			error("res-transform: index (first arg) to %s must be an integer", msg);
+			continue;
 		}
 		
-		x->resonances[i].f = f;
-		x->resonances[i].g = g;
-		x->resonances[i].b = b;
-		dumpifnecessary(x);
-	}
-}
-static void setonesinusoid(fobj *x, struct symbol *s, int argc, struct atom *argv) {
-	int i;
-	double f, g;
-	
-	if (argc != 3) {
-		error("res-transform: setonesinusoid needs exactly 3 arguments");
-		return;
-	} 
-	
-	if (argv[0].a_type!= A_LONG) {
-		error("res-transform: index (first arg) to setone must be an integer");
-		return;
-	}
-	
-	if (argv[1].a_type != A_FLOAT || argv[2].a_type != A_FLOAT || argv[3].a_type != A_FLOAT) {
-		error("res-transform: freq, gain, and bw must all be floats");
-		return;
-	}
-	
-	i = argv[0].a_w.w_long;
-	f = argv[1].a_w.w_float;
-	g = argv[2].a_w.w_float;
-	
-		
-	if (i < -1) {
-		post(" res-transform: setone: index must be >= 0 (or -1 to add a new resonance)");
-	} else if (i >= x->nreson) {
-		post(" res-transform: setone: model has only %ld resonances; can't set number %ld",
-			  x->nreson, i);
-	} else {
-		if (i == -1) {
-			/* Add a new resonance */
-			i = (x->nreson)++;
+		if (a[1].a_type != A_FLOAT || a[2].a_type != A_FLOAT || (group == 4 && a[3].a_type != A_FLOAT)) {
+			error(group == 4 ? "res-transform: freq, gain, and bw must all be floats" :
+				  "res-transform: freq and gain must both be floats");
+			continue;
 		}
 		
-		x->resonances[i].f = f;
-		x->resonances[i].g = g;
-		dumpifnecessary(x);
+		i = a[0].a_w.w_long;
+		
+		if (i < -1) {
+			post(" res-transform: %s: index must be >= 0 (or -1 to add a new resonance)", msg);
+		} else if (i >= x->nreson) {
+			post(" res-transform: %s: model has only %ld resonances; can't set number %ld",
+				  msg, x->nreson, i);
+		} else if (i == -1 && x->nreson >= x->maxresonances) {
+			post(" res-transform: %s: model is full (%ld resonances)", msg, x->maxresonances);
+		} else {
+			if (i == -1) {
+				/* Add a new resonance */
+				i = (x->nreson)++;
+			}
+			
+			x->resonances[i].f = a[1].a_w.w_float;
+			x->resonances[i].g = a[2].a_w.w_float;
+			if (group == 4)
+				x->resonances[i].b = a[3].a_w.w_float;
+			invalidate(x, group == 4 ? RT_FREQ|RT_RATE : RT_FREQ, i, i+1);
+			any = 1;
+		}
 	}
+	if (any)
+		dumpifnecessary(x);
+}
+
+static void setoneresonance(fobj *x, struct symbol *s, int argc, struct atom *argv) {
+	setonegroups(x, "setoneresonance", argc, argv, 4);
+}
+
+static void setonesinusoid(fobj *x, struct symbol *s, int argc, struct atom *argv) {
+	setonegroups(x, "setonesinusoid", argc, argv, 3);
 }
 /* this should output to second outlet in next release or be removed forever
 void numresonances(fobj *x) {
@@ -803,6 +988,7 @@ void numresonances(fobj *x) {
 static void setfreqrange(fobj *x, double min, double max) {
 	x->fmin = min;
 	x->fmax = max;
+	invalidateall(x, RT_GAIN);
 	dumpresonances(x);
 }
 
@@ -811,6 +997,7 @@ static void setfreqrange(fobj *x, double min, double max) {
 static void setamprange(fobj *x, double min, double max) {
 	x->mingain = min;
 	x->maxgain = max;
+	invalidateall(x, RT_GAIN);
 	dumpresonances(x);
 }
 
@@ -820,6 +1007,11 @@ void myobject_free(fobj *x)
 {
   sysmem_freeptr(x->model);
   sysmem_freeptr(x->resonances);
+  sysmem_freeptr(x->tf);
+  sysmem_freeptr(x->tg);
+  sysmem_freeptr(x->tb);
+  sysmem_freeptr(x->changed);
+  sysmem_freeptr(x->delta);
   freeobject(x->m_proxy);
 }
 
@@ -832,19 +1024,32 @@ void * fnew(t_symbol *s, int argc, t_atom *argv) {
 		return NULL;
 	}
 	x->m_proxy = proxy_new(x,1L,&x->m_inletNumber);
-	x->dataoutlet = listout(x);
+	x->dataoutlet = outlet_new(x, NULL);	// lists, or setoneresonance/setonesinusoid in delta-output mode
 	clearit(x);
 	
 	x->maxresonances = MAXRESON; // get this from the command line eventually
-	x->model = (t_atom *) sysmem_newptr(3 * x->maxresonances * sizeof(t_atom));
+	x->modelsize = 3 * x->maxresonances;
+	x->model = (t_atom *) sysmem_newptr(x->modelsize * sizeof(t_atom));
+	x->changed = (int *) sysmem_newptr(x->modelsize * sizeof(int));
+	x->delta = (t_atom *) sysmem_newptr(x->modelsize * sizeof(t_atom));
 	x->resonances = (struct reson *) sysmem_newptr(sizeof(struct reson) * x->maxresonances);
+	x->tf = (double *) sysmem_newptrclear(sizeof(double) * x->maxresonances);
+	x->tg = (double *) sysmem_newptrclear(sizeof(double) * x->maxresonances);
+	x->tb = (double *) sysmem_newptrclear(sizeof(double) * x->maxresonances);
 	
-	if(!x->model || ! x->resonances)
+	if(!x->model || ! x->resonances || !x->changed || !x->delta || !x->tf || !x->tg || !x->tb)
 	{
 		error("cannot allocate space for model");
 		return 0;
 	}
 
+	for(i=0;i<x->modelsize;++i)
+		atom_setfloat(x->model+i, 0.0);
+	x->dirty = 0;
+	x->nchanged = 0;
+	x->deltaoutput = 0;
+	resetdelta(x);
+
 	x->sinusoidalmodel = (s==gensym("sin-transform")); 
 	
 	
@@ -855,12 +1060,6 @@ void * fnew(t_symbol *s, int argc, t_atom *argv) {
 	storemodel(x,s,argc, argv, false,false,false);
 	computeeverything(x);		// So that tellmeeverything will tell the truth right after the object is instantiated
 
-	for(i=0;i<x->maxresonances;++i)
-	{
-		x->model[i*3+0].a_type = A_FLOAT;
-		x->model[i*3+1].a_type = A_FLOAT;
-		x->model[i*3+2].a_type = A_FLOAT;
- 	}
 	return  x;
 }
 
@@ -960,6 +1159,10 @@ int main(void)		/* called once at launch to define this class */
 	class_addmethod(resonclass, (method)version, "version", 0);
 
 	class_addmethod(resonclass, (method) resondump, "bang", 0);
+	class_addmethod(resonclass, (method)setdeltaoutput, "delta-output", A_LONG, 0);
+
+	ps_setoneresonance = gensym("setoneresonance");
+	ps_setonesinusoid = gensym("setonesinusoid");
 
 	class_register(CLASS_BOX, resonclass);
 
@@ -1014,6 +1217,10 @@ static void tellmeeverything(fobj *x) {
      post("    Percussifier: decayrate %lf, skew %lf, frequencypivot %lf, time %lf",
 	  x->k1, x->k2, x->fpivot, x->time);
 
+     if(x->deltaoutput)
+     	post("  delta-output 1: after the first full list only changed resonances are output, as %s messages",
+     		 x->sinusoidalmodel ? "setonesinusoid" : "setoneresonance");
+
    if(x->sinusoidalmodel)
  	{
  	    post("  Resulting model (frequency, amplitude duples):");
@@ -61,6 +61,8 @@ VERSION 1.999: Fixed sample-rate acquisition to happen on every list that is sen
 VERSION 1.9991: Fixed de-normalization problem.
 VERSION 1.9992: Fixed de-normalization problem using SSE
 VERSION 1.9995: Updated for 64-bit operation -- old floating point routines are commented out
+VERSION 2.0: Coefficient updates handed to the perform routine through the lock-free param-update library
+VERSION 2.0.1: setoneresonance message (one or more resonances), so res-transform's delta-output mode can drive it
 @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 
 
@@ -72,7 +74,6 @@ VERSION 1.9995: Updated for 64-bit operation -- old floating point routines are
 		set the maximum number of resonances dynamically with an integer argument
 		fix the assistance strings 
 		test on failure of resonance allocation
-		protect against filter update parallelism bugs a la peqbank
 		partial filter set updates
 	
 	Make smooth mode settable by a message.
@@ -92,6 +93,8 @@ VERSION 1.9995: Updated for 64-bit operation -- old floating point routines are
 #include "z_dsp.h"
 #include <math.h>
 
+#include "param-update.h"
+
 #ifdef WIN_VERSION
 #include <pmmintrin.h>
 #endif
@@ -129,6 +132,24 @@ typedef  struct dresdesc
 #endif
 } dresdesc;
 
+/* What the control side computes for each resonance.  Whole sets of these are handed
+   to the perform routine with param-update, which copies them into the dresdesc array
+   it owns at the start of a signal vector.  */
+typedef struct rescoeffs
+{
+	double a1, a1prime, b1, b2;
+	double fastr;
+#ifdef OGAIN
+	double og;
+#endif
+} rescoeffs;
+
+typedef struct resparams
+{
+	int nres;
+	rescoeffs r[MAXRESONANCES];
+} resparams;
+
 /* bank of filters */
 typedef struct 
 {
@@ -136,7 +157,9 @@ typedef struct
 	short b_connected;
 	/// resdesc *base;
 	dresdesc *dbase;
-	int nres; 
+	int nres;	/* number of resonances the perform routine is computing */
+	resparams *params[PARAM_NUM_BLOCKS];
+	paramPointers pp;
 	int nmax;	/* maximum number of filters*/
 	int ping; /* index of filter that will be pinged at the next opportunity */
 	float pingsize; /* size of pulse */
@@ -180,11 +203,57 @@ void resonators_dsp64(t_resonators *x, t_object *dsp64, short *count, double sam
 void resonators_float(t_resonators *x, double f);
 void resonators_int(t_resonators *x, long n);
 void resonators_list(t_resonators *x, t_symbol *s, short argc, t_atom *argv);
+void resonators_setoneresonance(t_resonators *x, t_symbol *s, short argc, t_atom *argv);
 void resonators_clear(t_resonators *x);
 void resonators_assist(t_resonators *x, void *b, long m, long a, char *s);
 void *resonators_new(t_symbol *s, short argc, t_atom *argv);
 void resonators_tellmeeverything(t_resonators *x);
 void resonators_free(t_resonators *x);
+int resonators_getparams(t_resonators *x);
+resparams *resonators_copyparams(t_resonators *x);
+double resonators_getsr(t_resonators *x);
+void resonators_setcoeffs(t_resonators *x, rescoeffs *c, double f, double g, double rate, double srbar);
+
+// Called by each perform routine before it touches dbase: picks up the latest
+// coefficients, if any, and returns the number of resonances to compute.
+int resonators_getparams(t_resonators *x)
+{
+	resparams *p = (resparams *) GetCurrentParams(&x->pp);
+	
+	if (p != (resparams *) GetPreviousParams(&x->pp))
+	{
+		dresdesc *f = x->dbase;
+		int i;
+		
+		for(i=0;i<p->nres;++i)
+		{
+			f[i].a1 = p->r[i].a1;
+			f[i].b1 = p->r[i].b1;
+			f[i].b2 = p->r[i].b2;
+			f[i].a1prime = p->r[i].a1prime;
+			f[i].fastr = p->r[i].fastr;
+#ifdef OGAIN
+			f[i].og = p->r[i].og;
+#endif
+			if(i>=x->nres) 	/* If there are now more resonances than there were: */ 
+			{
+			    // Set old a1 to zero so that the input to the new resonators will ramp up over the first signal vector.
+				f[i].o_a1 = 0.0;
+				f[i].o_b1 = f[i].b1;
+				f[i].o_b2 = f[i].b2;
+				// Clear out state variables for these totally new resonances
+				f[i].out1 = f[i].out2 = 0.0;
+#ifdef OGAIN
+				f[i].o_og = f[i].og;
+#endif
+			}
+		}
+		x->nres = p->nres;
+	}
+	DoneWithPreviousParams(&x->pp);
+	
+	return x->nres;
+}
 
 // unsmoothed with input
 /*
@@ -298,7 +367,7 @@ void resonators_perform64(t_resonators *op, t_object *dsp64, double **ins, long
 //    t_resonators *op = (t_resonators *)(w[1]);  /* argument */
 //    int n = (int)(w[4]);
     long n = sampleframes;
-    int nfilters = op->nres;
+    int nfilters = resonators_getparams(op);
     double o0, o1, o2, o3;
     double i0,i1,i2,i3/* ,i4,i5 */;
     double yn,yo;
@@ -483,7 +552,7 @@ void resonators2_perform64(t_resonators *op, t_object *dsp64, double **ins, long
 //    int n = (int)(w[3]);
     long n = sampleframes;
     
-    int nfilters = op->nres;
+    int nfilters = resonators_getparams(op);
     double o0, o1, o2, o3;
     /* double i0,i1,i2,i3,i4,i5; */
     double yn,yo;
@@ -1317,7 +1386,7 @@ void diresonators_perform64(t_resonators *op, t_object *dsp64, double **ins, lon
     double out[MAXMAXVECTOR];
 //    int n = (int)(w[4]);
     long n = sampleframes;
-    int nfilters = op->nres;
+    int nfilters = resonators_getparams(op);
     register	double yn,yo;
     int i, j;
     int ping = op->ping;
@@ -1615,7 +1684,7 @@ void diresonators2_perform64(t_resonators *op, t_object *dsp64, double **ins, lo
     double out[MAXMAXVECTOR];
     
     double rate = 1.0/n;
-    int nfilters = op->nres;
+    int nfilters = resonators_getparams(op);
     double yn,yo;
     int i, j;
     int ping = op->ping;
@@ -1820,7 +1889,8 @@ void resonators_dsp64(t_resonators *x, t_object *dsp64, short *connect, double s
 }
 
 // note that this assumes we can never be interrupted by perform routine
-// we need buffering here as we did with the ping functions
+// we need buffering here as we did with the ping functions (this is filter state,
+// not parameters, so param-update doesn't help)
 void resonators_float(t_resonators *x, double ff)
 {
 	int i;
@@ -1851,26 +1921,14 @@ void resonators_float(t_resonators *x, double ff)
 void resonators_squelch(t_resonators *x);
 void resonators_squelch(t_resonators *x)
 {
-	//resdesc *fp = x->base;
-	dresdesc *dp = x->dbase;
+	resparams *p = resonators_copyparams(x);
 	int i;
-		for(i=0;i<x->nres;++i)
+		for(i=0;i<p->nres;++i)
 		{
-			//if(x->doubling)
-			//{
-				dp[i].b1 *= dp[i].fastr;
-				dp[i].b2 *= dp[i].fastr*dp[i].fastr;
-			//}
-            /*
-			else
-			{
-				fp[i].b1 *= fp[i].fastr;
-				fp[i].b2 *= fp[i].fastr*fp[i].fastr;
-			}
-            */
-		
+				p->r[i].b1 *= p->r[i].fastr;
+				p->r[i].b2 *= p->r[i].fastr*p->r[i].fastr;
 		}
-
+	CheckInNewParams(&x->pp);
 }
 
 
@@ -1911,41 +1969,79 @@ static void outputgain_list(t_resonators *x, t_symbol *s, short argc, t_atom *ar
 void outputgain_list(t_resonators *x, t_symbol *s, short argc, t_atom *argv)
 {
 	int i;
-	//resdesc *fp = x->base;
-	dresdesc *dp = x->dbase;
+	resparams *p = resonators_copyparams(x);
 		for(i=0; i<argc; ++i) {
 		if (i >= MAXRESONANCES) {
 			post("resonators~: warning: output gain list has more than %ld resonances; dropping extras",
 				 MAXRESONANCES);
 			break;
-		} else {
+		} else if (i < p->nres) {	// resonances that don't exist yet will start at unity gain anyway
 #ifdef OGAIN
 			
-			 dp[i].og = /* fp[i].og = */ atom_getfloatarg(i,argc,argv);
+			 p->r[i].og = atom_getfloatarg(i,argc,argv);
 #endif
 	}
 	}
+	CheckInNewParams(&x->pp);
+	}
+
+// Checks out a parameter block holding a copy of the latest parameters,
+// for messages that change only some of them.  Caller must check it back in.
+resparams *resonators_copyparams(t_resonators *x)
+{
+	resparams *latest = (resparams *) GetLatestParams(&x->pp);
+	resparams *p = (resparams *) CheckOutParamBlock(&x->pp);
+	
+	p->nres = latest->nres;
+	memcpy(p->r, latest->r, latest->nres * sizeof(rescoeffs));
+	return p;
+}
+// Picks up the current sample rate; returns the sample interval
+double resonators_getsr(t_resonators *x)
+{
+	x->samplerate = sys_getsr();
+	if(x->samplerate<=0.0)
+		x->samplerate = 44100.0;
+	return x->sampleinterval = 1.0/x->samplerate;
+}
+
+// Filter coefficients for one resonance, everything but the output gain
+void resonators_setcoeffs(t_resonators *x, rescoeffs *c, double f, double g, double rate, double srbar)
+{
+	double r = exp(-rate*srbar);
+	
+	if((f<=0.0) || (f>=(0.995*x->samplerate*0.5)) || (r<=0.0) || (r>1.0))
+	{
+//		post("Warning parameters out of range");
+		c->a1 = 0.0;
+		c->b1 = 0.0;
+		c->b2 = 0.0;
+		c->a1prime = 0.0;
+		c->fastr = 0.0;
 	}
+	else
+	{
+		double ts;
+		f *= 2.0*3.14159265358979323*srbar;
+		ts = g * sin(f);
+		c->b1 = r*cos(f)*2.0;
+		c->a1 = ts * (1.0-r);	// this is one of the relavent L norms
+		c->b2 = -r*r;
+		c->a1prime = ts/c->b2;	// this is the other norm that establishes the impulse response of the right amplitude (scaled
+								// so that it can be summed into the state variable outside the perform routine
+								// If patents were cheaper..........
+		c->fastr = exp(-rate*100.0*srbar)/r;	// to decay fast
+	}
+}
+
 void resonators_list(t_resonators *x, t_symbol *s, short argc, t_atom *argv)
 {
 	int i;
-	// does this overlap stuff work? why dont we buffer a1prime and fastr? 
-	
-#define NOOVERLAP
-#ifdef NOOVERLAP
-	double ta1[MAXRESONANCES];
-	double tb1[MAXRESONANCES];
-	double tb2[MAXRESONANCES];
-#endif
 	int nres;
 	double srbar;
-	//resdesc *fp = x->base;
-	dresdesc *dp = x->dbase;
+	resparams *latest, *p;
 	
-        x->samplerate =  sys_getsr();
-		if(x->samplerate<=0.0)
-			x->samplerate = 44100.0;
-		srbar = x->sampleinterval = 1.0/x->samplerate;
+	srbar = resonators_getsr(x);
 
 	if(argc==2)
 	{
@@ -1960,6 +2056,11 @@ void resonators_list(t_resonators *x, t_symbol *s, short argc, t_atom *argv)
 		object_post((t_object *)x, "multiple of 3 floats required (frequency amplitude decayRate");
 		return;
 	}
+	
+	// The perform routine can't see this block until we check it in, so we can
+	// compute straight into it.
+	latest = (resparams *) GetLatestParams(&x->pp);
+	p = (resparams *) CheckOutParamBlock(&x->pp);
 			
 	for(i=0; (i*3)<argc; ++i) {
 		if (i >= MAXRESONANCES) {
@@ -1971,76 +2072,64 @@ void resonators_list(t_resonators *x, t_symbol *s, short argc, t_atom *argv)
 			double f = atom_getfloatarg(i*3,argc,argv);
 			double g = 	atom_getfloatarg(i*3+1,argc,argv);
 			double rate = atom_getfloatarg(i*3+2,argc,argv);
-			double r;
-			r =  exp(-rate*srbar);
-			if((f<=0.0) || (f>=(0.995*x->samplerate*0.5)) || (r<=0.0) || (r>1.0))
-			{
-	//				post("Warning parameters out of range");
-	#ifdef NOOVERLAP
-				ta1[i] = 0.0;
-				tb1[i] = 0.0;
-				tb2[i] = 0.0;
-	#else
-				//fp[i].b1 = fp[i].b1 = 0.0f;
-				dp[i].b1 = dp[i].b1 = 0.0;
-	#endif
-				//fp[i].a1prime = 0.0f;
-				//fp[i].fastr = 0.0f;
-				dp[i].a1prime = 0.0;
-				dp[i].fastr = 0.0;
-			}
-			else
-			{
-				double ts;
-				f *= 2.0*3.14159265358979323*srbar;
-				ts = g;
-					ts *= sin(f);
-				tb1[i] = r*cos(f)*2.0;
-					ta1[i] = ts *  (1.0-r);   //this is one of the relavent L norms
-				tb2[i] =  -r*r;
-				/* fp[i].a1prime = */ dp[i].a1prime = ts/tb2[i];   //this is the other norm that establishes the impulse response of the right amplitude (scaled
-													// so that it can be summed into the state variable outside the perform routine 
-													// If patents were cheaper..........
-			/* fp[i].fastr = */ dp[i].fastr= exp(-rate*100.0*srbar)/r; //to decay fast
-			}
+			rescoeffs *c = &p->r[i];
+			resonators_setcoeffs(x, c, f, g, rate, srbar);
+#ifdef OGAIN
+			// Output gains carry over; totally new resonances start at unity
+			c->og = (i < latest->nres) ? latest->r[i].og : 1.0;
+#endif
 		}
 	}
 	/* Now we know how many "good" resonances (freq > 0) were in the list */
 	nres = i;
-//This is where we should be double buffering
-
-
-
-
-	for(i=0;i<nres;++i)
-	{
-			/* fp[i].b1 = */ dp[i].b1 = tb1[i];
-			/* fp[i].a1 = */ dp[i].a1 = ta1[i];
-			/* fp[i].b2 = */ dp[i].b2 =  tb2[i];
-			if(i>=x->nres) 	/* If there are now more resonances than there were: */ 
-
-			{
-			    // Set old a1 to zero so that the input to the new resonators will ramp up over the first signal vector.
-				// fp[i].o_a1 = 0.0f;
-				// fp[i].o_b1 = fp[i].b1;
-				// fp[i].o_b2 = fp[i].b2;
-				dp[i].o_a1 = 0.0;
-				dp[i].o_b1 = dp[i].b1;
-				dp[i].o_b2 = dp[i].b2;
-				// Clear out state variables for these totally new resonances
-				// fp[i].out1 = fp[i].out2 = 0.0f;
-				dp[i].out1 = dp[i].out2 = 0.0f;
+	p->nres = nres;
+	
+	CheckInNewParams(&x->pp);
+//		post("nres %d", nres);
+}
 
+// index frequency gain decayrate: changes one resonance and leaves the others
+// alone.  Index -1, or one past the last resonance, adds a resonance; any gap
+// is filled with silent ones.  Several such groups in one message are applied
+// together, with one copy of the model; this is what res-transform sends in
+// delta-output mode.
+void resonators_setoneresonance(t_resonators *x, t_symbol *s, short argc, t_atom *argv)
+{
+	int i, j, k;
+	double srbar;
+	resparams *p;
+	
+	if (argc == 0 || argc%4 != 0) {
+		object_error((t_object *)x, "setoneresonance needs groups of 4 arguments (index frequency amplitude decayRate)");
+		return;
+	}
+	srbar = resonators_getsr(x);
+	
+	p = resonators_copyparams(x);
+	for(j=0; j<argc; j+=4) {
+		k = atom_getintarg(j,argc,argv);
+		if (k == -1)
+			k = p->nres;
+		if (k < 0 || k >= MAXRESONANCES) {
+			object_error((t_object *)x, "setoneresonance: index %d out of range (0 to %d)", k, MAXRESONANCES-1);
+			continue;
+		}
+		for(i=p->nres; i<k; ++i) {
+			resonators_setcoeffs(x, &p->r[i], 0.0, 0.0, 0.0, srbar);
 #ifdef OGAIN
-				dp[i].o_og = dp[i].og = 1.0;
-				// fp[i].o_og = fp[i].og = 1.0f;
+			p->r[i].og = 1.0;
 #endif
-			}
+		}
+		resonators_setcoeffs(x, &p->r[k], atom_getfloatarg(j+1,argc,argv), atom_getfloatarg(j+2,argc,argv),
+							 atom_getfloatarg(j+3,argc,argv), srbar);
+		if (k >= p->nres) {
+#ifdef OGAIN
+			p->r[k].og = 1.0;
+#endif
+			p->nres = k+1;
+		}
 	}
-	x->nres = nres;
-	
-// end of double buffering
-//		post("nres %d x->nres %d", nres, x->nres);
+	CheckInNewParams(&x->pp);
 }
 
 void resonators_assist(t_resonators *x, void *b, long m, long a, char *s)
@@ -2129,11 +2218,24 @@ void *resonators_new(t_symbol *s, short argc, t_atom *argv)
 	    {			post("resonators~: warning: not enough memory.  Expect to crash soon.");
 	    	return 0;
 	    }
+	{
+		int i;
+		for (i = 0; i < PARAM_NUM_BLOCKS; ++i) {
+			x->params[i] = (resparams *) sysmem_newptr(sizeof(resparams));
+			if (x->params[i]==0)
+			{	post("resonators~: warning: not enough memory.  Expect to crash soon.");
+				return 0;
+			}
+		}
+		x->params[0]->nres = 0;
+		InitParamPointers(&x->pp, x->params[0], x->params[1], x->params[2], x->params[3]);
+	}
 
    x->nres = MAXRESONANCES;
     resonators_clear(x); // clears state
     x->nres = 0;
     resonators_list(x,s,argc,argv);
+    resonators_getparams(x);	// DSP isn't running yet, so we can pick them up ourselves
     {
     	// resdesc *f = x->base;
     	dresdesc *df = x->dbase;
@@ -2172,6 +2274,11 @@ void resonators_free(t_resonators *x) {
   dsp_free(&(x->b_obj));
   //sysmem_freeptr(x->base);
   sysmem_freeptr(x->dbase);
+  {
+	int i;
+	for (i = 0; i < PARAM_NUM_BLOCKS; ++i)
+		if (x->params[i]) sysmem_freeptr(x->params[i]);
+  }
 }
 
 int main(void){
@@ -2189,6 +2296,7 @@ int main(void){
     class_addmethod(resonators_class, (method)resonators_dsp64, "dsp64", A_CANT, 0);
 	class_addmethod(resonators_class, (method)resonators_list, "list", A_GIMME, 0);
 	class_addmethod(resonators_class, (method)outputgain_list, "outputgain", A_GIMME, 0);
+	class_addmethod(resonators_class, (method)resonators_setoneresonance, "setoneresonance", A_GIMME, 0);
 	class_addmethod(resonators_class, (method)resonators_clear, "clear", 0);
 	class_addmethod(resonators_class, (method)resonators_squelch, "squelch", 0);
 	class_addmethod(resonators_class, (method)resonators_bang, "bang", 0);
@@ -37,6 +37,7 @@ VERSION 1.0: First version
 VERSION 1.1: Added choice of diffent formulas for calculating the cbw
 VERSION 1.2: Reads the contents of SDIF-buffers
 VERSION 1.2.1: Fixed a bug where in the computation of the denominator in rho_process_parncutt
+VERSION 1.3: Only compares partials within a few critical bandwidths of each other; batch message
 @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 */
 #define NAME "roughness"
@@ -60,16 +61,32 @@ VERSION 1.2.1: Fixed a bug where in the computation of the denominator in rho_pr
 
 #define VERY_SMALL 0.00000000001
 
+// Pairs of partials whose standard curve is below this are left out
+#define RHO_CURVE_FLOOR 1e-7
+
+// outlet_list() takes a short count
+#define RHO_MAXBATCH 32767
+
 #include "SDIF-buffer.h"  //  includes sdif.h, sdif-mem.h, sdif-buf.h
 #include "sdif-util.h"
 
+typedef struct _rho_partial
+{
+	float f, a;
+} t_rho_partial;
+
 typedef struct _rho
 {
 	t_object r_ob;
 	long r_in0;
 	void *r_out1;
+	void *r_out2;
 	float *r_buffer;
 	long r_bufferLen;
+	long r_bufferSize;
+	t_rho_partial *r_partials;	// r_bufferSize / 2 of them, sorted by frequency while processing
+	float r_cbWindow;
+	float r_windowMinFreq;
 	long r_cbwType;
 	int r_method;
 	float r_scIndex;
@@ -86,9 +103,15 @@ t_class *rho_class;
 void rho_anything(t_rho *x, t_symbol *msg, short argc, t_atom *argv);
 void rho_list(t_rho *x, t_symbol *msg, short argc, t_atom *argv);
 void rho_process(t_rho *x);
-void rho_process_parncutt(t_rho *x);
-void rho_process_kk(t_rho *x);
+float rho_compute(t_rho *x, float *buf, long n);
+float rho_process_parncutt(t_rho *x, float *buf, long n);
+float rho_process_kk(t_rho *x, float *buf, long n);
+int rho_reserve(t_rho *x, long n);
+int rho_comparePartials(const void *a, const void *b);
+void rho_setWindow(t_rho *x);
+long rho_readFrame(t_rho *x, SDIFmem_Frame f);
 void rho_processSDIF(t_rho *x);
+void rho_batch(t_rho *x);
 float rho_a2db(float a);
 void rho_deswizzle(float *l, int n, float l1[], float l2[]);
 void rho_set_cbw_type(t_rho *x, long t);
@@ -105,7 +128,7 @@ static void rho_setSDIFbuffer(t_rho *x, t_symbol *bufName);
 static void *my_getbytes(int numBytes);
 static void my_freebytes(void *bytes, int size);
 static void rho_GetMaxNumRows(t_rho *x);
-static void SetAtomFromMatrix(t_atom *a, SDIFmem_Matrix m, sdif_int32 column, sdif_int32 row);
+static float GetCellFromMatrix(SDIFmem_Matrix m, sdif_int32 column, sdif_int32 row);
 
 void rho_SDIFtime(t_rho *x, double t);
 
@@ -129,6 +152,7 @@ int main(void){
 	class_addmethod(rho_class, (method)rho_SDIFtime, "SDIFtime", A_FLOAT, 0);
 	class_addmethod(rho_class, (method)rho_setSDIFbuffer, "set", A_SYM, 0);
 	class_addmethod(rho_class, (method)rho_processSDIF, "process_SDIF", 0);
+	class_addmethod(rho_class, (method)rho_batch, "batch", 0);
 	
 	SDIFresult r;
 	
@@ -174,10 +198,13 @@ void *rho_new(void){
 	}
  // create a new instance of this object
 	
+	x->r_out2 = listout(x);
 	x->r_out1 = floatout(x);	
 	
 	x->r_buffer = NULL;
 	x->r_bufferLen = 0;
+	x->r_bufferSize = 0;
+	x->r_partials = NULL;
 	
 	x->r_cbwType = CBW_MOORE_GLASBERG;
 	x->r_method = PARNCUTT;
@@ -187,6 +214,7 @@ void *rho_new(void){
 	x->m_SDIFbuffer = 0;
 	x->m_buf = NULL;
 	x->r_scIndex = 2.0; // parncutt's original value
+	rho_setWindow(x);
 	
 	/*
 	if(argc == 2){
@@ -206,118 +234,219 @@ void rho_anything(t_rho *x, t_symbol *msg, short argc, t_atom *argv){
 }
 
 void rho_list(t_rho *x, t_symbol *msg, short argc, t_atom *argv){
-	if(argc > x->r_bufferLen)
-		x->r_buffer = (float *)realloc(x->r_buffer, argc * sizeof(float));
+	if(!rho_reserve(x, (argc + 1) / 2))
+		return;
 	
 	x->r_bufferLen = (long)argc;
 	int i;
 	for(i = 0; i < argc; i++){
-		x->r_buffer[i] = (float)argv[i].a_w.w_float;
+		x->r_buffer[i] = (float)atom_getfloat(argv + i);
 	}
 		
 	rho_process(x);
 }
 
 void rho_process(t_rho *x){
+	outlet_float(x->r_out1, rho_compute(x, x->r_buffer, x->r_bufferLen / 2));
+}
+
+float rho_compute(t_rho *x, float *buf, long n){
 	switch(x->r_method){
-		case PARNCUTT:
-			rho_process_parncutt(x);
-			break;
 		case KK:
-			rho_process_kk(x);
-			break;
+			return rho_process_kk(x, buf, n);
+		case PARNCUTT:
+		default:
+			return rho_process_parncutt(x, buf, n);
 	}
 }
 
-void rho_processSDIF(t_rho *x){
-	int i;
-	int numRows;
-	
-	SDIFmem_Frame f = SDIFbuf_GetFirstFrame(x->m_buf);
+// Copy the frequency and amplitude columns of a frame's matrix into r_buffer.
+// Returns the number of partials, or -1 if the frame has no matrix of its own type.
+long rho_readFrame(t_rho *x, SDIFmem_Frame f){
 	char frameType[4];
+	SDIFmem_Matrix m;
+	long i, numRows;
+
 	SDIF_Copy4Bytes(frameType, f->header.frameType);
-	SDIFmem_Matrix m = SDIFbuf_GetMatrixInFrame(f, frameType);
-	
+	if(!(m = SDIFbuf_GetMatrixInFrame(f, frameType)))
+		return -1;
+	if(m->header.columnCount < 3)
+		return -1;
+
 	numRows = m->header.rowCount;
-	if(numRows > x->r_bufferLen) 
-		x->r_buffer = (float *)realloc(x->r_buffer, (numRows * 2) * sizeof(float));
-		
-	for(i = 0; i < m->header.rowCount; i++){
-		x->r_buffer[i * 2] = SDIFutil_GetMatrixCell(m, 1, i);
-		x->r_buffer[(i * 2) + 1] = SDIFutil_GetMatrixCell(m, 2, i);
+	if(!rho_reserve(x, numRows))
+		return -1;
+	for(i = 0; i < numRows; i++){
+		x->r_buffer[i * 2] = GetCellFromMatrix(m, 1, i);
+		x->r_buffer[(i * 2) + 1] = GetCellFromMatrix(m, 2, i);
 	}
-	x->r_bufferLen = numRows;
-	rho_process(x);
-	
-	while(f){
-		f = SDIFbuf_GetNextFrame(f);
-		if(!f) break;
+	x->r_bufferLen = numRows * 2;
+	return numRows;
+}
 
-		SDIF_Copy4Bytes(frameType, f->header.frameType);
-		m = SDIFbuf_GetMatrixInFrame(f, frameType);
-		
-		numRows = m->header.rowCount;
-		if(numRows > x->r_bufferLen)
-			x->r_buffer = (float *)realloc(x->r_buffer, (numRows * 2) * sizeof(float));
-		
-		for(i = 0; i < numRows; i++){
-			x->r_buffer[i * 2] = SDIFutil_GetMatrixCell(m, 1, i);
-			x->r_buffer[(i * 2) + 1] = SDIFutil_GetMatrixCell(m, 2, i);
+void rho_processSDIF(t_rho *x){
+	SDIFmem_Frame f;
+
+	if(!x->m_buf){
+		object_error((t_object *)x, "no SDIF-buffer set");
+		return;
+	}
+	for(f = SDIFbuf_GetFirstFrame(x->m_buf); f; f = SDIFbuf_GetNextFrame(f)){
+		if(rho_readFrame(x, f) >= 0)
+			rho_process(x);
+	}
+}
+
+// Roughness of every frame in the SDIF-buffer, out the right outlet as one list
+// of at most RHO_MAXBATCH values.
+void rho_batch(t_rho *x){
+	SDIFmem_Frame f;
+	t_atom *out;
+	long numFrames = 0, k = 0;
+
+	if(!x->m_buf){
+		object_error((t_object *)x, "no SDIF-buffer set");
+		return;
+	}
+	for(f = SDIFbuf_GetFirstFrame(x->m_buf); f; f = SDIFbuf_GetNextFrame(f))
+		numFrames++;
+	if(!numFrames)
+		return;
+	if(numFrames > RHO_MAXBATCH){
+		object_error((t_object *)x, "%ld frames in the SDIF-buffer; only the first %d will be output", numFrames, RHO_MAXBATCH);
+		numFrames = RHO_MAXBATCH;
+	}
+	if(!(out = (t_atom *)calloc(numFrames, sizeof(t_atom)))){
+		object_error((t_object *)x, "out of memory");
+		return;
+	}
+	for(f = SDIFbuf_GetFirstFrame(x->m_buf); f && k < numFrames; f = SDIFbuf_GetNextFrame(f)){
+		if(rho_readFrame(x, f) >= 0)
+			atom_setfloat(out + k++, rho_compute(x, x->r_buffer, x->r_bufferLen / 2));
+	}
+	outlet_list(x->r_out2, NULL, (short)k, out);
+	free(out);
+}
+
+// Make room for n partials in r_buffer and r_partials.
+int rho_reserve(t_rho *x, long n){
+	if(n * 2 > x->r_bufferSize){
+		float *b = (float *)realloc(x->r_buffer, n * 2 * sizeof(float));
+		t_rho_partial *p = (t_rho_partial *)realloc(x->r_partials, n * sizeof(t_rho_partial));
+		if(b) x->r_buffer = b;
+		if(p) x->r_partials = p;
+		if(!b || !p){
+			object_error((t_object *)x, "out of memory");
+			return 0;
 		}
-		x->r_bufferLen = numRows;
-		rho_process(x);
+		x->r_bufferSize = n * 2;
+	}
+	return 1;
+}
+
+int rho_comparePartials(const void *a, const void *b){
+	float fa = ((const t_rho_partial *)a)->f, fb = ((const t_rho_partial *)b)->f;
+	return (fa > fb) - (fa < fb);
+}
+
+// The standard curve (e r exp(-r))^index peaks at r = 1 and falls away on
+// either side, so partials more than r_cbWindow critical bandwidths apart are
+// left out.  The window is where the curve drops below RHO_CURVE_FLOOR.
+void rho_setWindow(t_rho *x){
+	float cbInterval0 = 0.25;
+	double index = x->r_scIndex;
+	double lo = 1., hi = 1000., target;
+	int i;
+
+	if(index <= 0){
+		x->r_cbWindow = x->r_windowMinFreq = HUGE_VAL;
+		return;
+	}
+	target = log(RHO_CURVE_FLOOR) / index;
+	if(1. + log(hi) - hi > target){
+		x->r_cbWindow = x->r_windowMinFreq = HUGE_VAL;
+		return;
+	}
+	for(i = 0; i < 60; i++){
+		double r = 0.5 * (lo + hi);
+		if(1. + log(r) - r > target) lo = r;
+		else hi = r;
+	}
+	x->r_cbWindow = hi * cbInterval0;
+
+	// Going through the partials in order of frequency, we can stop at the
+	// first f2 with f2 - f1 > window * cbw(f2), but only where cbw grows more
+	// slowly than 1 / window so that every higher f2 is out too.
+	switch(x->r_cbwType){
+		case CBW_HUTCHINSON_KNOPOFF:
+			// d/df 1.72 f^0.65 = 1.118 f^-0.35
+			x->r_windowMinFreq = pow(1.118 * x->r_cbWindow, 1. / 0.35);
+			break;
+		case CBW_MOORE_GLASBERG:
+		default:
+			x->r_windowMinFreq = (0.108 * x->r_cbWindow < 1.) ? 0. : HUGE_VAL;
+			break;
 	}
 }
 
-void rho_process_parncutt(t_rho *x){
-	int i, j;
+float rho_process_parncutt(t_rho *x, float *buf, long n){
+	long i, j, np = 0, last = -1;
 	float numerator, denominator, meanFreq, cbw, cbInterval, ratio, standardCurve, roughness;
 	float cbInterval0 = 0.25;
 	float index = x->r_scIndex;//2; // the bigger index, the narrower the curve
 	float e = expf(1); // 2.7182818=base of natural logs
+	float window = x->r_cbWindow;
+	float minFreq = x->r_windowMinFreq;
+	t_rho_partial *p;
 	
 	numerator = denominator = 0;	
 	float f1, f2, a1, a2;
-	int counter = 0;
-	
-	for(i = 0; i < (x->r_bufferLen / 2) - 1; i++){
-		f1 = x->r_buffer[i * 2];
-		a1 = x->r_buffer[(i * 2) + 1];
-		counter = 0;
+
+	if(!rho_reserve(x, n))
+		return 0;
+	p = x->r_partials;
+
+	// Each partial with a positive amplitude counts in the denominator if
+	// there's another one after it in the list, i.e. all but the last.
+	for(i = 0; i < n; i++){
+		a1 = buf[(i * 2) + 1];
 		if(a1 > 0.){
-		
-			for(j = i + 1; j < (x->r_bufferLen / 2); j++){
-				f2 = x->r_buffer[j * 2];
-				a2 = x->r_buffer[(j * 2) + 1];
-				if(a2 > 0.){
-					counter++;
-					//post("i: %d, j: %d, %.10f %.10f %.10f %.10f", i, j, f1, a1, f2, a2);
-					
-					meanFreq = (f1 + f2) / 2;
-					cbw = rho_cbw(x, meanFreq);
-					cbInterval = (fabsf(f2 - f1)) / cbw;
-					ratio = cbInterval / cbInterval0;
-					//post( "%f, %f, %f\n", ( e * ratio ), exp ( -1 * ratio ), ratio );
-					standardCurve = powf((e * ratio) * expf(-1 * ratio), index);
-					//printf ( "%f\n", standardCurve );
-					numerator += a1 * a2 * standardCurve;
-					//printf ( "%f, %f, %f\n", gAmpData[i][j], gAmpData[k][l], numerator );
-				}
-			}
-			// this counter is to make sure that a1 was compared to something.
-			if(counter) denominator += a1 * a1;	
+			if(last >= 0)
+				denominator += buf[(last * 2) + 1] * buf[(last * 2) + 1];
+			last = i;
+			p[np].f = buf[i * 2];
+			p[np].a = a1;
+			np++;
+		}
+	}
+	qsort(p, np, sizeof(t_rho_partial), rho_comparePartials);
+	
+	for(i = 0; i < np - 1; i++){
+		f1 = p[i].f;
+		a1 = p[i].a;
+		for(j = i + 1; j < np; j++){
+			f2 = p[j].f;
+			if(f2 >= minFreq && f2 - f1 > window * rho_cbw(x, f2))
+				break;
+			a2 = p[j].a;
+			meanFreq = (f1 + f2) / 2;
+			cbw = rho_cbw(x, meanFreq);
+			cbInterval = (fabsf(f2 - f1)) / cbw;
+			ratio = cbInterval / cbInterval0;
+			standardCurve = powf((e * ratio) * expf(-1 * ratio), index);
+			numerator += a1 * a2 * standardCurve;
 		}
 	}
-	//post("numerator: %f\ndenominator: %f\n", numerator, denominator);
 	if(denominator > 0)
 		roughness = numerator / denominator;
 	else roughness = 0;
-	outlet_float(x->r_out1, roughness);
-	//post("roughness: %f", roughness);
-	
+	return roughness;
 }
 
-void rho_process_kk(t_rho *x){
+// Kameoka & Kuriyagawa.  A dyad an octave or more wide only contributes the
+// ambient noise, which is subtracted back out, so with the partials sorted by
+// frequency each one is only compared with those less than an octave above it.
+float rho_process_kk(t_rho *x, float *buf, long n){
 	float k0 = 1.0;
 	float C0 = 65;
 	float B = 0.25;		// Kameoka & Kuriyagawa's "beta" constant.
@@ -328,60 +457,54 @@ void rho_process_kk(t_rho *x){
 						// -loudness tones having a combined loudness of 60 dB,
 						// i.e. 57 dB SPL for each tone.
 	float fb;
-	float DI2ei, DIn, D2i, DI2i, DIt, D2ei;
+	float DI2ei, DIn, D2i, DI2i, DIt = 0, D2ei;
 	float f1, f2, a1, a2;
-	int i, j;
-	
-	float *freq = (float *)calloc(x->r_bufferLen / 2, sizeof(float));
-	float *amp = (float *)calloc(x->r_bufferLen / 2, sizeof(float));
-	rho_deswizzle(x->r_buffer, x->r_bufferLen, freq, amp);
+	long i, j;
+	t_rho_partial *p;
+
+	if(!rho_reserve(x, n))
+		return 0;
+	p = x->r_partials;
+	for(i = 0; i < n; i++){
+		p[i].f = buf[i * 2];
+		p[i].a = rho_a2db(buf[(i * 2) + 1]);
+	}
+	qsort(p, n, sizeof(t_rho_partial), rho_comparePartials);
+
+	// Compute dissonance intensity of noise DIn = (Dn0/k0)^(1/B) = C0^(1/B)
+
+	DIn = powf(C0, (1/B)); // Equation (11).
 		
-	for(i = 0; i < (x->r_bufferLen / 2) - 1; i++){
-		for(j = i + 1; j < (x->r_bufferLen / 2); j++){
-			if(freq[i] < freq[j]){
-				f1 = freq[i];
-				f2 = freq[j];
-				a1 = rho_a2db(amp[i]);
-				a2 = rho_a2db(amp[j]);
-			} else {
-				f2 = freq[i];
-				f1 = freq[j];
-				a2 = rho_a2db(amp[i]);
-				a1 = rho_a2db(amp[j]);
-			}
-			//if(fabsf(a1 - a2) > 25) post("%d %d, a1 - a2 is greater than 25, so we're going to break", i, j);
-			//if(a1 <= 17) post("%d %d, a1 is greater than 17, so we're going to break", i, j);
-			if(fabsf(a1 - a2) > 25) break;
-			if(a1 <= 17) break;
-			if(f1 < 20 || f2 < 20) break;
+	for(i = 0; i < n - 1; i++){
+		f1 = p[i].f;
+		if(f1 < 20) continue;
+		for(j = i + 1; j < n && p[j].f < 2 * f1; j++){
+			f2 = p[j].f;
+			a1 = p[i].a;
+			a2 = p[j].a;
+			if(fabsf(a1 - a2) > 25) continue;
+			if(a1 <= 17) continue;
 			fb = 2.27 * (((a1 - 57) / 40) + 1) * powf(f1, 0.477); // Equation 6.  This should go into the rho_cbw routine.
 			
-			object_post((t_object *)x, "%d %d, f1 = %f f2 = %f a1 = %f a2 = %f", i, j, f1, f2, a1, a2);
-			object_post((t_object *)x, "fb = %f", fb);
-			
-			// Supra-octave domain -- and near unison domain.
+			// Near unison domain.
 			// (We avoid calculations near zero frequency difference in order
 			//  to avoid log(0) when (f2-f1)/f1 is <=0.01)
 			//
 			// Assign only dissonance arising from ambient noise.
-			if ( f2 >= 2*f1 || (f2-f1)/f1 <= 0.01 )
+			if ( (f2-f1)/f1 <= 0.01 )
 				D2ei = k0*C0;  // Equation (9).
 			else{
 				// Dynamic Domain.  Note that the case where (f2-f1)/f1 is close to 0
 				// is taken care of above to avoid log(0).  
 				if ( f2-f1 <= fb )
 					D2ei = k0*( 100*( 2+log10((f2-f1)/f1) )/( 2+log10(fb/f1) ) + C0 ); //Equation (7).
-				else if ( f2-f1 > fb )
+				else
 					D2ei = k0*( 90*( log10((f2-f1)/f1) )/( log10(fb/f1) ) + 10 + C0 ); // Static Domain.
 			}
 			// Compute the Absolute Dissonance Intensity (DI) for the F1-F2 dyad.
 
 			DI2ei = powf((D2ei/k0), (1/B));	// Equation (10).
 
-			// Compute dissonance intensity of noise DIn = (Dn0/k0)^(1/B) = C0^(1/B)
-
-			DIn = powf(C0, (1/B)); // Equation (11).
-
 			// Subtract noises from dissonance.
 
 			DI2ei = DI2ei - DIn;
@@ -417,10 +540,7 @@ void rho_process_kk(t_rho *x){
 	DIt += powf((k0*C0), (1/B));
  
 	// The total absolute dissonance of the complex tone. 
-	outlet_float(x->r_out1,  powf(k0*DIt, B));
-	
-	free(freq);
-	free(amp);
+	return powf(k0*DIt, B);
 }
 
 float rho_a2db(float a){
@@ -440,6 +560,7 @@ void rho_deswizzle(float *l, int n, float l1[], float l2[]){
 
 void rho_set_cbw_type(t_rho *x, long t){
 	x->r_cbwType = t;
+	rho_setWindow(x);
 	switch(t){
 		case CBW_HUTCHINSON_KNOPOFF:
 			object_post((t_object *)x, "Using Hutchinson and Knopoff's critical bandwidth formula:");
@@ -455,6 +576,7 @@ void rho_set_cbw_type(t_rho *x, long t){
 
 void rho_standardCurveIndex(t_rho *x, double i){
 	x->r_scIndex = (float)i;
+	rho_setWindow(x);
 }
 
 float rho_cbw(t_rho *x, float f){
@@ -474,7 +596,7 @@ void rho_bang(t_rho *x)
 void rho_assist(t_rho *x, void *b, long m, long a, char *s)
 {
 	if (m == ASSIST_OUTLET)
-		sprintf(s,"help");
+		sprintf(s, a ? "roughness of every frame of the SDIF-buffer (list)" : "roughness (float)");
 	else {
 		switch (a) {	
 		case 0:
@@ -487,6 +609,7 @@ void rho_assist(t_rho *x, void *b, long m, long a, char *s)
 void rho_free(t_rho *x)
 {
 	free(x->r_buffer);
+	free(x->r_partials);
 }
 
 void rho_tellmeeverything(t_rho *x){
@@ -504,26 +627,14 @@ void rho_tellmeeverything(t_rho *x){
 }
 
 void rho_SDIFtime(t_rho *x, double t){
-	int i = 1;
-	char frameType[4];
-	short numArgs = 0;
-	t_atom *outputArgs;
 	SDIFmem_Frame f;
 	
+	if(!x->m_buf)
+		return;
 	if(!(f = SDIFbuf_GetFrame(x->m_buf, t, ESDIF_SEARCH_BACKWARDS)))
 		return;
-	
-	SDIF_Copy4Bytes(frameType, f->header.frameType);
-	SDIFmem_Matrix m = SDIFbuf_GetMatrixInFrame(f, frameType);
-	outputArgs = (t_atom *)calloc(m->header.rowCount * 2, sizeof(t_atom));
-	//x->r_SDIFindexes = (int *)realloc(x->r_SDIFindexes, m->header.rowCount * sizeof(int));
-	
-	for(i = 0; i < m->header.rowCount; i++){
-		//x->r_SDIFindexes[i] = SDIFutil_GetMatrixCell(m, 0, i);
-		SetAtomFromMatrix(&(outputArgs[numArgs++]), m, 1, i);
-		SetAtomFromMatrix(&(outputArgs[numArgs++]), m, 2, i);
-	}
-	rho_list(x, 0L, numArgs, outputArgs);
+	if(rho_readFrame(x, f) >= 0)
+		rho_process(x);
 }
 
 ////////////////////////////////////////////////////
@@ -615,10 +726,10 @@ static void rho_GetMaxNumRows(t_rho *x){
 	}
 }
 
-static void SetAtomFromMatrix(t_atom *a, SDIFmem_Matrix m, sdif_int32 column, sdif_int32 row) {
+static float GetCellFromMatrix(SDIFmem_Matrix m, sdif_int32 column, sdif_int32 row) {
 	if (m->header.matrixDataType == SDIF_INT32) {
-		atom_setlong(a, SDIFutil_GetMatrixCell_int32(m, column, row));
+		return (float)SDIFutil_GetMatrixCell_int32(m, column, row);
 	} else {
-		atom_setfloat(a, SDIFutil_GetMatrixCell(m, column, row));
+		return SDIFutil_GetMatrixCell(m, column, row);
 	}
 }
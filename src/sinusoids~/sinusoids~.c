@@ -44,6 +44,7 @@ VERSION 1.7.5: Force Package Info Generation
 VERSION 1.7.6: Changed max sinusoids to 1024 -mzed
 VERSION 1.8: Debugged bandwidth enhancement to make it more narrowband
 VERSION 1.9: Changed click problem on Intel by removing small random numbers from table, tweaked compiler options for performance, removed NTABSZ
+VERSION 1.9.1: setonesinusoid message (one or more partials), so res-transform's delta-output mode can drive it
 
 @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 
@@ -125,6 +126,8 @@ void  sinusoids_bwe_perform64(t_sinusoids *x, t_object *dsp64, double **ins, lon
 void sinusoids_dsp(t_sinusoids *x, t_signal **sp, short *connect);
 void sinusoids_dsp64(t_sinusoids *x, t_object *dsp64, short *count, double samplerate, long maxvectorsize, long flags);
 void sinusoids_list(t_sinusoids *x, t_symbol *s, short argc, t_atom *argv);
+void sinusoids_setonesinusoid(t_sinusoids *x, t_symbol *s, short argc, t_atom *argv);
+void sinusoids_setone(t_sinusoids *x, int i, int old_nosc, double f, double a, double b);
 void sinusoids_clear(t_sinusoids *x);
 void sinusoids_assist(t_sinusoids *x, void *b, long m, long a, char *s);
 void *sinusoids_new(t_symbol *s, short argc, t_atom *argv);
@@ -507,40 +510,89 @@ void sinusoids_list(t_sinusoids *x, t_symbol *s, short argc, t_atom *argv) {
 			a = atom_getfloatarg(i*2+1,argc,argv);
 			b = 0.0f;
 		}
-		
-		if((f<=0.0f) || (f>=(x->samplerate*0.5f))) {
-			// MW commented these out; fade out this partial but leave freq+noisiness alone
-			// fp[i].next_phase_inc = 0;
-			// fp[i].amplitude = 0.0f;
-			// fp[i].phase_inc = 0;
-			// fp[i].phase_current = 0;
-			// fp[i].next_noisiness = 0.0f;
-			fp[i].next_amplitude = 0.0f;
-			if (x->verbose) {
-				object_error((t_object *)x, "sinusoids~: bad frequency %f for partial %ld (killing partial)", f, i+1);
-			}
-		} else {
-			fp[i].next_phase_inc = x->pk*f;	/* frequency	*/
-			fp[i].next_amplitude = a;		/* amplitude	*/
-			fp[i].next_noisiness = b;
+		sinusoids_setone(x, i, old_nosc, f, a, b);
+	}
+//		post("nosc %d x-nosc %d", nosc, x->nosc);
+}
+
+// Sets partial i's targets; partials at or past old_nosc are born silent.
+void sinusoids_setone(t_sinusoids *x, int i, int old_nosc, double f, double a, double b) {
+	oscdesc *fp = x->base;
+	
+	if((f<=0.0f) || (f>=(x->samplerate*0.5f))) {
+		// MW commented these out; fade out this partial but leave freq+noisiness alone
+		// fp[i].next_phase_inc = 0;
+		// fp[i].amplitude = 0.0f;
+		// fp[i].phase_inc = 0;
+		// fp[i].phase_current = 0;
+		// fp[i].next_noisiness = 0.0f;
+		fp[i].next_amplitude = 0.0f;
+		if (x->verbose) {
+			object_error((t_object *)x, "sinusoids~: bad frequency %f for partial %ld (killing partial)", f, i+1);
 		}
-		
-		if (b < 0.0f || b > 1.0f) {
-			if (x->verbose) {
-				object_error((t_object *)x, "sinusoids~: bad noisiness %f for partial %ld (setting to 0)", f, i+1);
-			}
-			fp[i].next_noisiness = 0.0f;
+	} else {
+		fp[i].next_phase_inc = x->pk*f;	/* frequency	*/
+		fp[i].next_amplitude = a;		/* amplitude	*/
+		fp[i].next_noisiness = b;
+	}
+	
+	if (b < 0.0f || b > 1.0f) {
+		if (x->verbose) {
+			object_error((t_object *)x, "sinusoids~: bad noisiness %f for partial %ld (setting to 0)", f, i+1);
+		}
+		fp[i].next_noisiness = 0.0f;
+	}
+	
+	if (i >= old_nosc) {
+		/* Birth: fade amplitude up from zero, but keep freq+noisiness constant */
+		fp[i].amplitude = 0.0f;
+		fp[i].phase_inc = fp[i].next_phase_inc;
+		fp[i].noisiness = fp[i].next_noisiness;
+	}
+	//	post("%d %d %d %f %f %f", i, nosc,fp[i].next_phase_inc, fp[i].next_amplitude, f, a);
+}
+
+/* index frequency amplitude (noisiness): changes one partial and leaves the
+   others alone.  Index -1, or one past the last partial, adds a partial; any
+   gap is filled with silent ones.  Several such groups can come in one
+   message (groups of 4 in bwe mode); this is what res-transform sends in
+   delta-output mode. */
+void sinusoids_setonesinusoid(t_sinusoids *x, t_symbol *s, short argc, t_atom *argv) {
+	oscdesc *fp = x->base;
+	int i, j, k, old_nosc;
+	int group = (x->is_bwe && argc != 3) ? 4 : 3;
+	
+	if (argc == 0 || argc % group != 0) {
+		object_error((t_object *)x, x->is_bwe ?
+					 "setonesinusoid needs groups of 4 arguments (index frequency amplitude noisiness), or 3 for one partial" :
+					 "setonesinusoid needs groups of 3 arguments (index frequency amplitude)");
+		return;
+	}
+	
+	old_nosc = x->nosc;
+	for (j = 0; j < argc; j += group) {
+		k = atom_getintarg(j,argc,argv);
+		if (k == -1)
+			k = x->next_nosc;
+		if (k < 0 || k >= MAXOSCILLATORS) {
+			object_error((t_object *)x, "setonesinusoid: index %ld out of range (0 to %ld)", (long)k, (long)MAXOSCILLATORS-1);
+			continue;
 		}
 		
-		if (i >= old_nosc) {
-			/* Birth: fade amplitude up from zero, but keep freq+noisiness constant */
-			fp[i].amplitude = 0.0f;
-			fp[i].phase_inc = fp[i].next_phase_inc;
-			fp[i].noisiness = fp[i].next_noisiness;
+		if (k >= x->next_nosc) {
+			for (i = x->next_nosc; i < k; ++i) {
+				fp[i].next_amplitude = 0.0f;
+				if (i >= old_nosc) {
+					fp[i].amplitude = 0.0f;
+				}
+			}
+			x->next_nosc = k+1;
+			if (x->next_nosc > x->nosc)
+				x->nosc = x->next_nosc;
 		}
-		//	post("%d %d %d %f %f %f", i, nosc,fp[i].next_phase_inc, fp[i].next_amplitude, f, a);
+		sinusoids_setone(x, k, old_nosc, atom_getfloatarg(j+1,argc,argv), atom_getfloatarg(j+2,argc,argv),
+						 group == 4 ? atom_getfloatarg(j+3,argc,argv) : 0.0f);
 	}
-//		post("nosc %d x-nosc %d", nosc, x->nosc);
 }
 
 void sinusoids_assist(t_sinusoids *x, void *box, long msg, long arg, char *dstString) {
@@ -639,6 +691,7 @@ int main(void){
 	//class_addmethod(sinusoids_class, (method)sinusoids_dsp, "dsp", A_CANT, 0);
     class_addmethod(sinusoids_class, (method)sinusoids_dsp64, "dsp64", A_CANT, 0);
 	class_addmethod(sinusoids_class, (method)sinusoids_list, "list", A_GIMME, 0);
+	class_addmethod(sinusoids_class, (method)sinusoids_setonesinusoid, "setonesinusoid", A_GIMME, 0);
 	class_addmethod(sinusoids_class, (method)sinusoids_clear, "clear", 0);
 	class_addmethod(sinusoids_class, (method)sinusoids_assist, "assist", A_CANT, 0);
 	class_addmethod(sinusoids_class, (method)tellmeeverything, "tellmeeverything", 0);
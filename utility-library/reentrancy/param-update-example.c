@@ -1,56 +1,67 @@
 typedef struct myparamstruct {
 	int n;
-	float *values;
+	float values[MAXVALUES];
 } myparams;
 
 typedef struct _myobjecct {
 	t_pxobject b_obj;
 	...
+	myparams *blocks[PARAM_NUM_BLOCKS];
 	paramPointers pp;
 } myobject;
 
 
 new() {
 	myobject *x;
-	myparams *one, *two, *three;
-	
+	int i;
+
 	x=newobject(...);
-	
-	one = getbytes(...);
-	two = getbytes(...);
-	three = getbytes(...);
-	
-	one->values = initial_values;
-	
-	InitParamPointers(x->pp, one, two, three);
+
+	for (i = 0; i < PARAM_NUM_BLOCKS; ++i) {
+		x->blocks[i] = (myparams *) sysmem_newptrclear(sizeof(myparams));
+	}
+
+	x->blocks[0]->n = ...initial values...;
+
+	InitParamPointers(&x->pp, x->blocks[0], x->blocks[1], x->blocks[2], x->blocks[3]);
 }
 
 
 Update(myobject *x, ...) {
 	myparams *nextParams;
-	
-	nextParams = (myparams *) CheckOutParamBlock(x->pp);
-	
-	/* Lots of computation */
-	nextParams->values = new_values;
-	
-	CheckInNewParams(x->pp);
+
+	nextParams = (myparams *) CheckOutParamBlock(&x->pp);
+
+	/* Lots of computation; nextParams has garbage in it, so either write everything
+	   or start from a copy of (myparams *) GetLatestParams(&x->pp) */
+	nextParams->n = ...;
+	nextParams->values[...] = new_values;
+
+	CheckInNewParams(&x->pp);
 }
 
 Perform(myobject *x, ...) {
-	myparams *fromParams, *nextParams;
-	
-	fromParams = (myparams *) GetPreviousParams(x->pp);
-	toParams = (myparams *) GetCurrentParams(x->pp);
-	
+	myparams *fromParams, *toParams;
+	float v[MAXVALUES], inc[MAXVALUES];
+
+	toParams = (myparams *) GetCurrentParams(&x->pp);
+	fromParams = (myparams *) GetPreviousParams(&x->pp);
+
 	/* Process using those "snapshot"s */
 	if (fromParams == toParams) {
 		/* Parameters haven't changed since the last perform(); no need to interpolate */
-	
+
 		...
 	} else {
 		/* Interpolate from fromParams to toParams */
+		ParamRampFloat(inc, fromParams->values, toParams->values, toParams->n, n);
+		for (i = 0; i < toParams->n; ++i) v[i] = fromParams->values[i];
+
+		for (j = 0; j < n; ++j) {
+			... use v[] ...
+			for (i = 0; i < toParams->n; ++i) v[i] += inc[i];
+		}
 	}
-	
-	DoneWithPreviousParams(x->pp);
+
+	DoneWithPreviousParams(&x->pp);
 }
@@ -27,6 +27,8 @@ University of California, Berkeley.
 param-update.c
 	Pointer-swapping mechanism for geting atomic parameter updates for Max/MSP objects
 	Matt Wright, 4/21/2003
+	
+	Made lock-free with C11 atomics, interpolation helpers added, 2026.
 */
 
 
@@ -38,146 +40,140 @@ param-update.c
 	It's hairy because the audio interrupt might
 	come in the middle of computing the new coefficients.  In the worst case, we get new
 	parameters and compute new coefficients, then get new new parameters, and, in the
-	middle of computing the new new coefficients, get an audio interrupt.  From this case
-	we see that we need three buffers:  the old coefficients (that we used on the last
-	vector), the new coefficients (that we just computed), and temporary space to compute
-	a new set of coefficients.
+	middle of computing the new new coefficients, get an audio interrupt.  On a
+	multiprocessor the audio thread doesn't even have to interrupt us: it runs
+	alongside, and sees our stores in whatever order the hardware likes unless we say
+	otherwise.
 	
-	We have four pointers to these three arrays:
-		coeff - the values we'll use next time
-		oldcoeff - the values we used last time
-		newcoeff - where we compute new values
-		freecoeff - If coeff==oldcoeff, freecoeff points to the third buffer.
-		
-	The default state, when the coefficients haven't changed recently, is that
-	coeff==oldcoeff, and the remaining two pointers point to the remaining two buffers.
+	So there are four blocks, and every one of them has exactly one owner:
+		newparams - where the control side computes new values
+		params - the values the perform routine uses
+		oldparams - the values the perform routine is interpolating away from
+		            (== params when it isn't), else
+		freeparams - the audio side's spare
+		pending - the last block checked in, in transit between the two sides
 	
-	After new coefficients are computed we make them take effect by setting
-	coeff = newcoeff; newcoeff = freecoeff; freecoeff = 0;
+	Checking in swaps newparams with pending, in one atomic exchange that also sets the
+	PARAM_FRESH bit.  Whatever was pending before (an older block nobody picked up, or
+	a spare the audio side gave back) becomes the next newparams.
 	
-	But maybe we already computed new coefficients since the last time the perform routine
-	happened.  In that case coeff will be the "old new" coefficients, computed recently
-	but not yet actually used by a perform routine.  In that case we simply swap coeff and newcoeff.
+	At the start of a vector the perform routine looks at the bit.  If it's set, it
+	swaps its spare with pending, again in one exchange, and interpolates from the old
+	params to the new ones.  At the end of the vector the old params become the spare.
 	
-	The perform routine sees that coeff != oldcoeff and interpolates.  Then it sets
-	freecoeff = oldcoeff; oldcoeff = coeff;
-
+	The exchanges are acquire-release: the control side's stores to a block happen
+	before the audio side's exchange that picks it up, and the audio side's loads from
+	a block it gives back happen before the control side starts writing into it again.
 */
 
 #include "param-update.h"
 
+#define PARAM_FRESH 0x100
+#define PARAM_INDEX(p) ((p) & 0xff)
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define PARAM_EXCHANGE(a, v) ((int)InterlockedExchange((a), (v)))
+#define PARAM_PEEK(a) ((int)*(a))
+#define PARAM_INIT(a, v) (*(a) = (v))
+#else
+#define PARAM_EXCHANGE(a, v) atomic_exchange_explicit((a), (v), memory_order_acq_rel)
+#define PARAM_PEEK(a) atomic_load_explicit((a), memory_order_relaxed)
+#define PARAM_INIT(a, v) atomic_init((a), (v))
+#endif
 
 
-
-void InitParamPointers(paramPointers *pp, void *initialValues, void *blank1, void *blank2) {
-	pp->params = pp->oldparams = initialValues;
-	pp->newparams = blank1;
-	pp->freeparams = blank2;
+void InitParamPointers(paramPointers *pp, void *initialValues, void *blank1, void *blank2, void *blank3) {
+	pp->blocks[0] = initialValues;
+	pp->blocks[1] = blank1;
+	pp->blocks[2] = blank2;
+	pp->blocks[3] = blank3;
+	
+	pp->params = pp->oldparams = pp->latestparams = 0;
+	pp->freeparams = 1;
+	pp->newparams = 2;
+	PARAM_INIT(&pp->pending, 3);
 }
 
 void *CheckOutParamBlock(paramPointers *pp) {
-	if (pp->newparams == 0) {
-		error();
-	}
-	return pp->newparams;
+	return pp->blocks[pp->newparams];
 }
 
-void *GetCurrentParams(paramPointers *pp) {
-	return pp->params;
-}
-
-void *GetPreviousParams(paramPointers *pp) {
-	return pp->oldparams;
+void *GetLatestParams(paramPointers *pp) {
+	return pp->blocks[pp->latestparams];
 }
 
 void CheckInNewParams(paramPointers *pp) {
-	float *prevcoeffs, *prevnew, *prevfree;
-	int i;
-
-	// To make the new coefficients take effect we swap around the pointers to the
-	// coefficient buffers.  See the large comment at the top of this file.
-	// The audio processing interrupt might come at any time.
+	int prev;
 	
-	if (x->coeff == x->oldcoeff) {
-		// Normal case: these are the first new coeffients since the last perform routine		
-
-#ifdef DEBUG		
-		if (!test_normal_state(x)) post("peqbank_compute: x->coeff == x->oldcoeff");
-#endif
-
-		if (x->freecoeff == 0) {
-			post(" peqbank: disaster!  freecoeff shouldn't be zero here!");
-			   post("  coeff = %p, oldcoeff = %p, newcoeff = %p, freecoeff = %p",
-   					x->coeff, x->oldcoeff, x->newcoeff, x->freecoeff);
-
-		}
-		prevcoeffs = x->coeff;
-		prevnew = x->newcoeff;
-		prevfree = x->freecoeff;
-		
-		x->freecoeff = 0;
-		x->coeff = x->newcoeff;	// Now if we're interrupted the new values will be used.
-		x->newcoeff = prevfree;
-
-#ifdef DEBUG		
-		if (!test_newcoeffs_state(x)) post("peqbank_compute: just set first new coeffs");
-#endif
-
-	} else {
-		// We already computed new coeffients since the last perform routine, and now we
-		// have even newer ones.  The perform routine may have interrupted this procedure
-		// already, but it only would have changed oldcoeffs and freecoeffs.
+	// The release half of the exchange makes everything we wrote into newparams
+	// visible to the audio side before it can pick the block up.
+	prev = PARAM_EXCHANGE(&pp->pending, pp->newparams | PARAM_FRESH);
+	pp->latestparams = pp->newparams;
+	pp->newparams = PARAM_INDEX(prev);
+}
 
-#ifdef DEBUG		
-		if (!test_newcoeffs_state(x)) post("peqbank_compute: x->coeff != x->oldcoeff");
-#endif
-		
-		prevcoeffs = x->coeff;
-		prevnew = x->newcoeff;
-		
-		x->coeff = x->newcoeff;
-		x->newcoeff = prevcoeffs;
-
-#ifdef DEBUG		
-		if (!test_newcoeffs_state(x)) post("peqbank_compute: just set new new coeffs");
-#endif
+void *GetCurrentParams(paramPointers *pp) {
+	int next;
+	
+	// Nothing new, or we already swapped this vector
+	if (pp->oldparams != pp->params || !(PARAM_PEEK(&pp->pending) & PARAM_FRESH)) {
+		return pp->blocks[pp->params];
 	}
-
-	// Output the new coefficients out the outlet
-	for (i=0; i<(x->b_nbpeq+1)*NBPARAM; i++) SETFLOAT(x->myList+i, x->coeff[i]);		
-	outlet_list(x->b_outlet, 0L, (x->b_nbpeq+1)*NBPARAM, x->myList);
+	
+	// Only the control side sets the bit and only we clear it, so it's still set
+	// (possibly on an even newer block) when the exchange happens.
+	next = PARAM_EXCHANGE(&pp->pending, pp->freeparams);
+	pp->oldparams = pp->params;
+	pp->params = PARAM_INDEX(next);
+	pp->freeparams = -1;
+	return pp->blocks[pp->params];
 }
 
+void *GetPreviousParams(paramPointers *pp) {
+	return pp->blocks[pp->oldparams];
+}
 
-Sanity Check
-
-    if (x->coeff == x->oldcoeff) {
-    	if (!test_normal_state(x)) post("Assertions failed in tme, x->coeff == x->oldcoeff");
-    } else {
-    	if (!test_newcoeffs_state(x)) post("Assertions failed in tme, x->coeff != x->oldcoeff");
-    }
+void DoneWithPreviousParams(paramPointers *pp) {
+	// Now that we've made it to the end of the signal vector, the "old" parameters are
+	// the ones we just used.  The previous "old" ones, which we've now finished
+	// interpolating away from, are our spare.
+	if (pp->oldparams != pp->params) {
+		pp->freeparams = pp->oldparams;
+		pp->oldparams = pp->params;
+	}
+}
 
 
+void ParamRampFloat(float *inc, const float *from, const float *to, long n, long nsamples) {
+	float rate = 1.0f / (float) nsamples;
+	long i;
+	
+	for (i = 0; i < n; ++i) {
+		inc[i] = (to[i] - from[i]) * rate;
+	}
+}
 
+void ParamRampDouble(double *inc, const double *from, const double *to, long n, long nsamples) {
+	double rate = 1.0 / (double) nsamples;
+	long i;
+	
+	for (i = 0; i < n; ++i) {
+		inc[i] = (to[i] - from[i]) * rate;
+	}
+}
 
+void ParamInterpolateFloat(float *out, const float *from, const float *to, long n, float t) {
+	long i;
+	
+	for (i = 0; i < n; ++i) {
+		out[i] = from[i] + t * (to[i] - from[i]);
+	}
+}
 
-void DoneWithPreviousParams(paramPointers *pp) {
-	if (x->coeff != x->oldcoeff) {
-
-			// Now that we've made it to the end of the signal vector, the "old" coefficients are
-			// the ones we just used.  The previous "old" coeffients, which we've now finished
-			// interpolating away from, are not needed any more.
-			
-			
-			if (x->freecoeff != 0) {
-				post(" peqbank~ disaster!  freecoeff should be zero now!");
-			}
-			
-	#ifdef DEBUG	
-			x->testcoeff3 = x->oldcoeff[3];
-	#endif
-			
-			x->freecoeff = x->oldcoeff;
-			x->oldcoeff = mycoeff;		
+void ParamInterpolateDouble(double *out, const double *from, const double *to, long n, double t) {
+	long i;
+	
+	for (i = 0; i < n; ++i) {
+		out[i] = from[i] + t * (to[i] - from[i]);
 	}
 }
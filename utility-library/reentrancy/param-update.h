@@ -27,42 +27,82 @@ University of California, Berkeley.
 param-update.h
 	API for geting atomic parameter updates for Max/MSP objects
 	Matt Wright, 4/21/2003
+	
+	Made lock-free with C11 atomics, interpolation helpers added, 2026.
 		
 */
 
-typedef void *parameters *;
-
-typedef struct PacketBuffer_struct {
-} *PacketBuffer;
-
-
-/* Put one of these in your object */
+#ifndef __PARAM_UPDATE_H__
+#define __PARAM_UPDATE_H__
+
+/* Visual C++ before 2022 has no <stdatomic.h>; the Interlocked calls are
+   full barriers, which is more than we need but just as correct. */
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <windows.h>
+typedef volatile LONG paramAtomic;
+#else
+#include <stdatomic.h>
+typedef atomic_int paramAtomic;
+#endif
+
+#define PARAM_NUM_BLOCKS 4
+
+
+/* Put one of these in your object.
+
+   There are four parameter blocks.  At any moment one belongs to the control
+   side (the thread computing new values), two to the audio side (the values
+   in use and the values we're interpolating away from, or a spare), and one is
+   "pending": handed over by the control side and maybe not picked up yet.
+   Blocks only ever change hands by swapping the pending index, so neither side
+   waits for the other and a storm of updates costs the perform routine one
+   atomic exchange per vector.
+   
+   Only one thread at a time may be on each side.  Two control threads updating
+   the same object (say, the scheduler in overdrive and the main thread) must
+   take turns, as they always had to. */
 typedef struct _paramPointers {
-	void *params;
-	void *oldparams;
-	void *newparams;
-	void *freeparams;
+	void *blocks[PARAM_NUM_BLOCKS];
+	
+	/* control side */
+	int newparams;		// block we're writing
+	int latestparams;	// block most recently checked in
+	
+	/* audio side */
+	int params;			// block in use
+	int oldparams;		// block used on the previous vector; == params if nothing changed
+	int freeparams;		// block we'll give back on the next swap; -1 while interpolating
+	
+	/* shared */
+	paramAtomic pending;	// block index, | PARAM_FRESH until the audio side picks it up
 } paramPointers;
 
 
-/* You must allocate memory for three blocks of parameters, and pass those
-   three pointers to this procedure to initialize your paramPointer struct.
+/* You must allocate memory for four blocks of parameters, and pass those
+   four pointers to this procedure to initialize your paramPointer struct.
    The first parameter block should contain the initial values for your object;
-   the other two should just have enough memory.  */
-void InitParamPointers(paramPointers *pp, void *initialValues, void *blank1, void *blank2);
+   the others should just have enough memory.  */
+void InitParamPointers(paramPointers *pp, void *initialValues, void *blank1, void *blank2, void *blank3);
 
 
 /* To compute parameter values, first "check out" a parameter block to write the new values
-   into.  The object will continue to run with the previous values. */
+   into.  The object will continue to run with the previous values.  The block's old
+   contents are garbage: write every value, or start from a copy of GetLatestParams(). */
 void *CheckOutParamBlock(paramPointers *pp);
 
 
+/* The values most recently checked in, for the control side to read (never write).
+   The audio side may be reading the same block at the same time. */
+void *GetLatestParams(paramPointers *pp);
+
+
 /* Once the new parameter values are ready to go, "check in" the new values so that they'll
-   take effect on the next perform() */
+   take effect on the next perform().  Checking in again before the perform routine
+   got to the last ones simply replaces them. */
 void CheckInNewParams(paramPointers *pp);
 
 
-/* In the perform() routine, call this to get the current parameter values */
+/* In the perform() routine, call this first to get the current parameter values */
 void *GetCurrentParams(paramPointers *pp);
 
 /* In the perform() routine, call this to get the previous parameter values
@@ -74,3 +114,18 @@ void *GetPreviousParams(paramPointers *pp);
 /* At the end of the perform() routine, after the interpolation reaches the current
    value and there's no longer any need to remember the "previous" value, call this. */
 void DoneWithPreviousParams(paramPointers *pp);
+
+
+/* Interpolation helpers for blocks of coefficients.
+   
+   ParamRamp*() computes per-sample increments that take from[] to to[] in
+   nsamples steps: add inc[i] after each sample and you arrive at to[i] at the
+   end of the vector.  ParamInterpolate*() sets out[] to the point a fraction t
+   (0 = from, 1 = to) of the way, for objects that update once per vector or
+   per sub-block. */
+void ParamRampFloat(float *inc, const float *from, const float *to, long n, long nsamples);
+void ParamRampDouble(double *inc, const double *from, const double *to, long n, long nsamples);
+void ParamInterpolateFloat(float *out, const float *from, const float *to, long n, float t);
+void ParamInterpolateDouble(double *out, const double *from, const double *to, long n, double t);
+
+#endif /* __PARAM_UPDATE_H__ */